@@ -212,6 +212,9 @@
 /* Define to 1 if you have the `PtlGetJid' function. */
 #cmakedefine HAVE_PTLGETJID 1
 
+/* Define to 1 if you have the `pwritev' function. */
+#cmakedefine HAVE_PWRITEV 1
+
 /* Define to 1 if you have the `PtlNIFailStr' function. */
 #cmakedefine HAVE_PTLNIFAILSTR 1
 
@@ -261,6 +264,9 @@
 /* Define to 1 if you have the <sys/stat.h> header file. */
 #cmakedefine HAVE_SYS_STAT_H 1
 
+/* Define to 1 if you have the <sys/inotify.h> header file. */
+#cmakedefine HAVE_SYS_INOTIFY_H 1
+
 /* Define to 1 if you have the <sys/types.h> header file. */
 #cmakedefine HAVE_SYS_TYPES_H 1
 
@@ -78,6 +78,20 @@ void adios_set_max_buffer_size (uint64_t max_buffer_size_MB)
         adios_databuffer_set_max_size (max_buffer_size_MB * 1024L * 1024L);
 }
 
+///////////////////////////////////////////////////////////////////////////////
+void adios_set_buffer_options (int use_hugepages, uint64_t prefault_MB)
+{
+    adios_databuffer_set_hugepages (use_hugepages);
+    if (prefault_MB > 0)
+        adios_databuffer_prefault (prefault_MB * 1024L * 1024L);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void adios_release_buffers (void)
+{
+    adios_databuffer_pool_free ();
+}
+
 ///////////////////////////////////////////////////////////////////////////////
 int adios_open (int64_t * fd, const char * group_name, const char * name
                ,const char * mode, MPI_Comm comm
@@ -377,6 +391,15 @@ int adios_set_transform (int64_t var_id, const char *transform_type_str)
     return adios_common_set_transform (var_id, transform_type_str);
 }
 
+///////////////////////////////////////////////////////////////////////////////
+// adios_common_set_index is in adios_internals.c
+// set the write-time index of the selected variable (default is "none")
+int adios_set_index (int64_t var_id, const char *index_spec)
+{
+    adios_errno = err_no_error;
+    return adios_common_set_index (var_id, index_spec);
+}
+
 
 ///////////////////////////////////////////////////////////////////////////////
 
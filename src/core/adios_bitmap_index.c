@@ -0,0 +1,490 @@
+/*
+ * ADIOS is freely available under the terms of the BSD license described
+ * in the COPYING file in the top level directory of this source distribution.
+ *
+ * Copyright (c) 2008 - 2009.  UT-BATTELLE, LLC. All rights reserved.
+ */
+
+/*
+ * Write-time bitmap index: building the WAH compressed bitmaps of a block,
+ * and writing/reading the side file. See adios_bitmap_index.h for the format.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <inttypes.h>
+#include <math.h>
+#include "core/adios_bitmap_index.h"
+#include "core/adios_logger.h"
+#include "public/adios_error.h"
+
+static const char BITMAP_INDEX_MAGIC[8] = {'A','D','I','O','S','B','M','X'};
+#define BITMAP_INDEX_VERSION 1
+#define BITMAP_INDEX_BYTEORDER 0x01020304
+#define BITMAP_INDEX_HEADER_SIZE 16
+#define BIN_ENTRY_SIZE (2 * sizeof(double) + sizeof(uint32_t))
+
+#define WAH_FILL        0x80000000u
+#define WAH_FILL_ONE    0x40000000u
+#define WAH_MAX_COUNT   0x3fffffffu
+#define WAH_ALL_ONES    0x7fffffffu
+
+int adios_bitmap_index_parse_spec (const char *spec, uint32_t *nbins)
+{
+    *nbins = 0;
+    if (!spec || !spec[0] || !strcasecmp (spec, "none"))
+        return 0;
+    if (strncasecmp (spec, "bitmap", 6))
+        return -1;
+    spec += 6;
+    *nbins = ADIOS_BITMAP_INDEX_DEFAULT_BINS;
+    if (!spec[0])
+        return 0;
+    if (spec[0] != ':' || strncasecmp (spec+1, "bins=", 5))
+        return -1;
+    long n = strtol (spec+6, NULL, 10);
+    if (n < 1 || n > ADIOS_BITMAP_INDEX_MAX_BINS)
+        return -1;
+    *nbins = (uint32_t) n;
+    return 0;
+}
+
+int adios_bitmap_index_supports_type (enum ADIOS_DATATYPES type)
+{
+    switch (type)
+    {
+        case adios_byte:
+        case adios_unsigned_byte:
+        case adios_short:
+        case adios_unsigned_short:
+        case adios_integer:
+        case adios_unsigned_integer:
+        case adios_real:
+        case adios_double:
+            return 1;
+        default:
+            return 0;
+    }
+}
+
+static inline double value_at (enum ADIOS_DATATYPES type, const void *data, uint64_t i)
+{
+    switch (type)
+    {
+        case adios_byte:             return ((const signed char *) data)[i];
+        case adios_unsigned_byte:    return ((const unsigned char *) data)[i];
+        case adios_short:            return ((const int16_t *) data)[i];
+        case adios_unsigned_short:   return ((const uint16_t *) data)[i];
+        case adios_integer:          return ((const int32_t *) data)[i];
+        case adios_unsigned_integer: return ((const uint32_t *) data)[i];
+        case adios_real:             return ((const float *) data)[i];
+        case adios_double:           return ((const double *) data)[i];
+        default:                     return 0.0;
+    }
+}
+
+/* WAH encoder of one bin */
+struct wah
+{
+    uint32_t *words;
+    uint64_t len;
+    uint64_t cap;
+    uint64_t next_group; // groups of 31 elements encoded so far
+    double min, max;
+};
+
+static int wah_push (struct wah *w, uint32_t word)
+{
+    if (w->len == w->cap) {
+        uint64_t cap = (w->cap ? 2 * w->cap : 16);
+        uint32_t *p = (uint32_t *) realloc (w->words, cap * sizeof(uint32_t));
+        if (!p)
+            return -1;
+        w->words = p;
+        w->cap = cap;
+    }
+    w->words[w->len++] = word;
+    return 0;
+}
+
+static int wah_fill (struct wah *w, uint32_t fillbit, uint64_t ngroups)
+{
+    while (ngroups > 0) {
+        uint32_t *last = (w->len ? &w->words[w->len-1] : NULL);
+        if (last && (*last & WAH_FILL) && (*last & WAH_FILL_ONE) == fillbit &&
+            (*last & WAH_MAX_COUNT) < WAH_MAX_COUNT)
+        {
+            uint64_t n = WAH_MAX_COUNT - (*last & WAH_MAX_COUNT);
+            if (n > ngroups)
+                n = ngroups;
+            *last += (uint32_t) n;
+            ngroups -= n;
+        } else {
+            uint64_t n = (ngroups > WAH_MAX_COUNT ? WAH_MAX_COUNT : ngroups);
+            if (wah_push (w, WAH_FILL | fillbit | (uint32_t) n))
+                return -1;
+            ngroups -= n;
+        }
+    }
+    return 0;
+}
+
+/* Add the literal of 'group' (bits of 31 elements), after zero groups since the last one */
+static int wah_add_group (struct wah *w, uint64_t group, uint32_t literal)
+{
+    if (wah_fill (w, 0, group - w->next_group))
+        return -1;
+    w->next_group = group + 1;
+    if (literal == WAH_ALL_ONES)
+        return wah_fill (w, WAH_FILL_ONE, 1);
+    return wah_push (w, literal);
+}
+
+static inline void put (unsigned char **p, const void *v, size_t size)
+{
+    memcpy (*p, v, size);
+    *p += size;
+}
+
+void * adios_bitmap_index_build_record (const char *varname, uint32_t time_index,
+                                        enum ADIOS_DATATYPES type, int ndim,
+                                        const uint64_t *start, const uint64_t *count,
+                                        const void *data, uint32_t nbins,
+                                        uint64_t *record_len)
+{
+    uint64_t nelems = 1, i, g;
+    double lo = INFINITY, hi = -INFINITY, width;
+    struct wah *bins;
+    uint32_t *literals;
+    uint32_t *touched;
+    int d;
+    void *record = NULL;
+
+    *record_len = 0;
+    if (ndim < 1 || ndim > 32 || nbins < 1 || !adios_bitmap_index_supports_type (type))
+        return NULL;
+    for (d = 0; d < ndim; d++)
+        nelems *= count[d];
+
+    for (i = 0; i < nelems; i++) {
+        double v = value_at (type, data, i);
+        if (v < lo) lo = v;
+        if (v > hi) hi = v;
+    }
+    width = (hi - lo) / nbins;
+    if (!(width > 0.0) || !isfinite (width))
+        width = 0.0; // a single value, or infinite values: everything goes into the first bin
+
+    bins = (struct wah *) calloc (nbins, sizeof(struct wah));
+    literals = (uint32_t *) calloc (nbins, sizeof(uint32_t));
+    touched = (uint32_t *) malloc (31 * sizeof(uint32_t));
+    if (!bins || !literals || !touched) {
+        adios_error (err_no_memory, "Cannot allocate the bitmap index of variable %s\n", varname);
+        goto cleanup;
+    }
+    for (i = 0; i < nbins; i++) {
+        bins[i].min = INFINITY;
+        bins[i].max = -INFINITY;
+    }
+
+    // bin the elements 31 at a time, appending one literal to each bin present in the group
+    for (g = 0; g * 31 < nelems; g++) {
+        uint64_t first = g * 31;
+        uint64_t last = (first + 31 < nelems ? first + 31 : nelems);
+        int ntouched = 0, k;
+        for (i = first; i < last; i++) {
+            double v = value_at (type, data, i);
+            uint32_t b = 0;
+            if (v != v)
+                continue; // NaN
+            if (width > 0.0) {
+                double x = (v - lo) / width;
+                b = (x >= nbins ? nbins - 1 : (uint32_t) x);
+            }
+            if (!literals[b])
+                touched[ntouched++] = b;
+            literals[b] |= 1u << (i - first);
+            if (v < bins[b].min) bins[b].min = v;
+            if (v > bins[b].max) bins[b].max = v;
+        }
+        for (k = 0; k < ntouched; k++) {
+            uint32_t b = touched[k];
+            if (wah_add_group (&bins[b], g, literals[b])) {
+                adios_error (err_no_memory, "Cannot allocate the bitmap index of variable %s\n", varname);
+                goto cleanup;
+            }
+            literals[b] = 0;
+        }
+    }
+
+    {
+        uint16_t namelen = (uint16_t) (strlen (varname) + 1);
+        uint64_t len = sizeof(uint64_t) + sizeof(uint32_t) + sizeof(uint16_t) + namelen + 2 +
+                       2 * ndim * sizeof(uint64_t) + sizeof(uint32_t) + nbins * BIN_ENTRY_SIZE;
+        unsigned char *p;
+        uint8_t t8 = (uint8_t) type, nd8 = (uint8_t) ndim;
+
+        for (i = 0; i < nbins; i++)
+            len += bins[i].len * sizeof(uint32_t);
+        record = malloc (len);
+        if (!record) {
+            adios_error (err_no_memory, "Cannot allocate the bitmap index of variable %s\n", varname);
+            goto cleanup;
+        }
+        p = (unsigned char *) record;
+        put (&p, &len, sizeof(uint64_t));
+        put (&p, &time_index, sizeof(uint32_t));
+        put (&p, &namelen, sizeof(uint16_t));
+        put (&p, varname, namelen);
+        put (&p, &t8, 1);
+        put (&p, &nd8, 1);
+        put (&p, start, ndim * sizeof(uint64_t));
+        put (&p, count, ndim * sizeof(uint64_t));
+        put (&p, &nbins, sizeof(uint32_t));
+        for (i = 0; i < nbins; i++) {
+            uint32_t nwords = (uint32_t) bins[i].len;
+            put (&p, &bins[i].min, sizeof(double));
+            put (&p, &bins[i].max, sizeof(double));
+            put (&p, &nwords, sizeof(uint32_t));
+        }
+        for (i = 0; i < nbins; i++)
+            put (&p, bins[i].words, bins[i].len * sizeof(uint32_t));
+        *record_len = len;
+    }
+
+cleanup:
+    if (bins) {
+        for (i = 0; i < nbins; i++)
+            free (bins[i].words);
+        free (bins);
+    }
+    free (literals);
+    free (touched);
+    return record;
+}
+
+int adios_bitmap_index_write_records (const char *filename, int append,
+                                      const void *records, uint64_t len)
+{
+    FILE *f = NULL;
+    long size = 0;
+
+    if (append) {
+        f = fopen (filename, "r+b");
+        if (f && !fseek (f, 0, SEEK_END))
+            size = ftell (f);
+    }
+    if (!f || size < BITMAP_INDEX_HEADER_SIZE) {
+        uint32_t version = BITMAP_INDEX_VERSION, byteorder = BITMAP_INDEX_BYTEORDER;
+        if (f)
+            fclose (f);
+        f = fopen (filename, "wb");
+        if (!f) {
+            adios_error (err_file_open_error, "Cannot create the index file %s\n", filename);
+            return -1;
+        }
+        fwrite (BITMAP_INDEX_MAGIC, 1, sizeof(BITMAP_INDEX_MAGIC), f);
+        fwrite (&version, sizeof(uint32_t), 1, f);
+        fwrite (&byteorder, sizeof(uint32_t), 1, f);
+    }
+    if (len && fwrite (records, 1, len, f) != len) {
+        adios_error (err_write_error, "Cannot write the index file %s\n", filename);
+        fclose (f);
+        return -1;
+    }
+    if (fclose (f)) {
+        adios_error (err_write_error, "Cannot write the index file %s\n", filename);
+        return -1;
+    }
+    return 0;
+}
+
+static inline void get (const unsigned char **p, void *v, size_t size)
+{
+    memcpy (v, *p, size);
+    *p += size;
+}
+
+/* Parse one record at p (with 'avail' bytes left in the file), return its length or 0 if invalid */
+static uint64_t parse_record (const unsigned char *p, uint64_t avail, ADIOS_BITMAP_INDEX_BLOCK *b)
+{
+    const unsigned char *q = p;
+    uint64_t len, nwords = 0, fixed;
+    uint16_t namelen;
+    uint8_t t8, nd8;
+    uint32_t i;
+    int d;
+
+    if (avail < sizeof(uint64_t) + sizeof(uint32_t) + sizeof(uint16_t))
+        return 0;
+    get (&q, &len, sizeof(uint64_t));
+    if (len > avail)
+        return 0;
+    get (&q, &b->time_index, sizeof(uint32_t));
+    get (&q, &namelen, sizeof(uint16_t));
+    fixed = (q - p) + namelen + 2;
+    if (fixed > len || namelen == 0 || q[namelen-1] != '\0')
+        return 0;
+    b->varname = (const char *) q;
+    q += namelen;
+    get (&q, &t8, 1);
+    get (&q, &nd8, 1);
+    b->type = (enum ADIOS_DATATYPES) t8;
+    b->ndim = nd8;
+    if (b->ndim < 1 || b->ndim > 32 || !adios_bitmap_index_supports_type (b->type))
+        return 0;
+    fixed += 2 * b->ndim * sizeof(uint64_t) + sizeof(uint32_t);
+    if (fixed > len)
+        return 0;
+    get (&q, b->start, b->ndim * sizeof(uint64_t));
+    get (&q, b->count, b->ndim * sizeof(uint64_t));
+    get (&q, &b->nbins, sizeof(uint32_t));
+    b->nelems = 1;
+    for (d = 0; d < b->ndim; d++)
+        b->nelems *= b->count[d];
+    if (b->nbins < 1 || b->nbins > ADIOS_BITMAP_INDEX_MAX_BINS ||
+        fixed + b->nbins * BIN_ENTRY_SIZE > len)
+        return 0;
+    b->bins = q;
+    b->words = q + b->nbins * BIN_ENTRY_SIZE;
+    b->word_offsets = (uint64_t *) malloc (b->nbins * sizeof(uint64_t));
+    if (!b->word_offsets)
+        return 0;
+    for (i = 0; i < b->nbins; i++) {
+        uint32_t n;
+        memcpy (&n, b->bins + i * BIN_ENTRY_SIZE + 2 * sizeof(double), sizeof(uint32_t));
+        b->word_offsets[i] = nwords;
+        nwords += n;
+    }
+    if (fixed + b->nbins * BIN_ENTRY_SIZE + nwords * sizeof(uint32_t) != len) {
+        free (b->word_offsets);
+        b->word_offsets = NULL;
+        return 0;
+    }
+    return len;
+}
+
+ADIOS_BITMAP_INDEX_FILE * adios_bitmap_index_read_file (const char *filename)
+{
+    FILE *fp = fopen (filename, "rb");
+    ADIOS_BITMAP_INDEX_FILE *f;
+    unsigned char *buf;
+    uint64_t size, pos;
+    uint32_t version, byteorder;
+    int maxblocks = 0;
+
+    if (!fp)
+        return NULL;
+    if (fseek (fp, 0, SEEK_END) || (long) (size = ftell (fp)) < BITMAP_INDEX_HEADER_SIZE) {
+        fclose (fp);
+        return NULL;
+    }
+    rewind (fp);
+    buf = (unsigned char *) malloc (size);
+    if (!buf || fread (buf, 1, size, fp) != size) {
+        log_warn ("Cannot read the index file %s\n", filename);
+        free (buf);
+        fclose (fp);
+        return NULL;
+    }
+    fclose (fp);
+
+    memcpy (&version, buf + 8, sizeof(uint32_t));
+    memcpy (&byteorder, buf + 12, sizeof(uint32_t));
+    if (memcmp (buf, BITMAP_INDEX_MAGIC, sizeof(BITMAP_INDEX_MAGIC)) ||
+        version != BITMAP_INDEX_VERSION || byteorder != BITMAP_INDEX_BYTEORDER)
+    {
+        log_warn ("%s is not an index file of this version and byte order\n", filename);
+        free (buf);
+        return NULL;
+    }
+
+    f = (ADIOS_BITMAP_INDEX_FILE *) calloc (1, sizeof(ADIOS_BITMAP_INDEX_FILE));
+    f->buffer = buf;
+    pos = BITMAP_INDEX_HEADER_SIZE;
+    while (pos < size) {
+        uint64_t len;
+        if (f->nblocks == maxblocks) {
+            maxblocks = (maxblocks ? 2 * maxblocks : 64);
+            f->blocks = (ADIOS_BITMAP_INDEX_BLOCK *) realloc (f->blocks,
+                                maxblocks * sizeof(ADIOS_BITMAP_INDEX_BLOCK));
+        }
+        len = parse_record (buf + pos, size - pos, &f->blocks[f->nblocks]);
+        if (!len) {
+            log_warn ("Index file %s is damaged at offset %" PRIu64 ", "
+                      "the rest of the file is ignored\n", filename, pos);
+            break;
+        }
+        f->nblocks++;
+        pos += len;
+    }
+    return f;
+}
+
+void adios_bitmap_index_free_file (ADIOS_BITMAP_INDEX_FILE *f)
+{
+    int i;
+    if (!f)
+        return;
+    for (i = 0; i < f->nblocks; i++)
+        free (f->blocks[i].word_offsets);
+    free (f->blocks);
+    free (f->buffer);
+    free (f);
+}
+
+void adios_bitmap_index_bin_info (const ADIOS_BITMAP_INDEX_BLOCK *b, uint32_t bin,
+                                  double *min, double *max, uint32_t *nwords)
+{
+    const unsigned char *e = b->bins + bin * BIN_ENTRY_SIZE;
+    memcpy (min, e, sizeof(double));
+    memcpy (max, e + sizeof(double), sizeof(double));
+    memcpy (nwords, e + 2 * sizeof(double), sizeof(uint32_t));
+}
+
+/* Set bits [from, to) */
+static void set_bit_range (uint64_t *bits, uint64_t from, uint64_t to)
+{
+    if (from >= to)
+        return;
+    uint64_t w0 = from >> 6, w1 = (to - 1) >> 6;
+    uint64_t m0 = ~0ULL << (from & 63);
+    uint64_t m1 = ~0ULL >> (63 - ((to - 1) & 63));
+    if (w0 == w1) {
+        bits[w0] |= m0 & m1;
+        return;
+    }
+    bits[w0] |= m0;
+    for (w0++; w0 < w1; w0++)
+        bits[w0] = ~0ULL;
+    bits[w1] |= m1;
+}
+
+void adios_bitmap_index_or_bin (const ADIOS_BITMAP_INDEX_BLOCK *b, uint32_t bin, uint64_t *bits)
+{
+    double min, max;
+    uint32_t nwords, i;
+    const unsigned char *w = b->words + b->word_offsets[bin] * sizeof(uint32_t);
+    uint64_t pos = 0; // element of the current word
+
+    adios_bitmap_index_bin_info (b, bin, &min, &max, &nwords);
+    for (i = 0; i < nwords && pos < b->nelems; i++) {
+        uint32_t word;
+        memcpy (&word, w + i * sizeof(uint32_t), sizeof(uint32_t));
+        if (word & WAH_FILL) {
+            uint64_t n = (uint64_t) (word & WAH_MAX_COUNT) * 31;
+            if (word & WAH_FILL_ONE)
+                set_bit_range (bits, pos, (pos + n < b->nelems ? pos + n : b->nelems));
+            pos += n;
+        } else {
+            // literal bits beyond nelems are never set
+            uint64_t lit = word;
+            int shift = pos & 63;
+            bits[pos >> 6] |= lit << shift;
+            if (shift > 64 - 31)
+                bits[(pos >> 6) + 1] |= lit >> (64 - shift);
+            pos += 31;
+        }
+    }
+}
@@ -0,0 +1,100 @@
+/*
+ * ADIOS is freely available under the terms of the BSD license described
+ * in the COPYING file in the top level directory of this source distribution.
+ *
+ * Copyright (c) 2008 - 2009.  UT-BATTELLE, LLC. All rights reserved.
+ */
+
+/*
+ * Write-time bitmap index of array variables.
+ *
+ * For variables with an index (index="bitmap[:bins=N]" in the XML or
+ * adios_set_index()), each block written by adios_write() is binned into
+ * N equal-width bins between the min and max of the block, and the
+ * positions of the elements of each bin are stored as a WAH (word-aligned
+ * hybrid) compressed bitmap. The indexes of all blocks of an output step
+ * are appended to a side file next to the output file (<file>.idx) at
+ * adios_close(), which the BITMAP query method reads.
+ *
+ * Side file: a 16 byte header ("ADIOSBMX", uint32 version, uint32 0x01020304
+ * in the byte order of the writer), then one record per block:
+ *   uint64 record length (including this field)
+ *   uint32 time index of the output step
+ *   uint16 name length (including the terminating 0), name
+ *   uint8  type, uint8 ndim
+ *   uint64 global offsets [ndim], uint64 local dimensions [ndim]
+ *   uint32 nbins
+ *   nbins x { double min, double max, uint32 nwords } (min/max of the values in the bin)
+ *   the WAH words of bin 0, bin 1, ...
+ *
+ * WAH words: a literal word (bit 31 = 0) holds the bits of 31 consecutive
+ * elements (the first element in bit 0), a fill word (bit 31 = 1) stands for
+ * (bits 0-29) groups of 31 elements, all with the value of bit 30.
+ * Empty bins have no words. NaN values are not in any bin.
+ */
+#ifndef ADIOS_BITMAP_INDEX_H
+#define ADIOS_BITMAP_INDEX_H
+
+#include <stdint.h>
+#include "public/adios_types.h"
+
+#define ADIOS_BITMAP_INDEX_DEFAULT_BINS 64
+#define ADIOS_BITMAP_INDEX_MAX_BINS 4096
+#define ADIOS_BITMAP_INDEX_SUFFIX ".idx"
+
+/* Parse an index specification: "bitmap" or "bitmap:bins=N" sets *nbins,
+ * "none" or "" sets it to 0 (no index). Returns 0 on success, -1 if the
+ * specification is not recognized. */
+int adios_bitmap_index_parse_spec (const char *spec, uint32_t *nbins);
+
+/* 1 if variables of 'type' can be indexed (integers up to 32 bits, float and double) */
+int adios_bitmap_index_supports_type (enum ADIOS_DATATYPES type);
+
+/* Build the side file record of one block with 'nbins' bins.
+ * Returns a malloc'ed record of *record_len bytes, NULL on error. */
+void * adios_bitmap_index_build_record (const char *varname, uint32_t time_index,
+                                        enum ADIOS_DATATYPES type, int ndim,
+                                        const uint64_t *start, const uint64_t *count,
+                                        const void *data, uint32_t nbins,
+                                        uint64_t *record_len);
+
+/* Write 'len' bytes of records to the side file 'filename'. A new file is
+ * created (with the header) unless 'append' is set and the file exists.
+ * Returns 0 on success, -1 on error. */
+int adios_bitmap_index_write_records (const char *filename, int append,
+                                      const void *records, uint64_t len);
+
+/* One block in a side file loaded into memory */
+typedef struct {
+    const char *varname;
+    uint32_t time_index;
+    enum ADIOS_DATATYPES type;
+    int ndim;
+    uint64_t start[32];
+    uint64_t count[32];
+    uint64_t nelems;
+    uint32_t nbins;
+    const unsigned char *bins;   // bin table
+    const unsigned char *words;  // WAH words of all bins
+    uint64_t *word_offsets;      // index of the first word of each bin in 'words'
+} ADIOS_BITMAP_INDEX_BLOCK;
+
+typedef struct {
+    void *buffer;
+    int nblocks;
+    ADIOS_BITMAP_INDEX_BLOCK *blocks;
+} ADIOS_BITMAP_INDEX_FILE;
+
+/* Load a side file. Returns NULL if it does not exist or is not a valid side file. */
+ADIOS_BITMAP_INDEX_FILE * adios_bitmap_index_read_file (const char *filename);
+void adios_bitmap_index_free_file (ADIOS_BITMAP_INDEX_FILE *f);
+
+/* Min/max of the values in a bin of a block, and the number of its WAH words (0 = empty bin) */
+void adios_bitmap_index_bin_info (const ADIOS_BITMAP_INDEX_BLOCK *b, uint32_t bin,
+                                  double *min, double *max, uint32_t *nwords);
+
+/* OR the bitmap of a bin into 'bits', a plain bitmap of b->nelems bits
+ * (element i is bit i%64 of bits[i/64]) with at least b->nelems/64+1 words */
+void adios_bitmap_index_or_bin (const ADIOS_BITMAP_INDEX_BLOCK *b, uint32_t bin, uint64_t *bits);
+
+#endif
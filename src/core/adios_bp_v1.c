@@ -2359,6 +2359,92 @@ void adios_posix_close_internal (struct adios_bp_buffer_struct_v1 * b)
     adios_buffer_struct_clear (b);
 }
 
+#define STEP_MARKER_MAGIC "ADIOS-BP-STEP"
+
+char * adios_step_marker_name (const char * filename)
+{
+    char * name = (char *) malloc (strlen (filename) + strlen (ADIOS_STEP_MARKER_SUFFIX) + 1);
+    if (name)
+    {
+        sprintf (name, "%s%s", filename, ADIOS_STEP_MARKER_SUFFIX);
+    }
+    return name;
+}
+
+/* The marker holds the step (time index) of the last step completed in the
+ * file and the size of the file at that point, as one line of text. It is
+ * written to a temporary file and renamed, so readers never see a partial
+ * marker and the rename itself is the notification. */
+int adios_write_step_marker_v1 (const char * filename, uint32_t step, uint64_t file_size)
+{
+    char * name = adios_step_marker_name (filename);
+    char * tmpname;
+    char line [64];
+    int f, len, err = 0;
+
+    if (!name)
+        return ENOMEM;
+    tmpname = (char *) malloc (strlen (name) + 5);
+    if (!tmpname)
+    {
+        free (name);
+        return ENOMEM;
+    }
+    sprintf (tmpname, "%s.tmp", name);
+
+    len = snprintf (line, sizeof (line), STEP_MARKER_MAGIC " %u %" PRIu64 "\n", step, file_size);
+    f = open (tmpname, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (f == -1 || write (f, line, len) != len)
+    {
+        err = errno;
+    }
+    if (f != -1)
+    {
+        close (f);
+    }
+    if (!err && rename (tmpname, name))
+    {
+        err = errno;
+    }
+    if (err)
+    {
+        log_warn ("Could not write the step marker %s: %s\n", name, strerror (err));
+        unlink (tmpname);
+    }
+
+    free (tmpname);
+    free (name);
+    return err;
+}
+
+int adios_read_step_marker_v1 (const char * filename, uint32_t * step, uint64_t * file_size)
+{
+    char * name = adios_step_marker_name (filename);
+    char line [64];
+    unsigned long long size;
+    unsigned int s;
+    ssize_t len;
+    int f;
+
+    if (!name)
+        return ENOMEM;
+    f = open (name, O_RDONLY);
+    free (name);
+    if (f == -1)
+        return ENOENT;
+    len = read (f, line, sizeof (line) - 1);
+    close (f);
+    if (len <= 0)
+        return EINVAL;
+    line [len] = '\0';
+
+    if (sscanf (line, STEP_MARKER_MAGIC " %u %llu", &s, &size) != 2)
+        return EINVAL;
+    *step = s;
+    *file_size = (uint64_t) size;
+    return 0;
+}
+
 uint64_t adios_get_type_size (enum ADIOS_DATATYPES type, const void * var)
 {
     switch (type)
@@ -18,6 +18,8 @@
 #define ADIOS_VERSION_NUM_MASK                       0x000000FF
 #define ADIOS_VERSION_HAVE_SUBFILE                   0x00000100
 #define ADIOS_VERSION_HAVE_TIME_INDEX_CHARACTERISTIC 0x00000200
+// each step has its own index, chained to the previous one (see bp_utils.c)
+#define ADIOS_VERSION_HAVE_CHAINED_INDEX             0x00000400
 enum ADIOS_CHARACTERISTICS
 {
      adios_characteristic_value          = 0
@@ -363,6 +365,17 @@ int adios_posix_open_read_internal (const char * filename
                                    );
 void adios_posix_close_internal (struct adios_bp_buffer_struct_v1 * b);
 
+// Step marker: a small file next to a BP file written step by step, replaced
+// (renamed over) after the footer of each step is in the file, so that
+// streaming readers can watch it instead of reopening the file to poll it
+#define ADIOS_STEP_MARKER_SUFFIX ".step"
+// returns a new string, filename + ADIOS_STEP_MARKER_SUFFIX
+char * adios_step_marker_name (const char * filename);
+// returns 0 on success, an errno value otherwise
+int adios_write_step_marker_v1 (const char * filename, uint32_t step, uint64_t file_size);
+// returns 0 on success, ENOENT if there is no marker, EINVAL if it is not valid
+int adios_read_step_marker_v1 (const char * filename, uint32_t * step, uint64_t * file_size);
+
 // ADIOS statistics related functions
 uint64_t adios_get_stat_size (void * data, enum ADIOS_DATATYPES type, enum ADIOS_STAT stat_id);
 uint8_t adios_get_stat_set_count (enum ADIOS_DATATYPES type);
@@ -22,9 +22,12 @@
 #include "public/adios.h"
 #include "core/adios_internals.h"
 #include "core/adios_bp_v1.h"
+#include "core/adios_endianness.h"
 #include "core/qhashtbl.h"
 #include "core/adios_logger.h"
 #include "core/util.h"
+#include "core/adios_stats.h"
+#include "core/adios_bitmap_index.h"
 
 #ifdef DMALLOC
 #include "dmalloc.h"
@@ -49,6 +52,7 @@ void adios_file_struct_init (struct adios_file_struct * fd)
     fd->pgs_written = NULL;
     fd->current_pg = NULL;
     fd->allocated_bufptr = NULL;
+    fd->buffer_mapped = 0;
     fd->buffer = NULL;
     fd->shared_buffer = adios_flag_no;
     fd->bufstrat = no_buffering;
@@ -61,7 +65,14 @@ void adios_file_struct_init (struct adios_file_struct * fd)
     fd->nvars_written = 0;
     fd->attrs_start = 0;
     fd->nattrs_written = 0;
+    fd->zero_copy_threshold = 0;
+    fd->payload_refs = NULL;
+    fd->payload_refs_count = 0;
+    fd->payload_refs_allocated = 0;
+    fd->payload_refs_size = 0;
     fd->comm = MPI_COMM_NULL;
+    fd->bitmap_index_records = NULL;
+    fd->bitmap_index_records_size = 0;
 }
 
 int adios_int_is_var (const char * temp) // 1 == yes, 0 == no
@@ -1842,6 +1853,7 @@ int64_t adios_common_define_var (int64_t group_id, const char * name
     // NCSU - Initializing stat related info
     v->stats = 0;
     v->bitmap = 0;
+    v->bitmap_index_bins = 0;
 
     // NCSU ALACRITY-ADIOS - Initialize transform metadata (set to 'none')
     adios_transform_init_transform_var(v);
@@ -1982,6 +1994,28 @@ int adios_common_set_transform (int64_t var_id, const char *transform_type_str)
     return adios_errno;
 }
 
+/* Set the write-time index of a variable */
+int adios_common_set_index (int64_t var_id, const char *index_spec)
+{
+    struct adios_var_struct * v = (struct adios_var_struct *)var_id;
+    uint32_t nbins;
+    assert (v);
+    adios_errno = err_no_error;
+    if (adios_bitmap_index_parse_spec (index_spec, &nbins)) {
+        adios_error (err_invalid_value_attr,
+                     "Unknown index \"%s\" specified for variable \"%s\", ignoring it...\n",
+                     index_spec, v->name);
+        return adios_errno;
+    }
+    if (nbins && (!v->dimensions || !adios_bitmap_index_supports_type (v->type))) {
+        log_warn ("Index \"%s\" is supported only for arrays of integers up to 32 bits, "
+                  "float and double, variable \"%s\" will not be indexed\n", index_spec, v->name);
+        nbins = 0;
+    }
+    v->bitmap_index_bins = nbins;
+    return adios_errno;
+}
+
 
 void adios_common_get_group (int64_t * group_id, const char * name)
 {
@@ -2359,7 +2393,7 @@ int adios_write_open_process_group_header_v1 (struct adios_file_struct * fd)
 int adios_write_close_process_group_header_v1 (struct adios_file_struct * fd)
 {
     // close the PG area: write the total size to the beginning of the buffer
-    uint64_t size = fd->offset - fd->pg_start;
+    uint64_t size = fd->offset + fd->payload_refs_size - fd->pg_start;
     uint64_t offset = fd->pg_start;
     buffer_write (&fd->buffer, &fd->buffer_size, &offset, &size, 8);
     return 0;
@@ -2408,6 +2442,122 @@ void index_append_process_group_v1 (
     //print_pglist (index->pg_root, "Result");
 }
 
+/* Make room for 'needed' characteristics. The array grows geometrically,
+ * so that appending the characteristics of many processes one by one
+ * (e.g. building the global index) copies them only O(1) times. */
+static int index_reserve_characteristics_v1 (
+        struct adios_index_characteristic_struct_v1 ** characteristics
+        ,uint64_t * allocated
+        ,uint64_t needed
+        )
+{
+    uint64_t n = 2 * (*allocated);
+    void * ptr;
+
+    if (needed <= *allocated)
+        return 0;
+    if (n < needed)
+        n = needed;
+    ptr = realloc (*characteristics,
+                   n * sizeof (struct adios_index_characteristic_struct_v1));
+    if (!ptr)
+        return 1;
+    *characteristics = ptr;
+    *allocated = n;
+    return 0;
+}
+
+/* Order of run a and b in the heap of index_sort_characteristics_v1():
+ * by the time index of their next characteristic, then by run */
+static int index_run_before (const struct adios_index_characteristic_struct_v1 * c
+                            ,const uint64_t * next, uint64_t a, uint64_t b)
+{
+    return (c [next [a]].time_index < c [next [b]].time_index ||
+            (c [next [a]].time_index == c [next [b]].time_index && a < b));
+}
+
+static void index_sift_down (const struct adios_index_characteristic_struct_v1 * c
+                            ,const uint64_t * next, uint64_t * heap
+                            ,uint64_t nheap, uint64_t i)
+{
+    while (2 * i + 1 < nheap)
+    {
+        uint64_t k = 2 * i + 1, t;
+        if (k + 1 < nheap && index_run_before (c, next, heap [k + 1], heap [k]))
+            k++;
+        if (!index_run_before (c, next, heap [k], heap [i]))
+            break;
+        t = heap [i]; heap [i] = heap [k]; heap [k] = t;
+        i = k;
+    }
+}
+
+/* Sort the characteristics of a variable by time index. The array is a
+ * sequence of runs already in time order (one per merged index), which are
+ * merged in one pass with a heap. Characteristics with the same time index
+ * keep their order, i.e. the order in which the indexes were merged. */
+static void index_sort_characteristics_v1 (struct adios_index_var_struct_v1 * v)
+{
+    struct adios_index_characteristic_struct_v1 * c = v->characteristics;
+    struct adios_index_characteristic_struct_v1 * sorted;
+    uint64_t n = v->characteristics_count;
+    uint64_t nruns = 1, nheap, i, k;
+    uint64_t * end, * next, * heap;
+
+    for (i = 1; i < n; i++)
+    {
+        if (c [i].time_index < c [i - 1].time_index)
+            nruns++;
+    }
+    if (nruns == 1)
+        return;
+
+    sorted = malloc (v->characteristics_allocated
+                     * sizeof (struct adios_index_characteristic_struct_v1));
+    end = malloc (3 * nruns * sizeof (uint64_t));
+    if (!sorted || !end)
+    {
+        adios_error (err_no_memory, "error allocating memory to build "
+                "var index.  Index aborted\n");
+        free (sorted);
+        free (end);
+        return;
+    }
+    next = end + nruns;
+    heap = next + nruns;
+
+    // run k is [next [k], end [k])
+    next [0] = 0;
+    for (i = 1, k = 0; i < n; i++)
+    {
+        if (c [i].time_index < c [i - 1].time_index)
+        {
+            end [k++] = i;
+            next [k] = i;
+        }
+    }
+    end [k] = n;
+
+    for (k = 0; k < nruns; k++)
+        heap [k] = k;
+    nheap = nruns;
+    for (k = nruns / 2; k-- > 0; )
+        index_sift_down (c, next, heap, nheap, k);
+
+    for (i = 0; i < n; i++)
+    {
+        k = heap [0];
+        sorted [i] = c [next [k]++];
+        if (next [k] == end [k])
+            heap [0] = heap [--nheap];
+        index_sift_down (c, next, heap, nheap, 0);
+    }
+
+    free (c);
+    free (end);
+    v->characteristics = sorted;
+}
+
 void index_append_var_v1 (
         struct adios_index_struct_v1 *index
         ,struct adios_index_var_struct_v1 * item
@@ -2465,109 +2615,25 @@ void index_append_var_v1 (
             return;
         }
 
+        if (index_reserve_characteristics_v1 (&olditem->characteristics,
+                    &olditem->characteristics_allocated,
+                    olditem->characteristics_count + item->characteristics_count))
+        {
+            adios_error (err_no_memory, "error allocating memory to build "
+                    "var index.  Index aborted\n");
+            return;
+        }
+        memcpy (&olditem->characteristics [olditem->characteristics_count],
+                item->characteristics,
+                item->characteristics_count *
+                sizeof (struct adios_index_characteristic_struct_v1)
+               );
+        olditem->characteristics_count += item->characteristics_count;
+
         if (do_sort && item->characteristics_count > 0) 
         {
             log_debug ("  ----------- Append index with merging --------------\n");
-            struct adios_index_characteristic_struct_v1 * c;
-            int count = olditem->characteristics_count + item->characteristics_count;
-            c = malloc ( count * sizeof (struct adios_index_characteristic_struct_v1));
-            if (!c)
-            {
-                adios_error (err_no_memory, "error allocating memory to build "
-                        "var index.  Index aborted\n");
-                return;
-            }
-            /* Merge the characteristics sorted with time_index */
-            struct adios_index_characteristic_struct_v1 * c1 = olditem->characteristics;
-            struct adios_index_characteristic_struct_v1 * c2 = item->characteristics;
-            uint64_t k1 = 0;
-            uint64_t k2 = 0;
-            struct adios_index_characteristic_struct_v1 * cend = c;
-            log_debug ("  old count=%" PRIu64 " item count=%" PRIu64 "\n", olditem->characteristics_count, item->characteristics_count);
-            while (k1 < olditem->characteristics_count || k2 < item->characteristics_count)
-            {
-                log_debug ("  k1=%" PRIu64 " k2=%" PRIu64 "", k1, k2);
-                /*
-                if (k2 >= item->characteristics_count || c1->time_index <= c2->time_index) {
-                    memcpy (cend, c1, sizeof(struct adios_index_characteristic_struct_v1)); 
-                    log_debug_cont ("  -> choose c1, time_index=%u", c1->time_index);
-                    c1++;
-                    k1++;
-                }
-                else if (k1 >= olditem->characteristics_count || c1->time_index > c2->time_index) {
-                    memcpy (cend, c2, sizeof(struct adios_index_characteristic_struct_v1)); 
-                    log_debug_cont ("  -> choose c2, time_index=%u", c2->time_index);
-                    c2++;
-                    k2++;
-                }*/
-                if (k2 >= item->characteristics_count) {
-                    memcpy (cend, c1, sizeof(struct adios_index_characteristic_struct_v1)); 
-                    log_debug_cont ("  -> only c1, time_index=%u", c1->time_index);
-                    c1++;
-                    k1++;
-                }
-                else if (k1 >= olditem->characteristics_count) {
-                    memcpy (cend, c2, sizeof(struct adios_index_characteristic_struct_v1)); 
-                    log_debug_cont ("  -> only c2, time_index=%u", c2->time_index);
-                    c2++;
-                    k2++;
-                }
-                else if (c1->time_index <= c2->time_index) {
-                    memcpy (cend, c1, sizeof(struct adios_index_characteristic_struct_v1)); 
-                    log_debug_cont ("  -> choose c1, time_index=%u", c1->time_index);
-                    c1++;
-                    k1++;
-                }
-                else {
-                    memcpy (cend, c2, sizeof(struct adios_index_characteristic_struct_v1)); 
-                    log_debug_cont ("  -> choose c2, time_index=%u", c2->time_index);
-                    c2++;
-                    k2++;
-                }
-                cend++;
-                log_debug_cont ("\n");
-            }
-            free (olditem->characteristics);
-            olditem->characteristics = c;
-            olditem->characteristics_allocated = count;
-            olditem->characteristics_count = count;
-             
-        } 
-        else 
-        {
-            if (  olditem->characteristics_count
-                    + item->characteristics_count
-                    > olditem->characteristics_allocated
-               )
-            {
-                int new_items = (item->characteristics_count == 1)
-                    ? 100 : item->characteristics_count;
-                olditem->characteristics_allocated =
-                    olditem->characteristics_count + new_items;
-                void * ptr = realloc (
-                        olditem->characteristics,
-                        olditem->characteristics_allocated *
-                        sizeof (struct adios_index_characteristic_struct_v1)
-                        );
-
-                if (ptr)
-                {
-                    olditem->characteristics = ptr;
-                }
-                else
-                {
-                    adios_error (err_no_memory, "error allocating memory to build "
-                            "var index.  Index aborted\n");
-                    return;
-                }
-            }
-            memcpy (&olditem->characteristics [olditem->characteristics_count],
-                    item->characteristics,
-                    item->characteristics_count *
-                    sizeof (struct adios_index_characteristic_struct_v1)
-                   );
-
-            olditem->characteristics_count += item->characteristics_count;
+            index_sort_characteristics_v1 (olditem);
         }
 
         free (item->characteristics);
@@ -2597,31 +2663,13 @@ static void index_append_attribute_v1
                     && !strcasecmp (item->attr_path, (*root)->attr_path)
                )
             {
-                if (    (*root)->characteristics_count
-                        + item->characteristics_count
-                        > (*root)->characteristics_allocated
-                   )
+                if (index_reserve_characteristics_v1 (&(*root)->characteristics,
+                            &(*root)->characteristics_allocated,
+                            (*root)->characteristics_count + item->characteristics_count))
                 {
-                    int new_items = (item->characteristics_count == 1)
-                        ? 100 : item->characteristics_count;
-                    (*root)->characteristics_allocated =
-                        (*root)->characteristics_count + new_items;
-                    void * ptr;
-                    ptr = realloc ((*root)->characteristics
-                            ,  (*root)->characteristics_allocated
-                            * sizeof (struct adios_index_characteristic_struct_v1)
-                            );
-
-                    if (ptr)
-                    {
-                        (*root)->characteristics = ptr;
-                    }
-                    else
-                    {
-                        adios_error (err_no_memory, "error allocating memory to build "
-                                "attribute index.  Index aborted\n");
-                        return;
-                    }
+                    adios_error (err_no_memory, "error allocating memory to build "
+                            "attribute index.  Index aborted\n");
+                    return;
                 }
                 memcpy (&(*root)->characteristics
                         [(*root)->characteristics_count]
@@ -2651,6 +2699,8 @@ static void index_append_attribute_v1
 // lists in new_index will be destroyed as part of the merge operation...
 // needs_sorting: use 1 if the the inserted new list has multiple timesteps
 //                it will merge sort the characteristics to keep the time in order
+//                To merge many indexes, merge them all without sorting and
+//                call adios_sort_index_characteristics_v1() once at the end
 void adios_merge_index_v1 (
                    struct adios_index_struct_v1 * main_index
                   ,struct adios_index_process_group_struct_v1 * new_pg_root
@@ -2686,6 +2736,245 @@ void adios_merge_index_v1 (
     }
 }
 
+void adios_sort_index_characteristics_v1 (struct adios_index_struct_v1 * index)
+{
+    struct adios_index_var_struct_v1 * v = index->vars_root;
+
+    while (v)
+    {
+        index_sort_characteristics_v1 (v);
+        v = v->next;
+    }
+}
+
+#ifndef _NOMPI
+#define ADIOS_INDEX_REDUCE_TAG 0x1d3e
+// MPI counts are int, larger indexes are sent in pieces of this size
+#define ADIOS_INDEX_REDUCE_CHUNK ((uint64_t) INT_MAX)
+
+static void index_send_v1 (MPI_Comm comm, int dest, char * buffer, uint64_t size)
+{
+    uint64_t sent, n;
+
+    MPI_Send (&size, 1, MPI_UNSIGNED_LONG_LONG, dest, ADIOS_INDEX_REDUCE_TAG, comm);
+    for (sent = 0; sent < size; sent += n)
+    {
+        n = (size - sent < ADIOS_INDEX_REDUCE_CHUNK ? size - sent : ADIOS_INDEX_REDUCE_CHUNK);
+        MPI_Send (buffer + sent, (int) n, MPI_BYTE, dest, ADIOS_INDEX_REDUCE_TAG, comm);
+    }
+}
+
+/* Receive the index of process 'src' and merge it into 'index'.
+ * Attributes of other processes are not merged (since 1.4). */
+static void index_recv_merge_v1 (MPI_Comm comm, int src
+                                ,struct adios_index_struct_v1 * index
+                                )
+{
+    struct adios_bp_buffer_struct_v1 b;
+    struct adios_index_process_group_struct_v1 * new_pg_root = 0;
+    struct adios_index_var_struct_v1 * new_vars_root = 0;
+    uint64_t size = 0, received, n;
+    char * buffer;
+
+    MPI_Recv (&size, 1, MPI_UNSIGNED_LONG_LONG, src, ADIOS_INDEX_REDUCE_TAG
+             ,comm, MPI_STATUS_IGNORE
+             );
+    buffer = malloc (size);
+    if (!buffer)
+    {
+        adios_error (err_no_memory, "Cannot allocate %" PRIu64 " bytes to receive the "
+                "index of process %d. Index aborted\n", size, src);
+
+        /* The sender is still sending its index. Receive the pieces into
+         * one piece-sized buffer and drop them, so that the sends complete and
+         * the reduction goes on without this index. */
+        n = (size < ADIOS_INDEX_REDUCE_CHUNK ? size : ADIOS_INDEX_REDUCE_CHUNK);
+        buffer = malloc (n);
+        if (!buffer)
+        {
+            MPI_Abort (comm, err_no_memory);
+            return;
+        }
+        for (received = 0; received < size; received += n)
+        {
+            n = (size - received < ADIOS_INDEX_REDUCE_CHUNK ? size - received
+                                                            : ADIOS_INDEX_REDUCE_CHUNK);
+            MPI_Recv (buffer, (int) n, MPI_BYTE, src, ADIOS_INDEX_REDUCE_TAG, comm
+                     ,MPI_STATUS_IGNORE
+                     );
+        }
+        free (buffer);
+        return;
+    }
+    for (received = 0; received < size; received += n)
+    {
+        n = (size - received < ADIOS_INDEX_REDUCE_CHUNK ? size - received
+                                                        : ADIOS_INDEX_REDUCE_CHUNK);
+        MPI_Recv (buffer + received, (int) n, MPI_BYTE, src, ADIOS_INDEX_REDUCE_TAG, comm
+                 ,MPI_STATUS_IGNORE
+                 );
+    }
+
+    adios_buffer_struct_init (&b);
+    b.buff = buffer;
+    b.length = size;
+    b.change_endianness = adios_flag_no;
+    adios_parse_process_group_index_v1 (&b, &new_pg_root, NULL);
+    adios_parse_vars_index_v1 (&b, &new_vars_root, NULL, NULL);
+    adios_merge_index_v1 (index, new_pg_root, new_vars_root, 0, 0);
+
+    free (buffer);
+}
+
+void adios_reduce_index_v1 (MPI_Comm comm, int fanin
+                           ,struct adios_index_struct_v1 * index
+                           )
+{
+    int rank, size, i;
+    int64_t stride, group;
+
+    MPI_Comm_rank (comm, &rank);
+    MPI_Comm_size (comm, &size);
+    if (fanin < 2)
+        fanin = 2;
+    if (fanin > size)
+        fanin = size;
+
+    /* In the round with 'stride', the processes at multiples of
+     * fanin*stride receive from the next fanin-1 processes at multiples of
+     * stride, which send their merged index and are done. Children are
+     * merged in rank order, so rank 0 ends up with the indexes of all
+     * processes in rank order, like merging them one by one. */
+    for (stride = 1; stride < size; stride *= fanin)
+    {
+        group = rank % (stride * fanin);
+        if (group)
+        {
+            char * buffer = 0;
+            uint64_t buffer_size = 0;
+            uint64_t buffer_offset = 0;
+
+            adios_write_index_v1 (&buffer, &buffer_size, &buffer_offset, 0, index);
+            index_send_v1 (comm, (int) (rank - group), buffer, buffer_offset);
+            free (buffer);
+            return;
+        }
+        for (i = 1; i < fanin && rank + i * stride < size; i++)
+        {
+            index_recv_merge_v1 (comm, (int) (rank + i * stride), index);
+        }
+    }
+}
+
+/* Read one index (process groups, variables and attributes) from the footer
+ * ending at b->file_size into new lists */
+static int read_index_at_v1 (MPI_File fh, struct adios_bp_buffer_struct_v1 * b
+                            ,struct adios_index_process_group_struct_v1 ** pg_root
+                            ,struct adios_index_var_struct_v1 ** vars_root
+                            ,struct adios_index_attribute_struct_v1 ** attrs_root
+                            )
+{
+    MPI_Status status;
+
+    adios_init_buffer_read_version (b);
+    MPI_File_seek (fh, b->file_size - 28, MPI_SEEK_SET);
+    MPI_File_read (fh, b->buff, 28, MPI_BYTE, &status);
+    adios_init_buffer_read_index_offsets (b);
+    if (adios_parse_index_offsets_v1 (b))
+        return 1;
+    if (b->pg_index_offset >= b->vars_index_offset
+        || b->vars_index_offset >= b->attrs_index_offset
+        || b->attrs_index_offset + 28 > b->file_size)
+        return 1;
+
+    adios_init_buffer_read_process_group_index (b);
+    MPI_File_seek (fh, b->pg_index_offset, MPI_SEEK_SET);
+    MPI_File_read (fh, b->buff, b->pg_size, MPI_BYTE, &status);
+    adios_parse_process_group_index_v1 (b, pg_root, NULL);
+
+    adios_init_buffer_read_vars_index (b);
+    MPI_File_seek (fh, b->vars_index_offset, MPI_SEEK_SET);
+    MPI_File_read (fh, b->buff, b->vars_size, MPI_BYTE, &status);
+    adios_parse_vars_index_v1 (b, vars_root, NULL, NULL);
+
+    adios_init_buffer_read_attributes_index (b);
+    MPI_File_seek (fh, b->attrs_index_offset, MPI_SEEK_SET);
+    MPI_File_read (fh, b->buff, b->attrs_size, MPI_BYTE, &status);
+    adios_parse_attributes_index_v1 (b, attrs_root);
+    return 0;
+}
+
+int adios_read_chained_index_v1 (MPI_File fh
+                                ,struct adios_bp_buffer_struct_v1 * b
+                                ,struct adios_index_struct_v1 * index
+                                )
+{
+    struct adios_bp_buffer_struct_v1 lb;
+    MPI_Status status;
+    uint64_t file_size = b->file_size, end = b->file_size;
+    uint64_t * ends = 0;
+    char footer [28];
+    int nlinks = 0, l, err = 0;
+
+    // follow the chain back from the last footer
+    adios_buffer_struct_init (&lb);
+    while (end && !err)
+    {
+        uint64_t prev_end = 0;
+        uint32_t version;
+
+        if (end < 2 * 28)
+        {
+            err = 1;
+            break;
+        }
+        ends = (uint64_t *) realloc (ends, (nlinks + 1) * sizeof (uint64_t));
+        assert (ends);
+        ends [nlinks++] = end;
+
+        MPI_File_seek (fh, end - 28, MPI_SEEK_SET);
+        MPI_File_read (fh, footer, 28, MPI_BYTE, &status);
+        lb.buff = footer;
+        lb.length = 28;
+        lb.offset = 24;
+        adios_parse_version (&lb, &version);
+        if (version & ADIOS_VERSION_HAVE_CHAINED_INDEX)
+        {
+            MPI_File_seek (fh, end - 2 * 28 - 8, MPI_SEEK_SET);
+            MPI_File_read (fh, &prev_end, 8, MPI_BYTE, &status);
+            if (lb.change_endianness == adios_flag_yes)
+                swap_64 (prev_end);
+            err = (prev_end >= end);
+        }
+        end = prev_end;
+    }
+
+    // merge the indexes, oldest first, so that b ends up with the offsets of the last one
+    for (l = nlinks - 1; l >= 0 && !err; l--)
+    {
+        struct adios_index_process_group_struct_v1 * new_pg_root = 0;
+        struct adios_index_var_struct_v1 * new_vars_root = 0;
+        struct adios_index_attribute_struct_v1 * new_attrs_root = 0;
+
+        b->file_size = ends [l];
+        err = read_index_at_v1 (fh, b, &new_pg_root, &new_vars_root, &new_attrs_root);
+        adios_merge_index_v1 (index, new_pg_root, new_vars_root, new_attrs_root, 0);
+    }
+    b->file_size = file_size;
+    free (ends);
+
+    if (err)
+    {
+        adios_error (err_file_open_error,
+                     "Invalid BP file detected. The chained index is corrupt at offset %" PRIu64
+                     ". File size is (%" PRIu64 ")\n", end, file_size);
+        return 1;
+    }
+    log_debug ("Read a chained index of %d steps to rewrite it\n", nlinks);
+    return 0;
+}
+#endif
+
 #if 0
 // obsolete, merge the index with sorting
 // sort pg/var indexes by time index
@@ -3825,11 +4114,13 @@ void adios_build_index_v1 (struct adios_file_struct * fd,
     }
 }
 
-int adios_write_index_v1 (char ** buffer
+// prev_index_end: NULL, or the end of the previous footer for a chained index
+static int write_index_v1 (char ** buffer
         ,uint64_t * buffer_size
         ,uint64_t * buffer_offset
         ,uint64_t index_start
         ,struct adios_index_struct_v1 * index
+        ,const uint64_t * prev_index_end
         )
 {
     uint64_t groups_count = 0;
@@ -4567,6 +4858,11 @@ int adios_write_index_v1 (char ** buffer
     buffer_write (buffer, buffer_size, &buffer_offset_start, &attrs_count, 4);
     buffer_write (buffer, buffer_size, &buffer_offset_start, &index_size, 8);
 
+    // link to the previous step's footer
+    if (prev_index_end)
+    {
+        buffer_write (buffer, buffer_size, buffer_offset, prev_index_end, 8);
+    }
 
     /* Since ADIOS 1.4 Write new information before the last 24+4 bytes into the footer
        New information's format
@@ -4599,6 +4895,29 @@ int adios_write_index_v1 (char ** buffer
     return 0;
 }
 
+int adios_write_index_v1 (char ** buffer
+        ,uint64_t * buffer_size
+        ,uint64_t * buffer_offset
+        ,uint64_t index_start
+        ,struct adios_index_struct_v1 * index
+        )
+{
+    return write_index_v1 (buffer, buffer_size, buffer_offset, index_start
+                          ,index, NULL);
+}
+
+int adios_write_chained_index_v1 (char ** buffer
+        ,uint64_t * buffer_size
+        ,uint64_t * buffer_offset
+        ,uint64_t index_start
+        ,uint64_t prev_index_end
+        ,struct adios_index_struct_v1 * index
+        )
+{
+    return write_index_v1 (buffer, buffer_size, buffer_offset, index_start
+                          ,index, &prev_index_end);
+}
+
 int adios_write_version_v1 (char ** buffer
         ,uint64_t * buffer_size
         ,uint64_t * buffer_offset
@@ -5071,7 +5390,6 @@ int adios_generate_var_characteristics_v1 (struct adios_file_struct * fd, struct
 {
     uint64_t total_size = 0;
     uint64_t n = 0;
-    uint64_t total_n = 0;
     enum ADIOS_DATATYPES original_var_type = adios_transform_get_var_original_type_var(var);
 
     if (var->transform_type != adios_transform_none) {
@@ -5088,200 +5406,70 @@ int adios_generate_var_characteristics_v1 (struct adios_file_struct * fd, struct
     memset (map, -1, sizeof(map));
 
 
-#define HIST(a) \
-    { \
-        int low, high, mid; \
-        low=0; \
-        high=hist->num_breaks - 1; \
-        if (hist->breaks[low] > a) \
-        hist->frequencies[0] += 1; \
-        else if (a >= hist->breaks[high]) \
-        hist->frequencies[high + 1] += 1; \
-        else if (hist->breaks[low] <= a && a < hist->breaks[high]) \
-        { \
-            while(high-low>=2) \
-            { \
-                mid=(high+low)/2; \
-                if(a >= hist->breaks[mid]) \
-                { \
-                    low=mid; \
-                } \
-                else \
-                { \
-                    high=mid; \
-                } \
-            } \
-            hist->frequencies[low + 1] += 1; \
-        } \
-    }
-
-
-
-# define CHECK_FLOAT() (isnan (data [n]) || !isfinite (data [n]))
-# define CHECK_INT() (0)
-# define CHECK_FLOAT_NAN() (isnan (data [n]))
-# define CHECK_INT_NAN() (0)
-
-#define ADIOS_STATISTICS_FULL(a,b,NON_FINITE_CHECK) \
-{\
-    a * data = (a *) var->data; \
-    int i, j; \
-    struct adios_stat_struct * stats = var->stats[0]; \
-    a * min, * max; \
-    double * sum, * sum_square; \
-    uint32_t * cnt; \
-    struct adios_hist_struct * hist = 0; \
-    i = j = 0; \
-    while (var->bitmap >> j) { \
-        if ((var->bitmap >> j) & 1)    {\
-            map [j] = i; \
-            if (j == adios_statistic_hist) \
-            ;\
-            else \
-            stats[i].data = malloc(adios_get_stat_size(NULL, original_var_type, j)); \
-            i ++; \
-        } \
-        j ++; \
-    } \
-        min = (a *) stats[map[adios_statistic_min]].data; \
-        max = (a *) stats[map[adios_statistic_max]].data; \
-        sum = (double *) stats[map[adios_statistic_sum]].data; \
-        sum_square = (double *) stats[map[adios_statistic_sum_square]].data; \
-        cnt = (uint32_t *) stats[map[adios_statistic_cnt]].data; \
-        *cnt = 0;\
-        if (map[adios_statistic_hist] != -1) {\
-            hist = (struct adios_hist_struct *) stats[map[adios_statistic_hist]].data; \
-            hist->frequencies = calloc ((hist->num_breaks + 1), adios_get_type_size(adios_unsigned_integer, "")); \
-        } \
-        int have_finite_value = 0; \
-        n = 0; \
-        while ((n * b) < total_size) \
-        { \
-            if (NON_FINITE_CHECK()) {\
-                n ++; \
-                continue; \
-            }\
-            if (!have_finite_value) { \
-                *min = data [n]; \
-                *max = data [n]; \
-                *sum = data [n]; \
-                *sum_square = (data [n] * data [n]) ; \
-                *cnt = *cnt + 1; \
-                if (map[adios_statistic_hist] != -1) \
-                HIST(data [n]); \
-                have_finite_value = 1; \
-                n ++; \
-                continue; \
-            } \
-            if (data [n] < *min) \
-            *min = data [n]; \
-            if (data [n] > *max) \
-            *max = data [n]; \
-            *sum += data [n]; \
-            *sum_square += (data [n] * data [n]) ; \
-            *cnt = *cnt + 1; \
-            if (map[adios_statistic_hist] != -1) \
-            HIST(data [n]); \
-            n++; \
-        } \
-        if (map[adios_statistic_finite] != -1) \
-        * ((uint8_t * ) stats[map[adios_statistic_finite]].data) = have_finite_value; \
-        return 0; \
-    }
-
-#define ADIOS_STATISTICS_MINMAX(a,b,NAN_CHECK) \
-{\
-    a * data = (a *) var->data; \
-    struct adios_stat_struct * stats = var->stats[0]; \
-    map[adios_statistic_min] = 0; \
-    map[adios_statistic_max] = 1; \
-    map[adios_statistic_finite] = 2; \
-    stats[0].data = malloc(adios_get_stat_size(NULL, original_var_type, adios_statistic_min)); \
-    stats[1].data = malloc(adios_get_stat_size(NULL, original_var_type, adios_statistic_max)); \
-    stats[2].data = malloc(adios_get_stat_size(NULL, original_var_type, adios_statistic_finite)); \
-    a *min = (a *) stats[map[adios_statistic_min]].data; \
-    a *max = (a *) stats[map[adios_statistic_max]].data; \
-    int have_finite_value = 0; \
-    total_n = total_size / b; \
-    n = 0; \
-    while (n < total_n && NAN_CHECK()) \
-    { \
-        n++; \
-    } \
-    if (n < total_n) { \
-        *min = *data; \
-        *max = *data; \
-        have_finite_value = 1; \
-        data++; \
-        n++; \
-    }\
-    while (n < total_n) \
-    { \
-        if (*data < *min) \
-            *min = *data; \
-        if (*data > *max) \
-            *max = *data; \
-        n++; \
-        data++; \
-    } \
-    * ((uint8_t * ) stats[map[adios_statistic_finite]].data) = have_finite_value; \
-    return 0; \
-}
-
-#define ADIOS_STATISTICS(a,b,NON_FINITE_CHECK,NAN_CHECK) \
-    if (stat_flag == adios_stat_minmax) \
-        ADIOS_STATISTICS_MINMAX(a,b,NAN_CHECK) \
-    else \
-        ADIOS_STATISTICS_FULL(a,b,NON_FINITE_CHECK)
-
-
-#define MIN_MAX(a,b)\
-    {\
-        a * data = (a *) var->data; \
-        var->min = malloc (b); \
-        var->max = malloc (b); \
-        a * min = (a *) var->min; \
-        a * max = (a *) var->max; \
-        *min = data [0]; \
-        *max = data [0]; \
-        return 0; \
-    }
-
-
     switch (original_var_type)
     {
         case adios_byte:
-            ADIOS_STATISTICS(int8_t,1,CHECK_INT,CHECK_INT_NAN)
-
         case adios_unsigned_byte:
-            ADIOS_STATISTICS(uint8_t,1,CHECK_INT,CHECK_INT_NAN)
-
         case adios_short:
-            ADIOS_STATISTICS(int16_t,2,CHECK_INT,CHECK_INT_NAN)
-
         case adios_unsigned_short:
-            ADIOS_STATISTICS(uint16_t,2,CHECK_INT,CHECK_INT_NAN)
-
         case adios_integer:
-            ADIOS_STATISTICS(int32_t,4,CHECK_INT,CHECK_INT_NAN)
-
         case adios_unsigned_integer:
-            ADIOS_STATISTICS(uint32_t,4,CHECK_INT,CHECK_INT_NAN)
-
         case adios_long:
-            ADIOS_STATISTICS(int64_t,8,CHECK_INT,CHECK_INT_NAN)
-
         case adios_unsigned_long:
-            ADIOS_STATISTICS(uint64_t,8,CHECK_INT,CHECK_INT_NAN)
-
         case adios_real:
-            ADIOS_STATISTICS(float,4,CHECK_FLOAT,CHECK_FLOAT_NAN)
-
         case adios_double:
-            ADIOS_STATISTICS(double,8,CHECK_FLOAT,CHECK_FLOAT_NAN)
-
         case adios_long_double:
-            ADIOS_STATISTICS(long double,16,CHECK_FLOAT,CHECK_FLOAT_NAN)
+        {
+            struct adios_stat_struct * stats = var->stats[0];
+            uint64_t nelems = total_size / adios_get_type_size (original_var_type, "");
+            int have_finite_value;
+
+            if (stat_flag == adios_stat_minmax)
+            {
+                map[adios_statistic_min] = 0;
+                map[adios_statistic_max] = 1;
+                map[adios_statistic_finite] = 2;
+                stats[0].data = malloc(adios_get_stat_size(NULL, original_var_type, adios_statistic_min));
+                stats[1].data = malloc(adios_get_stat_size(NULL, original_var_type, adios_statistic_max));
+                stats[2].data = malloc(adios_get_stat_size(NULL, original_var_type, adios_statistic_finite));
+                have_finite_value = adios_stats_compute (original_var_type, var->data, nelems, 0,
+                                                         stats[0].data, stats[1].data,
+                                                         NULL, NULL, NULL);
+                * ((uint8_t * ) stats[map[adios_statistic_finite]].data) = have_finite_value;
+            }
+            else
+            {
+                struct adios_hist_struct * hist = 0;
+                int i, j;
+                i = j = 0;
+                while (var->bitmap >> j) {
+                    if ((var->bitmap >> j) & 1)    {
+                        map [j] = i;
+                        if (j != adios_statistic_hist)
+                            stats[i].data = malloc(adios_get_stat_size(NULL, original_var_type, j));
+                        i ++;
+                    }
+                    j ++;
+                }
+                if (map[adios_statistic_hist] != -1) {
+                    hist = (struct adios_hist_struct *) stats[map[adios_statistic_hist]].data;
+                    hist->frequencies = calloc ((hist->num_breaks + 1), adios_get_type_size(adios_unsigned_integer, ""));
+                }
+#define STAT_DATA(s) (map[s] != -1 ? stats[map[s]].data : NULL)
+                have_finite_value = adios_stats_compute (original_var_type, var->data, nelems, 1,
+                                                         stats[map[adios_statistic_min]].data,
+                                                         stats[map[adios_statistic_max]].data,
+                                                         STAT_DATA(adios_statistic_sum),
+                                                         STAT_DATA(adios_statistic_sum_square),
+                                                         STAT_DATA(adios_statistic_cnt));
+#undef STAT_DATA
+                if (hist)
+                    adios_stats_histogram (original_var_type, var->data, nelems, hist);
+                if (map[adios_statistic_finite] != -1)
+                    * ((uint8_t * ) stats[map[adios_statistic_finite]].data) = have_finite_value;
+            }
+            return 0;
+        }
 
         case adios_complex:
         {
@@ -5578,7 +5766,7 @@ uint64_t adios_write_var_header_v1 (struct adios_file_struct * fd
     uint16_t len;
 
     uint64_t start = fd->offset;  // save to write the size
-    v->write_offset = fd->offset; // save offset relative to beginning of buffer
+    v->write_offset = fd->offset + fd->payload_refs_size; // save offset relative to beginning of PG
                                   // PG start offset in file will be added later in adios_build_index_v1()
     fd->offset += 8;              // save space for the size
     total_size += 8;              // makes final parsing easier
@@ -5642,6 +5830,76 @@ int adios_write_var_payload_v1 (struct adios_file_struct * fd
     return 0;
 }
 
+int adios_write_var_payload_ref_v1 (struct adios_file_struct * fd
+        ,struct adios_var_struct * var
+        )
+{
+    struct adios_payload_ref_struct * ref;
+    uint64_t size;
+
+    if (fd->payload_refs_count == fd->payload_refs_allocated)
+    {
+        int n = (fd->payload_refs_allocated ? 2 * fd->payload_refs_allocated : 16);
+        ref = (struct adios_payload_ref_struct *) realloc (fd->payload_refs,
+                n * sizeof (struct adios_payload_ref_struct));
+        if (!ref)
+        {
+            // copy it then
+            return adios_write_var_payload_v1 (fd, var);
+        }
+        fd->payload_refs = ref;
+        fd->payload_refs_allocated = n;
+    }
+
+    size = adios_get_var_size (var, var->data);
+    ref = &fd->payload_refs [fd->payload_refs_count++];
+    ref->offset = fd->offset;
+    ref->data = var->data;
+    ref->size = size;
+    fd->payload_refs_size += size;
+
+    return 0;
+}
+
+void adios_clear_payload_refs_v1 (struct adios_file_struct * fd)
+{
+    fd->payload_refs_count = 0;
+    fd->payload_refs_size = 0;
+}
+
+int adios_get_pg_pieces_v1 (struct adios_file_struct * fd
+        ,struct adios_payload_ref_struct * pieces
+        )
+{
+    uint64_t start = 0;     // of the next part of the buffer
+    uint64_t pg_offset = 0; // of the next piece in the PG
+    int i, n = 0;
+
+    for (i = 0; i <= fd->payload_refs_count; i++)
+    {
+        uint64_t end = (i < fd->payload_refs_count ? fd->payload_refs [i].offset
+                                                   : fd->bytes_written);
+        if (end > start)
+        {
+            pieces [n].offset = pg_offset;
+            pieces [n].data = fd->buffer + start;
+            pieces [n].size = end - start;
+            pg_offset += pieces [n].size;
+            n++;
+            start = end;
+        }
+        if (i < fd->payload_refs_count && fd->payload_refs [i].size)
+        {
+            pieces [n] = fd->payload_refs [i];
+            pieces [n].offset = pg_offset;
+            pg_offset += pieces [n].size;
+            n++;
+        }
+    }
+
+    return n;
+}
+
 int adios_write_attribute_v1 (struct adios_file_struct * fd
         ,struct adios_attribute_struct * a
         )
@@ -5653,7 +5911,7 @@ int adios_write_attribute_v1 (struct adios_file_struct * fd
 
     // save space for attr length
     start = fd->offset;
-    a->write_offset = fd->offset; // save offset relative to beginning of buffer
+    a->write_offset = fd->offset + fd->payload_refs_size; // save offset relative to beginning of PG
                                   // PG start offset in file will be added later in adios_build_index_v1()
     fd->offset += 4;
 
@@ -5752,7 +6010,7 @@ int adios_write_open_vars_v1 (struct adios_file_struct * fd)
 int adios_write_close_vars_v1 (struct adios_file_struct * fd)
 {
     // close the var area (count and total size) and write the attributes
-    uint64_t size = fd->offset - fd->vars_start;
+    uint64_t size = fd->offset + fd->payload_refs_size - fd->vars_start;
     uint64_t offset = fd->vars_start;
     buffer_write (&fd->buffer, &fd->buffer_size, &offset, &fd->nvars_written, 4);
 
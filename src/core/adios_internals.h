@@ -85,6 +85,8 @@ struct adios_var_struct
     uint16_t transform_metadata_len;
     void *transform_metadata;
 
+    uint32_t bitmap_index_bins; // >0: build a bitmap index of each block written (adios_bitmap_index.h)
+
     struct adios_var_struct * next;
 };
 
@@ -192,6 +194,20 @@ struct adios_pg_struct
     struct adios_pg_struct  * next;
 };
 
+/* A payload that is not copied into the buffer but written from the user's
+   array (zero-copy write). It belongs at 'offset' in the buffer, so the PG in
+   the file is the buffer with the payloads inserted at their offsets.
+*/
+struct adios_payload_ref_struct
+{
+    uint64_t offset;
+    const void * data;
+    uint64_t size;
+};
+
+// default minimum array size for zero-copy writes (method parameter zero_copy)
+#define ADIOS_ZERO_COPY_THRESHOLD (1024*1024)
+
 struct adios_file_struct
 {
     char * name;
@@ -207,6 +223,7 @@ struct adios_file_struct
     struct adios_pg_struct * current_pg; // points to last PG in the list, which is being created in buffer
 
     char * allocated_bufptr;  // actual allocated buffer before alignment
+    int buffer_mapped;      // allocated_bufptr is mmap'ed (huge pages), see buffer.c
     char * buffer;          // buffer we use for building the output (aligned, made from allocated_bufptr)
     uint64_t offset;        // current offset to write at
     uint64_t bytes_written; // largest offset into buffer written to, = offset after calling _v1() functions
@@ -218,7 +235,16 @@ struct adios_file_struct
     uint64_t attrs_start;    // offset for where to put the attr count
     uint32_t nattrs_written;  // count of attrs to write
 
+    uint64_t zero_copy_threshold; // arrays of at least this size are not copied into the buffer, 0: copy all
+    struct adios_payload_ref_struct * payload_refs; // payloads of the current PG not copied into the buffer
+    int payload_refs_count;
+    int payload_refs_allocated;
+    uint64_t payload_refs_size; // total size of payload_refs, the position in the PG is offset + this
+
     MPI_Comm comm;          // duplicate of comm received in adios_open()
+
+    char * bitmap_index_records;       // bitmap index records of the blocks written in this step
+    uint64_t bitmap_index_records_size;
 };
 void adios_file_struct_init (struct adios_file_struct * fd);
 
@@ -506,6 +532,9 @@ int64_t adios_common_define_var (int64_t group_id, const char * name
 // set a transform method for a variable (=none if this function is never called)
 int adios_common_set_transform (int64_t var_id, const char *transform_type_str);
 
+// build a write-time index of a variable: "bitmap[:bins=N]" or "none"
+int adios_common_set_index (int64_t var_id, const char *index_spec);
+
 int adios_common_define_var_characteristics  (struct adios_group_struct * g
                                               ,const char * var_name
                                               ,const char * bin_interval
@@ -556,6 +585,16 @@ uint16_t adios_write_var_characteristics_v1 (struct adios_file_struct * fd
 int adios_write_var_payload_v1 (struct adios_file_struct * fd
                                ,struct adios_var_struct * var
                                );
+// zero-copy write: record the payload to be written from var->data at close
+int adios_write_var_payload_ref_v1 (struct adios_file_struct * fd
+                                   ,struct adios_var_struct * var
+                                   );
+void adios_clear_payload_refs_v1 (struct adios_file_struct * fd);
+// the buffered PG as the pieces to write in order: parts of the buffer and
+// the payload refs. pieces needs 2 * fd->payload_refs_count + 1 elements.
+int adios_get_pg_pieces_v1 (struct adios_file_struct * fd
+                           ,struct adios_payload_ref_struct * pieces
+                           );
 int adios_write_attribute_v1 (struct adios_file_struct * fd
                              ,struct adios_attribute_struct * a
                              );
@@ -574,6 +613,17 @@ int adios_write_index_v1 (char ** buffer
                          ,struct adios_index_struct_v1 * index
                          );
 
+// Same as adios_write_index_v1 for one step of a chained index
+// (ADIOS_VERSION_HAVE_CHAINED_INDEX): the end offset of the previous
+// footer (0 if none) is written in front of the footer
+int adios_write_chained_index_v1 (char ** buffer
+                                 ,uint64_t * buffer_size
+                                 ,uint64_t * buffer_offset
+                                 ,uint64_t index_start
+                                 ,uint64_t prev_index_end
+                                 ,struct adios_index_struct_v1 * index
+                                 );
+
 void adios_build_index_v1 (struct adios_file_struct * fd
                          ,struct adios_index_struct_v1 * index
                        );
@@ -586,6 +636,31 @@ void adios_merge_index_v1 (
                   ,int needs_sorting // merge-sort the characteristics to keep the time in order
                   );
 
+// Sort the characteristics of every variable by time index, keeping the order
+// of the merged indexes for the same time index. Each variable is sorted in
+// one pass (k-way merge of the time ordered runs of the merged indexes).
+void adios_sort_index_characteristics_v1 (struct adios_index_struct_v1 * index);
+
+#ifndef _NOMPI
+#define ADIOS_INDEX_REDUCE_FANIN 2
+// Merge the indexes of all processes of comm (built with adios_build_index_v1)
+// into the index of rank 0, along a tree of processes with 'fanin' children
+// per node. Collective, only rank 0 has the global index on return.
+void adios_reduce_index_v1 (MPI_Comm comm, int fanin
+                           ,struct adios_index_struct_v1 * index
+                           );
+
+// Read the index of every step of a file with a chained index
+// (ADIOS_VERSION_HAVE_CHAINED_INDEX), following the chain back from the
+// footer at b->file_size, and merge them into 'index' for the methods which
+// rewrite the whole index when appending. The offsets in b are those of
+// the last step's footer on return, like with adios_parse_index_offsets_v1.
+int adios_read_chained_index_v1 (MPI_File fh
+                                ,struct adios_bp_buffer_struct_v1 * b
+                                ,struct adios_index_struct_v1 * index
+                                );
+#endif
+
 /* obsolete, merge the index with sorting
 void adios_sort_index_v1 (struct adios_index_process_group_struct_v1 ** p1
                          ,struct adios_index_var_struct_v1 ** v1
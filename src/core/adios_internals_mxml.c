@@ -1182,6 +1182,7 @@ static int parseGroup (mxml_node_t * node, char * schema_version)
             const char * gwrite = 0;
             const char * read_flag = 0;
             const char * transform_type = 0; // NCSU ALACRITY-ADIOS
+            const char * index_spec = 0;
             enum ADIOS_DATATYPES t1;
 
             for (i = 0; i < n->value.element.num_attrs; i++)
@@ -1203,6 +1204,7 @@ static int parseGroup (mxml_node_t * node, char * schema_version)
                     GET_ATTR("gread",attr,gread,"var")
                     GET_ATTR("read",attr,read_flag,"var")
                 GET_ATTR("transform",attr,transform_type,"var") // NCSU ALACRITY-ADIOS
+                    GET_ATTR("index",attr,index_spec,"var")
                     log_warn ("config.xml: unknown attribute '%s' on %s "
                             "(ignored)\n"
                             ,attr->name
@@ -1256,6 +1258,10 @@ static int parseGroup (mxml_node_t * node, char * schema_version)
                 if (transform_type && strcmp(transform_type,"")) {
                     adios_common_set_transform (var, transform_type);
                 }
+                // and the write-time index if given
+                if (index_spec && strcmp(index_spec,"")) {
+                    adios_common_set_index (var, index_spec);
+                }
                 // an attribute for the mesh if it exists.
                 if (strcmp(mesh,"")){
                     adios_common_define_var_mesh (ptr_new_group, name, mesh, path);
@@ -1375,6 +1381,7 @@ static int parseGroup (mxml_node_t * node, char * schema_version)
                         const char * gread = 0;
                         const char * read_flag = 0;
                         const char * transform_type = 0; // NCSU ALACRITY-ADIOS
+                        const char * index_spec = 0;
                         enum ADIOS_DATATYPES t1;
 
 
@@ -1397,6 +1404,7 @@ static int parseGroup (mxml_node_t * node, char * schema_version)
                                 GET_ATTR("gread",attr,gread,"var")
                                 GET_ATTR("read",attr,read_flag,"var")
                         GET_ATTR("transform",attr,transform_type,"var") // NCSU ALACRITY-ADIOS
+                                GET_ATTR("index",attr,index_spec,"var")
                                 log_warn ("config.xml: unknown attribute '%s' "
                                         "on %s (ignored)\n"
                                         ,attr->name
@@ -1444,6 +1452,10 @@ static int parseGroup (mxml_node_t * node, char * schema_version)
                             if (transform_type && strcmp(transform_type,"")) {
                                 adios_common_set_transform (var, transform_type);
                             }
+                            // and the write-time index if given
+                            if (index_spec && strcmp(index_spec,"")) {
+                                adios_common_set_index (var, index_spec);
+                            }
                             // an attribute for the mesh if it exists.
                             if (strcmp(mesh,"")){
                                 adios_common_define_var_mesh (ptr_new_group, name, mesh, path);
@@ -1991,10 +2003,33 @@ static int parseMethod (mxml_node_t * node)
 }
 
 
+/* prefault-MB attribute of the buffer element, after the max size is set */
+static int parseBufferPrefault (const char * prefault_MB)
+{
+    char * end;
+    long int size;
+
+    if (!prefault_MB)
+        return 1;
+
+    errno = 0;
+    size = strtol (prefault_MB, &end, 10);
+    if (errno || (end != 0 && *end != '\0') || size < 0) {
+        adios_error (err_invalid_buffer_size, "config.xml: buffer prefault-MB cannot be parsed: %s\n", prefault_MB);
+        return 0;
+    }
+    if (size > 0) {
+        adios_databuffer_prefault ((uint64_t) size * 1024L * 1024L);
+    }
+    return 1;
+}
+
 static int parseBuffer (mxml_node_t * node)
 {
     const char * size_MB = 0;
     const char * max_size_MB = 0;
+    const char * hugepages = 0;
+    const char * prefault_MB = 0;
 
     int i;
 
@@ -2004,12 +2039,21 @@ static int parseBuffer (mxml_node_t * node)
         mxml_attr_t * attr = &node->value.element.attrs [i];
         GET_ATTR("size-MB",attr,size_MB,"method")
         GET_ATTR("max-size-MB",attr,max_size_MB,"method")
+        GET_ATTR("hugepages",attr,hugepages,"method")
+        GET_ATTR("prefault-MB",attr,prefault_MB,"method")
         log_warn ("config.xml: unknown attribute '%s' on %s (ignored)\n", attr->name, "buffer");
     }
 
+    if (hugepages)
+    {
+        adios_databuffer_set_hugepages (!strcasecmp (hugepages, "yes") || !strcmp (hugepages, "1"));
+    }
 
     if (!size_MB && !max_size_MB)
     {
+        if (hugepages || prefault_MB)
+            return parseBufferPrefault (prefault_MB);
+
         adios_error (err_invalid_buffer_size, "config.xml: must define either "
                 "size-MB or max-size-MB "
                 "buffer element\n"
@@ -2047,7 +2091,7 @@ static int parseBuffer (mxml_node_t * node)
         }
     }
 
-    return 1;
+    return parseBufferPrefault (prefault_MB);
 }
 
 
@@ -74,6 +74,11 @@ ADIOS_VARINFO * adios_inq_var_byid (ADIOS_FILE  *fp, int varid)
     return common_read_inq_var_byid (fp, varid);
 }
 
+int adios_inq_var_prefix (ADIOS_FILE  *fp, const char * prefix, int ** varids)
+{
+    return common_read_inq_var_prefix (fp, prefix, varids);
+}
+
 void adios_free_varinfo (ADIOS_VARINFO *vp)
 {
     common_read_free_varinfo (vp);
@@ -187,6 +192,11 @@ int adios_get_attr_byid (ADIOS_FILE  * fp, int attrid,
     return common_read_get_attr_byid (fp, attrid, type, size, data);
 }
 
+int adios_inq_attr_prefix (ADIOS_FILE  *fp, const char * prefix, int ** attrids)
+{
+    return common_read_inq_attr_prefix (fp, prefix, attrids);
+}
+
 const char * adios_type_to_string (enum ADIOS_DATATYPES type)
 {
     return common_read_type_to_string (type);
@@ -17,6 +17,7 @@
 #include "core/transforms/adios_transforms_read.h"
 #include "core/adios_selection_util.h"
 #include "core/adios_infocache.h"
+#include "core/transforms/adios_transforms_blockcache.h"
 
 // Ensure unique pointer-based values for each one
 const data_view_t LOGICAL_DATA_VIEW = &LOGICAL_DATA_VIEW;
@@ -263,6 +264,16 @@ int adios_read_get_dimension_order (ADIOS_FILE * fp)
     return common_read_get_dimension_order (fp);
 }
 
+// Size of the process-wide cache of decoded blocks, 0 turns it off
+void adios_read_set_block_cache(uint64_t max_bytes) {
+	adios_block_cache_set_size(max_bytes);
+}
 
+// Hit/miss counters of the block cache
+void adios_read_get_block_cache_stats(ADIOS_BLOCK_CACHE_STATS *stats) {
+	adios_block_cache_get_stats(stats);
+}
 
-
+void adios_read_reset_block_cache_stats() {
+	adios_block_cache_reset_stats();
+}
@@ -0,0 +1,690 @@
+/*
+ * ADIOS is freely available under the terms of the BSD license described
+ * in the COPYING file in the top level directory of this source distribution.
+ *
+ * Copyright (c) 2008 - 2009.  UT-BATTELLE, LLC. All rights reserved.
+ */
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+#if defined(__AVX__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#include "core/adios_stats.h"
+
+#define STATS_CHUNK 4096                // elements processed at once by the vector kernels
+#define STATS_PARALLEL_MIN (1 << 20)    // use multiple threads for arrays of this many elements
+
+/* Partial result over a range of elements */
+struct stats_part
+{
+    int have_value;
+    uint64_t cnt;
+    double sum;
+    double sum_square;
+    union {
+        int8_t i8;
+        uint8_t u8;
+        int16_t i16;
+        uint16_t u16;
+        int32_t i32;
+        uint32_t u32;
+        int64_t i64;
+        uint64_t u64;
+        float f;
+        double d;
+        long double ld;
+    } min, max;
+};
+
+typedef void (*stats_range_fn) (const void * data, uint64_t n, int full, struct stats_part * p);
+typedef void (*stats_merge_fn) (struct stats_part * p, const struct stats_part * c);
+
+#define SKIP_FLOAT(v,full) ((full) ? !isfinite (v) : isnan (v))
+#define SKIP_INT(v,full) (0)
+
+/* Merge the partial result c into p */
+#define STATS_MERGE(F) \
+static void stats_merge_##F (struct stats_part * p, const struct stats_part * c) \
+{ \
+    if (!c->have_value) \
+        return; \
+    if (!p->have_value) \
+    { \
+        p->min.F = c->min.F; \
+        p->max.F = c->max.F; \
+        p->have_value = 1; \
+    } \
+    else \
+    { \
+        if (c->min.F < p->min.F) \
+            p->min.F = c->min.F; \
+        if (c->max.F > p->max.F) \
+            p->max.F = c->max.F; \
+    } \
+    p->cnt += c->cnt; \
+    p->sum += c->sum; \
+    p->sum_square += c->sum_square; \
+}
+
+/* Element by element loop with checking of each value */
+#define STATS_SCALAR(T,F,SKIP) \
+static void stats_scalar_##F (const void * vdata, uint64_t n, int full, struct stats_part * p) \
+{ \
+    const T * data = (const T *) vdata; \
+    uint64_t i; \
+    for (i = 0; i < n; i++) \
+    { \
+        T v = data [i]; \
+        if (SKIP (v, full)) \
+            continue; \
+        if (!p->have_value) \
+        { \
+            p->min.F = v; \
+            p->max.F = v; \
+            p->have_value = 1; \
+        } \
+        else \
+        { \
+            if (v < p->min.F) \
+                p->min.F = v; \
+            if (v > p->max.F) \
+                p->max.F = v; \
+        } \
+        if (full) \
+        { \
+            p->sum += v; \
+            p->sum_square += (double) v * v; \
+            p->cnt++; \
+        } \
+    } \
+}
+
+/* Integers have no values to skip: branch-free loops with two accumulators */
+#define STATS_INT(T,F) \
+STATS_MERGE(F) \
+static void stats_range_##F (const void * vdata, uint64_t n, int full, struct stats_part * p) \
+{ \
+    const T * data = (const T *) vdata; \
+    struct stats_part c; \
+    T mn0, mn1, mx0, mx1; \
+    double s0 = 0, s1 = 0, q0 = 0, q1 = 0; \
+    uint64_t i; \
+    if (!n) \
+        return; \
+    mn0 = mn1 = mx0 = mx1 = data [0]; \
+    if (full) \
+    { \
+        for (i = 0; i + 1 < n; i += 2) \
+        { \
+            T a = data [i], b = data [i+1]; \
+            double da = a, db = b; \
+            mn0 = (a < mn0 ? a : mn0); \
+            mn1 = (b < mn1 ? b : mn1); \
+            mx0 = (a > mx0 ? a : mx0); \
+            mx1 = (b > mx1 ? b : mx1); \
+            s0 += da; \
+            s1 += db; \
+            q0 += da * da; \
+            q1 += db * db; \
+        } \
+    } \
+    else \
+    { \
+        for (i = 0; i + 1 < n; i += 2) \
+        { \
+            T a = data [i], b = data [i+1]; \
+            mn0 = (a < mn0 ? a : mn0); \
+            mn1 = (b < mn1 ? b : mn1); \
+            mx0 = (a > mx0 ? a : mx0); \
+            mx1 = (b > mx1 ? b : mx1); \
+        } \
+    } \
+    if (i < n) \
+    { \
+        double a = data [i]; \
+        mn0 = (data [i] < mn0 ? data [i] : mn0); \
+        mx0 = (data [i] > mx0 ? data [i] : mx0); \
+        s0 += a; \
+        q0 += a * a; \
+    } \
+    c.have_value = 1; \
+    c.cnt = (full ? n : 0); \
+    c.sum = s0 + s1; \
+    c.sum_square = q0 + q1; \
+    c.min.F = (mn0 < mn1 ? mn0 : mn1); \
+    c.max.F = (mx0 > mx1 ? mx0 : mx1); \
+    stats_merge_##F (p, &c); \
+}
+
+/* Floating point types: run the vector kernel on each chunk and
+   redo the chunk with the scalar loop if it has values to skip */
+#define STATS_FLOAT(T,F) \
+STATS_MERGE(F) \
+STATS_SCALAR(T,F,SKIP_FLOAT) \
+static void stats_range_##F (const void * vdata, uint64_t n, int full, struct stats_part * p) \
+{ \
+    const T * data = (const T *) vdata; \
+    struct stats_part c; \
+    uint64_t i, len; \
+    for (i = 0; i < n; i += STATS_CHUNK) \
+    { \
+        len = (n - i < STATS_CHUNK ? n - i : STATS_CHUNK); \
+        memset (&c, 0, sizeof (c)); \
+        if (!stats_vector_##F (data + i, len, full, &c)) \
+        { \
+            memset (&c, 0, sizeof (c)); \
+            stats_scalar_##F (data + i, len, full, &c); \
+        } \
+        stats_merge_##F (p, &c); \
+    } \
+}
+
+/* Vector kernels for float and double. They return 0 if the chunk contains
+   a value to skip (NaN, or any non-finite value in full mode). */
+#if defined(__AVX__)
+
+static int stats_vector_d (const double * data, uint64_t n, int full, struct stats_part * c)
+{
+    __m256d vmin = _mm256_set1_pd (data [0]), vmax = vmin;
+    __m256d vsum = _mm256_setzero_pd (), vsq = vsum, vbad = vsum, zero = vsum;
+    double lmin [4], lmax [4], lsum [4], lsq [4];
+    uint64_t i;
+    int k;
+
+    if (full)
+    {
+        for (i = 0; i + 4 <= n; i += 4)
+        {
+            __m256d x = _mm256_loadu_pd (data + i);
+            // x-x is 0 for finite values, NaN for NaN and infinity
+            vbad = _mm256_or_pd (vbad, _mm256_cmp_pd (_mm256_sub_pd (x, x), zero, _CMP_NEQ_UQ));
+            vmin = _mm256_min_pd (vmin, x);
+            vmax = _mm256_max_pd (vmax, x);
+            vsum = _mm256_add_pd (vsum, x);
+            vsq = _mm256_add_pd (vsq, _mm256_mul_pd (x, x));
+        }
+    }
+    else
+    {
+        for (i = 0; i + 4 <= n; i += 4)
+        {
+            __m256d x = _mm256_loadu_pd (data + i);
+            vbad = _mm256_or_pd (vbad, _mm256_cmp_pd (x, x, _CMP_UNORD_Q));
+            vmin = _mm256_min_pd (vmin, x);
+            vmax = _mm256_max_pd (vmax, x);
+        }
+    }
+    if (_mm256_movemask_pd (vbad))
+        return 0;
+
+    _mm256_storeu_pd (lmin, vmin);
+    _mm256_storeu_pd (lmax, vmax);
+    _mm256_storeu_pd (lsum, vsum);
+    _mm256_storeu_pd (lsq, vsq);
+    c->min.d = lmin [0];
+    c->max.d = lmax [0];
+    c->sum = c->sum_square = 0;
+    for (k = 0; k < 4; k++)
+    {
+        if (lmin [k] < c->min.d) c->min.d = lmin [k];
+        if (lmax [k] > c->max.d) c->max.d = lmax [k];
+        c->sum += lsum [k];
+        c->sum_square += lsq [k];
+    }
+    for (; i < n; i++)
+    {
+        double v = data [i];
+        if (SKIP_FLOAT (v, full))
+            return 0;
+        if (v < c->min.d) c->min.d = v;
+        if (v > c->max.d) c->max.d = v;
+        c->sum += v;
+        c->sum_square += v * v;
+    }
+    c->have_value = 1;
+    c->cnt = (full ? n : 0);
+    if (!full)
+        c->sum = c->sum_square = 0;
+    return 1;
+}
+
+static int stats_vector_f (const float * data, uint64_t n, int full, struct stats_part * c)
+{
+    __m256 vmin = _mm256_set1_ps (data [0]), vmax = vmin;
+    __m256 vbad = _mm256_setzero_ps (), zero = vbad;
+    __m256d vsum = _mm256_setzero_pd (), vsq = vsum;
+    float lmin [8], lmax [8];
+    double lsum [4], lsq [4];
+    uint64_t i;
+    int k;
+
+    if (full)
+    {
+        for (i = 0; i + 8 <= n; i += 8)
+        {
+            __m256 x = _mm256_loadu_ps (data + i);
+            __m256d lo = _mm256_cvtps_pd (_mm256_castps256_ps128 (x));
+            __m256d hi = _mm256_cvtps_pd (_mm256_extractf128_ps (x, 1));
+            vbad = _mm256_or_ps (vbad, _mm256_cmp_ps (_mm256_sub_ps (x, x), zero, _CMP_NEQ_UQ));
+            vmin = _mm256_min_ps (vmin, x);
+            vmax = _mm256_max_ps (vmax, x);
+            vsum = _mm256_add_pd (vsum, _mm256_add_pd (lo, hi));
+            vsq = _mm256_add_pd (vsq, _mm256_add_pd (_mm256_mul_pd (lo, lo), _mm256_mul_pd (hi, hi)));
+        }
+    }
+    else
+    {
+        for (i = 0; i + 8 <= n; i += 8)
+        {
+            __m256 x = _mm256_loadu_ps (data + i);
+            vbad = _mm256_or_ps (vbad, _mm256_cmp_ps (x, x, _CMP_UNORD_Q));
+            vmin = _mm256_min_ps (vmin, x);
+            vmax = _mm256_max_ps (vmax, x);
+        }
+    }
+    if (_mm256_movemask_ps (vbad))
+        return 0;
+
+    _mm256_storeu_ps (lmin, vmin);
+    _mm256_storeu_ps (lmax, vmax);
+    _mm256_storeu_pd (lsum, vsum);
+    _mm256_storeu_pd (lsq, vsq);
+    c->min.f = lmin [0];
+    c->max.f = lmax [0];
+    c->sum = c->sum_square = 0;
+    for (k = 0; k < 8; k++)
+    {
+        if (lmin [k] < c->min.f) c->min.f = lmin [k];
+        if (lmax [k] > c->max.f) c->max.f = lmax [k];
+    }
+    for (k = 0; k < 4; k++)
+    {
+        c->sum += lsum [k];
+        c->sum_square += lsq [k];
+    }
+    for (; i < n; i++)
+    {
+        float v = data [i];
+        if (SKIP_FLOAT (v, full))
+            return 0;
+        if (v < c->min.f) c->min.f = v;
+        if (v > c->max.f) c->max.f = v;
+        c->sum += v;
+        c->sum_square += (double) v * v;
+    }
+    c->have_value = 1;
+    c->cnt = (full ? n : 0);
+    if (!full)
+        c->sum = c->sum_square = 0;
+    return 1;
+}
+
+#elif defined(__SSE2__)
+
+static int stats_vector_d (const double * data, uint64_t n, int full, struct stats_part * c)
+{
+    __m128d vmin = _mm_set1_pd (data [0]), vmax = vmin;
+    __m128d vsum = _mm_setzero_pd (), vsq = vsum, vbad = vsum, zero = vsum;
+    double lmin [2], lmax [2], lsum [2], lsq [2];
+    uint64_t i;
+
+    if (full)
+    {
+        for (i = 0; i + 2 <= n; i += 2)
+        {
+            __m128d x = _mm_loadu_pd (data + i);
+            // x-x is 0 for finite values, NaN for NaN and infinity
+            vbad = _mm_or_pd (vbad, _mm_cmpneq_pd (_mm_sub_pd (x, x), zero));
+            vmin = _mm_min_pd (vmin, x);
+            vmax = _mm_max_pd (vmax, x);
+            vsum = _mm_add_pd (vsum, x);
+            vsq = _mm_add_pd (vsq, _mm_mul_pd (x, x));
+        }
+    }
+    else
+    {
+        for (i = 0; i + 2 <= n; i += 2)
+        {
+            __m128d x = _mm_loadu_pd (data + i);
+            vbad = _mm_or_pd (vbad, _mm_cmpunord_pd (x, x));
+            vmin = _mm_min_pd (vmin, x);
+            vmax = _mm_max_pd (vmax, x);
+        }
+    }
+    if (_mm_movemask_pd (vbad))
+        return 0;
+
+    _mm_storeu_pd (lmin, vmin);
+    _mm_storeu_pd (lmax, vmax);
+    _mm_storeu_pd (lsum, vsum);
+    _mm_storeu_pd (lsq, vsq);
+    c->min.d = (lmin [1] < lmin [0] ? lmin [1] : lmin [0]);
+    c->max.d = (lmax [1] > lmax [0] ? lmax [1] : lmax [0]);
+    c->sum = lsum [0] + lsum [1];
+    c->sum_square = lsq [0] + lsq [1];
+    for (; i < n; i++)
+    {
+        double v = data [i];
+        if (SKIP_FLOAT (v, full))
+            return 0;
+        if (v < c->min.d) c->min.d = v;
+        if (v > c->max.d) c->max.d = v;
+        c->sum += v;
+        c->sum_square += v * v;
+    }
+    c->have_value = 1;
+    c->cnt = (full ? n : 0);
+    if (!full)
+        c->sum = c->sum_square = 0;
+    return 1;
+}
+
+static int stats_vector_f (const float * data, uint64_t n, int full, struct stats_part * c)
+{
+    __m128 vmin = _mm_set1_ps (data [0]), vmax = vmin;
+    __m128 vbad = _mm_setzero_ps (), zero = vbad;
+    __m128d vsum = _mm_setzero_pd (), vsq = vsum;
+    float lmin [4], lmax [4];
+    double lsum [2], lsq [2];
+    uint64_t i;
+    int k;
+
+    if (full)
+    {
+        for (i = 0; i + 4 <= n; i += 4)
+        {
+            __m128 x = _mm_loadu_ps (data + i);
+            __m128d lo = _mm_cvtps_pd (x);
+            __m128d hi = _mm_cvtps_pd (_mm_movehl_ps (x, x));
+            vbad = _mm_or_ps (vbad, _mm_cmpneq_ps (_mm_sub_ps (x, x), zero));
+            vmin = _mm_min_ps (vmin, x);
+            vmax = _mm_max_ps (vmax, x);
+            vsum = _mm_add_pd (vsum, _mm_add_pd (lo, hi));
+            vsq = _mm_add_pd (vsq, _mm_add_pd (_mm_mul_pd (lo, lo), _mm_mul_pd (hi, hi)));
+        }
+    }
+    else
+    {
+        for (i = 0; i + 4 <= n; i += 4)
+        {
+            __m128 x = _mm_loadu_ps (data + i);
+            vbad = _mm_or_ps (vbad, _mm_cmpunord_ps (x, x));
+            vmin = _mm_min_ps (vmin, x);
+            vmax = _mm_max_ps (vmax, x);
+        }
+    }
+    if (_mm_movemask_ps (vbad))
+        return 0;
+
+    _mm_storeu_ps (lmin, vmin);
+    _mm_storeu_ps (lmax, vmax);
+    _mm_storeu_pd (lsum, vsum);
+    _mm_storeu_pd (lsq, vsq);
+    c->min.f = lmin [0];
+    c->max.f = lmax [0];
+    for (k = 1; k < 4; k++)
+    {
+        if (lmin [k] < c->min.f) c->min.f = lmin [k];
+        if (lmax [k] > c->max.f) c->max.f = lmax [k];
+    }
+    c->sum = lsum [0] + lsum [1];
+    c->sum_square = lsq [0] + lsq [1];
+    for (; i < n; i++)
+    {
+        float v = data [i];
+        if (SKIP_FLOAT (v, full))
+            return 0;
+        if (v < c->min.f) c->min.f = v;
+        if (v > c->max.f) c->max.f = v;
+        c->sum += v;
+        c->sum_square += (double) v * v;
+    }
+    c->have_value = 1;
+    c->cnt = (full ? n : 0);
+    if (!full)
+        c->sum = c->sum_square = 0;
+    return 1;
+}
+
+#else
+
+/* no vector instructions, always use the scalar loop */
+static int stats_vector_d (const double * data, uint64_t n, int full, struct stats_part * c)
+{
+    return 0;
+}
+
+static int stats_vector_f (const float * data, uint64_t n, int full, struct stats_part * c)
+{
+    return 0;
+}
+
+#endif
+
+STATS_INT(int8_t,i8)
+STATS_INT(uint8_t,u8)
+STATS_INT(int16_t,i16)
+STATS_INT(uint16_t,u16)
+STATS_INT(int32_t,i32)
+STATS_INT(uint32_t,u32)
+STATS_INT(int64_t,i64)
+STATS_INT(uint64_t,u64)
+STATS_FLOAT(float,f)
+STATS_FLOAT(double,d)
+STATS_MERGE(ld)
+STATS_SCALAR(long double,ld,SKIP_FLOAT)
+
+/* Run the range function on the array, split among threads if possible */
+static void stats_run (const void * data, uint64_t n, int elem_size, int full,
+                       stats_range_fn range, stats_merge_fn merge, struct stats_part * result)
+{
+    memset (result, 0, sizeof (struct stats_part));
+#ifdef _OPENMP
+    int nth = omp_get_max_threads();
+    if (n >= STATS_PARALLEL_MIN && nth > 1)
+    {
+        struct stats_part * parts = (struct stats_part *) calloc (nth, sizeof (struct stats_part));
+        if (parts)
+        {
+            int t;
+#pragma omp parallel num_threads(nth)
+            {
+                int k = omp_get_thread_num ();
+                int nk = omp_get_num_threads ();
+                uint64_t from = n / nk * k + (k < n % nk ? k : n % nk);
+                uint64_t count = n / nk + (k < n % nk ? 1 : 0);
+                range ((const char *) data + from * elem_size, count, full, &parts [k]);
+            }
+            // merge in thread order so that the result does not depend on scheduling
+            for (t = 0; t < nth; t++)
+                merge (result, &parts [t]);
+            free (parts);
+            return;
+        }
+    }
+#endif
+    range (data, n, full, result);
+}
+
+int adios_stats_compute (enum ADIOS_DATATYPES type, const void * data, uint64_t n, int full,
+                         void * min, void * max,
+                         double * sum, double * sum_square, uint32_t * cnt)
+{
+    struct stats_part r;
+    int size;
+
+#define STATS_CASE(ADIOS_TYPE,T,F,RANGE) \
+        case ADIOS_TYPE: \
+            size = sizeof (T); \
+            stats_run (data, n, size, full, RANGE, stats_merge_##F, &r); \
+            if (r.have_value) \
+            { \
+                memcpy (min, &r.min.F, size); \
+                memcpy (max, &r.max.F, size); \
+            } \
+            break;
+
+    switch (type)
+    {
+        STATS_CASE(adios_byte, int8_t, i8, stats_range_i8)
+        STATS_CASE(adios_unsigned_byte, uint8_t, u8, stats_range_u8)
+        STATS_CASE(adios_short, int16_t, i16, stats_range_i16)
+        STATS_CASE(adios_unsigned_short, uint16_t, u16, stats_range_u16)
+        STATS_CASE(adios_integer, int32_t, i32, stats_range_i32)
+        STATS_CASE(adios_unsigned_integer, uint32_t, u32, stats_range_u32)
+        STATS_CASE(adios_long, int64_t, i64, stats_range_i64)
+        STATS_CASE(adios_unsigned_long, uint64_t, u64, stats_range_u64)
+        STATS_CASE(adios_real, float, f, stats_range_f)
+        STATS_CASE(adios_double, double, d, stats_range_d)
+        STATS_CASE(adios_long_double, long double, ld, stats_scalar_ld)
+        default:
+            return 0;
+    }
+#undef STATS_CASE
+
+    if (!r.have_value)
+    {
+        memset (min, 0, size);
+        memset (max, 0, size);
+    }
+    if (full)
+    {
+        if (sum)
+            *sum = r.sum;
+        if (sum_square)
+            *sum_square = r.sum_square;
+        if (cnt)
+            *cnt = (uint32_t) r.cnt;
+    }
+    return r.have_value;
+}
+
+
+/* Find the bin of each finite value. With few breaks, the bin is the number of
+   breaks not above the value, counted without branches; otherwise binary search. */
+#define STATS_HIST_LINEAR_MAX 32
+#define STATS_HIST(T,F,SKIP) \
+static void stats_hist_##F (const void * vdata, uint64_t n, \
+                            const struct adios_hist_struct * hist, uint32_t * freq) \
+{ \
+    const T * data = (const T *) vdata; \
+    const double * breaks = hist->breaks; \
+    uint64_t i; \
+    int low, high, mid; \
+    if (hist->num_breaks <= STATS_HIST_LINEAR_MAX) \
+    { \
+        for (i = 0; i < n; i++) \
+        { \
+            double a = data [i]; \
+            if (SKIP (data [i], 1)) \
+                continue; \
+            low = 0; \
+            for (mid = 0; mid < hist->num_breaks; mid++) \
+                low += (a >= breaks [mid]); \
+            freq [low] += 1; \
+        } \
+        return; \
+    } \
+    for (i = 0; i < n; i++) \
+    { \
+        T a = data [i]; \
+        if (SKIP (a, 1)) \
+            continue; \
+        low = 0; \
+        high = hist->num_breaks - 1; \
+        if (breaks [low] > a) \
+            freq [0] += 1; \
+        else if (a >= breaks [high]) \
+            freq [high + 1] += 1; \
+        else \
+        { \
+            while (high - low >= 2) \
+            { \
+                mid = (high + low) / 2; \
+                if (a >= breaks [mid]) \
+                    low = mid; \
+                else \
+                    high = mid; \
+            } \
+            freq [low + 1] += 1; \
+        } \
+    } \
+}
+
+STATS_HIST(int8_t,i8,SKIP_INT)
+STATS_HIST(uint8_t,u8,SKIP_INT)
+STATS_HIST(int16_t,i16,SKIP_INT)
+STATS_HIST(uint16_t,u16,SKIP_INT)
+STATS_HIST(int32_t,i32,SKIP_INT)
+STATS_HIST(uint32_t,u32,SKIP_INT)
+STATS_HIST(int64_t,i64,SKIP_INT)
+STATS_HIST(uint64_t,u64,SKIP_INT)
+STATS_HIST(float,f,SKIP_FLOAT)
+STATS_HIST(double,d,SKIP_FLOAT)
+STATS_HIST(long double,ld,SKIP_FLOAT)
+
+void adios_stats_histogram (enum ADIOS_DATATYPES type, const void * data, uint64_t n,
+                            struct adios_hist_struct * hist)
+{
+    void (*fn) (const void *, uint64_t, const struct adios_hist_struct *, uint32_t *);
+
+    if (!hist->num_breaks)
+        return;
+
+    switch (type)
+    {
+        case adios_byte:             fn = stats_hist_i8; break;
+        case adios_unsigned_byte:    fn = stats_hist_u8; break;
+        case adios_short:            fn = stats_hist_i16; break;
+        case adios_unsigned_short:   fn = stats_hist_u16; break;
+        case adios_integer:          fn = stats_hist_i32; break;
+        case adios_unsigned_integer: fn = stats_hist_u32; break;
+        case adios_long:             fn = stats_hist_i64; break;
+        case adios_unsigned_long:    fn = stats_hist_u64; break;
+        case adios_real:             fn = stats_hist_f; break;
+        case adios_double:           fn = stats_hist_d; break;
+        case adios_long_double:      fn = stats_hist_ld; break;
+        default:
+            return;
+    }
+
+#ifdef _OPENMP
+    if (n >= STATS_PARALLEL_MIN && omp_get_max_threads() > 1)
+    {
+        const uint64_t size = adios_get_type_size (type, "");
+#pragma omp parallel
+        {
+            int k = omp_get_thread_num ();
+            int nk = omp_get_num_threads ();
+            uint64_t from = n / nk * k + (k < n % nk ? k : n % nk);
+            uint64_t count = n / nk + (k < n % nk ? 1 : 0);
+            uint32_t * freq = (uint32_t *) calloc (hist->num_breaks + 1, sizeof (uint32_t));
+            uint32_t b;
+            if (freq)
+            {
+                fn ((const char *) data + from * size, count, hist, freq);
+#pragma omp critical
+                for (b = 0; b <= hist->num_breaks; b++)
+                    hist->frequencies [b] += freq [b];
+                free (freq);
+            }
+            else
+            {
+#pragma omp critical
+                fn ((const char *) data + from * size, count, hist, hist->frequencies);
+            }
+        }
+        return;
+    }
+#endif
+    fn (data, n, hist, hist->frequencies);
+}
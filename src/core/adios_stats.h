@@ -0,0 +1,42 @@
+/*
+ * ADIOS is freely available under the terms of the BSD license described
+ * in the COPYING file in the top level directory of this source distribution.
+ *
+ * Copyright (c) 2008 - 2009.  UT-BATTELLE, LLC. All rights reserved.
+ */
+
+#ifndef ADIOS_STATS_H
+#define ADIOS_STATS_H
+
+#include <stdint.h>
+#include "public/adios_types.h"
+#include "core/adios_internals.h"
+
+/* Statistics of the data of a variable, used by adios_generate_var_characteristics_v1().
+ *
+ * The array is processed in chunks. For float and double, chunks are processed with
+ * SSE2/AVX instructions when the compiler targets them, and chunks containing
+ * non-finite values are redone with the scalar loop. Integer types use unrolled
+ * scalar loops the compiler can vectorize. If ADIOS is built with OpenMP, large
+ * arrays are split among the threads.
+ */
+
+/* Compute min and max of n elements of a (non-complex) numeric type.
+ * min/max point to one element of the type each.
+ * If full is 0, only NaN values are skipped, and sum, sum_square and cnt are not used.
+ * If full is 1, all non-finite values are skipped, and the sum, sum of squares and
+ * count of the values are calculated too.
+ * Returns 1 if there was at least one value not skipped, 0 otherwise
+ * (min/max/sum/sum_square are set to 0 then).
+ */
+int adios_stats_compute (enum ADIOS_DATATYPES type, const void * data, uint64_t n, int full,
+                         void * min, void * max,
+                         double * sum, double * sum_square, uint32_t * cnt);
+
+/* Add the finite values of n elements of a (non-complex) numeric type to the
+ * frequencies of the histogram. hist->frequencies must have num_breaks+1 elements.
+ */
+void adios_stats_histogram (enum ADIOS_DATATYPES type, const void * data, uint64_t n,
+                            struct adios_hist_struct * hist);
+
+#endif
@@ -10,6 +10,9 @@
 #include <stdint.h>
 #include <string.h>
 #include <assert.h>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
 #include "core/util.h"
 #include "core/common_read.h"
 #include "core/adios_subvolume.h"
@@ -160,12 +163,12 @@ void copy_subvolume_ragged_offset_with_spec(void *dst, const void *src,
 
 
 /*
- * copy_subvolume delegates to the copy_subvolume_helper function, with the
- * following parameter translations:
+ * copy_subvolume delegates to the copy engine below (see run_copy_plan), with
+ * the following parameter translations:
  * 1) Element size (i.e. 8 bytes for double, etc.) is considered an additional,
  *    fastest-varying dimension
  * 2) All "contiguous" fastest-varying dimensions are collapsed into a single
- *    fastest-varying dimension
+ *    contiguous run, and other dimensions whose strides line up are merged
  */
 void copy_subvolume(void *dst, const void *src, int ndim, const uint64_t *subv_dims,
                     const uint64_t *dst_dims, const uint64_t *dst_subv_offsets,
@@ -202,73 +205,299 @@ void copy_subvolume_ragged(void *dst, const void *src, int ndim, const uint64_t
 }
 
 /*
- * Copies a given subvolume from 'src' to 'dst'. It recursively copies a
- * hyperplane of progressively lower dimensions, until it reaches the lowest
- * dimension, in which case it simply performs a memcpy.
+ * Subvolume copy engine
  *
- * At any given call level to this function, 'src' and 'dst' point to the first
- * element of a hyperplane of the subvolume with dimension 'ndim'.
+ * A copy is described by a plan: the subvolume is reduced to contiguous runs
+ * of 'run' bytes, laid out along at most 32 "outer" dimensions with their
+ * own src/dst byte strides. Dimensions of length 1 are dropped, and adjacent
+ * dimensions whose strides line up in both buffers are merged, so e.g. a
+ * slab of full rows of a 3D array becomes a single 1D loop. The outer loops
+ * for 0 to 3 dimensions are written out explicitly; more dimensions recurse
+ * down to the 3D loop.
  *
- * @param dst the destination buffer
- * @param src the source buffer
- * @param ndim the number of dimensions
- * @param next_subv_dim the list of dimensions for the subvolume, starting with
- *        the slowest-changing
- * @param next_dst_stride the list of destination buffer strides for each
- *        dimension
- * @param next_src_stride the list of source buffer strides for each dimension
- * @param type the datatype of the elements in dst/src (NOTE: this is ONLY for
- *        the purpose of endianness swapping; strides/dimensions are in bytes)
- * @param swap_endianness if true, swap the endianness of each element
+ * The runs are copied by one of several kernels, chosen once per copy:
+ * fixed-size copies for narrow runs of 4, 8 or 16 bytes, a copy with
+ * endianness swapping folded in, non-temporal (streaming) stores for large
+ * copies that would only evict the caches, memmove for overlapping buffers,
+ * and memcpy otherwise.
  */
-static void copy_subvolume_helper(char *dst, const char *src,
-                                  int ndim, const uint64_t *next_subv_dim,
-                                  const uint64_t *next_dst_stride, const uint64_t *next_src_stride,
-                                  enum ADIOS_DATATYPES buftype, int swap_endianness) {
-    if (ndim == 1) {
-        memcpy(dst, src, *next_subv_dim);
-        if (swap_endianness) {
-            change_endianness(dst, *next_subv_dim, buftype);
-        }
-    } else {
-        int i;
-        for (i = 0; i < *next_subv_dim; i++) {
-            copy_subvolume_helper(dst, src, ndim - 1,
-                                  next_subv_dim + 1, next_dst_stride + 1, next_src_stride + 1,
-                                  buftype, swap_endianness);
 
-            src += *next_src_stride;
-            dst += *next_dst_stride;
-        }
+#define COPY_MAX_DIMS 32
+#define COPY_STREAM_MIN_TOTAL (8 << 20) // bytes copied at least to use streaming stores
+#define COPY_STREAM_MIN_RUN 256         // bytes per run at least to use streaming stores
+
+typedef struct {
+    int ndim;                               // number of outer dimensions
+    uint64_t run;                           // bytes in one contiguous run
+    uint64_t count[COPY_MAX_DIMS];          // outer dimensions, slowest first
+    uint64_t dst_stride[COPY_MAX_DIMS];     // in bytes
+    uint64_t src_stride[COPY_MAX_DIMS];     // in bytes
+    int swap_size;                          // size of the words to swap (0 for none)
+    enum ADIOS_DATATYPES type;              // for change_endianness() in the generic swap
+} copy_plan;
+
+static inline void run_copy(char *dst, const char *src, uint64_t n) {
+    memcpy(dst, src, n);
+}
+
+static inline void run_copy_4(char *dst, const char *src, uint64_t n) {
+    memcpy(dst, src, 4);
+}
+
+static inline void run_copy_8(char *dst, const char *src, uint64_t n) {
+    memcpy(dst, src, 8);
+}
+
+static inline void run_copy_16(char *dst, const char *src, uint64_t n) {
+    memcpy(dst, src, 16);
+}
+
+static inline void run_move(char *dst, const char *src, uint64_t n) {
+    memmove(dst, src, n);
+}
+
+static inline void run_copy_swap16(char *dst, const char *src, uint64_t n) {
+    uint64_t i;
+    uint16_t v;
+    for (i = 0; i < n; i += 2) {
+        memcpy(&v, src + i, 2);
+        v = (uint16_t)((v >> 8) | (v << 8));
+        memcpy(dst + i, &v, 2);
     }
 }
 
+static inline void run_copy_swap32(char *dst, const char *src, uint64_t n) {
+    uint64_t i;
+    uint32_t v;
+    for (i = 0; i < n; i += 4) {
+        memcpy(&v, src + i, 4);
+        v = ((v & 0x000000FFu) << 24) | ((v & 0x0000FF00u) << 8) |
+            ((v & 0x00FF0000u) >> 8) | ((v & 0xFF000000u) >> 24);
+        memcpy(dst + i, &v, 4);
+    }
+}
+
+static inline void run_copy_swap64(char *dst, const char *src, uint64_t n) {
+    uint64_t i;
+    uint64_t v;
+    for (i = 0; i < n; i += 8) {
+        memcpy(&v, src + i, 8);
+        v = ((v & 0x00000000000000FFull) << 56) | ((v & 0x000000000000FF00ull) << 40) |
+            ((v & 0x0000000000FF0000ull) << 24) | ((v & 0x00000000FF000000ull) << 8) |
+            ((v & 0x000000FF00000000ull) >> 8) | ((v & 0x0000FF0000000000ull) >> 24) |
+            ((v & 0x00FF000000000000ull) >> 40) | ((v & 0xFF00000000000000ull) >> 56);
+        memcpy(dst + i, &v, 8);
+    }
+}
+
+#ifdef __SSE2__
+/* Copy with non-temporal stores; the caller issues the store fence */
+static inline void run_copy_stream(char *dst, const char *src, uint64_t n) {
+    uint64_t head = (16 - ((uintptr_t)dst & 15)) & 15;
+    if (head > n)
+        head = n;
+    memcpy(dst, src, head);
+    dst += head; src += head; n -= head;
+    for (; n >= 64; n -= 64, dst += 64, src += 64) {
+        __m128i a = _mm_loadu_si128((const __m128i *)src);
+        __m128i b = _mm_loadu_si128((const __m128i *)(src + 16));
+        __m128i c = _mm_loadu_si128((const __m128i *)(src + 32));
+        __m128i d = _mm_loadu_si128((const __m128i *)(src + 48));
+        _mm_stream_si128((__m128i *)dst, a);
+        _mm_stream_si128((__m128i *)(dst + 16), b);
+        _mm_stream_si128((__m128i *)(dst + 32), c);
+        _mm_stream_si128((__m128i *)(dst + 48), d);
+    }
+    for (; n >= 16; n -= 16, dst += 16, src += 16)
+        _mm_stream_si128((__m128i *)dst, _mm_loadu_si128((const __m128i *)src));
+    memcpy(dst, src, n);
+}
+#endif
+
+/* Generic kernel: copy, then swap in place when needed (used for long double
+ * swapping, and for overlapping buffers) */
+#define run_generic(dst, src, n) \
+    do { \
+        memmove((dst), (src), (n)); \
+        if (plan->swap_size) \
+            change_endianness((dst), (n), plan->type); \
+    } while (0)
+
+/* The outer loops around a run kernel */
+#define COPY_LOOPS(NAME, RUN) \
+static void copy_loops_##NAME(const copy_plan *plan, int dim, char *dst, const char *src) { \
+    const uint64_t run = plan->run; \
+    uint64_t i, j, k; \
+    switch (plan->ndim - dim) { \
+    case 0: \
+        RUN(dst, src, run); \
+        break; \
+    case 1: \
+        for (i = 0; i < plan->count[dim]; i++) \
+            RUN(dst + i * plan->dst_stride[dim], src + i * plan->src_stride[dim], run); \
+        break; \
+    case 2: \
+        for (i = 0; i < plan->count[dim]; i++) { \
+            char *d = dst + i * plan->dst_stride[dim]; \
+            const char *s = src + i * plan->src_stride[dim]; \
+            for (j = 0; j < plan->count[dim + 1]; j++) \
+                RUN(d + j * plan->dst_stride[dim + 1], s + j * plan->src_stride[dim + 1], run); \
+        } \
+        break; \
+    case 3: \
+        for (i = 0; i < plan->count[dim]; i++) { \
+            for (j = 0; j < plan->count[dim + 1]; j++) { \
+                char *d = dst + i * plan->dst_stride[dim] + j * plan->dst_stride[dim + 1]; \
+                const char *s = src + i * plan->src_stride[dim] + j * plan->src_stride[dim + 1]; \
+                for (k = 0; k < plan->count[dim + 2]; k++) \
+                    RUN(d + k * plan->dst_stride[dim + 2], s + k * plan->src_stride[dim + 2], run); \
+            } \
+        } \
+        break; \
+    default: \
+        for (i = 0; i < plan->count[dim]; i++) \
+            copy_loops_##NAME(plan, dim + 1, dst + i * plan->dst_stride[dim], \
+                              src + i * plan->src_stride[dim]); \
+        break; \
+    } \
+}
+
+COPY_LOOPS(memcpy, run_copy)
+COPY_LOOPS(fixed4, run_copy_4)
+COPY_LOOPS(fixed8, run_copy_8)
+COPY_LOOPS(fixed16, run_copy_16)
+COPY_LOOPS(memmove, run_move)
+COPY_LOOPS(swap16, run_copy_swap16)
+COPY_LOOPS(swap32, run_copy_swap32)
+COPY_LOOPS(swap64, run_copy_swap64)
+COPY_LOOPS(generic, run_generic)
+#ifdef __SSE2__
+COPY_LOOPS(stream, run_copy_stream)
+#endif
+
 /*
- * Same as copy_subvolume_helper, but uses memmove instead of memcpy for
- * safe(r) copies on overlapping buffers.
+ * Builds the copy plan from the byte strides of the subvolume dimensions.
+ * Dimensions are given slowest first.
  */
-static void copy_subvolume_helper_safe(char *dst, const char *src,
-                                       int ndim, const uint64_t *next_subv_dim,
-                                       const uint64_t *next_dst_stride, const uint64_t *next_src_stride,
-                                        enum ADIOS_DATATYPES buftype, int swap_endianness) {
-    if (ndim == 1) {
-        memmove(dst, src, *next_subv_dim);
-        if (swap_endianness) {
-            change_endianness(dst, *next_subv_dim, buftype);
+static void build_copy_plan(copy_plan *plan, int ndim, const uint64_t *subv_dims,
+                            const uint64_t *dst_strides, const uint64_t *src_strides,
+                            int type_size) {
+    int i, n = 0;
+    uint64_t count[COPY_MAX_DIMS], dst_stride[COPY_MAX_DIMS], src_stride[COPY_MAX_DIMS];
+
+    plan->run = type_size;
+    // Walk from the fastest dimension, collecting outer dimensions fastest first
+    for (i = ndim - 1; i >= 0; i--) {
+        if (subv_dims[i] == 1)
+            continue;
+        if (n == 0 && src_strides[i] == plan->run && dst_strides[i] == plan->run) {
+            // contiguous in both buffers: extend the run
+            plan->run *= subv_dims[i];
+        } else if (n > 0 &&
+                   src_strides[i] == count[n - 1] * src_stride[n - 1] &&
+                   dst_strides[i] == count[n - 1] * dst_stride[n - 1]) {
+            // lines up with the previous outer dimension: merge them
+            count[n - 1] *= subv_dims[i];
+        } else {
+            count[n] = subv_dims[i];
+            dst_stride[n] = dst_strides[i];
+            src_stride[n] = src_strides[i];
+            n++;
         }
-    } else {
-        int i;
-        for (i = 0; i < *next_subv_dim; i++) {
-            copy_subvolume_helper(dst, src, ndim - 1,
-                                  next_subv_dim + 1, next_dst_stride + 1, next_src_stride + 1,
-                                  buftype, swap_endianness);
+    }
 
-            src += *next_src_stride;
-            dst += *next_dst_stride;
-        }
+    plan->ndim = n;
+    for (i = 0; i < n; i++) {
+        plan->count[i] = count[n - 1 - i];
+        plan->dst_stride[i] = dst_stride[n - 1 - i];
+        plan->src_stride[i] = src_stride[n - 1 - i];
     }
 }
 
+/* Size of the words to swap for the endianness of a type, 0 if nothing to swap */
+static int swap_word_size(enum ADIOS_DATATYPES type) {
+    switch (type) {
+    case adios_complex:
+        return 4;
+    case adios_double_complex:
+        return 8;
+    case adios_string:
+    case adios_string_array:
+        return 0;
+    default:
+        return adios_get_type_size(type, NULL) > 1 ? adios_get_type_size(type, NULL) : 0;
+    }
+}
+
+/* Returns 1 if the byte ranges touched by the copy in src and dst overlap */
+static int copy_buffers_overlap(const copy_plan *plan, const char *dst, const char *src) {
+    uint64_t dst_extent = plan->run, src_extent = plan->run;
+    int i;
+    for (i = 0; i < plan->ndim; i++) {
+        dst_extent += (plan->count[i] - 1) * plan->dst_stride[i];
+        src_extent += (plan->count[i] - 1) * plan->src_stride[i];
+    }
+    return dst < src + src_extent && src < dst + dst_extent;
+}
+
+static void run_copy_plan(const copy_plan *plan, char *dst, const char *src) {
+    uint64_t total = plan->run;
+    int i;
+
+    for (i = 0; i < plan->ndim; i++)
+        total *= plan->count[i];
+    if (total == 0)
+        return;
+
+    if (copy_buffers_overlap(plan, dst, src)) {
+        // See the note on overlapping copies in adios_subvolume.h
+        if (plan->swap_size)
+            copy_loops_generic(plan, 0, dst, src);
+        else
+            copy_loops_memmove(plan, 0, dst, src);
+        return;
+    }
+
+    switch (plan->swap_size) {
+    case 0:
+        break;
+    case 2:
+        copy_loops_swap16(plan, 0, dst, src);
+        return;
+    case 4:
+        copy_loops_swap32(plan, 0, dst, src);
+        return;
+    case 8:
+        copy_loops_swap64(plan, 0, dst, src);
+        return;
+    default:
+        copy_loops_generic(plan, 0, dst, src);
+        return;
+    }
+
+    switch (plan->run) {
+    case 4:
+        copy_loops_fixed4(plan, 0, dst, src);
+        return;
+    case 8:
+        copy_loops_fixed8(plan, 0, dst, src);
+        return;
+    case 16:
+        copy_loops_fixed16(plan, 0, dst, src);
+        return;
+    }
+
+#ifdef __SSE2__
+    // A single run is left to memcpy, which picks its own strategy for large sizes
+    if (plan->ndim > 0 && total >= COPY_STREAM_MIN_TOTAL && plan->run >= COPY_STREAM_MIN_RUN) {
+        copy_loops_stream(plan, 0, dst, src);
+        _mm_sfence();
+        return;
+    }
+#endif
+    copy_loops_memcpy(plan, 0, dst, src);
+}
+
 void copy_subvolume_ragged_offset(void *dst, const void *src, int ndim, const uint64_t *subv_dims,
                                   const uint64_t *dst_dims, const uint64_t *dst_subv_offsets,
                                   uint64_t dst_ragged_offset,
@@ -277,37 +506,14 @@ void copy_subvolume_ragged_offset(void *dst, const void *src, int ndim, const ui
                                   enum ADIOS_DATATYPES datum_type, enum ADIOS_FLAG swap_endianness) {
 
     int i;
-    int last_noncovering_dim = 0; // Index of dimension that starts a contiguous block
-    int buffers_intersect = 0; // Whether the source and destination memory copy regions may intersect
-    uint64_t src_strides[32];
-    uint64_t dst_strides[32];
+    uint64_t src_strides[COPY_MAX_DIMS];
+    uint64_t dst_strides[COPY_MAX_DIMS];
     const int type_size = adios_get_type_size(datum_type, NULL);
+    copy_plan plan;
 
-    // Find the last dimension for which the subvolume, source and destination
-    // spaces do not exactly match (i.e. non-zero offset or unequal lengths).
-    for (i = 0; i < ndim; i++) {
-        // If the subvolume, source and destination do not exactly match along
-        // this dimension, it is marked as incomplete
-        if (src_subv_offsets[i] != 0 ||
-            dst_subv_offsets[i] != 0 ||
-            subv_dims[i] != src_dims[i] ||
-            subv_dims[i] != dst_dims[i]) {
-
-            last_noncovering_dim = i;
-        }
-    }
+    assert(ndim <= COPY_MAX_DIMS);
 
-    // Calculate the volume (number of bytes) of the region subtended by the
-    // contiguous dimensions (which start with the last non-covering dimension)
-    uint64_t contig_dims_volume = 1;
-    for (i = last_noncovering_dim; i < ndim; i++) {
-        contig_dims_volume *= subv_dims[i];
-    }
-    // Add the element size as a new "dimension", to convert from element-space
-    // to byte-space
-    contig_dims_volume *= type_size; // Assumes non-string type
-
-    // Compute strides for the dimensions
+    // Compute strides for the dimensions, in bytes
     uint64_t src_volume = type_size;
     uint64_t dst_volume = type_size;
     for (i = ndim - 1; i >= 0; i--) {
@@ -318,9 +524,7 @@ void copy_subvolume_ragged_offset(void *dst, const void *src, int ndim, const ui
         dst_volume *= dst_dims[i];
     }
 
-    // Compute the starting offsets for src and dst. In theory we could skip
-    // the contiguous dimensions other than the first one, but just to be
-    // safe/simple we calculate them all.
+    // Compute the starting offsets for src and dst
     uint64_t src_offset = 0, dst_offset = 0;
     for (i = 0; i < ndim; i++) {
         src_offset += src_subv_offsets[i] * src_strides[i];
@@ -330,76 +534,11 @@ void copy_subvolume_ragged_offset(void *dst, const void *src, int ndim, const ui
     src_offset -= src_ragged_offset * type_size;
     dst_offset -= dst_ragged_offset * type_size;
 
-    // Save the old value of the first contiguous dimension, then replace it
-    // with a "collapsed" dimension consolidating all contiguous dimensions
-    // into one
-    // We "cheat" a bit by removing the const modifier. This is OK because we
-    // carefully put back the original value before returning. This is the only
-    // argument modification we do in this function besides filling 'dst'.
-    uint64_t first_contig_dim_value_old = subv_dims[last_noncovering_dim];
-    ((uint64_t*)subv_dims)[last_noncovering_dim] = contig_dims_volume;
-
-    // Compute whether the memory regions for the copy overlap
-    // If so, we need to use a safer copy method
-    if (0) { // FOR NOW, DON'T DO THIS, AS WE NEVER USE OVERLAPPING BUFFERS
-        uint64_t dst_end_offset = dst_offset;
-        uint64_t src_end_offset = src_offset;
-        // Match the stride counts as executed by the helper function: all but
-        // the last dimension contribute (length - 1) strides, with the last
-        // dimension contributing instead its length
-        for (i = 0; i < last_noncovering_dim; i++) {
-            src_end_offset += (subv_dims[i] - 1) * src_strides[i];
-            dst_end_offset += (subv_dims[i] - 1) * dst_strides[i];
-        }
-        src_end_offset += subv_dims[last_noncovering_dim];
-        dst_end_offset += subv_dims[last_noncovering_dim];
-
-        buffers_intersect =
-                intersect_segments((uint64_t)dst + dst_offset,
-                                   dst_end_offset - dst_offset,
-                                   (uint64_t)src + src_offset,
-                                   src_end_offset - src_offset,
-                                   NULL, NULL);
-
-        buffers_intersect = 0; // Look Ma, no asserts!
-
-        // Enfoce the safety condition for overlapping buffers here
-        if (buffers_intersect) {
-            assert((char*)src + src_offset >= (char*)dst + dst_offset);
-            for (i = 0; i < last_noncovering_dim + 1; i++)
-                assert(src_strides[i] >= dst_strides[i]);
-        }
-    }
-
-    //printf(">>> copy_subvolume is using %d contiguous dimensions...\n", ndim - first_contig_dim);
-
-    // Finally, delegate to the recursive worker function
-    if (buffers_intersect) {
-        copy_subvolume_helper_safe(
-                (char*)dst + dst_offset,            /* Offset dst buffer to the first element */
-                (char*)src + src_offset,            /* Offset src buffer to the first element */
-                last_noncovering_dim + 1,           /* Number of dimensions, modified for collapsed contiguous dimensions */
-                subv_dims,                          /* Subvolume dimensions (modified to collapse all contiguous dimensions) */
-                dst_strides,                        /* dst buffer dimension strides */
-                src_strides,                        /* src buffer dimension strides */
-                datum_type,                         /* The datatype of the buffer elements */
-                swap_endianness == adios_flag_yes   /* Whether to swap endianness */
-        );
-    } else {
-        copy_subvolume_helper(
-                (char*)dst + dst_offset,            /* Offset dst buffer to the first element */
-                (char*)src + src_offset,            /* Offset src buffer to the first element */
-                last_noncovering_dim + 1,           /* Number of dimensions, modified for collapsed contiguous dimensions */
-                subv_dims,                          /* Subvolume dimensions (modified to collapse all contiguous dimensions) */
-                dst_strides,                        /* dst buffer dimension strides */
-                src_strides,                        /* src buffer dimension strides */
-                datum_type,                         /* The datatype of the buffer elements */
-                swap_endianness == adios_flag_yes   /* Whether to swap endianness */
-        );
-    }
+    build_copy_plan(&plan, ndim, subv_dims, dst_strides, src_strides, type_size);
+    plan.type = datum_type;
+    plan.swap_size = (swap_endianness == adios_flag_yes ? swap_word_size(datum_type) : 0);
 
-    // Restore the old first contiguous dimension value
-    ((uint64_t*)subv_dims)[last_noncovering_dim] = first_contig_dim_value_old;
+    run_copy_plan(&plan, (char*)dst + dst_offset, (const char*)src + src_offset);
 }
 
 uint64_t compute_linear_offset_in_volume(int ndim, const uint64_t *point, const uint64_t *dims) {
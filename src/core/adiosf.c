@@ -87,6 +87,20 @@ void FC_FUNC_(adios_set_max_buffer_size, ADIOS_SET_MAX_BUFFER_SIZE) (int *max_bu
         adios_databuffer_set_max_size ((uint64_t)*max_buffer_size_MB * 1024L * 1024L);
 }
 
+///////////////////////////////////////////////////////////////////////////////
+void FC_FUNC_(adios_set_buffer_options, ADIOS_SET_BUFFER_OPTIONS) (int *use_hugepages, int *prefault_MB)
+{
+    adios_databuffer_set_hugepages (*use_hugepages);
+    if (*prefault_MB > 0)
+        adios_databuffer_prefault ((uint64_t)*prefault_MB * 1024L * 1024L);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void FC_FUNC_(adios_release_buffers, ADIOS_RELEASE_BUFFERS) ()
+{
+    adios_databuffer_pool_free ();
+}
+
 
 ///////////////////////////////////////////////////////////////////////////////
 void FC_FUNC_(adios_open, ADIOS_OPEN) 
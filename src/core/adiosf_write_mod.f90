@@ -169,6 +169,16 @@ module adios_write_mod
             integer,        intent(in)  :: sizeMB
         end subroutine
 
+        subroutine adios_set_buffer_options (use_hugepages, prefaultMB)
+            implicit none
+            integer,        intent(in)  :: use_hugepages
+            integer,        intent(in)  :: prefaultMB
+        end subroutine
+
+        subroutine adios_release_buffers ()
+            implicit none
+        end subroutine
+
         subroutine adios_define_schema_version (group_id, schema_version)
             implicit none
             integer*8,      intent(in)  :: group_id
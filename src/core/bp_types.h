@@ -9,9 +9,15 @@
 #define __BP_TYPES_H__
 
 #include "public/adios_types.h"
+#include "public/adios_mpi.h"
 #include "core/adios_bp_v1.h"
 #include "core/util.h" /* struct read_request */
 
+/* MPI-3 shared memory windows are needed for the 'shared_index' open mode */
+#if !defined(_NOMPI) && defined(MPI_VERSION) && MPI_VERSION >= 3
+#define BP_SHARED_INDEX 1
+#endif
+
 #define BP_MAX_RANK 32
 #define BP_MAX_NDIMS (BP_MAX_RANK+1)
 
@@ -43,6 +49,27 @@ struct bp_minifooter {
     uint64_t file_size;
 } __attribute__((__packed__));
 
+/* A read-only memory mapping of a BP file or subfile (see the 'mmap' read parameter) */
+struct BP_file_map
+{
+    char * addr;     // start of mapping, NULL if the file is not mapped
+    uint64_t size;   // number of mapped bytes
+    struct BP_file_map * superseded; // older mappings of the file, before it grew,
+                                     // kept until close for the chunks pointing into them
+};
+
+/* A file range read ahead by the read planner of perform_reads (see the
+   'coalesce' read parameter), or for a later step (see 'prefetch').
+   Slices within the range are served from memory. */
+struct BP_staged_range
+{
+    int file_index;  // -1 for the main file
+    uint64_t offset;
+    uint64_t size;
+    char * data;
+    int step;        // step a prefetched range was read for
+};
+
 struct BP_file_handle
 {
     uint32_t file_index;
@@ -61,21 +88,86 @@ struct BP_file_handle_header
 
 typedef struct BP_file_handle_header BP_file_handle_list;
 
+/* Columnar (struct of arrays) copy of the block characteristics of one
+ * variable, used by read_var_bb() for variables with many blocks. Block i
+ * of the variable is element i of every array. Dimensions are without time
+ * and in C order, as returned by bp_get_dimension_characteristics_notime().
+ * The first and last block of each time index are kept in a table, and the
+ * blocks of each time index are also kept sorted by their start in the
+ * slowest dimension, so that the blocks intersecting a bounding box are
+ * found with a binary search (bp_columns_find_blocks()).
+ */
+struct BP_var_columns
+{
+    uint64_t nblocks;
+    int ndim;                   // number of dimensions (without time) of the variable
+    uint64_t * offset;          // [nblocks]
+    uint64_t * payload_offset;  // [nblocks]
+    uint32_t * time_index;      // [nblocks]
+    uint32_t * file_index;      // [nblocks]
+    uint8_t * is_global;        // [nblocks] 1 if the block belongs to a global array
+    uint64_t * count;           // [nblocks * ndim] local dimensions of the block
+    uint64_t * start;           // [nblocks * ndim] offsets of the block in the global space
+    uint64_t * gdims;           // [nblocks * ndim] global dimensions
+    uint32_t min_time;          // smallest time index of the blocks
+    uint32_t ntimes;            // size of the tables below, 0 if the time indices are too sparse
+    int64_t * time_first;       // [ntimes] first block of time index min_time + t, -1 if none
+    int64_t * time_last;        // [ntimes] last block of time index min_time + t, -1 if none
+    uint64_t * max_count;       // [ntimes] largest count in the slowest dimension of those blocks
+    uint64_t * by_start;        // [nblocks] blocks time_first..time_last of each time index,
+                                //   ordered by start in the slowest dimension
+};
+
+struct bp_chain_cache; // see bp_utils.c
+struct bp_prefetch; // see read_bp.c
+
+/* What a streaming reader keeps from one open of the file to the next */
+struct BP_stream_state
+{
+    int have_marker;        // the writer updates a step marker, see adios_write_step_marker_v1()
+    uint32_t marker_step;   // contents of the marker when the file was last opened
+    uint64_t marker_size;
+    int64_t marker_mtime;   // modification time of the marker then (seconds)
+    int notify_fd;          // inotify descriptor watching the marker's directory, -1 if none
+    struct bp_chain_cache * chain; // indexes of a chained index read so far (rank 0)
+};
+
 typedef struct BP_FILE {
     MPI_File mpi_fh;
     char * fname; // Main file name is needed to calculate subfile names
     BP_file_handle_list subfile_handles; // This list links all the subfiles handle together
+    int use_mmap; // 1: serve payload reads from memory mappings instead of MPI_File_read
+    struct BP_file_map map; // mapping of the main file
+    struct BP_file_map * subfile_maps; // mappings of the subfiles, indexed by file_index
+    uint32_t n_subfile_maps;
+    struct BP_staged_range * staged; // ranges read ahead, sorted by file_index and offset
+    uint64_t n_staged;
+    struct BP_staged_range * prefetched; // ranges of later steps read in the background, sorted the same way
+    uint64_t n_prefetched;
+    struct bp_prefetch * prefetch; // reads in progress, NULL if none
     MPI_Comm comm;
     struct adios_bp_buffer_struct_v1 * b;
     struct bp_index_pg_struct_v1 * pgs_root;
     struct adios_index_var_struct_v1 * vars_root;
     struct adios_index_attribute_struct_v1 * attrs_root;
     struct adios_index_var_struct_v1 ** vars_table; // To speed up vars_root lookup. Q. Liu, 12-2013.
+    int lazy_index; // 1: decode the characteristics of a variable only when it is first accessed
+    int index_threads; // number of threads to decode the characteristics with at open
+    char * vars_index; // copy of the variables index while characteristics are not decoded
+    uint64_t * vars_index_offsets; // per variable, offset of its characteristics in vars_index, 0 if decoded
+    uint32_t vars_pending; // number of variables whose characteristics are not decoded yet
+    int shared_index; // 1: broadcast the raw footer once per node into shared memory
+    int vars_index_shared; // 1: vars_index points into the shared footer, not to be freed
+    struct BP_var_columns ** var_columns; // per variable, columnar block index built on first use
+#if BP_SHARED_INDEX
+    MPI_Win index_win; // shared memory window holding the footer, MPI_WIN_NULL if none
+#endif
     struct bp_minifooter mfooter; 
     struct BP_GROUP_VAR * gvar_h;
     struct BP_GROUP_ATTR * gattr_h;
     uint32_t tidx_start;
     uint32_t tidx_stop;
+    struct BP_stream_state * stream; // NULL unless opened as a stream, freed by bp_close()
     void * priv;
 } BP_FILE;
 
@@ -87,6 +179,9 @@ typedef struct BP_PROC {
     read_request * local_read_request_list;
     void * b; //internal buffer for chunk reading
     void * priv;
+    struct adios_index_attribute_struct_v1 ** attrs_by_id; // attributes by attribute ID, built at the first get_attr
+    int nattrs_by_id;
+    struct BP_file_map * retired_maps; // mappings of the files closed by advance_step, unmapped at close
 } BP_PROC;
 
 struct BP_GROUP_VAR {
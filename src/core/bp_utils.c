@@ -5,13 +5,21 @@
  * Copyright (c) 2008 - 2009.  UT-BATTELLE, LLC. All rights reserved.
  */
 
+#include "config.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <assert.h>
 #include <stdarg.h>
 #include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
 #include <string.h>
 #include <math.h>
+#if HAVE_PTHREAD
+#include <pthread.h>
+#endif
 #include "public/adios.h"
 #include "public/adios_read.h"
 #include "public/adios_error.h"
@@ -22,6 +30,7 @@
 #include "core/adios_endianness.h"
 #include "core/adios_logger.h"
 #include "core/futils.h"
+#include "core/qhashtbl.h"
 #define BYTE_ALIGN 8
 #define MINIFOOTER_SIZE 28
 
@@ -229,6 +238,80 @@ int bp_read_open (const char * filename,
     return 0;
 }
 
+#if BP_SHARED_INDEX
+/* 'shared_index' mode, an optimisation of the broadcast of the footer: the
+ * footer read by rank 0 is broadcast only among the first process of each
+ * node, into a shared memory window there, instead of to every process.
+ * All processes of a node then parse the same raw copy in place, so fh->b
+ * is pointed to the window here. Returns the footer or NULL if the window
+ * cannot be created.
+ * The parsed index (groups, variables, attributes) is not shared: every
+ * process still builds its own from the window. With lazy_index the window
+ * is kept until bp_close(), which is then collective over the processes of
+ * the node.
+ */
+static char * bp_bcast_shared_index (BP_FILE * fh, MPI_Comm comm, uint64_t header_size)
+{
+    MPI_Comm node_comm, leader_comm;
+    int rank, node_rank, disp_unit;
+    MPI_Aint size;
+    char * base = NULL;
+
+    MPI_Comm_rank (comm, &rank);
+    MPI_Comm_split_type (comm, MPI_COMM_TYPE_SHARED, rank, MPI_INFO_NULL, &node_comm);
+    MPI_Comm_rank (node_comm, &node_rank);
+    // rank 0 of comm is also rank 0 of its node and of the leaders
+    MPI_Comm_split (comm, (node_rank == 0 ? 0 : MPI_UNDEFINED), rank, &leader_comm);
+
+    if (MPI_Win_allocate_shared ((node_rank == 0 ? (MPI_Aint) header_size : 0), 1,
+                                 MPI_INFO_NULL, node_comm, &base, &fh->index_win)
+        != MPI_SUCCESS)
+    {
+        log_warn ("Could not allocate a shared memory window for the index of %s, "
+                  "every process will keep its own copy\n", fh->fname);
+        fh->index_win = MPI_WIN_NULL;
+    }
+
+    if (fh->index_win != MPI_WIN_NULL)
+    {
+        if (node_rank != 0)
+        {
+            MPI_Win_shared_query (fh->index_win, 0, &size, &disp_unit, &base);
+        }
+
+        MPI_Win_fence (0, fh->index_win);
+        if (node_rank == 0)
+        {
+            if (rank == 0)
+            {
+                memcpy (base, fh->b->buff, header_size);
+            }
+            MPI_Bcast (base, header_size, MPI_BYTE, 0, leader_comm);
+        }
+        MPI_Win_fence (0, fh->index_win);
+    }
+
+    if (leader_comm != MPI_COMM_NULL)
+    {
+        MPI_Comm_free (&leader_comm);
+    }
+    MPI_Comm_free (&node_comm);
+
+    if (fh->index_win == MPI_WIN_NULL)
+    {
+        return NULL;
+    }
+
+    // rank 0 does not need its private copy of the footer anymore
+    adios_buffer_struct_clear (fh->b);
+    fh->b->buff = base;
+    fh->b->length = header_size;
+    fh->b->offset = 0;
+
+    return base;
+}
+#endif
+
 /* This routine does the parallel bp file open and index parsing.
  */
 int bp_open (const char * fname,
@@ -261,6 +344,29 @@ int bp_open (const char * fname,
 
     header_size = fh->mfooter.file_size-fh->mfooter.pgs_index_offset;
 
+#if BP_SHARED_INDEX
+    if (fh->shared_index && bp_bcast_shared_index (fh, comm, header_size))
+    {
+        /* Everyone parses the node's copy of the index */
+        fh->vars_index_shared = 1;
+        bp_parse_pgs (fh);
+        bp_parse_vars (fh);
+        bp_parse_attrs (fh);
+
+        // fh->b is used as a private read buffer from now on
+        adios_buffer_struct_init (fh->b);
+
+        // with lazy_index the window is still referenced, it is freed in bp_close()
+        if (!fh->vars_index)
+        {
+            fh->vars_index_shared = 0;
+            MPI_Win_free (&fh->index_win);
+        }
+
+        return 0;
+    }
+#endif
+
     if (rank != 0)
     {
         if (!fh->b->buff)
@@ -411,15 +517,342 @@ BP_FILE * BP_FILE_alloc (const char * fname, MPI_Comm comm)
     fh->vars_root = 0;
     fh->attrs_root = 0;
     fh->vars_table = 0;
+    fh->lazy_index = 0;
+    fh->index_threads = 1;
+    fh->vars_index = 0;
+    fh->vars_index_offsets = 0;
+    fh->vars_pending = 0;
+    fh->shared_index = 0;
+    fh->vars_index_shared = 0;
+    fh->var_columns = 0;
+#if BP_SHARED_INDEX
+    fh->index_win = MPI_WIN_NULL;
+#endif
     fh->b = malloc (sizeof (struct adios_bp_buffer_struct_v1));
     assert (fh->b);
     fh->subfile_handles.n_handles = 0;
     fh->subfile_handles.warning_printed = 0;
     fh->subfile_handles.head = NULL;
     fh->subfile_handles.tail = NULL;
+    fh->use_mmap = 0;
+    fh->map.addr = NULL;
+    fh->map.size = 0;
+    fh->map.superseded = NULL;
+    fh->subfile_maps = NULL;
+    fh->n_subfile_maps = 0;
+    fh->staged = NULL;
+    fh->n_staged = 0;
+    fh->prefetched = NULL;
+    fh->n_prefetched = 0;
+    fh->prefetch = NULL;
+    fh->stream = NULL;
     return fh;
 }
 
+/* Map the whole file read-only. Returns 0 on success, 1 on error. */
+static int bp_map_file (const char * fname, struct BP_file_map * map)
+{
+    struct stat st;
+    void * addr;
+    int fd;
+
+    fd = open (fname, O_RDONLY);
+    if (fd == -1)
+    {
+        log_debug ("mmap: could not open %s\n", fname);
+        return 1;
+    }
+
+    if (fstat (fd, &st) || st.st_size == 0)
+    {
+        close (fd);
+        return 1;
+    }
+
+    addr = mmap (NULL, (size_t) st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    /* the mapping stays valid after closing the descriptor */
+    close (fd);
+
+    if (addr == MAP_FAILED)
+    {
+        log_debug ("mmap: could not map %s\n", fname);
+        return 1;
+    }
+
+    map->addr = (char *) addr;
+    map->size = (uint64_t) st.st_size;
+    return 0;
+}
+
+/* Unmap and free a list of mappings linked by their superseded field */
+void bp_unmap_list (struct BP_file_map ** list)
+{
+    struct BP_file_map * old;
+
+    while (*list)
+    {
+        old = *list;
+        *list = old->superseded;
+        munmap (old->addr, (size_t) old->size);
+        free (old);
+    }
+}
+
+/* Unmap the file and its superseded mappings */
+static void bp_unmap_file (struct BP_file_map * map)
+{
+    if (map->addr)
+    {
+        munmap (map->addr, (size_t) map->size);
+        map->addr = NULL;
+        map->size = 0;
+    }
+    bp_unmap_list (&map->superseded);
+}
+
+/* Keep the current mapping in the list of superseded ones before mapping the
+   file again. Returns 0 on success, 1 on error. */
+static int bp_supersede_map (struct BP_file_map * map)
+{
+    struct BP_file_map * old = (struct BP_file_map *) malloc (sizeof (struct BP_file_map));
+
+    if (!old)
+        return 1;
+    *old = *map;
+    map->addr = NULL;
+    map->size = 0;
+    map->superseded = old;
+    return 0;
+}
+
+/* Subfiles of fname are named <fname>.dir/<basename of fname>.<file_index>.
+   The returned string should be freed by the caller. */
+char * bp_get_subfile_name (const char * fname, uint32_t file_index)
+{
+    const char * name_no_path = strrchr (fname, '/');
+    char * name;
+
+    name_no_path = (name_no_path ? name_no_path + 1 : fname);
+    name = (char *) malloc (strlen (fname) + 5 + strlen (name_no_path) + 1 + 10 + 1);
+    assert (name);
+    sprintf (name, "%s.dir/%s.%u", fname, name_no_path, file_index);
+
+    return name;
+}
+
+/* Return a pointer to bytes [offset, offset+size) of the main file
+ * (file_index < 0) or of a subfile, served from a read-only memory mapping.
+ * The file is mapped on first access and mapped again if it has grown since;
+ * the old mappings are unmapped only by unmap_all_BP_files() at close.
+ * Returns NULL if mmap is not enabled for this file or the range cannot be
+ * mapped; the caller should fall back to MPI_File_read then.
+ */
+char * bp_get_mapped_slice (BP_FILE * fh, int file_index, uint64_t offset, uint64_t size)
+{
+    struct BP_file_map * map;
+    char * name;
+    int err;
+
+    if (!fh->use_mmap)
+        return NULL;
+
+    if (file_index < 0)
+    {
+        map = &fh->map;
+        name = NULL;
+    }
+    else
+    {
+        if ((uint32_t) file_index >= fh->n_subfile_maps)
+        {
+            uint32_t n = file_index + 1;
+            fh->subfile_maps = (struct BP_file_map *) realloc (fh->subfile_maps,
+                                    n * sizeof (struct BP_file_map));
+            assert (fh->subfile_maps);
+            memset (fh->subfile_maps + fh->n_subfile_maps, 0,
+                    (n - fh->n_subfile_maps) * sizeof (struct BP_file_map));
+            fh->n_subfile_maps = n;
+        }
+        map = &fh->subfile_maps[file_index];
+        name = bp_get_subfile_name (fh->fname, file_index);
+    }
+
+    if (map->addr && offset + size > map->size)
+    {
+        // file has grown since we mapped it (stream being appended);
+        // chunks returned earlier still point into the old mapping
+        if (bp_supersede_map (map))
+        {
+            if (name)
+                free (name);
+            return NULL;
+        }
+    }
+
+    err = 0;
+    if (!map->addr)
+    {
+        err = bp_map_file (name ? name : fh->fname, map);
+    }
+
+    if (name)
+        free (name);
+
+    if (err || offset + size > map->size)
+        return NULL;
+
+    return map->addr + offset;
+}
+
+/* The range of the sorted array 'ranges' that holds bytes [offset, offset+size)
+ * of the main file (file_index < 0) or of a subfile, NULL if none */
+static struct BP_staged_range * find_staged_range (struct BP_staged_range * ranges, uint64_t n,
+                                                   int file_index, uint64_t offset, uint64_t size)
+{
+    int64_t lo = 0, hi = (int64_t) n - 1, mid;
+    struct BP_staged_range * r;
+
+    // find the last range starting at or before (file_index, offset)
+    while (lo <= hi)
+    {
+        mid = (lo + hi) / 2;
+        r = &ranges[mid];
+        if (r->file_index < file_index
+            || (r->file_index == file_index && r->offset <= offset))
+            lo = mid + 1;
+        else
+            hi = mid - 1;
+    }
+
+    if (hi < 0)
+        return NULL;
+
+    r = &ranges[hi];
+    if (r->file_index != file_index || offset + size > r->offset + r->size)
+        return NULL;
+
+    return r;
+}
+
+/* Return a pointer to bytes [offset, offset+size) of the main file
+ * (file_index < 0) or of a subfile if they are within a range read ahead by
+ * the read planner, NULL otherwise.
+ */
+char * bp_get_staged_slice (BP_FILE * fh, int file_index, uint64_t offset, uint64_t size)
+{
+    struct BP_staged_range * r = find_staged_range (fh->staged, fh->n_staged,
+                                                    file_index, offset, size);
+    return (r ? r->data + (offset - r->offset) : NULL);
+}
+
+/* The same for the ranges of later steps read by the 'prefetch' read parameter */
+char * bp_get_prefetched_slice (BP_FILE * fh, int file_index, uint64_t offset, uint64_t size)
+{
+    struct BP_staged_range * r = find_staged_range (fh->prefetched, fh->n_prefetched,
+                                                    file_index, offset, size);
+    return (r ? r->data + (offset - r->offset) : NULL);
+}
+
+/* A slice served from memory: read ahead by the read planner or prefetched,
+ * or from the file mapping with the 'mmap' parameter. NULL if it should be
+ * read from the file.
+ */
+char * bp_get_slice_in_memory (BP_FILE * fh, int file_index, uint64_t offset, uint64_t size)
+{
+    char * slice = NULL;
+
+    if (fh->n_staged)
+        slice = bp_get_staged_slice (fh, file_index, offset, size);
+    if (!slice && fh->n_prefetched)
+        slice = bp_get_prefetched_slice (fh, file_index, offset, size);
+    if (!slice)
+        slice = bp_get_mapped_slice (fh, file_index, offset, size);
+
+    return slice;
+}
+
+void bp_free_staged_reads (BP_FILE * fh)
+{
+    uint64_t i;
+
+    for (i = 0; i < fh->n_staged; i++)
+    {
+        free (fh->staged[i].data);
+    }
+    if (fh->staged)
+    {
+        free (fh->staged);
+        fh->staged = NULL;
+    }
+    fh->n_staged = 0;
+}
+
+void bp_free_prefetched_reads (BP_FILE * fh)
+{
+    uint64_t i;
+
+    for (i = 0; i < fh->n_prefetched; i++)
+    {
+        free (fh->prefetched[i].data);
+    }
+    if (fh->prefetched)
+    {
+        free (fh->prefetched);
+        fh->prefetched = NULL;
+    }
+    fh->n_prefetched = 0;
+}
+
+/* Move the current and superseded mappings of map to the list *retired */
+static void bp_retire_map (struct BP_file_map * map, struct BP_file_map ** retired)
+{
+    struct BP_file_map * old;
+
+    if (map->addr && bp_supersede_map (map))
+        return; // out of memory, unmapped with the file
+    while (map->superseded)
+    {
+        old = map->superseded;
+        map->superseded = old->superseded;
+        old->superseded = *retired;
+        *retired = old;
+    }
+}
+
+/* Move all mappings of fh, of the file and of the subfiles, to the list
+ * *retired, so that the chunks pointing into them outlive fh. The stream
+ * reader closes and reopens the file to see new steps, and unmaps the list
+ * at adios_read_close() with bp_unmap_list().
+ */
+void bp_retire_maps (BP_FILE * fh, struct BP_file_map ** retired)
+{
+    uint32_t i;
+
+    bp_retire_map (&fh->map, retired);
+    for (i = 0; i < fh->n_subfile_maps; i++)
+    {
+        bp_retire_map (&fh->subfile_maps[i], retired);
+    }
+}
+
+void unmap_all_BP_files (BP_FILE * fh)
+{
+    uint32_t i;
+
+    bp_unmap_file (&fh->map);
+    for (i = 0; i < fh->n_subfile_maps; i++)
+    {
+        bp_unmap_file (&fh->subfile_maps[i]);
+    }
+
+    if (fh->subfile_maps)
+    {
+        free (fh->subfile_maps);
+        fh->subfile_maps = NULL;
+    }
+    fh->n_subfile_maps = 0;
+}
+
 static const int MAX_HANDLES = 512;
 static void close_BP_subfile (struct BP_file_handle * sfh)
 {
@@ -467,6 +900,36 @@ void add_BP_subfile_handle (BP_FILE * fh, struct BP_file_handle * n)
     }
 }
 
+/* Return the handle of subfile file_index, opening it if it is not open yet.
+   Returns NULL if the subfile cannot be opened. */
+MPI_File * bp_open_subfile (BP_FILE * fh, uint32_t file_index)
+{
+    MPI_File * sfh = get_BP_subfile_handle (fh, file_index);
+    struct BP_file_handle * new_h;
+    char * name;
+    int err;
+
+    if (sfh)
+        return sfh;
+
+    new_h = (struct BP_file_handle *) calloc (1, sizeof (struct BP_file_handle));
+    assert (new_h);
+    new_h->file_index = file_index;
+    name = bp_get_subfile_name (fh->fname, file_index);
+    err = MPI_File_open (MPI_COMM_SELF, name, MPI_MODE_RDONLY, MPI_INFO_NULL, &new_h->fh);
+    if (err != MPI_SUCCESS)
+    {
+        adios_error (err_file_open_error, "Can not open file %s\n", name);
+        free (new_h);
+        free (name);
+        return NULL;
+    }
+    free (name);
+
+    add_BP_subfile_handle (fh, new_h);
+    return &new_h->fh;
+}
+
 void close_all_BP_subfiles (BP_FILE * fh)
 {
     BP_file_handle_list * lst = &fh->subfile_handles;
@@ -489,6 +952,10 @@ void close_all_BP_subfiles (BP_FILE * fh)
     lst->tail = NULL;
 }
 
+/* Free everything of an open file. If the shared index window is still
+ * held (shared_index with lazy_index) this is collective over the processes
+ * of the node, as freeing the window is.
+ */
 int bp_close (BP_FILE * fh)
 {
     struct BP_GROUP_VAR * gh = fh->gvar_h;
@@ -504,6 +971,9 @@ int bp_close (BP_FILE * fh)
         MPI_File_close (&mpi_fh);
 
     close_all_BP_subfiles (fh);
+    unmap_all_BP_files (fh);
+    bp_free_staged_reads (fh);
+    bp_free_prefetched_reads (fh); // the reads in progress were waited for by the read method
 
     if (fh->b) {
         adios_posix_close_internal (fh->b);
@@ -516,7 +986,8 @@ int bp_close (BP_FILE * fh)
     while (vars_root) {
         vr = vars_root;
         vars_root = vars_root->next;
-        for (j = 0; j < vr->characteristics_count; j++) {
+        // characteristics are NULL if they were never decoded (lazy_index)
+        for (j = 0; vr->characteristics && j < vr->characteristics_count; j++) {
             // alloc in bp_utils.c:bp_parse_characteristics() <- bp_get_characteristics_data()
             if (vr->characteristics[j].dims.dims)
                 free (vr->characteristics[j].dims.dims);
@@ -578,6 +1049,35 @@ int bp_close (BP_FILE * fh)
         fh->vars_table = 0;
     }
 
+    if (fh->var_columns)
+    {
+        for (i = 0; i < fh->mfooter.vars_count; i++)
+            bp_free_var_columns (fh->var_columns[i]);
+        free (fh->var_columns);
+        fh->var_columns = 0;
+    }
+
+    if (fh->vars_index)
+    {
+        if (!fh->vars_index_shared)
+            free (fh->vars_index);
+        fh->vars_index = 0;
+    }
+
+#if BP_SHARED_INDEX
+    // collective over the node communicator the window was created on
+    if (fh->index_win != MPI_WIN_NULL)
+    {
+        MPI_Win_free (&fh->index_win);
+    }
+#endif
+
+    if (fh->vars_index_offsets)
+    {
+        free (fh->vars_index_offsets);
+        fh->vars_index_offsets = 0;
+    }
+
     /* Free attributes structures */
     /* alloc in bp_utils.c bp_parse_attrs() */
     while (attrs_root) {
@@ -692,11 +1192,474 @@ int bp_close (BP_FILE * fh)
         free (fh->fname);
         fh->fname = 0;
     }
-
-    if (fh)
-        free (fh);
-
-    return 0;
+
+    bp_free_stream_state (fh->stream);
+    fh->stream = 0;
+
+    if (fh)
+        free (fh);
+
+    return 0;
+}
+
+/* Files written with a chained index (ADIOS_VERSION_HAVE_CHAINED_INDEX)
+ * have one index per output step: each step appended its process groups,
+ * then the index of only these process groups, the end offset of the
+ * previous step's footer (8 bytes, 0 in the first step) and the usual
+ * 28+28 bytes of footer. The first index of a chain can also be the
+ * complete index of a file written without chaining before the appends.
+ * The reader follows the chain back from the last footer and merges the
+ * indexes into one index in the usual layout, which is then parsed as
+ * the footer of the file. Opening a file reads every index of the chain,
+ * one read per step; only a stream keeps the indexes read at its previous
+ * open (bp_chain_cache), since a file rewritten with the same layout could
+ * not be told apart from the cached one.
+ * The MPI methods read the whole chain with adios_read_chained_index_v1()
+ * when appending and write a merged index, which ends the chain.
+ */
+struct bp_chain_link
+{
+    char * buff;            // from the PG index to the end of the footer
+    uint64_t size;          // size of buff
+    uint64_t vars_offset;   // offset of the vars index in buff
+    uint64_t attrs_offset;  // offset of the attributes index in buff
+    uint32_t * ids [2];     // position of each variable/attribute in the merged index
+};
+
+/* The links read at the last open of a stream, newest first, the newest
+ * one ending at 'end'. At the next open only the links after 'end' are read
+ * from the file, so each new step costs the size of its own index. */
+struct bp_chain_cache
+{
+    struct bp_chain_link * links;
+    int nlinks;
+    uint64_t end;
+};
+
+static void bp_chain_cache_clear (struct bp_chain_cache * cache)
+{
+    int l;
+    for (l = 0; l < cache->nlinks; l++)
+    {
+        free (cache->links [l].buff);
+    }
+    free (cache->links);
+    cache->links = 0;
+    cache->nlinks = 0;
+    cache->end = 0;
+}
+
+struct BP_stream_state * bp_alloc_stream_state ()
+{
+    struct BP_stream_state * s = (struct BP_stream_state *) calloc (1, sizeof (struct BP_stream_state));
+    assert (s);
+    s->notify_fd = -1;
+    return s;
+}
+
+void bp_free_stream_state (struct BP_stream_state * s)
+{
+    if (!s)
+        return;
+    if (s->notify_fd != -1)
+    {
+        close (s->notify_fd);
+    }
+    if (s->chain)
+    {
+        bp_chain_cache_clear (s->chain);
+        free (s->chain);
+    }
+    free (s);
+}
+
+/* A variable or attribute in the merged index */
+struct bp_chain_entry
+{
+    const char * header;    // id, group, name, path and type where it first appears
+    uint32_t header_size;
+    uint64_t characteristics_count;
+    uint64_t characteristics_size;
+    char * next;            // where the next characteristics go in the merged index
+};
+
+static void bp_chain_write (char ** p, const void * value, int size, enum ADIOS_FLAG swap)
+{
+    memcpy (*p, value, size);
+    if (swap == adios_flag_yes)
+        swap_ptr (*p, size * 8);
+    *p += size;
+}
+
+/* Parse the header of the variable/attribute at lb->offset and advance
+ * lb->offset to its characteristics. Returns the size of the entry
+ * (without its length field). If key is not NULL, it is set to a new
+ * string "group\npath/name". */
+static uint32_t bp_chain_parse_entry (struct adios_bp_buffer_struct_v1 * lb,
+                                      uint32_t * header_size, uint64_t * count,
+                                      char ** key)
+{
+    uint32_t size;
+    uint16_t len [3];
+    const char * str [3];
+    uint64_t start;
+    int i;
+
+    BUFREAD32(lb, size)
+    start = lb->offset;
+    lb->offset += 4; // id
+    for (i = 0; i < 3; i++) // group, name, path
+    {
+        BUFREAD16(lb, len [i])
+        str [i] = lb->buff + lb->offset;
+        lb->offset += len [i];
+    }
+    lb->offset += 1; // type
+    *header_size = lb->offset - start;
+    BUFREAD64(lb, *count)
+
+    if (key)
+    {
+        *key = (char *) malloc (len [0] + len [1] + len [2] + 3);
+        sprintf (*key, "%.*s\n%.*s/%.*s", len [0], str [0], len [2], str [2], len [1], str [1]);
+    }
+    return size;
+}
+
+/* Collect the variables (a = 0) or attributes (a = 1) of all indexes of the
+ * chain (oldest first) in the order of their first appearance.
+ * Returns the size of the merged index without its count and length. */
+static uint64_t bp_chain_collect (struct bp_chain_link * links, int nlinks, int a,
+                                  enum ADIOS_FLAG change_endianness,
+                                  struct bp_chain_entry ** entries, uint32_t * nentries)
+{
+    struct adios_bp_buffer_struct_v1 lb;
+    qhashtbl_t * tbl = qhashtbl (1024);
+    uint64_t size = 0;
+    uint32_t n = 0, nalloc = 0;
+    int l;
+
+    adios_buffer_struct_init (&lb);
+    lb.change_endianness = change_endianness;
+    *entries = 0;
+
+    for (l = nlinks - 1; l >= 0; l--)
+    {
+        uint32_t count, k;
+        uint64_t length;
+
+        lb.buff = links [l].buff;
+        lb.offset = (a ? links [l].attrs_offset : links [l].vars_offset);
+        BUFREAD32((&lb), count)
+        BUFREAD64((&lb), length)
+        links [l].ids [a] = (uint32_t *) malloc ((count ? count : 1) * sizeof (uint32_t));
+        assert (links [l].ids [a]);
+
+        for (k = 0; k < count; k++)
+        {
+            uint64_t entry_start = lb.offset + 4, ccount;
+            uint32_t header_size, esize;
+            struct bp_chain_entry * e;
+            char * key;
+            intptr_t id;
+
+            esize = bp_chain_parse_entry (&lb, &header_size, &ccount, &key);
+            id = (intptr_t) tbl->get (tbl, key);
+            if (!id)
+            {
+                if (n == nalloc)
+                {
+                    nalloc = (nalloc ? 2 * nalloc : 1024);
+                    *entries = (struct bp_chain_entry *) realloc (*entries,
+                                            nalloc * sizeof (struct bp_chain_entry));
+                    assert (*entries);
+                }
+                e = &(*entries) [n];
+                e->header = links [l].buff + entry_start;
+                e->header_size = header_size;
+                e->characteristics_count = 0;
+                e->characteristics_size = 0;
+                id = ++n;
+                tbl->put (tbl, key, (void *) id);
+                size += 4 + header_size + 8;
+            }
+            free (key);
+
+            e = &(*entries) [id - 1];
+            e->characteristics_count += ccount;
+            e->characteristics_size += esize - header_size - 8;
+            size += esize - header_size - 8;
+            links [l].ids [a][k] = id - 1;
+            lb.offset = entry_start + esize;
+        }
+    }
+
+    tbl->free (tbl);
+    *nentries = n;
+    return size;
+}
+
+/* Write the merged variables (a = 0) or attributes (a = 1) index at *p */
+static void bp_chain_merge (struct bp_chain_link * links, int nlinks, int a,
+                            enum ADIOS_FLAG change_endianness,
+                            struct bp_chain_entry * entries, uint32_t nentries,
+                            uint64_t size, char ** p)
+{
+    struct adios_bp_buffer_struct_v1 lb;
+    // like the writer, the length of the index does not count the length fields of the entries
+    uint64_t length = size - 4 * (uint64_t) nentries;
+    uint32_t k;
+    int l;
+
+    bp_chain_write (p, &nentries, 4, change_endianness);
+    bp_chain_write (p, &length, 8, change_endianness);
+    for (k = 0; k < nentries; k++)
+    {
+        struct bp_chain_entry * e = &entries [k];
+        uint32_t esize = e->header_size + 8 + e->characteristics_size;
+        bp_chain_write (p, &esize, 4, change_endianness);
+        memcpy (*p, e->header, e->header_size);
+        *p += e->header_size;
+        bp_chain_write (p, &e->characteristics_count, 8, change_endianness);
+        e->next = *p;
+        *p += e->characteristics_size;
+    }
+
+    // append the characteristics of each index, oldest first
+    adios_buffer_struct_init (&lb);
+    lb.change_endianness = change_endianness;
+    for (l = nlinks - 1; l >= 0; l--)
+    {
+        uint32_t count;
+        uint64_t ilength;
+
+        lb.buff = links [l].buff;
+        lb.offset = (a ? links [l].attrs_offset : links [l].vars_offset);
+        BUFREAD32((&lb), count)
+        BUFREAD64((&lb), ilength)
+
+        for (k = 0; k < count; k++)
+        {
+            uint64_t entry_start = lb.offset + 4, ccount;
+            uint32_t header_size, esize, csize;
+            struct bp_chain_entry * e = &entries [links [l].ids [a][k]];
+
+            esize = bp_chain_parse_entry (&lb, &header_size, &ccount, NULL);
+            csize = esize - header_size - 8;
+            memcpy (e->next, lb.buff + lb.offset, csize);
+            e->next += csize;
+            lb.offset = entry_start + esize;
+        }
+    }
+}
+
+/* Read all indexes of a file with a chained index and merge them into b->buff.
+ * The merged index is given offsets in the minifooter as if it were at the
+ * end of the file, so that its size is file_size - pgs_index_offset. */
+static int bp_read_chained_index (BP_FILE * bp_struct)
+{
+    struct adios_bp_buffer_struct_v1 * b = bp_struct->b;
+    struct bp_minifooter * mh = &bp_struct->mfooter;
+    struct adios_bp_buffer_struct_v1 lb;
+    struct bp_chain_link * links = 0;
+    struct bp_chain_entry * entries [2] = {0, 0};
+    struct bp_chain_cache * cache = (bp_struct->stream ? bp_struct->stream->chain : 0);
+    uint32_t nentries [2];
+    uint64_t end = mh->file_size;
+    uint64_t pgs_count = 0, pgs_length = 0, sizes [2], total;
+    char footer [MINIFOOTER_SIZE];
+    char * p;
+    int nlinks = 0, ncached = 0, l, a, err = 0;
+    MPI_Status status;
+
+    adios_buffer_struct_init (&lb);
+
+    // follow the chain back from the last footer
+    while (end)
+    {
+        uint64_t pgs_offset, vars_offset, attrs_offset, prev_end = 0;
+        uint32_t version;
+
+        if (cache && cache->nlinks && end == cache->end)
+        {
+            // the rest of the chain was read at the last open, unless the file was rewritten
+            struct bp_chain_link * newest = &cache->links [0];
+            MPI_File_seek (bp_struct->mpi_fh, (MPI_Offset) end - MINIFOOTER_SIZE, MPI_SEEK_SET);
+            MPI_File_read (bp_struct->mpi_fh, footer, MINIFOOTER_SIZE, MPI_BYTE, &status);
+            if (!memcmp (footer, newest->buff + newest->size - MINIFOOTER_SIZE, MINIFOOTER_SIZE))
+            {
+                links = (struct bp_chain_link *) realloc (links,
+                                (nlinks + cache->nlinks) * sizeof (struct bp_chain_link));
+                assert (links);
+                memcpy (links + nlinks, cache->links, cache->nlinks * sizeof (struct bp_chain_link));
+                nlinks += cache->nlinks;
+                ncached = cache->nlinks;
+                free (cache->links);
+                cache->links = 0;
+                cache->nlinks = 0;
+                break;
+            }
+            bp_chain_cache_clear (cache);
+        }
+
+        if (end < 2 * MINIFOOTER_SIZE)
+        {
+            err = 1;
+            break;
+        }
+        MPI_File_seek (bp_struct->mpi_fh, (MPI_Offset) end - MINIFOOTER_SIZE, MPI_SEEK_SET);
+        MPI_File_read (bp_struct->mpi_fh, footer, MINIFOOTER_SIZE, MPI_BYTE, &status);
+        lb.buff = footer;
+        lb.length = MINIFOOTER_SIZE;
+        lb.offset = MINIFOOTER_SIZE - 4;
+        adios_parse_version (&lb, &version);
+        lb.offset = 0;
+        BUFREAD64((&lb), pgs_offset)
+        BUFREAD64((&lb), vars_offset)
+        BUFREAD64((&lb), attrs_offset)
+        if (lb.change_endianness != mh->change_endianness ||
+            (version & ADIOS_VERSION_NUM_MASK) < 2 ||
+            (version & ADIOS_VERSION_NUM_MASK) > ADIOS_VERSION_BP_FORMAT ||
+            pgs_offset >= vars_offset || vars_offset >= attrs_offset ||
+            attrs_offset + 2 * MINIFOOTER_SIZE > end)
+        {
+            err = 1;
+            break;
+        }
+
+        links = (struct bp_chain_link *) realloc (links, (nlinks + 1) * sizeof (struct bp_chain_link));
+        assert (links);
+        links [nlinks].buff = (char *) malloc (end - pgs_offset);
+        if (!links [nlinks].buff)
+        {
+            adios_error (err_no_memory, "could not allocate %" PRIu64 " bytes\n", end - pgs_offset);
+            err = 2;
+            break;
+        }
+        links [nlinks].size = end - pgs_offset;
+        links [nlinks].vars_offset = vars_offset - pgs_offset;
+        links [nlinks].attrs_offset = attrs_offset - pgs_offset;
+        links [nlinks].ids [0] = links [nlinks].ids [1] = 0;
+        nlinks++;
+        MPI_File_seek (bp_struct->mpi_fh, (MPI_Offset) pgs_offset, MPI_SEEK_SET);
+        MPI_File_read (bp_struct->mpi_fh, links [nlinks-1].buff, end - pgs_offset, MPI_BYTE, &status);
+
+        if (version & ADIOS_VERSION_HAVE_CHAINED_INDEX)
+        {
+            lb.buff = links [nlinks-1].buff;
+            lb.offset = end - pgs_offset - 2 * MINIFOOTER_SIZE - 8;
+            BUFREAD64((&lb), prev_end)
+            if (prev_end > pgs_offset)
+            {
+                err = 1;
+                break;
+            }
+        }
+        end = prev_end;
+    }
+
+    if (!err)
+    {
+        // process groups: the entries of all indexes, oldest first
+        for (l = nlinks - 1; l >= 0; l--)
+        {
+            uint64_t count;
+            lb.buff = links [l].buff;
+            lb.offset = 0;
+            BUFREAD64((&lb), count)
+            pgs_count += count;
+            pgs_length += links [l].vars_offset - 16;
+        }
+        for (a = 0; a < 2; a++)
+        {
+            sizes [a] = bp_chain_collect (links, nlinks, a, mh->change_endianness,
+                                          &entries [a], &nentries [a]);
+        }
+
+        total = 16 + pgs_length + 12 + sizes [0] + 12 + sizes [1];
+        if (total > mh->file_size)
+        {
+            err = 1;
+        }
+    }
+
+    if (!err)
+    {
+        bp_realloc_aligned (b, total);
+        if (!b->buff)
+        {
+            err = 2;
+        }
+    }
+
+    if (!err)
+    {
+        p = b->buff;
+        // PG index length is the size of its entries, see adios_write_index_v1()
+        bp_chain_write (&p, &pgs_count, 8, mh->change_endianness);
+        bp_chain_write (&p, &pgs_length, 8, mh->change_endianness);
+        for (l = nlinks - 1; l >= 0; l--)
+        {
+            memcpy (p, links [l].buff + 16, links [l].vars_offset - 16);
+            p += links [l].vars_offset - 16;
+        }
+        for (a = 0; a < 2; a++)
+        {
+            bp_chain_merge (links, nlinks, a, mh->change_endianness,
+                            entries [a], nentries [a], sizes [a], &p);
+        }
+
+        mh->pgs_index_offset = mh->file_size - total;
+        mh->vars_index_offset = mh->pgs_index_offset + 16 + pgs_length;
+        mh->attrs_index_offset = mh->vars_index_offset + 12 + sizes [0];
+        b->pg_index_offset = mh->pgs_index_offset;
+        b->vars_index_offset = mh->vars_index_offset;
+        b->attrs_index_offset = mh->attrs_index_offset;
+        b->end_of_pgs = b->pg_index_offset;
+        b->pg_size = b->vars_index_offset - b->pg_index_offset;
+        b->vars_size = b->attrs_index_offset - b->vars_index_offset;
+        b->attrs_size = mh->file_size - b->attrs_index_offset;
+        b->offset = 0;
+        log_debug ("BP file with a chained index: merged %d indexes (%d read before) "
+                   "into %" PRIu64 " bytes\n", nlinks, ncached, total);
+    }
+    else if (err == 1)
+    {
+        adios_error (err_file_open_error,
+                "Invalid BP file detected. The chained index is corrupt at offset %" PRIu64
+                ". File size is (%" PRIu64 ")\n", end, mh->file_size);
+    }
+
+    for (l = 0; l < nlinks; l++)
+    {
+        free (links [l].ids [0]);
+        free (links [l].ids [1]);
+        links [l].ids [0] = links [l].ids [1] = 0;
+    }
+    if (bp_struct->stream && !err)
+    {
+        // keep the links for the next open of the stream
+        if (!cache)
+        {
+            cache = (struct bp_chain_cache *) calloc (1, sizeof (struct bp_chain_cache));
+            bp_struct->stream->chain = cache;
+        }
+        bp_chain_cache_clear (cache);
+        cache->links = links;
+        cache->nlinks = nlinks;
+        cache->end = mh->file_size;
+    }
+    else
+    {
+        for (l = 0; l < nlinks; l++)
+        {
+            free (links [l].buff);
+        }
+        free (links);
+    }
+    free (entries [0]);
+    free (entries [1]);
+    return (err ? 1 : 0);
 }
 
 int bp_read_minifooter (BP_FILE * bp_struct)
@@ -740,6 +1703,10 @@ int bp_read_minifooter (BP_FILE * bp_struct)
         return 1;
     }
 
+    if (mh->version & ADIOS_VERSION_HAVE_CHAINED_INDEX) {
+        return bp_read_chained_index (bp_struct);
+    }
+
     b->offset = 0; // reset offset to beginning
 
     BUFREAD64(b, b->pg_index_offset)
@@ -1314,6 +2281,202 @@ int bp_parse_attrs (BP_FILE * fh)
 /*******************/
 /* Parse VARIABLES */
 /*******************/
+/* Parse the characteristics sets of one variable from b.
+ * b->offset must point to the first characteristics set.
+ */
+static void bp_parse_var_characteristics (BP_FILE * fh,
+                                          struct adios_bp_buffer_struct_v1 * b,
+                                          struct adios_index_var_struct_v1 * v)
+{
+    struct bp_minifooter * mh = &(fh->mfooter);
+    uint64_t j;
+
+    // validate remaining length: offsets_count *
+    // (8 + 2 * (size of type))
+    v->characteristics = malloc (v->characteristics_count
+        * sizeof (struct adios_index_characteristic_struct_v1)
+        );
+    memset (v->characteristics, 0
+        ,  v->characteristics_count
+        * sizeof (struct adios_index_characteristic_struct_v1)
+           );
+    // NOTE: Above memset assumes that all 0's is a valid initialization.
+    //       This is true, currently, but be careful in the future.
+
+    for (j = 0; j < v->characteristics_count; j++)
+    {
+        uint8_t characteristic_set_count;
+        uint32_t characteristic_set_length;
+        uint8_t item = 0;
+
+        BUFREAD8(b, characteristic_set_count)
+        BUFREAD32(b, characteristic_set_length)
+
+        while (item < characteristic_set_count) {
+            bp_parse_characteristics (b, &v, j);
+            item++;
+        }
+
+        /* Old BP files do not have time_index characteristics, so we
+           set it here automatically: j div # of pgs per timestep
+           Assumed that in old BP files, all pgs write each variable in each timestep.*/
+        if (v->characteristics [j].time_index == 0) {
+            v->characteristics [j].time_index =
+                 j / (mh->pgs_count / (fh->tidx_stop - fh->tidx_start + 1)) + 1;
+            /*printf("OldBP: var %s time_index set to %d\n",
+                    v->var_name,
+                    v->characteristics [j].time_index);*/
+        }
+    }
+}
+
+/* Decode the characteristics of variable 'varid' from the copy of the
+ * variables index kept by bp_parse_vars() in lazy mode.
+ */
+static void bp_decode_var_byid (BP_FILE * fh, int varid)
+{
+    struct adios_bp_buffer_struct_v1 b;
+
+    if (!fh->vars_index_offsets || !fh->vars_index_offsets[varid])
+        return;
+
+    memset (&b, 0, sizeof (struct adios_bp_buffer_struct_v1));
+    b.buff = fh->vars_index;
+    b.offset = fh->vars_index_offsets[varid];
+    b.change_endianness = fh->b->change_endianness;
+
+    bp_parse_var_characteristics (fh, &b, fh->vars_table[varid]);
+    fh->vars_index_offsets[varid] = 0;
+}
+
+/* Release the copy of the variables index when nothing is left to decode */
+static void bp_release_vars_index (BP_FILE * fh)
+{
+    if (!fh->vars_index_shared)
+        free (fh->vars_index);
+    fh->vars_index = 0;
+    free (fh->vars_index_offsets);
+    fh->vars_index_offsets = 0;
+}
+
+#if HAVE_PTHREAD
+struct bp_decode_vars_range
+{
+    BP_FILE * fh;
+    int start;
+    int stop;
+};
+
+static void * bp_decode_vars_thread (void * arg)
+{
+    struct bp_decode_vars_range * range = (struct bp_decode_vars_range *) arg;
+    int i;
+
+    for (i = range->start; i < range->stop; i++)
+    {
+        bp_decode_var_byid (range->fh, i);
+    }
+
+    return NULL;
+}
+#endif
+
+/* Decode the characteristics of all variables which are not decoded yet.
+ * With 'nthreads' > 1 (and pthreads available), the variables are split
+ * into contiguous ranges which are decoded concurrently.
+ */
+void bp_decode_all_vars (BP_FILE * fh, int nthreads)
+{
+    int nvars = fh->mfooter.vars_count;
+    int i;
+
+    if (!fh->vars_index_offsets)
+        return;
+
+#if HAVE_PTHREAD
+    if (nthreads > nvars)
+        nthreads = nvars;
+
+    if (nthreads > 1)
+    {
+        pthread_t * threads = (pthread_t *) malloc (nthreads * sizeof (pthread_t));
+        struct bp_decode_vars_range * ranges = (struct bp_decode_vars_range *)
+                              malloc (nthreads * sizeof (struct bp_decode_vars_range));
+        int started = 0;
+
+        for (i = 0; i < nthreads; i++)
+        {
+            ranges[i].fh = fh;
+            ranges[i].start = (int) ((int64_t) nvars * i / nthreads);
+            ranges[i].stop = (int) ((int64_t) nvars * (i + 1) / nthreads);
+        }
+
+        // the calling thread takes the first range
+        for (i = 1; i < nthreads; i++)
+        {
+            if (pthread_create (&threads[i], NULL, bp_decode_vars_thread, &ranges[i]))
+            {
+                log_warn ("Could not create index decoding thread, "
+                          "decoding the rest of the index serially\n");
+                break;
+            }
+            started = i;
+        }
+
+        bp_decode_vars_thread (&ranges[0]);
+
+        for (i = 1; i <= started; i++)
+        {
+            pthread_join (threads[i], NULL);
+        }
+
+        free (threads);
+        free (ranges);
+    }
+#endif
+
+    // serial case, or whatever is left after a failed thread creation
+    for (i = 0; i < nvars; i++)
+    {
+        bp_decode_var_byid (fh, i);
+    }
+
+    fh->vars_pending = 0;
+    bp_release_vars_index (fh);
+}
+
+/* Decode one variable on first access (lazy_index) */
+static void bp_decode_pending_var (BP_FILE * fh, int varid)
+{
+    if (fh->vars_index_offsets && fh->vars_index_offsets[varid])
+    {
+        bp_decode_var_byid (fh, varid);
+        if (--fh->vars_pending == 0)
+            bp_release_vars_index (fh);
+    }
+}
+
+/* Make sure the characteristics of variable 'v' are decoded (lazy_index).
+ * Use it when 'v' was found by walking fh->vars_root instead of
+ * bp_find_var_byid().
+ */
+void bp_decode_var (BP_FILE * fh, struct adios_index_var_struct_v1 * v)
+{
+    int i;
+
+    if (!fh->vars_index_offsets)
+        return;
+
+    for (i = 0; i < fh->mfooter.vars_count; i++)
+    {
+        if (fh->vars_table[i] == v)
+        {
+            bp_decode_pending_var (fh, i);
+            break;
+        }
+    }
+}
+
 int bp_parse_vars (BP_FILE * fh)
 {
     struct adios_bp_buffer_struct_v1 * b = fh->b;
@@ -1322,6 +2485,7 @@ int bp_parse_vars (BP_FILE * fh)
 
     struct adios_index_var_struct_v1 ** root;
     int bpversion = mh->version & ADIOS_VERSION_NUM_MASK;
+    uint64_t vars_start;
 
     if (b->length - b->offset < VARS_MINIHEADER_SIZE) {
         adios_error (err_invalid_buffer,
@@ -1344,6 +2508,33 @@ int bp_parse_vars (BP_FILE * fh)
 
     // To speed find_var_byid(). Q. Liu, 11-2013.
     fh->vars_table = (struct adios_index_var_struct_v1 **) malloc (8*(size_t)mh->vars_count);
+
+    /* In lazy mode (and for the threaded decoding), only the variable headers
+       are parsed here. The variables index is kept and the characteristics of
+       each variable are decoded later from there. */
+    vars_start = b->offset;
+    if ((fh->lazy_index || fh->index_threads > 1) && mh->vars_count > 0)
+    {
+        uint64_t vars_end = mh->attrs_index_offset - mh->pgs_index_offset;
+        if (vars_end <= vars_start || vars_end > b->length)
+            vars_end = b->length;
+
+        if (fh->vars_index_shared)
+        {
+            // the footer stays in the node's shared memory window
+            fh->vars_index = b->buff + vars_start;
+        }
+        else
+        {
+            fh->vars_index = (char *) malloc (vars_end - vars_start);
+            assert (fh->vars_index);
+            memcpy (fh->vars_index, b->buff + vars_start, vars_end - vars_start);
+        }
+        fh->vars_index_offsets = (uint64_t *) calloc (mh->vars_count, sizeof (uint64_t));
+        assert (fh->vars_index_offsets);
+        fh->vars_pending = mh->vars_count;
+    }
+
     // validate remaining length
     int i;
     for (i = 0; i < mh->vars_count; i++) {
@@ -1357,6 +2548,7 @@ int bp_parse_vars (BP_FILE * fh)
         uint32_t var_entry_length;
         uint16_t len;
         uint64_t characteristics_sets_count;
+        uint64_t var_entry_start = b->offset;
 
         BUFREAD32(b, var_entry_length)
         if (bpversion > 1) {
@@ -1390,47 +2582,25 @@ int bp_parse_vars (BP_FILE * fh)
         (*root)->characteristics_count = characteristics_sets_count;
         (*root)->characteristics_allocated = characteristics_sets_count;
 
-        // validate remaining length: offsets_count *
-        // (8 + 2 * (size of type))
-        (*root)->characteristics = malloc (characteristics_sets_count
-            * sizeof (struct adios_index_characteristic_struct_v1)
-            );
-        memset ((*root)->characteristics, 0
-            ,  characteristics_sets_count
-            * sizeof (struct adios_index_characteristic_struct_v1)
-               );
-        // NOTE: Above memset assumes that all 0's is a valid initialization.
-        //       This is true, currently, but be careful in the future.
-
-        uint64_t j;
-        for (j = 0; j < characteristics_sets_count; j++)
+        if (fh->vars_index_offsets)
         {
-            uint8_t characteristic_set_count;
-            uint32_t characteristic_set_length;
-            uint8_t item = 0;
-
-            BUFREAD8(b, characteristic_set_count)
-            BUFREAD32(b, characteristic_set_length)
-
-            while (item < characteristic_set_count) {
-                bp_parse_characteristics (b, root, j);
-                item++;
-            }
-
-            /* Old BP files do not have time_index characteristics, so we
-               set it here automatically: j div # of pgs per timestep
-               Assumed that in old BP files, all pgs write each variable in each timestep.*/
-            if ((*root)->characteristics [j].time_index == 0) {
-                (*root)->characteristics [j].time_index =
-                     j / (mh->pgs_count / (fh->tidx_stop - fh->tidx_start + 1)) + 1;
-                /*printf("OldBP: var %s time_index set to %d\n",
-                        (*root)->var_name,
-                        (*root)->characteristics [j].time_index);*/
-            }
+            // remember where the characteristics are and skip them
+            (*root)->characteristics = 0;
+            fh->vars_index_offsets[i] = b->offset - vars_start;
+            b->offset = var_entry_start + 4 + var_entry_length;
+        }
+        else
+        {
+            bp_parse_var_characteristics (fh, b, *root);
         }
         root = &(*root)->next;
     }
 
+    if (fh->vars_index_offsets && !fh->lazy_index)
+    {
+        bp_decode_all_vars (fh, fh->index_threads);
+    }
+
     root = vars_root;
     uint32_t * var_counts_per_group;
     uint16_t *  var_gids;
@@ -1495,10 +2665,13 @@ int bp_parse_vars (BP_FILE * fh)
         }
         //printf ("Variable %d full path is [%s]\n", i, var_namelist[i]);
 
-        var_offsets[i] = (uint64_t *) malloc (
-                sizeof(uint64_t)*(*root)->characteristics_count);
-        for (j=0;j < (*root)->characteristics_count;j++) {
-            var_offsets[i][j] = (*root)->characteristics [j].offset;
+        // not available for variables which are not decoded yet (lazy_index)
+        if ((*root)->characteristics) {
+            var_offsets[i] = (uint64_t *) malloc (
+                    sizeof(uint64_t)*(*root)->characteristics_count);
+            for (j=0;j < (*root)->characteristics_count;j++) {
+                var_offsets[i][j] = (*root)->characteristics [j].offset;
+            }
         }
 
         //struct adios_index_characteristic_dims_struct_v1 * pdims;
@@ -1949,6 +3122,8 @@ int bp_seek_to_step (ADIOS_FILE * fp, int tostep, int show_hidden_attrs)
     else
     {
         allstep = 0;
+        // the time index of every variable is needed below
+        bp_decode_all_vars (fh, fh->index_threads);
         t = get_time (var_root, tostep);
     }
 
@@ -3111,10 +4286,315 @@ struct adios_index_var_struct_v1 * bp_find_var_byid (BP_FILE * fh, int varid)
         return NULL;
     }
 */
+    bp_decode_pending_var (fh, varid);
     return fh->vars_table[varid];
  //   return var_root;
 }
 
+struct bp_block_by_start
+{
+    uint64_t start;
+    uint64_t block;
+};
+
+static int compare_block_by_start (const void * a, const void * b)
+{
+    const struct bp_block_by_start * x = (const struct bp_block_by_start *) a;
+    const struct bp_block_by_start * y = (const struct bp_block_by_start *) b;
+
+    if (x->start != y->start)
+        return (x->start < y->start ? -1 : 1);
+    return (x->block < y->block ? -1 : (x->block > y->block));
+}
+
+static int compare_uint64 (const void * a, const void * b)
+{
+    uint64_t x = *(const uint64_t *) a, y = *(const uint64_t *) b;
+    return (x < y ? -1 : (x > y));
+}
+
+/* Fill the time index tables of the columns and order the blocks of each
+ * time index by start in the slowest dimension. The tables are left empty
+ * (ntimes = 0) if the time indices are spread over more values than there
+ * are blocks; the lookups then scan the blocks.
+ */
+static void bp_build_columns_time_tables (struct BP_var_columns * c)
+{
+    struct bp_block_by_start * sorted;
+    uint32_t max_time;
+    uint64_t i, t, b, n;
+
+    if (c->nblocks == 0)
+        return;
+
+    c->min_time = max_time = c->time_index[0];
+    for (i = 1; i < c->nblocks; i++)
+    {
+        if (c->time_index[i] < c->min_time)
+            c->min_time = c->time_index[i];
+        if (c->time_index[i] > max_time)
+            max_time = c->time_index[i];
+    }
+    if ((uint64_t) max_time - c->min_time + 1 > c->nblocks)
+        return;
+
+    c->ntimes = max_time - c->min_time + 1;
+    c->time_first = (int64_t *) malloc (c->ntimes * sizeof (int64_t));
+    c->time_last = (int64_t *) malloc (c->ntimes * sizeof (int64_t));
+    c->max_count = (uint64_t *) calloc (c->ntimes, sizeof (uint64_t));
+    c->by_start = (uint64_t *) malloc (c->nblocks * sizeof (uint64_t));
+    sorted = (struct bp_block_by_start *) malloc (c->nblocks * sizeof (struct bp_block_by_start));
+    assert (c->time_first && c->time_last && c->max_count && c->by_start && sorted);
+
+    for (t = 0; t < c->ntimes; t++)
+    {
+        c->time_first[t] = c->time_last[t] = -1;
+    }
+    for (i = 0; i < c->nblocks; i++)
+    {
+        t = c->time_index[i] - c->min_time;
+        if (c->time_first[t] < 0)
+            c->time_first[t] = i;
+        c->time_last[t] = i;
+    }
+
+    // the range of a time index is what get_var_start/stop_index() return,
+    // blocks of other time indices within it are kept in it like there
+    for (t = 0; t < c->ntimes; t++)
+    {
+        if (c->time_first[t] < 0)
+            continue;
+        n = 0;
+        for (b = c->time_first[t]; b <= (uint64_t) c->time_last[t]; b++, n++)
+        {
+            sorted[n].start = (c->ndim > 0 ? c->start[b * c->ndim] : 0);
+            sorted[n].block = b;
+            if (c->ndim > 0 && c->count[b * c->ndim] > c->max_count[t])
+                c->max_count[t] = c->count[b * c->ndim];
+        }
+        qsort (sorted, n, sizeof (struct bp_block_by_start), compare_block_by_start);
+        for (i = 0; i < n; i++)
+        {
+            c->by_start[c->time_first[t] + i] = sorted[i].block;
+        }
+    }
+    free (sorted);
+}
+
+/* Build the columnar block index of a variable from its characteristics */
+struct BP_var_columns * bp_build_var_columns (struct adios_index_var_struct_v1 * v,
+                                              int file_is_fortran)
+{
+    struct BP_var_columns * c;
+    uint64_t ldims[32], gdims[32], offsets[32];
+    uint64_t i, n = v->characteristics_count;
+    int j, ndim, has_time = 0;
+
+    c = (struct BP_var_columns *) calloc (1, sizeof (struct BP_var_columns));
+    assert (c);
+
+    // the time dimension (if any) is not part of the block dimensions
+    ndim = 0;
+    if (n > 0)
+    {
+        ndim = v->characteristics[0].dims.count;
+        bp_get_dimension_generic_notime (&v->characteristics[0].dims, ldims, gdims, offsets,
+                                         file_is_fortran, &has_time);
+        if (has_time)
+            ndim--;
+    }
+
+    c->nblocks = n;
+    c->ndim = ndim;
+    c->offset = (uint64_t *) malloc (n * sizeof (uint64_t));
+    c->payload_offset = (uint64_t *) malloc (n * sizeof (uint64_t));
+    c->time_index = (uint32_t *) malloc (n * sizeof (uint32_t));
+    c->file_index = (uint32_t *) malloc (n * sizeof (uint32_t));
+    c->is_global = (uint8_t *) malloc (n * sizeof (uint8_t));
+    c->count = (uint64_t *) calloc (n * ndim + 1, sizeof (uint64_t));
+    c->start = (uint64_t *) calloc (n * ndim + 1, sizeof (uint64_t));
+    c->gdims = (uint64_t *) calloc (n * ndim + 1, sizeof (uint64_t));
+
+    for (i = 0; i < n; i++)
+    {
+        struct adios_index_characteristic_struct_v1 * ch = &v->characteristics[i];
+
+        c->offset[i] = ch->offset;
+        c->payload_offset[i] = ch->payload_offset;
+        c->time_index[i] = ch->time_index;
+        c->file_index[i] = ch->file_index;
+
+        c->is_global[i] = (uint8_t) bp_get_dimension_characteristics_notime (ch,
+                                            ldims, gdims, offsets, file_is_fortran);
+        for (j = 0; j < ndim; j++)
+        {
+            c->count[i * ndim + j] = ldims[j];
+            c->start[i * ndim + j] = offsets[j];
+            c->gdims[i * ndim + j] = gdims[j];
+        }
+    }
+
+    bp_build_columns_time_tables (c);
+
+    return c;
+}
+
+void bp_free_var_columns (struct BP_var_columns * c)
+{
+    if (!c)
+        return;
+
+    free (c->offset);
+    free (c->payload_offset);
+    free (c->time_index);
+    free (c->file_index);
+    free (c->is_global);
+    free (c->count);
+    free (c->start);
+    free (c->gdims);
+    free (c->time_first);
+    free (c->time_last);
+    free (c->max_count);
+    free (c->by_start);
+    free (c);
+}
+
+/* Return the columnar block index of variable 'varid', building it on
+ * first use. It is freed in bp_close().
+ */
+struct BP_var_columns * bp_get_var_columns (BP_FILE * fh, int varid)
+{
+    if (!fh->var_columns)
+    {
+        fh->var_columns = (struct BP_var_columns **)
+                    calloc (fh->mfooter.vars_count, sizeof (struct BP_var_columns *));
+        assert (fh->var_columns);
+    }
+
+    if (!fh->var_columns[varid])
+    {
+        fh->var_columns[varid] = bp_build_var_columns (bp_find_var_byid (fh, varid),
+                                                       is_fortran_file (fh));
+    }
+
+    return fh->var_columns[varid];
+}
+
+/* Find the first and last block of time index 'time'.
+ * Returns 0 if found, -1 otherwise (and *start = *stop = -1).
+ */
+int bp_columns_time_range (const struct BP_var_columns * c, uint32_t time,
+                           int64_t * start, int64_t * stop)
+{
+    int64_t i;
+
+    *start = *stop = -1;
+    if (c->ntimes)
+    {
+        if (time >= c->min_time && time - c->min_time < c->ntimes)
+        {
+            *start = c->time_first[time - c->min_time];
+            *stop = c->time_last[time - c->min_time];
+        }
+        return (*start < 0 ? -1 : 0);
+    }
+
+    for (i = 0; i < (int64_t) c->nblocks; i++)
+    {
+        if (c->time_index[i] == time)
+        {
+            *start = i;
+            break;
+        }
+    }
+
+    if (*start < 0)
+        return -1;
+
+    for (i = c->nblocks - 1; i >= *start; i--)
+    {
+        if (c->time_index[i] == time)
+        {
+            *stop = i;
+            break;
+        }
+    }
+
+    return 0;
+}
+
+/* First position in by_start[from, to) whose block starts at or after 'value'
+   in the slowest dimension */
+static uint64_t columns_lower_bound (const struct BP_var_columns * c, uint64_t from, uint64_t to,
+                                     uint64_t value)
+{
+    uint64_t mid;
+
+    while (from < to)
+    {
+        mid = from + (to - from) / 2;
+        if (c->start[c->by_start[mid] * c->ndim] < value)
+            from = mid + 1;
+        else
+            to = mid;
+    }
+    return from;
+}
+
+/* Store in 'blocks' the blocks of the range of time index 'time' (see
+ * bp_columns_time_range()) that intersect the box (start, count), in
+ * increasing order, and return how many there are. A block can only
+ * intersect the box if it starts in the slowest dimension less than its
+ * largest count before the box, so only those blocks are checked.
+ * 'blocks' must have room for all blocks of the range.
+ */
+uint64_t bp_columns_find_blocks (const struct BP_var_columns * c, uint32_t time,
+                                 const uint64_t * start, const uint64_t * count, uint64_t * blocks)
+{
+    int64_t first, last;
+    uint64_t from, to, i, n = 0, maxc;
+
+    if (bp_columns_time_range (c, time, &first, &last))
+        return 0;
+
+    if (!c->ntimes || c->ndim == 0)
+    {
+        for (i = first; i <= (uint64_t) last; i++)
+        {
+            if (bp_columns_block_intersects (c, i, start, count))
+                blocks[n++] = i;
+        }
+        return n;
+    }
+
+    maxc = c->max_count[time - c->min_time];
+    from = columns_lower_bound (c, first, last + 1, (start[0] >= maxc ? start[0] - maxc + 1 : 0));
+    to = columns_lower_bound (c, from, last + 1, start[0] + count[0]);
+    for (i = from; i < to; i++)
+    {
+        if (bp_columns_block_intersects (c, c->by_start[i], start, count))
+            blocks[n++] = c->by_start[i];
+    }
+    qsort (blocks, n, sizeof (uint64_t), compare_uint64);
+    return n;
+}
+
+/* Check if block 'b' intersects the box (start, count) of c->ndim dimensions */
+int bp_columns_block_intersects (const struct BP_var_columns * c, uint64_t b,
+                                 const uint64_t * start, const uint64_t * count)
+{
+    const uint64_t * bstart = c->start + b * c->ndim;
+    const uint64_t * bcount = c->count + b * c->ndim;
+    int j, flag = 1;
+
+    for (j = 0; j < c->ndim; j++)
+    {
+        flag &= (bstart[j] < start[j] + count[j]) & (start[j] < bstart[j] + bcount[j]);
+    }
+
+    return flag;
+}
+
 int is_global_array (struct adios_index_characteristic_struct_v1 *ch) {
     return is_global_array_generic(&ch->dims);
 }
@@ -3288,6 +4768,8 @@ int get_num_subfiles (BP_FILE * fh)
     struct adios_index_var_struct_v1 ** root;
     int i, j, n = 0;
 
+    bp_decode_all_vars (fh, fh->index_threads);
+
     root = vars_root;
     for (i = 0; i < mh->vars_count; i++)
     {
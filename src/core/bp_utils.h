@@ -36,7 +36,18 @@ int bp_read_open (const char * filename,
         BP_FILE * fh);
 MPI_File * get_BP_subfile_handle(BP_FILE *fh, uint32_t file_index);
 void add_BP_subfile_handle (struct BP_FILE *fh, struct BP_file_handle * n);
+MPI_File * bp_open_subfile (struct BP_FILE * fh, uint32_t file_index);
 void close_all_BP_subfiles (BP_FILE * fh);
+char * bp_get_subfile_name (const char * fname, uint32_t file_index);
+char * bp_get_mapped_slice (BP_FILE * fh, int file_index, uint64_t offset, uint64_t size);
+char * bp_get_staged_slice (BP_FILE * fh, int file_index, uint64_t offset, uint64_t size);
+char * bp_get_prefetched_slice (BP_FILE * fh, int file_index, uint64_t offset, uint64_t size);
+char * bp_get_slice_in_memory (BP_FILE * fh, int file_index, uint64_t offset, uint64_t size);
+void bp_free_staged_reads (BP_FILE * fh);
+void bp_free_prefetched_reads (BP_FILE * fh);
+void unmap_all_BP_files (BP_FILE * fh);
+void bp_retire_maps (BP_FILE * fh, struct BP_file_map ** retired);
+void bp_unmap_list (struct BP_file_map ** list);
 int get_time (struct adios_index_var_struct_v1 * v, int step);
 int bp_open (const char * fname,
              MPI_Comm comm,
@@ -44,9 +55,13 @@ int bp_open (const char * fname,
 ADIOS_VARINFO * bp_inq_var_byid (const ADIOS_FILE * fp, int varid);
 int bp_close (BP_FILE * fh);
 int bp_read_minifooter (BP_FILE * bp_struct);
+struct BP_stream_state * bp_alloc_stream_state ();
+void bp_free_stream_state (struct BP_stream_state * s);
 int bp_parse_pgs (BP_FILE * fh);
 int bp_parse_attrs (BP_FILE * fh);
 int bp_parse_vars (BP_FILE * fh);
+void bp_decode_var (BP_FILE * fh, struct adios_index_var_struct_v1 * v);
+void bp_decode_all_vars (BP_FILE * fh, int nthreads);
 int bp_seek_to_step (ADIOS_FILE * fp, int tostep, int show_hidden_attrs);
 int64_t get_var_start_index (struct adios_index_var_struct_v1 * v, int t);
 int64_t get_var_stop_index (struct adios_index_var_struct_v1 * v, int t);
@@ -82,6 +97,18 @@ double bp_value_to_double(enum ADIOS_DATATYPES type, void * data);
 int is_fortran_file (BP_FILE * fh);
 int has_subfiles (BP_FILE * fh);
 struct adios_index_var_struct_v1 * bp_find_var_byid (BP_FILE * fh, int varid);
+/* Variables with at least this many blocks use the columnar block index for scans */
+#define BP_COLUMNS_MIN_BLOCKS 256
+
+struct BP_var_columns * bp_build_var_columns (struct adios_index_var_struct_v1 * v, int file_is_fortran);
+void bp_free_var_columns (struct BP_var_columns * c);
+struct BP_var_columns * bp_get_var_columns (BP_FILE * fh, int varid);
+int bp_columns_time_range (const struct BP_var_columns * c, uint32_t time,
+                           int64_t * start, int64_t * stop);
+int bp_columns_block_intersects (const struct BP_var_columns * c, uint64_t b,
+                                 const uint64_t * start, const uint64_t * count);
+uint64_t bp_columns_find_blocks (const struct BP_var_columns * c, uint32_t time,
+                                 const uint64_t * start, const uint64_t * count, uint64_t * blocks);
 int is_global_array_generic (const struct adios_index_characteristic_dims_struct_v1 *dims); // NCSU ALACRITY-ADIOS
 int is_global_array (struct adios_index_characteristic_struct_v1 * ch);
 int check_bp_validity (const char * fname);
@@ -5,17 +5,23 @@
  * Copyright (c) 2008 - 2009.  UT-BATTELLE, LLC. All rights reserved.
  */
 
+#include "config.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <stdint.h>
+#include <string.h>
 #include <inttypes.h>
 #include <unistd.h>   /* _SC_PAGE_SIZE, _SC_AVPHYS_PAGES */
 #include <limits.h>   /* ULLONG_MAX */
 #include <assert.h>
+#include <sys/mman.h>
 
 #if defined(__APPLE__)
 #    include <mach/mach.h>
 #endif
+#if HAVE_PTHREAD
+#    include <pthread.h>
+#endif
 
 #include "core/buffer.h"
 #include "core/adios_logger.h"
@@ -35,16 +41,33 @@ static uint64_t max_size =
     18446744073709551615ULL; 
 #endif
 
+// bytes of buffers still being written out by background drains
+static uint64_t held_size = 0;
+static void wait_all_drains (void);
+
 void adios_databuffer_set_max_size (uint64_t v)  { max_size = v; }
 
+/* max size available for the buffer of the current step */
+static uint64_t available_size ()
+{
+    return (held_size < max_size ? max_size - held_size : 0);
+}
+
 uint64_t adios_databuffer_get_extension_size (struct adios_file_struct *fd)
 {
     uint64_t size = DATABUFFER_DEFAULT_SIZE;
-    if (size > max_size - fd->buffer_size)
+    uint64_t avail = available_size();
+    if (held_size > 0 && size + fd->buffer_size > avail)
     {
-        if (fd->buffer_size <= max_size)
+        // buffers of background writes are in the way, wait for them
+        wait_all_drains ();
+        avail = available_size();
+    }
+    if (size > avail - fd->buffer_size)
+    {
+        if (fd->buffer_size <= avail)
         {
-            size = max_size - fd->buffer_size;
+            size = avail - fd->buffer_size;
         }
         else 
         {
@@ -55,32 +78,274 @@ uint64_t adios_databuffer_get_extension_size (struct adios_file_struct *fd)
     return size;
 }
 
+/* Data buffers of finished adios_open()...adios_close() operations are kept
+   in a pool and reused by the next adios_open(), so that the buffer of each
+   output step is not allocated and page-faulted again. Buffers are freed at
+   adios_finalize(), by adios_release_buffers() and when an allocation fails.
+   With hugepages set, buffers are mmap'ed with huge pages (MAP_HUGETLB if
+   reserved huge pages are available, transparent huge pages otherwise).
+*/
+#define POOL_MAX_BUFFERS 4
+#define HUGEPAGE_SIZE 2097152ULL
+
+struct pooled_buffer
+{
+    char * allocated_bufptr;
+    uint64_t size;  // usable size from the aligned start
+    int mapped;     // 1 if allocated with mmap
+};
+
+static struct pooled_buffer pool [POOL_MAX_BUFFERS];
+static int pool_count = 0;
+static int use_hugepages = 0;
+
+void adios_databuffer_set_hugepages (int v)  { use_hugepages = v; }
+
+static char * align_buffer (char * allocated_bufptr)
+{
+    uint64_t p = (uint64_t) allocated_bufptr;
+    return (char *) ((p + BYTE_ALIGN - 1) & ~(BYTE_ALIGN - 1));
+}
+
+static uint64_t mapped_size (uint64_t size)
+{
+    return (size + HUGEPAGE_SIZE - 1) & ~(HUGEPAGE_SIZE - 1);
+}
+
+/* mmap 'size' bytes (a multiple of HUGEPAGE_SIZE) backed by huge pages if possible */
+static char * map_buffer (uint64_t size, int populate)
+{
+    int flags = MAP_PRIVATE | MAP_ANONYMOUS;
+    void * b = MAP_FAILED;
+
+#ifdef MAP_POPULATE
+    if (populate)
+        flags |= MAP_POPULATE;
+#endif
+#ifdef MAP_HUGETLB
+    b = mmap (NULL, size, PROT_READ | PROT_WRITE, flags | MAP_HUGETLB, -1, 0);
+#endif
+    if (b == MAP_FAILED)
+    {
+        b = mmap (NULL, size, PROT_READ | PROT_WRITE, flags, -1, 0);
+        if (b == MAP_FAILED)
+            return NULL;
+#ifdef MADV_HUGEPAGE
+        madvise (b, size, MADV_HUGEPAGE);
+#endif
+    }
+    return (char *) b;
+}
+
+static void free_buffer (char * allocated_bufptr, uint64_t size, int mapped)
+{
+    if (mapped)
+        munmap (allocated_bufptr, size);
+    else
+        free (allocated_bufptr);
+}
+
+static void pool_put (char * allocated_bufptr, uint64_t size, int mapped)
+{
+    int i, smallest = 0;
+
+    if (!allocated_bufptr)
+        return;
+    if (!size)
+    {
+        free_buffer (allocated_bufptr, size, mapped);
+        return;
+    }
+    if (pool_count == POOL_MAX_BUFFERS)
+    {
+        for (i = 1; i < pool_count; i++)
+        {
+            if (pool[i].size < pool[smallest].size)
+                smallest = i;
+        }
+        if (pool[smallest].size >= size)
+        {
+            free_buffer (allocated_bufptr, size, mapped);
+            return;
+        }
+        free_buffer (pool[smallest].allocated_bufptr, pool[smallest].size, pool[smallest].mapped);
+        pool[smallest] = pool[--pool_count];
+    }
+    pool[pool_count].allocated_bufptr = allocated_bufptr;
+    pool[pool_count].size = size;
+    pool[pool_count].mapped = mapped;
+    pool_count++;
+}
+
+/* Give fd the smallest pooled buffer of at least 'size' bytes, or the
+   largest one if none is big enough. Buffers larger than the max size are freed. */
+static void pool_get (struct adios_file_struct *fd, uint64_t size)
+{
+    int i, best = -1;
+
+    for (i = 0; i < pool_count; i++)
+    {
+        if (pool[i].size > available_size())
+        {
+            free_buffer (pool[i].allocated_bufptr, pool[i].size, pool[i].mapped);
+            pool[i--] = pool[--pool_count];
+        }
+        else if (best < 0 ||
+                 (pool[i].size >= size ? pool[best].size < size || pool[i].size < pool[best].size
+                                       : pool[i].size > pool[best].size))
+        {
+            best = i;
+        }
+    }
+    if (best < 0)
+        return;
+
+    fd->allocated_bufptr = pool[best].allocated_bufptr;
+    fd->buffer_mapped = pool[best].mapped;
+    fd->buffer = (fd->buffer_mapped ? fd->allocated_bufptr : align_buffer (fd->allocated_bufptr));
+    fd->buffer_size = pool[best].size;
+    pool[best] = pool[--pool_count];
+    log_debug ("Data buffer of %" PRIu64 " bytes reused for group %s\n",
+               fd->buffer_size, fd->group->name);
+}
+
+void adios_databuffer_pool_free (void)
+{
+    while (pool_count > 0)
+    {
+        pool_count--;
+        free_buffer (pool[pool_count].allocated_bufptr, pool[pool_count].size,
+                     pool[pool_count].mapped);
+    }
+}
+
+int adios_databuffer_prefault (uint64_t size)
+{
+    char * b;
+    uint64_t i;
+    long pagesize = sysconf (_SC_PAGE_SIZE);
+
+    if (size > available_size())
+        size = available_size();
+    if (!size)
+        return 0;
+
+    if (use_hugepages)
+    {
+        size = mapped_size (size);
+        b = map_buffer (size, 1);
+    }
+    else
+    {
+        b = (char *) malloc (size + BYTE_ALIGN - 1);
+    }
+    if (!b)
+    {
+        log_warn ("Cannot allocate %" PRIu64 " bytes for the data buffer in advance\n", size);
+        return 1;
+    }
+    // touch every page now instead of in adios_write()
+    for (i = 0; i < size + (use_hugepages ? 0 : BYTE_ALIGN - 1); i += (pagesize > 0 ? pagesize : 4096))
+        b[i] = 0;
+    pool_put (b, size, use_hugepages);
+    log_debug ("Data buffer of %" PRIu64 " bytes allocated in advance\n", size);
+    return 0;
+}
+
+/* realloc the buffer of fd to 'size' bytes, keeping its content */
+static int grow_buffer (struct adios_file_struct *fd, uint64_t size)
+{
+    char * b;
+
+    if (use_hugepages && (fd->buffer_mapped || !fd->allocated_bufptr))
+    {
+        size = mapped_size (size);
+        if (fd->allocated_bufptr)
+        {
+#ifdef MREMAP_MAYMOVE
+            b = (char *) mremap (fd->allocated_bufptr, fd->buffer_size, size, MREMAP_MAYMOVE);
+            if (b == MAP_FAILED)
+                return 1;
+#else
+            b = map_buffer (size, 0);
+            if (!b)
+                return 1;
+            memcpy (b, fd->allocated_bufptr, fd->buffer_size);
+            munmap (fd->allocated_bufptr, fd->buffer_size);
+#endif
+        }
+        else
+        {
+            b = map_buffer (size, 0);
+            if (!b)
+                return 1;
+        }
+        fd->buffer_mapped = 1;
+        fd->allocated_bufptr = b;
+        fd->buffer = b;
+    }
+    else if (fd->buffer_mapped)
+    {
+        // hugepages were turned off, move the content into a malloc'ed buffer
+        b = (char *) malloc (size + BYTE_ALIGN - 1);
+        if (!b)
+            return 1;
+        memcpy (align_buffer (b), fd->buffer, fd->buffer_size);
+        munmap (fd->allocated_bufptr, fd->buffer_size);
+        fd->buffer_mapped = 0;
+        fd->allocated_bufptr = b;
+        fd->buffer = align_buffer (b);
+    }
+    else
+    {
+        // align usable buffer to BYTE_ALIGN bytes
+        b = (char *) realloc (fd->allocated_bufptr, size + BYTE_ALIGN - 1);
+        if (!b)
+            return 1;
+        if (align_buffer (b) - b != fd->buffer - fd->allocated_bufptr)
+        {
+            // the content moved to a different alignment
+            memmove (align_buffer (b), b + (fd->buffer - fd->allocated_bufptr),
+                     (fd->buffer_size < size ? fd->buffer_size : size));
+        }
+        fd->allocated_bufptr = b;
+        fd->buffer = align_buffer (b);
+    }
+    log_debug ("Data buffer extended from %" PRIu64 " to %" PRIu64 " bytes\n", fd->buffer_size, size);
+    fd->buffer_size = size;
+    return 0;
+}
+
 int adios_databuffer_resize (struct adios_file_struct *fd, uint64_t size)
 {
     /* This function works as malloc if fd->allocated_bufptr is NULL, so
        there is no need for a separate first-allocation function */
     int retval = 0;
 
-    if (size <= max_size) 
+    if (size > available_size() && held_size > 0)
     {
-        // try to alloc/realloc a buffer to requested size
-        // align usable buffer to BYTE_ALIGN bytes
-        void * b = realloc (fd->allocated_bufptr, size +  BYTE_ALIGN - 1);
-        if (b)
-        {
-            fd->allocated_bufptr = b;
-            uint64_t p = (uint64_t) fd->allocated_bufptr;
-            fd->buffer = (char *) ((p + BYTE_ALIGN - 1) & ~(BYTE_ALIGN - 1));
-            log_debug ("Data buffer extended from %" PRIu64 " to %" PRIu64 " bytes\n", fd->buffer_size, size);
-            fd->buffer_size = size;
+        log_debug ("Wait for background writes to allocate %" PRIu64 " bytes for group %s\n",
+                   size, fd->group->name);
+        wait_all_drains ();
+    }
 
-        }
-        else
+    if (size <= available_size()) 
+    {
+        if (!fd->allocated_bufptr)
+            pool_get (fd, size);
+
+        // a reused buffer may already be big enough, it is not shrunk
+        if (size > fd->buffer_size && grow_buffer (fd, size))
         {
-            retval = 1;
-            log_warn ("Cannot allocate %" PRIu64 " bytes for buffered output of group %s. "
-                      "Continue buffering with buffer size %" PRIu64 " MB\n",
-                      size, fd->group->name, fd->buffer_size/1048576);
+            // free the idle buffers and try again
+            adios_databuffer_pool_free ();
+            if (grow_buffer (fd, size))
+            {
+                retval = 1;
+                log_warn ("Cannot allocate %" PRIu64 " bytes for buffered output of group %s. "
+                          "Continue buffering with buffer size %" PRIu64 " MB\n",
+                          size, fd->group->name, fd->buffer_size/1048576);
+            }
         }
     }
     else
@@ -89,7 +354,7 @@ int adios_databuffer_resize (struct adios_file_struct *fd, uint64_t size)
         log_warn ("Cannot allocate %" PRIu64 " bytes for buffered output of group %s "
                 " because max allowed is %" PRIu64 " bytes. "
                 "Continue buffering with buffer size %" PRIu64 " MB\n",
-                size, fd->group->name, max_size, fd->buffer_size/1048576);
+                size, fd->group->name, available_size(), fd->buffer_size/1048576);
     }
 
     return retval;
@@ -97,16 +362,203 @@ int adios_databuffer_resize (struct adios_file_struct *fd, uint64_t size)
 
 void adios_databuffer_free (struct adios_file_struct *fd)
 {
-    if (fd->allocated_bufptr)
-        free (fd->allocated_bufptr);
+    // keep the buffer for the next adios_open()
+    pool_put (fd->allocated_bufptr, fd->buffer_size, fd->buffer_mapped);
     fd->allocated_bufptr = 0;
     fd->buffer = 0;
     fd->buffer_size = 0;
+    fd->buffer_mapped = 0;
     fd->offset = 0;
     fd->bytes_written = 0;
 }
 
 
+struct adios_databuffer_drain
+{
+#if HAVE_PTHREAD
+    pthread_t thread;
+#endif
+    int active;              // 1 while a buffer is being written out
+    int status;              // return value of the last drain function
+    char * name;             // file name of the step being written out
+    char * allocated_bufptr; // buffer taken over from the file struct
+    char * buffer;           // aligned start of the data in allocated_bufptr
+    int mapped;              // allocated_bufptr is mmap'ed
+    uint64_t size;           // bytes of data to write
+    uint64_t held;           // bytes counted against the max buffer size
+    ADIOS_DRAIN_FN fn;
+    void * arg;
+    int unreported;          // status of a drain completed by wait_all_drains()
+    struct adios_databuffer_drain * next;
+};
+
+// all drains, so that an allocation can wait for the buffers held by any group
+static struct adios_databuffer_drain * drains = 0;
+
+struct adios_databuffer_drain * adios_databuffer_drain_new (void)
+{
+    struct adios_databuffer_drain * d;
+    d = (struct adios_databuffer_drain *) calloc (1, sizeof (struct adios_databuffer_drain));
+    if (d)
+    {
+        d->next = drains;
+        drains = d;
+    }
+    return d;
+}
+
+void adios_databuffer_drain_free (struct adios_databuffer_drain * d)
+{
+    struct adios_databuffer_drain ** p = &drains;
+    if (d)
+    {
+        adios_databuffer_drain_wait (d);
+        while (*p && *p != d)
+            p = &(*p)->next;
+        if (*p)
+            *p = d->next;
+        free (d);
+    }
+}
+
+#if HAVE_PTHREAD
+static void * drain_thread (void * arg)
+{
+    struct adios_databuffer_drain * d = (struct adios_databuffer_drain *) arg;
+    d->status = d->fn (d->arg, d->buffer, d->size);
+    return NULL;
+}
+#endif
+
+static void drain_release (struct adios_databuffer_drain * d)
+{
+    pool_put (d->allocated_bufptr, d->held, d->mapped);
+    free (d->name);
+    held_size -= d->held;
+    d->allocated_bufptr = 0;
+    d->buffer = 0;
+    d->name = 0;
+    d->held = 0;
+    d->active = 0;
+}
+
+static int drain_join (struct adios_databuffer_drain * d)
+{
+#if HAVE_PTHREAD
+    pthread_join (d->thread, NULL);
+#endif
+    log_debug ("Background write of %" PRIu64 " bytes to %s completed\n", d->size, d->name);
+    drain_release (d);
+    return d->status;
+}
+
+int adios_databuffer_drain_wait (struct adios_databuffer_drain * d)
+{
+    int status;
+
+    if (!d)
+        return 0;
+    if (!d->active)
+    {
+        status = d->unreported;
+        d->unreported = 0;
+        return status;
+    }
+    return drain_join (d);
+}
+
+/* Wait for the drains of all groups, to free their buffers. Their status is
+   returned by the next adios_databuffer_drain_wait() of their owner. */
+static void wait_all_drains (void)
+{
+    struct adios_databuffer_drain * d;
+    for (d = drains; d; d = d->next)
+    {
+        if (d->active)
+            d->unreported |= drain_join (d);
+    }
+}
+
+int adios_databuffer_drain_open (struct adios_databuffer_drain * d, struct adios_file_struct * fd)
+{
+    uint64_t next_size;
+
+    if (!d || !d->active)
+        return 0;
+
+    next_size = (fd->group->last_buffer_size > 0 ? fd->group->last_buffer_size
+                                                 : DATABUFFER_DEFAULT_SIZE);
+    if (   fd->mode != adios_mode_write
+        || !strcmp (fd->name, d->name)
+        || next_size > available_size())
+    {
+        log_debug ("Wait for background write to %s before opening %s\n", d->name, fd->name);
+        return adios_databuffer_drain_wait (d);
+    }
+    return 0;
+}
+
+int adios_databuffer_drain_start (struct adios_databuffer_drain * d,
+                                  struct adios_file_struct * fd,
+                                  struct adios_method_struct * method,
+                                  ADIOS_DRAIN_FN fn, void * arg)
+{
+    struct adios_method_list_struct * m = fd->group->methods;
+    int status = adios_databuffer_drain_wait (d);
+
+    while (m && m->method != method)
+        m = m->next;
+
+    d->fn = fn;
+    d->arg = arg;
+    d->size = fd->bytes_written;
+    if (m && !m->next)
+    {
+        // last method to use the buffer in this step, take it over
+        d->allocated_bufptr = fd->allocated_bufptr;
+        d->buffer = fd->buffer;
+        d->mapped = fd->buffer_mapped;
+        d->held = fd->buffer_size;
+        fd->allocated_bufptr = 0;
+        fd->buffer = 0;
+        fd->buffer_mapped = 0;
+    }
+    else
+    {
+        // other methods still need the buffer, write out a copy
+        d->allocated_bufptr = (char *) malloc (d->size + BYTE_ALIGN - 1);
+        d->buffer = (d->allocated_bufptr ? align_buffer (d->allocated_bufptr) : 0);
+        d->mapped = 0;
+        d->held = d->size;
+        if (!d->buffer)
+        {
+            log_warn ("Cannot allocate %" PRIu64 " bytes for background write of %s, "
+                      "writing it now\n", d->size, fd->name);
+            return fn (arg, fd->buffer, fd->bytes_written) || status;
+        }
+        memcpy (d->buffer, fd->buffer, d->size);
+    }
+    d->name = strdup (fd->name);
+    d->status = 0;
+    d->active = 1;
+    held_size += d->held;
+
+#if HAVE_PTHREAD
+    if (pthread_create (&d->thread, NULL, drain_thread, d))
+    {
+        log_warn ("Cannot create thread for background write of %s, writing it now\n",
+                  fd->name);
+        d->status = fn (arg, d->buffer, d->size);
+        drain_release (d);
+        return d->status || status;
+    }
+#else
+    d->status = fn (arg, d->buffer, d->size);
+#endif
+    return status;
+}
+
+
 /* OBSOLETE BELOW
 
    However, write methods still use them in get_write_buffer() functions that don't work anymore
@@ -26,8 +26,50 @@ uint64_t adios_databuffer_get_extension_size (struct adios_file_struct *fd);
    It does NOT resize the buffer up to the maximum if size is greater than the maximum
 */
 int adios_databuffer_resize (struct adios_file_struct *fd, uint64_t size);
+/* Release the buffer of fd. It is kept for reuse by the next adios_open(). */
 void adios_databuffer_free (struct adios_file_struct *fd);
 
+/* Allocate new buffers with mmap() and huge pages (1) or with malloc (0) */
+void adios_databuffer_set_hugepages (int v);
+/* Allocate a buffer of 'size' bytes (up to the max size) and touch all its
+   pages now, to be used by the next adios_open(). Returns 0 on success. */
+int adios_databuffer_prefault (uint64_t size);
+/* Free all buffers kept for reuse */
+void adios_databuffer_pool_free (void);
+
+
+/* Background write-out (drain) of the data buffer, used by methods with the
+   "async" parameter. adios_databuffer_drain_start() takes over the filled
+   buffer of fd and calls fn (arg, buffer, size) in a background thread, so
+   adios_close() returns immediately and the next step is buffered into a new
+   buffer while the previous one is written (double buffering).
+   A buffer being drained counts against the max buffer size.
+   fn returns 0 on success. It must not call MPI functions unless MPI provides
+   MPI_THREAD_MULTIPLE.
+*/
+typedef int (*ADIOS_DRAIN_FN) (void * arg, char * buffer, uint64_t size);
+struct adios_databuffer_drain;
+
+struct adios_databuffer_drain * adios_databuffer_drain_new (void);
+/* Wait for the drain in progress and free d */
+void adios_databuffer_drain_free (struct adios_databuffer_drain * d);
+
+/* Wait for the previous drain of d, then start draining the buffer of fd.
+   Returns the status of the previous drain. */
+int adios_databuffer_drain_start (struct adios_databuffer_drain * d,
+                                  struct adios_file_struct * fd,
+                                  struct adios_method_struct * method,
+                                  ADIOS_DRAIN_FN fn, void * arg);
+
+/* Wait for the drain in progress, if any. Returns its status. */
+int adios_databuffer_drain_wait (struct adios_databuffer_drain * d);
+
+/* Called from the method's open: wait for the drain in progress if the new
+   step cannot overlap with it (same file, read/append/update mode, or
+   not enough buffer space left). Returns the status of the waited drain. */
+int adios_databuffer_drain_open (struct adios_databuffer_drain * d,
+                                 struct adios_file_struct * fd);
+
 
 
 /*
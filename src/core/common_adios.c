@@ -28,6 +28,7 @@
 #include "core/adios_logger.h"
 #include "core/adios_timing.h"
 #include "core/qhashtbl.h"
+#include "core/adios_bitmap_index.h"
 #include "public/adios_error.h"
 
 // NCSU ALACRITY-ADIOS
@@ -85,6 +86,7 @@ int common_adios_finalize (int mype)
         }
     }
 
+    adios_databuffer_pool_free ();
     adios_cleanup ();
 
 #if defined(WITH_NCSU_TIMER) && defined(TIMER_LEVEL) && (TIMER_LEVEL <= 0)
@@ -330,6 +332,14 @@ int common_adios_open (int64_t * fd_p, const char * group_name
             methods = methods->next;
         }
 
+        /* Payloads are not copied into the buffer (zero-copy) only if the
+           method that asked for it is the only one getting the buffer */
+        if (fd->zero_copy_threshold && g->methods && g->methods->next)
+        {
+            log_warn ("Zero-copy writes are disabled for group %s because it "
+                      "has more than one method\n", g->name);
+            fd->zero_copy_threshold = 0;
+        }
 
         if (fd->bufstrat != no_buffering)
         {
@@ -532,6 +542,147 @@ static int common_adios_write_transform_helper(struct adios_file_struct * fd, st
     return 1;
 }
 
+///////////////////////////////////////////////////////////////////////////////
+/* Build the bitmap index record of the block being written (from the user data,
+ * before any transformation) and append it to the records of this step */
+static void adios_add_bitmap_index_record (struct adios_file_struct * fd, struct adios_var_struct * v)
+{
+    struct adios_dimension_struct * d;
+    uint64_t start[32], count[32], len;
+    int ndim = 0, global = 1;
+    char * name;
+    void * record;
+    char * p;
+
+    for (d = v->dimensions; d; d = d->next)
+    {
+        if (d->dimension.is_time_index == adios_flag_yes ||
+            d->global_dimension.is_time_index == adios_flag_yes)
+            continue;
+        if (ndim == 32)
+            return;
+        count[ndim] = adios_get_dim_value (&d->dimension);
+        start[ndim] = adios_get_dim_value (&d->local_offset);
+        if (!adios_get_dim_value (&d->global_dimension))
+            global = 0;
+        ndim++;
+    }
+    if (!ndim || !global)
+    {
+        log_warn ("adios_write(): the bitmap index is supported only for global arrays, "
+                  "variable %s/%s will not be indexed\n", v->path, v->name);
+        return;
+    }
+
+    // full name as seen by the readers
+    name = (char *) malloc (strlen (v->path) + strlen (v->name) + 2);
+    if (!name)
+        return;
+    if (v->path[0] && v->path[strlen (v->path)-1] != '/')
+        sprintf (name, "%s/%s", v->path, v->name);
+    else
+        sprintf (name, "%s%s", v->path, v->name);
+
+    record = adios_bitmap_index_build_record (name, fd->group->time_index, v->type, ndim,
+                                              start, count, v->data, v->bitmap_index_bins, &len);
+    free (name);
+    if (!record)
+        return;
+
+    p = (char *) realloc (fd->bitmap_index_records, fd->bitmap_index_records_size + len);
+    if (!p)
+    {
+        adios_error (err_no_memory, "adios_write(): cannot store the bitmap index of variable %s/%s\n",
+                     v->path, v->name);
+        free (record);
+        return;
+    }
+    memcpy (p + fd->bitmap_index_records_size, record, len);
+    fd->bitmap_index_records = p;
+    fd->bitmap_index_records_size += len;
+    free (record);
+}
+
+/* Collect the bitmap index records of all processes on rank 0 and append them
+ * to the side file of the output */
+static void adios_write_bitmap_index (struct adios_file_struct * fd)
+{
+    struct adios_method_list_struct * m;
+    const char * base_path = "";
+    int rank = 0, size = 1, i;
+    int mysize = (int) fd->bitmap_index_records_size;
+    int * sizes = NULL, * offsets = NULL;
+    char * records = fd->bitmap_index_records;
+    uint64_t total = fd->bitmap_index_records_size;
+
+    if (fd->bitmap_index_records_size > INT32_MAX)
+    {
+        log_error ("adios_close(): bitmap index of more than 2GB per process is not supported, "
+                   "no index is written\n");
+        mysize = 0;
+    }
+    for (m = fd->group->methods; m; m = m->next)
+    {
+        if (m->method->base_path)
+        {
+            base_path = m->method->base_path;
+            break;
+        }
+    }
+
+    if (fd->comm != MPI_COMM_NULL && fd->comm != MPI_COMM_SELF)
+    {
+        MPI_Comm_rank (fd->comm, &rank);
+        MPI_Comm_size (fd->comm, &size);
+    }
+    if (size > 1)
+    {
+        if (rank == 0)
+            sizes = (int *) malloc (2 * size * sizeof (int));
+        MPI_Gather (&mysize, 1, MPI_INT, sizes, 1, MPI_INT, 0, fd->comm);
+        records = NULL;
+        if (rank == 0)
+        {
+            offsets = sizes + size;
+            total = 0;
+            for (i = 0; i < size; i++)
+            {
+                offsets[i] = (int) total;
+                total += sizes[i];
+            }
+            if (total > INT32_MAX)
+            {
+                log_error ("adios_close(): bitmap index of more than 2GB per step is not supported, "
+                           "no index is written\n");
+                for (i = 0; i < size; i++)
+                    sizes[i] = offsets[i] = 0;
+                total = 0;
+            }
+            records = (char *) malloc (total ? total : 1);
+        }
+        MPI_Gatherv (fd->bitmap_index_records, mysize, MPI_BYTE,
+                     records, sizes, offsets, MPI_BYTE, 0, fd->comm);
+    }
+
+    if (rank == 0 && records)
+    {
+        char * filename = (char *) malloc (strlen (base_path) + strlen (fd->name)
+                                           + strlen (ADIOS_BITMAP_INDEX_SUFFIX) + 1);
+        sprintf (filename, "%s%s%s", base_path, fd->name, ADIOS_BITMAP_INDEX_SUFFIX);
+        adios_bitmap_index_write_records (filename,
+                (fd->mode == adios_mode_append || fd->mode == adios_mode_update),
+                records, total);
+        free (filename);
+    }
+
+    if (records != fd->bitmap_index_records)
+        free (records);
+    free (sizes);
+    free (fd->bitmap_index_records);
+    fd->bitmap_index_records = NULL;
+    fd->bitmap_index_records_size = 0;
+}
+
 ///////////////////////////////////////////////////////////////////////////////
 /* common_adios_write is just a partial implementation. It expects filled out
  * structures. This is because C and Fortran implementations of adios_write are
@@ -549,12 +700,29 @@ int common_adios_write (struct adios_file_struct * fd, struct adios_var_struct *
     // as we can't do this after the data is transformed
     adios_generate_var_characteristics_v1 (fd, v);
 
+    // The bitmap index is built from the untransformed data as well
+    if (v->bitmap_index_bins && v->dimensions && v->data)
+    {
+        adios_add_bitmap_index_record (fd, v);
+    }
+
+    // Large arrays are not copied into the buffer if the method writes them
+    // directly from the user's memory
+    uint64_t ref_size = 0;
+    if (fd->zero_copy_threshold && v->transform_type == adios_transform_none
+        && v->dimensions && v->data)
+    {
+        ref_size = adios_get_var_size (v, v->data);
+        if (ref_size < fd->zero_copy_threshold)
+            ref_size = 0;
+    }
+
     uint64_t vsize = 0;
     if (fd->bufstate == buffering_ongoing)
     {
         // Second, estimate the size needed for buffering and extend buffer when needed
         // and handle the error if buffer cannot be extended
-        vsize = adios_transform_worst_case_transformed_var_size(v);
+        vsize = adios_transform_worst_case_transformed_var_size(v) - ref_size;
 
         if (fd->buffer_size < fd->offset + vsize)
         {
@@ -608,6 +776,7 @@ int common_adios_write (struct adios_file_struct * fd, struct adios_var_struct *
                     }
                     /* Start buffering from scratch (a new PG) */
                     fd->offset = 0;
+                    adios_clear_payload_refs_v1 (fd);
                     adios_write_open_process_group_header_v1 (fd);
                     adios_write_open_vars_v1 (fd);
                     add_new_pg_written (fd);
@@ -639,7 +808,10 @@ int common_adios_write (struct adios_file_struct * fd, struct adios_var_struct *
                 adios_write_var_header_v1 (fd, v);
 
                 // write payload
-                adios_write_var_payload_v1 (fd, v);
+                if (ref_size)
+                    adios_write_var_payload_ref_v1 (fd, v);
+                else
+                    adios_write_var_payload_v1 (fd, v);
             }
         }
     }
@@ -1205,6 +1377,20 @@ int common_adios_close (int64_t fd_p)
     /* clean-up all copied variables with statistics and data in all PGs attached to this file */
     adios_free_pglist (fd);
 
+    if (fd->mode != adios_mode_read)
+    {
+        /* append the bitmap indexes of this step to the side file (collective) */
+        for (v = fd->group->vars; v; v = v->next)
+        {
+            if (v->bitmap_index_bins)
+                break;
+        }
+        if (v)
+        {
+            adios_write_bitmap_index (fd);
+        }
+    }
+
     if (fd->name)
     {
         free (fd->name);
@@ -1237,6 +1423,7 @@ int common_adios_close (int64_t fd_p)
         adios_databuffer_free (fd);
     }
 
+    free (fd->payload_refs);
     free (fd);
 
 #if defined(WITH_NCSU_TIMER) && defined(TIMER_LEVEL) && (TIMER_LEVEL <= 0)
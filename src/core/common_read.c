@@ -28,6 +28,7 @@
 #include "transforms/adios_transforms_hooks_read.h"
 #include "transforms/adios_transforms_reqgroup.h"
 #include "transforms/adios_transforms_datablock.h"
+#include "transforms/adios_transforms_blockcache.h"
 #define BYTE_ALIGN 8
 
 #ifdef DMALLOC
@@ -39,6 +40,21 @@
    Therefore static variables cannot be used to pass info between two Matlab/ADIOS calls */
 static struct adios_read_hooks_struct * adios_read_hooks = 0;
 
+/* Index of the names of the variables or the attributes of a file, for
+ * lookups and prefix searches by name (with or without the leading /).
+ * IDs are those of the complete list, not of the group in view.
+ */
+struct name_index_entry {
+    const char *name;   /* without the leading / */
+    int id;
+};
+
+struct name_index_struct {
+    qhashtbl_t *hashtbl;                /* name -> id+1, built at the first lookup */
+    int nsorted;
+    struct name_index_entry *sorted;    /* sorted by name, built at the first prefix search */
+};
+
 struct common_read_internals_struct {
     enum ADIOS_READ_METHOD method;
     struct adios_read_hooks_struct * read_hooks; /* Save adios_read_hooks for each fopen for Matlab */
@@ -57,7 +73,8 @@ struct common_read_internals_struct {
     char     ** full_varnamelist;    /* fp->var_namelist to save here if one group is viewed */
     uint32_t    full_nattrs;         /* fp->nvars to save here for a group view */
     char     ** full_attrnamelist;   /* fp->attr_namelist to save here if one group is viewed */
-    qhashtbl_t *hashtbl_vars;    /* speed up search for var_namelist to varid  */
+    struct name_index_struct var_index;   /* speed up search for var_namelist to varid  */
+    struct name_index_struct attr_index;  /* speed up search for attr_namelist to attrid  */
 
     // NCSU ALACRITY-ADIOS - Table of sub-requests issued by transform method
     adios_transform_read_request *transform_reqgroups;
@@ -67,6 +84,9 @@ struct common_read_internals_struct {
 
     // Cache of VARINFOs and TRANSINFOs, only used internally by ADIOS at the moment
     adios_infocache *infocache;
+
+    // Identity of the file at open, for the block cache
+    adios_block_cache_file block_cache_file;
 };
 
 // NCSU ALACRITY-ADIOS - Forward declaration/function prototypes
@@ -81,6 +101,7 @@ int common_read_init_method (enum ADIOS_READ_METHOD method,
     PairStruct *params, *p, *prev_p;
     int verbose_level, removeit, save;
     int retval;
+    long nthreads;
     char *end;
 
     adios_errno = err_no_error;
@@ -143,6 +164,18 @@ int common_read_init_method (enum ADIOS_READ_METHOD method,
             adios_verbose_level = save;
             removeit = 1;
         }
+        else if (!strcasecmp (p->name, "read_threads"))
+        {
+            // decoding of transformed blocks; left in the list for the method
+            errno = 0;
+            nthreads = p->value ? strtol(p->value, &end, 10) : 0;
+            if (errno || nthreads < 1 || (end != 0 && *end != '\0')) {
+                log_error ("Invalid 'read_threads' parameter passed to read init function: '%s'\n",
+                           p->value ? p->value : "");
+            } else {
+                adios_transform_set_read_threads ((int) nthreads);
+            }
+        }
         if (removeit) {
             if (p == params) {
                 // remove head
@@ -184,6 +217,162 @@ static int calc_hash_size(unsigned int nvars)
     return hash_size;
 }
 
+static const char * skip_leading_slash (const char *name)
+{
+    return (*name == '/' ? name+1 : name);
+}
+
+/* The complete list of variables (attrs=0) or attributes (attrs=1), not just the group in view */
+static void get_full_namelist (const ADIOS_FILE *fp, int attrs, int *n, char ***namelist)
+{
+    struct common_read_internals_struct * internals = 
+        (struct common_read_internals_struct *) fp->internal_data;
+    if (internals->group_in_view == -1) {
+        *n = (attrs ? fp->nattrs : fp->nvars);
+        *namelist = (attrs ? fp->attr_namelist : fp->var_namelist);
+    } else {
+        *n = (int) (attrs ? internals->full_nattrs : internals->full_nvars);
+        *namelist = (attrs ? internals->full_attrnamelist : internals->full_varnamelist);
+    }
+}
+
+static void name_index_free (struct name_index_struct *ni)
+{
+    if (ni->hashtbl)
+        ni->hashtbl->free (ni->hashtbl);
+    free (ni->sorted);
+    ni->hashtbl = NULL;
+    ni->sorted = NULL;
+    ni->nsorted = 0;
+}
+
+/* Find a variable (attrs=0) or attribute (attrs=1) name in the complete list.
+   The exact name is looked up first, then the name with the leading / removed
+   or added, so that "a" finds "/a" only if there is no "a".
+   Returns the ID in the complete list or -1 if not found. */
+static int name_index_find (const ADIOS_FILE *fp, int attrs, const char *name)
+{
+    struct common_read_internals_struct * internals = 
+        (struct common_read_internals_struct *) fp->internal_data;
+    struct name_index_struct *ni = (attrs ? &internals->attr_index : &internals->var_index);
+    char *slashed;
+    int id;
+
+    if (!ni->hashtbl) {
+        int n, i;
+        char **namelist;
+        get_full_namelist (fp, attrs, &n, &namelist);
+        ni->hashtbl = qhashtbl (n > 0 ? calc_hash_size(n) : 1);
+        if (!ni->hashtbl) {
+            adios_error (err_no_memory, "Cannot allocate memory for the index of names\n");
+            return -1;
+        }
+        for (i=0; i<n; i++) {
+            ni->hashtbl->put (ni->hashtbl, namelist[i],
+                              (void *)(intptr_t)(i+1)); // avoid 0 for error checking later
+        }
+    }
+    // id=0 is "not found", otherwise +1 bigger than actual id
+    id = (int)(intptr_t) ni->hashtbl->get (ni->hashtbl, name) - 1;
+    if (id >= 0)
+        return id;
+
+    if (*name == '/')
+        return (int)(intptr_t) ni->hashtbl->get (ni->hashtbl, name+1) - 1;
+
+    slashed = (char *) malloc (strlen(name) + 2);
+    if (!slashed) {
+        adios_error (err_no_memory, "Cannot allocate memory to look up name %s\n", name);
+        return -1;
+    }
+    slashed[0] = '/';
+    strcpy (slashed+1, name);
+    id = (int)(intptr_t) ni->hashtbl->get (ni->hashtbl, slashed) - 1;
+    free (slashed);
+    return id;
+}
+
+static int compare_name_index_entries (const void *a, const void *b)
+{
+    return strcmp (((const struct name_index_entry *) a)->name,
+                   ((const struct name_index_entry *) b)->name);
+}
+
+static int compare_ints (const void *a, const void *b)
+{
+    int x = *(const int *) a, y = *(const int *) b;
+    return (x > y) - (x < y);
+}
+
+/* Find the variables (attrs=0) or attributes (attrs=1) in view whose name
+   (without the leading /) starts with 'prefix' (without the leading /).
+   Returns the number of names found and their IDs in the view in ascending
+   order in *ids (malloc'ed, NULL if none found), -1 on error. */
+static int name_index_find_prefix (const ADIOS_FILE *fp, int attrs, const char *prefix, int **ids)
+{
+    struct common_read_internals_struct * internals = 
+        (struct common_read_internals_struct *) fp->internal_data;
+    struct name_index_struct *ni = (attrs ? &internals->attr_index : &internals->var_index);
+    int offset = (int) (attrs ? internals->group_attrid_offset : internals->group_varid_offset);
+    int nview = (attrs ? fp->nattrs : fp->nvars);
+    int lo, hi, i, n;
+    size_t plen;
+
+    *ids = NULL;
+    if (!ni->sorted) {
+        char **namelist;
+        get_full_namelist (fp, attrs, &n, &namelist);
+        if (n <= 0)
+            return 0;
+        ni->sorted = (struct name_index_entry *) malloc (n * sizeof(struct name_index_entry));
+        if (!ni->sorted) {
+            adios_error (err_no_memory, "Cannot allocate memory for the index of names\n");
+            return -1;
+        }
+        for (i=0; i<n; i++) {
+            ni->sorted[i].name = skip_leading_slash (namelist[i]);
+            ni->sorted[i].id = i;
+        }
+        qsort (ni->sorted, n, sizeof(struct name_index_entry), compare_name_index_entries);
+        ni->nsorted = n;
+    }
+
+    // first name >= prefix, then all names starting with prefix follow it
+    prefix = skip_leading_slash (prefix);
+    plen = strlen (prefix);
+    lo = 0;
+    hi = ni->nsorted;
+    while (lo < hi) {
+        int mid = lo + (hi - lo) / 2;
+        if (strcmp (ni->sorted[mid].name, prefix) < 0)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    for (hi = lo; hi < ni->nsorted && !strncmp (ni->sorted[hi].name, prefix, plen); hi++)
+        ;
+    if (hi == lo)
+        return 0;
+
+    *ids = (int *) malloc ((hi - lo) * sizeof(int));
+    if (!*ids) {
+        adios_error (err_no_memory, "Cannot allocate memory for the list of names\n");
+        return -1;
+    }
+    for (i = lo, n = 0; i < hi; i++) {
+        int id = ni->sorted[i].id - offset;
+        if (id >= 0 && id < nview)
+            (*ids)[n++] = id;
+    }
+    if (!n) {
+        free (*ids);
+        *ids = NULL;
+        return 0;
+    }
+    qsort (*ids, n, sizeof(int), compare_ints);
+    return n;
+}
+
 int common_read_finalize_method(enum ADIOS_READ_METHOD method)
 {
     adios_errno = err_no_error;
@@ -200,6 +389,7 @@ int common_read_finalize_method(enum ADIOS_READ_METHOD method)
     } else {
         retval = adios_read_hooks[method].adios_read_finalize_method_fn ();
     }
+    adios_transform_set_read_threads (1);
 
     // finalize the query API; may call it multiple times here in multiple read methods' finalize;
     common_query_finalize(); 
@@ -377,7 +567,6 @@ ADIOS_FILE * common_read_open (const char * fname,
 {
     ADIOS_FILE * fp;
     struct common_read_internals_struct * internals; 
-    long i;
 
     if ((int)method < 0 || (int)method >= ADIOS_READ_METHOD_COUNT) {
         adios_error (err_invalid_read_method,
@@ -415,14 +604,6 @@ ADIOS_FILE * common_read_open (const char * fname,
 
     fp->is_streaming = 1; // Mark file handle as streaming
 
-    // create hashtable from the variable names as key and their index as value
-    int hashsize = calc_hash_size(fp->nvars);
-    internals->hashtbl_vars = qhashtbl(hashsize);
-    for (i=0; i<fp->nvars; i++) {
-        internals->hashtbl_vars->put (internals->hashtbl_vars, fp->var_namelist[i], 
-                                       (void *)(i+1)); // avoid 0 for error checking later
-    }
-
     // save the method and group information in fp->internal_data
     if (fp){
         adios_read_hooks[internals->method].adios_get_groupinfo_fn (fp, &internals->ngroups,
@@ -430,6 +611,7 @@ ADIOS_FILE * common_read_open (const char * fname,
         internals->group_in_view = -1;
         internals->group_varid_offset = 0;
         internals->group_attrid_offset = 0;
+        adios_block_cache_identify_file (&internals->block_cache_file, fname);
         fp->internal_data = (void *)internals;
     } else {
         free (internals);
@@ -449,7 +631,6 @@ ADIOS_FILE * common_read_open_file (const char * fname,
 {
     ADIOS_FILE * fp;
     struct common_read_internals_struct * internals; 
-    long i;
 
     if ((int)method < 0 || (int)method >= ADIOS_READ_METHOD_COUNT) {
         adios_error (err_invalid_read_method,
@@ -487,14 +668,6 @@ ADIOS_FILE * common_read_open_file (const char * fname,
     
     fp->is_streaming = 0; // Mark file handle as not streaming
 
-    // create hashtable from the variable names as key and their index as value
-    int hashsize = calc_hash_size(fp->nvars);
-    internals->hashtbl_vars = qhashtbl(hashsize);
-    for (i=0; i<fp->nvars; i++) {
-        internals->hashtbl_vars->put (internals->hashtbl_vars, fp->var_namelist[i], 
-                                       (void *)(i+1)); // avoid 0 for error checking later
-    }
-
     // save the method and group information in fp->internal_data
     if (fp){
         adios_read_hooks[internals->method].adios_get_groupinfo_fn (fp, &internals->ngroups,
@@ -502,6 +675,7 @@ ADIOS_FILE * common_read_open_file (const char * fname,
         internals->group_in_view = -1;
         internals->group_varid_offset = 0;
         internals->group_attrid_offset = 0;
+        adios_block_cache_identify_file (&internals->block_cache_file, fname);
         fp->internal_data = (void *)internals;
     } else {
         free (internals);
@@ -558,8 +732,8 @@ int common_read_close (ADIOS_FILE *fp)
 
         adios_infocache_free(&internals->infocache);
 
-        if (internals->hashtbl_vars)
-            internals->hashtbl_vars->free (internals->hashtbl_vars);
+        name_index_free (&internals->var_index);
+        name_index_free (&internals->attr_index);
 
         free (internals);
     } else {
@@ -574,6 +748,11 @@ adios_infocache * common_read_get_file_infocache(ADIOS_FILE *fp) {
 	return internals->infocache;
 }
 
+const adios_block_cache_file * common_read_get_block_cache_file(const ADIOS_FILE *fp) {
+	const struct common_read_internals_struct *internals = (const struct common_read_internals_struct *) fp->internal_data;
+	return internals->block_cache_file.valid ? &internals->block_cache_file : NULL;
+}
+
 // NCSU ALACRITY-ADIOS
 data_view_t common_read_get_data_view(const ADIOS_FILE *fp) {
 	const struct common_read_internals_struct *internals = (const struct common_read_internals_struct *) fp->internal_data;
@@ -622,9 +801,7 @@ void common_read_reset_dimension_order (const ADIOS_FILE *fp, int is_fortran)
 int common_read_advance_step (ADIOS_FILE *fp, int last, float timeout_sec)
 {
     struct common_read_internals_struct * internals;
-    int hashsize;
     int retval;
-    long i;
     
     adios_errno = err_no_error;
     if (fp) {
@@ -633,15 +810,9 @@ int common_read_advance_step (ADIOS_FILE *fp, int last, float timeout_sec)
             internals = (struct common_read_internals_struct *) fp->internal_data;
             retval = internals->read_hooks[internals->method].adios_advance_step_fn (fp, last, timeout_sec);
             if (!retval) {
-                // Re-create hashtable from the variable names as key and their index as value
-                if (internals->hashtbl_vars)
-                    internals->hashtbl_vars->free (internals->hashtbl_vars);
-                hashsize = calc_hash_size(fp->nvars);
-                internals->hashtbl_vars = qhashtbl(hashsize);
-                for (i=0; i<fp->nvars; i++) {
-                    internals->hashtbl_vars->put (internals->hashtbl_vars, fp->var_namelist[i],
-                            (void *)(i+1)); // avoid 0 for error checking later
-                }
+                // The lists of names have changed, the name indexes are rebuilt at the next lookup
+                name_index_free (&internals->var_index);
+                name_index_free (&internals->attr_index);
 
                 // Invalidate infocache, since all varinfos may have changed now
                 adios_infocache_invalidate(internals->infocache);
@@ -709,36 +880,34 @@ static int common_read_find_var (const ADIOS_FILE *fp, const char *name, int qui
 
     if (fp) {
         internals = (struct common_read_internals_struct *) fp->internal_data;
-
-        // Double cast makes the compiler happy...
-        varid = (int)(int64_t)internals->hashtbl_vars->get (internals->hashtbl_vars, name);
-        // varid=0 is "not found", otherwise +1 bigger than actual varid
-        varid--; // we added varid+1 originally to avoid double meanings of 0 (value and not-found)
+        varid = name_index_find (fp, 0, name);
+        // map the global varid back to the current group view's varid
+        if (varid >= 0) {
+            varid -= internals->group_varid_offset;
+            if (varid >= fp->nvars)
+                varid = -1; // in another group
+        }
     }
 
-    if (varid == -1) {
+    if (varid < 0) {
         if (!quiet)
             adios_error (err_invalid_varname, "Variable '%s' is not found!\n", name);
         else
             adios_errno = err_invalid_varname;
         return -1;
     }
-
-    // map the global varid back to the current group view's varid
-    varid -= internals->group_varid_offset;
     return varid;
 }
 
-static int common_read_find_attr (int n, char ** namelist, const char *name, int quiet)
+static int common_read_find_attr (const ADIOS_FILE *fp, const char *name, int quiet)
 {
     /** Find a string name in a list of names and return the index.
         Search should work with starting / characters and without.
         Create adios error and return -1 if name is null or
           if name is not found in the list.
-        role = 0 for variable search, 1 for attribute search
      */
-    int id, nstartpos=0, sstartpos;
-    char ** s = namelist;
+    struct common_read_internals_struct * internals;
+    int id = -1;
 
     if (!name) {
         if (!quiet)
@@ -748,19 +917,18 @@ static int common_read_find_attr (int n, char ** namelist, const char *name, int
         return -1;
     }
 
-    // find names with or without beginning /
-    if (*name == '/') nstartpos = 1;
-
-    for (id=0; id < n; id++) {
-        if (*s[0] == '/') sstartpos = 1;
-        else sstartpos = 0;
-        //DBG_PRINTF("     check %s, startpos=%d\n", *s, sstartpos);
-        if (!strcmp (*s+sstartpos, name+nstartpos))
-            break; // found this name
-        s++;
+    if (fp) {
+        internals = (struct common_read_internals_struct *) fp->internal_data;
+        id = name_index_find (fp, 1, name);
+        // map the global attrid back to the current group view's attrid
+        if (id >= 0) {
+            id -= internals->group_attrid_offset;
+            if (id >= fp->nattrs)
+                id = -1; // in another group
+        }
     }
-    
-    if (id == n) {
+
+    if (id < 0) {
         if (!quiet)
             adios_error (err_invalid_attrname, "Attribute '%s' is not found!\n", name);
         else
@@ -790,6 +958,34 @@ ADIOS_VARINFO * common_read_inq_var (const ADIOS_FILE *fp, const char * varname)
     return retval;
 }
 
+int common_read_inq_var_prefix (const ADIOS_FILE *fp, const char * prefix, int ** varids)
+{
+    adios_errno = err_no_error;
+    if (!fp) {
+        adios_error (err_invalid_file_pointer, "Null pointer passed as file to adios_inq_var_prefix()\n");
+        return -1;
+    }
+    if (!prefix || !varids) {
+        adios_error (err_invalid_argument, "Null pointer passed as prefix or list to adios_inq_var_prefix()\n");
+        return -1;
+    }
+    return name_index_find_prefix (fp, 0, prefix, varids);
+}
+
+int common_read_inq_attr_prefix (const ADIOS_FILE *fp, const char * prefix, int ** attrids)
+{
+    adios_errno = err_no_error;
+    if (!fp) {
+        adios_error (err_invalid_file_pointer, "Null pointer passed as file to adios_inq_attr_prefix()\n");
+        return -1;
+    }
+    if (!prefix || !attrids) {
+        adios_error (err_invalid_argument, "Null pointer passed as prefix or list to adios_inq_attr_prefix()\n");
+        return -1;
+    }
+    return name_index_find_prefix (fp, 1, prefix, attrids);
+}
+
 // NCSU ALACRITY-ADIOS - For copying original metadata from transform
 //   info to inq var info
 static void patch_varinfo_with_transform_blockinfo(ADIOS_VARINFO *vi, ADIOS_TRANSINFO *ti) {
@@ -844,40 +1040,37 @@ ADIOS_VARINFO * common_read_inq_var_byid (const ADIOS_FILE *fp, int varid)
  */
 void common_read_get_attrs_for_variable (const ADIOS_FILE *fp, ADIOS_VARINFO *vi)
 {
-    char * varpath;
-    int i; 
+    const char * varpath;
+    char * prefix;
+    int i, n, *ids;
     assert (vi != NULL);
     assert (fp != NULL);
     vi->nattrs = 0;
-    vi->attr_ids = (int *) malloc (fp->nattrs * sizeof(int));
-    assert (vi->attr_ids != NULL);
-    varpath = fp->var_namelist [vi->varid];
+    vi->attr_ids = NULL;
+    varpath = skip_leading_slash (fp->var_namelist [vi->varid]);
     log_debug ("Look for attributes of variable %s...\n", varpath);
     int varlen = strlen (varpath);
-    for (i=0; i<fp->nattrs; i++)
+    prefix = (char *) malloc (varlen + 2);
+    assert (prefix != NULL);
+    sprintf (prefix, "%s/", varpath);
+    // candidates are the attributes under <varpath>/
+    n = name_index_find_prefix (fp, 1, prefix, &ids);
+    free (prefix);
+    for (i=0; i<n; i++)
     {
         // attr must be <varpath> + / + something without /
-        const char * attr = fp->attr_namelist[i];
-        int attlen = strlen (attr);
-        if (attlen > varlen + 1)
+        const char * attr = skip_leading_slash (fp->attr_namelist[ids[i]]);
+        if (attr[varlen+1] && !strchr (attr+varlen+1, '/'))
         {
-            if (!strncmp(varpath, attr, varlen))
-            {
-                if (attr[varlen] == '/' &&
-                    !strchr (attr+varlen+1, '/'))
-                {
-                    log_debug ("    Found attr %s\n", attr);
-                    vi->attr_ids [vi->nattrs] = i;
-                    vi->nattrs++;
-                }
-            }
+            log_debug ("    Found attr %s\n", fp->attr_namelist[ids[i]]);
+            ids [vi->nattrs] = ids[i];
+            vi->nattrs++;
         }
     }
     if (vi->nattrs) {
-        vi->attr_ids = (int *) realloc (vi->attr_ids, vi->nattrs * sizeof(int));
+        vi->attr_ids = (int *) realloc (ids, vi->nattrs * sizeof(int));
     } else {
-        free(vi->attr_ids);
-        vi->attr_ids = NULL;
+        free(ids);
     }
 }
 
@@ -1180,6 +1373,8 @@ void common_read_free_transinfo(const ADIOS_VARINFO *vi, ADIOS_TRANSINFO *ti) {
         }
 
         common_read_free_blockinfo(&ti->orig_blockinfo, vi->sum_nblocks);
+        if (ti->payload_offsets) MYFREE(ti->payload_offsets);
+        if (ti->file_indexes) MYFREE(ti->file_indexes);
 
         free(ti);
     }
@@ -1226,7 +1421,7 @@ int common_read_get_attr_mesh (const ADIOS_FILE * fp,
 
     adios_errno = err_no_error;
     if (fp) {
-        int attrid = common_read_find_attr (fp->nattrs, fp->attr_namelist, attrname, 1);
+        int attrid = common_read_find_attr (fp, attrname, 1);
         if (attrid > -1) {
             retval = common_read_get_attr_byid_mesh (fp, attrid, type, size, data);
         } else {
@@ -3743,7 +3938,7 @@ int common_read_get_attr (const ADIOS_FILE * fp,
 
     adios_errno = err_no_error;
     if (fp) {
-        int attrid = common_read_find_attr (fp->nattrs, fp->attr_namelist, attrname, 0);
+        int attrid = common_read_find_attr (fp, attrname, 0);
         if (attrid > -1) {
             retval = common_read_get_attr_byid (fp, attrid, type, size, data);
         } else {
@@ -3878,14 +4073,16 @@ int common_read_group_view (ADIOS_FILE  *fp, int groupid)
             retval = 0;
 
         } else if (groupid == -1) {
-            /* Reset to full view */
-            fp->nvars  = internals->full_nvars;
-            fp->var_namelist  = internals->full_varnamelist;
-            fp->nattrs = internals->full_nattrs;
-            fp->attr_namelist  = internals->full_attrnamelist;
-            internals->group_varid_offset = 0;
-            internals->group_attrid_offset = 0;
-            internals->group_in_view = -1;
+            /* Reset to full view (if a group is in view at all) */
+            if (internals->group_in_view != -1) {
+                fp->nvars  = internals->full_nvars;
+                fp->var_namelist  = internals->full_varnamelist;
+                fp->nattrs = internals->full_nattrs;
+                fp->attr_namelist  = internals->full_attrnamelist;
+                internals->group_varid_offset = 0;
+                internals->group_attrid_offset = 0;
+                internals->group_in_view = -1;
+            }
             retval = 0;
         } else {
             adios_error (err_invalid_group, "Invalid group ID in adios_group_view()\n");
@@ -16,6 +16,7 @@
 #include "core/adios_infocache.h"
 #include "core/transforms/adios_transforms_read.h" // NCSU ALACRITY-ADIOS
 #include "core/transforms/adios_transforms_transinfo.h" // NCSU ALACRITY-ADIOS
+#include "core/transforms/adios_transforms_blockcache.h"
 
 #include <stdint.h>
 
@@ -43,6 +44,10 @@ int common_read_close(ADIOS_FILE *fp);
 // beyond the current timestep or after close.
 adios_infocache * common_read_get_file_infocache(ADIOS_FILE *fp);
 
+// Identity of the file taken at open for the block cache, NULL if the cache
+// was off or the file could not be identified
+const adios_block_cache_file * common_read_get_block_cache_file(const ADIOS_FILE *fp);
+
 data_view_t common_read_set_data_view(ADIOS_FILE *fp, data_view_t data_view); // NCSU ALACRITY-ADIOS
 data_view_t common_read_get_data_view(const ADIOS_FILE *fp);
 
@@ -52,6 +57,8 @@ void common_read_release_step (ADIOS_FILE *fp);
 ADIOS_VARINFO * common_read_inq_var (const ADIOS_FILE  *fp, const char * varname);
 ADIOS_VARINFO * common_read_inq_var_byid (const ADIOS_FILE  *fp, int varid);
 ADIOS_VARINFO * common_read_inq_var_raw_byid (const ADIOS_FILE  *fp, int varid);
+int common_read_inq_var_prefix (const ADIOS_FILE *fp, const char * prefix, int ** varids);
+int common_read_inq_attr_prefix (const ADIOS_FILE *fp, const char * prefix, int ** attrids);
 ADIOS_TRANSINFO * common_read_inq_transinfo(const ADIOS_FILE *fp, const ADIOS_VARINFO *vi); // NCSU ALACRITY-ADIOS
 int common_read_inq_var_stat (const ADIOS_FILE *fp, ADIOS_VARINFO * varinfo,
                              int per_step_stat, int per_block_stat);
@@ -0,0 +1,238 @@
+/*
+ * adios_transforms_blockcache.c
+ *
+ * Process-wide LRU cache of decoded blocks, see adios_transforms_blockcache.h.
+ * The blocks are found by key in a hash table and kept in a doubly linked
+ * list, most recently used first; the blocks at the tail are evicted when a
+ * new block does not fit.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+
+#include "core/adios_logger.h"
+#include "core/qhashtbl.h"
+#include "core/transforms/adios_transforms_blockcache.h"
+
+#define BLOCK_CACHE_HASH_RANGE 1024
+
+typedef struct block_cache_entry {
+    char *key;
+    void *data;
+    uint64_t size;
+    struct block_cache_entry *prev; // more recently used
+    struct block_cache_entry *next; // less recently used
+} block_cache_entry;
+
+static struct {
+    int initialized;
+    qhashtbl_t *table;
+    block_cache_entry *head; // most recently used
+    block_cache_entry *tail; // least recently used
+    ADIOS_BLOCK_CACHE_STATS stats;
+} cache;
+
+static void init_cache() {
+    const char *env;
+    long long mb;
+
+    if (cache.initialized)
+        return;
+    cache.initialized = 1;
+
+    env = getenv("ADIOS_BLOCK_CACHE");
+    mb = env ? atoll(env) : 0;
+    if (mb > 0)
+        cache.stats.max_bytes = (uint64_t)mb * 1024 * 1024;
+}
+
+// Size and modification time of a file when it was last identified
+typedef struct block_cache_file_state {
+    uint64_t dev;
+    uint64_t ino;
+    uint64_t generation;
+    uint64_t size;
+    int64_t mtime_ns;
+    struct block_cache_file_state *next;
+} block_cache_file_state;
+
+static block_cache_file_state *files = NULL;
+static uint64_t last_generation = 0;
+
+void adios_block_cache_identify_file(adios_block_cache_file *file, const char *path) {
+    struct stat st;
+    block_cache_file_state *f;
+    int64_t mtime_ns;
+
+    file->valid = 0;
+    if (!adios_block_cache_enabled() || !path || stat(path, &st))
+        return;
+#if defined(__APPLE__)
+    mtime_ns = (int64_t)st.st_mtimespec.tv_sec * 1000000000 + st.st_mtimespec.tv_nsec;
+#elif defined(st_mtime)
+    // st_mtime is a macro for st_mtim.tv_sec where the nanoseconds are available
+    mtime_ns = (int64_t)st.st_mtim.tv_sec * 1000000000 + st.st_mtim.tv_nsec;
+#else
+    mtime_ns = (int64_t)st.st_mtime * 1000000000;
+#endif
+
+    for (f = files; f; f = f->next)
+        if (f->dev == (uint64_t)st.st_dev && f->ino == (uint64_t)st.st_ino)
+            break;
+    if (!f) {
+        f = (block_cache_file_state *)calloc(1, sizeof(block_cache_file_state));
+        if (!f)
+            return;
+        f->dev = (uint64_t)st.st_dev;
+        f->ino = (uint64_t)st.st_ino;
+        f->generation = ++last_generation;
+        f->next = files;
+        files = f;
+    } else if ((uint64_t)st.st_size < f->size ||
+               ((uint64_t)st.st_size == f->size && mtime_ns != f->mtime_ns)) {
+        log_debug("block cache: %s was rewritten\n", path);
+        f->generation = ++last_generation;
+    }
+    f->size = (uint64_t)st.st_size;
+    f->mtime_ns = mtime_ns;
+
+    file->dev = f->dev;
+    file->ino = f->ino;
+    file->generation = f->generation;
+    file->valid = 1;
+}
+
+// The key as a string for the hash table
+static char * make_key(const adios_block_cache_key *key, char *buf, size_t len) {
+    int n = snprintf(buf, len, "%llu:%llu:%llu:%u:%llu:%llu",
+                     (unsigned long long)key->file->dev, (unsigned long long)key->file->ino,
+                     (unsigned long long)key->file->generation, (unsigned)key->file_index,
+                     (unsigned long long)key->payload_offset, (unsigned long long)key->raw_length);
+    return (n > 0 && (size_t)n < len) ? buf : NULL;
+}
+
+static void unlink_entry(block_cache_entry *e) {
+    if (e->prev) e->prev->next = e->next; else cache.head = e->next;
+    if (e->next) e->next->prev = e->prev; else cache.tail = e->prev;
+    e->prev = e->next = NULL;
+}
+
+static void link_entry_at_head(block_cache_entry *e) {
+    e->prev = NULL;
+    e->next = cache.head;
+    if (cache.head) cache.head->prev = e; else cache.tail = e;
+    cache.head = e;
+}
+
+static void evict_entry(block_cache_entry *e) {
+    unlink_entry(e);
+    cache.table->remove(cache.table, e->key);
+    cache.stats.nblocks--;
+    cache.stats.bytes -= e->size;
+    free(e->key);
+    free(e->data);
+    free(e);
+}
+
+int adios_block_cache_enabled() {
+    init_cache();
+    return cache.stats.max_bytes > 0;
+}
+
+const void * adios_block_cache_get(const adios_block_cache_key *key, uint64_t *size) {
+    char buf[128];
+    block_cache_entry *e = NULL;
+
+    if (!adios_block_cache_enabled())
+        return NULL;
+
+    if (cache.table && make_key(key, buf, sizeof(buf)))
+        e = (block_cache_entry *)cache.table->get(cache.table, buf);
+
+    if (!e) {
+        cache.stats.misses++;
+        return NULL;
+    }
+
+    cache.stats.hits++;
+    unlink_entry(e);
+    link_entry_at_head(e);
+    *size = e->size;
+    return e->data;
+}
+
+void adios_block_cache_put(const adios_block_cache_key *key, const void *data, uint64_t size) {
+    char buf[128];
+    block_cache_entry *e;
+
+    if (!adios_block_cache_enabled() || size == 0 || size > cache.stats.max_bytes)
+        return;
+    if (!make_key(key, buf, sizeof(buf)))
+        return;
+
+    if (!cache.table) {
+        cache.table = qhashtbl(BLOCK_CACHE_HASH_RANGE);
+        if (!cache.table)
+            return;
+    }
+
+    // The same block decoded twice before it was cached
+    e = (block_cache_entry *)cache.table->get(cache.table, buf);
+    if (e) {
+        unlink_entry(e);
+        link_entry_at_head(e);
+        return;
+    }
+
+    while (cache.tail && cache.stats.bytes + size > cache.stats.max_bytes) {
+        evict_entry(cache.tail);
+        cache.stats.evictions++;
+    }
+
+    e = (block_cache_entry *)calloc(1, sizeof(block_cache_entry));
+    if (!e)
+        return;
+    e->key = strdup(buf);
+    e->data = malloc(size);
+    if (!e->key || !e->data) {
+        free(e->key);
+        free(e->data);
+        free(e);
+        return;
+    }
+    memcpy(e->data, data, size);
+    e->size = size;
+
+    cache.table->put(cache.table, e->key, e);
+    link_entry_at_head(e);
+    cache.stats.nblocks++;
+    cache.stats.bytes += size;
+}
+
+void adios_block_cache_set_size(uint64_t max_bytes) {
+    init_cache();
+    cache.stats.max_bytes = max_bytes;
+
+    while (cache.tail && cache.stats.bytes > cache.stats.max_bytes) {
+        evict_entry(cache.tail);
+        cache.stats.evictions++;
+    }
+    if (!max_bytes && cache.table) {
+        cache.table->free(cache.table);
+        cache.table = NULL;
+    }
+    log_debug("block cache set to %llu bytes\n", (unsigned long long)max_bytes);
+}
+
+void adios_block_cache_get_stats(ADIOS_BLOCK_CACHE_STATS *stats) {
+    init_cache();
+    *stats = cache.stats;
+}
+
+void adios_block_cache_reset_stats() {
+    cache.stats.hits = 0;
+    cache.stats.misses = 0;
+    cache.stats.evictions = 0;
+}
@@ -0,0 +1,65 @@
+/*
+ * adios_transforms_blockcache.h
+ *
+ * A process-wide LRU cache of decoded blocks of transformed variables.
+ * A block is identified by the file it is stored in and the offset of its
+ * transformed payload in that file (and subfile), so it is found again when
+ * the file is reopened or read through another ADIOS_FILE. The file is
+ * identified once when it is opened, by device, inode and a generation that
+ * changes when the file is rewritten but not when steps are appended to it,
+ * so appended files keep their blocks and rewritten files miss them. Only
+ * whole decoded blocks are kept, bounded by a total size in bytes. A read
+ * with a user buffer whose block is in the cache skips both the file read
+ * and the decoding.
+ *
+ * The cache is off until adios_read_set_block_cache() gives it a size, or the
+ * ADIOS_BLOCK_CACHE environment variable sets one in MB.
+ */
+
+#ifndef ADIOS_TRANSFORMS_BLOCKCACHE_H_
+#define ADIOS_TRANSFORMS_BLOCKCACHE_H_
+
+#include <stdint.h>
+#include "public/adios_read_ext.h"
+
+typedef struct {
+    int valid;           // 0 if the file could not be identified, then nothing is cached
+    uint64_t dev;
+    uint64_t ino;
+    uint64_t generation; // see adios_block_cache_identify_file()
+} adios_block_cache_file;
+
+typedef struct {
+    const adios_block_cache_file *file;
+    uint32_t file_index;     // subfile
+    uint64_t payload_offset; // of the transformed block in the (sub)file
+    uint64_t raw_length;     // size of the transformed block
+} adios_block_cache_key;
+
+/* Identifies the file at path, once when it is opened. The generation is
+ * kept if the file has only grown since it was last identified in this
+ * process (steps appended) and changes if it shrank or was modified without
+ * growing (rewritten). A rewrite that leaves the file larger than before is
+ * taken for an append; its blocks still miss unless they have the same
+ * offset and transformed size as blocks of the old file.
+ * Sets file->valid to 0 if the cache is off or the file cannot be stat'ed. */
+void adios_block_cache_identify_file(adios_block_cache_file *file, const char *path);
+
+/* Non-zero if the cache has a size */
+int adios_block_cache_enabled();
+
+/* Returns the decoded block and sets *size, or returns NULL. Counts a hit or a
+ * miss. The pointer is valid until the next adios_block_cache_* call. */
+const void * adios_block_cache_get(const adios_block_cache_key *key, uint64_t *size);
+
+/* Copies a decoded block into the cache, evicting the least recently used
+ * blocks to make room. Blocks larger than the cache are not kept. */
+void adios_block_cache_put(const adios_block_cache_key *key, const void *data, uint64_t size);
+
+/* Sets the size of the cache, 0 turns it off and frees all blocks */
+void adios_block_cache_set_size(uint64_t max_bytes);
+
+void adios_block_cache_get_stats(ADIOS_BLOCK_CACHE_STATS *stats);
+void adios_block_cache_reset_stats();
+
+#endif /* ADIOS_TRANSFORMS_BLOCKCACHE_H_ */
@@ -0,0 +1,344 @@
+/*
+ * Chunked compression support for the compression transform plugins.
+ * See adios_transforms_chunked.h for the layout of the chunk table.
+ */
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <assert.h>
+#include "config.h"
+#if HAVE_PTHREAD
+#include <pthread.h>
+#endif
+
+#include "core/adios_logger.h"
+#include "core/transforms/adios_transforms_chunked.h"
+
+#define TABLE_HEADER_SIZE (sizeof(uint32_t) + sizeof(uint64_t))
+
+void adios_transform_chunked_parse_spec(const struct adios_transform_spec *spec,
+                                        int *max_chunks, int *nthreads)
+{
+    int i;
+    *max_chunks = 0;
+    *nthreads = 1;
+    if (!spec)
+        return;
+
+    for (i = 0; i < spec->param_count; i++) {
+        const struct adios_transform_spec_kv_pair *param = &spec->params[i];
+        if (!param->key || !param->value)
+            continue;
+        if (!strcmp(param->key, "chunks")) {
+            *max_chunks = atoi(param->value);
+            if (*max_chunks < 0)
+                *max_chunks = 0;
+            if (*max_chunks > ADIOS_CHUNKED_MAX_CHUNKS) {
+                log_warn("Transform parameter chunks=%d is too large, using %d chunks\n",
+                         *max_chunks, ADIOS_CHUNKED_MAX_CHUNKS);
+                *max_chunks = ADIOS_CHUNKED_MAX_CHUNKS;
+            }
+        } else if (!strcmp(param->key, "threads")) {
+            *nthreads = atoi(param->value);
+            if (*nthreads < 1)
+                *nthreads = 1;
+        }
+    }
+}
+
+uint16_t adios_transform_chunked_metadata_size(int max_chunks)
+{
+    return (uint16_t)(TABLE_HEADER_SIZE + max_chunks * sizeof(uint64_t));
+}
+
+uint32_t adios_transform_chunked_nchunks(const void *metadata)
+{
+    uint32_t nchunks;
+    memcpy(&nchunks, metadata, sizeof(uint32_t));
+    return nchunks;
+}
+
+uint64_t adios_transform_chunked_chunk_size(const void *metadata)
+{
+    uint64_t chunk_size;
+    memcpy(&chunk_size, (const char *)metadata + sizeof(uint32_t), sizeof(uint64_t));
+    return chunk_size;
+}
+
+uint64_t adios_transform_chunked_chunk_end(const void *metadata, uint32_t chunk)
+{
+    uint64_t end;
+    memcpy(&end, (const char *)metadata + TABLE_HEADER_SIZE + chunk * sizeof(uint64_t), sizeof(uint64_t));
+    return end;
+}
+
+uint64_t adios_transform_chunked_chunk_start(const void *metadata, uint32_t chunk)
+{
+    return chunk ? adios_transform_chunked_chunk_end(metadata, chunk - 1) : 0;
+}
+
+const void * adios_transform_chunked_table(const void *metadata, uint16_t metadata_len,
+                                           uint16_t table_offset)
+{
+    const void *table = (const char *)metadata + table_offset;
+
+    if (!metadata || metadata_len < table_offset + TABLE_HEADER_SIZE)
+        return NULL;
+    if (adios_transform_chunked_nchunks(table) == 0 ||
+        adios_transform_chunked_nchunks(table) > ADIOS_CHUNKED_MAX_CHUNKS ||
+        metadata_len < table_offset + adios_transform_chunked_metadata_size(adios_transform_chunked_nchunks(table)))
+        return NULL;
+    return table;
+}
+
+static void set_chunk_end(void *metadata, uint32_t chunk, uint64_t end)
+{
+    memcpy((char *)metadata + TABLE_HEADER_SIZE + chunk * sizeof(uint64_t), &end, sizeof(uint64_t));
+}
+
+/*
+ * Work shared by the threads: chunks are taken one at a time from a counter,
+ * since the time to (de)compress a chunk varies with its content.
+ */
+struct chunked_work
+{
+    const char *in;
+    char *out;
+    uint64_t raw_len;       // raw size of the whole block
+    uint64_t chunk_size;
+    uint32_t first_chunk;
+    uint32_t last_chunk;
+    uint32_t next_chunk;
+    uint64_t *lengths;      // compress: stored length of each chunk
+    const void *metadata;   // decompress: chunk table
+    adios_chunked_codec_fn codec;
+    void *arg;
+    int error;
+#if HAVE_PTHREAD
+    pthread_mutex_t lock;
+    int threaded;
+#endif
+};
+
+static int next_chunk(struct chunked_work *w, uint32_t *chunk)
+{
+    int found = 0;
+#if HAVE_PTHREAD
+    if (w->threaded)
+        pthread_mutex_lock(&w->lock);
+#endif
+    if (w->next_chunk <= w->last_chunk) {
+        *chunk = w->next_chunk++;
+        found = 1;
+    }
+#if HAVE_PTHREAD
+    if (w->threaded)
+        pthread_mutex_unlock(&w->lock);
+#endif
+    return found;
+}
+
+static uint64_t raw_chunk_length(const struct chunked_work *w, uint32_t chunk)
+{
+    uint64_t start = chunk * w->chunk_size;
+    return (w->raw_len - start < w->chunk_size) ? w->raw_len - start : w->chunk_size;
+}
+
+// Each chunk is compressed in place at its raw offset in the output
+static void * compress_chunks(void *arg)
+{
+    struct chunked_work *w = (struct chunked_work *) arg;
+    uint32_t c;
+
+    while (next_chunk(w, &c)) {
+        const char *src = w->in + c * w->chunk_size;
+        char *dst = w->out + c * w->chunk_size;
+        uint64_t raw_len = raw_chunk_length(w, c);
+        uint64_t out_len = raw_len;
+
+        if (w->codec(src, raw_len, dst, &out_len, w->arg) != 0 || out_len >= raw_len) {
+            memcpy(dst, src, raw_len);
+            out_len = raw_len;
+        }
+        w->lengths[c] = out_len;
+    }
+    return NULL;
+}
+
+static void * decompress_chunks(void *arg)
+{
+    struct chunked_work *w = (struct chunked_work *) arg;
+    uint64_t base = adios_transform_chunked_chunk_start(w->metadata, w->first_chunk);
+    uint32_t c;
+
+    while (next_chunk(w, &c)) {
+        uint64_t start = adios_transform_chunked_chunk_start(w->metadata, c);
+        uint64_t stored_len = adios_transform_chunked_chunk_end(w->metadata, c) - start;
+        uint64_t raw_len = raw_chunk_length(w, c);
+        uint64_t out_len = raw_len;
+        const char *src = w->in + (start - base);
+        char *dst = w->out + (uint64_t)(c - w->first_chunk) * w->chunk_size;
+
+        if (stored_len == raw_len) {
+            memcpy(dst, src, raw_len);
+        } else if (w->codec(src, stored_len, dst, &out_len, w->arg) != 0 || out_len != raw_len) {
+            w->error = 1;
+        }
+    }
+    return NULL;
+}
+
+// Runs 'func' on the calling thread and nthreads-1 other threads
+static void run_chunks(struct chunked_work *w, int nthreads, void * (*func)(void *))
+{
+    uint32_t nchunks = w->last_chunk - w->first_chunk + 1;
+
+    w->next_chunk = w->first_chunk;
+    w->error = 0;
+#if HAVE_PTHREAD
+    w->threaded = 0;
+    if (nthreads > nchunks)
+        nthreads = nchunks;
+
+    if (nthreads > 1) {
+        pthread_t *threads = (pthread_t *) malloc(nthreads * sizeof(pthread_t));
+        int started = 0, i;
+
+        pthread_mutex_init(&w->lock, NULL);
+        w->threaded = 1;
+        for (i = 1; i < nthreads; i++) {
+            if (pthread_create(&threads[i], NULL, func, w)) {
+                log_warn("Could not create transform thread, continuing with %d threads\n", i);
+                break;
+            }
+            started = i;
+        }
+
+        func(w);
+
+        for (i = 1; i <= started; i++) {
+            pthread_join(threads[i], NULL);
+        }
+        pthread_mutex_destroy(&w->lock);
+        free(threads);
+        return;
+    }
+#endif
+    func(w);
+}
+
+uint64_t adios_transform_chunked_compress(const void *in, uint64_t in_len, int elem_size,
+                                          void *out, int max_chunks, int nthreads,
+                                          adios_chunked_codec_fn compress, void *arg,
+                                          void *metadata)
+{
+    struct chunked_work w;
+    uint64_t chunk_size, pos;
+    uint32_t nchunks, c;
+
+    assert(max_chunks > 0 && elem_size > 0);
+
+    chunk_size = (in_len + max_chunks - 1) / max_chunks;
+    if (chunk_size < ADIOS_CHUNKED_MIN_CHUNK_SIZE)
+        chunk_size = ADIOS_CHUNKED_MIN_CHUNK_SIZE;
+    chunk_size = (chunk_size + elem_size - 1) / elem_size * elem_size;
+    nchunks = (uint32_t)((in_len + chunk_size - 1) / chunk_size);
+
+    memset(metadata, 0, adios_transform_chunked_metadata_size(max_chunks));
+    memcpy(metadata, &nchunks, sizeof(uint32_t));
+    memcpy((char *)metadata + sizeof(uint32_t), &chunk_size, sizeof(uint64_t));
+    if (nchunks == 0)
+        return 0;
+
+    memset(&w, 0, sizeof(w));
+    w.in = (const char *) in;
+    w.out = (char *) out;
+    w.raw_len = in_len;
+    w.chunk_size = chunk_size;
+    w.first_chunk = 0;
+    w.last_chunk = nchunks - 1;
+    w.lengths = (uint64_t *) malloc(nchunks * sizeof(uint64_t));
+    w.codec = compress;
+    w.arg = arg;
+    run_chunks(&w, nthreads, compress_chunks);
+
+    // Close the gaps between the chunks. Chunk c only moves down, to or before
+    // its own raw offset, so moving the chunks in order is safe.
+    pos = 0;
+    for (c = 0; c < nchunks; c++) {
+        if (pos != c * chunk_size)
+            memmove(w.out + pos, w.out + c * chunk_size, w.lengths[c]);
+        pos += w.lengths[c];
+        set_chunk_end(metadata, c, pos);
+    }
+
+    free(w.lengths);
+    return pos;
+}
+
+int adios_transform_chunked_find_chunks(const void *metadata, int elem_size,
+                                        const ADIOS_SELECTION *bounds,
+                                        const ADIOS_SELECTION *intersection,
+                                        uint32_t *first_chunk, uint32_t *last_chunk)
+{
+    uint32_t nchunks = adios_transform_chunked_nchunks(metadata);
+    uint64_t chunk_size = adios_transform_chunked_chunk_size(metadata);
+    uint64_t first = 0, last = 0;
+    int d;
+
+    *first_chunk = 0;
+    *last_chunk = nchunks ? nchunks - 1 : 0;
+    if (nchunks <= 1 || !bounds || !intersection
+        || bounds->type != ADIOS_SELECTION_BOUNDINGBOX
+        || intersection->type != ADIOS_SELECTION_BOUNDINGBOX
+        || bounds->u.bb.ndim != intersection->u.bb.ndim)
+        return 0;
+
+    // Linear offsets of the first and last element of the intersection in the block
+    for (d = 0; d < bounds->u.bb.ndim; d++) {
+        const uint64_t rel = intersection->u.bb.start[d] - bounds->u.bb.start[d];
+        if (intersection->u.bb.count[d] == 0)
+            return 0;
+        first = first * bounds->u.bb.count[d] + rel;
+        last = last * bounds->u.bb.count[d] + rel + intersection->u.bb.count[d] - 1;
+    }
+
+    *first_chunk = (uint32_t)(first * elem_size / chunk_size);
+    *last_chunk = (uint32_t)(((last + 1) * elem_size - 1) / chunk_size);
+    if (*last_chunk >= nchunks)
+        *last_chunk = nchunks - 1;
+    return (*first_chunk > 0 || *last_chunk < nchunks - 1);
+}
+
+int adios_transform_chunked_decompress(const void *metadata, const void *in,
+                                       uint32_t first_chunk, uint32_t last_chunk,
+                                       uint64_t raw_len, void *out, int nthreads,
+                                       adios_chunked_codec_fn decompress, void *arg)
+{
+    struct chunked_work w;
+
+    if (adios_transform_chunked_nchunks(metadata) == 0)
+        return 0;
+
+    memset(&w, 0, sizeof(w));
+    w.in = (const char *) in;
+    w.out = (char *) out;
+    w.raw_len = raw_len;
+    w.chunk_size = adios_transform_chunked_chunk_size(metadata);
+    w.first_chunk = first_chunk;
+    w.last_chunk = last_chunk;
+    w.metadata = metadata;
+    w.codec = decompress;
+    w.arg = arg;
+    run_chunks(&w, nthreads, decompress_chunks);
+
+    return w.error ? -1 : 0;
+}
+
+int adios_transform_chunked_read_threads()
+{
+    const char *env = getenv("ADIOS_TRANSFORM_THREADS");
+    int nthreads = env ? atoi(env) : 1;
+    return (nthreads > 1) ? nthreads : 1;
+}
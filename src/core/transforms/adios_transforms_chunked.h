@@ -0,0 +1,95 @@
+/*
+ * Chunked compression support for the compression transform plugins.
+ *
+ * A block of data is split into independently compressed chunks of equal
+ * raw size, so that chunks can be compressed and decompressed by several
+ * threads, and a reader can decompress only the chunks that overlap with
+ * its selection instead of the whole block.
+ *
+ * The plugin appends a chunk table to its own transform metadata:
+ *   [uint32 nchunks][uint64 chunk_size][uint64 end offset] x max_chunks
+ * where end offset i is the offset in the transformed data right after the
+ * (stored) chunk i. A chunk whose stored length equals its raw length is
+ * stored uncompressed.
+ */
+
+#ifndef ADIOS_TRANSFORMS_CHUNKED_H_
+#define ADIOS_TRANSFORMS_CHUNKED_H_
+
+#include <stdint.h>
+#include "public/adios_selection.h"
+#include "core/transforms/adios_transforms_specparse.h"
+
+#define ADIOS_CHUNKED_MAX_CHUNKS 1024
+#define ADIOS_CHUNKED_MIN_CHUNK_SIZE 65536
+
+/*
+ * Compress or decompress 'in_len' bytes into 'out'. *out_len holds the
+ * capacity of 'out' on entry and the produced length on return.
+ * Returns 0 on success.
+ */
+typedef int (*adios_chunked_codec_fn) (const void *in, uint64_t in_len,
+                                       void *out, uint64_t *out_len, void *arg);
+
+/*
+ * Looks for "chunks=N" and "threads=T" among the parameters of a transform spec.
+ * @param max_chunks set to N (capped at ADIOS_CHUNKED_MAX_CHUNKS), or 0 if chunking
+ *        is not requested
+ * @param nthreads set to T, or 1
+ */
+void adios_transform_chunked_parse_spec(const struct adios_transform_spec *spec,
+                                        int *max_chunks, int *nthreads);
+
+/* Size of the chunk table for a given maximum number of chunks */
+uint16_t adios_transform_chunked_metadata_size(int max_chunks);
+
+/*
+ * Compresses 'in' chunk by chunk into 'out', which must have room for
+ * 'in_len' bytes (chunks that do not shrink are stored raw). Chunk sizes are
+ * multiples of 'elem_size'. Fills the chunk table at 'metadata'.
+ * @return the length of the transformed data
+ */
+uint64_t adios_transform_chunked_compress(const void *in, uint64_t in_len, int elem_size,
+                                          void *out, int max_chunks, int nthreads,
+                                          adios_chunked_codec_fn compress, void *arg,
+                                          void *metadata);
+
+/*
+ * Returns the chunk table found at 'table_offset' in the transform metadata of
+ * a block, or NULL if the metadata is too short to hold it.
+ */
+const void * adios_transform_chunked_table(const void *metadata, uint16_t metadata_len,
+                                           uint16_t table_offset);
+
+/* Accessors of the chunk table */
+uint32_t adios_transform_chunked_nchunks(const void *metadata);
+uint64_t adios_transform_chunked_chunk_size(const void *metadata);
+uint64_t adios_transform_chunked_chunk_start(const void *metadata, uint32_t chunk);
+uint64_t adios_transform_chunked_chunk_end(const void *metadata, uint32_t chunk);
+
+/*
+ * Finds the chunks [*first_chunk, *last_chunk] that contain the elements of
+ * 'intersection' within the block 'bounds' (bounding boxes of the same
+ * dimensionality). For other selections all chunks are returned.
+ * @return 1 if only part of the block is needed, 0 if all chunks are needed
+ */
+int adios_transform_chunked_find_chunks(const void *metadata, int elem_size,
+                                        const ADIOS_SELECTION *bounds,
+                                        const ADIOS_SELECTION *intersection,
+                                        uint32_t *first_chunk, uint32_t *last_chunk);
+
+/*
+ * Decompresses chunks [first_chunk, last_chunk] into 'out'. 'in' holds the
+ * stored chunks starting with first_chunk, 'raw_len' is the raw size of the
+ * whole block. Uses 'nthreads' threads.
+ * @return 0 on success, -1 if a chunk fails to decompress
+ */
+int adios_transform_chunked_decompress(const void *metadata, const void *in,
+                                       uint32_t first_chunk, uint32_t last_chunk,
+                                       uint64_t raw_len, void *out, int nthreads,
+                                       adios_chunked_codec_fn decompress, void *arg);
+
+/* Number of threads for decompression, from the ADIOS_TRANSFORM_THREADS environment variable (default 1) */
+int adios_transform_chunked_read_threads();
+
+#endif /* ADIOS_TRANSFORMS_CHUNKED_H_ */
@@ -0,0 +1,32 @@
+/*
+ * Read side of the chunked compression support for the compression
+ * transform plugins. See adios_transforms_chunked_read.h.
+ */
+
+#include <stdint.h>
+
+#include "core/adios_internals.h" // adios_get_type_size()
+#include "core/transforms/adios_transforms_chunked_read.h"
+
+#define CHUNKED_STATUS 2
+
+const void * adios_transform_chunked_pg_table(const adios_transform_pg_read_request *pg_reqgroup)
+{
+    const char *meta = (const char *)pg_reqgroup->transform_metadata;
+    if (!meta || pg_reqgroup->transform_metadata_len <= ADIOS_CHUNKED_META_BASE_LEN ||
+        meta[sizeof(uint64_t)] != CHUNKED_STATUS)
+        return NULL;
+    return adios_transform_chunked_table(meta, pg_reqgroup->transform_metadata_len,
+                                         ADIOS_CHUNKED_META_BASE_LEN);
+}
+
+int adios_transform_chunked_pg_find_chunks(const adios_transform_read_request *reqgroup,
+                                           const adios_transform_pg_read_request *pg_reqgroup,
+                                           const void *table,
+                                           uint32_t *first_chunk, uint32_t *last_chunk)
+{
+    return adios_transform_chunked_find_chunks(table,
+                adios_get_type_size(reqgroup->transinfo->orig_type, ""),
+                pg_reqgroup->pg_bounds_sel, pg_reqgroup->pg_intersection_sel,
+                first_chunk, last_chunk);
+}
@@ -0,0 +1,36 @@
+/*
+ * Read side of the chunked compression support (see adios_transforms_chunked.h),
+ * shared by the compression transform plugins.
+ *
+ * The plugins using it store their own transform metadata as
+ *   [uint64 raw size][char status][chunk table]
+ * where status 2 means that the block was compressed in chunks.
+ */
+
+#ifndef ADIOS_TRANSFORMS_CHUNKED_READ_H_
+#define ADIOS_TRANSFORMS_CHUNKED_READ_H_
+
+#include <stdint.h>
+#include "core/transforms/adios_transforms_reqgroup.h"
+#include "core/transforms/adios_transforms_chunked.h"
+
+/* Offset of the chunk table in the transform metadata */
+#define ADIOS_CHUNKED_META_BASE_LEN (sizeof(uint64_t) + sizeof(char))
+
+/*
+ * Returns the chunk table of the block read by 'pg_reqgroup' if it was
+ * compressed in chunks, NULL otherwise.
+ */
+const void * adios_transform_chunked_pg_table(const adios_transform_pg_read_request *pg_reqgroup);
+
+/*
+ * Finds the chunks [*first_chunk, *last_chunk] of the block that overlap with
+ * the part of the selection in it.
+ * @return 1 if it is not all chunks, 0 otherwise
+ */
+int adios_transform_chunked_pg_find_chunks(const adios_transform_read_request *reqgroup,
+                                           const adios_transform_pg_read_request *pg_reqgroup,
+                                           const void *table,
+                                           uint32_t *first_chunk, uint32_t *last_chunk);
+
+#endif /* ADIOS_TRANSFORMS_CHUNKED_READ_H_ */
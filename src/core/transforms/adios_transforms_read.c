@@ -1,5 +1,10 @@
 #include <stddef.h>
 #include <assert.h>
+#include <string.h>
+#include "config.h"
+#if HAVE_PTHREAD
+#include <pthread.h>
+#endif
 
 #include "core/adios_bp_v1.h"
 #include "core/adios_internals.h"
@@ -22,10 +27,13 @@
 #include "core/transforms/adios_transforms_read.h"
 #include "core/transforms/adios_transforms_util.h"
 #include "core/transforms/adios_patchdata.h"
+#include "core/transforms/adios_transforms_blockcache.h"
 
 // Utilities
 #define FREE(p) {if (p){free(p); (p)=NULL;}}
 
+static int apply_datablock_to_result(adios_datablock *datablock, adios_transform_read_request *reqgroup);
+
 // Read request inspection
 enum ADIOS_TRANSFORM_REQGROUP_RESULT_MODE adios_transform_read_request_get_mode(const adios_transform_read_request *req) {
     return req->orig_data != NULL ? FULL_RESULT_MODE : PARTIAL_RESULT_MODE;
@@ -192,6 +200,96 @@ inline static const ADIOS_SELECTION * create_writeblock_bounds(const ADIOS_SELEC
     return create_pg_bounds_from_varblock(transinfo->orig_ndim, vb_bounds);
 }
 
+// Key of a PG in the block cache: the file identified at open and the offset
+// of the transformed PG in it, which appending steps to the file does not move.
+static int get_pg_cache_key(const adios_transform_read_request *reqgroup,
+                            const adios_transform_pg_read_request *pg_reqgroup,
+                            adios_block_cache_key *key)
+{
+    const ADIOS_TRANSINFO *ti = reqgroup->transinfo;
+    const int blockidx = pg_reqgroup->blockidx;
+
+    if (ti->orig_type == adios_string || !ti->payload_offsets || !ti->file_indexes ||
+        !ti->payload_offsets[blockidx])
+        return 0;
+
+    key->file = common_read_get_block_cache_file(reqgroup->fp);
+    if (!key->file)
+        return 0;
+    key->file_index = ti->file_indexes[blockidx];
+    key->payload_offset = ti->payload_offsets[blockidx];
+    key->raw_length = pg_reqgroup->raw_var_length;
+    return 1;
+}
+
+// Size of a whole decoded PG in bytes
+static uint64_t get_pg_decoded_size(const adios_transform_read_request *reqgroup,
+                                    const adios_transform_pg_read_request *pg_reqgroup)
+{
+    uint64_t size = adios_get_type_size(reqgroup->transinfo->orig_type, NULL);
+    int i;
+    for (i = 0; i < pg_reqgroup->orig_ndim; i++)
+        size *= pg_reqgroup->orig_varblock->count[i];
+    return size;
+}
+
+// If the PG is in the block cache, patch it into the user buffer and return 1,
+// so that it is neither read nor decoded. Only done for reads into a user
+// buffer, partial results (adios_check_reads chunks) are read as usual.
+static int serve_pg_from_block_cache(adios_transform_read_request *reqgroup,
+                                     const adios_transform_pg_read_request *pg_reqgroup)
+{
+    adios_block_cache_key key;
+    adios_datablock *datablock;
+    const void *data;
+    uint64_t size = 0;
+
+    if (!reqgroup->orig_data || !adios_block_cache_enabled() ||
+        !get_pg_cache_key(reqgroup, pg_reqgroup, &key))
+        return 0;
+
+    data = adios_block_cache_get(&key, &size);
+    if (!data || size != get_pg_decoded_size(reqgroup, pg_reqgroup))
+        return 0;
+
+    datablock = adios_datablock_new(reqgroup->transinfo->orig_type, pg_reqgroup->timestep,
+                                    pg_reqgroup->pg_writeblock_sel, (void *)data);
+    apply_datablock_to_result(datablock, reqgroup);
+    adios_datablock_free(&datablock, 0); // the data belongs to the cache
+    return 1;
+}
+
+// Whether a datablock returned by a transform plugin holds a whole decoded PG.
+// Only datablocks made by adios_datablock_new_whole_pg() are trusted: plugins
+// that decode part of a PG (chunked zlib, zfp) return its bounding box and a
+// buffer holding the decoded part only.
+static int is_whole_pg_datablock(const adios_datablock *datablock,
+                                 const adios_transform_pg_read_request *pg_reqgroup)
+{
+    const ADIOS_SELECTION *b = datablock->bounds;
+
+    return b->type == ADIOS_SELECTION_WRITEBLOCK &&
+           datablock->ragged_offset == 0 &&
+           datablock->timestep == pg_reqgroup->timestep &&
+           b->u.block.index == pg_reqgroup->blockidx &&
+           b->u.block.is_absolute_index && !b->u.block.is_sub_pg_selection;
+}
+
+// Keep a copy of a datablock in the block cache if it is a whole decoded PG
+static void add_datablock_to_block_cache(const adios_transform_read_request *reqgroup,
+                                         const adios_transform_pg_read_request *pg_reqgroup,
+                                         const adios_datablock *datablock)
+{
+    adios_block_cache_key key;
+
+    if (!adios_block_cache_enabled() ||
+        !is_whole_pg_datablock(datablock, pg_reqgroup) ||
+        !get_pg_cache_key(reqgroup, pg_reqgroup, &key))
+        return;
+
+    adios_block_cache_put(&key, datablock->data, get_pg_decoded_size(reqgroup, pg_reqgroup));
+}
+
 static int generate_read_request_for_pg(
 		const ADIOS_VARINFO *raw_varinfo, const ADIOS_TRANSINFO *transinfo,
 		const ADIOS_SELECTION *sel,
@@ -230,7 +328,13 @@ static int generate_read_request_for_pg(
                                                               transinfo->transform_metadatas[blockidx].content,
                                                               (uint16_t)transinfo->transform_metadatas[blockidx].length);
 
-        adios_transform_generate_read_subrequests(readreq, new_pg_readreq);
+        if (serve_pg_from_block_cache(readreq, new_pg_readreq)) {
+            // Nothing to read for this PG
+            new_pg_readreq->completed = 1;
+            readreq->num_completed_pg_reqgroups++;
+        } else {
+            adios_transform_generate_read_subrequests(readreq, new_pg_readreq);
+        }
         adios_transform_pg_read_request_append(readreq, new_pg_readreq);
 
         // Don't free pg_bounds_sel or pg_intersection_sel, since they are now
@@ -355,6 +459,9 @@ adios_transform_read_request * adios_transform_generate_read_reqgroup(const ADIO
     if (new_readreq->num_pg_reqgroups == 0) {
         adios_transform_read_request_free(&new_readreq);
         new_readreq = NULL;
+    } else if (new_readreq->num_completed_pg_reqgroups == new_readreq->num_pg_reqgroups) {
+        // All PGs were served from the block cache
+        new_readreq->completed = 1;
     }
 
     return new_readreq;
@@ -389,6 +496,9 @@ static adios_datablock * finish_subreq(
         }
     }
 
+    if (result)
+        add_datablock_to_block_cache(reqgroup, pg_reqgroup, result);
+
     if (reqgroup->completed) {
         tmp_result = adios_transform_read_reqgroup_completed(reqgroup);
         if (tmp_result) {
@@ -533,7 +643,7 @@ static uint64_t apply_datablock_to_buffer_nonlocal_selections(
  *         no data in the given datablock was pertinent to the given output
  *         buffer selection)
  */
-static uint64_t apply_datablock_to_buffer_and_free(
+static uint64_t apply_datablock_to_buffer(
 		const ADIOS_VARINFO *raw_varinfo, const ADIOS_TRANSINFO *transinfo,
 		adios_datablock *datablock,
         void **output_buffer, const ADIOS_SELECTION *output_sel, ADIOS_SELECTION **out_inter_sel, enum ADIOS_FLAG swap_endianness)
@@ -591,6 +701,19 @@ static uint64_t apply_datablock_to_buffer_and_free(
 		}
 	}
 
+    return used_count;
+}
+
+// The same, then frees the datablock and its data
+static uint64_t apply_datablock_to_buffer_and_free(
+		const ADIOS_VARINFO *raw_varinfo, const ADIOS_TRANSINFO *transinfo,
+		adios_datablock *datablock,
+        void **output_buffer, const ADIOS_SELECTION *output_sel, ADIOS_SELECTION **out_inter_sel, enum ADIOS_FLAG swap_endianness)
+{
+    const uint64_t used_count =
+            apply_datablock_to_buffer(raw_varinfo, transinfo, datablock,
+                                      output_buffer, output_sel, out_inter_sel, swap_endianness);
+
     // Free the datablock
     adios_datablock_free(&datablock, 1);
     return used_count;
@@ -598,18 +721,16 @@ static uint64_t apply_datablock_to_buffer_and_free(
 
 /*
  * Takes a datablock and applies its data to the user buffer for the given
- * read request group, then frees the given datablock. Assumes there is, in
- * fact, a user buffer (i.e., it is not NULL).
+ * read request group. Assumes there is, in fact, a user buffer (i.e., it is
+ * not NULL).
  *
  * Assumes that the datablock selection is of type bounding box.
  *
- * NOTE: also frees the data buffer within the datablock
- *
  * @return non-zero if some data in the datablock intersected the read
  *         request's selection, and was applied; returns 0 otherwise.
  */
-static int apply_datablock_to_result_and_free(adios_datablock *datablock,
-                                              adios_transform_read_request *reqgroup)
+static int apply_datablock_to_result(adios_datablock *datablock,
+                                     adios_transform_read_request *reqgroup)
 {
     assert(datablock); assert(reqgroup);
     assert(reqgroup->orig_sel);
@@ -648,7 +769,7 @@ static int apply_datablock_to_result_and_free(adios_datablock *datablock,
 
     // Now that we have the output buffer pointer, actually perform the patch operation
     const uint64_t used_count =
-            apply_datablock_to_buffer_and_free(
+            apply_datablock_to_buffer(
                     reqgroup->raw_varinfo, reqgroup->transinfo,
                     datablock,
                     &output_buffer, reqgroup->orig_sel, NULL /* don't need the intersection */,
@@ -657,6 +778,20 @@ static int apply_datablock_to_result_and_free(adios_datablock *datablock,
     return used_count != 0;
 }
 
+/*
+ * The same, then frees the given datablock.
+ *
+ * NOTE: also frees the data buffer within the datablock
+ */
+static int apply_datablock_to_result_and_free(adios_datablock *datablock,
+                                              adios_transform_read_request *reqgroup)
+{
+    const int used = apply_datablock_to_result(datablock, reqgroup);
+
+    adios_datablock_free(&datablock, 1);
+    return used;
+}
+
 /*
  * Takes a datablock containing data potentially applicable to the given read
  * request group, identifies that data (if any), and returns it as an
@@ -862,6 +997,140 @@ void adios_transform_process_read_chunk(adios_transform_read_request **reqgroups
     }
 }
 
+/*
+ * Decoding with several threads, see adios_transform_set_read_threads().
+ * The PG reqgroups of a blocking read are independent: each one is decoded
+ * from its own raw data into its own part of the user buffer. They are marked
+ * completed by the calling thread, then the threads take them one at a time,
+ * since the time to decode a block varies with its content. Only the plugins
+ * that keep no state between calls are run this way; the other PG reqgroups,
+ * and the completion of the read reqgroups, are left to the loop of
+ * adios_transform_process_all_reads().
+ */
+static int read_threads = 1;
+
+void adios_transform_set_read_threads(int nthreads) {
+    read_threads = (nthreads > 1) ? nthreads : 1;
+}
+
+#if HAVE_PTHREAD
+struct pg_work {
+    adios_transform_read_request **reqgroups;
+    adios_transform_pg_read_request **pg_reqgroups;
+    int n;
+    int next;
+    pthread_mutex_t lock; // guards next and the block cache
+};
+
+static int is_reentrant_transform(enum ADIOS_TRANSFORM_TYPE type) {
+    return type == adios_transform_identity || type == adios_transform_zlib ||
+           type == adios_transform_bzip2 || type == adios_transform_zfp;
+}
+
+static void apply_pg_result(struct pg_work *w, adios_transform_read_request *reqgroup,
+                            adios_transform_pg_read_request *pg_reqgroup, adios_datablock *result) {
+    pthread_mutex_lock(&w->lock);
+    add_datablock_to_block_cache(reqgroup, pg_reqgroup, result);
+    pthread_mutex_unlock(&w->lock);
+    apply_datablock_to_result_and_free(result, reqgroup);
+}
+
+static void * complete_pg_reqgroups(void *arg) {
+    struct pg_work *w = (struct pg_work *) arg;
+    adios_transform_read_request *reqgroup;
+    adios_transform_pg_read_request *pg_reqgroup;
+    adios_transform_raw_read_request *subreq;
+    adios_datablock *result;
+    int i;
+
+    for (;;) {
+        pthread_mutex_lock(&w->lock);
+        i = (w->next < w->n) ? w->next++ : -1;
+        pthread_mutex_unlock(&w->lock);
+        if (i < 0)
+            break;
+
+        reqgroup = w->reqgroups[i];
+        pg_reqgroup = w->pg_reqgroups[i];
+        for (subreq = pg_reqgroup->subreqs; subreq; subreq = subreq->next) {
+            result = adios_transform_subrequest_completed(reqgroup, pg_reqgroup, subreq);
+            if (result) apply_pg_result(w, reqgroup, pg_reqgroup, result);
+        }
+        result = adios_transform_pg_reqgroup_completed(reqgroup, pg_reqgroup);
+        if (result) apply_pg_result(w, reqgroup, pg_reqgroup, result);
+    }
+    return NULL;
+}
+
+static void complete_pg_reqgroups_threaded(adios_transform_read_request *reqgroups_head) {
+    adios_transform_read_request *reqgroup;
+    adios_transform_pg_read_request *pg_reqgroup;
+    adios_transform_raw_read_request *subreq;
+    struct pg_work w;
+    pthread_t *threads;
+    int n = 0, nthreads, started = 0, i;
+
+    memset(&w, 0, sizeof(w));
+    for (reqgroup = reqgroups_head; reqgroup; reqgroup = reqgroup->next) {
+        if (reqgroup->completed || !reqgroup->orig_data ||
+            !is_reentrant_transform(reqgroup->transinfo->transform_type))
+            continue;
+        for (pg_reqgroup = reqgroup->pg_reqgroups; pg_reqgroup; pg_reqgroup = pg_reqgroup->next)
+            if (!pg_reqgroup->completed && !pg_reqgroup->num_completed_subreqs)
+                n++;
+    }
+    if (n < 2)
+        return;
+
+    w.reqgroups = (adios_transform_read_request **) malloc(n * sizeof(adios_transform_read_request *));
+    w.pg_reqgroups = (adios_transform_pg_read_request **) malloc(n * sizeof(adios_transform_pg_read_request *));
+    nthreads = (n < read_threads) ? n : read_threads;
+    threads = (pthread_t *) malloc(nthreads * sizeof(pthread_t));
+    if (!w.reqgroups || !w.pg_reqgroups || !threads) {
+        free(w.reqgroups);
+        free(w.pg_reqgroups);
+        free(threads);
+        return;
+    }
+
+    // The completion counters of the read reqgroups are only touched here
+    for (reqgroup = reqgroups_head; reqgroup; reqgroup = reqgroup->next) {
+        if (reqgroup->completed || !reqgroup->orig_data ||
+            !is_reentrant_transform(reqgroup->transinfo->transform_type))
+            continue;
+        for (pg_reqgroup = reqgroup->pg_reqgroups; pg_reqgroup; pg_reqgroup = pg_reqgroup->next) {
+            if (pg_reqgroup->completed || pg_reqgroup->num_completed_subreqs)
+                continue;
+            for (subreq = pg_reqgroup->subreqs; subreq; subreq = subreq->next)
+                adios_transform_raw_read_request_mark_complete(reqgroup, pg_reqgroup, subreq);
+            w.reqgroups[w.n] = reqgroup;
+            w.pg_reqgroups[w.n] = pg_reqgroup;
+            w.n++;
+        }
+    }
+
+    pthread_mutex_init(&w.lock, NULL);
+    for (i = 1; i < nthreads; i++) {
+        if (pthread_create(&threads[i], NULL, complete_pg_reqgroups, &w)) {
+            log_warn("Could not create transform thread, continuing with %d threads\n", i);
+            break;
+        }
+        started = i;
+    }
+
+    complete_pg_reqgroups(&w);
+
+    for (i = 1; i <= started; i++)
+        pthread_join(threads[i], NULL);
+    pthread_mutex_destroy(&w.lock);
+
+    log_debug("%d transformed blocks decoded by %d threads\n", w.n, started + 1);
+    free(threads);
+    free(w.reqgroups);
+    free(w.pg_reqgroups);
+}
+#endif
+
 /*
  * Process all read reqgroups, assuming they have been fully completed,
  * producing all required results based on the raw data read.
@@ -875,6 +1144,11 @@ void adios_transform_process_all_reads(adios_transform_read_request **reqgroups_
     adios_transform_raw_read_request *subreq;
     adios_datablock *result;
 
+#if HAVE_PTHREAD
+    if (read_threads > 1)
+        complete_pg_reqgroups_threaded(*reqgroups_head);
+#endif
+
     // Complete each read reqgroup in turn
     while ((reqgroup = adios_transform_read_request_pop(reqgroups_head)) != NULL) {
         // Free leftover read request groups immediately, with no further processing
@@ -899,13 +1173,19 @@ void adios_transform_process_all_reads(adios_transform_read_request **reqgroups_
 
                 // Make the required call to the transform method to apply the results
                 result = adios_transform_subrequest_completed(reqgroup, pg_reqgroup, subreq);
-                if (result) apply_datablock_to_result_and_free(result, reqgroup);
+                if (result) {
+                    add_datablock_to_block_cache(reqgroup, pg_reqgroup, result);
+                    apply_datablock_to_result_and_free(result, reqgroup);
+                }
             }
             assert(pg_reqgroup->completed);
 
             // Make the required call to the transform method to apply the results
             result = adios_transform_pg_reqgroup_completed(reqgroup, pg_reqgroup);
-            if (result) apply_datablock_to_result_and_free(result, reqgroup);
+            if (result) {
+                add_datablock_to_block_cache(reqgroup, pg_reqgroup, result);
+                apply_datablock_to_result_and_free(result, reqgroup);
+            }
         }
         assert(reqgroup->completed);
 
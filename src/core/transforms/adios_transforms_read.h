@@ -79,4 +79,10 @@ void adios_transform_process_read_chunk(adios_transform_read_request **reqgroups
  */
 void adios_transform_process_all_reads(adios_transform_read_request **reqgroups_head);
 
+/*
+ * Sets the number of threads adios_transform_process_all_reads() decodes
+ * blocks with, from the 'read_threads' read parameter (1 by default).
+ */
+void adios_transform_set_read_threads(int nthreads);
+
 #endif /* ADIOS_TRANSFORMS_READ_H_ */
@@ -506,7 +506,7 @@ int adios_transform_read_request_list_match_chunk(const adios_transform_read_req
                                                   adios_transform_read_request **matching_reqgroup,
                                                   adios_transform_pg_read_request **matching_pg_reqgroup,
                                                   adios_transform_raw_read_request **matching_subreq) {
-    int found;
+    int found = 0;
     adios_transform_read_request *cur;
     for (cur = (adios_transform_read_request *)reqgroup_head; cur; cur = cur->next) {
         found = adios_transform_read_request_match_chunk(cur, chunk, skip_completed, matching_pg_reqgroup, matching_subreq);
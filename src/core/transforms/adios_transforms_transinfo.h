@@ -30,6 +30,11 @@ typedef struct {
     ADIOS_VARBLOCK *orig_blockinfo;
 
     ADIOS_TRANSFORM_METADATA *transform_metadatas;
+
+    // Where each transformed block is stored, for the block cache.
+    // NULL if the read method does not know, an offset is 0 if not recorded.
+    uint64_t *payload_offsets;
+    uint32_t *file_indexes;
 } ADIOS_TRANSINFO;
 
 #endif /* ADIOS_TRANSFORMS_TRANSINFO_H_ */
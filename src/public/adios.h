@@ -94,6 +94,14 @@ int adios_allocate_buffer (
 // To set maximum buffer size for each adios_open()...adios_close() operation.
 void adios_set_max_buffer_size (uint64_t max_buffer_size_MB);
 
+// To allocate the buffers with huge pages (use_hugepages != 0) and to
+// allocate and page-fault prefault_MB of buffer now, used by the first adios_open().
+void adios_set_buffer_options (int use_hugepages, uint64_t prefault_MB);
+
+// To free the buffers kept for reuse by the next adios_open() calls
+// (e.g. when the application needs the memory). They are freed at adios_finalize() anyway.
+void adios_release_buffers (void);
+
 // To declare a ADIOS group
 int adios_declare_group (int64_t * id, 
                          const char * name,
@@ -141,6 +149,12 @@ uint64_t adios_expected_var_size (int64_t var_id);
 // returns adios_errno (0=OK)
 int adios_set_transform (int64_t var_id, const char *transform_type_str);
 
+// To build a bitmap index of each block of a variable just defined, in a
+// side file <file>.idx used by the BITMAP query method.
+// index_spec is "bitmap", "bitmap:bins=N" or "none"
+// returns adios_errno (0=OK)
+int adios_set_index (int64_t var_id, const char *index_spec);
+
 int adios_define_attribute (int64_t group, 
                             const char * name,
                             const char * path, 
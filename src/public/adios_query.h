@@ -14,7 +14,8 @@ enum ADIOS_QUERY_METHOD
     ADIOS_QUERY_METHOD_FASTBIT  = 1,
     ADIOS_QUERY_METHOD_ALACRITY = 2,
     ADIOS_QUERY_METHOD_UNKNOWN  = 3,
-    ADIOS_QUERY_METHOD_COUNT = ADIOS_QUERY_METHOD_UNKNOWN
+    ADIOS_QUERY_METHOD_BITMAP   = 4,
+    ADIOS_QUERY_METHOD_COUNT    = 5   /* methods are [0, COUNT) except UNKNOWN */
 };
     
 
@@ -98,6 +99,9 @@ typedef struct {
               }
               free (result->selections);
               free (result);
+       BITMAP returns one ADIOS_SELECTION_POINTS selection of N-dimensional global points
+           in the bounding box returned in result->selection[0].u.points.container.
+           It is deleted the same way as the FASTBIT and ALACRITY results.
        MINMAX returns multiple selections, each of them is of type ADIOS_SELECTION_WRITEBLOCK
            Block id of the Nth returned writeblock selection = result->selection[N].u.block.index
            npoints is 0.
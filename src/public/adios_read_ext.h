@@ -83,6 +83,16 @@ typedef struct {
 	int npg;
 } ADIOS_PG_INTERSECTIONS;
 
+/* Counters of the cache of decoded blocks, see adios_read_set_block_cache() */
+typedef struct {
+    uint64_t hits;      // blocks served from the cache
+    uint64_t misses;    // blocks looked up and not found
+    uint64_t evictions; // blocks dropped to make room for others
+    uint64_t nblocks;   // blocks in the cache
+    uint64_t bytes;     // memory held by the blocks
+    uint64_t max_bytes; // size of the cache, 0 if it is off
+} ADIOS_BLOCK_CACHE_STATS;
+
 #ifndef __INCLUDED_FROM_FORTRAN_API__
 
 /* Sets the "data view" for this ADIOS file, which determines how ADIOS presents variables through
@@ -128,6 +138,22 @@ int adios_get_absolute_writeblock_index(const ADIOS_VARINFO *varinfo, int timest
 
 void adios_free_pg_intersections(ADIOS_PG_INTERSECTIONS **intersections);
 
+/* Sets the size of the cache of decoded blocks of transformed variables, shared by all files
+ * read by this process. A block read again (same block of the same file, even after the file
+ * was closed and reopened or steps were appended to it) is served from the cache instead of
+ * being read and decoded again, if the read is scheduled with a user buffer. Only files
+ * opened while the cache is on are cached. The least recently used blocks are evicted first.
+ * 0 turns the cache off and frees it (default, unless the ADIOS_BLOCK_CACHE environment
+ * variable gives a size in MB).
+ */
+void adios_read_set_block_cache(uint64_t max_bytes);
+
+/* Returns the counters of the block cache in *stats */
+void adios_read_get_block_cache_stats(ADIOS_BLOCK_CACHE_STATS *stats);
+
+/* Sets the hit, miss and eviction counters of the block cache back to 0 */
+void adios_read_reset_block_cache_stats();
+
 /* What is the dimension order of arrays in the file?
  * 0: C ordering (row-major), last dimension is the fastest dimension
  * 1: Fortran ordering (column-major), first dimension is the fastest dimension
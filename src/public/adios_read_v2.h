@@ -348,6 +348,20 @@ ADIOS_VARINFO * adios_inq_var (ADIOS_FILE *fp, const char * varname);
  */
 ADIOS_VARINFO * adios_inq_var_byid (ADIOS_FILE *fp, int varid);   
 
+/** Find the variables whose name starts with a prefix, e.g. all variables
+ *  under a path with prefix "/mesh/coords/". Names are matched with or
+ *  without their leading /. Only the variables in the current group view
+ *  are returned.
+ *
+ *  IN:  fp       pointer to an (opened) ADIOS_FILE struct
+ *       prefix   beginning of the names
+ *  OUT: varids   list of the indexes (0..fp->nvars-1) of the variables found,
+ *                in ascending order. It is allocated by the library,
+ *                use free() to free it. NULL if nothing is found.
+ *  RETURN:       number of variables found, -1 on error (sets adios_errno)
+ */
+int adios_inq_var_prefix (ADIOS_FILE *fp, const char * prefix, int ** varids);
+
 /** Free memory used by an ADIOS_VARINFO struct */
 void adios_free_varinfo (ADIOS_VARINFO *cp);
 
@@ -533,6 +547,14 @@ int adios_get_attr_byid (ADIOS_FILE  * fp, int attrid,
                          enum ADIOS_DATATYPES * type,
                          int * size, void ** data);
 
+/** Find the attributes whose name starts with a prefix, like
+ *  adios_inq_var_prefix() for variables.
+ *  OUT: attrids  list of the indexes (0..fp->nattrs-1) of the attributes found,
+ *                in ascending order, use free() to free it.
+ *  RETURN:       number of attributes found, -1 on error (sets adios_errno)
+ */
+int adios_inq_attr_prefix (ADIOS_FILE *fp, const char * prefix, int ** attrids);
+
 /** Return the name of an adios type */
 const char * adios_type_to_string (enum ADIOS_DATATYPES type);
 
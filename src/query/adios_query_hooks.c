@@ -36,6 +36,7 @@ void adios_query_hooks_init (struct adios_query_hooks_struct ** t)
     }
 
     ASSIGN_FNS(minmax, ADIOS_QUERY_METHOD_MINMAX);
+    ASSIGN_FNS(bitmap, ADIOS_QUERY_METHOD_BITMAP);
 #ifdef ALACRITY
     ASSIGN_FNS(alac, ADIOS_QUERY_METHOD_ALACRITY);
 #endif
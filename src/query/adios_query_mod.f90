@@ -27,6 +27,7 @@ module adios_query_mod
     integer, parameter :: ADIOS_QUERY_METHOD_MINMAX   = 0 
     integer, parameter :: ADIOS_QUERY_METHOD_FASTBIT  = 1 
     integer, parameter :: ADIOS_QUERY_METHOD_ALACRITY = 2 
+    integer, parameter :: ADIOS_QUERY_METHOD_BITMAP   = 3 
 
     !
     ! Predicate
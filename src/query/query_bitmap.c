@@ -0,0 +1,630 @@
+/*
+ * query_bitmap.c
+ *
+ * Query method using the bitmap index written next to the output file
+ * (<file>.idx, see core/adios_bitmap_index.h) by variables with index="bitmap".
+ *
+ * A query item is evaluated into a bitmap over its box (its bounding box or
+ * writeblock selection, or the whole variable). For each block of the step
+ * overlapping the box, the bins whose min/max fully satisfy the predicate
+ * are ORed in, bins that do not satisfy it are skipped, and
+ * the elements of the bins that partially satisfy it are checked against
+ * the raw data (only the part of the block overlapping the box is read).
+ * With q->estimate set, the partial bins are taken as hits without reading.
+ * The bitmaps of the query items are combined with AND/OR and the result is
+ * returned as N-dimensional global points in batches.
+ */
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <math.h>
+#include "public/adios_error.h"
+#include "public/adios_query.h"
+#include "public/adios_selection.h"
+#include "public/adios_read_ext.h"
+#include "core/common_read.h"
+#include "core/adios_logger.h"
+#include "core/adios_bitmap_index.h"
+#include "core/a2sel.h"
+#include "common_query.h"
+#include "adios_query_hooks.h"
+
+typedef struct {
+    /* query item (leaf) */
+    ADIOS_BITMAP_INDEX_FILE *idx;
+    int nblocks;
+    ADIOS_BITMAP_INDEX_BLOCK **blocks; // blocks of the variable, in file order
+    int nsteps;
+    uint32_t *time_indices;            // distinct time indices of the blocks (=steps), sorted
+
+    /* result of the evaluation of the (sub)query */
+    int step;                          // step of the result, -1 if there is none
+    uint64_t *bits;
+    uint64_t nelems;                   // number of bits
+    uint64_t nhits;
+    uint64_t pos;                      // next bit to return
+    int ndim;                          // box of the result points
+    uint64_t start[32];
+    uint64_t count[32];
+} BITMAP_INTERNAL;
+
+static BITMAP_INTERNAL * get_internal (ADIOS_QUERY *q)
+{
+    BITMAP_INTERNAL *bi = (BITMAP_INTERNAL *) q->queryInternal;
+    if (!bi) {
+        bi = (BITMAP_INTERNAL *) calloc (1, sizeof(BITMAP_INTERNAL));
+        bi->step = -1;
+        q->queryInternal = bi;
+    }
+    return bi;
+}
+
+static void free_result (BITMAP_INTERNAL *bi)
+{
+    free (bi->bits);
+    bi->bits = NULL;
+    bi->nelems = bi->nhits = bi->pos = 0;
+    bi->step = -1;
+}
+
+static const char * skip_slash (const char *name)
+{
+    while (*name == '/')
+        name++;
+    return name;
+}
+
+static int compare_uint32 (const void *a, const void *b)
+{
+    uint32_t x = *(const uint32_t *) a, y = *(const uint32_t *) b;
+    return (x > y) - (x < y);
+}
+
+/* Load the side file of the query item and find the blocks of its variable.
+ * Returns 0 if there is no index for the variable. */
+static int load_index (ADIOS_QUERY *q)
+{
+    BITMAP_INTERNAL *bi = get_internal (q);
+    char *filename;
+    const char *varname;
+    int i, n;
+
+    if (bi->idx)
+        return 1;
+    if (!q->file || !q->file->path || !q->varName)
+        return 0;
+
+    filename = (char *) malloc (strlen (q->file->path) + strlen (ADIOS_BITMAP_INDEX_SUFFIX) + 1);
+    sprintf (filename, "%s%s", q->file->path, ADIOS_BITMAP_INDEX_SUFFIX);
+    bi->idx = adios_bitmap_index_read_file (filename);
+    free (filename);
+    if (!bi->idx)
+        return 0;
+
+    varname = skip_slash (q->varName);
+    bi->blocks = (ADIOS_BITMAP_INDEX_BLOCK **) malloc (bi->idx->nblocks * sizeof(ADIOS_BITMAP_INDEX_BLOCK *) + 1);
+    bi->time_indices = (uint32_t *) malloc (bi->idx->nblocks * sizeof(uint32_t) + 1);
+    for (i = 0; i < bi->idx->nblocks; i++) {
+        ADIOS_BITMAP_INDEX_BLOCK *b = &bi->idx->blocks[i];
+        if (!strcmp (skip_slash (b->varname), varname)) {
+            bi->time_indices[bi->nblocks] = b->time_index;
+            bi->blocks[bi->nblocks++] = b;
+        }
+    }
+    if (!bi->nblocks) {
+        log_debug ("No bitmap index for variable %s\n", q->varName);
+        return 0;
+    }
+
+    qsort (bi->time_indices, bi->nblocks, sizeof(uint32_t), compare_uint32);
+    for (i = 1, n = 1; i < bi->nblocks; i++) {
+        if (bi->time_indices[i] != bi->time_indices[n-1])
+            bi->time_indices[n++] = bi->time_indices[i];
+    }
+    bi->nsteps = n;
+    return 1;
+}
+
+static void free_internals (ADIOS_QUERY *q)
+{
+    if (q->left)
+        free_internals ((ADIOS_QUERY *) q->left);
+    if (q->right)
+        free_internals ((ADIOS_QUERY *) q->right);
+    adios_query_bitmap_free (q);
+}
+
+static int can_evaluate (ADIOS_QUERY *q)
+{
+    if (q->left || q->right) {
+        return (!q->left || can_evaluate ((ADIOS_QUERY *) q->left)) &&
+               (!q->right || can_evaluate ((ADIOS_QUERY *) q->right));
+    }
+    if (!load_index (q))
+        return 0;
+    if (q->sel) {
+        BITMAP_INTERNAL *bi = (BITMAP_INTERNAL *) q->queryInternal;
+        if (q->sel->type == ADIOS_SELECTION_BOUNDINGBOX)
+            return q->sel->u.bb.ndim == bi->blocks[0]->ndim;
+        if (q->sel->type == ADIOS_SELECTION_WRITEBLOCK)
+            return !q->sel->u.block.is_sub_pg_selection;
+        return 0;
+    }
+    return 1;
+}
+
+int adios_query_bitmap_can_evaluate (ADIOS_QUERY *q)
+{
+    // we can evaluate only iff
+    // - the file has a bitmap index for the variable of every query item
+    // - the selection of every query item is NULL, a bounding box or a whole writeblock
+    if (can_evaluate (q))
+        return 1;
+    // another method will evaluate the query, drop what has been loaded
+    free_internals (q);
+    return 0;
+}
+
+/* The bounding box of a query item at a step: its selection (the box of
+ * the writeblock for writeblock selections) or the whole variable */
+static int get_leaf_box (ADIOS_QUERY *q, int timestep, int *ndim, uint64_t *start, uint64_t *count)
+{
+    int d;
+    if (q->sel && q->sel->type == ADIOS_SELECTION_BOUNDINGBOX) {
+        *ndim = q->sel->u.bb.ndim;
+        memcpy (start, q->sel->u.bb.start, *ndim * sizeof(uint64_t));
+        memcpy (count, q->sel->u.bb.count, *ndim * sizeof(uint64_t));
+    } else if (q->sel && q->sel->type == ADIOS_SELECTION_WRITEBLOCK) {
+        int wb = q->sel->u.block.index;
+        if (!q->varinfo || q->varinfo->ndim < 1 || q->varinfo->ndim > 32)
+            return -1;
+        if (!q->varinfo->blockinfo) {
+            adios_read_set_data_view (q->file, LOGICAL_DATA_VIEW);
+            common_read_inq_var_blockinfo (q->file, q->varinfo);
+        }
+        // varinfo has the blocks of all steps in file mode, only the current one in stream mode
+        if (!q->sel->u.block.is_absolute_index && q->varinfo->nsteps > 1)
+            wb = adios_get_absolute_writeblock_index (q->varinfo, wb, timestep);
+        if (!q->varinfo->blockinfo || wb < 0 || wb >= q->varinfo->sum_nblocks)
+            return -1;
+        *ndim = q->varinfo->ndim;
+        memcpy (start, q->varinfo->blockinfo[wb].start, *ndim * sizeof(uint64_t));
+        memcpy (count, q->varinfo->blockinfo[wb].count, *ndim * sizeof(uint64_t));
+    } else if (q->sel) {
+        return -1;
+    } else {
+        if (!q->varinfo || q->varinfo->ndim < 1 || q->varinfo->ndim > 32)
+            return -1;
+        *ndim = q->varinfo->ndim;
+        for (d = 0; d < *ndim; d++) {
+            start[d] = 0;
+            count[d] = q->varinfo->dims[d];
+        }
+    }
+    return 0;
+}
+
+/* How a bin with values in [min,max] satisfies the predicate: 1 all of them, 0 none, -1 some */
+static int classify_bin (enum ADIOS_PREDICATE_MODE op, double v, double min, double max)
+{
+    if (v != v)
+        return (op == ADIOS_NE); // nothing is equal to NaN
+    switch (op) {
+        case ADIOS_LT:   return (max < v) ? 1 : (min >= v ? 0 : -1);
+        case ADIOS_LTEQ: return (max <= v) ? 1 : (min > v ? 0 : -1);
+        case ADIOS_GT:   return (min > v) ? 1 : (max <= v ? 0 : -1);
+        case ADIOS_GTEQ: return (min >= v) ? 1 : (max < v ? 0 : -1);
+        case ADIOS_EQ:   return (v < min || v > max) ? 0 : (min == max ? 1 : -1);
+        case ADIOS_NE:   return (v < min || v > max) ? 1 : (min == max ? 0 : -1);
+        default:         return 0;
+    }
+}
+
+static inline int satisfies (enum ADIOS_PREDICATE_MODE op, double x, double v)
+{
+    switch (op) {
+        case ADIOS_LT:   return x < v;
+        case ADIOS_LTEQ: return x <= v;
+        case ADIOS_GT:   return x > v;
+        case ADIOS_GTEQ: return x >= v;
+        case ADIOS_EQ:   return x == v;
+        case ADIOS_NE:   return x != v;
+        default:         return 0;
+    }
+}
+
+static inline double value_at (enum ADIOS_DATATYPES type, const void *data, uint64_t i)
+{
+    switch (type) {
+        case adios_byte:             return ((const signed char *) data)[i];
+        case adios_unsigned_byte:    return ((const unsigned char *) data)[i];
+        case adios_short:            return ((const int16_t *) data)[i];
+        case adios_unsigned_short:   return ((const uint16_t *) data)[i];
+        case adios_integer:          return ((const int32_t *) data)[i];
+        case adios_unsigned_integer: return ((const uint32_t *) data)[i];
+        case adios_real:             return ((const float *) data)[i];
+        case adios_double:           return ((const double *) data)[i];
+        default:                     return 0.0;
+    }
+}
+
+#define TESTBIT(bits,i) (((bits)[(i) >> 6] >> ((i) & 63)) & 1)
+#define SETBIT(bits,i)  ((bits)[(i) >> 6] |= 1ULL << ((i) & 63))
+
+/* Evaluate a block of a query item and set the hits in the part of the box it overlaps */
+static int evaluate_block (ADIOS_QUERY *q, int timestep, const ADIOS_BITMAP_INDEX_BLOCK *b,
+                           int ndim, const uint64_t *bstart, const uint64_t *bcount,
+                           double value, uint64_t *bits)
+{
+    uint64_t is[32], ic[32], nrows = 1, ninter = 1, row, k;
+    uint64_t bstride[32], blkstride[32];
+    uint64_t *hits, *candidates = NULL;
+    uint64_t nwords = b->nelems / 64 + 1;
+    void *raw = NULL;
+    uint32_t bin;
+    int d, has_candidates = 0;
+
+    // intersection of the block and the box
+    for (d = 0; d < ndim; d++) {
+        uint64_t s = (b->start[d] > bstart[d] ? b->start[d] : bstart[d]);
+        uint64_t e1 = b->start[d] + b->count[d], e2 = bstart[d] + bcount[d];
+        uint64_t e = (e1 < e2 ? e1 : e2);
+        if (s >= e)
+            return 0;
+        is[d] = s;
+        ic[d] = e - s;
+        ninter *= ic[d];
+        if (d < ndim - 1)
+            nrows *= ic[d];
+    }
+    bstride[ndim-1] = blkstride[ndim-1] = 1;
+    for (d = ndim - 2; d >= 0; d--) {
+        bstride[d] = bstride[d+1] * bcount[d+1];
+        blkstride[d] = blkstride[d+1] * b->count[d+1];
+    }
+
+    hits = (uint64_t *) calloc (nwords, sizeof(uint64_t));
+    if (!hits) {
+        adios_error (err_no_memory, "Cannot allocate memory for the bitmap query\n");
+        return -1;
+    }
+    for (bin = 0; bin < b->nbins; bin++) {
+        double min, max;
+        uint32_t nw;
+        int c;
+        adios_bitmap_index_bin_info (b, bin, &min, &max, &nw);
+        if (!nw)
+            continue;
+        c = classify_bin (q->predicateOp, value, min, max);
+        if (c < 0 && q->estimate)
+            c = 1;
+        if (c == 1) {
+            adios_bitmap_index_or_bin (b, bin, hits);
+        } else if (c < 0) {
+            if (!candidates) {
+                candidates = (uint64_t *) calloc (nwords, sizeof(uint64_t));
+                if (!candidates) {
+                    adios_error (err_no_memory, "Cannot allocate memory for the bitmap query\n");
+                    free (hits);
+                    return -1;
+                }
+            }
+            adios_bitmap_index_or_bin (b, bin, candidates);
+            has_candidates = 1;
+        }
+    }
+
+    if (q->predicateOp == ADIOS_NE) {
+        // NaN elements are in no bin, and they are != to any value like in
+        // the scan of the values, so they are hits
+        uint64_t *binned = (uint64_t *) calloc (nwords, sizeof(uint64_t));
+        if (!binned) {
+            adios_error (err_no_memory, "Cannot allocate memory for the bitmap query\n");
+            free (hits);
+            free (candidates);
+            return -1;
+        }
+        for (bin = 0; bin < b->nbins; bin++)
+            adios_bitmap_index_or_bin (b, bin, binned);
+        for (k = 0; k < nwords; k++)
+            hits[k] |= ~binned[k];
+        free (binned);
+    }
+
+    if (has_candidates) {
+        // read the overlapping part of the block to check the candidates
+        ADIOS_SELECTION *sel = a2sel_boundingbox (ndim, is, ic);
+        raw = malloc (ninter * common_read_type_size (b->type, NULL));
+        if (!raw) {
+            adios_error (err_no_memory, "Cannot allocate memory for the bitmap query\n");
+            a2sel_free (sel);
+            free (hits);
+            free (candidates);
+            return -1;
+        }
+        common_read_schedule_read (q->file, sel, q->varName, timestep, 1, NULL, raw);
+        common_read_perform_reads (q->file, 1);
+        a2sel_free (sel);
+    }
+
+    // copy the hits of the intersection into the box, row by row of the last dimension
+    for (row = 0; row < nrows; row++) {
+        uint64_t rem = row, boff = 0, blkoff = 0, ioff = row * ic[ndim-1];
+        for (d = ndim - 2; d >= 0; d--) {
+            uint64_t c = is[d] + rem % ic[d];
+            rem /= ic[d];
+            boff += (c - bstart[d]) * bstride[d];
+            blkoff += (c - b->start[d]) * blkstride[d];
+        }
+        boff += is[ndim-1] - bstart[ndim-1];
+        blkoff += is[ndim-1] - b->start[ndim-1];
+        for (k = 0; k < ic[ndim-1]; k++) {
+            if (TESTBIT (hits, blkoff + k) ||
+                (has_candidates && TESTBIT (candidates, blkoff + k) &&
+                 satisfies (q->predicateOp, value_at (b->type, raw, ioff + k), value)))
+            {
+                SETBIT (bits, boff + k);
+            }
+        }
+    }
+
+    free (raw);
+    free (hits);
+    free (candidates);
+    return 0;
+}
+
+/* Evaluate a query item over its box. 'timestep' is the step as given by the
+ * user (to read data), 'absoluteTimestep' the step in the file (to find the
+ * blocks in the index). Returns the bitmap and its number of bits. */
+static uint64_t * evaluate_leaf (ADIOS_QUERY *q, int timestep, int absoluteTimestep, uint64_t *nelems)
+{
+    BITMAP_INTERNAL *bi;
+    uint64_t start[32], count[32], n = 1;
+    uint64_t *bits;
+    uint32_t time_index;
+    int ndim, d, i;
+    char *end;
+    double value;
+
+    if (!load_index (q)) {
+        adios_error (err_invalid_query_value, "There is no bitmap index for variable %s\n", q->varName);
+        return NULL;
+    }
+    bi = (BITMAP_INTERNAL *) q->queryInternal;
+    if (get_leaf_box (q, timestep, &ndim, start, count)) {
+        adios_error (err_invalid_query_value, "Unsupported selection for the bitmap query of %s\n", q->varName);
+        return NULL;
+    }
+    value = strtod (q->predicateValue, &end);
+    if (end == q->predicateValue) {
+        adios_error (err_invalid_query_value, "Invalid value %s in the query of %s\n",
+                     q->predicateValue, q->varName);
+        return NULL;
+    }
+
+    for (d = 0; d < ndim; d++)
+        n *= count[d];
+    bits = (uint64_t *) calloc (n / 64 + 1, sizeof(uint64_t));
+    if (!bits) {
+        adios_error (err_no_memory, "Cannot allocate memory for the bitmap query\n");
+        return NULL;
+    }
+    *nelems = n;
+
+    // the steps of the variable are the distinct time indices of its blocks
+    if (absoluteTimestep < 0 || absoluteTimestep >= bi->nsteps)
+        return bits;
+    time_index = bi->time_indices[absoluteTimestep];
+    for (i = 0; i < bi->nblocks; i++) {
+        ADIOS_BITMAP_INDEX_BLOCK *b = bi->blocks[i];
+        if (b->time_index != time_index)
+            continue;
+        if (b->ndim != ndim) {
+            log_warn ("Bitmap index block of variable %s has %d dimensions instead of %d, ignored\n",
+                      q->varName, b->ndim, ndim);
+            continue;
+        }
+        if (evaluate_block (q, timestep, b, ndim, start, count, value, bits)) {
+            free (bits);
+            return NULL;
+        }
+    }
+    return bits;
+}
+
+static uint64_t * evaluate_node (ADIOS_QUERY *q, int timestep, int absoluteTimestep, uint64_t *nelems)
+{
+    uint64_t *lbits, *rbits, nl, nr, i;
+
+    if (!q->left && !q->right)
+        return evaluate_leaf (q, timestep, absoluteTimestep, nelems);
+    if (!q->right)
+        return evaluate_node ((ADIOS_QUERY *) q->left, timestep, absoluteTimestep, nelems);
+    if (!q->left)
+        return evaluate_node ((ADIOS_QUERY *) q->right, timestep, absoluteTimestep, nelems);
+
+    lbits = evaluate_node ((ADIOS_QUERY *) q->left, timestep, absoluteTimestep, &nl);
+    if (!lbits)
+        return NULL;
+    rbits = evaluate_node ((ADIOS_QUERY *) q->right, timestep, absoluteTimestep, &nr);
+    if (!rbits) {
+        free (lbits);
+        return NULL;
+    }
+    if (nl != nr) {
+        adios_error (err_incompatible_queries, "Query items have selections of different sizes\n");
+        free (lbits);
+        free (rbits);
+        return NULL;
+    }
+    if (q->combineOp == ADIOS_QUERY_OP_AND) {
+        for (i = 0; i < nl / 64 + 1; i++)
+            lbits[i] &= rbits[i];
+    } else {
+        for (i = 0; i < nl / 64 + 1; i++)
+            lbits[i] |= rbits[i];
+    }
+    free (rbits);
+    *nelems = nl;
+    return lbits;
+}
+
+static uint64_t count_bits (const uint64_t *bits, uint64_t nelems)
+{
+    uint64_t n = 0, i;
+    for (i = 0; i < nelems / 64 + 1; i++) {
+        uint64_t w = bits[i];
+        for (; w; n++)
+            w &= w - 1;
+    }
+    return n;
+}
+
+/* Set the box of the result points: the output boundary or else the box of the leftmost item */
+static int set_output_box (ADIOS_QUERY *q, int timestep, BITMAP_INTERNAL *bi, ADIOS_SELECTION *outputBoundary)
+{
+    ADIOS_QUERY *leaf = q;
+    uint64_t n = 1;
+    int d;
+
+    while (leaf->left)
+        leaf = (ADIOS_QUERY *) leaf->left;
+    if (outputBoundary) {
+        if (outputBoundary->type != ADIOS_SELECTION_BOUNDINGBOX || outputBoundary->u.bb.ndim > 32) {
+            adios_error (err_unsupported_selection, "The bitmap query method supports only "
+                         "bounding box and writeblock output selections\n");
+            return -1;
+        }
+        bi->ndim = outputBoundary->u.bb.ndim;
+        memcpy (bi->start, outputBoundary->u.bb.start, bi->ndim * sizeof(uint64_t));
+        memcpy (bi->count, outputBoundary->u.bb.count, bi->ndim * sizeof(uint64_t));
+    } else if (get_leaf_box (leaf, timestep, &bi->ndim, bi->start, bi->count)) {
+        adios_error (err_invalid_query_value, "Unsupported selection for the bitmap query of %s\n", leaf->varName);
+        return -1;
+    }
+    for (d = 0; d < bi->ndim; d++)
+        n *= bi->count[d];
+    if (bi->bits && n != bi->nelems) {
+        adios_error (err_incompatible_queries, "The output selection and the query selections have different sizes\n");
+        return -1;
+    }
+    return 0;
+}
+
+/* Evaluate the query at a new step */
+static int do_evaluate (ADIOS_QUERY *q, int timestep, int absoluteTimestep, ADIOS_SELECTION *outputBoundary)
+{
+    BITMAP_INTERNAL *bi = get_internal (q);
+
+    free_result (bi);
+    bi->bits = evaluate_node (q, timestep, absoluteTimestep, &bi->nelems);
+    if (!bi->bits)
+        return -1;
+    if (set_output_box (q, timestep, bi, outputBoundary)) {
+        free_result (bi);
+        return -1;
+    }
+    bi->nhits = count_bits (bi->bits, bi->nelems);
+    bi->step = absoluteTimestep;
+
+    // this is treated as the first call to evaluate the query for a new timestep
+    q->onTimeStep = absoluteTimestep;
+    q->maxResultsDesired = bi->nhits;
+    q->resultsReadSoFar = 0;
+    return 0;
+}
+
+int64_t adios_query_bitmap_estimate (ADIOS_QUERY *q, int timestep)
+{
+    const int absoluteTimestep = adios_get_actual_timestep (q, timestep);
+    BITMAP_INTERNAL *bi = get_internal (q);
+    if ((q->onTimeStep != absoluteTimestep || bi->step != absoluteTimestep) &&
+        do_evaluate (q, timestep, absoluteTimestep, NULL))
+        return -1;
+    return (int64_t) bi->nhits;
+}
+
+int adios_query_bitmap_evaluate (ADIOS_QUERY *q, int timestep, uint64_t batchSize,
+                                 ADIOS_SELECTION *outputBoundary, ADIOS_QUERY_RESULT *queryResult)
+{
+    const int absoluteTimestep = adios_get_actual_timestep (q, timestep);
+    BITMAP_INTERNAL *bi = get_internal (q);
+    uint64_t npoints, *points, i, k;
+    int d;
+
+    if (q->onTimeStep != absoluteTimestep || bi->step != absoluteTimestep) {
+        if (do_evaluate (q, timestep, absoluteTimestep, outputBoundary)) {
+            queryResult->status = ADIOS_QUERY_RESULT_ERROR;
+            return -1;
+        }
+    } else if (q->resultsReadSoFar == 0 && set_output_box (q, timestep, bi, outputBoundary)) {
+        // evaluated by estimate, without the output boundary
+        queryResult->status = ADIOS_QUERY_RESULT_ERROR;
+        return -1;
+    }
+
+    npoints = q->maxResultsDesired - q->resultsReadSoFar;
+    if (npoints > batchSize)
+        npoints = batchSize;
+    if (npoints == 0) {
+        queryResult->status = ADIOS_QUERY_NO_MORE_RESULTS;
+        return 0;
+    }
+
+    points = (uint64_t *) malloc (npoints * bi->ndim * sizeof(uint64_t));
+    if (!points) {
+        adios_error (err_no_memory, "Cannot allocate memory for %" PRIu64 " points\n", npoints);
+        queryResult->status = ADIOS_QUERY_RESULT_ERROR;
+        return -1;
+    }
+    for (k = 0, i = bi->pos; k < npoints && i < bi->nelems; i++) {
+        if (!bi->bits[i >> 6]) {
+            i |= 63; // skip empty words
+            continue;
+        }
+        if (TESTBIT (bi->bits, i)) {
+            uint64_t rem = i, *p = points + k * bi->ndim;
+            for (d = bi->ndim - 1; d >= 0; d--) {
+                p[d] = bi->start[d] + rem % bi->count[d];
+                rem /= bi->count[d];
+            }
+            k++;
+        }
+    }
+    bi->pos = i;
+
+    queryResult->selections = a2sel_points (bi->ndim, npoints, points,
+                                            a2sel_boundingbox (bi->ndim, bi->start, bi->count), 1);
+    queryResult->nselections = 1;
+    queryResult->npoints = npoints;
+    queryResult->method_used = ADIOS_QUERY_METHOD_BITMAP;
+
+    q->resultsReadSoFar += npoints;
+    queryResult->status = (q->resultsReadSoFar < q->maxResultsDesired ?
+                           ADIOS_QUERY_HAS_MORE_RESULTS : ADIOS_QUERY_NO_MORE_RESULTS);
+    return queryResult->status;
+}
+
+int adios_query_bitmap_free (ADIOS_QUERY *q)
+{
+    BITMAP_INTERNAL *bi;
+    if (q == NULL || q->queryInternal == NULL)
+        return 0;
+    // every query piece is freed by the user one by one
+    bi = (BITMAP_INTERNAL *) q->queryInternal;
+    free_result (bi);
+    adios_bitmap_index_free_file (bi->idx);
+    free (bi->blocks);
+    free (bi->time_indices);
+    free (bi);
+    q->queryInternal = NULL;
+    return 1;
+}
+
+int adios_query_bitmap_finalize ()
+{
+    return 1;
+}
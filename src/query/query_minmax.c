@@ -21,6 +21,30 @@
 #include "config.h"  // HAVE_STRTOLD
 
 
+/* Min/max interval index of the blocks of one variable in one step, built from the
+ * block statistics the first time a query condition on the variable is evaluated
+ * in that step.
+ * It is built from the statistics of the read API (adios_inq_var_stat) and not from the
+ * columnar block index of the BP reader (struct BP_var_columns), because query methods
+ * work with any read method. For the same reason it is built on demand per step: a query
+ * has no file open of its own, and in a stream the blocks of a step are only known once
+ * the step has arrived.
+ * The min and max values are converted to double (exact for the types the index is used for)
+ * and kept in block order for the loops, and sorted with the block ids, so that range
+ * predicates find their matching blocks with a binary search instead of a loop over
+ * all blocks.
+ */
+typedef struct {
+    int step;             // absolute step the index was built for
+    int nblocks;
+    double *mins;         // in block order
+    double *maxs;
+    double *sorted_mins;  // ascending
+    int    *by_min;       // block ids in the order of sorted_mins
+    double *sorted_maxs;  // ascending
+    int    *by_max;       // block ids in the order of sorted_maxs
+} MINMAX_INDEX;
+
 typedef struct {
     int nblocks;
     char *blocks;  // 0-1 boolean flag for each writeblock, 1=matches query
@@ -30,6 +54,9 @@ typedef struct {
 
     int current_blockid; // end of last evaluation (remember it to be able 
                          // to continue in consecutive evaluate calls)
+
+    int nindex;
+    MINMAX_INDEX **index; // per timestep, of a leaf node's variable, kept between evaluations
 } MINMAX_INTERNAL;
 
 static void create_internal (ADIOS_QUERY *q)
@@ -40,12 +67,29 @@ static void create_internal (ADIOS_QUERY *q)
     }
 }
 
+static void free_index (MINMAX_INDEX *idx)
+{
+    if (idx) {
+        free (idx->mins);
+        free (idx->maxs);
+        free (idx->sorted_mins);
+        free (idx->by_min);
+        free (idx->sorted_maxs);
+        free (idx->by_max);
+        free (idx);
+    }
+}
+
 static void free_internal (ADIOS_QUERY *q)
 {
     if (q->queryInternal != NULL) {
         MINMAX_INTERNAL* qi = (MINMAX_INTERNAL*) q->queryInternal;
         if (qi->blocks)
             free (qi->blocks);
+        int i;
+        for (i = 0; i < qi->nindex; i++)
+            free_index (qi->index[i]);
+        free (qi->index);
         free (qi);
         q->queryInternal = NULL;
     }
@@ -196,7 +240,7 @@ static void * string_to_value (char *v_str, enum ADIOS_DATATYPES vartype)
     static signed long long v_int;
     static unsigned long long v_uint;
     static double v_real;
-    LONGDOUBLE v_ld;
+    static LONGDOUBLE v_ld;
     switch (vartype) 
     {
         case adios_unsigned_byte:
@@ -235,6 +279,257 @@ static void * string_to_value (char *v_str, enum ADIOS_DATATYPES vartype)
     return retval;
 }
 
+/* Types whose values are exactly representable as double, for which the index is used */
+static int index_supports_type (enum ADIOS_DATATYPES vartype)
+{
+    switch (vartype)
+    {
+        case adios_unsigned_byte:
+        case adios_byte:
+        case adios_unsigned_short:
+        case adios_short:
+        case adios_unsigned_integer:
+        case adios_integer:
+        case adios_real:
+        case adios_double:
+            return 1;
+        default:
+            return 0;
+    }
+}
+
+static double value_to_double (const void *v, enum ADIOS_DATATYPES vartype)
+{
+    switch (vartype)
+    {
+        case adios_unsigned_byte:    return (double) *(const unsigned char *) v;
+        case adios_byte:             return (double) *(const signed char *) v;
+        case adios_unsigned_short:   return (double) *(const unsigned short *) v;
+        case adios_short:            return (double) *(const signed short *) v;
+        case adios_unsigned_integer: return (double) *(const unsigned int *) v;
+        case adios_integer:          return (double) *(const signed int *) v;
+        case adios_real:             return (double) *(const float *) v;
+        case adios_double:           return *(const double *) v;
+        default:                     return 0.0;
+    }
+}
+
+/* The predicate value as converted by string_to_value(), as double */
+static double predicate_to_double (void *v_pred, enum ADIOS_DATATYPES vartype)
+{
+    switch (vartype)
+    {
+        case adios_unsigned_byte:
+        case adios_unsigned_short:
+        case adios_unsigned_integer:
+            return (double) *(unsigned long long *) v_pred;
+        case adios_byte:
+        case adios_short:
+        case adios_integer:
+            return (double) *(signed long long *) v_pred;
+        default:
+            return *(double *) v_pred;
+    }
+}
+
+struct index_entry {
+    double value;
+    int blockid;
+};
+
+static int compare_index_entries (const void *a, const void *b)
+{
+    const struct index_entry *x = (const struct index_entry *) a;
+    const struct index_entry *y = (const struct index_entry *) b;
+    if (x->value < y->value) return -1;
+    if (x->value > y->value) return 1;
+    return x->blockid - y->blockid;
+}
+
+static void sort_index_values (const double *values, int n, double *sorted, int *ids)
+{
+    struct index_entry *e = (struct index_entry *) malloc (n * sizeof(struct index_entry));
+    int i;
+    for (i = 0; i < n; i++) {
+        e[i].value = values[i];
+        e[i].blockid = i;
+    }
+    qsort (e, n, sizeof(struct index_entry), compare_index_entries);
+    for (i = 0; i < n; i++) {
+        sorted[i] = e[i].value;
+        ids[i] = e[i].blockid;
+    }
+    free (e);
+}
+
+/* Build the index of the blocks of a leaf node's variable in 'timestep',
+ * from the blocks starting at block_start_idx in the statistics */
+static MINMAX_INDEX * build_index (ADIOS_QUERY *q, int step, int block_start_idx, int nblocks)
+{
+    MINMAX_INDEX *idx = (MINMAX_INDEX *) calloc (1, sizeof(MINMAX_INDEX));
+    void **mins = q->varinfo->statistics->blocks->mins + block_start_idx;
+    void **maxs = q->varinfo->statistics->blocks->maxs + block_start_idx;
+    int i;
+
+    idx->step = step;
+    idx->nblocks = nblocks;
+    idx->mins = (double *) malloc (nblocks * sizeof(double));
+    idx->maxs = (double *) malloc (nblocks * sizeof(double));
+    idx->sorted_mins = (double *) malloc (nblocks * sizeof(double));
+    idx->sorted_maxs = (double *) malloc (nblocks * sizeof(double));
+    idx->by_min = (int *) malloc (nblocks * sizeof(int));
+    idx->by_max = (int *) malloc (nblocks * sizeof(int));
+    if (!idx->mins || !idx->maxs || !idx->sorted_mins || !idx->sorted_maxs ||
+        !idx->by_min || !idx->by_max)
+    {
+        log_warn ("minmax query: could not allocate the block index of variable %s, "
+                  "evaluating block by block\n", q->varName);
+        free_index (idx);
+        return NULL;
+    }
+
+    for (i = 0; i < nblocks; i++) {
+        idx->mins[i] = value_to_double (mins[i], q->varinfo->type);
+        idx->maxs[i] = value_to_double (maxs[i], q->varinfo->type);
+        if (idx->mins[i] != idx->mins[i] || idx->maxs[i] != idx->maxs[i]) {
+            // NaN statistics cannot be ordered, compare them block by block
+            free_index (idx);
+            return NULL;
+        }
+    }
+    sort_index_values (idx->mins, nblocks, idx->sorted_mins, idx->by_min);
+    sort_index_values (idx->maxs, nblocks, idx->sorted_maxs, idx->by_max);
+    return idx;
+}
+
+/* The index of a leaf node's variable in 'timestep' if it has been built already */
+static MINMAX_INDEX * find_index (ADIOS_QUERY *q, int timestep)
+{
+    if (q->queryInternal && timestep < INTERNAL(q)->nindex && INTERNAL(q)->index[timestep] &&
+        INTERNAL(q)->index[timestep]->step == adios_get_actual_timestep (q, timestep))
+        return INTERNAL(q)->index[timestep];
+    return NULL;
+}
+
+/* The index of a leaf node's variable in 'timestep', built if it does not exist yet.
+ * In streams, timestep is always 0 and the index is rebuilt when a new step arrives.
+ */
+static MINMAX_INDEX * get_index (ADIOS_QUERY *q, int timestep, int block_start_idx, int nblocks)
+{
+    const int step = adios_get_actual_timestep (q, timestep);
+    MINMAX_INTERNAL *qi;
+
+    create_internal (q);
+    qi = INTERNAL(q);
+    if (timestep >= qi->nindex) {
+        MINMAX_INDEX **p = (MINMAX_INDEX **) realloc (qi->index, (timestep+1) * sizeof(MINMAX_INDEX*));
+        if (!p)
+            return NULL;
+        memset (p + qi->nindex, 0, (timestep + 1 - qi->nindex) * sizeof(MINMAX_INDEX*));
+        qi->index = p;
+        qi->nindex = timestep+1;
+    }
+    if (qi->index[timestep] && 
+        (qi->index[timestep]->step != step || qi->index[timestep]->nblocks != nblocks))
+    {
+        free_index (qi->index[timestep]);
+        qi->index[timestep] = NULL;
+    }
+    if (!qi->index[timestep] && q->varinfo->statistics && q->varinfo->statistics->blocks)
+        qi->index[timestep] = build_index (q, step, block_start_idx, nblocks);
+    return qi->index[timestep];
+}
+
+/* Number of values in the ascending array less than v (or_equal=0), less or equal to v (or_equal=1) */
+static int count_below (const double *sorted, int n, double v, int or_equal)
+{
+    int lo = 0, hi = n;
+    while (lo < hi) {
+        int mid = lo + (hi - lo) / 2;
+        if (sorted[mid] < v || (or_equal && sorted[mid] == v))
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    return lo;
+}
+
+/* Clear the flag of every block not in ids[0..k-1] */
+static void keep_blocks (char *blocks, int nblocks, const int *ids, int k)
+{
+    int i;
+    if (k == nblocks)
+        return;
+    if (k == 0) {
+        memset (blocks, 0, nblocks);
+        return;
+    }
+    char *keep = (char *) calloc (nblocks, sizeof(char));
+    for (i = 0; i < k; i++)
+        keep[ids[i]] = 1;
+    for (i = 0; i < nblocks; i++)
+        blocks[i] &= keep[i];
+    free (keep);
+}
+
+/* Evaluate the predicate of a leaf node on the blocks flagged in 'blocks' with the index */
+static void evaluate_with_index (const MINMAX_INDEX *idx, enum ADIOS_PREDICATE_MODE op, double v, char *blocks)
+{
+    const int n = idx->nblocks;
+    int i, k;
+
+    switch (op)
+    {
+        case ADIOS_LT:    // blocks with min < v
+            keep_blocks (blocks, n, idx->by_min, count_below (idx->sorted_mins, n, v, 0));
+            break;
+        case ADIOS_LTEQ:  // blocks with min <= v
+            keep_blocks (blocks, n, idx->by_min, count_below (idx->sorted_mins, n, v, 1));
+            break;
+        case ADIOS_GT:    // blocks with max > v
+            k = count_below (idx->sorted_maxs, n, v, 1);
+            keep_blocks (blocks, n, idx->by_max + k, n - k);
+            break;
+        case ADIOS_GTEQ:  // blocks with max >= v
+            k = count_below (idx->sorted_maxs, n, v, 0);
+            keep_blocks (blocks, n, idx->by_max + k, n - k);
+            break;
+        case ADIOS_EQ:
+        {
+            // min <= v <= max: take the shorter of the two candidate lists and check the other bound
+            int nmin = count_below (idx->sorted_mins, n, v, 1);
+            int kmax = count_below (idx->sorted_maxs, n, v, 0);
+            int *ids = (int *) malloc ((n ? n : 1) * sizeof(int));
+            int m = 0;
+            if (nmin <= n - kmax) {
+                for (i = 0; i < nmin; i++)
+                    if (idx->maxs[idx->by_min[i]] >= v)
+                        ids[m++] = idx->by_min[i];
+            } else {
+                for (i = kmax; i < n; i++)
+                    if (idx->mins[idx->by_max[i]] <= v)
+                        ids[m++] = idx->by_max[i];
+            }
+            keep_blocks (blocks, n, ids, m);
+            free (ids);
+            break;
+        }
+        case ADIOS_NE:
+            // not a match only if all elements of the block equal v
+            for (i = 0; i < n; i++)
+                blocks[i] &= !(idx->mins[i] == v && idx->maxs[i] == v);
+            break;
+    }
+}
+
+static int count_flags (const char *blocks, int nblocks)
+{
+    int i, n = 0;
+    for (i = 0; i < nblocks; i++)
+        n += blocks[i];
+    return n;
+}
+
 /*
  * evaluate a single query item (Variable PredicateOP Value) 
  * In: blocks array flag has 1s which writeblocks have to be checked
@@ -258,8 +553,6 @@ static int minmax_evaluate_node (ADIOS_QUERY* q, int timestep, int nblocks, char
     // sanity check
     assert (q->varinfo);
     assert (q->varinfo->blockinfo);
-    assert (q->varinfo->statistics);
-    assert (q->varinfo->statistics->blocks);
     assert (nblocks == q->varinfo->nblocks[timestep]);
 
     // speed up for special case when selection is a single writeblock
@@ -270,7 +563,7 @@ static int minmax_evaluate_node (ADIOS_QUERY* q, int timestep, int nblocks, char
         int index = (q->sel->u.block.is_absolute_index ? 
                      q->sel->u.block.index - block_start_idx :
                      q->sel->u.block.index);
-        assert (index > 0);
+        assert (index >= 0);
         assert (index < nblocks);
         memset (blocks, 0, nblocks);
         blocks [ index ] = 1;
@@ -280,41 +573,45 @@ static int minmax_evaluate_node (ADIOS_QUERY* q, int timestep, int nblocks, char
 
     void * pred_val = string_to_value (q->predicateValue, q->varinfo->type);
 
-    for (i=loop_start; i < loop_end; i++) 
-    {    
-        if (blocks[i] && q->sel && *sel != q->sel)
-        {
-            // if selection is different from previously used selection (in the query tree), then we
-            // have to do boundary checks again here
-            if (q->sel->type == ADIOS_SELECTION_BOUNDINGBOX) 
-            { 
-                if (q->varinfo->global) 
-                {
-                    ADIOS_SELECTION_BOUNDINGBOX_STRUCT bb = q->sel->u.bb;
-                    uint64_t *pg_start = q->varinfo->blockinfo[i+block_start_idx].start;
-                    uint64_t *pg_count = q->varinfo->blockinfo[i+block_start_idx].count;
-                    int k;
-                    for (k = 0; k < bb.ndim; k++) {
-                        if (bb.start[k]+bb.count[k] <= pg_start[k] ||
-                            pg_start[k]+pg_count[k] <= bb.start[k] )
-                            blocks[i] = 0;
-                    }
-                } 
-                else
-                { // what do we do for non-global arrays?
+    if (q->sel && *sel != q->sel && q->sel->type == ADIOS_SELECTION_BOUNDINGBOX && q->varinfo->global)
+    {
+        // if selection is different from previously used selection (in the query tree), then we
+        // have to do boundary checks again here
+        ADIOS_SELECTION_BOUNDINGBOX_STRUCT bb = q->sel->u.bb;
+        for (i=loop_start; i < loop_end; i++) 
+        {    
+            if (blocks[i])
+            {
+                uint64_t *pg_start = q->varinfo->blockinfo[i+block_start_idx].start;
+                uint64_t *pg_count = q->varinfo->blockinfo[i+block_start_idx].count;
+                int k;
+                for (k = 0; k < bb.ndim; k++) {
+                    if (bb.start[k]+bb.count[k] <= pg_start[k] ||
+                        pg_start[k]+pg_count[k] <= bb.start[k] )
+                        blocks[i] = 0;
                 }
             }
-            /* see speed up above 
-            else if (q->sel->type == ADIOS_SELECTION_WRITEBLOCK) 
-            {
-                int index = (q->sel->u.block.is_absolute_index ? 
-                        q->sel->u.block.index - block_start_idx :
-                        q->sel->u.block.index);
-                if (i != index)
-                    blocks[i] = 0;
-            }*/
         }
+        // what do we do for non-global arrays?
+    }
+
+    if (index_supports_type (q->varinfo->type))
+    {
+        // evaluate the predicate on all blocks still in play with the min/max index
+        MINMAX_INDEX *idx = get_index (q, timestep, block_start_idx, nblocks);
+        if (idx)
+        {
+            evaluate_with_index (idx, q->predicateOp, 
+                                 predicate_to_double (pred_val, q->varinfo->type), blocks);
+            *sel = q->sel;
+            return count_flags (blocks, nblocks);
+        }
+    }
 
+    assert (q->varinfo->statistics);
+    assert (q->varinfo->statistics->blocks);
+    for (i=loop_start; i < loop_end; i++) 
+    {    
         if (blocks[i])  // block is still in boundary
         {
             // check the formula finally
@@ -340,8 +637,8 @@ static int minmax_evaluate_node (ADIOS_QUERY* q, int timestep, int nblocks, char
                     // we MAY have a match in block if the predicate value falls inside of the min..max range
                     //blocks[i] = (v >= q->varinfo->statistics->blocks->mins[i+block_start_idx] &&
                     //             v <= q->varinfo->statistics->blocks->maxs[i+block_start_idx]); 
-                    blocks[i] = compare_values (pred_val, ADIOS_GTEQ, q->varinfo->statistics->blocks->mins[i+block_start_idx], q->varinfo->type);
-                    blocks[i] = compare_values (pred_val, ADIOS_LTEQ, q->varinfo->statistics->blocks->maxs[i+block_start_idx], q->varinfo->type);
+                    blocks[i] = compare_values (pred_val, ADIOS_GTEQ, q->varinfo->statistics->blocks->mins[i+block_start_idx], q->varinfo->type) &&
+                                compare_values (pred_val, ADIOS_LTEQ, q->varinfo->statistics->blocks->maxs[i+block_start_idx], q->varinfo->type);
                     break;
                 case ADIOS_NE:
                     // we only know for sure that the block is not a match if all elements
@@ -405,7 +702,12 @@ static int minmax_process_rec(ADIOS_QUERY* q, int timestep, int nblocks, char *
             rightblocks = blocks;
         }
 
-        if ( q->combineOp != ADIOS_QUERY_OP_AND || ln > 0) {
+        if (q->combineOp == ADIOS_QUERY_OP_OR) {
+            // the right side starts from all blocks, so it has to do its own boundary checks
+            ADIOS_SELECTION *rightsel = NULL;
+            rn = minmax_process_rec((ADIOS_QUERY*) q->right, timestep, nblocks, rightblocks, &rightsel, estimate);
+            *sel = rightsel;
+        } else if (ln > 0) {
             rn = minmax_process_rec((ADIOS_QUERY*) q->right, timestep, nblocks, rightblocks, sel, estimate);
         } else {
             rn = 0; // skip evaluating right side since left produced already zero results
@@ -536,11 +838,15 @@ static int can_evaluate(ADIOS_QUERY* q, int timestep, ADIOS_SELECTION **sel, int
         {
             if (!q->varinfo)
                 q->varinfo = common_read_inq_var (q->file, q->varName); // get per block statistics
-            if (q->varinfo && !q->varinfo->statistics)
+            // the statistics are not needed if the min/max index of this step has been built already
+            int has_index = (q->varinfo && find_index (q, timestep) != NULL);
+            if (q->varinfo && !q->varinfo->statistics && !has_index)
                 common_read_inq_var_stat (q->file, q->varinfo, 0, 1); // get per block statistics
             if (q->varinfo && !q->varinfo->blockinfo)
                 common_read_inq_var_blockinfo (q->file, q->varinfo); // get per block dimensions
-            if (q->varinfo  && q->varinfo->statistics  && q->varinfo->statistics->blocks && q->varinfo->blockinfo) {
+            if (q->varinfo  && 
+                ((q->varinfo->statistics && q->varinfo->statistics->blocks) || has_index) && 
+                q->varinfo->blockinfo) {
                 supported = 1;
                 if (q->sel && q->sel->type == ADIOS_SELECTION_BOUNDINGBOX && q->sel->u.bb.ndim != q->varinfo->ndim) {
                     supported = 0;
@@ -597,8 +903,19 @@ static int do_evaluate_now (ADIOS_QUERY *q, int timestep)
         return -1;
     }
 
+    // keep the min/max index of a single condition query for the next evaluation
+    MINMAX_INDEX **index = NULL;
+    int nindex = 0;
+    if (q->queryInternal) {
+        index = INTERNAL(q)->index;
+        nindex = INTERNAL(q)->nindex;
+        INTERNAL(q)->index = NULL;
+        INTERNAL(q)->nindex = 0;
+    }
     free_internal (q);
     create_internal (q);
+    INTERNAL(q)->index = index;
+    INTERNAL(q)->nindex = nindex;
     internal_alloc_blocks (q, nblocks);
     INTERNAL(q)->current_blockid = 0;
     INTERNAL(q)->rightmostsel = qsel;
@@ -10,11 +10,23 @@
 /* Read method for BP files */
 /****************************/
 
+#include "config.h"
 #include <stdlib.h>
 #include <string.h>
 #include <math.h>
 #include <assert.h>
 #include <errno.h>
+#include <limits.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#if HAVE_PTHREAD
+#include <pthread.h>
+#endif
+#ifdef HAVE_SYS_INOTIFY_H
+#include <sys/inotify.h>
+#include <poll.h>
+#endif
 #include "public/adios_read.h"
 #include "public/adios_error.h"
 #include "public/adios_types.h"
@@ -39,13 +51,28 @@
 static int chunk_buffer_size = 1024*1024*16;
 static int poll_interval_msec = 10000; // 10 secs by default
 static int show_hidden_attrs = 0; // don't show hidden attr by default
+static int use_mmap = 0; // read payloads from memory mapped files
+static int lazy_index = 0; // decode variable characteristics on first access
+static int index_threads = 1; // number of threads to decode the index at open
+static int shared_index = 0; // broadcast the raw footer once per node into shared memory
+static int coalesce = 1; // merge the small reads of blocking perform_reads into larger ones
+static uint64_t coalesce_gap = 64*1024; // merge reads at most this many bytes apart
+static int prefetch_steps = 0; // steps read in the background after each blocking perform_reads
+static uint64_t prefetch_buffer = 256*1024*1024; // memory for the prefetched steps
+static int read_threads = 1; // threads serving the requests of a blocking perform_reads
+
+#define STEP_MARKER_POLL_MSEC 100 // longest wait between two checks of a step marker
 
 static ADIOS_VARCHUNK * read_var_bb  (const ADIOS_FILE * fp, read_request * r);
 static ADIOS_VARCHUNK * read_var_pts (const ADIOS_FILE * fp, read_request * r);
 static ADIOS_VARCHUNK * read_var_wb  (const ADIOS_FILE * fp, read_request * r);
+static ADIOS_VARCHUNK * read_var_mapped (const ADIOS_FILE * fp, read_request * r);
 
 static int map_req_varid (const ADIOS_FILE * fp, int varid);
+static void set_file_options (BP_FILE * fh);
 static int adios_wbidx_to_pgidx (const ADIOS_FILE * fp, read_request * r, int step_offset);
+static int read_range (BP_FILE * fh, int file_index, uint64_t offset, uint64_t size, char * data);
+static void prefetch_stop (BP_FILE * fh);
 
 // NCSU - For custom memory allocation
 #define CALLOC(var, num, sz, comment)\
@@ -66,7 +93,15 @@ static int adios_wbidx_to_pgidx (const ADIOS_FILE * fp, read_request * r, int st
     }\
 }\
 
+/* The OPS1/OPS2 macros below set 'slice_ptr' to the first byte of the
+   requested slice. The slice is served from memory if perform_reads has read
+   it ahead (see plan_reads()) or with the 'mmap' parameter from the file
+   mapping, otherwise it is read into fh->b.
+ */
 #define MPI_FILE_READ_OPS1                          \
+        slice_ptr = bp_get_slice_in_memory (fh, -1, slice_offset, slice_size); \
+        if (!slice_ptr)                             \
+        {                                           \
         bp_realloc_aligned(fh->b, slice_size);      \
         fh->b->offset = 0;                          \
                                                     \
@@ -82,9 +117,15 @@ static int adios_wbidx_to_pgidx (const ADIOS_FILE * fp, read_request * r, int st
                       ,&status                      \
                       );                            \
         fh->b->offset = 0;                          \
+        slice_ptr = fh->b->buff;                    \
+        }                                           \
 
 // To read subfiles
 #define MPI_FILE_READ_OPS2                                                                  \
+        slice_ptr = bp_get_slice_in_memory (fh, v->characteristics[start_idx + idx].file_index,\
+                                             slice_offset, slice_size);                     \
+        if (!slice_ptr)                                                                     \
+        {                                                                                   \
         bp_realloc_aligned(fh->b, slice_size);                                              \
         fh->b->offset = 0;                                                                  \
                                                                                             \
@@ -93,25 +134,13 @@ static int adios_wbidx_to_pgidx (const ADIOS_FILE * fp, read_request * r, int st
         if (!sfh)                                                                           \
         {                                                                                   \
             int err;                                                                        \
-            char * ch, * name_no_path, * name;                                              \
+            char * name;                                                                    \
             MPI_Info info = MPI_INFO_NULL;                                                  \
             struct BP_file_handle * new_h =                                                 \
                   (struct BP_file_handle *) malloc (sizeof (struct BP_file_handle));        \
             new_h->file_index = v->characteristics[start_idx + idx].file_index;             \
             new_h->next = 0;                                                                \
-            if ( (ch = strrchr (fh->fname, '/')) )                                          \
-            {                                                                               \
-                name_no_path = (char *) malloc (strlen (ch + 1) + 1);                       \
-                strcpy (name_no_path, ch + 1);                                              \
-            }                                                                               \
-            else                                                                            \
-            {                                                                               \
-                name_no_path = (char *) malloc (strlen (fh->fname) + 1);                    \
-                strcpy (name_no_path, fh->fname);                                           \
-            }                                                                               \
-                                                                                            \
-            name = (char *) malloc (strlen (fh->fname) + 5 + strlen (name_no_path) + 1 + 10 + 1); \
-            sprintf (name, "%s.dir/%s.%d", fh->fname, name_no_path, new_h->file_index);     \
+            name = bp_get_subfile_name (fh->fname, new_h->file_index);                      \
             err = MPI_File_open (MPI_COMM_SELF                                                   \
                                 ,name                                                       \
                                 ,MPI_MODE_RDONLY                                            \
@@ -127,7 +156,6 @@ static int adios_wbidx_to_pgidx (const ADIOS_FILE * fp, read_request * r, int st
            add_BP_subfile_handle (fh, new_h);                                                  \
            sfh = &new_h->fh;                                                                \
                                                                                             \
-           free (name_no_path);                                                             \
            free (name);                                                                     \
         }                                                                                   \
                                                                                             \
@@ -142,6 +170,8 @@ static int adios_wbidx_to_pgidx (const ADIOS_FILE * fp, read_request * r, int st
                       ,&status                                                              \
                       );                                                                    \
         fh->b->offset = 0;                                                                  \
+        slice_ptr = fh->b->buff;                                                            \
+        }                                                                                   \
 
 //We also need to be able to read old .bp which doesn't have 'payload_offset'
 #define MPI_FILE_READ_OPS3                                                                  \
@@ -160,10 +190,18 @@ static int adios_wbidx_to_pgidx (const ADIOS_FILE * fp, read_request * r, int st
         MPI_File_read (fh->mpi_fh, fh->b->buff, tmpcount + 8, MPI_BYTE, &status);           \
         fh->b->offset = 0;                                                                  \
         adios_parse_var_data_header_v1 (fh->b, &var_header);                                \
+        slice_ptr = fh->b->buff + fh->b->offset;                                            \
 
 // NCSU ALACRITY-ADIOS: After much pain and consideration, I've decided to implement a
 //     2nd version of this function to avoid substantial wasted time in the writeblock method
 #define MPI_FILE_READ_OPS1_BUF(buf)                 \
+        slice_ptr = bp_get_slice_in_memory (fh, -1, slice_offset, slice_size); \
+        if (slice_ptr)                              \
+        {                                           \
+            memcpy ((buf), slice_ptr, slice_size);  \
+        }                                           \
+        else                                        \
+        {                                           \
         MPI_File_seek (fh->mpi_fh                   \
                       ,(MPI_Offset)slice_offset     \
                       ,MPI_SEEK_SET                 \
@@ -174,34 +212,31 @@ static int adios_wbidx_to_pgidx (const ADIOS_FILE * fp, read_request * r, int st
                       ,slice_size                   \
                       ,MPI_BYTE                     \
                       ,&status                      \
-                      );
+                      );                            \
+        }
 
 // To read subfiles
 #define MPI_FILE_READ_OPS2_BUF(buf)                                                         \
+        slice_ptr = bp_get_slice_in_memory (fh, v->characteristics[start_idx + idx].file_index,\
+                                             slice_offset, slice_size);                     \
+        if (slice_ptr)                                                                      \
+        {                                                                                   \
+            memcpy ((buf), slice_ptr, slice_size);                                          \
+        }                                                                                   \
+        else                                                                                \
+        {                                                                                   \
         MPI_File * sfh;                                                                     \
         sfh = get_BP_subfile_handle (fh, v->characteristics[start_idx + idx].file_index);   \
         if (!sfh)                                                                           \
         {                                                                                   \
             int err;                                                                        \
-            char * ch, * name_no_path, * name;                                              \
+            char * name;                                                                    \
             MPI_Info info = MPI_INFO_NULL;                                                  \
             struct BP_file_handle * new_h =                                                 \
                   (struct BP_file_handle *) malloc (sizeof (struct BP_file_handle));        \
             new_h->file_index = v->characteristics[start_idx + idx].file_index;             \
             new_h->next = 0;                                                                \
-            if ((ch = strrchr (fh->fname, '/')))                                              \
-            {                                                                               \
-                name_no_path = (char *) malloc (strlen (ch + 1) + 1);                       \
-                strcpy (name_no_path, ch + 1);                                              \
-            }                                                                               \
-            else                                                                            \
-            {                                                                               \
-                name_no_path = (char *) malloc (strlen (fh->fname) + 1);                    \
-                strcpy (name_no_path, fh->fname);                                           \
-            }                                                                               \
-                                                                                            \
-            name = (char *) malloc (strlen (fh->fname) + 5 + strlen (name_no_path) + 1 + 10 + 1); \
-            sprintf (name, "%s.dir/%s.%d", fh->fname, name_no_path, new_h->file_index);     \
+            name = bp_get_subfile_name (fh->fname, new_h->file_index);                      \
             err = MPI_File_open (MPI_COMM_SELF                                                   \
                                 ,name                                                       \
                                 ,MPI_MODE_RDONLY                                            \
@@ -217,7 +252,6 @@ static int adios_wbidx_to_pgidx (const ADIOS_FILE * fp, read_request * r, int st
            add_BP_subfile_handle (fh, new_h);                                                 \
            sfh = &new_h->fh;                                                                \
                                                                                             \
-           free (name_no_path);                                                             \
            free (name);                                                                     \
         }                                                                                   \
                                                                                             \
@@ -230,7 +264,8 @@ static int adios_wbidx_to_pgidx (const ADIOS_FILE * fp, read_request * r, int st
                       ,slice_size                                                           \
                       ,MPI_BYTE                                                             \
                       ,&status                                                              \
-                      );
+                      );                                                                    \
+        }
 
 
 /* This routine release one step. It only frees the var/attr namelist. */
@@ -244,6 +279,13 @@ static void release_step (ADIOS_FILE *fp)
         p->varid_mapping = 0;
     }
 
+    if (p->attrs_by_id)
+    {
+        free (p->attrs_by_id);
+        p->attrs_by_id = 0;
+        p->nattrs_by_id = 0;
+    }
+
     if (fp->var_namelist)
     {
         a2s_free_namelist (fp->var_namelist, fp->nvars);
@@ -259,13 +301,156 @@ static void release_step (ADIOS_FILE *fp)
     }
 }
 
+/* Pass the method parameters that affect file handling to a new BP_FILE */
+static void set_file_options (BP_FILE * fh)
+{
+    fh->use_mmap = use_mmap;
+    fh->lazy_index = lazy_index;
+    fh->index_threads = index_threads;
+    fh->shared_index = shared_index;
+}
+
+/* Read the step marker of fname and its modification time.
+ * Returns 0 if there is a valid marker. */
+static int read_step_marker (const char * fname, uint32_t * step, uint64_t * size, int64_t * mtime)
+{
+    char * name = adios_step_marker_name (fname);
+    struct stat st;
+    int err = stat (name, &st);
+
+    free (name);
+    if (err)
+        return 1;
+    *mtime = (int64_t) st.st_mtime;
+    return (adios_read_step_marker_v1 (fname, step, size) != 0);
+}
+
+/* Remember the step marker of fname before the file is opened, so that
+ * the next step is announced by a change of the marker. A marker older
+ * than the file by more than the poll interval is left over from an earlier
+ * writer, or is not being updated, and the file is polled instead.
+ * Rank 0 reads the marker, all processes learn whether there is one.
+ */
+static void open_step_marker (const char * fname, MPI_Comm comm, struct BP_stream_state * s)
+{
+    int rank;
+    struct stat st;
+
+    MPI_Comm_rank (comm, &rank);
+    if (rank == 0)
+    {
+        s->have_marker = !read_step_marker (fname, &s->marker_step, &s->marker_size,
+                                            &s->marker_mtime);
+        if (s->have_marker && !stat (fname, &st) &&
+            (int64_t) st.st_mtime > s->marker_mtime + poll_interval_msec / 1000 + 1)
+        {
+            log_debug ("step marker of %s is older than the file, polling the file\n", fname);
+            s->have_marker = 0;
+        }
+    }
+    MPI_Bcast (&s->have_marker, 1, MPI_INT, 0, comm);
+}
+
+/* Rank 0: 1 if the step marker of fname changed since the file was opened */
+static int step_marker_changed (const char * fname, const struct BP_stream_state * s)
+{
+    uint32_t step;
+    uint64_t size;
+    int64_t mtime;
+
+    if (read_step_marker (fname, &step, &size, &mtime))
+        return 0; // being replaced, or removed: wait for the next one
+    return (step != s->marker_step || size != s->marker_size);
+}
+
+#ifdef HAVE_SYS_INOTIFY_H
+/* Watch the directory of the step marker, the marker is replaced by a rename */
+static void watch_step_marker (const char * fname, struct BP_stream_state * s)
+{
+    char * dir = strdup (fname);
+    char * slash = strrchr (dir, '/');
+
+    if (slash)
+        *(slash + 1) = '\0';
+    else
+        strcpy (dir, ".");
+
+    s->notify_fd = inotify_init1 (IN_NONBLOCK | IN_CLOEXEC);
+    if (s->notify_fd != -1 &&
+        inotify_add_watch (s->notify_fd, dir, IN_MOVED_TO | IN_CLOSE_WRITE) == -1)
+    {
+        log_debug ("cannot watch %s for step markers: %s\n", dir, strerror (errno));
+        close (s->notify_fd);
+        s->notify_fd = -1;
+    }
+    free (dir);
+}
+#endif
+
+/* Rank 0: wait until the step marker of fname changes, at most timeout_sec
+ * seconds (forever if negative). With inotify the change is seen as soon as
+ * the marker is replaced by a writer on this node; the marker is also
+ * checked every STEP_MARKER_POLL_MSEC for writers on other nodes, which
+ * inotify does not see. Every poll interval, the file itself is checked
+ * in case the writer stopped updating the marker.
+ * Returns 1 if the marker changed, 0 on timeout and -1 if the file changed
+ * but the marker did not, then the file should be polled instead.
+ */
+static int wait_for_step_marker (const char * fname, struct BP_stream_state * s, double timeout_sec)
+{
+    double t0 = adios_gettime_double (), t_file = t0, elapsed;
+    struct stat st;
+    int wait_msec;
+
+    while (!step_marker_changed (fname, s))
+    {
+        elapsed = adios_gettime_double () - t0;
+        if (timeout_sec >= 0.0 && elapsed >= timeout_sec)
+            return 0;
+
+        if ((adios_gettime_double () - t_file) * 1000.0 >= poll_interval_msec)
+        {
+            t_file = adios_gettime_double ();
+            if (!stat (fname, &st) &&
+                (int64_t) st.st_mtime > s->marker_mtime + poll_interval_msec / 1000 + 1)
+                return -1;
+        }
+
+        wait_msec = STEP_MARKER_POLL_MSEC;
+        if (timeout_sec >= 0.0 && (timeout_sec - elapsed) * 1000.0 < wait_msec)
+            wait_msec = (int) ((timeout_sec - elapsed) * 1000.0) + 1;
+
+#ifdef HAVE_SYS_INOTIFY_H
+        if (s->notify_fd == -1)
+            watch_step_marker (fname, s);
+        if (s->notify_fd != -1)
+        {
+            char events [4096];
+            struct pollfd pfd;
+            pfd.fd = s->notify_fd;
+            pfd.events = POLLIN;
+            pfd.revents = 0;
+            if (poll (&pfd, 1, wait_msec) > 0)
+            {
+                // any file of the directory, the marker is checked again anyway
+                while (read (s->notify_fd, events, sizeof (events)) > 0);
+            }
+            continue;
+        }
+#endif
+        adios_nanosleep (0, wait_msec * 1000000L);
+    }
+    return 1;
+}
+
 /* This routin open a ADIOS-BP file with no timeout.
  * It first checks whether this is a valid BP file. This is done by
  * checking the validity on rank 0 and communicating to other ranks (avoiding
  * the situation where every one kicks the tire.
  * If the file is ok, then go ahead get the metadata.
+ * If stream is not NULL, it is attached to the new BP_FILE.
  */
-static BP_FILE * open_file (const char * fname, MPI_Comm comm)
+static BP_FILE * open_file (const char * fname, MPI_Comm comm, struct BP_stream_state * stream)
 {
     int rank, file_ok;
     BP_FILE * fh;
@@ -289,6 +474,12 @@ static BP_FILE * open_file (const char * fname, MPI_Comm comm)
     }
 
     fh = BP_FILE_alloc (fname, comm);
+    set_file_options (fh);
+    if (stream)
+    {
+        fh->stream = stream;
+        open_step_marker (fname, comm, stream);
+    }
 
     bp_open (fname, comm, fh);
 
@@ -299,6 +490,7 @@ static BP_FILE * open_file (const char * fname, MPI_Comm comm)
 void build_ADIOS_FILE_struct (ADIOS_FILE * fp, BP_FILE * fh)
 {
     BP_PROC * p;
+    BP_PROC * old = (BP_PROC *) fp->fh; // of the file closed by advance_step
     int rank;
 
     log_debug ("build_ADIOS_FILE_struct is called\n");
@@ -313,6 +505,18 @@ void build_ADIOS_FILE_struct (ADIOS_FILE * fp, BP_FILE * fh)
     p->local_read_request_list = 0;
     p->b = 0;
     p->priv = 0;
+    p->attrs_by_id = 0;
+    p->nattrs_by_id = 0;
+    // chunks returned from the old mappings stay valid until close
+    p->retired_maps = (old ? old->retired_maps : 0);
+    if (old)
+    {
+        free (old->varid_mapping);
+        free (old->attrs_by_id);
+        free (old->b);
+        list_free_read_request (old->local_read_request_list);
+        free (old);
+    }
 
     fp->fh = (uint64_t) p;
     fp->file_size = fh->mfooter.file_size;
@@ -330,12 +534,20 @@ void build_ADIOS_FILE_struct (ADIOS_FILE * fp, BP_FILE * fh)
     return;
 }
 
-static int get_new_step (ADIOS_FILE * fp, const char * fname, MPI_Comm comm, int last_tidx, float timeout_sec)
+/* Reopen the file until it has steps after last_tidx or the timeout expires.
+ * If the writer updates a step marker, the file is only reopened when the
+ * marker changes, otherwise it is reopened every poll interval.
+ * stream is attached to the new BP_FILE on success.
+ */
+static int get_new_step (ADIOS_FILE * fp, const char * fname, MPI_Comm comm, int last_tidx,
+                         float timeout_sec, struct BP_stream_state * stream)
 {
     BP_FILE * new_fh;
     double t1 = adios_gettime_double();
+    int rank;
 
     log_debug ("enter get_new_step\n");
+    MPI_Comm_rank (comm, &rank);
     /* First check if the file has been updated with more steps. */
     /* While loop for handling timeout
        timeout > 0: wait up to this long to open the stream
@@ -347,26 +559,42 @@ static int get_new_step (ADIOS_FILE * fp, const char * fname, MPI_Comm comm, int
 
     while (stay_in_poll_loop)
     {
-        /* Re-open the file */
-        new_fh = open_file (fname, comm);
-        if (!new_fh)
-        {
-            // file is bad so keeps polling.
-            stay_in_poll_loop = 1;
-        }
-        else if (new_fh && new_fh->tidx_stop == last_tidx)
+        int reopen = 1;
+        if (stream && stream->have_marker)
         {
-            // file is good but no new steps in it. Continue polling.
-            bp_close (new_fh);
-            stay_in_poll_loop = 1;
+            // nothing new unless the writer replaced the marker
+            if (rank == 0)
+            {
+                reopen = step_marker_changed (fname, stream);
+            }
+            MPI_Bcast (&reopen, 1, MPI_INT, 0, comm);
         }
-        else
+
+        if (reopen)
         {
-            // the file looks good and there are new steps written.
-            build_ADIOS_FILE_struct (fp, new_fh);
-            stay_in_poll_loop = 0;
-            found_stream = 1;
+            /* Re-open the file */
+            new_fh = open_file (fname, comm, stream);
+            if (!new_fh)
+            {
+                // file is bad so keeps polling.
+                stay_in_poll_loop = 1;
+            }
+            else if (new_fh && new_fh->tidx_stop == last_tidx)
+            {
+                // file is good but no new steps in it. Continue polling.
+                new_fh->stream = 0;
+                bp_close (new_fh);
+                stay_in_poll_loop = 1;
+            }
+            else
+            {
+                // the file looks good and there are new steps written.
+                build_ADIOS_FILE_struct (fp, new_fh);
+                stay_in_poll_loop = 0;
+                found_stream = 1;
+            }
         }
+
         // check if we need to stay in loop
         if (stay_in_poll_loop)
         {
@@ -374,20 +602,34 @@ static int get_new_step (ADIOS_FILE * fp, const char * fname, MPI_Comm comm, int
             {
                 stay_in_poll_loop = 0;
             }
-            else if (timeout_sec < 0.0)
-            {
-                stay_in_poll_loop = 1;
-            }
             else if (timeout_sec > 0.0 && (adios_gettime_double () - t1 > timeout_sec))
             {
                 log_debug ("Time is out in get_new_step()\n");
                 stay_in_poll_loop = 0;
             }
+            else if (stream && stream->have_marker)
+            {
+                int stale = 0;
+                if (rank == 0)
+                {
+                    stale = (wait_for_step_marker (fname, stream, (timeout_sec < 0.0 ? -1.0 :
+                             timeout_sec - (adios_gettime_double () - t1))) < 0);
+                }
+                MPI_Bcast (&stale, 1, MPI_INT, 0, comm);
+                if (stale)
+                {
+                    // the writer stopped updating the marker, poll the file from now on
+                    log_debug ("step marker of %s is not updated, polling the file\n", fname);
+                    stream->have_marker = 0;
+                }
+            }
             else
             {
                 adios_nanosleep (poll_interval_msec/1000,
                     (int)(((uint64_t)poll_interval_msec * 1000000L)%1000000000L));
             }
+            // everyone follows rank 0 on the timeout
+            MPI_Bcast (&stay_in_poll_loop, 1, MPI_INT, 0, comm);
         }
 
     } // while (stay_in_poll_loop)
@@ -659,9 +901,11 @@ static ADIOS_VARCHUNK * read_var_bb (const ADIOS_FILE *fp, read_request * r)
     void * data;
     int dummy = -1, is_global = 0, size_of_type;
     uint64_t slice_offset, slice_size;
+    char * slice_ptr;
     MPI_Status status;
     ADIOS_VARCHUNK * chunk;
     struct adios_var_header_struct_v1 var_header;
+    struct BP_var_columns * columns = NULL;
     //struct adios_var_payload_struct_v1 var_payload;
 
 //    log_debug ("read_var_bb()\n");
@@ -723,6 +967,16 @@ static ADIOS_VARCHUNK * read_var_bb (const ADIOS_FILE *fp, read_request * r)
 
     size_of_type = bp_get_type_size (v->type, v->characteristics [0].value);
 
+    /* Variables with many blocks are scanned in the columnar block index */
+    if (ndim > 0 && v->characteristics_count >= BP_COLUMNS_MIN_BLOCKS)
+    {
+        columns = bp_get_var_columns (fh, r->varid);
+        if (columns->ndim != ndim)
+        {
+            columns = NULL;
+        }
+    }
+
 //    log_debug ("read_var_bb: from_steps = %d, nsteps = %d\n", r->from_steps, r->nsteps);
 
     /* Note fp->current_step is always 0 for file mode. */
@@ -743,8 +997,15 @@ static ADIOS_VARCHUNK * read_var_bb (const ADIOS_FILE *fp, read_request * r)
 
 //printf ("t = %d(%d,%d), time = %d\n", t, fp->current_step, r->from_steps, time);
 //printf ("c = %d, f = %d, time = %d\n", fp->current_step, r->from_steps, time);
-        start_idx = get_var_start_index (v, time);
-        stop_idx = get_var_stop_index (v, time);
+        if (columns)
+        {
+            bp_columns_time_range (columns, time, &start_idx, &stop_idx);
+        }
+        else
+        {
+            start_idx = get_var_start_index (v, time);
+            stop_idx = get_var_stop_index (v, time);
+        }
 
         if (start_idx < 0 || stop_idx < 0)
         {
@@ -787,7 +1048,7 @@ static ADIOS_VARCHUNK * read_var_bb (const ADIOS_FILE *fp, read_request * r)
                 MPI_FILE_READ_OPS3
             }
 
-            memcpy ((char *)data, fh->b->buff + fh->b->offset, size_of_type);
+            memcpy ((char *)data, slice_ptr, size_of_type);
 
             if (fh->mfooter.change_endianness == adios_flag_yes)
             {
@@ -809,14 +1070,33 @@ static ADIOS_VARCHUNK * read_var_bb (const ADIOS_FILE *fp, read_request * r)
             /* READ AN ARRAY VARIABLE */
             int * idx_table = (int *) malloc (sizeof (int) * (stop_idx - start_idx + 1));
             uint64_t write_offset = 0;
+            uint64_t * blocks = NULL, nblocks = 0, n, k;
+
+            /* For a global array with many blocks, only the blocks that intersect
+               the selection are visited, found in the columnar block index. The
+               first block is always visited, it is fully checked below (bounds,
+               local array). */
+            if (columns && columns->is_global[start_idx])
+            {
+                blocks = (uint64_t *) malloc ((stop_idx - start_idx + 2) * sizeof (uint64_t));
+                assert (blocks);
+                n = bp_columns_find_blocks (columns, time, start, count, blocks + 1);
+                blocks[0] = start_idx;
+                for (k = 1, nblocks = 1; k <= n; k++)
+                {
+                    if (blocks[k] != (uint64_t) start_idx)
+                        blocks[nblocks++] = blocks[k];
+                }
+            }
 /*
                 printf ("count   = "); for (j = 0; j<ndim; j++) printf ("%d ",count[j]); printf ("\n");
                 printf ("start   = "); for (j = 0; j<ndim; j++) printf ("%d ",start[j]); printf ("\n");
 */
             // loop over the list of pgs to read from one-by-one
-            for (idx = 0; idx < stop_idx - start_idx + 1; idx++)
+            for (k = 0; blocks ? k < nblocks : (int64_t) k < stop_idx - start_idx + 1; k++)
             {
                 int flag;
+                idx = (blocks ? (int64_t) blocks[k] - start_idx : (int64_t) k);
                 datasize = 1;
                 var_stride = 1;
                 dset_stride = 1;
@@ -911,7 +1191,7 @@ static ADIOS_VARCHUNK * read_var_bb (const ADIOS_FILE *fp, read_request * r)
                          MPI_FILE_READ_OPS3
                     }
 
-                    memcpy ((char *)data, fh->b->buff + fh->b->offset, slice_size);
+                    memcpy ((char *)data, slice_ptr, slice_size);
                     if (fh->mfooter.change_endianness == adios_flag_yes)
                     {
                         change_endianness (data, slice_size, v->type);
@@ -974,7 +1254,7 @@ static ADIOS_VARCHUNK * read_var_bb (const ADIOS_FILE *fp, read_request * r)
                         MPI_FILE_READ_OPS3
                     }
 
-                    memcpy ((char *)data + write_offset, fh->b->buff + fh->b->offset, slice_size);
+                    memcpy ((char *)data + write_offset, slice_ptr, slice_size);
                     if (fh->mfooter.change_endianness == adios_flag_yes)
                     {
                         change_endianness((char *)data + write_offset, slice_size, v->type);
@@ -1081,7 +1361,7 @@ static ADIOS_VARCHUNK * read_var_bb (const ADIOS_FILE *fp, read_request * r)
                     }
 
                     adios_util_copy_data (data
-                              ,fh->b->buff + fh->b->offset
+                              ,slice_ptr
                               ,0
                               ,hole_break
                               ,size_in_dset
@@ -1097,9 +1377,10 @@ static ADIOS_VARCHUNK * read_var_bb (const ADIOS_FILE *fp, read_request * r)
                               ,v->type
                               );
                 }
-            }  // end for (idx ... loop over pgs
+            }  // end for (k ... loop over pgs
 
             free (idx_table);
+            free (blocks);
 
             total_size += items_read * size_of_type;
             // shift target pointer for next read in
@@ -1129,108 +1410,426 @@ static ADIOS_VARCHUNK * read_var_bb (const ADIOS_FILE *fp, read_request * r)
     return chunk;
 }
 
-/* This routine reads in data for point selection.
-*/
-static ADIOS_VARCHUNK * read_var_pts (const ADIOS_FILE *fp, read_request * r)
+/* Point reads in a bounding box container.
+ *
+ * The points are sorted by their offset in the global array and binned to
+ * the blocks that contain them (the last block written wins, as in
+ * read_var_bb()). Each block is read in runs of elements that start and end
+ * with a point and have holes of at most coalesce_gap bytes, and the points
+ * are copied from the runs to their place in the output. For sparse points
+ * in a large array, this reads the bytes around the points only instead of
+ * the box spanning all points.
+ */
+struct point_item
 {
-    BP_PROC * p = GET_BP_PROC (fp);
-    BP_FILE * fh = GET_BP_FILE (fp);
-    int size_of_type;
-
-    uint64_t i;
-    uint64_t nerr = 0; // number of out of bound errors (points outside of subselection block)
-    ADIOS_SELECTION * sel = r->sel;
-    assert (sel->type == ADIOS_SELECTION_POINTS);
-    ADIOS_VARCHUNK * chunk = NULL;
-    int pndim = sel->u.points.ndim; // dimensionality of points
-    int bndim; // dimensionality of subselection block
-    struct adios_index_var_struct_v1 * v;
-    int step, d;
-    uint64_t zeros[32] = {0, 0, 0, 0,  0, 0, 0, 0,  0, 0, 0, 0,  0, 0, 0, 0,
-                          0, 0, 0, 0,  0, 0, 0, 0,  0, 0, 0, 0,  0, 0, 0, 0};
-    // for statistics
-    uint64_t nelems_read = 0;
-    uint64_t nelems_container = 0;
-    uint64_t points_read = 0;
-    int nreads_performed = 0;
-    double t_span = 0.0, t_read = 0.0, t_pick = 0.0;
-    double te, ttemp;
-    double tb = MPI_Wtime();
+    uint64_t offset; // linear offset of the point in the global array
+    uint64_t index;  // position of the point in the point list
+};
 
+static int compare_point_items (const void * a, const void * b)
+{
+    const struct point_item * x = (const struct point_item *) a;
+    const struct point_item * y = (const struct point_item *) b;
 
-    v = bp_find_var_byid (fh, r->varid);
-    size_of_type = bp_get_type_size (v->type, v->characteristics [0].value);
+    if (x->offset != y->offset)
+        return (x->offset < y->offset ? -1 : 1);
+    if (x->index != y->index)
+        return (x->index < y->index ? -1 : 1);
+    return 0;
+}
 
-    /* The idea is we convert a point selection to bounding box or writeblock selection. */
-    read_request nrs;
-    read_request *nr = &nrs;
+/* 1 if the blocks of the requested steps can be read in byte ranges:
+   global arrays that are not transformed and have a payload offset */
+static int points_can_be_binned (const ADIOS_FILE * fp, const read_request * r,
+                                 struct adios_index_var_struct_v1 * v)
+{
+    BP_PROC * p = GET_BP_PROC (fp);
+    BP_FILE * fh = GET_BP_FILE (fp);
+    struct adios_index_characteristic_struct_v1 * ch;
+    int64_t start_idx, stop_idx, idx;
+    int t, time;
 
-    nr->varid = r->varid;
-    nr->priv = r->priv;
+    if (v->type == adios_string || futils_is_called_from_fortran ())
+    {
+        return 0;
+    }
 
-    ADIOS_SELECTION * container = sel->u.points.container_selection;
-    if (container &&
-        container->type != ADIOS_SELECTION_WRITEBLOCK &&
-        container->type != ADIOS_SELECTION_BOUNDINGBOX)
+    for (t = fp->current_step + r->from_steps; t < fp->current_step + r->from_steps + r->nsteps; t++)
     {
-        log_error ("The container selection of a point selection "
-                "must be either NULL or a bounding box or a writeblock. "
-                "We will use the default global bounding box\n");
-        container = NULL;
+        time = (!p->streaming ? get_time (v, t) : fh->tidx_start + t);
+        start_idx = get_var_start_index (v, time);
+        stop_idx = get_var_stop_index (v, time);
+        if (start_idx < 0 || stop_idx < 0)
+        {
+            continue;
+        }
+        for (idx = start_idx; idx <= stop_idx; idx++)
+        {
+            ch = &v->characteristics[idx];
+            if (ch->transform.transform_type != adios_transform_none
+                || !ch->payload_offset || !is_global_array (ch))
+            {
+                return 0;
+            }
+        }
     }
+    return 1;
+}
 
-    int free_container = 0;
-    if (!container)
+/* Read the points of request r in the bounding box 'container' into dest,
+   npoints values per step. Points outside of the container are skipped and
+   counted in the return value, points in no block are not touched. */
+static uint64_t read_points_binned (const ADIOS_FILE * fp, const read_request * r,
+                                    struct adios_index_var_struct_v1 * v,
+                                    const ADIOS_SELECTION * container, char * dest,
+                                    uint64_t * nelems_read, int * nreads)
+{
+    BP_PROC * p = GET_BP_PROC (fp);
+    BP_FILE * fh = GET_BP_FILE (fp);
+    const ADIOS_SELECTION_POINTS_STRUCT * pts = &r->sel->u.points;
+    struct adios_index_characteristic_struct_v1 * ch;
+    int ndim = container->u.bb.ndim;
+    uint64_t ldims[32], gdims[32], offsets[32], stride[32];
+    uint64_t * coords, * local, * bin_start = NULL, * binned;
+    struct point_item * items;
+    int64_t * owner;
+    uint64_t i, j, k, n, nvalid, nerr = 0, lo, hi, first, last, gap, slice_offset, slice_size;
+    int64_t start_idx, stop_idx, b, nblocks;
+    int d, t, time, step, inside, file_is_fortran, has_subfile, size_of_type, file_index;
+    char * slice_ptr, * out;
+
+    n = pts->npoints;
+    file_is_fortran = is_fortran_file (fh);
+    has_subfile = has_subfiles (fh);
+    size_of_type = bp_get_type_size (v->type, v->characteristics [0].value);
+    gap = (coalesce ? coalesce_gap / size_of_type : 0);
+
+    coords = (uint64_t *) malloc (n * ndim * sizeof (uint64_t));
+    items = (struct point_item *) malloc (n * sizeof (struct point_item));
+    owner = (int64_t *) malloc (n * sizeof (int64_t));
+    binned = (uint64_t *) malloc (n * sizeof (uint64_t));
+    local = (uint64_t *) malloc (n * sizeof (uint64_t));
+    if (!coords || !items || !owner || !binned || !local)
     {
-        // create full bounding box as container
-        ADIOS_VARINFO * vinfo = adios_read_bp_inq_var_byid (fp, r->varid);
-        container = a2sel_boundingbox (vinfo->ndim, zeros, vinfo->dims);
-        free_container = 1;
-        sel->u.points.container_selection = container; // save the container instead of NULL to be used in pick_points_from_boundingbox
-        common_read_free_varinfo (vinfo);
+        adios_error (err_no_memory, "Could not allocate memory to sort %" PRIu64 " points\n", n);
+        goto done;
     }
 
-    char * dest = (char*)(r->data); // pointer to output buffer, will increase
-        // continuously as we pick points
+    /* global coordinates of the points, the ones outside of the container are dropped */
+    if (pts->ndim == ndim)
+    {
+        for (i = 0; i < n * ndim; i++)
+        {
+            coords[i] = pts->points[i] + container->u.bb.start[i % ndim];
+        }
+    }
+    else
+    {
+        a2sel_points_1DtoND_box (n, pts->points, ndim, container->u.bb.start,
+                                 container->u.bb.count, 1, coords);
+    }
 
-    if (container->type == ADIOS_SELECTION_WRITEBLOCK)
+    for (step = 0; step < r->nsteps; step++)
     {
-        // Read the writeblock and then pick the points from memory
-        ADIOS_SELECTION * wbsel = container;
-        ADIOS_SELECTION_WRITEBLOCK_STRUCT *wb = &wbsel->u.block;
-        uint64_t ldims[32], gdims[32], offsets[32];
+        out = dest + (uint64_t) step * n * size_of_type;
+        t = fp->current_step + r->from_steps + step;
+        time = (!p->streaming ? get_time (v, t) : fh->tidx_start + t);
+        start_idx = get_var_start_index (v, time);
+        stop_idx = get_var_stop_index (v, time);
+        if (start_idx < 0 || stop_idx < 0)
+        {
+            adios_error (err_no_data_at_timestep,"Variable %s has no data at %d time step\n",
+                         v->var_name, t);
+            continue;
+        }
+        nblocks = stop_idx - start_idx + 1;
 
-        for (step = 0; step < r->nsteps; step++)
+        /* sort the points by offset in the global array */
+        bp_get_dimension_characteristics_notime (&v->characteristics[start_idx], ldims, gdims,
+                                                 offsets, file_is_fortran);
+        stride[ndim-1] = 1;
+        for (d = ndim - 2; d >= 0; d--)
         {
-            // Get the size of the writeblock
-            //  but first prepare fake request to call adios_wbidx_to_pgidx
-            ttemp = MPI_Wtime();
-            nr->from_steps = r->from_steps;
-            nr->nsteps = r->nsteps;
-            nr->sel = wbsel;
-            int wbidx = wb->is_absolute_index && !p->streaming ?
-                        wb->index :
-                        adios_wbidx_to_pgidx (fp, nr, step);
+            stride[d] = stride[d+1] * gdims[d+1];
+        }
 
-            uint64_t nelems = 1;
-            /* get ldims for the chunk and then calculate payload size */
-            bndim = v->characteristics[wbidx].dims.count;
-            bp_get_dimension_characteristics_notime(&(v->characteristics[wbidx]), ldims, gdims, offsets, is_fortran_file (fh));
-            for (d = 0; d < bndim; d++)
+        nvalid = 0;
+        for (i = 0; i < n; i++)
+        {
+            const uint64_t * c = coords + i * ndim;
+            items[nvalid].offset = 0;
+            for (d = 0; d < ndim; d++)
             {
-                nelems *= ldims [d];
+                if (c[d] < container->u.bb.start[d]
+                    || c[d] >= container->u.bb.start[d] + container->u.bb.count[d])
+                {
+                    break;
+                }
+                items[nvalid].offset += c[d] * stride[d];
             }
-            t_span += MPI_Wtime() - ttemp;
+            if (d < ndim)
+            {
+                nerr++;
+                continue;
+            }
+            items[nvalid].index = i;
+            owner[nvalid] = -1;
+            nvalid++;
+        }
+        qsort (items, nvalid, sizeof (struct point_item), compare_point_items);
 
-            // Read the writeblock
-            nr->data = malloc (nelems*size_of_type);
-            if (nr->data)
+        /* bin the points to the blocks: the points of a block lie between the
+           global offsets of its first and last element */
+        for (b = 0; b < nblocks; b++)
+        {
+            ch = &v->characteristics[start_idx + b];
+            bp_get_dimension_characteristics_notime (ch, ldims, gdims, offsets, file_is_fortran);
+            lo = hi = 0;
+            for (d = 0; d < ndim; d++)
             {
-                nr->from_steps = r->from_steps+step;
-                nr->nsteps = 1;
-                nr->datasize = nelems*size_of_type;
-                nr->sel = wbsel;
-                ttemp = MPI_Wtime();
+                if (!ldims[d])
+                    break;
+                lo += offsets[d] * stride[d];
+                hi += (offsets[d] + ldims[d] - 1) * stride[d];
+            }
+            if (d < ndim)
+            {
+                continue;
+            }
+
+            // first point at or after lo
+            i = 0;
+            j = nvalid;
+            while (i < j)
+            {
+                k = i + (j - i) / 2;
+                if (items[k].offset < lo)
+                    i = k + 1;
+                else
+                    j = k;
+            }
+            for (k = i; k < nvalid && items[k].offset <= hi; k++)
+            {
+                const uint64_t * c = coords + items[k].index * ndim;
+                inside = 1;
+                for (d = 0; d < ndim && inside; d++)
+                {
+                    inside = (c[d] >= offsets[d] && c[d] < offsets[d] + ldims[d]);
+                }
+                if (inside)
+                {
+                    owner[k] = b;
+                }
+            }
+        }
+
+        /* group the points by block, in the order of their offsets */
+        bin_start = (uint64_t *) calloc (nblocks + 1, sizeof (uint64_t));
+        if (!bin_start)
+        {
+            adios_error (err_no_memory, "Could not allocate memory to bin %" PRIu64 " points\n", n);
+            goto done;
+        }
+        for (k = 0; k < nvalid; k++)
+        {
+            if (owner[k] >= 0)
+                bin_start[owner[k] + 1]++;
+        }
+        for (b = 0; b < nblocks; b++)
+        {
+            bin_start[b + 1] += bin_start[b];
+        }
+        for (k = 0; k < nvalid; k++)
+        {
+            if (owner[k] >= 0)
+                binned[bin_start[owner[k]]++] = k;
+        }
+        for (b = nblocks; b > 0; b--)
+        {
+            bin_start[b] = bin_start[b - 1];
+        }
+        bin_start[0] = 0;
+
+        /* read each block in runs around its points */
+        for (b = 0; b < nblocks; b++)
+        {
+            if (bin_start[b] == bin_start[b + 1])
+            {
+                continue;
+            }
+            ch = &v->characteristics[start_idx + b];
+            bp_get_dimension_characteristics_notime (ch, ldims, gdims, offsets, file_is_fortran);
+            file_index = (has_subfile ? (int) ch->file_index : -1);
+
+            for (k = bin_start[b]; k < bin_start[b + 1]; k++)
+            {
+                const uint64_t * c = coords + items[binned[k]].index * ndim;
+                local[k] = 0;
+                for (d = 0; d < ndim; d++)
+                {
+                    local[k] = local[k] * ldims[d] + (c[d] - offsets[d]);
+                }
+            }
+
+            for (i = bin_start[b]; i < bin_start[b + 1]; i = j)
+            {
+                first = last = local[i];
+                for (j = i + 1; j < bin_start[b + 1]; j++)
+                {
+                    if (local[j] > last + 1 + gap
+                        || (local[j] - first + 1) * size_of_type > (uint64_t) chunk_buffer_size)
+                    {
+                        break;
+                    }
+                    last = local[j];
+                }
+
+                slice_offset = ch->payload_offset + first * size_of_type;
+                slice_size = (last - first + 1) * size_of_type;
+                slice_ptr = bp_get_slice_in_memory (fh, file_index, slice_offset, slice_size);
+                if (!slice_ptr)
+                {
+                    bp_realloc_aligned (fh->b, slice_size);
+                    fh->b->offset = 0;
+                    if (read_range (fh, file_index, slice_offset, slice_size, fh->b->buff))
+                    {
+                        adios_error (err_expected_read_size_mismatch,
+                                     "Could not read %" PRIu64 " bytes of variable %s at offset %"
+                                     PRIu64 "\n", slice_size, v->var_name, slice_offset);
+                        continue;
+                    }
+                    slice_ptr = fh->b->buff;
+                }
+
+                for (k = i; k < j; k++)
+                {
+                    char * to = out + items[binned[k]].index * size_of_type;
+                    memcpy (to, slice_ptr + (local[k] - first) * size_of_type, size_of_type);
+                    if (fh->mfooter.change_endianness == adios_flag_yes)
+                    {
+                        change_endianness (to, size_of_type, v->type);
+                    }
+                }
+                *nelems_read += last - first + 1;
+                (*nreads)++;
+            }
+        }
+        free (bin_start);
+        bin_start = NULL;
+    }
+
+done:
+    free (bin_start);
+    free (local);
+    free (binned);
+    free (owner);
+    free (items);
+    free (coords);
+    return nerr;
+}
+
+/* This routine reads in data for point selection.
+*/
+static ADIOS_VARCHUNK * read_var_pts (const ADIOS_FILE *fp, read_request * r)
+{
+    BP_PROC * p = GET_BP_PROC (fp);
+    BP_FILE * fh = GET_BP_FILE (fp);
+    int size_of_type;
+
+    uint64_t i;
+    uint64_t nerr = 0; // number of out of bound errors (points outside of subselection block)
+    ADIOS_SELECTION * sel = r->sel;
+    assert (sel->type == ADIOS_SELECTION_POINTS);
+    ADIOS_VARCHUNK * chunk = NULL;
+    int pndim = sel->u.points.ndim; // dimensionality of points
+    int bndim; // dimensionality of subselection block
+    struct adios_index_var_struct_v1 * v;
+    int step, d;
+    uint64_t zeros[32] = {0, 0, 0, 0,  0, 0, 0, 0,  0, 0, 0, 0,  0, 0, 0, 0,
+                          0, 0, 0, 0,  0, 0, 0, 0,  0, 0, 0, 0,  0, 0, 0, 0};
+    // for statistics
+    uint64_t nelems_read = 0;
+    uint64_t nelems_container = 0;
+    uint64_t points_read = 0;
+    int nreads_performed = 0;
+    double t_span = 0.0, t_read = 0.0, t_pick = 0.0;
+    double te, ttemp;
+    double tb = MPI_Wtime();
+
+
+    v = bp_find_var_byid (fh, r->varid);
+    size_of_type = bp_get_type_size (v->type, v->characteristics [0].value);
+
+    /* The idea is we convert a point selection to bounding box or writeblock selection. */
+    read_request nrs;
+    read_request *nr = &nrs;
+
+    nr->varid = r->varid;
+    nr->priv = r->priv;
+
+    ADIOS_SELECTION * container = sel->u.points.container_selection;
+    if (container &&
+        container->type != ADIOS_SELECTION_WRITEBLOCK &&
+        container->type != ADIOS_SELECTION_BOUNDINGBOX)
+    {
+        log_error ("The container selection of a point selection "
+                "must be either NULL or a bounding box or a writeblock. "
+                "We will use the default global bounding box\n");
+        container = NULL;
+    }
+
+    int free_container = 0;
+    if (!container)
+    {
+        // create full bounding box as container
+        ADIOS_VARINFO * vinfo = adios_read_bp_inq_var_byid (fp, r->varid);
+        container = a2sel_boundingbox (vinfo->ndim, zeros, vinfo->dims);
+        free_container = 1;
+        sel->u.points.container_selection = container; // save the container instead of NULL to be used in pick_points_from_boundingbox
+        common_read_free_varinfo (vinfo);
+    }
+
+    char * dest = (char*)(r->data); // pointer to output buffer, will increase
+        // continuously as we pick points
+
+    if (container->type == ADIOS_SELECTION_WRITEBLOCK)
+    {
+        // Read the writeblock and then pick the points from memory
+        ADIOS_SELECTION * wbsel = container;
+        ADIOS_SELECTION_WRITEBLOCK_STRUCT *wb = &wbsel->u.block;
+        uint64_t ldims[32], gdims[32], offsets[32];
+
+        for (step = 0; step < r->nsteps; step++)
+        {
+            // Get the size of the writeblock
+            //  but first prepare fake request to call adios_wbidx_to_pgidx
+            ttemp = MPI_Wtime();
+            nr->from_steps = r->from_steps;
+            nr->nsteps = r->nsteps;
+            nr->sel = wbsel;
+            int wbidx = wb->is_absolute_index && !p->streaming ?
+                        wb->index :
+                        adios_wbidx_to_pgidx (fp, nr, step);
+
+            uint64_t nelems = 1;
+            /* get ldims for the chunk and then calculate payload size */
+            bndim = v->characteristics[wbidx].dims.count;
+            bp_get_dimension_characteristics_notime(&(v->characteristics[wbidx]), ldims, gdims, offsets, is_fortran_file (fh));
+            for (d = 0; d < bndim; d++)
+            {
+                nelems *= ldims [d];
+            }
+            t_span += MPI_Wtime() - ttemp;
+
+            // Read the writeblock
+            nr->data = malloc (nelems*size_of_type);
+            if (nr->data)
+            {
+                nr->from_steps = r->from_steps+step;
+                nr->nsteps = 1;
+                nr->datasize = nelems*size_of_type;
+                nr->sel = wbsel;
+                ttemp = MPI_Wtime();
                 ADIOS_VARCHUNK * wbchunk = read_var_wb (fp, nr);
                 t_read += MPI_Wtime() - ttemp;
 
@@ -1260,6 +1859,17 @@ static ADIOS_VARCHUNK * read_var_pts (const ADIOS_FILE *fp, read_request * r)
             }
         }
     }
+    else if (container->type == ADIOS_SELECTION_BOUNDINGBOX
+             && container->u.bb.ndim <= 32 && points_can_be_binned (fp, r, v))
+    {
+        // read the bytes around the points only
+        assert (pndim == container->u.bb.ndim || pndim == 1);
+        ttemp = MPI_Wtime();
+        nerr = read_points_binned (fp, r, v, container, dest, &nelems_read, &nreads_performed);
+        t_read += MPI_Wtime() - ttemp;
+        nelems_container = r->nsteps * adios_get_nelements_of_box (container->u.bb.ndim,
+                                container->u.bb.start, container->u.bb.count);
+    }
     else if (container->type == ADIOS_SELECTION_BOUNDINGBOX)
     {
         bndim = container->u.bb.ndim;
@@ -1500,7 +2110,7 @@ static ADIOS_VARCHUNK * read_var_pts (const ADIOS_FILE *fp, read_request * r)
 
 int adios_read_bp_init_method (MPI_Comm comm, PairStruct * params)
 {
-    int  max_chunk_size, pollinterval;
+    int  max_chunk_size, pollinterval, nthreads;
     PairStruct * p = params;
 
     while (p)
@@ -1540,6 +2150,127 @@ int adios_read_bp_init_method (MPI_Comm comm, PairStruct * params)
 
             log_debug ("show_hidden_attrs is set\n");
         }
+        else if (!strcasecmp (p->name, "mmap"))
+        {
+            use_mmap = 1;
+
+            log_debug ("mmap is set, payloads will be read from memory mapped files\n");
+        }
+        else if (!strcasecmp (p->name, "lazy_index"))
+        {
+            lazy_index = 1;
+
+            log_debug ("lazy_index is set, variable characteristics are decoded on first access\n");
+        }
+        else if (!strcasecmp (p->name, "index_threads"))
+        {
+            errno = 0;
+            nthreads = strtol(p->value, NULL, 10);
+            if (nthreads > 0 && !errno)
+            {
+                log_debug ("index_threads set to %d for READ_BP read method\n",
+                            nthreads);
+                index_threads = nthreads;
+            }
+            else
+            {
+                log_error ("Invalid 'index_threads' parameter given to the READ_BP "
+                            "read method: '%s'\n", p->value);
+            }
+        }
+        else if (!strcasecmp (p->name, "shared_index"))
+        {
+#if BP_SHARED_INDEX
+            shared_index = 1;
+
+            log_debug ("shared_index is set, the raw index is broadcast once per node\n");
+#else
+            log_warn ("The 'shared_index' parameter of the READ_BP read method "
+                      "needs MPI-3 shared memory support, it is ignored\n");
+#endif
+        }
+        else if (!strcasecmp (p->name, "coalesce"))
+        {
+            if (p->value && (!strcasecmp (p->value, "no") || !strcasecmp (p->value, "off")
+                             || !strcmp (p->value, "0")))
+            {
+                coalesce = 0;
+                log_debug ("coalesce is off, blocks are read one by one\n");
+            }
+            else
+            {
+                coalesce = 1;
+            }
+        }
+        else if (!strcasecmp (p->name, "coalesce_gap"))
+        {
+            long long gap;
+            errno = 0;
+            gap = p->value ? strtoll (p->value, NULL, 10) : -1;
+            if (gap >= 0 && !errno)
+            {
+                log_debug ("coalesce_gap set to %lld bytes for READ_BP read method\n", gap);
+                coalesce_gap = (uint64_t) gap;
+            }
+            else
+            {
+                log_error ("Invalid 'coalesce_gap' parameter given to the READ_BP "
+                            "read method: '%s'\n", p->value);
+            }
+        }
+        else if (!strcasecmp (p->name, "prefetch"))
+        {
+            long steps;
+            errno = 0;
+            steps = (p->value && *p->value) ? strtol (p->value, NULL, 10) : 1;
+            if (steps >= 0 && !errno)
+            {
+#if HAVE_PTHREAD
+                log_debug ("prefetch set to %ld steps for READ_BP read method\n", steps);
+                prefetch_steps = (int) steps;
+#else
+                log_warn ("The 'prefetch' parameter of the READ_BP read method "
+                          "needs pthreads, it is ignored\n");
+#endif
+            }
+            else
+            {
+                log_error ("Invalid 'prefetch' parameter given to the READ_BP "
+                            "read method: '%s'\n", p->value);
+            }
+        }
+        else if (!strcasecmp (p->name, "prefetch_buffer"))
+        {
+            long mb;
+            errno = 0;
+            mb = p->value ? strtol (p->value, NULL, 10) : -1;
+            if (mb > 0 && !errno)
+            {
+                log_debug ("prefetch_buffer set to %ldMB for READ_BP read method\n", mb);
+                prefetch_buffer = (uint64_t) mb * 1024 * 1024;
+            }
+            else
+            {
+                log_error ("Invalid 'prefetch_buffer' parameter given to the READ_BP "
+                            "read method: '%s'\n", p->value);
+            }
+        }
+        else if (!strcasecmp (p->name, "read_threads"))
+        {
+            // an invalid value is reported by common_read_init_method()
+            errno = 0;
+            nthreads = p->value ? strtol (p->value, NULL, 10) : 0;
+            if (nthreads > 0 && !errno)
+            {
+#if HAVE_PTHREAD
+                log_debug ("read_threads set to %d for READ_BP read method\n", nthreads);
+                read_threads = nthreads;
+#else
+                log_warn ("The 'read_threads' parameter of the READ_BP read method "
+                          "needs pthreads, it is ignored\n");
+#endif
+            }
+        }
 
         p = p->next;
     }
@@ -1553,6 +2284,15 @@ int adios_read_bp_finalize_method ()
     chunk_buffer_size = 1024*1024*16;
     poll_interval_msec = 10000; // 10 secs by default
     show_hidden_attrs = 0; // don't show hidden attr by default
+    use_mmap = 0;
+    lazy_index = 0;
+    index_threads = 1;
+    shared_index = 0;
+    coalesce = 1;
+    coalesce_gap = 64*1024;
+    prefetch_steps = 0;
+    prefetch_buffer = 256*1024*1024;
+    read_threads = 1;
 
     return 0;
 }
@@ -1641,6 +2381,7 @@ static int open_stream (ADIOS_FILE * fp, const char * fname,
     }
 
     fh = BP_FILE_alloc (fname, comm);
+    set_file_options (fh);
 
     p = (BP_PROC *) malloc (sizeof (BP_PROC));
     assert (p);
@@ -1650,6 +2391,13 @@ static int open_stream (ADIOS_FILE * fp, const char * fname,
     p->local_read_request_list = 0;
     p->b = 0;
     p->priv = 0;
+    p->attrs_by_id = 0;
+    p->nattrs_by_id = 0;
+    p->retired_maps = 0;
+
+    /* the step marker and the chained index are kept across reopens */
+    fh->stream = bp_alloc_stream_state ();
+    open_step_marker (fname, comm, fh->stream);
 
     /* BP file open and gp/var/att parsing */
     bp_open (fname, comm, fh);
@@ -1701,6 +2449,7 @@ ADIOS_FILE * adios_read_bp_open_file (const char * fname, MPI_Comm comm)
     MPI_Comm_rank (comm, &rank);
 
     fh = BP_FILE_alloc (fname, comm);
+    set_file_options (fh);
 
     p = (BP_PROC *) malloc (sizeof (BP_PROC));
     assert (p);
@@ -1710,6 +2459,9 @@ ADIOS_FILE * adios_read_bp_open_file (const char * fname, MPI_Comm comm)
     p->local_read_request_list = 0;
     p->b = 0;
     p->priv = 0;
+    p->attrs_by_id = 0;
+    p->nattrs_by_id = 0;
+    p->retired_maps = 0;
 
     /* The ADIOS_FILE struct looks like the following */
 #if 0
@@ -1770,6 +2522,9 @@ typedef struct {
     return fp;
 }
 
+/* With shared_index and lazy_index, close must be called by all processes
+ * that opened the file, see bp_close().
+ */
 int adios_read_bp_close (ADIOS_FILE * fp)
 {
     BP_PROC * p = GET_BP_PROC (fp);
@@ -1777,6 +2532,7 @@ int adios_read_bp_close (ADIOS_FILE * fp)
 
     if (p->fh)
     {
+        prefetch_stop (fh);
         bp_close (fh);
         p->fh = 0;
     }
@@ -1793,6 +2549,15 @@ int adios_read_bp_close (ADIOS_FILE * fp)
         p->local_read_request_list = 0;
     }
 
+    if (p->attrs_by_id)
+    {
+        free (p->attrs_by_id);
+        p->attrs_by_id = 0;
+    }
+
+    bp_unmap_list (&p->retired_maps);
+    free (p->b);
+
     free (p);
 
     if (fp->var_namelist)
@@ -1837,7 +2602,8 @@ int adios_read_bp_advance_step (ADIOS_FILE * fp, int last, float timeout_sec)
 {
     BP_PROC * p = GET_BP_PROC (fp);
     BP_FILE * fh = GET_BP_FILE (fp);
-    int last_tidx;
+    struct BP_stream_state * stream;
+    int last_tidx, current_step;
     MPI_Comm comm;
     char * fname;
 
@@ -1856,28 +2622,34 @@ int adios_read_bp_advance_step (ADIOS_FILE * fp, int last, float timeout_sec)
              // time out.
         {
             last_tidx = fh->tidx_stop;
+            current_step = fp->current_step;
             fname = strdup (fh->fname);
             comm = fh->comm;
+            stream = fh->stream;
+            fh->stream = 0;
 
             if (p->fh)
             {
+                prefetch_stop (fh);
+                bp_retire_maps (fh, &p->retired_maps);
                 bp_close (fh);
                 p->fh = 0;
             }
 
-            if (!get_new_step (fp, fname, comm, last_tidx, timeout_sec))
+            if (!get_new_step (fp, fname, comm, last_tidx, timeout_sec, stream))
             {
                 // With file reading, how can we tell it is the end of the streams?
                 adios_errno = err_step_notready;
+                bp_free_stream_state (stream);
             }
 
             free (fname);
 
             if (adios_errno == 0)
             {
+                // the reopened file was positioned at its first step
                 release_step (fp);
-                bp_seek_to_step (fp, fp->last_step + 1, show_hidden_attrs);
-                fp->current_step = fp->last_step + 1;
+                bp_seek_to_step (fp, current_step + 1, show_hidden_attrs);
             }
         }
     }
@@ -1886,17 +2658,22 @@ int adios_read_bp_advance_step (ADIOS_FILE * fp, int last, float timeout_sec)
         last_tidx = fh->tidx_stop;
         fname = strdup (fh->fname);
         comm = fh->comm;
+        stream = fh->stream;
+        fh->stream = 0;
 
         if (p->fh)
         {
+            prefetch_stop (fh);
+            bp_retire_maps (fh, &p->retired_maps);
             bp_close (fh);
             p->fh = 0;
         }
 
         // lockmode is currently not supported.
-        if (!get_new_step (fp, fh->fname, fh->comm, last_tidx, timeout_sec))
+        if (!get_new_step (fp, fname, comm, last_tidx, timeout_sec, stream))
         {
             adios_errno = err_step_notready;
+            bp_free_stream_state (stream);
         }
 
         free (fname);
@@ -3023,6 +3800,8 @@ ADIOS_TRANSINFO * adios_read_bp_inq_var_transinfo(const ADIOS_FILE *fp, const AD
     }
     transinfo->orig_blockinfo = 0;
     transinfo->transform_metadatas = 0;
+    transinfo->payload_offsets = 0;
+    transinfo->file_indexes = 0;
 
     return transinfo;
 }
@@ -3071,12 +3850,34 @@ int adios_read_bp_inq_var_trans_blockinfo(const ADIOS_FILE *fp, const ADIOS_VARI
     	};
     }
 
+    // Where the blocks are stored, which does not change when steps are appended
+    ti->payload_offsets = (uint64_t *) malloc (vi->sum_nblocks * sizeof (uint64_t));
+    ti->file_indexes = (uint32_t *) malloc (vi->sum_nblocks * sizeof (uint32_t));
+    if (ti->payload_offsets && ti->file_indexes) {
+        for (i = 0; i < vi->sum_nblocks; i++) {
+            ti->payload_offsets[i] = var_root->characteristics[streaming_block_offset + i].payload_offset;
+            ti->file_indexes[i] = var_root->characteristics[streaming_block_offset + i].file_index;
+        }
+    } else {
+        free (ti->payload_offsets);
+        free (ti->file_indexes);
+        ti->payload_offsets = 0;
+        ti->file_indexes = 0;
+    }
+
     return 0;
 }
 
 // NCSU ALACRITY-ADIOS - Dummy function stubs for the staged and staged1 read transports; move to those files at some point
+// The staged method reads untransformed variables only. Report them as such,
+// since the read layer requires a transinfo to schedule a read.
 ADIOS_TRANSINFO * adios_read_bp_staged_inq_var_transinfo(const ADIOS_FILE *fp, const ADIOS_VARINFO *vi) {
-    return NULL;
+    ADIOS_TRANSINFO *transinfo = calloc(1, sizeof(ADIOS_TRANSINFO));
+    if (transinfo) {
+        transinfo->transform_type = adios_transform_none;
+        transinfo->orig_type = adios_unknown;
+    }
+    return transinfo;
 }
 ADIOS_TRANSINFO * adios_read_bp_staged1_inq_var_transinfo(const ADIOS_FILE *fp, const ADIOS_VARINFO *vi) {
     return NULL;
@@ -3230,18 +4031,988 @@ int adios_read_bp_schedule_read_byid (const ADIOS_FILE * fp, const ADIOS_SELECTI
     return 0;
 }
 
-int adios_read_bp_perform_reads (const ADIOS_FILE *fp, int blocking)
+/* Read planner of adios_read_bp_perform_reads().
+ *
+ * A selection that intersects many small blocks costs one file read per
+ * block. Before serving the requests, the planner collects the file ranges
+ * of the small slices the scheduled requests will read, sorts them by file
+ * and offset, and merges ranges at most coalesce_gap bytes apart into reads
+ * of at most chunk_buffer_size bytes. The merged ranges are read at once,
+ * then the MPI_FILE_READ_OPS macros find the slices in memory and the
+ * requests scatter them into the user buffers as usual. Slices that are not
+ * read ahead are read from the file one by one.
+ */
+#define PLAN_MAX_SLICE (1024*1024)       // only slices up to this size are read ahead
+#define PLAN_MAX_STAGED (256*1024*1024)  // memory for ranges read ahead at once
+
+struct plan_range
 {
-    BP_PROC * p = GET_BP_PROC (fp);
-    read_request * r;
-    ADIOS_VARCHUNK * chunk;
+    int file_index;
+    uint64_t offset;
+    uint64_t size;
+    int step;           // absolute step of the slice, -1 if not known
+};
 
-    /* 1. prepare all reads */
-    // check if all user memory is provided for blocking read
-    if (blocking)
+struct read_plan
+{
+    struct plan_range * ranges;
+    uint64_t n;
+    uint64_t allocated;
+    uint64_t max_slice; // larger slices are not added
+    int step;           // step of the slices being added
+};
+
+static void plan_add (struct read_plan * plan, int file_index, uint64_t offset, uint64_t size)
+{
+    if (size == 0 || size > plan->max_slice)
     {
-        r = p->local_read_request_list;
-        while (r)
+        return;
+    }
+
+    if (plan->n == plan->allocated)
+    {
+        uint64_t n = (plan->allocated ? 2 * plan->allocated : 1024);
+        struct plan_range * ranges = (struct plan_range *)
+                realloc (plan->ranges, n * sizeof (struct plan_range));
+        if (!ranges)
+        {
+            return;
+        }
+        plan->ranges = ranges;
+        plan->allocated = n;
+    }
+
+    plan->ranges[plan->n].file_index = file_index;
+    plan->ranges[plan->n].offset = offset;
+    plan->ranges[plan->n].size = size;
+    plan->ranges[plan->n].step = plan->step;
+    plan->n++;
+}
+
+/* The slices read_var_bb() will read for a bounding box request */
+static void plan_bb_request (const ADIOS_FILE * fp, const read_request * r, struct read_plan * plan)
+{
+    BP_PROC * p = GET_BP_PROC (fp);
+    BP_FILE * fh = GET_BP_FILE (fp);
+    struct adios_index_var_struct_v1 * v;
+    struct adios_index_characteristic_struct_v1 * ch;
+    uint64_t start[32], count[32], ldims[32], gdims[32], offsets[32];
+    uint64_t lo, hi, first, last, stride;
+    int64_t start_idx, stop_idx, idx;
+    int i, t, time, ndim, file_is_fortran, has_subfile, size_of_type, dummy = -1;
+
+    ndim = r->sel->u.bb.ndim;
+    v = bp_find_var_byid (fh, r->varid);
+    if (ndim <= 0 || ndim > 32 || !v->characteristics_count)
+    {
+        return;
+    }
+
+    file_is_fortran = is_fortran_file (fh);
+    has_subfile = has_subfiles (fh);
+    size_of_type = bp_get_type_size (v->type, v->characteristics [0].value);
+
+    /* read_var_bb() swaps the selection of a Fortran caller to C order */
+    memcpy (start, r->sel->u.bb.start, ndim * sizeof (uint64_t));
+    memcpy (count, r->sel->u.bb.count, ndim * sizeof (uint64_t));
+    if (futils_is_called_from_fortran ())
+    {
+        swap_order (ndim, start, &dummy);
+        swap_order (ndim, count, &dummy);
+    }
+
+    for (t = fp->current_step + r->from_steps; t < fp->current_step + r->from_steps + r->nsteps; t++)
+    {
+        time = (!p->streaming ? get_time (v, t) : fh->tidx_start + t);
+        start_idx = get_var_start_index (v, time);
+        stop_idx = get_var_stop_index (v, time);
+        if (start_idx < 0 || stop_idx < 0)
+        {
+            continue;
+        }
+
+        for (idx = start_idx; idx <= stop_idx; idx++)
+        {
+            ch = &v->characteristics[idx];
+            if (!ch->payload_offset)
+            {
+                continue;
+            }
+            if (!bp_get_dimension_characteristics_notime (ch, ldims, gdims, offsets, file_is_fortran))
+            {
+                // a local array, only its first block is read
+                break;
+            }
+
+            /* first and last element of the intersection in the payload */
+            first = last = 0;
+            stride = 1;
+            for (i = ndim - 1; i >= 0; i--)
+            {
+                lo = (start[i] > offsets[i] ? start[i] : offsets[i]);
+                hi = (start[i] + count[i] < offsets[i] + ldims[i] ?
+                      start[i] + count[i] : offsets[i] + ldims[i]);
+                if (lo >= hi)
+                {
+                    break;
+                }
+                first += (lo - offsets[i]) * stride;
+                last += (hi - 1 - offsets[i]) * stride;
+                stride *= ldims[i];
+            }
+            if (i >= 0)
+            {
+                continue;
+            }
+
+            plan_add (plan, has_subfile ? (int) ch->file_index : -1,
+                      ch->payload_offset + first * size_of_type,
+                      (last - first + 1) * size_of_type);
+        }
+    }
+}
+
+/* The slices read_var_wb() will read for a writeblock request */
+static void plan_wb_request (const ADIOS_FILE * fp, read_request * r, struct read_plan * plan)
+{
+    BP_PROC * p = GET_BP_PROC (fp);
+    BP_FILE * fh = GET_BP_FILE (fp);
+    const ADIOS_SELECTION_WRITEBLOCK_STRUCT * wb = &r->sel->u.block;
+    struct adios_index_var_struct_v1 * v;
+    struct adios_index_characteristic_struct_v1 * ch;
+    uint64_t ldims[32], gdims[32], offsets[32];
+    uint64_t offset, size;
+    int64_t idx;
+    int i, j, ndim, has_subfile, size_of_type;
+
+    v = bp_find_var_byid (fh, r->varid);
+    has_subfile = has_subfiles (fh);
+
+    for (i = 0; i < r->nsteps; i++)
+    {
+        idx = wb->is_absolute_index && !p->streaming ?
+                  wb->index :
+                  adios_wbidx_to_pgidx (fp, r, i);
+        if (idx < 0 || idx >= v->characteristics_count)
+        {
+            continue;
+        }
+
+        ch = &v->characteristics[idx];
+        ndim = ch->dims.count;
+        if (ndim == 0 || !ch->payload_offset)
+        {
+            continue;
+        }
+
+        size_of_type = bp_get_type_size (v->type, ch->value);
+        offset = ch->payload_offset;
+        if (wb->is_sub_pg_selection)
+        {
+            offset += wb->element_offset * size_of_type;
+            size = wb->nelements * size_of_type;
+        }
+        else
+        {
+            bp_get_dimension_characteristics (ch, ldims, gdims, offsets);
+            size = size_of_type;
+            for (j = 0; j < ndim; j++)
+            {
+                size *= ldims [j];
+            }
+        }
+
+        plan_add (plan, has_subfile ? (int) ch->file_index : -1, offset, size);
+    }
+}
+
+static int compare_plan_ranges (const void * a, const void * b)
+{
+    const struct plan_range * x = (const struct plan_range *) a;
+    const struct plan_range * y = (const struct plan_range *) b;
+
+    if (x->file_index != y->file_index)
+        return (x->file_index < y->file_index ? -1 : 1);
+    if (x->offset != y->offset)
+        return (x->offset < y->offset ? -1 : 1);
+    return 0;
+}
+
+/* Read a range of the main file (file_index < 0) or of a subfile.
+   Returns 0 on success. */
+static int read_range (BP_FILE * fh, int file_index, uint64_t offset, uint64_t size, char * data)
+{
+    MPI_File * mfh;
+    MPI_Status status;
+    int count = 0;
+
+    if (file_index < 0)
+    {
+        mfh = &fh->mpi_fh;
+    }
+    else
+    {
+        mfh = bp_open_subfile (fh, file_index);
+        if (!mfh)
+        {
+            return 1;
+        }
+    }
+
+    MPI_File_seek (*mfh, (MPI_Offset) offset, MPI_SEEK_SET);
+    MPI_File_read (*mfh, data, (int) size, MPI_BYTE, &status);
+    MPI_Get_count (&status, MPI_BYTE, &count);
+
+    return ((uint64_t) count != size);
+}
+
+/* Read ahead the slices of all scheduled requests, see above */
+static void plan_reads (const ADIOS_FILE * fp)
+{
+    BP_PROC * p = GET_BP_PROC (fp);
+    BP_FILE * fh = GET_BP_FILE (fp);
+    struct read_plan plan = {NULL, 0, 0, PLAN_MAX_SLICE, -1};
+    struct plan_range m;
+    read_request * r;
+    uint64_t i, j, end, total = 0, nslices = 0;
+    char * data;
+
+    if (!coalesce || fh->use_mmap)
+    {
+        return;
+    }
+
+    for (r = p->local_read_request_list; r; r = r->next)
+    {
+        if (r->sel->type == ADIOS_SELECTION_BOUNDINGBOX)
+        {
+            plan_bb_request (fp, r, &plan);
+        }
+        else if (r->sel->type == ADIOS_SELECTION_WRITEBLOCK)
+        {
+            plan_wb_request (fp, r, &plan);
+        }
+    }
+
+    // slices prefetched in the background are not read again
+    if (fh->n_prefetched)
+    {
+        for (i = 0, j = 0; i < plan.n; i++)
+        {
+            if (!bp_get_prefetched_slice (fh, plan.ranges[i].file_index,
+                                          plan.ranges[i].offset, plan.ranges[i].size))
+            {
+                plan.ranges[j++] = plan.ranges[i];
+            }
+        }
+        plan.n = j;
+    }
+
+    if (plan.n > 1)
+    {
+        qsort (plan.ranges, plan.n, sizeof (struct plan_range), compare_plan_ranges);
+        fh->staged = (struct BP_staged_range *) malloc (plan.n * sizeof (struct BP_staged_range));
+    }
+
+    for (i = 0; fh->staged && i < plan.n; i = j)
+    {
+        m = plan.ranges[i];
+        for (j = i + 1; j < plan.n; j++)
+        {
+            const struct plan_range * c = &plan.ranges[j];
+            end = (c->offset + c->size > m.offset + m.size ? c->offset + c->size : m.offset + m.size);
+            if (c->file_index != m.file_index
+                || c->offset > m.offset + m.size + coalesce_gap
+                || end - m.offset > (uint64_t) chunk_buffer_size)
+            {
+                break;
+            }
+            m.size = end - m.offset;
+        }
+
+        if (j - i < 2)
+        {
+            // nothing to merge with, read the usual way
+            continue;
+        }
+        if (total + m.size > PLAN_MAX_STAGED)
+        {
+            break;
+        }
+
+        data = (char *) malloc (m.size);
+        if (!data)
+        {
+            break;
+        }
+        if (read_range (fh, m.file_index, m.offset, m.size, data))
+        {
+            free (data);
+            continue;
+        }
+
+        fh->staged[fh->n_staged].file_index = m.file_index;
+        fh->staged[fh->n_staged].offset = m.offset;
+        fh->staged[fh->n_staged].size = m.size;
+        fh->staged[fh->n_staged].data = data;
+        fh->staged[fh->n_staged].step = -1;
+        fh->n_staged++;
+        total += m.size;
+        nslices += j - i;
+    }
+
+    log_debug ("perform_reads: %" PRIu64 " slices read ahead in %" PRIu64 " reads of %" PRIu64
+               " bytes in total, out of %" PRIu64 " slices\n", nslices, fh->n_staged, total, plan.n);
+
+    if (fh->staged && !fh->n_staged)
+    {
+        free (fh->staged);
+        fh->staged = NULL;
+    }
+    free (plan.ranges);
+}
+
+/* Step prefetching, with the 'prefetch=K' read parameter.
+ *
+ * A time series is usually read step after step with the same requests.
+ * After a blocking perform_reads has served its requests, the same requests
+ * are planned for the next K steps and a background thread reads their file
+ * ranges with pread() on its own file descriptors, while the application
+ * works on the current step. The next perform_reads waits for the thread and
+ * the MPI_FILE_READ_OPS macros find the slices in memory, like the ranges of
+ * the read planner. Ranges of steps before the requested ones are dropped,
+ * and at most prefetch_buffer bytes are held. The steps are absolute, so
+ * this works for files read with from_steps and for streams read with
+ * adios_advance_step().
+ */
+struct bp_prefetch
+{
+#if HAVE_PTHREAD
+    pthread_t thread;
+#endif
+    char * fname;
+    struct BP_staged_range * ranges; // data is NULL if the range could not be read
+    uint64_t n;
+};
+
+struct prefetch_fd
+{
+    int file_index;
+    int fd;
+};
+
+static int compare_staged_ranges (const void * a, const void * b)
+{
+    const struct BP_staged_range * x = (const struct BP_staged_range *) a;
+    const struct BP_staged_range * y = (const struct BP_staged_range *) b;
+
+    if (x->file_index != y->file_index)
+        return (x->file_index < y->file_index ? -1 : 1);
+    if (x->offset != y->offset)
+        return (x->offset < y->offset ? -1 : 1);
+    return 0;
+}
+
+static int compare_prefetch_ranges (const void * a, const void * b)
+{
+    const struct plan_range * x = (const struct plan_range *) a;
+    const struct plan_range * y = (const struct plan_range *) b;
+
+    if (x->step != y->step)
+        return (x->step < y->step ? -1 : 1);
+    return compare_plan_ranges (a, b);
+}
+
+/* Read 'size' bytes at 'offset', returns 0 on success */
+static int pread_all (int fd, char * data, uint64_t size, uint64_t offset)
+{
+    ssize_t n;
+
+    while (size > 0)
+    {
+        n = pread (fd, data, size, (off_t) offset);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0)
+            return 1;
+        data += n;
+        offset += n;
+        size -= n;
+    }
+    return 0;
+}
+
+/* A descriptor of the main file (file_index < 0) or of a subfile, opened on
+   first use and kept in *fds. Returns -1 if the file cannot be opened. */
+static int range_fd (const char * fname, int file_index, struct prefetch_fd ** fds, int * nfds)
+{
+    struct prefetch_fd * f;
+    char * name;
+    int k;
+
+    for (k = 0; k < *nfds; k++)
+    {
+        if ((*fds)[k].file_index == file_index)
+            return (*fds)[k].fd;
+    }
+
+    f = (struct prefetch_fd *) realloc (*fds, (*nfds + 1) * sizeof (struct prefetch_fd));
+    if (!f)
+        return -1;
+    *fds = f;
+    name = (file_index < 0 ? strdup (fname) : bp_get_subfile_name (fname, file_index));
+    f[*nfds].file_index = file_index;
+    f[*nfds].fd = (name ? open (name, O_RDONLY) : -1);
+    free (name);
+    return f[(*nfds)++].fd;
+}
+
+static void close_range_fds (struct prefetch_fd * fds, int nfds)
+{
+    int k;
+
+    for (k = 0; k < nfds; k++)
+    {
+        if (fds[k].fd >= 0)
+            close (fds[k].fd);
+    }
+    free (fds);
+}
+
+/* Read a range with pread(), data is NULL if it could not be read */
+static void read_staged_range (struct BP_staged_range * r, int fd)
+{
+    r->data = (fd >= 0 ? (char *) malloc (r->size) : NULL);
+    if (r->data && pread_all (fd, r->data, r->size, r->offset))
+    {
+        free (r->data);
+        r->data = NULL;
+    }
+}
+
+/* The background reads, no MPI calls here */
+static void * prefetch_thread (void * arg)
+{
+    struct bp_prefetch * job = (struct bp_prefetch *) arg;
+    struct prefetch_fd * fds = NULL;
+    uint64_t i;
+    int nfds = 0;
+
+    for (i = 0; i < job->n; i++)
+    {
+        read_staged_range (&job->ranges[i],
+                           range_fd (job->fname, job->ranges[i].file_index, &fds, &nfds));
+    }
+
+    close_range_fds (fds, nfds);
+    return NULL;
+}
+
+static void prefetch_free (struct bp_prefetch * job)
+{
+    uint64_t i;
+
+    for (i = 0; i < job->n; i++)
+    {
+        free (job->ranges[i].data);
+    }
+    free (job->ranges);
+    free (job->fname);
+    free (job);
+}
+
+/* Wait for the background reads and keep the ranges of steps >= min_step */
+static void prefetch_wait (BP_FILE * fh, int min_step)
+{
+    struct bp_prefetch * job = fh->prefetch;
+    struct BP_staged_range * ranges;
+    uint64_t i, n = 0, nmax;
+
+    if (job)
+    {
+#if HAVE_PTHREAD
+        pthread_join (job->thread, NULL);
+#endif
+        fh->prefetch = NULL;
+    }
+
+    nmax = fh->n_prefetched + (job ? job->n : 0);
+    ranges = (nmax ? (struct BP_staged_range *) malloc (nmax * sizeof (struct BP_staged_range)) : NULL);
+    for (i = 0; i < fh->n_prefetched; i++)
+    {
+        if (ranges && fh->prefetched[i].step >= min_step)
+            ranges[n++] = fh->prefetched[i];
+        else
+            free (fh->prefetched[i].data);
+    }
+    for (i = 0; job && i < job->n; i++)
+    {
+        if (ranges && job->ranges[i].data && job->ranges[i].step >= min_step)
+        {
+            ranges[n++] = job->ranges[i];
+            job->ranges[i].data = NULL;
+        }
+    }
+    if (job)
+        prefetch_free (job);
+
+    free (fh->prefetched);
+    fh->prefetched = ranges;
+    fh->n_prefetched = n;
+    if (!n)
+    {
+        free (ranges);
+        fh->prefetched = NULL;
+    }
+    else
+    {
+        qsort (fh->prefetched, n, sizeof (struct BP_staged_range), compare_staged_ranges);
+    }
+}
+
+/* Wait for the background reads and drop them, before the file is closed */
+static void prefetch_stop (BP_FILE * fh)
+{
+    if (fh->prefetch)
+    {
+#if HAVE_PTHREAD
+        pthread_join (fh->prefetch->thread, NULL);
+#endif
+        prefetch_free (fh->prefetch);
+        fh->prefetch = NULL;
+    }
+}
+
+/* The slices of the scheduled requests in the next prefetch_steps steps */
+static void plan_prefetch (const ADIOS_FILE * fp, struct read_plan * plan)
+{
+    BP_PROC * p = GET_BP_PROC (fp);
+    read_request * r, next;
+    int d;
+
+    for (d = 1; d <= prefetch_steps; d++)
+    {
+        for (r = p->local_read_request_list; r; r = r->next)
+        {
+            next = *r;
+            next.from_steps = r->from_steps + d * r->nsteps;
+            if (fp->current_step + next.from_steps + next.nsteps - 1 > fp->last_step)
+            {
+                continue;
+            }
+
+            plan->step = fp->current_step + next.from_steps;
+            if (r->sel->type == ADIOS_SELECTION_BOUNDINGBOX)
+            {
+                plan_bb_request (fp, &next, plan);
+            }
+            else if (r->sel->type == ADIOS_SELECTION_WRITEBLOCK
+                     && !(r->sel->u.block.is_absolute_index && !p->streaming))
+            {
+                plan_wb_request (fp, &next, plan);
+            }
+        }
+    }
+}
+
+/* Start reading the planned ranges in the background */
+static void prefetch_start (const ADIOS_FILE * fp, struct read_plan * plan)
+{
+    BP_FILE * fh = GET_BP_FILE (fp);
+    struct bp_prefetch * job;
+    struct plan_range m;
+    uint64_t i, j, end, held = 0;
+
+    // ranges already in memory are not read again
+    for (i = 0, j = 0; i < plan->n; i++)
+    {
+        if (!bp_get_prefetched_slice (fh, plan->ranges[i].file_index,
+                                      plan->ranges[i].offset, plan->ranges[i].size))
+        {
+            plan->ranges[j++] = plan->ranges[i];
+        }
+    }
+    plan->n = j;
+    if (!plan->n)
+    {
+        return;
+    }
+
+    for (i = 0; i < fh->n_prefetched; i++)
+    {
+        held += fh->prefetched[i].size;
+    }
+
+    job = (struct bp_prefetch *) calloc (1, sizeof (struct bp_prefetch));
+    if (!job)
+    {
+        return;
+    }
+    job->fname = strdup (fh->fname);
+    job->ranges = (struct BP_staged_range *) malloc (plan->n * sizeof (struct BP_staged_range));
+    if (!job->fname || !job->ranges)
+    {
+        prefetch_free (job);
+        return;
+    }
+
+    // nearest steps first, merge the ranges of a step like plan_reads() does
+    qsort (plan->ranges, plan->n, sizeof (struct plan_range), compare_prefetch_ranges);
+    for (i = 0; i < plan->n; i = j)
+    {
+        m = plan->ranges[i];
+        for (j = i + 1; j < plan->n; j++)
+        {
+            const struct plan_range * c = &plan->ranges[j];
+            end = (c->offset + c->size > m.offset + m.size ? c->offset + c->size : m.offset + m.size);
+            if (c->step != m.step || c->file_index != m.file_index
+                || c->offset > m.offset + m.size + coalesce_gap
+                || end - m.offset > (uint64_t) chunk_buffer_size)
+            {
+                break;
+            }
+            m.size = end - m.offset;
+        }
+
+        if (held + m.size > prefetch_buffer)
+        {
+            break;
+        }
+        job->ranges[job->n].file_index = m.file_index;
+        job->ranges[job->n].offset = m.offset;
+        job->ranges[job->n].size = m.size;
+        job->ranges[job->n].data = NULL;
+        job->ranges[job->n].step = m.step;
+        job->n++;
+        held += m.size;
+    }
+
+    log_debug ("perform_reads: prefetch %" PRIu64 " ranges of steps %d to %d\n",
+               job->n, plan->ranges[0].step, plan->ranges[plan->n - 1].step);
+
+#if HAVE_PTHREAD
+    if (job->n && !pthread_create (&job->thread, NULL, prefetch_thread, job))
+    {
+        fh->prefetch = job;
+        return;
+    }
+#endif
+    prefetch_free (job);
+}
+
+/* Threaded perform_reads, with the 'read_threads=N' read parameter.
+ *
+ * The requests are served in batches of at most PLAN_MAX_STAGED planned
+ * bytes. The slices of a batch are merged like in plan_reads() and N threads
+ * read the merged ranges with pread() on their own file descriptors. Then N
+ * threads copy the requests whose slices are all in memory into the user
+ * buffers: read_var() does no I/O for them, and the parts of the index it
+ * builds on first access are built by the calling thread beforehand. The
+ * other requests (points, scalars, ranges that could not be read) are
+ * served by the calling thread as usual. The raw blocks of transformed
+ * variables are read here as well, they are decoded afterwards by
+ * adios_transform_process_all_reads().
+ */
+struct serve_work
+{
+    const ADIOS_FILE * fp;
+    const char * fname;
+    struct BP_staged_range * ranges; // ranges to read
+    uint64_t nranges;
+    read_request ** reqs;            // requests to copy from memory
+    uint64_t nreqs;
+    uint64_t next;                   // next range or request to take
+#if HAVE_PTHREAD
+    pthread_mutex_t lock;
+#endif
+};
+
+static int serve_next (struct serve_work * w, uint64_t n, uint64_t * i)
+{
+    int found = 0;
+#if HAVE_PTHREAD
+    pthread_mutex_lock (&w->lock);
+#endif
+    if (w->next < n)
+    {
+        *i = w->next++;
+        found = 1;
+    }
+#if HAVE_PTHREAD
+    pthread_mutex_unlock (&w->lock);
+#endif
+    return found;
+}
+
+static void * stage_thread (void * arg)
+{
+    struct serve_work * w = (struct serve_work *) arg;
+    struct prefetch_fd * fds = NULL;
+    uint64_t i;
+    int nfds = 0;
+
+    while (serve_next (w, w->nranges, &i))
+    {
+        read_staged_range (&w->ranges[i],
+                           range_fd (w->fname, w->ranges[i].file_index, &fds, &nfds));
+    }
+
+    close_range_fds (fds, nfds);
+    return NULL;
+}
+
+static void * copy_thread (void * arg)
+{
+    struct serve_work * w = (struct serve_work *) arg;
+    uint64_t i;
+
+    while (serve_next (w, w->nreqs, &i))
+    {
+        common_read_free_chunk (read_var (w->fp, w->reqs[i]));
+    }
+    return NULL;
+}
+
+// Runs 'func' on the calling thread and up to read_threads-1 other threads
+static void run_serve_threads (struct serve_work * w, uint64_t n, void * (*func) (void *))
+{
+#if HAVE_PTHREAD
+    pthread_t * threads;
+    int nthreads = (n < (uint64_t) read_threads ? (int) n : read_threads);
+    int i, started = 0;
+
+    w->next = 0;
+    pthread_mutex_init (&w->lock, NULL);
+    threads = (nthreads > 1 ? (pthread_t *) malloc (nthreads * sizeof (pthread_t)) : NULL);
+    for (i = 1; threads && i < nthreads; i++)
+    {
+        if (pthread_create (&threads[i], NULL, func, w))
+        {
+            log_warn ("Could not create read thread, continuing with %d threads\n", i);
+            break;
+        }
+        started = i;
+    }
+
+    func (w);
+
+    for (i = 1; i <= started; i++)
+    {
+        pthread_join (threads[i], NULL);
+    }
+    free (threads);
+    pthread_mutex_destroy (&w->lock);
+#else
+    w->next = 0;
+    func (w);
+#endif
+}
+
+/* Is every slice of the request in memory? Also builds the columnar block
+   index read_var_bb() would otherwise build in a thread. */
+static int request_in_memory (const ADIOS_FILE * fp, read_request * r)
+{
+    BP_FILE * fh = GET_BP_FILE (fp);
+    struct read_plan plan = {NULL, 0, 0, UINT64_MAX, -1};
+    struct adios_index_var_struct_v1 * v;
+    uint64_t i;
+    int in_memory;
+
+    if (r->sel->type == ADIOS_SELECTION_BOUNDINGBOX)
+    {
+        plan_bb_request (fp, r, &plan);
+    }
+    else if (r->sel->type == ADIOS_SELECTION_WRITEBLOCK)
+    {
+        plan_wb_request (fp, r, &plan);
+    }
+
+    // scalars and old files without payload offsets have no slices
+    in_memory = (plan.n > 0);
+    for (i = 0; in_memory && i < plan.n; i++)
+    {
+        in_memory = (bp_get_slice_in_memory (fh, plan.ranges[i].file_index,
+                                             plan.ranges[i].offset, plan.ranges[i].size) != NULL);
+    }
+    free (plan.ranges);
+
+    v = bp_find_var_byid (fh, r->varid);
+    if (in_memory && r->sel->type == ADIOS_SELECTION_BOUNDINGBOX
+        && r->sel->u.bb.ndim > 0 && v->characteristics_count >= BP_COLUMNS_MIN_BLOCKS)
+    {
+        bp_get_var_columns (fh, r->varid);
+    }
+    return in_memory;
+}
+
+static void serve_requests_threaded (const ADIOS_FILE * fp)
+{
+    BP_PROC * p = GET_BP_PROC (fp);
+    BP_FILE * fh = GET_BP_FILE (fp);
+    struct read_plan plan;
+    struct plan_range m;
+    struct serve_work w;
+    read_request * r, ** batch = NULL;
+    uint64_t i, j, n, end, size, planned, nbatch, allocated = 0, nseq;
+
+    memset (&w, 0, sizeof (struct serve_work));
+    w.fp = fp;
+    w.fname = fh->fname;
+
+    while (p->local_read_request_list)
+    {
+        /* take the requests of the next batch off the list */
+        memset (&plan, 0, sizeof (struct read_plan));
+        plan.max_slice = UINT64_MAX;
+        plan.step = -1;
+        planned = 0;
+        nbatch = 0;
+        while ((r = p->local_read_request_list) != NULL)
+        {
+            n = plan.n;
+            if (r->sel->type == ADIOS_SELECTION_BOUNDINGBOX)
+            {
+                plan_bb_request (fp, r, &plan);
+            }
+            else if (r->sel->type == ADIOS_SELECTION_WRITEBLOCK)
+            {
+                plan_wb_request (fp, r, &plan);
+            }
+            for (i = n, size = 0; i < plan.n; i++)
+            {
+                size += plan.ranges[i].size;
+            }
+            if (nbatch && planned + size > PLAN_MAX_STAGED)
+            {
+                plan.n = n;
+                break;
+            }
+
+            if (nbatch == allocated)
+            {
+                read_request ** b = (read_request **)
+                        realloc (batch, (allocated ? 2 * allocated : 256) * sizeof (read_request *));
+                if (!b)
+                {
+                    plan.n = n;
+                    break;
+                }
+                batch = b;
+                allocated = (allocated ? 2 * allocated : 256);
+            }
+            batch[nbatch++] = r;
+            planned += size;
+            p->local_read_request_list = r->next;
+        }
+        if (!nbatch)
+        {
+            // out of memory, serve the rest one by one
+            free (plan.ranges);
+            break;
+        }
+
+        /* read the merged ranges, skipping what is prefetched already */
+        for (i = 0, j = 0; i < plan.n; i++)
+        {
+            if (!bp_get_prefetched_slice (fh, plan.ranges[i].file_index,
+                                          plan.ranges[i].offset, plan.ranges[i].size))
+            {
+                plan.ranges[j++] = plan.ranges[i];
+            }
+        }
+        plan.n = j;
+        qsort (plan.ranges, plan.n, sizeof (struct plan_range), compare_plan_ranges);
+
+        w.ranges = (plan.n ? (struct BP_staged_range *) malloc (plan.n * sizeof (struct BP_staged_range)) : NULL);
+        w.nranges = 0;
+        for (i = 0; w.ranges && i < plan.n; i = j)
+        {
+            m = plan.ranges[i];
+            for (j = i + 1; j < plan.n; j++)
+            {
+                // overlapping slices are always merged, the staged ranges must be disjoint
+                const struct plan_range * c = &plan.ranges[j];
+                end = (c->offset + c->size > m.offset + m.size ? c->offset + c->size : m.offset + m.size);
+                if (c->file_index != m.file_index
+                    || c->offset > m.offset + m.size + (coalesce ? coalesce_gap : 0)
+                    || (c->offset >= m.offset + m.size && end - m.offset > (uint64_t) chunk_buffer_size))
+                {
+                    break;
+                }
+                m.size = end - m.offset;
+            }
+            w.ranges[w.nranges].file_index = m.file_index;
+            w.ranges[w.nranges].offset = m.offset;
+            w.ranges[w.nranges].size = m.size;
+            w.ranges[w.nranges].data = NULL;
+            w.ranges[w.nranges].step = -1;
+            w.nranges++;
+        }
+        free (plan.ranges);
+
+        run_serve_threads (&w, w.nranges, stage_thread);
+
+        for (i = 0, j = 0; i < w.nranges; i++)
+        {
+            if (w.ranges[i].data)
+            {
+                w.ranges[j++] = w.ranges[i];
+            }
+        }
+        fh->staged = w.ranges;
+        fh->n_staged = j;
+
+        /* copy the requests in memory with the threads, serve the others here */
+        w.reqs = (read_request **) malloc (nbatch * sizeof (read_request *));
+        w.nreqs = 0;
+        for (i = 0; i < nbatch; i++)
+        {
+            if (w.reqs && request_in_memory (fp, batch[i]))
+            {
+                w.reqs[w.nreqs++] = batch[i];
+            }
+            else
+            {
+                common_read_free_chunk (read_var (fp, batch[i]));
+            }
+        }
+        nseq = nbatch - w.nreqs;
+
+        run_serve_threads (&w, w.nreqs, copy_thread);
+
+        log_debug ("perform_reads: %" PRIu64 " requests served by %d threads from %" PRIu64
+                   " ranges of %" PRIu64 " bytes in total, %" PRIu64 " served one by one\n",
+                   w.nreqs, read_threads, fh->n_staged, planned, nseq);
+
+        for (i = 0; i < nbatch; i++)
+        {
+            a2sel_free (batch[i]->sel);
+            batch[i]->sel = NULL;
+            free (batch[i]);
+        }
+        free (w.reqs);
+        w.reqs = NULL;
+        bp_free_staged_reads (fh);
+    }
+
+    free (batch);
+}
+
+int adios_read_bp_perform_reads (const ADIOS_FILE *fp, int blocking)
+{
+    BP_PROC * p = GET_BP_PROC (fp);
+    BP_FILE * fh;
+    read_request * r;
+    ADIOS_VARCHUNK * chunk;
+    struct read_plan next = {NULL, 0, 0, UINT64_MAX, -1};
+    int first_step;
+
+    /* 1. prepare all reads */
+    // check if all user memory is provided for blocking read
+    if (blocking)
+    {
+        r = p->local_read_request_list;
+        while (r)
         {
             if (!r->data)
             {
@@ -3261,6 +5032,36 @@ int adios_read_bp_perform_reads (const ADIOS_FILE *fp, int blocking)
         return 0;
     }
 
+    /* 2. wait for the steps prefetched in the background */
+    fh = GET_BP_FILE (fp);
+    if (fh->prefetch || fh->n_prefetched)
+    {
+        first_step = INT_MAX;
+        for (r = p->local_read_request_list; r; r = r->next)
+        {
+            if (fp->current_step + r->from_steps < first_step)
+                first_step = fp->current_step + r->from_steps;
+        }
+        prefetch_wait (fh, first_step);
+    }
+
+    /* 3. plan the next steps to prefetch, while the requests are at hand */
+    if (prefetch_steps > 0 && !fh->use_mmap)
+    {
+        plan_prefetch (fp, &next);
+    }
+
+    /* 4. serve the requests */
+    if (read_threads > 1 && !fh->use_mmap)
+    {
+        serve_requests_threaded (fp);
+    }
+
+    // read ahead the small slices in larger reads
+    if (p->local_read_request_list)
+    {
+        plan_reads (fp);
+    }
     while (p->local_read_request_list)
     {
         chunk = read_var (fp, p->local_read_request_list);
@@ -3275,6 +5076,12 @@ int adios_read_bp_perform_reads (const ADIOS_FILE *fp, int blocking)
         common_read_free_chunk (chunk);
     }
 
+    bp_free_staged_reads (fh);
+
+    /* 5. read the next steps in the background */
+    prefetch_start (fp, &next);
+    free (next.ranges);
+
     return 0;
 }
 
@@ -3545,6 +5352,22 @@ int adios_read_bp_check_reads (const ADIOS_FILE * fp, ADIOS_VARCHUNK ** chunk)
     else // if memory is not pre-allocated
     {
         log_debug ("adios_read_bp_check_reads(): memory is not pre-allocated\n");
+
+        // a whole block can be returned directly from the file mapping
+        varchunk = read_var_mapped (fp, p->local_read_request_list);
+        if (varchunk)
+        {
+            // remove head from list
+            r = p->local_read_request_list;
+            p->local_read_request_list = p->local_read_request_list->next;
+            a2sel_free (r->sel);
+            r->sel = NULL;
+            free(r);
+
+            * chunk = varchunk;
+            return 1;
+        }
+
         // memory is large enough to contain the data
         if (chunk_buffer_size >= p->local_read_request_list->datasize)
         {
@@ -3623,18 +5446,17 @@ int adios_read_bp_check_reads (const ADIOS_FILE * fp, ADIOS_VARCHUNK ** chunk)
     return 0;
 }
 
-int adios_read_bp_get_attr_byid (const ADIOS_FILE * fp, int attrid, enum ADIOS_DATATYPES * type, int * size, void ** data)
+/* Make the list of attributes by attribute ID once per step instead of
+ * traversing the attribute list of the file at every get_attr.
+ * Hidden attributes have IDs only if they are in the attribute name list.
+ */
+static int build_attrs_by_id (const ADIOS_FILE * fp)
 {
-    int i;
+    BP_PROC * p = GET_BP_PROC (fp);
     BP_FILE * fh = GET_BP_FILE (fp);
     struct adios_index_attribute_struct_v1 * attr_root;
-    struct adios_index_var_struct_v1 * var_root, * v1;
-    int file_is_fortran, last_step = fp->last_step, show_hidden_attrs;
-    uint64_t k, attr_c_index, var_c_index;
-
-    adios_errno = 0;
+    int i, n, show_hidden_attrs = 0;
 
-    show_hidden_attrs = 0;
     for (i = 0; i < fp->nattrs; i++)
     {
         if (strstr (fp->attr_namelist[i], "__adios__"))
@@ -3644,45 +5466,47 @@ int adios_read_bp_get_attr_byid (const ADIOS_FILE * fp, int attrid, enum ADIOS_D
         }
     }
 
-    attr_root = fh->attrs_root; /* need to traverse the attribute list of the group */
-    i = 0;
-
-    if (show_hidden_attrs)
+    n = 0;
+    for (attr_root = fh->attrs_root; attr_root; attr_root = attr_root->next)
+        n++;
+    p->attrs_by_id = (struct adios_index_attribute_struct_v1 **)
+                        malloc ((n + 1) * sizeof (struct adios_index_attribute_struct_v1 *));
+    if (!p->attrs_by_id)
     {
-        while (i < attrid && attr_root)
-        {
-            i++;
-            attr_root = attr_root->next;
-        }
+        adios_error (err_no_memory, "Could not allocate memory for the list of attributes\n");
+        return adios_errno;
     }
-    else
+
+    n = 0;
+    for (attr_root = fh->attrs_root; attr_root; attr_root = attr_root->next)
     {
-        while (i < attrid && attr_root)
-        {
-            if (strstr (attr_root->attr_path, "__adios__"))
-            {
-            }
-            else
-            {
-                i++;
-            }
+        if (show_hidden_attrs || !strstr (attr_root->attr_path, "__adios__"))
+            p->attrs_by_id[n++] = attr_root;
+    }
+    p->nattrs_by_id = n;
+    return 0;
+}
 
-            attr_root = attr_root->next;
-        }
+int adios_read_bp_get_attr_byid (const ADIOS_FILE * fp, int attrid, enum ADIOS_DATATYPES * type, int * size, void ** data)
+{
+    BP_PROC * p = GET_BP_PROC (fp);
+    BP_FILE * fh = GET_BP_FILE (fp);
+    struct adios_index_attribute_struct_v1 * attr_root;
+    struct adios_index_var_struct_v1 * var_root, * v1;
+    int file_is_fortran, last_step = fp->last_step;
+    uint64_t k, attr_c_index, var_c_index;
 
-        while (attr_root && strstr (attr_root->attr_path, "__adios__"))
-        {
-            attr_root = attr_root->next;
-        }
-    }
+    adios_errno = 0;
 
-    assert (attr_root);
+    if (!p->attrs_by_id && build_attrs_by_id (fp))
+        return adios_errno;
 
-    if (i != attrid)
+    if (attrid < 0 || attrid >= p->nattrs_by_id)
     {
         adios_error (err_corrupted_attribute, "Attribute id=%d is valid but was not found in internal data structures!\n",attrid);
         return adios_errno;
     }
+    attr_root = p->attrs_by_id[attrid];
 
     /* Look for the last step because some of the hidden attributes, such as last update time,
      * make sense for the most recent value. 07/2011 - Q.Liu
@@ -3773,6 +5597,8 @@ int adios_read_bp_get_attr_byid (const ADIOS_FILE * fp, int attrid, enum ADIOS_D
             return adios_errno;
         }
 
+        bp_decode_var (fh, var_root);
+
         /* default values in case of error */
         *data = NULL;
         *size = 0;
@@ -4124,6 +5950,7 @@ static ADIOS_VARCHUNK * read_var_wb (const ADIOS_FILE * fp, read_request * r)
     uint64_t ldims[32], gdims[32], offsets[32];
     int size_of_type;
     uint64_t slice_offset, slice_size;
+    char * slice_ptr;
     void * data;
     ADIOS_VARCHUNK * chunk;
     MPI_Status status;
@@ -4178,7 +6005,7 @@ static ADIOS_VARCHUNK * read_var_wb (const ADIOS_FILE * fp, read_request * r)
                 MPI_FILE_READ_OPS2
             }
 
-            memcpy((char *)data, fh->b->buff + fh->b->offset, size_of_type);
+            memcpy((char *)data, slice_ptr, size_of_type);
 
             if (fh->mfooter.change_endianness == adios_flag_yes)
             {
@@ -4265,6 +6092,127 @@ static ADIOS_VARCHUNK * read_var_wb (const ADIOS_FILE * fp, read_request * r)
     return chunk;
 }
 
+/* With the 'mmap' parameter, a request that covers exactly one whole block
+ * of one step (a writeblock selection, or a bounding box equal to the block)
+ * is served without copying: the returned chunk points into the file mapping.
+ * The chunk data is valid until the file is closed.
+ * Returns NULL if the request does not qualify, the caller should read it
+ * the usual way then.
+ */
+static ADIOS_VARCHUNK * read_var_mapped (const ADIOS_FILE * fp, read_request * r)
+{
+    BP_PROC * p = GET_BP_PROC (fp);
+    BP_FILE * fh = GET_BP_FILE (fp);
+    struct adios_index_var_struct_v1 * v;
+    struct adios_index_characteristic_struct_v1 * ch;
+    uint64_t ldims[32], gdims[32], offsets[32];
+    uint64_t slice_size;
+    int64_t idx, start_idx, stop_idx;
+    int j, ndim, t, time;
+    char * ptr;
+    ADIOS_VARCHUNK * chunk;
+
+    if (!fh->use_mmap
+        || r->nsteps != 1
+        || fh->mfooter.change_endianness == adios_flag_yes)
+    {
+        return NULL;
+    }
+
+    v = bp_find_var_byid (fh, r->varid);
+    if (v->type == adios_string)
+    {
+        return NULL;
+    }
+
+    idx = -1;
+    if (r->sel->type == ADIOS_SELECTION_WRITEBLOCK)
+    {
+        if (r->sel->u.block.is_sub_pg_selection)
+        {
+            return NULL;
+        }
+        idx = r->sel->u.block.is_absolute_index && !p->streaming ?
+                  r->sel->u.block.index :
+                  adios_wbidx_to_pgidx (fp, r, 0);
+    }
+    else if (r->sel->type == ADIOS_SELECTION_BOUNDINGBOX
+             && !futils_is_called_from_fortran ())
+    {
+        t = fp->current_step + r->from_steps;
+        time = (!p->streaming ? get_time (v, t) : fh->tidx_start + t);
+        start_idx = get_var_start_index (v, time);
+        stop_idx = get_var_stop_index (v, time);
+        ndim = r->sel->u.bb.ndim;
+
+        for (start_idx = (start_idx < 0 ? stop_idx + 1 : start_idx);
+             start_idx <= stop_idx && idx < 0;
+             start_idx++)
+        {
+            ch = &v->characteristics[start_idx];
+            if (ch->time_index != time || ch->dims.count == 0 || !is_global_array (ch))
+            {
+                continue;
+            }
+
+            bp_get_dimension_characteristics_notime (ch, ldims, gdims, offsets,
+                                                     is_fortran_file (fh));
+            for (j = 0; j < ndim; j++)
+            {
+                if (offsets[j] != r->sel->u.bb.start[j] || ldims[j] != r->sel->u.bb.count[j])
+                {
+                    break;
+                }
+            }
+
+            if (j == ndim)
+            {
+                idx = start_idx;
+            }
+        }
+    }
+
+    if (idx < 0 || idx >= v->characteristics_count)
+    {
+        return NULL;
+    }
+
+    ch = &v->characteristics[idx];
+    ndim = ch->dims.count;
+    if (ndim == 0
+        || ch->payload_offset == 0
+        || ch->transform.transform_type != adios_transform_none)
+    {
+        return NULL;
+    }
+
+    slice_size = bp_get_type_size (v->type, "");
+    bp_get_dimension_characteristics (ch, ldims, gdims, offsets);
+    for (j = 0; j < ndim; j++)
+    {
+        slice_size *= ldims[j];
+    }
+
+    ptr = bp_get_mapped_slice (fh, has_subfiles (fh) ? (int) ch->file_index : -1,
+                               ch->payload_offset, slice_size);
+    if (!ptr)
+    {
+        return NULL;
+    }
+
+    chunk = (ADIOS_VARCHUNK *) malloc (sizeof (ADIOS_VARCHUNK));
+    assert (chunk);
+
+    chunk->varid = r->varid;
+    chunk->type = v->type;
+    chunk->from_steps = r->from_steps;
+    chunk->nsteps = r->nsteps;
+    chunk->sel = a2sel_copy (r->sel);
+    chunk->data = ptr;
+
+    return chunk;
+}
+
 #if 0
 // NCSU - Timer series analysis, correlation
 double adios_stat_cor (ADIOS_VARINFO * vix, ADIOS_VARINFO * viy, char * characteristic, uint32_t time_start, uint32_t time_end, uint32_t lag)
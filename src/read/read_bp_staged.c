@@ -39,6 +39,7 @@ static int chunk_buffer_size = -1;  // chunk size - must be set
 static int poll_interval = 10; // 10 secs by default
 static int show_hidden_attrs = 0; // don't show hidden attr by default
 static int num_aggregators = -1; // number of aggregator - must be set
+static uint64_t stripe_size = 1024*1024; // file domains of the aggregators are multiples of this
 
 //private structure of BP_PROC
 typedef struct bp_proc_private_struct
@@ -65,16 +66,12 @@ typedef struct read_request_private
     int rank;
     void * data;
     int file_idx;
-    uint64_t offset;
+    uint64_t offset;        // payload offset of the block
+    uint64_t slice_offset;  // file offset of the bytes of the block to read
+    uint64_t slice_size;    // and their size
     void * parent;
 } rr_pvt_struct;
 
-static void read_buffer (const ADIOS_FILE * fp,
-                         uint64_t buffer_offset,
-                         read_request * r,
-                         read_request * s
-                        );
-
 static int isAggregator (BP_PROC * p)
 {
     assert (p);
@@ -195,206 +192,6 @@ static int calc_data_size (BP_PROC * p)
     return size;
 }
 
-/**************************************************
-* Get the subfile index and associate data offset *
-***************************************************/
-static void get_data_addr (const ADIOS_FILE * fp, int varid,
-                           const read_request * r,
-                           int * file_idx,
-                           uint64_t * offset,
-                           uint64_t * payload_size
-                          )
-{
-    BP_PROC * p = (BP_PROC *) fp->fh;
-    BP_FILE * fh = (BP_FILE *) p->fh;
-    struct adios_index_var_struct_v1 * v;
-    int j, idx, t;
-    int start_idx, stop_idx;
-    int ndim, time, file_is_fortran;
-    uint64_t * dims = 0;
-    uint64_t ldims[32], gdims[32], offsets[32];
-    uint64_t * start, * count;
-    int nsteps, is_global = 0, flag;
-
-    file_is_fortran = is_fortran_file (fh);
-    v = bp_find_var_byid (fh, varid);
-
-    /* Get dimensions and flip if caller != writer language */
-    bp_get_and_swap_dimensions (fp, v, file_is_fortran,
-                                &ndim, &dims, &nsteps,
-                                file_is_fortran);
-
-    assert (ndim == r->sel->u.bb.ndim);
-
-    start = r->sel->u.bb.start;
-    count = r->sel->u.bb.count;
-
-    /* Note fp->current_step is always 0 for file mode. */
-    for (t = fp->current_step + r->from_steps;
-         t < fp->current_step + r->from_steps + r->nsteps; t++
-        )
-    {
-
-        if (!p->streaming)
-        {
-            time = get_time (v, t);
-        }
-        else
-        {
-            time = t + 1;
-        }
-
-        start_idx = get_var_start_index (v, time);
-        stop_idx = get_var_stop_index (v, time);
-
-        if (start_idx < 0 || stop_idx < 0)
-        {
-            adios_error (err_no_data_at_timestep,
-                         "Variable (id=%d) has no data at %d time step in %s\n",
-                         varid, t, __FUNCTION__);
-            continue;
-        }
-
-        if (ndim == 0)
-        {
-            /* THIS IS A SCALAR VARIABLE */
-            idx = 0;
-
-            * file_idx = v->characteristics[start_idx + idx].file_index;
-            * offset = v->characteristics[start_idx + idx].payload_offset;
-            * payload_size = bp_get_type_size (v->type,
-                                               v->characteristics[start_idx + idx].value);
-            return;
-        }
-
-         /* READ AN ARRAY VARIABLE */
-        int * idx_table = (int *) malloc (sizeof(int) * (stop_idx - start_idx + 1));
-
-        // loop over the list of pgs to read from one-by-one
-        for (idx = 0; idx < stop_idx - start_idx + 1; idx++)
-        {
-            idx_table[idx] = 1;
-            /* Each pg can have a different sized array, so we need the actual dimensions from it */
-            is_global = bp_get_dimension_characteristics_notime (&(v->characteristics[start_idx + idx]),
-                                                                 ldims,
-                                                                 gdims,
-                                                                 offsets,
-                                                                 file_is_fortran
-                                                                );
-            if (!is_global)
-            {
-                memcpy (gdims, ldims, ndim * 8);
-            }
-
-            for (j = 0; j < ndim; j++)
-            {
-                if ( (count[j] > gdims[j])
-                  || (start[j] > gdims[j])
-                  || (start[j] + count[j] > gdims[j]))
-                {
-                    adios_error (err_out_of_bound,
-                                 "Error: Variable (id=%d) out of bound ("
-                                 "the data in dimension %d to read is %" PRIu64 " elements from index %" PRIu64
-                                 " but the actual data is [0,%" PRId64 "])",
-                                 varid, j + 1, count[j], start[j], gdims[j] - 1);
-                    return;
-                }
-
-                /* check if there is any data in this pg and this dimension to read in */
-                flag = (offsets[j] >= start[j]
-                        && offsets[j] < start[j] + count[j])
-                    || (offsets[j] < start[j]
-                        && offsets[j] + ldims[j] > start[j] + count[j])
-                    || (offsets[j] + ldims[j] > start[j]
-                        && offsets[j] + ldims[j] <= start[j] + count[j]);
-
-                idx_table[idx] = idx_table[idx] && flag;
-            }
-
-            //FIXME
-            if (idx_table[idx])
-            {
-                free (idx_table);
-                if (dims)
-                {
-                    free (dims);
-                }
-
-                * file_idx = v->characteristics[start_idx + idx].file_index;
-                * offset = v->characteristics[start_idx + idx].payload_offset;
-                * payload_size = bp_get_type_size (v->type, v->characteristics[start_idx + idx].value);
-                for (j = 0; j < ndim; j++)
-                {
-                    * payload_size *= ldims[j];
-                }
-                return;
-            }
-        }
-
-        free (idx_table);
-/*
-        if (isTimeless (file_tdim))
-            break;
-*/
-    } // end for (timestep ... loop over timesteps
-
-    if (dims)
-    {
-        free (dims);
-    }
-}
-
-static void sort_read_requests (BP_PROC * p)
-{
-    bp_proc_pvt_struct * pvt = (bp_proc_pvt_struct *) p->priv;
-    rr_pvt_struct * rr_r, * rr_t; 
-    int file_idx;
-    uint64_t offset;
-    read_request * r = pvt->split_read_request_list;
-    read_request * n = 0, * t, * t_prev, * next;
-    while (r)
-    {
-//printf ("[%d]: r->ra->offset = %" PRIu64 "\n", p->rank, r->ra->offset);
-        rr_r = (rr_pvt_struct *) r->priv;
-        t = n;
-        t_prev = 0;
-        next = r->next;
-
-        file_idx = rr_r->file_idx;
-        offset = rr_r->offset;
-
-        //while (t && t->ra->file_idx <= file_idx)
-        while (t)
-        {
-            rr_t = (rr_pvt_struct *) t->priv;
-            if (rr_t->file_idx > file_idx ||
-                (rr_t->file_idx == file_idx && rr_t->offset > offset)
-               )
-            {
-                break;
-            }
-
-            t_prev = t;
-            t = t->next;
-        }
-
-        if (!t_prev)
-        {
-            r->next = n;
-            n = r;
-        }
-        else
-        {
-            t_prev->next = r;
-            r->next = t;
-        }
-//if (p->rank == 1) list_print_readers (p, n);
-        r = next;
-    }
-
-    pvt->split_read_request_list = n;
-}
-
 /*
 static void send_read_data1 (BP_PROC * p)
 {
@@ -694,7 +491,13 @@ static read_request * split_read_requests (const ADIOS_FILE * fp, read_request *
             n_pvt->rank = rr_pvt->rank;
             n_pvt->file_idx = v->characteristics[start_idx + idx].file_index;
             n_pvt->offset = v->characteristics[start_idx + idx].payload_offset;
+            n_pvt->slice_offset = n_pvt->offset;
+            n_pvt->slice_size = bp_get_type_size (v->type,
+                                                  v->characteristics[start_idx + idx].value);
             n_pvt->parent = r;
+            n->sel = (ADIOS_SELECTION *) malloc (sizeof (ADIOS_SELECTION));
+            assert (n->sel);
+            n->sel->type = ADIOS_SELECTION_BOUNDINGBOX;
             n->sel->u.bb.ndim = 0;
             n->sel->u.bb.start = 0;
             n->sel->u.bb.count = 0;
@@ -898,6 +701,21 @@ static read_request * split_read_requests (const ADIOS_FILE * fp, read_request *
                 n->datasize *= n->sel->u.bb.count[i];
             }
 
+            /* the bytes of the block payload holding the selection: from its first
+             * to its last element in the block */
+            {
+                uint64_t first = 0, last = 0, stride = 1;
+                for (i = ndim - 1; i > -1; i--)
+                {
+                    first += (n->sel->u.bb.start[i] - offsets[i]) * stride;
+                    last += (n->sel->u.bb.start[i] + n->sel->u.bb.count[i] - 1 - offsets[i]) * stride;
+                    stride *= ldims[i];
+                }
+                nrr_pvt->slice_size = bp_get_type_size (v->type, v->characteristics[start_idx + idx].value);
+                nrr_pvt->slice_offset = nrr_pvt->offset + first * nrr_pvt->slice_size;
+                nrr_pvt->slice_size *= last - first + 1;
+            }
+
             list_insert_read_request_tail (&h, n);
         }
 
@@ -935,199 +753,529 @@ static void process_read_requests (const ADIOS_FILE * fp)
     }
 }
 
-static void read_chunk (const ADIOS_FILE * fp,
-                        int file_idx, 
-                        uint64_t chunk_offset, 
-                        uint64_t size
+#ifndef __MPI_DUMMY_H__
+
+static void read_buffer (const ADIOS_FILE * fp,
+                         const char * buff,
+                         uint64_t buffer_offset,
+                         read_request * r,
+                         read_request * s
+                        );
+
+/* Read size bytes at offset of the file (or subfile file_idx) into data */
+static void read_range (const ADIOS_FILE * fp,
+                        int file_idx,
+                        uint64_t offset,
+                        uint64_t size,
+                        char * data
                        )
 {
     BP_PROC * p = (BP_PROC *) fp->fh;
     BP_FILE * fh = (BP_FILE *) p->fh;
     MPI_File * sfh;
     MPI_Status status;
-    int has_subfile;
 
-    //struct timeval t0, t1;
-    //gettimeofday (&t0, NULL);
+    if (has_subfiles (fh))
+    {
+        sfh = bp_open_subfile (fh, file_idx);
+        if (!sfh)
+        {
+            return;
+        }
+    }
+    else
+    {
+        sfh = &fh->mpi_fh;
+    }
+
+    MPI_File_seek (*sfh
+                  ,(MPI_Offset)offset
+                  ,MPI_SEEK_SET
+                  );
+
+    // MPI_File_read takes an int count
+    while (size > 0)
+    {
+        int len = (size > 0x40000000) ? 0x40000000 : (int) size;
+
+        MPI_File_read (*sfh
+                      ,data
+                      ,len
+                      ,MPI_BYTE
+                      ,&status
+                      );
+        data += len;
+        size -= len;
+    }
+}
+
+/* Two-phase collective read among the aggregators.
+ *
+ * Each aggregator has split the read requests of its group into the blocks
+ * they touch (split_read_request_list), and knows the file range of each piece.
+ * 1. The extent of the requested ranges in each (sub)file is reduced over all
+ *    aggregators. The extents are laid out one after the other, each aligned
+ *    to stripe_size, and the result is cut into one file domain of whole
+ *    stripes per aggregator.
+ * 2. Each aggregator merges the ranges of its group, cuts them at the domain
+ *    boundaries and sends the pieces to the owners of the domains (MPI_Alltoallv).
+ * 3. Each domain owner merges the pieces it received from all aggregators,
+ *    so that bytes requested by several groups are read only once, and reads
+ *    them in cycles of at most max_chunk_size bytes. After each cycle the pieces
+ *    are sent back to the aggregators that requested them (MPI_Alltoallv).
+ * 4. Each aggregator copies the data out of its ranges into the requests with
+ *    read_buffer(). The data of the other processes of the group is then sent
+ *    to them by send_read_data().
+ */
+
+#define TWO_PHASE_GAP (64*1024) // read over holes up to this size between requested pieces
 
-    has_subfile = has_subfiles (fh);
+// a range of bytes in the file, or in subfile file_idx
+struct tp_range
+{
+    uint64_t file_idx;
+    uint64_t offset;
+    uint64_t size;
+};
 
-    bp_realloc_aligned(fh->b, size);
-    fh->b->offset = 0;
+// a piece received by a domain owner, and its position in the receive buffer
+struct tp_piece
+{
+    struct tp_range r;
+    int idx;
+};
 
-    if (has_subfile)
+static int compare_tp_ranges (const void * a, const void * b)
+{
+    const struct tp_range * x = (const struct tp_range *) a;
+    const struct tp_range * y = (const struct tp_range *) b;
+
+    if (x->file_idx != y->file_idx)
     {
-        sfh = get_BP_subfile_handle (fh, file_idx);   
+        return (x->file_idx < y->file_idx) ? -1 : 1;
+    }
+    if (x->offset != y->offset)
+    {
+        return (x->offset < y->offset) ? -1 : 1;
+    }
 
-        if (!sfh)
+    return 0;
+}
+
+/* Cut a range at the boundaries of the file domains.
+ * base is the position of the aligned extent of the file starting at lo.
+ * Returns the number of pieces. The pieces and the domain of each are stored
+ * if pieces is not NULL.
+ */
+static int tp_cut_range (const struct tp_range * r, uint64_t base, uint64_t lo,
+                         uint64_t domain_size, struct tp_range * pieces, int * domain)
+{
+    uint64_t offset = r->offset, left = r->size, pos, len;
+    int n = 0;
+
+    while (left > 0)
+    {
+        pos = base + offset - lo;
+        len = domain_size - pos % domain_size;
+        if (len > left)
         {
-            int err;
-            char * ch, * name_no_path, * name;
-            struct BP_file_handle * new_h =
-                  (struct BP_file_handle *) malloc (sizeof (struct BP_file_handle));
+            len = left;
+        }
 
-            new_h->file_index = file_idx;
-            new_h->next = 0;
-            if ( (ch = strrchr (fh->fname, '/')))
-            {
-                name_no_path = malloc (strlen (ch + 1) + 1);
-                strcpy (name_no_path, ch + 1);
-            }
-            else
-            {
-                name_no_path = malloc (strlen (fh->fname) + 1);
-                strcpy (name_no_path, fh->fname);
-            }
+        if (pieces)
+        {
+            pieces[n].file_idx = r->file_idx;
+            pieces[n].offset = offset;
+            pieces[n].size = len;
+            domain[n] = (int) (pos / domain_size);
+        }
+        n++;
 
-            name = malloc (strlen (fh->fname) + 5 + strlen (name_no_path) + 1 + 10 + 1);
-            sprintf (name, "%s.dir/%s.%d", fh->fname, name_no_path, new_h->file_index);
+        offset += len;
+        left -= len;
+    }
 
-            err = MPI_File_open (MPI_COMM_SELF
-                                ,name
-                                ,MPI_MODE_RDONLY
-                                ,MPI_INFO_NULL
-                                ,&new_h->fh
-                                );
-            if (err != MPI_SUCCESS)
+    return n;
+}
+
+static void two_phase_read (const ADIOS_FILE * fp)
+{
+    BP_PROC * p = (BP_PROC *) fp->fh;
+    BP_FILE * fh = (BP_FILE *) p->fh;
+    bp_proc_pvt_struct * pvt = (bp_proc_pvt_struct *) p->priv;
+    MPI_Comm comm = pvt->new_comm2; // the aggregators
+    int has_subfile = has_subfiles (fh);
+    int naggr, nfiles, my_nfiles = 0, ncycles, my_ncycles = 0;
+    int nranges = 0, npieces, nin, nreads, i, j, k, c;
+    struct tp_range * ranges, * pieces, * out, * in, * reads;
+    struct tp_piece * sorted;
+    char ** range_data, ** out_data, ** read_data;
+    int * domain, * out_cycle, * in_cycle, * read_of, * read_cycle;
+    int * scounts, * sdispls, * rcounts, * rdispls, * sbytes, * sbdispls, * rbytes, * rbdispls;
+    uint64_t * lo, * hi, * base, total = 0, domain_size, bytes;
+    char * sbuf, * rbuf;
+    read_request * s;
+
+    MPI_Comm_size (comm, &naggr);
+
+    /* The ranges of the group, merged where they overlap or touch */
+    ranges = (struct tp_range *) malloc (list_get_length (pvt->split_read_request_list)
+                                         * sizeof (struct tp_range) + 1);
+    assert (ranges);
+    for (s = pvt->split_read_request_list; s; s = s->next)
+    {
+        rr_pvt_struct * rr = (rr_pvt_struct *) s->priv;
+        ranges[nranges].file_idx = has_subfile ? rr->file_idx : 0;
+        ranges[nranges].offset = rr->slice_offset;
+        ranges[nranges].size = rr->slice_size;
+        if ((int) ranges[nranges].file_idx >= my_nfiles)
+        {
+            my_nfiles = ranges[nranges].file_idx + 1;
+        }
+        nranges++;
+    }
+
+    qsort (ranges, nranges, sizeof (struct tp_range), compare_tp_ranges);
+    for (i = 0, j = -1; i < nranges; i++)
+    {
+        if (j >= 0 && ranges[i].file_idx == ranges[j].file_idx
+            && ranges[i].offset <= ranges[j].offset + ranges[j].size)
+        {
+            if (ranges[i].offset + ranges[i].size > ranges[j].offset + ranges[j].size)
             {
-                adios_error (err_file_open_error, "Can not open file %s\n", name);
-                return;
+                ranges[j].size = ranges[i].offset + ranges[i].size - ranges[j].offset;
             }
+        }
+        else
+        {
+            ranges[++j] = ranges[i];
+        }
+    }
+    nranges = j + 1;
 
-            add_BP_subfile_handle (fh, new_h);
-            sfh = &new_h->fh;
+    /* 1. the file domains */
+    MPI_Allreduce (&my_nfiles, &nfiles, 1, MPI_INT, MPI_MAX, comm);
+    if (nfiles == 0)
+    {
+        // nothing to read by anyone
+        free (ranges);
+        return;
+    }
 
-            free (name_no_path);
-            free (name);
+    lo = (uint64_t *) malloc (nfiles * 8);
+    hi = (uint64_t *) malloc (nfiles * 8);
+    base = (uint64_t *) malloc (nfiles * 8);
+    assert (lo && hi && base);
+    for (i = 0; i < nfiles; i++)
+    {
+        lo[i] = UINT64_MAX;
+        hi[i] = 0;
+    }
+    for (i = 0; i < nranges; i++)
+    {
+        k = ranges[i].file_idx;
+        if (ranges[i].offset < lo[k])
+        {
+            lo[k] = ranges[i].offset;
         }
+        if (ranges[i].offset + ranges[i].size > hi[k])
+        {
+            hi[k] = ranges[i].offset + ranges[i].size;
+        }
+    }
+    MPI_Allreduce (MPI_IN_PLACE, lo, nfiles, MPI_UNSIGNED_LONG_LONG, MPI_MIN, comm);
+    MPI_Allreduce (MPI_IN_PLACE, hi, nfiles, MPI_UNSIGNED_LONG_LONG, MPI_MAX, comm);
 
-        MPI_File_seek (*sfh
-                      ,(MPI_Offset)chunk_offset
-                      ,MPI_SEEK_SET
-                      );
-        MPI_File_read (*sfh
-                      ,fh->b->buff
-                      ,size
-                      ,MPI_BYTE
-                      ,&status
-                      );
+    for (i = 0; i < nfiles; i++)
+    {
+        base[i] = total;
+        if (lo[i] < hi[i])
+        {
+            lo[i] = lo[i] / stripe_size * stripe_size;
+            hi[i] = (hi[i] + stripe_size - 1) / stripe_size * stripe_size;
+            total += hi[i] - lo[i];
+        }
     }
-    else
+    domain_size = (total / stripe_size + naggr - 1) / naggr * stripe_size;
+
+    log_debug ("two-phase read: %d aggregators, %d files, %" PRIu64 " bytes in file domains of %"
+               PRIu64 " bytes\n", naggr, nfiles, total, domain_size);
+
+    /* 2. cut the ranges into pieces per domain, in the order of the domains */
+    range_data = (char **) malloc (nranges * sizeof (char *) + 1);
+    assert (range_data);
+    npieces = 0;
+    for (i = 0; i < nranges; i++)
     {
-        MPI_File_seek (fh->mpi_fh
-                      ,(MPI_Offset)chunk_offset
-                      ,MPI_SEEK_SET
-                      );
-        MPI_File_read (fh->mpi_fh
-                      ,fh->b->buff
-                      ,size
-                      ,MPI_BYTE
-                      ,&status
-                      );
+        k = ranges[i].file_idx;
+        range_data[i] = (char *) malloc (ranges[i].size);
+        assert (range_data[i]);
+        npieces += tp_cut_range (&ranges[i], base[k], lo[k], domain_size, 0, 0);
     }
 
-    fh->b->offset = 0;
+    pieces = (struct tp_range *) malloc (npieces * sizeof (struct tp_range) + 1);
+    domain = (int *) malloc (npieces * sizeof (int) + 1);
+    out = (struct tp_range *) malloc (npieces * sizeof (struct tp_range) + 1);
+    out_data = (char **) malloc (npieces * sizeof (char *) + 1);
+    out_cycle = (int *) malloc (npieces * sizeof (int) + 1);
+    scounts = (int *) calloc (naggr, sizeof (int));
+    sdispls = (int *) malloc (naggr * sizeof (int));
+    rcounts = (int *) malloc (naggr * sizeof (int));
+    rdispls = (int *) malloc (naggr * sizeof (int));
+    sbytes = (int *) malloc (naggr * sizeof (int));
+    sbdispls = (int *) malloc (naggr * sizeof (int));
+    rbytes = (int *) malloc (naggr * sizeof (int));
+    rbdispls = (int *) malloc (naggr * sizeof (int));
+    assert (pieces && domain && out && out_data && out_cycle && scounts && sdispls
+            && rcounts && rdispls && sbytes && sbdispls && rbytes && rbdispls);
+
+    for (i = 0, j = 0; i < nranges; i++)
+    {
+        k = ranges[i].file_idx;
+        j += tp_cut_range (&ranges[i], base[k], lo[k], domain_size, pieces + j, domain + j);
+    }
+    for (j = 0; j < npieces; j++)
+    {
+        scounts[domain[j]]++;
+    }
+    for (i = 0, k = 0; i < naggr; i++)
+    {
+        sdispls[i] = k;
+        k += scounts[i];
+    }
 
-    //gettimeofday (&t1, NULL);
-    //printf ("read chunk time = %f \n", t1.tv_sec - t0.tv_sec + (double)(t1.tv_usec - t0.tv_usec)/1000000 );
-}
+    // out[] is pieces[] sorted by domain, out_data[] is where their data goes
+    for (i = 0, j = 0; i < nranges; i++)
+    {
+        for (; j < npieces && pieces[j].file_idx == ranges[i].file_idx
+               && pieces[j].offset < ranges[i].offset + ranges[i].size; j++)
+        {
+            k = sdispls[domain[j]]++;
+            out[k] = pieces[j];
+            out_data[k] = range_data[i] + (pieces[j].offset - ranges[i].offset);
+        }
+    }
+    for (i = 0; i < naggr; i++)
+    {
+        sdispls[i] -= scounts[i];
+    }
 
-/* 
-The read request link list needs to be sorted beforehand
-*/
-static void do_read (const ADIOS_FILE * fp)
-{
-    BP_PROC * p = (BP_PROC *) fp->fh;
-    bp_proc_pvt_struct * pvt = (bp_proc_pvt_struct *) p->priv;
-    int file_idx;
-    uint64_t offset, payload_size;
-    //struct timeval t0;
-    //struct timeval t1;
-    //double t2, t3, t4, t5;
+    MPI_Alltoall (scounts, 1, MPI_INT, rcounts, 1, MPI_INT, comm);
+
+    for (i = 0, nin = 0; i < naggr; i++)
+    {
+        rdispls[i] = nin;
+        nin += rcounts[i];
+        sbytes[i] = scounts[i] * sizeof (struct tp_range);
+        sbdispls[i] = sdispls[i] * sizeof (struct tp_range);
+        rbytes[i] = rcounts[i] * sizeof (struct tp_range);
+        rbdispls[i] = rdispls[i] * sizeof (struct tp_range);
+    }
+
+    in = (struct tp_range *) malloc (nin * sizeof (struct tp_range) + 1);
+    in_cycle = (int *) malloc (nin * sizeof (int) + 1);
+    read_of = (int *) malloc (nin * sizeof (int) + 1);
+    sorted = (struct tp_piece *) malloc (nin * sizeof (struct tp_piece) + 1);
+    reads = (struct tp_range *) malloc (nin * sizeof (struct tp_range) + 1);
+    read_cycle = (int *) malloc (nin * sizeof (int) + 1);
+    read_data = (char **) calloc (nin + 1, sizeof (char *));
+    assert (in && in_cycle && read_of && sorted && reads && read_cycle && read_data);
+
+    MPI_Alltoallv (out, sbytes, sbdispls, MPI_BYTE,
+                   in, rbytes, rbdispls, MPI_BYTE, comm);
+
+    /* 3. merge the pieces of my domain into reads, and group the reads into cycles */
+    for (j = 0; j < nin; j++)
+    {
+        sorted[j].r = in[j];
+        sorted[j].idx = j;
+    }
+    qsort (sorted, nin, sizeof (struct tp_piece), compare_tp_ranges);
+
+    nreads = 0;
+    for (j = 0; j < nin; j++)
+    {
+        const struct tp_range * q = &sorted[j].r;
+        struct tp_range * m = (nreads > 0) ? &reads[nreads - 1] : 0;
+        uint64_t end = q->offset + q->size;
+
+        if (nreads > 0 && q->file_idx == m->file_idx
+            && q->offset <= m->offset + m->size + TWO_PHASE_GAP
+            && (end <= m->offset + m->size || end - m->offset <= (uint64_t) chunk_buffer_size))
+        {
+            if (end > m->offset + m->size)
+            {
+                m->size = end - m->offset;
+            }
+        }
+        else
+        {
+            reads[nreads++] = *q;
+        }
+        read_of[sorted[j].idx] = nreads - 1;
+    }
 
-    read_request * s = pvt->split_read_request_list, * f_start = s, * f_end = s;
-    read_request * o_start = s, * o_end = s, * o_prev_end = 0, * parent = 0;
+    for (k = 0, c = 0, bytes = 0; k < nreads; k++)
+    {
+        if (bytes > 0 && bytes + reads[k].size > (uint64_t) chunk_buffer_size)
+        {
+            c++;
+            bytes = 0;
+        }
+        read_cycle[k] = c;
+        bytes += reads[k].size;
+    }
+    my_ncycles = (nreads > 0) ? c + 1 : 0;
 
-    //gettimeofday (&t0, NULL);
+    for (j = 0; j < nin; j++)
+    {
+        in_cycle[j] = read_cycle[read_of[j]];
+    }
 
-    //t2 = MPI_Wtime();
+    // tell the requesters in which cycle each of their pieces comes
+    MPI_Alltoallv (in_cycle, rcounts, rdispls, MPI_INT,
+                   out_cycle, scounts, sdispls, MPI_INT, comm);
+    MPI_Allreduce (&my_ncycles, &ncycles, 1, MPI_INT, MPI_MAX, comm);
 
-    while (f_start)
+    for (c = 0, k = 0; c < ncycles; c++)
     {
-        f_end = f_start;
+        int first_read = k;
 
-        // Find a set of reqeusts that fall into the same file, i.e., [f_start, f_end)
-        while (f_end
-          && ((rr_pvt_struct *) f_end->priv)->file_idx == ((rr_pvt_struct *) f_start->priv)->file_idx)
+        // read this cycle of my domain
+        for (; k < nreads && read_cycle[k] == c; k++)
         {
-            f_end = f_end->next;
+            read_data[k] = (char *) malloc (reads[k].size);
+            assert (read_data[k]);
+            read_range (fp, reads[k].file_idx, reads[k].offset, reads[k].size, read_data[k]);
         }
 
-        o_start = f_start;
-        o_end = f_start;
-        o_prev_end = 0;
+        // pieces going out of my domain, and pieces coming to my ranges
+        for (i = 0, bytes = 0; i < naggr; i++)
+        {
+            sbytes[i] = 0;
+            for (j = rdispls[i]; j < rdispls[i] + rcounts[i]; j++)
+            {
+                if (in_cycle[j] == c)
+                {
+                    sbytes[i] += in[j].size;
+                }
+            }
+            sbdispls[i] = bytes;
+            bytes += sbytes[i];
+        }
+        sbuf = (char *) malloc (bytes + 1);
+        assert (sbuf);
 
-        while (o_start != f_end)
+        for (i = 0, bytes = 0; i < naggr; i++)
         {
-            // Find a set of requests that fall into chunk size, i.e., [o_start, o_end)
-            while (o_end && o_end != f_end
-                  && ((rr_pvt_struct *) o_end->priv)->offset - ((rr_pvt_struct *)o_start->priv)->offset <= chunk_buffer_size)
+            rbytes[i] = 0;
+            for (j = sdispls[i]; j < sdispls[i] + scounts[i]; j++)
             {
-                o_prev_end = o_end;
-                o_end = o_end->next;
+                if (out_cycle[j] == c)
+                {
+                    rbytes[i] += out[j].size;
+                }
             }
+            rbdispls[i] = bytes;
+            bytes += rbytes[i];
+        }
+        rbuf = (char *) malloc (bytes + 1);
+        assert (rbuf);
 
-            // Calculate the var payload size of the last request
-            get_data_addr (fp,
-                           o_prev_end->varid, 
-                           o_prev_end, 
-                           &file_idx, 
-                           &offset, 
-                           &payload_size
-                          );
-//printf ("o_start.offset = %" PRIu64 "\n", o_start->ra->offset);
-//printf ("o_prev_end.offset = %" PRIu64 "\n", o_prev_end->ra->offset);
-
-            //t4 = MPI_Wtime ();
-            // read a chunk from file into internal buffer
-            read_chunk (fp, 
-                        ((rr_pvt_struct *) o_start->priv)->file_idx, 
-                        ((rr_pvt_struct *) o_start->priv)->offset, 
-                        ((rr_pvt_struct *) o_prev_end->priv)->offset
-                         - ((rr_pvt_struct *) o_start->priv)->offset + payload_size
-                       );
-
-            //t5 = MPI_Wtime ();
-//    printf ("read chunk = %f \n", t5 - t4);
-
-            s = o_start;
-            do
+        for (j = 0, bytes = 0; j < nin; j++)
+        {
+            if (in_cycle[j] == c)
             {
-                parent = ((rr_pvt_struct *) s->priv)->parent;
-                // copy data from internal buffer to user buffer
-                read_buffer (fp, ((rr_pvt_struct *) o_start->priv)->offset, parent, s);
+                const struct tp_range * m = &reads[read_of[j]];
+                memcpy (sbuf + bytes, read_data[read_of[j]] + (in[j].offset - m->offset), in[j].size);
+                bytes += in[j].size;
+            }
+        }
 
-                s = s->next;
-            } while (s != o_end);
+        MPI_Alltoallv (sbuf, sbytes, sbdispls, MPI_BYTE,
+                       rbuf, rbytes, rbdispls, MPI_BYTE, comm);
 
-            o_start = o_end;
-            o_prev_end = 0;
+        for (j = 0, bytes = 0; j < npieces; j++)
+        {
+            if (out_cycle[j] == c)
+            {
+                memcpy (out_data[j], rbuf + bytes, out[j].size);
+                bytes += out[j].size;
+            }
         }
 
-        f_start = f_end;
+        free (sbuf);
+        free (rbuf);
+        for (; first_read < k; first_read++)
+        {
+            free (read_data[first_read]);
+            read_data[first_read] = 0;
+        }
     }
 
-    //gettimeofday (&t1, NULL);
-    //t3 = MPI_Wtime ();
+    /* 4. copy from the ranges into the requests */
+    for (s = pvt->split_read_request_list; s; s = s->next)
+    {
+        rr_pvt_struct * rr = (rr_pvt_struct *) s->priv;
+        struct tp_range key;
+        int low = 0, high = nranges - 1, mid;
 
-    //printf ("while time = %f \n", t1.tv_sec - t0.tv_sec + (double)(t1.tv_usec - t0.tv_usec)/1000000 );
-    //printf ("while time = %f \n", t3 - t2);
+        key.file_idx = has_subfile ? rr->file_idx : 0;
+        key.offset = rr->slice_offset;
+
+        // the last range starting at or before the slice
+        while (low < high)
+        {
+            mid = (low + high + 1) / 2;
+            if (compare_tp_ranges (&ranges[mid], &key) <= 0)
+            {
+                low = mid;
+            }
+            else
+            {
+                high = mid - 1;
+            }
+        }
+
+        read_buffer (fp, range_data[low], ranges[low].offset, rr->parent, s);
+    }
+
+    for (i = 0; i < nranges; i++)
+    {
+        free (range_data[i]);
+    }
+    free (range_data);
+    free (ranges);
+    free (lo);
+    free (hi);
+    free (base);
+    free (pieces);
+    free (domain);
+    free (out);
+    free (out_data);
+    free (out_cycle);
+    free (in);
+    free (in_cycle);
+    free (read_of);
+    free (sorted);
+    free (reads);
+    free (read_cycle);
+    free (read_data);
+    free (scounts);
+    free (sdispls);
+    free (rcounts);
+    free (rdispls);
+    free (sbytes);
+    free (sbdispls);
+    free (rbytes);
+    free (rbdispls);
 }
 
 /* r - the original read rquest
  * s - the read request as the result of spliting
  */
 static void read_buffer (const ADIOS_FILE * fp,
+                         const char * buff,
                          uint64_t buffer_offset,
                          read_request * r,
                          read_request * s
@@ -1213,8 +1361,13 @@ static void read_buffer (const ADIOS_FILE * fp,
             }
 
             slice_offset = v->characteristics[start_idx + idx].payload_offset;
+            if (slice_offset != ((rr_pvt_struct *) s->priv)->offset)
+            {
+                // the value of another step, s is not about it
+                continue;
+            }
 
-            memcpy (data, fh->b->buff + slice_offset - buffer_offset, size_unit);
+            memcpy (data, buff + slice_offset - buffer_offset, size_unit);
             if (fh->mfooter.change_endianness == adios_flag_yes)
             {
                 change_endianness (data, size_unit, v->type);
@@ -1240,6 +1393,14 @@ static void read_buffer (const ADIOS_FILE * fp,
             int flag1, flag2;
             uint64_t payload_size = size_unit;
 
+            /* s is about one block only (not even one at the same place in
+             * another step), and only its data is in the buffer */
+            if (v->characteristics[start_idx + idx].payload_offset != ((rr_pvt_struct *) s->priv)->offset
+                || v->characteristics[start_idx + idx].file_index != ((rr_pvt_struct *) s->priv)->file_idx)
+            {
+                continue;
+            }
+
             datasize = 1;
             var_stride = 1;
             dset_stride = 1;
@@ -1324,7 +1485,7 @@ static void read_buffer (const ADIOS_FILE * fp,
 
                 if (idx_check2)
                 {
-                    memcpy (data, fh->b->buff + slice_offset - buffer_offset, slice_size);
+                    memcpy (data, buff + slice_offset - buffer_offset, slice_size);
                     if (fh->mfooter.change_endianness == adios_flag_yes)
                     {
                         change_endianness (data, slice_size, v->type);
@@ -1384,7 +1545,7 @@ static void read_buffer (const ADIOS_FILE * fp,
                 if (idx_check2)
                 {
                     memcpy ((char *) data + write_offset,
-                            fh->b->buff + slice_offset - buffer_offset,
+                            buff + slice_offset - buffer_offset,
                             slice_size
                            );
                     if (fh->mfooter.change_endianness == adios_flag_yes)
@@ -1482,7 +1643,7 @@ static void read_buffer (const ADIOS_FILE * fp,
                 if (idx_check2)
                 {
                     adios_util_copy_data (data
-                              ,fh->b->buff + fh->b->offset + slice_offset - buffer_offset
+                              ,(char *) buff + slice_offset - buffer_offset
                               ,0
                               ,break_dim
                               ,size_in_dset
@@ -1508,6 +1669,16 @@ static void read_buffer (const ADIOS_FILE * fp,
 #undef MAX_DIMS
 }
 
+#else
+
+static void two_phase_read (const ADIOS_FILE * fp)
+{
+    adios_error (err_operation_not_supported,
+                 "The BP_AGGREGATE read method is not available without MPI\n");
+}
+
+#endif
+
 static void broadcast_fh_buffer (ADIOS_FILE * fp)
 {
     BP_PROC * p = (BP_PROC *) fp->fh;
@@ -1607,6 +1778,7 @@ static void broadcast_fh_buffer (ADIOS_FILE * fp)
         }
 
         vars_root = fh->vars_root;
+        i = 0;
         while (vars_root)
         {
             _buffer_write (&buffer, &buffer_size, &buffer_offset, 
@@ -1632,7 +1804,9 @@ static void broadcast_fh_buffer (ADIOS_FILE * fp)
             _buffer_write (&buffer, &buffer_size, &buffer_offset, 
                            &vars_root->type, 4); // type
 
-            ADIOS_VARINFO * vi = bp_inq_var_byid (fp, vars_root->id - 1);
+            // the index of a variable is its position in the list, which is
+            // not always its id (e.g. in files of the MPI_AGGREGATE method)
+            ADIOS_VARINFO * vi = bp_inq_var_byid (fp, i);
             assert (vi);
 
             _buffer_write (&buffer, &buffer_size, &buffer_offset, 
@@ -1670,6 +1844,7 @@ fprintf (stderr, "bc %s bo 1 = %" PRIu64 ", bo 2 = %" PRIu64 ", len = %d\n", var
             common_read_free_varinfo (vi);
 
             vars_root = vars_root->next;
+            i++;
         }
     }
 
@@ -1929,6 +2104,21 @@ int adios_read_bp_staged_init_method (MPI_Comm comm, PairStruct * params)
 
             log_debug ("show_hidden_attrs is set\n");
         }
+        else if (!strcasecmp (p->name, "stripe_size"))
+        {
+            errno = 0;
+            long long size = strtoll (p->value, NULL, 10);
+            if (size > 0 && !errno)
+            {
+                log_debug ("stripe_size set to %lld bytes for STAGED_READ_BP read method\n", size);
+                stripe_size = (uint64_t) size;
+            }
+            else
+            {
+                log_error ("Invalid 'stripe_size' parameter given to the STAGED_READ_BP "
+                            "read method: '%s'\n", p->value);
+            }
+        }
         else if (!strcasecmp (p->name, "num_aggregators"))
         {
             errno = 0;
@@ -1989,6 +2179,7 @@ int adios_read_bp_staged_finalize_method ()
     poll_interval = 10;
     show_hidden_attrs = 0;
     num_aggregators = -1;
+    stripe_size = 1024*1024;
 
     return 0;
 }
@@ -2141,19 +2332,9 @@ ADIOS_FILE * adios_read_bp_staged_open_file (const char * fname, MPI_Comm comm)
 
     MPI_Comm_rank (comm, &rank);
 
-    fh = (BP_FILE *) malloc (sizeof (BP_FILE));
-    assert (fh);
-    fh->fname = (fname ? strdup (fname) : 0L);
+    fh = BP_FILE_alloc (fname, comm);
+    // only the aggregators open the file
     fh->mpi_fh = 0;
-    fh->subfile_handles.n_handles = 0;
-    fh->comm = comm;
-    fh->gvar_h = 0;
-    fh->pgs_root = 0;
-    fh->vars_root = 0;
-    fh->attrs_root = 0;
-    fh->vars_table = 0;
-    fh->b = malloc (sizeof (struct adios_bp_buffer_struct_v1));
-    assert (fh->b);
     adios_buffer_struct_init (fh->b);
 
     p = (BP_PROC *) malloc (sizeof (BP_PROC));
@@ -2164,6 +2345,9 @@ ADIOS_FILE * adios_read_bp_staged_open_file (const char * fname, MPI_Comm comm)
     p->local_read_request_list = 0;
     p->b = 0;
     p->priv = 0;
+    p->attrs_by_id = 0;
+    p->nattrs_by_id = 0;
+    p->retired_maps = 0;
     init_read (p);
 
     fp = (ADIOS_FILE *) malloc (sizeof (ADIOS_FILE));
@@ -2404,9 +2588,7 @@ int adios_read_bp_staged_perform_reads (const ADIOS_FILE *fp, int blocking)
 
     if (isAggregator (p))
     {
-        sort_read_requests (p);
-
-        do_read (fp);
+        two_phase_read (fp);
 
         send_read_data (p);
     }
@@ -6,6 +6,7 @@
 #include "util.h"
 #include "core/transforms/adios_transforms_hooks_read.h"
 #include "core/transforms/adios_transforms_reqgroup.h"
+#include "core/transforms/adios_transforms_chunked_read.h"
 #include "core/adios_internals.h" // adios_get_type_size()
 
 #ifdef BZIP2
@@ -41,9 +42,31 @@ int decompress_bzip2_pre_allocated(const void* input_data, const uint64_t input_
     return 0;
 }
 
+// Decompress one chunk of a chunked ("chunks=N") transform
+static int decompress_bzip2_chunk(const void *in, uint64_t in_len, void *out, uint64_t *out_len, void *arg)
+{
+    return decompress_bzip2_pre_allocated(in, in_len, out, out_len);
+}
+
 int adios_transform_bzip2_generate_read_subrequests(adios_transform_read_request *reqgroup,
                                                        adios_transform_pg_read_request *pg_reqgroup)
 {
+    const void *table = adios_transform_chunked_pg_table(pg_reqgroup);
+    if (table)
+    {
+        // read only the chunks we need
+        uint32_t first_chunk, last_chunk;
+        adios_transform_chunked_pg_find_chunks(reqgroup, pg_reqgroup, table, &first_chunk, &last_chunk);
+
+        uint64_t start = adios_transform_chunked_chunk_start(table, first_chunk);
+        uint64_t count = adios_transform_chunked_chunk_end(table, last_chunk) - start;
+        void *buf = malloc(count);
+        assert(buf);
+        adios_transform_raw_read_request *subreq = adios_transform_raw_read_request_new_byte_segment(pg_reqgroup, start, count, buf);
+        adios_transform_raw_read_request_append(pg_reqgroup, subreq);
+        return 0;
+    }
+
     void *buf = malloc(pg_reqgroup->raw_var_length);
     assert(buf);
     adios_transform_raw_read_request *subreq = adios_transform_raw_read_request_new_whole_pg(pg_reqgroup, buf);
@@ -80,6 +103,41 @@ adios_datablock * adios_transform_bzip2_pg_reqgroup_completed(adios_transform_re
         printf("WARNING: possible wrong data size or corrupted metadata\n");
     }
     
+    const void *table = adios_transform_chunked_pg_table(completed_pg_reqgroup);
+    if (table)
+    {
+        uint32_t first_chunk, last_chunk;
+        int partial = adios_transform_chunked_pg_find_chunks(reqgroup, completed_pg_reqgroup, table, &first_chunk, &last_chunk);
+        uint64_t chunk_size = adios_transform_chunked_chunk_size(table);
+        uint64_t end = (uint64_t)(last_chunk + 1) * chunk_size;
+        if (end > uncompressed_size)
+            end = uncompressed_size;
+
+        void* uncompressed_data = malloc(end - first_chunk * chunk_size);
+        if(!uncompressed_data)
+        {
+            return NULL;
+        }
+        if (adios_transform_chunked_decompress(table, compressed_data, first_chunk, last_chunk,
+                                               uncompressed_size, uncompressed_data,
+                                               adios_transform_chunked_read_threads(),
+                                               decompress_bzip2_chunk, NULL))
+        {
+            free(uncompressed_data);
+            return NULL;
+        }
+
+        if (!partial)
+            return adios_datablock_new_whole_pg(reqgroup, completed_pg_reqgroup, uncompressed_data);
+
+        // the data starts at the first element of the first chunk read
+        return adios_datablock_new_ragged_offset(reqgroup->transinfo->orig_type,
+                                                 completed_pg_reqgroup->timestep,
+                                                 completed_pg_reqgroup->pg_bounds_sel,
+                                                 first_chunk * chunk_size / adios_get_type_size(reqgroup->transinfo->orig_type, ""),
+                                                 uncompressed_data);
+    }
+
     void* uncompressed_data = malloc(uncompressed_size);
     if(!uncompressed_data)
     {
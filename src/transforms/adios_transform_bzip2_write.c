@@ -10,6 +10,7 @@
 #include "core/transforms/adios_transforms_write.h"
 #include "core/transforms/adios_transforms_hooks_write.h"
 #include "core/transforms/adios_transforms_util.h"
+#include "core/transforms/adios_transforms_chunked.h"
 
 #ifdef BZIP2
 
@@ -43,9 +44,21 @@ int compress_bzip2_pre_allocated(const void* input_data,
     return 0;
 }
 
+// Compress one chunk of a chunked ("chunks=N") transform
+static int compress_bzip2_chunk(const void *in, uint64_t in_len, void *out, uint64_t *out_len, void *arg)
+{
+    return compress_bzip2_pre_allocated(in, in_len, out, out_len, *(int*)arg);
+}
+
 uint16_t adios_transform_bzip2_get_metadata_size(struct adios_transform_spec *transform_spec)
 {
-    return (sizeof(uint64_t) + sizeof(char));    // metadata: original data size (uint64_t) + compression succ flag (char)
+    int max_chunks, nthreads;
+    adios_transform_chunked_parse_spec(transform_spec, &max_chunks, &nthreads);
+
+    // metadata: original data size (uint64_t) + compression succ flag (char)
+    //           + chunk table if chunked
+    return (sizeof(uint64_t) + sizeof(char)) +
+           (max_chunks > 0 ? adios_transform_chunked_metadata_size(max_chunks) : 0);
 }
 
 void adios_transform_bzip2_transformed_size_growth(
@@ -85,6 +98,14 @@ int adios_transform_bzip2_apply(struct adios_file_struct *fd,
             compress_level = 9;
     }
 
+    int max_chunks, nthreads;
+    adios_transform_chunked_parse_spec(var->transform_spec, &max_chunks, &nthreads);
+    const uint16_t meta_base_len = sizeof(uint64_t) + sizeof(char);
+    if (max_chunks > 0 && (!var->transform_metadata ||
+        var->transform_metadata_len < meta_base_len + adios_transform_chunked_metadata_size(max_chunks)))
+    {
+        max_chunks = 0; // no room for the chunk table
+    }
 
     // decide the output buffer
     uint64_t output_size = input_size; //adios_transform_bzip2_calc_vars_transformed_size(adios_transform_bzip2, input_size, 1);
@@ -116,15 +137,28 @@ int adios_transform_bzip2_apply(struct adios_file_struct *fd,
     uint64_t actual_output_size = output_size;
     char compress_ok = 1;
 
-    int rtn = compress_bzip2_pre_allocated(input_buff, input_size, output_buff, &actual_output_size, compress_level);
-
-    if(0 != rtn                     // compression failed for some reason, then just copy the buffer
-        || actual_output_size > input_size)  // or size after compression is even larger (not likely to happen since compression lib will return non-zero in this case)
+    if (max_chunks > 0)
     {
-        // printf("compression failed, fall back to memory copy\n");
-        memcpy(output_buff, input_buff, input_size);
-        actual_output_size = input_size;
-        compress_ok = 0;    // succ sign set to 0
+        // independently compressed chunks, flag 2 tells the reader to look at the chunk table
+        int elem_size = adios_get_type_size(var->pre_transform_type, NULL);
+        actual_output_size = adios_transform_chunked_compress(input_buff, input_size,
+                (elem_size > 0 ? elem_size : 1), output_buff,
+                max_chunks, nthreads, compress_bzip2_chunk, &compress_level,
+                (char*)var->transform_metadata + meta_base_len);
+        compress_ok = 2;
+    }
+    else
+    {
+        int rtn = compress_bzip2_pre_allocated(input_buff, input_size, output_buff, &actual_output_size, compress_level);
+
+        if(0 != rtn                     // compression failed for some reason, then just copy the buffer
+            || actual_output_size > input_size)  // or size after compression is even larger (not likely to happen since compression lib will return non-zero in this case)
+        {
+            // printf("compression failed, fall back to memory copy\n");
+            memcpy(output_buff, input_buff, input_size);
+            actual_output_size = input_size;
+            compress_ok = 0;    // succ sign set to 0
+        }
     }
 
     // Wrap up, depending on buffer mode
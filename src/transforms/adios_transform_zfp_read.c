@@ -24,6 +24,7 @@
 
 /* Extra ADIOS headers that weren't added in the template */
 #include "core/adios_internals.h" 	// adios_get_type_size()
+#include "core/adios_subvolume.h"	// compute_linear_offset_in_volume()
 
 
 /* ZFP specific */
@@ -103,12 +104,154 @@ static int zfp_decompression(struct zfp_buffer* zbuff, void* uarray, void* carra
 int adios_transform_zfp_is_implemented (void) {return 1;}
 
 
-/* Kept the default. I think this is piecing together how to read a "block" from smaller subrequests*/
+/* Part of a block to decompress. In fixed-rate mode every ZFP block takes the same number
+ * of bits, so the blocks covering a range of the slowest ZFP dimension (the last ADIOS
+ * dimension, since the ADIOS dimensions are given to ZFP in order) are one contiguous piece
+ * of the compressed stream. Kept in pg_reqgroup->transform_internal.
+ */
+struct zfp_partial_read
+{
+    uint64_t row_start;	// first row of the slowest ZFP dimension to decompress (multiple of 4)
+    uint64_t nrows;	// number of rows to decompress
+    uint64_t row_size;	// elements in a row
+    uint64_t byte_start;	// compressed bytes to read (whole stream words)
+    uint64_t byte_count;
+    uint64_t bit_offset;	// of the first block from byte_start
+};
+
+
+/* Find the rows of 4^d blocks that contain the selection in a fixed-rate compressed block.
+ * Returns NULL if the whole block has to be decompressed.
+ */
+static struct zfp_partial_read* zfp_plan_partial_read(adios_transform_read_request *reqgroup,
+		adios_transform_pg_read_request *pg_reqgroup)
+{
+    const ADIOS_SELECTION *bounds = pg_reqgroup->pg_bounds_sel;
+    const ADIOS_SELECTION *sel = pg_reqgroup->pg_intersection_sel;
+    int ndims = reqgroup->transinfo->orig_ndim;
+    uint64_t rel_first[3], rel_last[3], first, last;
+    uint64_t nrows, blocks_per_layer = 1, bits_per_layer, layer0, layer1, bit_start, bit_end;
+    const uint64_t word_bytes = stream_word_bits / 8;
+    struct zfp_metadata metadata;
+    struct zfp_partial_read* plan;
+    zfp_stream* zstream;
+    zfp_type type;
+    double rate;
+    int i;
+
+    if (ndims < 1 || ndims > 3 || !bounds || !sel
+        || bounds->type != ADIOS_SELECTION_BOUNDINGBOX || sel->type != ADIOS_SELECTION_BOUNDINGBOX
+        || bounds->u.bb.ndim != ndims || sel->u.bb.ndim != ndims)
+    {
+        return NULL;
+    }
+    if (reqgroup->transinfo->orig_type == adios_double)
+        type = zfp_type_double;
+    else if (reqgroup->transinfo->orig_type == adios_real)
+        type = zfp_type_float;
+    else
+        return NULL;
+
+    zfp_read_metadata(&metadata, pg_reqgroup);
+    if (metadata.cmode != 2 || sscanf(metadata.ctol, "%lf", &rate) != 1)
+        return NULL;	// only the fixed-rate mode has blocks of a known size
+
+    /* bits per block, as set at compression */
+    zstream = zfp_stream_open(NULL);
+    zfp_stream_set_rate(zstream, rate, type, (uint) ndims, 0);
+    bits_per_layer = zstream->maxbits;
+    zfp_stream_close(zstream);
+
+    /* linear offsets of the first and last element of the selection in the block */
+    for (i = 0; i < ndims; i++)
+    {
+        rel_first[i] = sel->u.bb.start[i] - bounds->u.bb.start[i];
+        rel_last[i] = rel_first[i] + sel->u.bb.count[i] - 1;
+    }
+    first = compute_linear_offset_in_volume(ndims, rel_first, bounds->u.bb.count);
+    last = compute_linear_offset_in_volume(ndims, rel_last, bounds->u.bb.count);
+
+    /* ZFP sees the first ADIOS dimension as the fastest one, the last as the slowest */
+    plan = (struct zfp_partial_read*) malloc(sizeof(struct zfp_partial_read));
+    plan->row_size = 1;
+    for (i = 0; i < ndims - 1; i++)
+    {
+        plan->row_size *= bounds->u.bb.count[i];
+        blocks_per_layer *= (bounds->u.bb.count[i] + 3) / 4;
+    }
+    nrows = bounds->u.bb.count[ndims-1];
+    bits_per_layer *= blocks_per_layer;
+
+    layer0 = (first / plan->row_size) / 4;
+    layer1 = (last / plan->row_size) / 4;
+    plan->row_start = layer0 * 4;
+    plan->nrows = (layer1 + 1) * 4 < nrows ? (layer1 + 1) * 4 - plan->row_start : nrows - plan->row_start;
+    if (plan->nrows == nrows)
+    {
+        free(plan);
+        return NULL;
+    }
+
+    bit_start = layer0 * bits_per_layer;
+    bit_end = (layer1 + 1) * bits_per_layer;
+    plan->byte_start = bit_start / stream_word_bits * word_bytes;
+    plan->byte_count = (bit_end + stream_word_bits - 1) / stream_word_bits * word_bytes - plan->byte_start;
+    if (plan->byte_start + plan->byte_count > pg_reqgroup->raw_var_length)
+    {
+        plan->byte_count = pg_reqgroup->raw_var_length - plan->byte_start;
+    }
+    plan->bit_offset = bit_start - plan->byte_start * 8;
+    return plan;
+}
+
+
+/* Decompress only the rows of blocks of a partial read */
+static int zfp_partial_decompression(struct zfp_buffer* zbuff, void* uarray, void* carray,
+		const struct zfp_partial_read* plan)
+{
+    zbuff->dims[zbuff->ndims-1] = (uint) plan->nrows;
+    zfp_initialize(uarray, zbuff);
+    if (zbuff->error)
+    {
+        return 0;
+    }
+
+    zbuff->bstream = stream_open(carray, plan->byte_count);
+    zfp_stream_set_bit_stream(zbuff->zstream, zbuff->bstream);
+    stream_rseek(zbuff->bstream, plan->bit_offset);
+    if (!zfp_decompress(zbuff->zstream, zbuff->field))
+    {
+        adios_error(err_transform_failure, "ZFP decompression failed for variable %s\n", zbuff->name);
+        zbuff->error = true;
+    }
+
+    zfp_field_free(zbuff->field);
+    zfp_stream_close(zbuff->zstream);
+    stream_close(zbuff->bstream);
+    free(zbuff->dims);
+    return !zbuff->error;
+}
+
+
+/* Read the whole block, or in fixed-rate mode only the blocks needed for the selection */
 int adios_transform_zfp_generate_read_subrequests(adios_transform_read_request *reqgroup, adios_transform_pg_read_request *pg_reqgroup)
 {
+    adios_transform_raw_read_request *subreq;
+    struct zfp_partial_read* plan = zfp_plan_partial_read(reqgroup, pg_reqgroup);
+    if (plan)
+    {
+        // one extra word, the decoder may look ahead at the end of the stream
+        void *buf = calloc(plan->byte_count + stream_word_bits / 8, 1);
+        assert(buf);
+        pg_reqgroup->transform_internal = plan;
+        subreq = adios_transform_raw_read_request_new_byte_segment(pg_reqgroup, plan->byte_start, plan->byte_count, buf);
+        adios_transform_raw_read_request_append(pg_reqgroup, subreq);
+        return 0;
+    }
+
     void *buf = malloc(pg_reqgroup->raw_var_length);
     assert(buf);
-    adios_transform_raw_read_request *subreq = adios_transform_raw_read_request_new_whole_pg(pg_reqgroup, buf);
+    subreq = adios_transform_raw_read_request_new_whole_pg(pg_reqgroup, buf);
     adios_transform_raw_read_request_append(pg_reqgroup, subreq);
     return 0;
 }
@@ -183,6 +326,31 @@ adios_datablock * adios_transform_zfp_pg_reqgroup_completed(adios_transform_read
 	strcpy(zbuff->ctol, metadata->ctol);
 
 
+	/* Only some rows of blocks were read */
+	const struct zfp_partial_read* plan = (const struct zfp_partial_read*) completed_pg_reqgroup->transform_internal;
+	if (plan)
+	{
+		void* udata = malloc(plan->nrows * plan->row_size * adios_get_type_size(reqgroup->transinfo->orig_type, ""));
+		if(!udata)
+		{
+			adios_error(err_no_memory, "Ran out of memory allocating uncompressed "
+					"buffer for ZFP transformation.\n");
+			return NULL;
+		}
+		success = zfp_partial_decompression(zbuff, udata, cdata, plan);
+		free(zbuff);
+		free(metadata);
+		if (!success)
+		{
+			free(udata);
+			return NULL;
+		}
+		return adios_datablock_new_ragged_offset(reqgroup->transinfo->orig_type,
+				completed_pg_reqgroup->timestep, completed_pg_reqgroup->pg_bounds_sel,
+				plan->row_start * plan->row_size, udata);
+	}
+
+
 	/* Allocate the array we'll store the uncompressed data in */
 	void* udata;
 	udata = malloc(usize);
@@ -10,6 +10,7 @@
 #include <stdlib.h>
 #include <math.h>
 #include <string.h>
+#include <inttypes.h>
 #if defined(__APPLE__)
 #    include <sys/param.h>
 #    include <sys/mount.h>
@@ -52,6 +53,23 @@ struct adios_MPI_data_struct
 
     struct adios_bp_buffer_struct_v1 b;
     struct adios_index_struct_v1 * index;
+
+    struct adios_databuffer_drain * drain; // background writer, NULL if "async" is not set
+    int index_fanin;    // processes merged per node of the index reduction tree
+    uint64_t zero_copy; // arrays of at least this size are written from user memory, 0: off
+    int step_marker;    // = 1 with "step_marker": update <file>.step after each step for streaming readers
+};
+
+/* What the background writer needs to complete one step in adios_close() */
+struct adios_MPI_drain_job
+{
+    MPI_File fh;            // closed by the writer
+    int rank;
+    char * name;
+    uint64_t pg_start;      // offset of the buffered PG in the file
+    char * index;           // index and version, only on rank 0
+    uint64_t index_start;
+    uint64_t index_size;
 };
 
 #if COLLECT_METRICS
@@ -287,6 +305,76 @@ void adios_mpi_init (const PairStruct * parameters
     md->size = 0;
     md->group_comm = method->init_comm; // unused here, adios_open will set the current comm
     md->index = adios_alloc_index_v1(1); // with hashtables
+    md->drain = 0;
+    md->index_fanin = ADIOS_INDEX_REDUCE_FANIN;
+    md->zero_copy = 0;
+    md->step_marker = 0;
+
+    const PairStruct * p = parameters;
+    while (p)
+    {
+        if (!strcasecmp (p->name, "async"))
+        {
+            if (!p->value || (strcasecmp (p->value, "no") && strcmp (p->value, "0")))
+            {
+                int provided = MPI_THREAD_SINGLE;
+                MPI_Query_thread (&provided);
+                if (provided == MPI_THREAD_MULTIPLE)
+                {
+                    log_debug ("MPI method: async writes are enabled\n");
+                    md->drain = adios_databuffer_drain_new ();
+                }
+                else
+                {
+                    log_warn ("MPI method: parameter 'async' requires MPI initialized "
+                              "with MPI_THREAD_MULTIPLE. Writes will be synchronous.\n");
+                }
+            }
+        }
+        else if (!strcasecmp (p->name, "index_fanin"))
+        {
+            int n = (p->value ? atoi (p->value) : 0);
+            if (n >= 2)
+            {
+                md->index_fanin = n;
+            }
+            else
+            {
+                log_warn ("MPI method: parameter 'index_fanin' must be at least 2, "
+                          "using %d\n", md->index_fanin);
+            }
+        }
+        else if (!strcasecmp (p->name, "zero_copy"))
+        {
+            // zero_copy[=<minimum array size in KB>]
+            if (!p->value || !strcasecmp (p->value, "yes"))
+                md->zero_copy = ADIOS_ZERO_COPY_THRESHOLD;
+            else if (strcasecmp (p->value, "no"))
+                md->zero_copy = (uint64_t) strtoull (p->value, NULL, 10) * 1024;
+        }
+        else if (!strcasecmp (p->name, "step_marker"))
+        {
+            if (!p->value || (strcasecmp (p->value, "no") && strcmp (p->value, "0")))
+            {
+                log_debug ("MPI method: a step marker is written after each step\n");
+                md->step_marker = 1;
+            }
+        }
+        p = p->next;
+    }
+
+    if (md->zero_copy && md->drain)
+    {
+        log_warn ("MPI method: zero_copy cannot be used with async writes, "
+                  "arrays will be copied into the buffer\n");
+        md->zero_copy = 0;
+    }
+    if (md->step_marker && md->drain)
+    {
+        log_warn ("MPI method: step_marker cannot be used with async writes, "
+                  "no step marker is written\n");
+        md->step_marker = 0;
+    }
 
     adios_buffer_struct_init (&md->b);
 #if COLLECT_METRICS
@@ -339,6 +427,13 @@ int adios_mpi_open (struct adios_file_struct * fd
 #endif
     adios_buffer_struct_clear (&md->b);
 
+    if (adios_databuffer_drain_open (md->drain, fd))
+    {
+        adios_error (err_write_error,
+                     "MPI method, rank %d: background write of the previous step failed\n",
+                     md->rank);
+    }
+
     md->group_comm = comm;
     if (md->group_comm != MPI_COMM_NULL)
     {
@@ -404,41 +499,49 @@ int adios_mpi_open (struct adios_file_struct * fd
                               ,&md->status
                               );
                 adios_parse_version (&md->b, &md->b.version);
+                if (md->b.version & ADIOS_VERSION_HAVE_CHAINED_INDEX)
+                {
+                    // written by the POSIX method, the index of every step is read
+                    // and the whole index is rewritten
+                    adios_read_chained_index_v1 (md->fh, &md->b, md->index);
+                }
+                else
+                {
+                    adios_init_buffer_read_index_offsets (&md->b);
+                    // already in the buffer
+                    adios_parse_index_offsets_v1 (&md->b);
 
-                adios_init_buffer_read_index_offsets (&md->b);
-                // already in the buffer
-                adios_parse_index_offsets_v1 (&md->b);
-
-                adios_init_buffer_read_process_group_index (&md->b);
-                MPI_File_seek (md->fh, md->b.pg_index_offset
-                              ,MPI_SEEK_SET
-                              );
-                MPI_File_read (md->fh, md->b.buff, md->b.pg_size, MPI_BYTE
-                              ,&md->status
-                              );
-                adios_parse_process_group_index_v1 (&md->b, &md->index->pg_root, &md->index->pg_tail);
+                    adios_init_buffer_read_process_group_index (&md->b);
+                    MPI_File_seek (md->fh, md->b.pg_index_offset
+                                  ,MPI_SEEK_SET
+                                  );
+                    MPI_File_read (md->fh, md->b.buff, md->b.pg_size, MPI_BYTE
+                                  ,&md->status
+                                  );
+                    adios_parse_process_group_index_v1 (&md->b, &md->index->pg_root, &md->index->pg_tail);
 
 #if 1
-                adios_init_buffer_read_vars_index (&md->b);
-                MPI_File_seek (md->fh, md->b.vars_index_offset
-                              ,MPI_SEEK_SET
-                              );
-                MPI_File_read (md->fh, md->b.buff, md->b.vars_size, MPI_BYTE
-                              ,&md->status
-                              );
-                adios_parse_vars_index_v1 (&md->b, &md->index->vars_root, 
-                                           md->index->hashtbl_vars,
-                                           &md->index->vars_tail);
+                    adios_init_buffer_read_vars_index (&md->b);
+                    MPI_File_seek (md->fh, md->b.vars_index_offset
+                                  ,MPI_SEEK_SET
+                                  );
+                    MPI_File_read (md->fh, md->b.buff, md->b.vars_size, MPI_BYTE
+                                  ,&md->status
+                                  );
+                    adios_parse_vars_index_v1 (&md->b, &md->index->vars_root, 
+                                               md->index->hashtbl_vars,
+                                               &md->index->vars_tail);
 
-                adios_init_buffer_read_attributes_index (&md->b);
-                MPI_File_seek (md->fh, md->b.attrs_index_offset
-                              ,MPI_SEEK_SET
-                              );
-                MPI_File_read (md->fh, md->b.buff, md->b.attrs_size, MPI_BYTE
-                              ,&md->status
-                              );
-                adios_parse_attributes_index_v1 (&md->b, &md->index->attrs_root);
+                    adios_init_buffer_read_attributes_index (&md->b);
+                    MPI_File_seek (md->fh, md->b.attrs_index_offset
+                                  ,MPI_SEEK_SET
+                                  );
+                    MPI_File_read (md->fh, md->b.buff, md->b.attrs_size, MPI_BYTE
+                                  ,&md->status
+                                  );
+                    adios_parse_attributes_index_v1 (&md->b, &md->index->attrs_root);
 #endif
+                }
                 // md->b.end_of_pgs points to the end of the last PG in file
             }
 
@@ -658,20 +761,28 @@ int adios_mpi_open (struct adios_file_struct * fd
                                   ,&md->status
                                   );
                     adios_parse_version (&md->b, &md->b.version);
-
-                    adios_init_buffer_read_index_offsets (&md->b);
-                    // already in the buffer
-                    adios_parse_index_offsets_v1 (&md->b);
-
-                    adios_init_buffer_read_process_group_index (&md->b);
-                    MPI_File_seek (md->fh, md->b.pg_index_offset
-                                  ,MPI_SEEK_SET
-                                  );
-                    MPI_File_read (md->fh, md->b.buff, md->b.pg_size, MPI_BYTE
-                                  ,&md->status
-                                  );
-
-                    adios_parse_process_group_index_v1 (&md->b, &md->index->pg_root, &md->index->pg_tail);
+                    if (md->b.version & ADIOS_VERSION_HAVE_CHAINED_INDEX)
+                    {
+                        // written by the POSIX method, the index of every step is read
+                        // and the whole index is rewritten
+                        adios_read_chained_index_v1 (md->fh, &md->b, md->index);
+                    }
+                    else
+                    {
+                        adios_init_buffer_read_index_offsets (&md->b);
+                        // already in the buffer
+                        adios_parse_index_offsets_v1 (&md->b);
+
+                        adios_init_buffer_read_process_group_index (&md->b);
+                        MPI_File_seek (md->fh, md->b.pg_index_offset
+                                      ,MPI_SEEK_SET
+                                      );
+                        MPI_File_read (md->fh, md->b.buff, md->b.pg_size, MPI_BYTE
+                                      ,&md->status
+                                      );
+
+                        adios_parse_process_group_index_v1 (&md->b, &md->index->pg_root, &md->index->pg_tail);
+                    }
 
                     // find the largest time index so we can append properly
                     struct adios_index_process_group_struct_v1 * p;
@@ -691,25 +802,28 @@ int adios_mpi_open (struct adios_file_struct * fd
                               ,md->group_comm
                               );
 
-                    adios_init_buffer_read_vars_index (&md->b);
-                    MPI_File_seek (md->fh, md->b.vars_index_offset
-                                  ,MPI_SEEK_SET
-                                  );
-                    MPI_File_read (md->fh, md->b.buff, md->b.vars_size, MPI_BYTE
-                                  ,&md->status
-                                  );
-                    adios_parse_vars_index_v1 (&md->b, &md->index->vars_root, 
-                                               md->index->hashtbl_vars,
-                                               &md->index->vars_tail);
-
-                    adios_init_buffer_read_attributes_index (&md->b);
-                    MPI_File_seek (md->fh, md->b.attrs_index_offset
-                                  ,MPI_SEEK_SET
-                                  );
-                    MPI_File_read (md->fh, md->b.buff, md->b.attrs_size
-                                  ,MPI_BYTE, &md->status
-                                  );
-                    adios_parse_attributes_index_v1 (&md->b, &md->index->attrs_root);
+                    if (!(md->b.version & ADIOS_VERSION_HAVE_CHAINED_INDEX))
+                    {
+                        adios_init_buffer_read_vars_index (&md->b);
+                        MPI_File_seek (md->fh, md->b.vars_index_offset
+                                      ,MPI_SEEK_SET
+                                      );
+                        MPI_File_read (md->fh, md->b.buff, md->b.vars_size, MPI_BYTE
+                                      ,&md->status
+                                      );
+                        adios_parse_vars_index_v1 (&md->b, &md->index->vars_root, 
+                                                   md->index->hashtbl_vars,
+                                                   &md->index->vars_tail);
+
+                        adios_init_buffer_read_attributes_index (&md->b);
+                        MPI_File_seek (md->fh, md->b.attrs_index_offset
+                                      ,MPI_SEEK_SET
+                                      );
+                        MPI_File_read (md->fh, md->b.buff, md->b.attrs_size
+                                      ,MPI_BYTE, &md->status
+                                      );
+                        adios_parse_attributes_index_v1 (&md->b, &md->index->attrs_root);
+                    }
 
                     // remember the end of the last PG in file. The new PG written now
                     // will have an offset updated from here. 
@@ -817,6 +931,9 @@ int adios_mpi_open (struct adios_file_struct * fd
 static void build_file_offsets (struct adios_MPI_data_struct *md,
                                 struct adios_file_struct *fd)
 {
+    // size of the PG: the buffer and the arrays not copied into it
+    uint64_t pg_size = fd->bytes_written + fd->payload_refs_size;
+
     if (md->group_comm != MPI_COMM_NULL)
     {
         if (md->rank == 0)
@@ -826,10 +943,10 @@ static void build_file_offsets (struct adios_MPI_data_struct *md,
                                            * md->size);
             int i;
 
-            offsets [0] = fd->bytes_written; // = the size of data in buffer on this processor
+            offsets [0] = pg_size; // = the size of data in buffer on this processor
 // mpixlc_r on Eugene doesn't support 64 bit mode. Therefore the following may have problem
 // on Eugene for large data size since MPI_LONG_LONG is 32bit 
-            MPI_Gather (&(fd->bytes_written), 1, MPI_LONG_LONG
+            MPI_Gather (&pg_size, 1, MPI_LONG_LONG
                        ,offsets, 1, MPI_LONG_LONG
                        ,0, md->group_comm);
 
@@ -859,7 +976,7 @@ static void build_file_offsets (struct adios_MPI_data_struct *md,
         else
         {
             MPI_Offset offset[1];
-            offset[0] = fd->bytes_written;
+            offset[0] = pg_size;
 
             MPI_Gather (offset, 1, MPI_LONG_LONG
                        ,0, 1, MPI_LONG_LONG
@@ -876,7 +993,7 @@ static void build_file_offsets (struct adios_MPI_data_struct *md,
     }
     else
     {
-        md->b.pg_index_offset = fd->bytes_written;
+        md->b.pg_index_offset = pg_size;
         fd->current_pg->pg_start_in_file = md->b.end_of_pgs; // 0 or where to append to existing data
     }
 }
@@ -886,6 +1003,9 @@ enum BUFFERING_STRATEGY adios_mpi_should_buffer (struct adios_file_struct * fd
                                                 ,struct adios_method_struct * method
                                                 )
 {
+    struct adios_MPI_data_struct * md = (struct adios_MPI_data_struct *)
+                                                 method->method_data;
+    fd->zero_copy_threshold = md->zero_copy;
     return stop_on_overflow;
 }
 
@@ -1114,17 +1234,171 @@ void adios_mpi_buffer_overflow (struct adios_file_struct * fd,
 }
 
 
+/* Write size bytes at offset in MAX_MPIWRITE_SIZE pieces */
+static int adios_mpi_write_at (MPI_File fh, uint64_t offset, char * buf, uint64_t size,
+                               int rank, const char * name)
+{
+    uint64_t total_written = 0;
+    MPI_Status status;
+    int write_len, count, err;
+
+    while (total_written < size)
+    {
+        write_len = (size - total_written > MAX_MPIWRITE_SIZE) ? MAX_MPIWRITE_SIZE
+                                                               : size - total_written;
+        err = MPI_File_write_at (fh, offset + total_written, buf + total_written,
+                                 write_len, MPI_BYTE, &status);
+        MPI_Get_count (&status, MPI_BYTE, &count);
+        if (err != MPI_SUCCESS || count != write_len)
+        {
+            char e [MPI_MAX_ERROR_STRING];
+            int len = 0;
+            memset (e, 0, MPI_MAX_ERROR_STRING);
+            MPI_Error_string (err, e, &len);
+            log_error ("MPI method, rank %d: writing of %" PRIu64 " bytes at offset %" PRIu64 " "
+                       "to file %s failed (wrote %d): '%s'\n",
+                       rank, size, offset + total_written, name, count, e);
+            return 1;
+        }
+        total_written += count;
+    }
+    return 0;
+}
+
+/* Write the buffered PG with the payloads of the zero-copy writes, which are
+   taken from the user's arrays: one write of an hindexed datatype (over
+   absolute addresses) per MAX_MPIWRITE_SIZE bytes */
+static int adios_mpi_write_pieces (struct adios_MPI_data_struct * md
+                                  ,struct adios_file_struct * fd
+                                  )
+{
+    int n = 2 * fd->payload_refs_count + 1;
+    struct adios_payload_ref_struct * pieces;
+    int * lengths;
+    MPI_Aint * displs;
+    MPI_Datatype type;
+    MPI_Status status;
+    uint64_t offset = fd->current_pg->pg_start_in_file;
+    uint64_t done = 0; // bytes of pieces [i] in earlier writes
+    int i = 0, err = MPI_SUCCESS;
+
+    pieces = (struct adios_payload_ref_struct *)
+                  malloc (n * sizeof (struct adios_payload_ref_struct));
+    lengths = (int *) malloc (n * sizeof (int));
+    displs = (MPI_Aint *) malloc (n * sizeof (MPI_Aint));
+    n = adios_get_pg_pieces_v1 (fd, pieces);
+
+    while (i < n && err == MPI_SUCCESS)
+    {
+        uint64_t size = 0;
+        int nblocks = 0, count = 0;
+
+        while (i < n && size < MAX_MPIWRITE_SIZE)
+        {
+            uint64_t len = pieces [i].size - done;
+            if (len > MAX_MPIWRITE_SIZE - size)
+                len = MAX_MPIWRITE_SIZE - size;
+            MPI_Get_address ((char *) pieces [i].data + done, &displs [nblocks]);
+            lengths [nblocks++] = (int) len;
+            size += len;
+            done += len;
+            if (done == pieces [i].size)
+            {
+                i++;
+                done = 0;
+            }
+        }
+
+        MPI_Type_create_hindexed (nblocks, lengths, displs, MPI_BYTE, &type);
+        MPI_Type_commit (&type);
+        err = MPI_File_write_at (md->fh, offset, MPI_BOTTOM, 1, type, &status);
+        MPI_Type_free (&type);
+        MPI_Get_count (&status, MPI_BYTE, &count);
+        if (err != MPI_SUCCESS || count != size)
+        {
+            char e [MPI_MAX_ERROR_STRING];
+            int len = 0;
+            memset (e, 0, MPI_MAX_ERROR_STRING);
+            MPI_Error_string (err, e, &len);
+            adios_error (err_write_error,
+                    "MPI method, rank %d: adios_close(): writing of %llu bytes "
+                    "at offset %llu to file %s failed (wrote %d): '%s'\n",
+                    md->rank, size, offset, fd->name, count, e);
+            err = (err != MPI_SUCCESS ? err : MPI_ERR_IO);
+        }
+        offset += size;
+    }
+
+    free (displs);
+    free (lengths);
+    free (pieces);
+    return err;
+}
+
+/* Runs in the background writer: write the PG and the index, close the file */
+static int adios_mpi_drain (void * arg, char * buffer, uint64_t size)
+{
+    struct adios_MPI_drain_job * job = (struct adios_MPI_drain_job *) arg;
+    int err;
+
+    err = adios_mpi_write_at (job->fh, job->pg_start, buffer, size, job->rank, job->name);
+    if (job->index)
+    {
+        err |= adios_mpi_write_at (job->fh, job->index_start, job->index, job->index_size,
+                                   job->rank, job->name);
+    }
+    MPI_File_close (&job->fh);
+
+    free (job->index);
+    free (job->name);
+    free (job);
+    return err;
+}
+
+/* Hand over the buffered PG and the index (rank 0) to the background writer.
+   The file handle is passed over too, and closed by the writer. */
+static void adios_mpi_start_drain (struct adios_file_struct * fd
+                                  ,struct adios_method_struct * method
+                                  )
+{
+    struct adios_MPI_data_struct * md = (struct adios_MPI_data_struct *)
+                                                 method->method_data;
+    struct adios_MPI_drain_job * job;
+    uint64_t buffer_size = 0;
+    uint64_t buffer_offset = 0;
+
+    job = (struct adios_MPI_drain_job *) calloc (1, sizeof (struct adios_MPI_drain_job));
+    job->fh = md->fh;
+    job->rank = md->rank;
+    job->name = strdup (fd->name);
+    job->pg_start = fd->current_pg->pg_start_in_file;
+    if (md->rank == 0)
+    {
+        adios_write_index_v1 (&job->index, &buffer_size, &buffer_offset
+                             ,md->b.pg_index_offset, md->index);
+        adios_write_version_v1 (&job->index, &buffer_size, &buffer_offset);
+        job->index_start = md->b.pg_index_offset;
+        job->index_size = buffer_offset;
+    }
+    md->fh = 0;
+
+    if (adios_databuffer_drain_start (md->drain, fd, method, adios_mpi_drain, job))
+    {
+        adios_error (err_write_error,
+                     "MPI method, rank %d: background write of the previous step failed\n",
+                     md->rank);
+    }
+}
+
 void adios_mpi_close (struct adios_file_struct * fd
                      ,struct adios_method_struct * method
                      )
 {
     struct adios_MPI_data_struct * md = (struct adios_MPI_data_struct *)
                                                  method->method_data;
+    uint64_t file_size = 0; // size of the file after this step (rank 0)
     //struct adios_attribute_struct * a = fd->group->attributes;
 
-    struct adios_index_process_group_struct_v1 * new_pg_root = 0;
-    struct adios_index_var_struct_v1 * new_vars_root = 0;
-    struct adios_index_attribute_struct_v1 * new_attrs_root = 0;
 #if COLLECT_METRICS
     gettimeofday (&timing.t23, NULL);
     timing.t19.tv_sec = timing.t23.tv_sec;
@@ -1166,129 +1440,72 @@ void adios_mpi_close (struct adios_file_struct * fd
             // build index appending to any existing index
             adios_build_index_v1 (fd, md->index);
 
-            // if collective, gather the indexes from the rest and call
+            // if collective, merge the indexes of all processes into rank 0
             if (md->group_comm != MPI_COMM_NULL)
             {
-                if (md->rank == 0)
-                {
-                    int * index_sizes = malloc (4 * md->size);
-                    int * index_offsets = malloc (4 * md->size);
-                    char * recv_buffer = 0;
-                    uint32_t size = 0;
-                    uint32_t total_size = 0;
-                    int i;
-
-                    MPI_Gather (&size, 1, MPI_INT
-                               ,index_sizes, 1, MPI_INT
-                               ,0, md->group_comm
-                               );
-
-                    for (i = 0; i < md->size; i++)
-                    {
-                        index_offsets [i] = total_size;
-                        total_size += index_sizes [i];
-                    } 
-
-                    recv_buffer = malloc (total_size);
-
-                    MPI_Gatherv (&size, 0, MPI_BYTE
-                                ,recv_buffer, index_sizes, index_offsets
-                                ,MPI_BYTE, 0, md->group_comm
-                                );
-
-                    char * buffer_save = md->b.buff;
-                    uint64_t buffer_size_save = md->b.length;
-                    uint64_t offset_save = md->b.offset;
-
-                    for (i = 1; i < md->size; i++)
-                    {
-                        md->b.buff = recv_buffer + index_offsets [i];
-                        md->b.length = index_sizes [i];
-                        md->b.offset = 0;
-
-                        adios_parse_process_group_index_v1 (&md->b, &new_pg_root, NULL);
-                        adios_parse_vars_index_v1 (&md->b, &new_vars_root, NULL, NULL);
-                        // do not merge attributes from other processes from 1.4
-                        /*
-                        adios_parse_attributes_index_v1 (&md->b
-                                                        ,&new_attrs_root
-                                                        );
-                        */
-                        adios_merge_index_v1 (md->index, new_pg_root, 
-                                              new_vars_root, new_attrs_root, 0);
-                        new_pg_root = 0;
-                        new_vars_root = 0;
-                        new_attrs_root = 0;
-                    }
-                    md->b.buff = buffer_save;
-                    md->b.length = buffer_size_save;
-                    md->b.offset = offset_save;
-
-                    free (recv_buffer);
-                    free (index_sizes);
-                    free (index_offsets);
-                }
-                else
-                {
-                    adios_write_index_v1 (&buffer, &buffer_size, &buffer_offset
-                                         ,0, md->index);
-
-                    uint32_t tmp_buffer_size = (uint32_t) buffer_offset;
-                    MPI_Gather (&tmp_buffer_size, 1, MPI_INT, 0, 0, MPI_INT
-                               ,0, md->group_comm
-                               );
-                    MPI_Gatherv (buffer, buffer_offset, MPI_BYTE
-                                ,0, 0, 0, MPI_BYTE
-                                ,0, md->group_comm
-                                );
-                }
+                adios_reduce_index_v1 (md->group_comm, md->index_fanin, md->index);
             }
 
 #if COLLECT_METRICS
             gettimeofday (&timing.t13, NULL);
 #endif
-            // everyone writes their data
-            MPI_File_seek (md->fh, fd->current_pg->pg_start_in_file, MPI_SEEK_SET);
-            // if we need to write > 2 GB, need to do it in parts
-            // since count is limited to MAX_MPIWRITE_SIZE (signed 32-bit max).
-            uint64_t bytes_written = 0;
-            int32_t to_write = 0;
-            if (fd->bytes_written > MAX_MPIWRITE_SIZE)
+            if (md->drain)
             {
-                to_write = MAX_MPIWRITE_SIZE;
+                free (buffer);
+                adios_mpi_start_drain (fd, method);
+                break;
             }
-            else
+
+            if (fd->payload_refs_count)
             {
-                to_write = (int32_t) fd->bytes_written;
+                // the buffer and the arrays not copied into it
+                adios_mpi_write_pieces (md, fd);
             }
-
-            while (bytes_written < fd->bytes_written)
+            else
             {
-                err = MPI_File_write (md->fh, fd->buffer + bytes_written
-                        ,to_write, MPI_BYTE, &md->status
-                        );
-                if (err != MPI_SUCCESS) 
-                {              
-                    char e [MPI_MAX_ERROR_STRING];
-                    int len = 0;
-                    memset (e, 0, MPI_MAX_ERROR_STRING);
-                    MPI_Error_string (err, e, &len);
-                    adios_error (err_write_error, 
-                            "MPI method, rank %d: adios_close(): writing of buffered data "
-                            "[%llu..%llu] to file %s failed: '%s'\n",
-                            md->rank, bytes_written, bytes_written+to_write-1, 
-                            fd->name, e);       
+                // everyone writes their data
+                MPI_File_seek (md->fh, fd->current_pg->pg_start_in_file, MPI_SEEK_SET);
+                // if we need to write > 2 GB, need to do it in parts
+                // since count is limited to MAX_MPIWRITE_SIZE (signed 32-bit max).
+                uint64_t bytes_written = 0;
+                int32_t to_write = 0;
+                if (fd->bytes_written > MAX_MPIWRITE_SIZE)
+                {
+                    to_write = MAX_MPIWRITE_SIZE;
                 }
-                bytes_written += to_write;
-                if (fd->bytes_written > bytes_written)
+                else
                 {
-                    if (fd->bytes_written - bytes_written > MAX_MPIWRITE_SIZE)
-                    {
-                        to_write = MAX_MPIWRITE_SIZE;
+                    to_write = (int32_t) fd->bytes_written;
+                }
+
+                while (bytes_written < fd->bytes_written)
+                {
+                    err = MPI_File_write (md->fh, fd->buffer + bytes_written
+                            ,to_write, MPI_BYTE, &md->status
+                            );
+                    if (err != MPI_SUCCESS) 
+                    {              
+                        char e [MPI_MAX_ERROR_STRING];
+                        int len = 0;
+                        memset (e, 0, MPI_MAX_ERROR_STRING);
+                        MPI_Error_string (err, e, &len);
+                        adios_error (err_write_error, 
+                                "MPI method, rank %d: adios_close(): writing of buffered data "
+                                "[%llu..%llu] to file %s failed: '%s'\n",
+                                md->rank, bytes_written, bytes_written+to_write-1, 
+                                fd->name, e);       
                     }
-                    else
+                    bytes_written += to_write;
+                    if (fd->bytes_written > bytes_written)
                     {
-                        to_write = fd->bytes_written - bytes_written;
+                        if (fd->bytes_written - bytes_written > MAX_MPIWRITE_SIZE)
+                        {
+                            to_write = MAX_MPIWRITE_SIZE;
+                        }
+                        else
+                        {
+                            to_write = fd->bytes_written - bytes_written;
+                        }
                     }
                 }
             }
@@ -1350,6 +1567,7 @@ timeval_subtract (&timing.t8, &b, &a);
                             "of %llu bytes to file %s failed: '%s'\n",
                             md->rank, buffer_offset, fd->name, e);       
                 }
+                file_size = md->b.pg_index_offset + buffer_offset;
             }
 #if COLLECT_METRICS
             gettimeofday (&timing.t20, NULL);
@@ -1385,124 +1603,66 @@ timeval_subtract (&timing.t8, &b, &a);
 
             // build index appending to any existing index
             adios_build_index_v1 (fd, md->index);
-            // if collective, gather the indexes from the rest and call
+            // if collective, merge the indexes of all processes into rank 0
             if (md->group_comm != MPI_COMM_NULL)
             {
-                if (md->rank == 0)
-                {
-                    int * index_sizes = malloc (4 * md->size);
-                    int * index_offsets = malloc (4 * md->size);
-                    char * recv_buffer = 0;
-                    uint32_t size = 0;
-                    uint32_t total_size = 0;
-                    int i;
-
-                    MPI_Gather (&size, 1, MPI_INT
-                               ,index_sizes, 1, MPI_INT
-                               ,0, md->group_comm
-                               );
-
-                    for (i = 0; i < md->size; i++)
-                    {
-                        index_offsets [i] = total_size;
-                        total_size += index_sizes [i];
-                    }
-
-                    recv_buffer = malloc (total_size);
-
-                    MPI_Gatherv (&size, 0, MPI_BYTE
-                                ,recv_buffer, index_sizes, index_offsets
-                                ,MPI_BYTE, 0, md->group_comm
-                                );
-
-                    char * buffer_save = md->b.buff;
-                    uint64_t buffer_size_save = md->b.length;
-                    uint64_t offset_save = md->b.offset;
-
-                    for (i = 1; i < md->size; i++)
-                    {
-                        md->b.buff = recv_buffer + index_offsets [i];
-                        md->b.length = index_sizes [i];
-                        md->b.offset = 0;
-
-                        adios_parse_process_group_index_v1 (&md->b, &new_pg_root, NULL);
-                        adios_parse_vars_index_v1 (&md->b, &new_vars_root, NULL, NULL);
-                        // do not merge attributes from other processes from 1.4
-                        /*
-                        adios_parse_attributes_index_v1 (&md->b
-                                                        ,&new_attrs_root
-                                                        );
-                        */
-                        adios_merge_index_v1 (md->index, new_pg_root, 
-                                              new_vars_root, new_attrs_root, 0);
-                        new_pg_root = 0;
-                        new_vars_root = 0;
-                        new_attrs_root = 0;
-                    }
-                    md->b.buff = buffer_save;
-                    md->b.length = buffer_size_save;
-                    md->b.offset = offset_save;
-
-                    free (recv_buffer);
-                    free (index_sizes);
-                    free (index_offsets);
-                }
-                else
-                {
-                    adios_write_index_v1 (&buffer, &buffer_size, &buffer_offset
-                                         ,0, md->index);
-
-                    int _buffer_size = buffer_offset;
+                adios_reduce_index_v1 (md->group_comm, md->index_fanin, md->index);
+            }
 
-                    MPI_Gather (&_buffer_size, 1, MPI_INT, 0, 0, MPI_INT
-                               ,0, md->group_comm
-                               );
-                    MPI_Gatherv (buffer, buffer_offset, MPI_BYTE
-                                ,0, 0, 0, MPI_BYTE
-                                ,0, md->group_comm
-                                );
-                }
+            if (md->drain)
+            {
+                free (buffer);
+                adios_mpi_start_drain (fd, method);
+                break;
             }
 
-            /* Write data buffer */
-            MPI_File_seek (md->fh, fd->current_pg->pg_start_in_file, MPI_SEEK_SET);
+            if (fd->payload_refs_count)
+            {
+                // the buffer and the arrays not copied into it
+                adios_mpi_write_pieces (md, fd);
+            }
+            else
+            {
+                /* Write data buffer */
+                MPI_File_seek (md->fh, fd->current_pg->pg_start_in_file, MPI_SEEK_SET);
 #if 0
-            err = MPI_File_write (md->fh, fd->buffer, fd->bytes_written
-                    ,MPI_BYTE, &md->status
-                    );
+                err = MPI_File_write (md->fh, fd->buffer, fd->bytes_written
+                        ,MPI_BYTE, &md->status
+                        );
 #endif
-            {              
-                uint64_t total_written = 0;
-                uint64_t to_write = fd->bytes_written;
-                int write_len = 0;
-                int count;
-                char * buf_ptr = fd->buffer;
-                while (total_written < fd->bytes_written)
-                {
-                    write_len = (to_write > MAX_MPIWRITE_SIZE) ? MAX_MPIWRITE_SIZE : to_write;
-                    err = MPI_File_write (md->fh, buf_ptr, write_len, MPI_BYTE, &md->status);
-                    MPI_Get_count(&md->status, MPI_BYTE, &count);
-                    if (count != write_len)
+                {              
+                    uint64_t total_written = 0;
+                    uint64_t to_write = fd->bytes_written;
+                    int write_len = 0;
+                    int count;
+                    char * buf_ptr = fd->buffer;
+                    while (total_written < fd->bytes_written)
                     {
-                        err = count;
-                        break;
+                        write_len = (to_write > MAX_MPIWRITE_SIZE) ? MAX_MPIWRITE_SIZE : to_write;
+                        err = MPI_File_write (md->fh, buf_ptr, write_len, MPI_BYTE, &md->status);
+                        MPI_Get_count(&md->status, MPI_BYTE, &count);
+                        if (count != write_len)
+                        {
+                            err = count;
+                            break;
+                        }
+                        total_written += count;
+                        buf_ptr += count;
+                        to_write -= count;
+                        //err = total_written;
                     }
-                    total_written += count;
-                    buf_ptr += count;
-                    to_write -= count;
-                    //err = total_written;
+                }              
+                if (err != MPI_SUCCESS) 
+                {              
+                    char e [MPI_MAX_ERROR_STRING];
+                    int len = 0;
+                    memset (e, 0, MPI_MAX_ERROR_STRING);
+                    MPI_Error_string (err, e, &len);
+                    adios_error (err_write_error, 
+                            "MPI method, rank %d: adios_close(): writing of buffered data "
+                            "of %llu bytes to file %s failed: '%s'\n",
+                            md->rank, fd->bytes_written, fd->name, e);       
                 }
-            }              
-            if (err != MPI_SUCCESS) 
-            {              
-                char e [MPI_MAX_ERROR_STRING];
-                int len = 0;
-                memset (e, 0, MPI_MAX_ERROR_STRING);
-                MPI_Error_string (err, e, &len);
-                adios_error (err_write_error, 
-                        "MPI method, rank %d: adios_close(): writing of buffered data "
-                        "of %llu bytes to file %s failed: '%s'\n",
-                        md->rank, fd->bytes_written, fd->name, e);       
             }
 
             /* Rank 0 writes the index */
@@ -1554,6 +1714,7 @@ timeval_subtract (&timing.t8, &b, &a);
                             "of %llu bytes to file %s failed: '%s'\n",
                             md->rank, buffer_offset, fd->name, e);       
                 }
+                file_size = md->b.pg_index_offset + buffer_offset;
             }
 
             free (buffer);
@@ -1577,6 +1738,22 @@ timeval_subtract (&timing.t8, &b, &a);
         MPI_File_close (&md->fh);
     }
 
+    if (md->step_marker && fd->mode != adios_mode_read)
+    {
+        // tell streaming readers once all processes wrote their data
+        if (md->group_comm != MPI_COMM_NULL)
+        {
+            MPI_Barrier (md->group_comm);
+        }
+        if (md->rank == 0)
+        {
+            char * name = malloc (strlen (method->base_path) + strlen (fd->name) + 1);
+            sprintf (name, "%s%s", method->base_path, fd->name);
+            adios_write_step_marker_v1 (name, fd->group->time_index, file_size);
+            free (name);
+        }
+    }
+
 #if COLLECT_METRICS
     gettimeofday (&timing.t28, NULL);
     print_metrics (md, iteration++);
@@ -1606,6 +1783,14 @@ void adios_mpi_finalize (int mype, struct adios_method_struct * method)
         adios_mpi_initialized = 0;
         MPI_Info_free (&md->info);
     }
+    if (adios_databuffer_drain_wait (md->drain))
+    {
+        adios_error (err_write_error,
+                     "MPI method, rank %d: background write of the last step failed\n",
+                     md->rank);
+    }
+    adios_databuffer_drain_free (md->drain);
+    md->drain = 0;
     adios_free_index_v1 (md->index);
     adios_buffer_struct_clear (&md->b);
 }
@@ -104,6 +104,7 @@ struct adios_MPI_data_struct
     int is_color_set; // whether 'color' is set from XML.
     int g_color1;
     int g_color2;
+    uint64_t last_pg_size; // bytes written in the previous step, to balance the aggregation groups
     MPI_Comm g_comm1;
     MPI_Comm g_comm2;
     MPI_Offset * g_offsets;
@@ -340,8 +341,8 @@ adios_mpi_amr_set_striping_unit(struct adios_MPI_data_struct * md, char *paramet
     }
     else
     {
-        // By default, set stripe count to 1 to maximize concurrency.
-        striping_count = DEFAULT_STRIPE_COUNT;
+        // By default, spread the OSTs over the aggregators (see below)
+        striping_count = 0;
     }
     free (temp_string);
 
@@ -389,7 +390,6 @@ adios_mpi_amr_set_striping_unit(struct adios_MPI_data_struct * md, char *paramet
         lum.lmm_magic = LOV_USER_MAGIC;
         lum.lmm_pattern = 0;
         lum.lmm_stripe_size = striping_unit;
-        lum.lmm_stripe_count = striping_count;
 
         // calculate the # of ost's to skip
         n_ost_skipping = 0;
@@ -409,6 +409,16 @@ adios_mpi_amr_set_striping_unit(struct adios_MPI_data_struct * md, char *paramet
             return;
         }
 
+        if (!striping_count)
+        {
+            // each subfile on its own OSTs, all OSTs in use
+            if (md->g_num_aggregators > 0 && n_ost > md->g_num_aggregators)
+                striping_count = n_ost / md->g_num_aggregators;
+            else
+                striping_count = DEFAULT_STRIPE_COUNT;
+        }
+        lum.lmm_stripe_count = striping_count;
+
         i = 0;
         n = 0;
         while (i < md->g_num_ost)
@@ -416,7 +426,7 @@ adios_mpi_amr_set_striping_unit(struct adios_MPI_data_struct * md, char *paramet
             if (md->g_ost_skipping_list[i] == 0)
             {
                 n++;
-                if (n - 1 == md->g_color1 % n_ost)
+                if (n - 1 == (md->g_color1 * striping_count) % n_ost)
                     break;
             }
             
@@ -477,11 +487,310 @@ adios_mpi_amr_set_have_mdf (char * parameters, struct adios_MPI_data_struct * md
     free (temp_string);
 }
 
+/* Binary heap of indices for the aggregation planner, the top is the
+   index for which less() is true against all others */
+struct amr_heap
+{
+    int * a;
+    int n;
+    int (* less) (int x, int y, void * ctx);
+    void * ctx;
+};
+
+static void amr_heap_push (struct amr_heap * h, int x)
+{
+    int i = h->n++;
+    while (i > 0 && h->less (x, h->a [(i - 1) / 2], h->ctx))
+    {
+        h->a [i] = h->a [(i - 1) / 2];
+        i = (i - 1) / 2;
+    }
+    h->a [i] = x;
+}
+
+static int amr_heap_pop (struct amr_heap * h)
+{
+    int top = h->a [0], x = h->a [--h->n], i = 0, c;
+    while ((c = 2 * i + 1) < h->n)
+    {
+        if (c + 1 < h->n && h->less (h->a [c + 1], h->a [c], h->ctx))
+            c++;
+        if (!h->less (h->a [c], x, h->ctx))
+            break;
+        h->a [i] = h->a [c];
+        i = c;
+    }
+    h->a [i] = x;
+    return top;
+}
+
+struct amr_plan_proc
+{
+    uint64_t node;
+    uint64_t weight;
+    int rank;
+};
+
+struct amr_plan_bins
+{
+    uint64_t * load;
+    int * count;
+};
+
+struct amr_plan_nodes
+{
+    uint64_t * weight;
+    int * quota;
+};
+
+/* processes sorted by node, then the heaviest first */
+static int amr_plan_proc_cmp (const void * a, const void * b)
+{
+    const struct amr_plan_proc * x = (const struct amr_plan_proc *) a;
+    const struct amr_plan_proc * y = (const struct amr_plan_proc *) b;
+    if (x->node != y->node)
+        return (x->node < y->node ? -1 : 1);
+    if (x->weight != y->weight)
+        return (x->weight > y->weight ? -1 : 1);
+    return x->rank - y->rank;
+}
+
+/* least loaded group first, then the one with the fewest processes */
+static int amr_plan_bin_less (int x, int y, void * ctx)
+{
+    struct amr_plan_bins * b = (struct amr_plan_bins *) ctx;
+    if (b->load [x] != b->load [y])
+        return b->load [x] < b->load [y];
+    if (b->count [x] != b->count [y])
+        return b->count [x] < b->count [y];
+    return x < y;
+}
+
+/* node with the most bytes per aggregator first */
+static int amr_plan_node_more (int x, int y, void * ctx)
+{
+    struct amr_plan_nodes * n = (struct amr_plan_nodes *) ctx;
+    double wx = (double) n->weight [x] / n->quota [x];
+    double wy = (double) n->weight [y] / n->quota [y];
+    if (wx != wy)
+        return wx > wy;
+    return x < y;
+}
+
+/* An id of the node of this process: the lowest rank on the node */
+static uint64_t adios_mpi_amr_node_id (MPI_Comm comm, int rank)
+{
+    MPI_Comm node_comm;
+    int node_id = rank;
+#if defined(MPI_VERSION) && MPI_VERSION >= 3
+    MPI_Comm_split_type (comm, MPI_COMM_TYPE_SHARED, rank, MPI_INFO_NULL, &node_comm);
+#else
+    // processes with the same host name, or the same hash of it
+    char name [MPI_MAX_PROCESSOR_NAME];
+    unsigned int hash = 5381;
+    int i, len = 0;
+    MPI_Get_processor_name (name, &len);
+    for (i = 0; i < len; i++)
+        hash = hash * 33 + (unsigned char) name [i];
+    MPI_Comm_split (comm, (int) (hash & 0x7fffffff), rank, &node_comm);
+#endif
+    MPI_Allreduce (&rank, &node_id, 1, MPI_INT, MPI_MIN, node_comm);
+    MPI_Comm_free (&node_comm);
+    return (uint64_t) node_id;
+}
+
+/* Plan the aggregation: the number of aggregators (if not set by the user)
+   and the aggregation group of every process.
+   Without num_aggregators, there are as many aggregators as OSTs, or one per
+   node if the number of OSTs is unknown. Groups are made of processes on
+   the same node, or of whole nodes if there are fewer aggregators than
+   nodes, balancing the bytes written by each process in the previous step
+   (the number of processes in the first step). Groups are numbered in the
+   order of their lowest rank, which is their aggregator.
+   Sets g_num_aggregators, g_is_aggregator, g_color1 and g_color2.
+*/
+static void adios_mpi_amr_plan_aggregation (struct adios_MPI_data_struct * md)
+{
+    int nproc = md->size;
+    uint64_t mine [2], * all, total = 0;
+    struct amr_plan_proc * procs;
+    struct amr_plan_bins bins;
+    struct amr_plan_nodes nodes;
+    struct amr_heap h;
+    int * node_first, * node_count, * bin, * color, * members;
+    int i, k, n, nnodes, naggr, next_color = 0;
+
+    mine [0] = adios_mpi_amr_node_id (md->group_comm, md->rank);
+    mine [1] = md->last_pg_size;
+    all = (uint64_t *) malloc (2 * nproc * sizeof (uint64_t));
+    MPI_Allgather (mine, 2, MPI_UNSIGNED_LONG_LONG
+                  ,all, 2, MPI_UNSIGNED_LONG_LONG
+                  ,md->group_comm);
+
+    for (i = 0; i < nproc; i++)
+        total += all [2 * i + 1];
+
+    procs = (struct amr_plan_proc *) malloc (nproc * sizeof (struct amr_plan_proc));
+    for (i = 0; i < nproc; i++)
+    {
+        procs [i].node = all [2 * i];
+        procs [i].weight = (total ? all [2 * i + 1] : 1);
+        procs [i].rank = i;
+    }
+    qsort (procs, nproc, sizeof (struct amr_plan_proc), amr_plan_proc_cmp);
+
+    // the processes of each node in procs
+    node_first = (int *) malloc (nproc * sizeof (int));
+    node_count = (int *) calloc (nproc, sizeof (int));
+    nodes.weight = (uint64_t *) calloc (nproc, sizeof (uint64_t));
+    nodes.quota = (int *) malloc (nproc * sizeof (int));
+    nnodes = 0;
+    for (i = 0; i < nproc; i++)
+    {
+        if (!i || procs [i].node != procs [i - 1].node)
+        {
+            node_first [nnodes++] = i;
+        }
+        node_count [nnodes - 1]++;
+        nodes.weight [nnodes - 1] += procs [i].weight;
+    }
+
+    naggr = md->g_num_aggregators;
+    if (naggr <= 0)
+    {
+        naggr = (md->g_num_ost > 0 ? md->g_num_ost : nnodes);
+    }
+    if (naggr > nproc)
+    {
+        naggr = nproc;  // no aggregation
+    }
+
+    bin = (int *) malloc (nproc * sizeof (int));
+    bins.load = (uint64_t *) calloc (naggr, sizeof (uint64_t));
+    bins.count = (int *) calloc (naggr, sizeof (int));
+    h.a = (int *) malloc ((nnodes > naggr ? nnodes : naggr) * sizeof (int));
+
+    if (naggr >= nnodes)
+    {
+        // one aggregator per node, the others to the nodes with the most bytes per aggregator
+        h.n = 0;
+        h.less = amr_plan_node_more;
+        h.ctx = &nodes;
+        for (n = 0; n < nnodes; n++)
+        {
+            nodes.quota [n] = 1;
+            if (node_count [n] > 1)
+                amr_heap_push (&h, n);
+        }
+        for (k = nnodes; k < naggr && h.n; k++)
+        {
+            n = amr_heap_pop (&h);
+            nodes.quota [n]++;
+            if (nodes.quota [n] < node_count [n])
+                amr_heap_push (&h, n);
+        }
+
+        // on each node, the heaviest process first to the least loaded group
+        h.less = amr_plan_bin_less;
+        h.ctx = &bins;
+        k = 0;
+        for (n = 0; n < nnodes; n++)
+        {
+            h.n = 0;
+            for (i = 0; i < nodes.quota [n]; i++)
+                amr_heap_push (&h, k + i);
+            for (i = node_first [n]; i < node_first [n] + node_count [n]; i++)
+            {
+                int b = amr_heap_pop (&h);
+                bin [procs [i].rank] = b;
+                bins.load [b] += procs [i].weight;
+                bins.count [b]++;
+                amr_heap_push (&h, b);
+            }
+            k += nodes.quota [n];
+        }
+    }
+    else
+    {
+        // whole nodes, the heaviest first, to the least loaded group
+        int * node_order = (int *) malloc (nnodes * sizeof (int));
+        h.n = 0;
+        h.less = amr_plan_node_more;
+        h.ctx = &nodes;
+        for (n = 0; n < nnodes; n++)
+        {
+            nodes.quota [n] = 1;
+            amr_heap_push (&h, n);
+        }
+        for (k = 0; k < nnodes; k++)
+            node_order [k] = amr_heap_pop (&h);
+
+        h.less = amr_plan_bin_less;
+        h.ctx = &bins;
+        for (k = 0; k < naggr; k++)
+            amr_heap_push (&h, k);
+        for (k = 0; k < nnodes; k++)
+        {
+            int b = amr_heap_pop (&h);
+            n = node_order [k];
+            for (i = node_first [n]; i < node_first [n] + node_count [n]; i++)
+                bin [procs [i].rank] = b;
+            bins.load [b] += nodes.weight [n];
+            bins.count [b] += node_count [n];
+            amr_heap_push (&h, b);
+        }
+        free (node_order);
+    }
+
+    // number the groups in the order of their lowest rank
+    color = (int *) malloc (naggr * sizeof (int));
+    members = (int *) calloc (naggr, sizeof (int));
+    for (k = 0; k < naggr; k++)
+        color [k] = -1;
+    for (i = 0; i < nproc; i++)
+    {
+        int b = bin [i];
+        if (color [b] < 0)
+            color [b] = next_color++;
+        md->g_is_aggregator [i] = (members [b] == 0);
+        if (i == md->rank)
+        {
+            md->g_color1 = color [b];
+            md->g_color2 = members [b];
+        }
+        members [b]++;
+    }
+    md->g_num_aggregators = next_color;
+
+    if (md->rank == 0)
+    {
+        uint64_t max_load = 0;
+        for (k = 0; k < naggr; k++)
+            if (bins.load [k] > max_load)
+                max_load = bins.load [k];
+        log_debug ("MPI_AGGREGATE method: %d aggregators for %d processes on %d nodes, "
+                   "largest group %llu %s\n", md->g_num_aggregators, nproc, nnodes,
+                   (unsigned long long) max_load, (total ? "bytes" : "processes"));
+    }
+
+    free (members);
+    free (color);
+    free (h.a);
+    free (bins.count);
+    free (bins.load);
+    free (bin);
+    free (nodes.quota);
+    free (nodes.weight);
+    free (node_count);
+    free (node_first);
+    free (procs);
+    free (all);
+}
+
 static void
 adios_mpi_amr_set_aggregation_parameters(char * parameters, struct adios_MPI_data_struct * md)
 {
-    int i, aggr_group_size, remain, index;
-    int nproc = md->size, rank = md->rank;
+    int nproc = md->size;
     char *temp_string, *p_size;
 
     // set up the number of OST to use
@@ -529,14 +838,8 @@ adios_mpi_amr_set_aggregation_parameters(char * parameters, struct adios_MPI_dat
     }
     else
     {
-        if (nproc <= md->g_num_ost)
-        {
-            md->g_num_aggregators = nproc;
-        }
-        else
-        {
-            md->g_num_aggregators = md->g_num_ost;
-        }
+        // chosen by adios_mpi_amr_plan_aggregation()
+        md->g_num_aggregators = 0;
     }
     free (temp_string);
 
@@ -636,11 +939,6 @@ adios_mpi_amr_set_aggregation_parameters(char * parameters, struct adios_MPI_dat
     }
     free (temp_string);
 
-    if (md->g_num_aggregators > nproc || md->g_num_aggregators <= 0)
-    {
-        md->g_num_aggregators = nproc;  //no aggregation
-    }
-
     md->g_is_aggregator = (int *) malloc (nproc * sizeof(int));
     if (md->g_is_aggregator == 0)
     {
@@ -651,42 +949,7 @@ adios_mpi_amr_set_aggregation_parameters(char * parameters, struct adios_MPI_dat
 
     if (!md->is_color_set)
     {
-        aggr_group_size = nproc / md->g_num_aggregators;
-        remain = nproc - (int) aggr_group_size * md->g_num_aggregators;
-
-        index = 0;
-        for (i = 0; i < md->g_num_aggregators; i++)
-        {
-            md->g_is_aggregator[index] = 1;
-
-            if (i < remain)
-            {
-                index += aggr_group_size + 1;
-            }
-            else
-            {
-                index += aggr_group_size;
-            }
-        }
-
-        if (remain == 0)
-        {
-            md->g_color1 = rank / aggr_group_size;
-            md->g_color2 = rank % aggr_group_size;
-        }
-        else
-        {
-            if (rank < (aggr_group_size + 1) * remain)
-            {
-                md->g_color1 = rank / (aggr_group_size + 1);
-                md->g_color2 = rank % (aggr_group_size + 1);
-            }
-            else
-            {
-                md->g_color1 = remain + (rank - (aggr_group_size + 1) * remain) / aggr_group_size;
-                md->g_color2 = (rank - (aggr_group_size + 1) * remain)% aggr_group_size;
-            }
-        }
+        adios_mpi_amr_plan_aggregation (md);
 
         MPI_Comm_split (md->group_comm, md->g_color1, md->rank, &md->g_comm1);
         MPI_Comm_split (md->group_comm, md->g_color2, md->rank, &md->g_comm2);
@@ -974,16 +1237,24 @@ void * adios_mpi_amr_do_reopen_thread (void * param)
         MPI_File_seek (md->fh, md->b.file_size - md->b.length, MPI_SEEK_SET);
         MPI_File_read (md->fh, md->b.buff, md->b.length, MPI_BYTE, &md->status);
         adios_parse_version (&md->b, &md->b.version);
+        if (md->b.version & ADIOS_VERSION_HAVE_CHAINED_INDEX)
+        {
+            // written by the POSIX method, the index of every step is read
+            // and the whole index is rewritten
+            adios_read_chained_index_v1 (md->fh, &md->b, md->index);
+        }
+        else
+        {
+            adios_init_buffer_read_index_offsets (&md->b);
+            // already in the buffer
+            adios_parse_index_offsets_v1 (&md->b);
 
-        adios_init_buffer_read_index_offsets (&md->b);
-        // already in the buffer
-        adios_parse_index_offsets_v1 (&md->b);
-
-        adios_init_buffer_read_process_group_index (&md->b);
-        MPI_File_seek (md->fh, md->b.pg_index_offset, MPI_SEEK_SET);
-        MPI_File_read (md->fh, md->b.buff, md->b.pg_size, MPI_BYTE, &md->status);
+            adios_init_buffer_read_process_group_index (&md->b);
+            MPI_File_seek (md->fh, md->b.pg_index_offset, MPI_SEEK_SET);
+            MPI_File_read (md->fh, md->b.buff, md->b.pg_size, MPI_BYTE, &md->status);
 
-        adios_parse_process_group_index_v1 (&md->b, &md->index->pg_root, &md->index->pg_tail);
+            adios_parse_process_group_index_v1 (&md->b, &md->index->pg_root, &md->index->pg_tail);
+        }
 
         // find the largest time index so we can append properly
         struct adios_index_process_group_struct_v1 * p;
@@ -997,17 +1268,20 @@ void * adios_mpi_amr_do_reopen_thread (void * param)
         }
         fd->group->time_index = ++max_time_index;
 
-        adios_init_buffer_read_vars_index (&md->b);
-        MPI_File_seek (md->fh, md->b.vars_index_offset, MPI_SEEK_SET);
-        MPI_File_read (md->fh, md->b.buff, md->b.vars_size, MPI_BYTE, &md->status);
-        adios_parse_vars_index_v1 (&md->b, &md->index->vars_root, 
-                                    md->index->hashtbl_vars,
-                                   &md->index->vars_tail);
-
-        adios_init_buffer_read_attributes_index (&md->b);
-        MPI_File_seek (md->fh, md->b.attrs_index_offset, MPI_SEEK_SET);
-        MPI_File_read (md->fh, md->b.buff, md->b.attrs_size, MPI_BYTE, &md->status);
-        adios_parse_attributes_index_v1 (&md->b, &md->index->attrs_root);
+        if (!(md->b.version & ADIOS_VERSION_HAVE_CHAINED_INDEX))
+        {
+            adios_init_buffer_read_vars_index (&md->b);
+            MPI_File_seek (md->fh, md->b.vars_index_offset, MPI_SEEK_SET);
+            MPI_File_read (md->fh, md->b.buff, md->b.vars_size, MPI_BYTE, &md->status);
+            adios_parse_vars_index_v1 (&md->b, &md->index->vars_root, 
+                                        md->index->hashtbl_vars,
+                                       &md->index->vars_tail);
+
+            adios_init_buffer_read_attributes_index (&md->b);
+            MPI_File_seek (md->fh, md->b.attrs_index_offset, MPI_SEEK_SET);
+            MPI_File_read (md->fh, md->b.buff, md->b.attrs_size, MPI_BYTE, &md->status);
+            adios_parse_attributes_index_v1 (&md->b, &md->index->attrs_root);
+        }
 
         // remember the end of the last PG in file. The new PG written now
         // will have an offset updated from here. 
@@ -1100,6 +1374,7 @@ void adios_mpi_amr_init (const PairStruct * parameters
     md->is_color_set = 0;
     md->g_color1 = 0;
     md->g_color2 = 0;
+    md->last_pg_size = 0;
     md->g_offsets = 0;
     md->g_ost_skipping_list = 0;
     md->open_thread_data = 0;
@@ -1332,7 +1607,6 @@ int adios_mpi_amr_open (struct adios_file_struct * fd
             if (md->rank == 0)
             {
                 int f;
-                md->g_num_ost = 1024; // default num_ost, maybe updated below
 
                 // open metadata file
                 adios_mpi_amr_set_have_mdf (method->parameters, md);
@@ -1348,6 +1622,8 @@ int adios_mpi_amr_open (struct adios_file_struct * fd
 #ifdef HAVE_LUSTRE
                     struct obd_uuid uuids[1024];
                     int rc;
+                    // same number of OSTs, and aggregators, as in write mode
+                    md->g_num_ost = 1024;
                     rc = llapi_lov_get_uuids(f, uuids, &md->g_num_ost);
                     if (rc != 0)
                     {
@@ -2012,14 +2288,15 @@ void adios_mpi_amr_bg_close (struct adios_file_struct * fd
                                                             );*/
 
                             // global index would become unsorted on main aggregator during merging 
-                            // so sort timesteps if appending
+                            // so sort timesteps if appending, once after the loop
                             adios_merge_index_v1 (md->index, new_pg_root, 
-                                                  new_vars_root, new_attrs_root,
-                                                  (fd->mode == adios_mode_append));
+                                                  new_vars_root, new_attrs_root, 0);
                             new_pg_root = 0;
                             new_vars_root = 0;
                             new_attrs_root = 0;
                         }
+                        if (fd->mode == adios_mode_append)
+                            adios_sort_index_characteristics_v1 (md->index);
 
                         md->b.buff = buffer_save;
                         md->b.length = buffer_size_save;
@@ -2537,14 +2814,15 @@ void adios_mpi_amr_ag_close (struct adios_file_struct * fd
                                                         );*/
 
                         // global index would become unsorted on main aggregator during merging 
-                        // so sort timesteps if appending
+                        // so sort timesteps if appending, once after the loop
                         adios_merge_index_v1 (md->index, new_pg_root, 
-                                              new_vars_root, new_attrs_root, 
-                                              (fd->mode == adios_mode_append));
+                                              new_vars_root, new_attrs_root, 0);
                         new_pg_root = 0;
                         new_vars_root = 0;
                         new_attrs_root = 0;
                     }
+                    if (fd->mode == adios_mode_append)
+                        adios_sort_index_characteristics_v1 (md->index);
 
                     md->b.buff = buffer_save;
                     md->b.length = buffer_size_save;
@@ -2718,6 +2996,10 @@ void adios_mpi_amr_close (struct adios_file_struct * fd
     START_TIMER (ADIOS_TIMER_AD_CLOSE);
     struct adios_MPI_data_struct * md = (struct adios_MPI_data_struct *)
                                                  method->method_data;
+    // the volume of this step balances the aggregation groups of the next one
+    if (fd->mode != adios_mode_read)
+        md->last_pg_size = fd->bytes_written;
+
     if (md->g_io_type == ADIOS_MPI_AMR_IO_AG)
     {
         adios_mpi_amr_ag_close (fd, method);
@@ -655,41 +655,49 @@ int adios_mpi_lustre_open (struct adios_file_struct * fd
                               ,&md->status
                               );
                 adios_parse_version (&md->b, &md->b.version);
+                if (md->b.version & ADIOS_VERSION_HAVE_CHAINED_INDEX)
+                {
+                    // written by the POSIX method, the index of every step is read
+                    // and the whole index is rewritten
+                    adios_read_chained_index_v1 (md->fh, &md->b, md->index);
+                }
+                else
+                {
+                    adios_init_buffer_read_index_offsets (&md->b);
+                    // already in the buffer
+                    adios_parse_index_offsets_v1 (&md->b);
 
-                adios_init_buffer_read_index_offsets (&md->b);
-                // already in the buffer
-                adios_parse_index_offsets_v1 (&md->b);
-
-                adios_init_buffer_read_process_group_index (&md->b);
-                MPI_File_seek (md->fh, md->b.pg_index_offset
-                              ,MPI_SEEK_SET
-                              );
-                MPI_File_read (md->fh, md->b.buff, md->b.pg_size, MPI_BYTE
-                              ,&md->status
-                              );
-                adios_parse_process_group_index_v1 (&md->b, &md->index->pg_root, &md->index->pg_tail);
+                    adios_init_buffer_read_process_group_index (&md->b);
+                    MPI_File_seek (md->fh, md->b.pg_index_offset
+                                  ,MPI_SEEK_SET
+                                  );
+                    MPI_File_read (md->fh, md->b.buff, md->b.pg_size, MPI_BYTE
+                                  ,&md->status
+                                  );
+                    adios_parse_process_group_index_v1 (&md->b, &md->index->pg_root, &md->index->pg_tail);
 
 #if 1
-                adios_init_buffer_read_vars_index (&md->b);
-                MPI_File_seek (md->fh, md->b.vars_index_offset
-                              ,MPI_SEEK_SET
-                              );
-                MPI_File_read (md->fh, md->b.buff, md->b.vars_size, MPI_BYTE
-                              ,&md->status
-                              );
-                adios_parse_vars_index_v1 (&md->b, &md->index->vars_root, 
-                                           md->index->hashtbl_vars,
-                                           &md->index->vars_tail);
+                    adios_init_buffer_read_vars_index (&md->b);
+                    MPI_File_seek (md->fh, md->b.vars_index_offset
+                                  ,MPI_SEEK_SET
+                                  );
+                    MPI_File_read (md->fh, md->b.buff, md->b.vars_size, MPI_BYTE
+                                  ,&md->status
+                                  );
+                    adios_parse_vars_index_v1 (&md->b, &md->index->vars_root, 
+                                               md->index->hashtbl_vars,
+                                               &md->index->vars_tail);
 
-                adios_init_buffer_read_attributes_index (&md->b);
-                MPI_File_seek (md->fh, md->b.attrs_index_offset
-                              ,MPI_SEEK_SET
-                              );
-                MPI_File_read (md->fh, md->b.buff, md->b.attrs_size, MPI_BYTE
-                              ,&md->status
-                              );
-                adios_parse_attributes_index_v1 (&md->b, &md->index->attrs_root);
+                    adios_init_buffer_read_attributes_index (&md->b);
+                    MPI_File_seek (md->fh, md->b.attrs_index_offset
+                                  ,MPI_SEEK_SET
+                                  );
+                    MPI_File_read (md->fh, md->b.buff, md->b.attrs_size, MPI_BYTE
+                                  ,&md->status
+                                  );
+                    adios_parse_attributes_index_v1 (&md->b, &md->index->attrs_root);
 #endif
+                }
                 // md->b.end_of_pgs points to the end of the last PG in file
             }
 
@@ -922,20 +930,28 @@ int adios_mpi_lustre_open (struct adios_file_struct * fd
                                   ,&md->status
                                   );
                     adios_parse_version (&md->b, &md->b.version);
-
-                    adios_init_buffer_read_index_offsets (&md->b);
-                    // already in the buffer
-                    adios_parse_index_offsets_v1 (&md->b);
-
-                    adios_init_buffer_read_process_group_index (&md->b);
-                    MPI_File_seek (md->fh, md->b.pg_index_offset
-                                  ,MPI_SEEK_SET
-                                  );
-                    MPI_File_read (md->fh, md->b.buff, md->b.pg_size, MPI_BYTE
-                                  ,&md->status
-                                  );
-
-                    adios_parse_process_group_index_v1 (&md->b ,&md->index->pg_root, &md->index->pg_tail);
+                    if (md->b.version & ADIOS_VERSION_HAVE_CHAINED_INDEX)
+                    {
+                        // written by the POSIX method, the index of every step is read
+                        // and the whole index is rewritten
+                        adios_read_chained_index_v1 (md->fh, &md->b, md->index);
+                    }
+                    else
+                    {
+                        adios_init_buffer_read_index_offsets (&md->b);
+                        // already in the buffer
+                        adios_parse_index_offsets_v1 (&md->b);
+
+                        adios_init_buffer_read_process_group_index (&md->b);
+                        MPI_File_seek (md->fh, md->b.pg_index_offset
+                                      ,MPI_SEEK_SET
+                                      );
+                        MPI_File_read (md->fh, md->b.buff, md->b.pg_size, MPI_BYTE
+                                      ,&md->status
+                                      );
+
+                        adios_parse_process_group_index_v1 (&md->b ,&md->index->pg_root, &md->index->pg_tail);
+                    }
 
                     // find the largest time index so we can append properly
                     struct adios_index_process_group_struct_v1 * p;
@@ -956,28 +972,31 @@ int adios_mpi_lustre_open (struct adios_file_struct * fd
                               );
 
 
-                    adios_init_buffer_read_vars_index (&md->b);
-                    MPI_File_seek (md->fh, md->b.vars_index_offset
-                                  ,MPI_SEEK_SET
-                                  );
-                    MPI_File_read (md->fh, md->b.buff, md->b.vars_size, MPI_BYTE
-                                  ,&md->status
-                                  );
-                    adios_parse_vars_index_v1 (&md->b, &md->index->vars_root, 
-                                               md->index->hashtbl_vars,
-                                               &md->index->vars_tail);
-
-
-                    adios_init_buffer_read_attributes_index (&md->b);
-                    MPI_File_seek (md->fh, md->b.attrs_index_offset
-                                  ,MPI_SEEK_SET
-                                  );
-                    MPI_File_read (md->fh, md->b.buff, md->b.attrs_size
-                                  ,MPI_BYTE, &md->status
-                                  );
-                    adios_parse_attributes_index_v1 (&md->b
-                                                    ,&md->index->attrs_root
-                                                    );
+                    if (!(md->b.version & ADIOS_VERSION_HAVE_CHAINED_INDEX))
+                    {
+                        adios_init_buffer_read_vars_index (&md->b);
+                        MPI_File_seek (md->fh, md->b.vars_index_offset
+                                      ,MPI_SEEK_SET
+                                      );
+                        MPI_File_read (md->fh, md->b.buff, md->b.vars_size, MPI_BYTE
+                                      ,&md->status
+                                      );
+                        adios_parse_vars_index_v1 (&md->b, &md->index->vars_root, 
+                                                   md->index->hashtbl_vars,
+                                                   &md->index->vars_tail);
+
+
+                        adios_init_buffer_read_attributes_index (&md->b);
+                        MPI_File_seek (md->fh, md->b.attrs_index_offset
+                                      ,MPI_SEEK_SET
+                                      );
+                        MPI_File_read (md->fh, md->b.buff, md->b.attrs_size
+                                      ,MPI_BYTE, &md->status
+                                      );
+                        adios_parse_attributes_index_v1 (&md->b
+                                                        ,&md->index->attrs_root
+                                                        );
+                    }
 
                     // remember the end of the last PG in file. The new PG written now
                     // will have an offset updated from here. 
@@ -1384,9 +1403,6 @@ void adios_mpi_lustre_close (struct adios_file_struct * fd
                                                  method->method_data;
     //struct adios_attribute_struct * a = fd->group->attributes;
 
-    struct adios_index_process_group_struct_v1 * new_pg_root = 0;
-    struct adios_index_var_struct_v1 * new_vars_root = 0;
-    struct adios_index_attribute_struct_v1 * new_attrs_root = 0;
 #if COLLECT_METRICS
     gettimeofday (&t23, NULL);
     static int iteration = 0;
@@ -1431,87 +1447,12 @@ void adios_mpi_lustre_close (struct adios_file_struct * fd
             adios_build_index_v1 (fd, md->index);
             STOP_TIMER (ADIOS_TIMER_LOCALMD);
 
-            // if collective, gather the indexes from the rest and call
+            // if collective, merge the indexes of all processes into rank 0
             if (md->group_comm != MPI_COMM_NULL)
             {
-                if (md->rank == 0)
-                {
-                    int * index_sizes = malloc (4 * md->size);
-                    int * index_offsets = malloc (4 * md->size);
-                    char * recv_buffer = 0;
-                    uint32_t size = 0;
-                    uint32_t total_size = 0;
-                    int i;
-
-                    START_TIMER (ADIOS_TIMER_COMM);
-                    MPI_Gather (&size, 1, MPI_INT
-                               ,index_sizes, 1, MPI_INT
-                               ,0, md->group_comm
-                               );
-                    STOP_TIMER (ADIOS_TIMER_COMM);
-
-                    for (i = 0; i < md->size; i++)
-                    {
-                        index_offsets [i] = total_size;
-                        total_size += index_sizes [i];
-                    } 
-
-                    recv_buffer = malloc (total_size);
-
-                    START_TIMER (ADIOS_TIMER_COMM);
-                    MPI_Gatherv (&size, 0, MPI_BYTE
-                                ,recv_buffer, index_sizes, index_offsets
-                                ,MPI_BYTE, 0, md->group_comm
-                                );
-                    STOP_TIMER (ADIOS_TIMER_COMM);
-
-                    char * buffer_save = md->b.buff;
-                    uint64_t buffer_size_save = md->b.length;
-                    uint64_t offset_save = md->b.offset;
-
-                    for (i = 1; i < md->size; i++)
-                    {
-                        md->b.buff = recv_buffer + index_offsets [i];
-                        md->b.length = index_sizes [i];
-                        md->b.offset = 0;
-
-                        adios_parse_process_group_index_v1 (&md->b, &new_pg_root, NULL);
-                        adios_parse_vars_index_v1 (&md->b, &new_vars_root, NULL, NULL);
-                        // do not merge attributes from other processes from 1.4
-                        /*
-                        adios_parse_attributes_index_v1 (&md->b
-                                                        ,&new_attrs_root
-                                                        );
-                         */
-                        adios_merge_index_v1 (md->index, new_pg_root, 
-                                              new_vars_root, new_attrs_root, 0);
-                        new_pg_root = 0;
-                        new_vars_root = 0;
-                        new_attrs_root = 0;
-                    }
-                    md->b.buff = buffer_save;
-                    md->b.length = buffer_size_save;
-                    md->b.offset = offset_save;
-
-                    free (recv_buffer);
-                    free (index_sizes);
-                    free (index_offsets);
-                }
-                else
-                {
-                    adios_write_index_v1 (&buffer, &buffer_size, &buffer_offset
-                                         ,0, md->index);
-
-                    START_TIMER (ADIOS_TIMER_COMM);
-                    MPI_Gather (&buffer_offset, 1, MPI_INT, 0, 0, MPI_INT
-                               ,0, md->group_comm
-                               );
-                    MPI_Gatherv (buffer, buffer_offset, MPI_BYTE
-                                ,0, 0, 0, MPI_BYTE
-                                ,0, md->group_comm
-                                );
-                    STOP_TIMER (ADIOS_TIMER_COMM);
-                }
+                START_TIMER (ADIOS_TIMER_COMM);
+                adios_reduce_index_v1 (md->group_comm, ADIOS_INDEX_REDUCE_FANIN, md->index);
+                STOP_TIMER (ADIOS_TIMER_COMM);
             }
 
 #if COLLECT_METRICS
@@ -1585,87 +1526,12 @@ void adios_mpi_lustre_close (struct adios_file_struct * fd
             adios_build_index_v1 (fd, md->index);
             STOP_TIMER (ADIOS_TIMER_LOCALMD);
 
-            // if collective, gather the indexes from the rest and call
+            // if collective, merge the indexes of all processes into rank 0
             if (md->group_comm != MPI_COMM_NULL)
             {
-                if (md->rank == 0)
-                {
-                    int * index_sizes = malloc (4 * md->size);
-                    int * index_offsets = malloc (4 * md->size);
-                    char * recv_buffer = 0;
-                    uint32_t size = 0;
-                    uint32_t total_size = 0;
-                    int i;
-
-                    START_TIMER (ADIOS_TIMER_COMM);
-                    MPI_Gather (&size, 1, MPI_INT
-                               ,index_sizes, 1, MPI_INT
-                               ,0, md->group_comm
-                               );
-                    STOP_TIMER (ADIOS_TIMER_COMM);
-
-                    for (i = 0; i < md->size; i++)
-                    {
-                        index_offsets [i] = total_size;
-                        total_size += index_sizes [i];
-                    }
-
-                    recv_buffer = malloc (total_size);
-
-                    START_TIMER (ADIOS_TIMER_COMM);
-                    MPI_Gatherv (&size, 0, MPI_BYTE
-                                ,recv_buffer, index_sizes, index_offsets
-                                ,MPI_BYTE, 0, md->group_comm
-                                );
-                    STOP_TIMER (ADIOS_TIMER_COMM);
-
-                    char * buffer_save = md->b.buff;
-                    uint64_t buffer_size_save = md->b.length;
-                    uint64_t offset_save = md->b.offset;
-
-                    for (i = 1; i < md->size; i++)
-                    {
-                        md->b.buff = recv_buffer + index_offsets [i];
-                        md->b.length = index_sizes [i];
-                        md->b.offset = 0;
-
-                        adios_parse_process_group_index_v1 (&md->b, &new_pg_root, NULL);
-                        adios_parse_vars_index_v1 (&md->b, &new_vars_root, NULL, NULL);
-                        // do not merge attributes from other processes from 1.4
-                        /*
-                        adios_parse_attributes_index_v1 (&md->b
-                                                        ,&new_attrs_root
-                                                        );
-                         */
-                        adios_merge_index_v1 (md->index, new_pg_root, 
-                                              new_vars_root, new_attrs_root, 0);
-                        new_pg_root = 0;
-                        new_vars_root = 0;
-                        new_attrs_root = 0;
-                    }
-                    md->b.buff = buffer_save;
-                    md->b.length = buffer_size_save;
-                    md->b.offset = offset_save;
-
-                    free (recv_buffer);
-                    free (index_sizes);
-                    free (index_offsets);
-                }
-                else
-                {
-                    adios_write_index_v1 (&buffer, &buffer_size, &buffer_offset
-                                         ,0, md->index);
-
-                    START_TIMER (ADIOS_TIMER_COMM);
-                    MPI_Gather (&buffer_offset, 1, MPI_INT, 0, 0, MPI_INT
-                               ,0, md->group_comm
-                               );
-                    MPI_Gatherv (buffer, buffer_offset, MPI_BYTE
-                                ,0, 0, 0, MPI_BYTE
-                                ,0, md->group_comm
-                                );
-                    STOP_TIMER (ADIOS_TIMER_COMM);
-                }
+                START_TIMER (ADIOS_TIMER_COMM);
+                adios_reduce_index_v1 (md->group_comm, ADIOS_INDEX_REDUCE_FANIN, md->index);
+                STOP_TIMER (ADIOS_TIMER_COMM);
             }
 
             /* Write data buffer */
@@ -6,14 +6,17 @@
  */
 
 #include <sys/types.h>
+#include <sys/uio.h>
 #include <unistd.h>
 #include <fcntl.h>
+#include <limits.h>
 #include <sys/stat.h>
 #include <stdlib.h>
 #include <math.h>
 #include <string.h>
 #include <stdint.h>
 #include <assert.h>
+#include <errno.h>
 
 // see if we have MPI or other tools
 #include "config.h"
@@ -23,6 +26,7 @@
 #include <mxml.h>
 
 #include "public/adios_mpi.h" // MPI or dummy MPI for seq. build
+#include "public/adios_error.h"
 #include "core/adios_transport_hooks.h"
 #include "core/adios_bp_v1.h"
 #include "core/adios_internals.h"
@@ -68,11 +72,35 @@ struct adios_POSIX_data_struct
     int file_is_open; // = 1 if in append mode we leave the file open (close at finalize)
     int index_is_in_memory; // = 1 when index is kept in memory, no need to read from file. =1 after first 'append/update' is completed but not after first 'write'.
     uint64_t pg_start_next; // remember end of PG data for future append steps
+    int chain_index; // = 1 with "index=chained": append steps write only their own index
+    int index_is_chained; // = 1 if the file being written has a chained index
+    uint64_t prev_index_end; // chained index: end of the last footer in the file
+#ifdef HAVE_MPI
+    uint64_t md_index_end; // chained index: end of the last footer in the metadata file
+#endif
 
     uint64_t total_bytes_written;  /* bytes including all PGs written during one open()..close() with overflows
           index position will be fd->current_pg->pg_start_in_file + total_bytes_written
           it is calculated but not used; fd->current_pg->pg_start_in_file will point to index beginning
           */
+    struct adios_databuffer_drain * drain; // background writer, NULL if "async" is not set
+    uint64_t zero_copy; // arrays of at least this size are written from user memory, 0: off
+    int step_marker; // = 1 with "step_marker": update <file>.step after each step for streaming readers
+};
+
+/* What the background writer needs to complete one step in adios_close() */
+struct adios_POSIX_drain_job
+{
+    int f;                  // subfile
+    int close_file;         // 1: close f when done ('w' mode)
+    uint64_t pg_start;      // offset of the buffered PG in the subfile
+    char * index;           // local index and version
+    uint64_t index_start;
+    uint64_t index_size;
+    int mf;                 // metadata file (rank 0), -1 if none, closed when done
+    char * global_index;
+    uint64_t global_index_start;
+    uint64_t global_index_size;
 };
 
 
@@ -97,12 +125,75 @@ void adios_posix_init (const PairStruct * parameters
     p->group_comm = MPI_COMM_NULL;
     p->rank = 0;
     p->size = 0;
+    p->md_index_end = 0;
 #endif
     p->g_have_mdf = 1;
     p->file_is_open = 0;  // = 1 when posix file is open (used in append mode only)
     p->index_is_in_memory = 0; 
     p->pg_start_next = 0;
+    p->chain_index = 0;
+    p->index_is_chained = 0;
+    p->prev_index_end = 0;
     p->total_bytes_written = 0;
+    p->drain = 0;
+    p->zero_copy = 0;
+    p->step_marker = 0;
+
+    const PairStruct * param = parameters;
+    while (param)
+    {
+        if (!strcasecmp (param->name, "async"))
+        {
+            if (!param->value || (strcasecmp (param->value, "no") && strcmp (param->value, "0")))
+            {
+                log_debug ("POSIX method: async writes are enabled\n");
+                p->drain = adios_databuffer_drain_new ();
+            }
+        }
+        else if (!strcasecmp (param->name, "index"))
+        {
+            if (param->value && !strcasecmp (param->value, "chained"))
+            {
+                log_debug ("POSIX method: append steps write a chained index\n");
+                p->chain_index = 1;
+            }
+            else if (param->value && strcasecmp (param->value, "merged"))
+            {
+                log_warn ("POSIX method: unknown index type '%s', "
+                          "using the merged index\n", param->value);
+            }
+        }
+        else if (!strcasecmp (param->name, "zero_copy"))
+        {
+            // zero_copy[=<minimum array size in KB>]
+            if (!param->value || !strcasecmp (param->value, "yes"))
+                p->zero_copy = ADIOS_ZERO_COPY_THRESHOLD;
+            else if (strcasecmp (param->value, "no"))
+                p->zero_copy = (uint64_t) strtoull (param->value, NULL, 10) * 1024;
+        }
+        else if (!strcasecmp (param->name, "step_marker"))
+        {
+            if (!param->value || (strcasecmp (param->value, "no") && strcmp (param->value, "0")))
+            {
+                log_debug ("POSIX method: a step marker is written after each step\n");
+                p->step_marker = 1;
+            }
+        }
+        param = param->next;
+    }
+
+    if (p->zero_copy && p->drain)
+    {
+        log_warn ("POSIX method: zero_copy cannot be used with async writes, "
+                  "arrays will be copied into the buffer\n");
+        p->zero_copy = 0;
+    }
+    if (p->step_marker && p->drain)
+    {
+        log_warn ("POSIX method: step_marker cannot be used with async writes, "
+                  "no step marker is written\n");
+        p->step_marker = 0;
+    }
 }
 
 
@@ -148,6 +239,12 @@ int adios_posix_open (struct adios_file_struct * fd
     }
     free (temp_string);
 
+    if (adios_databuffer_drain_open (p->drain, fd))
+    {
+        adios_error (err_write_error,
+                     "POSIX method: background write of the previous step failed\n");
+    }
+
 #if defined ADIOS_TIMERS || defined ADIOS_TIMER_EVENTS
     int timer_count = 8;
     char ** timer_names = (char**) malloc (timer_count * sizeof (char*) );
@@ -338,6 +435,12 @@ START_TIMER (ADIOS_TIMER_AD_OPEN);
 #endif
             p->file_is_open = 1;
             p->pg_start_next = 0;
+            p->b.end_of_pgs = 0; // may be left from appending to another file
+            p->index_is_chained = p->chain_index;
+            p->prev_index_end = 0;
+#ifdef HAVE_MPI
+            p->md_index_end = 0;
+#endif
 
             break;
         }
@@ -393,6 +496,22 @@ START_TIMER (ADIOS_TIMER_AD_OPEN);
                 p->file_is_open = 1;
             }
 
+            if (!p->index_is_in_memory)
+            {
+                // a file with a chained index is always appended to with a chained index
+                p->index_is_chained = p->chain_index;
+                if (old_file && !p->index_is_chained)
+                {
+                    uint32_t version;
+                    struct stat s;
+                    if (fstat (p->b.f, &s) == 0)
+                        p->b.file_size = s.st_size;
+                    adios_posix_read_version (&p->b);
+                    adios_parse_version (&p->b, &version);
+                    p->index_is_chained = (version & ADIOS_VERSION_HAVE_CHAINED_INDEX) != 0;
+                }
+            }
+
 #ifdef HAVE_MPI
             // open metadata file by rank 0, if user wants to write it
             START_TIMER (ADIOS_TIMER_GLOBALMD);
@@ -400,7 +519,8 @@ START_TIMER (ADIOS_TIMER_AD_OPEN);
                 p->g_have_mdf &&
                 p->rank == 0)
             {
-                p->mf = open (mdfile_name, O_WRONLY | O_TRUNC | O_LARGEFILE
+                // the global index is rewritten unless the new step's index is chained to it
+                p->mf = open (mdfile_name, O_WRONLY | (p->index_is_chained ? 0 : O_TRUNC) | O_LARGEFILE
                         , S_IRUSR | S_IWUSR
                         | S_IRGRP | S_IWGRP
                         | S_IROTH | S_IWOTH
@@ -421,6 +541,7 @@ START_TIMER (ADIOS_TIMER_AD_OPEN);
                         return 0;
                     }
                 }
+                p->md_index_end = (p->index_is_chained ? lseek (p->mf, 0, SEEK_END) : 0);
             }
             STOP_TIMER (ADIOS_TIMER_GLOBALMD);
 #endif
@@ -471,6 +592,15 @@ START_TIMER (ADIOS_TIMER_AD_OPEN);
                             }
                             fd->group->time_index = max_time_index;
 
+                            if (p->index_is_chained)
+                            {
+                                // only the new steps' indexes are written, after the last footer
+                                adios_clear_index_v1 (p->index);
+                                p->prev_index_end = p->b.file_size;
+                                p->pg_start_next = p->b.file_size;
+                                break;
+                            }
+
                             adios_posix_read_vars_index (&p->b);
                             adios_parse_vars_index_v1 (&p->b, &p->index->vars_root, 
                                     p->index->hashtbl_vars,
@@ -508,6 +638,7 @@ START_TIMER (ADIOS_TIMER_AD_OPEN);
             {
                 // there is no previous data, start from offset 0
                 p->pg_start_next = 0;
+                p->prev_index_end = 0;
             }
             STOP_TIMER (ADIOS_TIMER_LOCALMD);
             //printf ("adios_posix_open append/update, old_file=%d, index_is_in_memory=%d, "
@@ -548,6 +679,9 @@ enum BUFFERING_STRATEGY adios_posix_should_buffer (struct adios_file_struct * fd
                                                   ,struct adios_method_struct * method
                                                   )
 {
+    struct adios_POSIX_data_struct * p = (struct adios_POSIX_data_struct *)
+                                                          method->method_data;
+    fd->zero_copy_threshold = p->zero_copy;
     return continue_with_new_pg;
 }
 
@@ -648,6 +782,111 @@ void adios_posix_read (struct adios_file_struct * fd
     v->data_size = buffer_size;
 }
 
+static int adios_posix_pwrite (int f, const char * buf, uint64_t size, uint64_t offset)
+{
+    uint64_t total_written = 0;
+    ssize_t s;
+
+    while (total_written < size)
+    {
+        s = pwrite (f, buf + total_written,
+                    (size - total_written > MAX_MPIWRITE_SIZE ? MAX_MPIWRITE_SIZE
+                                                              : size - total_written),
+                    offset + total_written);
+        if (s < 0 && errno == EINTR)
+            continue;
+        if (s <= 0)
+        {
+            log_error ("POSIX method: writing %" PRIu64 " bytes at offset %" PRIu64 " failed: %s\n",
+                       size - total_written, offset + total_written, strerror (errno));
+            return 1;
+        }
+        total_written += s;
+    }
+    return 0;
+}
+
+#ifndef IOV_MAX
+#define IOV_MAX 1024
+#endif
+
+/* Write the buffered PG with the payloads of the zero-copy writes, which
+   are taken from the user's arrays, at offset */
+static int adios_posix_pwritev (int f, struct adios_file_struct * fd, uint64_t offset)
+{
+    int n = 2 * fd->payload_refs_count + 1;
+    struct adios_payload_ref_struct * pieces;
+    int i, err = 0;
+
+    pieces = (struct adios_payload_ref_struct *)
+                  malloc (n * sizeof (struct adios_payload_ref_struct));
+    if (!pieces)
+    {
+        adios_error (err_no_memory, "POSIX method: cannot allocate the list of %d pieces "
+                     "of the process group of %s\n", n, fd->name);
+        return 1;
+    }
+    n = adios_get_pg_pieces_v1 (fd, pieces);
+
+#if HAVE_PWRITEV
+    struct iovec * iov = (struct iovec *) malloc (n * sizeof (struct iovec));
+    if (!iov)
+    {
+        adios_error (err_no_memory, "POSIX method: cannot allocate the I/O vector of %d pieces "
+                     "of the process group of %s\n", n, fd->name);
+        free (pieces);
+        return 1;
+    }
+    for (i = 0; i < n; i++)
+    {
+        iov [i].iov_base = (void *) pieces [i].data;
+        iov [i].iov_len = pieces [i].size;
+    }
+
+    i = 0;
+    while (i < n)
+    {
+        ssize_t s = pwritev (f, iov + i, (n - i > IOV_MAX ? IOV_MAX : n - i), offset);
+        if (s < 0 && errno == EINTR)
+            continue;
+        if (s <= 0)
+        {
+            adios_error (err_write_error, "POSIX method: writing %d pieces of the process group "
+                         "of %s at offset %" PRIu64 " failed: %s\n",
+                         n - i, fd->name, offset, strerror (errno));
+            err = 1;
+            break;
+        }
+        offset += s;
+        // skip what has been written, the last piece may be partially written
+        while (i < n && s >= (ssize_t) iov [i].iov_len)
+        {
+            s -= iov [i].iov_len;
+            i++;
+        }
+        if (s)
+        {
+            iov [i].iov_base = (char *) iov [i].iov_base + s;
+            iov [i].iov_len -= s;
+        }
+    }
+    free (iov);
+#else
+    for (i = 0; i < n && !err; i++)
+    {
+        err = adios_posix_pwrite (f, pieces [i].data, pieces [i].size, offset + pieces [i].offset);
+    }
+    if (err)
+    {
+        adios_error (err_write_error, "POSIX method: writing the process group of %s failed\n",
+                     fd->name);
+    }
+#endif
+
+    free (pieces);
+    return err;
+}
+
 static void adios_posix_write_pg (struct adios_file_struct * fd
                                  ,struct adios_method_struct * method
                                  )
@@ -673,6 +912,21 @@ static void adios_posix_write_pg (struct adios_file_struct * fd
             "buffer offset = %" PRIu64 "  total_bytes_written = %" PRIu64 "\n",
             fd->current_pg->pg_start_in_file, p->pg_start_next, fd->offset, p->total_bytes_written);*/
 
+    if (fd->payload_refs_count)
+    {
+        // write the buffer and the arrays not copied into it, errors are
+        // reported by adios_posix_pwritev()
+        if (adios_posix_pwritev (p->b.f, fd, offset))
+        {
+            log_error ("POSIX method: the process group written to %s is incomplete\n",
+                       fd->name);
+        }
+        bytes_written = fd->bytes_written + fd->payload_refs_size;
+        p->total_bytes_written += bytes_written;
+        p->pg_start_next += bytes_written;
+        return;
+    }
+
     lseek (p->b.f, offset, SEEK_SET);
 
     if (fd->bytes_written > MAX_MPIWRITE_SIZE)
@@ -712,6 +966,78 @@ static void adios_posix_write_pg (struct adios_file_struct * fd
 
 }
 
+/* Async mode: set the offsets like adios_posix_write_pg() but leave the
+   writing of the PG to the background writer */
+static void adios_posix_reserve_pg (struct adios_file_struct * fd
+                                   ,struct adios_method_struct * method
+                                   )
+{
+    struct adios_POSIX_data_struct * p = (struct adios_POSIX_data_struct *)
+                                                          method->method_data;
+    fd->current_pg->pg_start_in_file = p->pg_start_next;
+    p->total_bytes_written += fd->bytes_written;
+    p->pg_start_next += fd->bytes_written;
+}
+
+/* Runs in the background writer: write the PG, the index and the global index */
+static int adios_posix_drain (void * arg, char * buffer, uint64_t size)
+{
+    struct adios_POSIX_drain_job * job = (struct adios_POSIX_drain_job *) arg;
+    int err;
+
+    err = adios_posix_pwrite (job->f, buffer, size, job->pg_start);
+    err |= adios_posix_pwrite (job->f, job->index, job->index_size, job->index_start);
+    if (job->close_file)
+        close (job->f);
+
+    if (job->mf != -1)
+    {
+        err |= adios_posix_pwrite (job->mf, job->global_index, job->global_index_size,
+                                   job->global_index_start);
+        close (job->mf);
+    }
+
+    free (job->index);
+    free (job->global_index);
+    free (job);
+    return err;
+}
+
+static struct adios_POSIX_drain_job * adios_posix_new_drain_job (struct adios_file_struct * fd)
+{
+    struct adios_POSIX_drain_job * job;
+    job = (struct adios_POSIX_drain_job *) calloc (1, sizeof (struct adios_POSIX_drain_job));
+    job->pg_start = fd->current_pg->pg_start_in_file;
+    job->mf = -1;
+    return job;
+}
+
+/* Hand over the buffered PG and the index to the background writer */
+static void adios_posix_start_drain (struct adios_file_struct * fd
+                                    ,struct adios_method_struct * method
+                                    ,struct adios_POSIX_drain_job * job
+                                    ,char * buffer
+                                    ,uint64_t buffer_size
+                                    ,int close_file
+                                    )
+{
+    struct adios_POSIX_data_struct * p = (struct adios_POSIX_data_struct *)
+                                                          method->method_data;
+    job->f = p->b.f;
+    job->close_file = close_file;
+    job->index = buffer;
+    job->index_start = p->pg_start_next;
+    job->index_size = buffer_size;
+    if (close_file)
+        p->b.f = -1;
+
+    if (adios_databuffer_drain_start (p->drain, fd, method, adios_posix_drain, job))
+    {
+        adios_error (err_write_error,
+                     "POSIX method: background write of the previous step failed\n");
+    }
+}
+
 static void adios_posix_write_index (struct adios_file_struct * fd
         ,struct adios_method_struct * method
         ,char * buffer
@@ -729,6 +1055,32 @@ static void adios_posix_write_index (struct adios_file_struct * fd
     write (p->b.f, buffer, buffer_size);
 }
 
+/* Serialize an index and the version, as one step of a chained index
+ * after the footer ending at prev_index_end if the file has a chained index */
+static void adios_posix_build_index_buffer (struct adios_POSIX_data_struct * p
+        ,char ** buffer
+        ,uint64_t * buffer_size
+        ,uint64_t * buffer_offset
+        ,uint64_t index_start
+        ,uint64_t prev_index_end
+        ,struct adios_index_struct_v1 * index
+        ,uint32_t flag
+        )
+{
+    if (p->index_is_chained)
+    {
+        adios_write_chained_index_v1 (buffer, buffer_size, buffer_offset
+                                     ,index_start, prev_index_end, index);
+        flag |= ADIOS_VERSION_HAVE_CHAINED_INDEX;
+    }
+    else
+    {
+        adios_write_index_v1 (buffer, buffer_size, buffer_offset
+                             ,index_start, index);
+    }
+    adios_write_version_flag_v1 (buffer, buffer_size, buffer_offset, flag);
+}
+
 static void adios_posix_do_read (struct adios_file_struct * fd
         ,struct adios_method_struct * method
         )
@@ -872,6 +1224,36 @@ void adios_posix_buffer_overflow (struct adios_file_struct * fd,
     STOP_TIMER (ADIOS_TIMER_AD_OVERFLOW);
 }
 
+/* Tell streaming readers that a step is complete: replace the step marker
+   of the file readers open, which is file_size bytes long now */
+static void adios_posix_write_step_marker (struct adios_file_struct * fd
+                                          ,struct adios_method_struct * method
+                                          ,uint64_t file_size
+                                          )
+{
+    struct adios_POSIX_data_struct * p = (struct adios_POSIX_data_struct *)
+                                                          method->method_data;
+    char * name;
+
+#ifdef HAVE_MPI
+    if (p->group_comm != MPI_COMM_SELF)
+    {
+        // without the metadata file, there is nothing to read the steps from
+        if (!p->g_have_mdf)
+            return;
+        // the metadata file refers to the subfiles of all processes
+        MPI_Barrier (p->group_comm);
+        if (p->rank != 0)
+            return;
+    }
+#endif
+
+    name = malloc (strlen (method->base_path) + strlen (fd->name) + 1);
+    sprintf (name, "%s%s", method->base_path, fd->name);
+    adios_write_step_marker_v1 (name, fd->group->time_index, file_size);
+    free (name);
+}
+
 void adios_posix_close (struct adios_file_struct * fd
                        ,struct adios_method_struct * method
                        )
@@ -893,9 +1275,19 @@ void adios_posix_close (struct adios_file_struct * fd
             uint64_t buffer_size = 0;
             uint64_t buffer_offset = 0;
 
-            // write buffered data now
+            struct adios_POSIX_drain_job * job = 0;
+
+            // write buffered data now, or leave it to the background writer
             START_TIMER (ADIOS_TIMER_IO);
-            adios_posix_write_pg (fd, method); 
+            if (p->drain)
+            {
+                adios_posix_reserve_pg (fd, method);
+                job = adios_posix_new_drain_job (fd);
+            }
+            else
+            {
+                adios_posix_write_pg (fd, method); 
+            }
             STOP_TIMER (ADIOS_TIMER_IO);
 
             // Note: adios_posix_write_pg() sets the fd->current_pg->pg_start_in_file
@@ -906,13 +1298,13 @@ void adios_posix_close (struct adios_file_struct * fd
 
             START_TIMER (ADIOS_TIMER_LOCALMD);
             uint64_t index_start = p->pg_start_next;
+            uint64_t md_end = 0; // end of the metadata file after this step (rank 0)
             // build new index for this step
             adios_build_index_v1 (fd, p->index);
             // if collective, gather the indexes from the rest and call
             // adios_merge_index_v1 (&new_pg_root, &new_vars_root, pg, vars);
-            adios_write_index_v1 (&buffer, &buffer_size, &buffer_offset
-                                 ,index_start, p->index);
-            adios_write_version_v1 (&buffer, &buffer_size, &buffer_offset);
+            adios_posix_build_index_buffer (p, &buffer, &buffer_size, &buffer_offset
+                                           ,index_start, 0, p->index, 0);
             STOP_TIMER (ADIOS_TIMER_LOCALMD);
 
 #ifdef HAVE_MPI
@@ -985,35 +1377,40 @@ void adios_posix_close (struct adios_file_struct * fd
                     char * global_index_buffer = 0;
                     uint64_t global_index_buffer_size = 0;
                     uint64_t global_index_buffer_offset = 0;
-                    uint64_t global_index_start = 0;
-                    uint16_t flag = 0;
-
-                    adios_write_index_v1 (&global_index_buffer, &global_index_buffer_size
-                                         ,&global_index_buffer_offset, global_index_start
-                                         ,p->index);
-
-                    flag |= ADIOS_VERSION_HAVE_SUBFILE;
-
-                    adios_write_version_flag_v1 (&global_index_buffer
-                                                ,&global_index_buffer_size
-                                                ,&global_index_buffer_offset
-                                                ,flag
-                                                );
-                    START_TIMER (ADIOS_TIMER_IO);
-                    ssize_t s = write (p->mf, global_index_buffer, global_index_buffer_offset);
-                    STOP_TIMER (ADIOS_TIMER_IO);
-                    if (s != global_index_buffer_offset)
+                    uint64_t global_index_start = p->md_index_end;
+
+                    adios_posix_build_index_buffer (p, &global_index_buffer
+                                                   ,&global_index_buffer_size
+                                                   ,&global_index_buffer_offset
+                                                   ,global_index_start, p->md_index_end
+                                                   ,p->index, ADIOS_VERSION_HAVE_SUBFILE);
+                    if (job)
                     {
-                        fprintf (stderr, "POSIX method tried to write %" PRIu64 ", "
-                                         "only wrote %" PRId64 ". %s:%d\n"
-                                         ,fd->bytes_written
-                                         ,(int64_t)s
-                                         ,__func__, __LINE__
-                                );
+                        // written and closed by the background writer
+                        job->mf = p->mf;
+                        job->global_index = global_index_buffer;
+                        job->global_index_start = global_index_start;
+                        job->global_index_size = global_index_buffer_offset;
                     }
+                    else
+                    {
+                        START_TIMER (ADIOS_TIMER_IO);
+                        ssize_t s = write (p->mf, global_index_buffer, global_index_buffer_offset);
+                        STOP_TIMER (ADIOS_TIMER_IO);
+                        if (s != global_index_buffer_offset)
+                        {
+                            fprintf (stderr, "POSIX method tried to write %" PRIu64 ", "
+                                             "only wrote %" PRId64 ". %s:%d\n"
+                                             ,fd->bytes_written
+                                             ,(int64_t)s
+                                             ,__func__, __LINE__
+                                    );
+                        }
 
-                    close (p->mf);
-                    free (global_index_buffer);
+                        close (p->mf);
+                        free (global_index_buffer);
+                    }
+                    md_end = global_index_start + global_index_buffer_offset;
                 }
                 else
                 {
@@ -1037,12 +1434,25 @@ void adios_posix_close (struct adios_file_struct * fd
 
             // write buffered index now
             START_TIMER (ADIOS_TIMER_IO);
-            adios_posix_write_index (fd, method, buffer, buffer_offset); 
+            if (job)
+            {
+                // the background writer closes the file and frees the index buffer
+                adios_posix_start_drain (fd, method, job, buffer, buffer_offset, 1);
+                buffer = 0;
+            }
+            else
+            {
+                adios_posix_write_index (fd, method, buffer, buffer_offset); 
+            }
             STOP_TIMER (ADIOS_TIMER_IO);
 
             // close the file assuming we are done in 'w' mode
             adios_posix_close_internal (&p->b);
             p->file_is_open = 0;
+            if (p->step_marker)
+            {
+                adios_posix_write_step_marker (fd, method, (md_end ? md_end : index_start + buffer_offset));
+            }
             // in 'w' mode we forget about index, first append needs to read it from file
             adios_clear_index_v1 (p->index); 
             // notify future append steps that write mode does not keep the index in memory
@@ -1061,9 +1471,19 @@ void adios_posix_close (struct adios_file_struct * fd
             uint64_t buffer_size = 0;
             uint64_t buffer_offset = 0;
 
-            // write buffered data now
+            struct adios_POSIX_drain_job * job = 0;
+
+            // write buffered data now, or leave it to the background writer
             START_TIMER (ADIOS_TIMER_IO);
-            adios_posix_write_pg (fd, method); 
+            if (p->drain)
+            {
+                adios_posix_reserve_pg (fd, method);
+                job = adios_posix_new_drain_job (fd);
+            }
+            else
+            {
+                adios_posix_write_pg (fd, method); 
+            }
             STOP_TIMER (ADIOS_TIMER_IO);
 
             // Note: adios_posix_write_pg() sets the fd->current_pg->pg_start_in_file
@@ -1074,20 +1494,31 @@ void adios_posix_close (struct adios_file_struct * fd
 
             START_TIMER (ADIOS_TIMER_LOCALMD);
             uint64_t index_start = p->pg_start_next;
+            uint64_t md_end = 0; // end of the metadata file after this step (rank 0)
             // build index for current step and merge it into the 
             // existing index for previous steps
             struct adios_index_struct_v1 * current_index;
             current_index = adios_alloc_index_v1(1); // no hashtables
             adios_build_index_v1 (fd, current_index);
-            // new timestep so sorting is not needed during merge
-            adios_merge_index_v1 (p->index, current_index->pg_root, 
-                    current_index->vars_root, current_index->attrs_root, 0);
-            adios_write_index_v1 (&buffer, &buffer_size, &buffer_offset
-                                 ,index_start, p->index);
-            // free current_index structure but do not clear it's content, which is merged
-            // into p->index
+            if (p->index_is_chained)
+            {
+                // write only this step's index, linked to the previous footer
+                adios_posix_build_index_buffer (p, &buffer, &buffer_size, &buffer_offset
+                                               ,index_start, p->prev_index_end
+                                               ,current_index, 0);
+                adios_clear_index_v1 (current_index);
+            }
+            else
+            {
+                // new timestep so sorting is not needed during merge
+                adios_merge_index_v1 (p->index, current_index->pg_root, 
+                        current_index->vars_root, current_index->attrs_root, 0);
+                adios_posix_build_index_buffer (p, &buffer, &buffer_size, &buffer_offset
+                                               ,index_start, 0, p->index, 0);
+            }
+            // free current_index structure, its content is merged into p->index
+            // or already cleared
             adios_free_index_v1 (current_index);
-            adios_write_version_v1 (&buffer, &buffer_size, &buffer_offset);
             STOP_TIMER (ADIOS_TIMER_LOCALMD);
 
 #ifdef HAVE_MPI
@@ -1156,14 +1587,15 @@ void adios_posix_close (struct adios_file_struct * fd
                         }
 
                         // global index would become unsorted on main aggregator during merging 
-                        // so sort timesteps in this case (appending)
+                        // so sort timesteps in this case (appending), once after the loop
                         adios_merge_index_v1 (gindex, new_pg_root, 
-                                              new_vars_root, new_attrs_root, 1);
+                                              new_vars_root, new_attrs_root, 0);
                     
                         new_pg_root = 0;
                         new_vars_root = 0;
                         new_attrs_root = 0;
                     }
+                    adios_sort_index_characteristics_v1 (gindex);
 
                     p->b.buff = buffer_save;
                     p->b.length = buffer_size_save;
@@ -1176,37 +1608,42 @@ void adios_posix_close (struct adios_file_struct * fd
                     char * global_index_buffer = 0;
                     uint64_t global_index_buffer_size = 0;
                     uint64_t global_index_buffer_offset = 0;
-                    uint64_t global_index_start = 0;
-                    uint16_t flag = 0;
-
-                    adios_write_index_v1 (&global_index_buffer, &global_index_buffer_size
-                                         ,&global_index_buffer_offset, global_index_start
-                                         ,gindex);
+                    uint64_t global_index_start = p->md_index_end;
 
-                    flag |= ADIOS_VERSION_HAVE_SUBFILE;
+                    adios_posix_build_index_buffer (p, &global_index_buffer
+                                                   ,&global_index_buffer_size
+                                                   ,&global_index_buffer_offset
+                                                   ,global_index_start, p->md_index_end
+                                                   ,gindex, ADIOS_VERSION_HAVE_SUBFILE);
 
-                    adios_write_version_flag_v1 (&global_index_buffer
-                                                ,&global_index_buffer_size
-                                                ,&global_index_buffer_offset
-                                                ,flag
-                                                );
-
-                    START_TIMER (ADIOS_TIMER_IO);
-                    ssize_t s = write (p->mf, global_index_buffer, global_index_buffer_offset);
-                    STOP_TIMER (ADIOS_TIMER_IO);
-                    if (s != global_index_buffer_offset)
+                    if (job)
                     {
-                        fprintf (stderr, "POSIX method tried to write %" PRIu64 ", "
-                                         "only wrote %" PRId64 ", Mode: a. %s:%d\n"
-                                         ,global_index_buffer_offset
-                                         ,(int64_t)s
-                                         ,__func__, __LINE__
-                                );
+                        // written and closed by the background writer
+                        job->mf = p->mf;
+                        job->global_index = global_index_buffer;
+                        job->global_index_start = global_index_start;
+                        job->global_index_size = global_index_buffer_offset;
                     }
+                    else
+                    {
+                        START_TIMER (ADIOS_TIMER_IO);
+                        ssize_t s = write (p->mf, global_index_buffer, global_index_buffer_offset);
+                        STOP_TIMER (ADIOS_TIMER_IO);
+                        if (s != global_index_buffer_offset)
+                        {
+                            fprintf (stderr, "POSIX method tried to write %" PRIu64 ", "
+                                             "only wrote %" PRId64 ", Mode: a. %s:%d\n"
+                                             ,global_index_buffer_offset
+                                             ,(int64_t)s
+                                             ,__func__, __LINE__
+                                    );
+                        }
 
-                    close (p->mf);
+                        close (p->mf);
 
-                    free (global_index_buffer);
+                        free (global_index_buffer);
+                    }
+                    md_end = global_index_start + global_index_buffer_offset;
                     adios_clear_index_v1 (gindex);
                     adios_free_index_v1 (gindex);
                 }
@@ -1230,9 +1667,30 @@ void adios_posix_close (struct adios_file_struct * fd
 
             // write buffered index now
             START_TIMER (ADIOS_TIMER_IO);
-            adios_posix_write_index (fd, method, buffer, buffer_offset); 
+            if (job)
+            {
+                // the file stays open for the next append step
+                adios_posix_start_drain (fd, method, job, buffer, buffer_offset, 0);
+                buffer = 0;
+            }
+            else
+            {
+                adios_posix_write_index (fd, method, buffer, buffer_offset); 
+            }
             STOP_TIMER (ADIOS_TIMER_IO);
 
+            if (p->index_is_chained)
+            {
+                // the next step starts after this step's footer
+                p->prev_index_end = index_start + buffer_offset;
+                p->pg_start_next = p->prev_index_end;
+            }
+
+            if (p->step_marker)
+            {
+                adios_posix_write_step_marker (fd, method, (md_end ? md_end : index_start + buffer_offset));
+            }
+
             free (buffer);
 
             break;
@@ -1281,6 +1739,14 @@ void adios_posix_finalize (int mype, struct adios_method_struct * method)
 {
     struct adios_POSIX_data_struct * p = (struct adios_POSIX_data_struct *)
                                                           method->method_data;
+    if (adios_databuffer_drain_wait (p->drain))
+    {
+        adios_error (err_write_error,
+                     "POSIX method: background write of the last step failed\n");
+    }
+    adios_databuffer_drain_free (p->drain);
+    p->drain = 0;
+
     if (p->file_is_open) {
         adios_clear_index_v1 (p->index); // append and update methods never cleared the index
         adios_posix_close_internal (&p->b);
@@ -0,0 +1,211 @@
+/*
+ * ADIOS is freely available under the terms of the BSD license described
+ * in the COPYING file in the top level directory of this source distribution.
+ *
+ * Copyright (c) 2008 - 2009.  UT-BATTELLE, LLC. All rights reserved.
+ */
+
+/* Test of appending to a file of the MPI_AGGREGATE method.
+ *
+ * All processes write a step of a 1D global array with the MPI_AGGREGATE
+ * method, then append NSTEPS-1 steps in which each process writes a
+ * different amount of data than before, so that the aggregation groups are
+ * balanced differently in every step. The number of subfiles in the .dir
+ * directory must not change with the appends, and every process reads the
+ * whole array of every step back and checks it. This is done with
+ * num_aggregators given and with the number of aggregators derived from
+ * num_ost.
+ *
+ * Usage: aggregate_append
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <dirent.h>
+#include "mpi.h"
+#include "adios.h"
+#include "adios_read.h"
+
+#define NX 1000
+#define NSTEPS 3
+
+static const char * params[] = {"num_aggregators=2;num_ost=2", "num_ost=3"};
+#define NPARAMS 2
+
+static double value (int step, uint64_t i)
+{
+    return step * 1.0e7 + (double) i;
+}
+
+/* Elements written by 'rank' in 'step': more on the low ranks in even steps,
+   more on the high ranks in odd steps */
+static uint64_t local_size (int step, int rank, int size)
+{
+    return (uint64_t) NX * (step % 2 ? rank + 1 : size - rank);
+}
+
+/* Number of subfiles of fname (rank 0 only) */
+static int count_subfiles (const char * fname)
+{
+    char dirname[256], prefix[256];
+    DIR * dir;
+    struct dirent * e;
+    int n = 0;
+
+    sprintf (dirname, "%s.dir", fname);
+    sprintf (prefix, "%s.", fname);
+    dir = opendir (dirname);
+    if (!dir)
+        return -1;
+    while ((e = readdir (dir)))
+    {
+        if (!strncmp (e->d_name, prefix, strlen (prefix)))
+            n++;
+    }
+    closedir (dir);
+    return n;
+}
+
+static void write_step (const char * group, const char * fname, int step,
+                        int rank, int size, MPI_Comm comm)
+{
+    int64_t fh;
+    uint64_t total, gdim = 0, ldim = local_size (step, rank, size), offs = 0, i;
+    double * data = (double *) malloc (ldim * sizeof (double));
+    int r;
+
+    for (r = 0; r < size; r++)
+    {
+        if (r < rank)
+            offs += local_size (step, r, size);
+        gdim += local_size (step, r, size);
+    }
+    for (i = 0; i < ldim; i++)
+        data[i] = value (step, offs + i);
+
+    adios_open (&fh, group, fname, (step ? "a" : "w"), comm);
+    adios_group_size (fh, 3 * sizeof (uint64_t) + ldim * sizeof (double), &total);
+    adios_write (fh, "gdim", &gdim);
+    adios_write (fh, "ldim", &ldim);
+    adios_write (fh, "offs", &offs);
+    adios_write (fh, "data", data);
+    adios_close (fh);
+    free (data);
+}
+
+static int check_file (const char * fname, int rank, int size, MPI_Comm comm)
+{
+    ADIOS_FILE * f;
+    ADIOS_SELECTION * sel;
+    uint64_t start = 0, count, i;
+    double * data;
+    int s, r, err = 0;
+
+    f = adios_read_open_file (fname, ADIOS_READ_METHOD_BP, comm);
+    if (!f)
+    {
+        printf ("ERROR: rank %d: cannot open %s: %s\n", rank, fname, adios_errmsg ());
+        return 1;
+    }
+    if (f->last_step + 1 != NSTEPS)
+    {
+        printf ("ERROR: rank %d: %s has %d steps instead of %d\n", rank, fname,
+                f->last_step + 1, NSTEPS);
+        adios_read_close (f);
+        return 1;
+    }
+
+    for (s = 0; s < NSTEPS && !err; s++)
+    {
+        for (r = 0, count = 0; r < size; r++)
+            count += local_size (s, r, size);
+        data = (double *) calloc (count, sizeof (double));
+        sel = adios_selection_boundingbox (1, &start, &count);
+        adios_schedule_read (f, sel, "data", s, 1, data);
+        adios_perform_reads (f, 1);
+        for (i = 0; i < count && !err; i++)
+        {
+            if (data[i] != value (s, i))
+            {
+                printf ("ERROR: rank %d: %s step %d data[%llu] = %g instead of %g\n",
+                        rank, fname, s, (unsigned long long) i, data[i], value (s, i));
+                err = 1;
+            }
+        }
+        adios_selection_delete (sel);
+        free (data);
+    }
+    adios_read_close (f);
+    return err;
+}
+
+int main (int argc, char ** argv)
+{
+    MPI_Comm comm = MPI_COMM_WORLD;
+    char group[64], fname[64];
+    int64_t g;
+    int rank, size, p, s, nsub[NSTEPS], err = 0, gerr;
+
+    MPI_Init (&argc, &argv);
+    MPI_Comm_rank (comm, &rank);
+    MPI_Comm_size (comm, &size);
+
+    adios_init_noxml (comm);
+    adios_set_max_buffer_size (10);
+    for (p = 0; p < NPARAMS; p++)
+    {
+        sprintf (group, "append%d", p);
+        adios_declare_group (&g, group, "", adios_stat_default);
+        adios_select_method (g, "MPI_AGGREGATE", params[p], "");
+        adios_define_var (g, "gdim", "", adios_unsigned_long, "", "", "");
+        adios_define_var (g, "ldim", "", adios_unsigned_long, "", "", "");
+        adios_define_var (g, "offs", "", adios_unsigned_long, "", "", "");
+        adios_define_var (g, "data", "", adios_double, "ldim", "gdim", "offs");
+    }
+
+    for (p = 0; p < NPARAMS; p++)
+    {
+        sprintf (group, "append%d", p);
+        sprintf (fname, "aggregate_append_%d.bp", p);
+        for (s = 0; s < NSTEPS; s++)
+        {
+            write_step (group, fname, s, rank, size, comm);
+            MPI_Barrier (comm);
+            if (rank == 0)
+                nsub[s] = count_subfiles (fname);
+        }
+        if (rank == 0)
+        {
+            for (s = 1; s < NSTEPS; s++)
+            {
+                if (nsub[s] != nsub[0])
+                {
+                    printf ("ERROR: %s: %s has %d subfiles after step %d, %d after the first one\n",
+                            params[p], fname, nsub[s], s, nsub[0]);
+                    err = 1;
+                }
+            }
+            if (nsub[0] < 1)
+            {
+                printf ("ERROR: %s: %s has no subfiles\n", params[p], fname);
+                err = 1;
+            }
+        }
+    }
+    adios_finalize (rank);
+
+    adios_read_init_method (ADIOS_READ_METHOD_BP, comm, "");
+    for (p = 0; p < NPARAMS; p++)
+    {
+        sprintf (fname, "aggregate_append_%d.bp", p);
+        err |= check_file (fname, rank, size, comm);
+    }
+    adios_read_finalize_method (ADIOS_READ_METHOD_BP);
+
+    MPI_Allreduce (&err, &gerr, 1, MPI_INT, MPI_MAX, comm);
+    if (rank == 0)
+        printf ("%s\n", gerr ? "FAILED" : "OK");
+
+    MPI_Finalize ();
+    return gerr;
+}
@@ -0,0 +1,176 @@
+/*
+ * ADIOS is freely available under the terms of the BSD license described
+ * in the COPYING file in the top level directory of this source distribution.
+ *
+ * Copyright (c) 2008 - 2009.  UT-BATTELLE, LLC. All rights reserved.
+ */
+
+/* Test of the "async" parameter of the POSIX and MPI write methods.
+ *
+ * Each method writes NSTEPS steps of a global array into its own file,
+ * the first step with "w", the others with "a". Between two steps a second
+ * file is written, so that a step overlaps with the drain of the previous
+ * one while the reopen of the same file waits for it. After adios_finalize(),
+ * which waits for the last drain, every step of both files is read back and
+ * checked.
+ *
+ * Usage: async_write
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "mpi.h"
+#include "adios.h"
+#include "adios_read.h"
+
+#define NX 1000
+#define NSTEPS 4
+
+static const char * methods[] = {"POSIX", "MPI"};
+#define NMETHODS 2
+
+static double value (int m, int step, int rank, int i)
+{
+    return m * 1.0e6 + step * 1.0e4 + rank * NX + i;
+}
+
+static void declare_group (const char * name, const char * method)
+{
+    int64_t g;
+    adios_declare_group (&g, name, "", adios_stat_default);
+    adios_select_method (g, method, "async", "");
+    adios_define_var (g, "gdim", "", adios_integer, "", "", "");
+    adios_define_var (g, "ldim", "", adios_integer, "", "", "");
+    adios_define_var (g, "offs", "", adios_integer, "", "", "");
+    adios_define_var (g, "step", "", adios_integer, "", "", "");
+    adios_define_var (g, "data", "", adios_double, "ldim", "gdim", "offs");
+}
+
+static void write_step (const char * group, const char * fname, const char * mode,
+                        int m, int step, int rank, int size, MPI_Comm comm)
+{
+    int64_t fh;
+    uint64_t total;
+    double data[NX];
+    int i, gdim = NX * size, ldim = NX, offs = NX * rank;
+
+    for (i = 0; i < NX; i++)
+        data[i] = value (m, step, rank, i);
+
+    adios_open (&fh, group, fname, mode, comm);
+    adios_group_size (fh, 4 * sizeof (int) + NX * sizeof (double), &total);
+    adios_write (fh, "gdim", &gdim);
+    adios_write (fh, "ldim", &ldim);
+    adios_write (fh, "offs", &offs);
+    adios_write (fh, "step", &step);
+    adios_write (fh, "data", data);
+    adios_close (fh);
+}
+
+static int check_file (const char * fname, int m, int nsteps, int rank, int size, MPI_Comm comm)
+{
+    ADIOS_FILE * f;
+    ADIOS_SELECTION * sel;
+    uint64_t start = (uint64_t) NX * rank, count = NX;
+    double data[NX];
+    int s, i, step, err = 0;
+
+    f = adios_read_open_file (fname, ADIOS_READ_METHOD_BP, comm);
+    if (!f)
+    {
+        printf ("ERROR: rank %d: cannot open %s: %s\n", rank, fname, adios_errmsg ());
+        return 1;
+    }
+    if (f->last_step + 1 != nsteps)
+    {
+        printf ("ERROR: rank %d: %s has %d steps instead of %d\n", rank, fname,
+                f->last_step + 1, nsteps);
+        adios_read_close (f);
+        return 1;
+    }
+
+    sel = adios_selection_boundingbox (1, &start, &count);
+    for (s = 0; s < nsteps && !err; s++)
+    {
+        memset (data, 0, sizeof (data));
+        step = -1;
+        adios_schedule_read (f, sel, "data", s, 1, data);
+        adios_schedule_read (f, NULL, "step", s, 1, &step);
+        adios_perform_reads (f, 1);
+        if (step != s)
+        {
+            printf ("ERROR: rank %d: %s step %d holds step %d\n", rank, fname, s, step);
+            err = 1;
+        }
+        for (i = 0; i < NX && !err; i++)
+        {
+            if (data[i] != value (m, s, rank, i))
+            {
+                printf ("ERROR: rank %d: %s step %d data[%d] = %g instead of %g\n",
+                        rank, fname, s, i, data[i], value (m, s, rank, i));
+                err = 1;
+            }
+        }
+    }
+    adios_selection_delete (sel);
+    adios_read_close (f);
+    return err;
+}
+
+int main (int argc, char ** argv)
+{
+    MPI_Comm comm = MPI_COMM_WORLD;
+    char group[64], fname[64], other[64], othergroup[64];
+    int rank, size, provided, m, s, err = 0, gerr;
+
+    MPI_Init_thread (&argc, &argv, MPI_THREAD_MULTIPLE, &provided);
+    MPI_Comm_rank (comm, &rank);
+    MPI_Comm_size (comm, &size);
+    if (provided < MPI_THREAD_MULTIPLE && rank == 0)
+        printf ("MPI does not provide MPI_THREAD_MULTIPLE, the MPI method writes synchronously\n");
+
+    adios_init_noxml (comm);
+    adios_set_max_buffer_size (10);
+
+    for (m = 0; m < NMETHODS; m++)
+    {
+        sprintf (group, "async_%s", methods[m]);
+        sprintf (othergroup, "async_other_%s", methods[m]);
+        declare_group (group, methods[m]);
+        declare_group (othergroup, methods[m]);
+    }
+
+    for (s = 0; s < NSTEPS; s++)
+    {
+        for (m = 0; m < NMETHODS; m++)
+        {
+            sprintf (group, "async_%s", methods[m]);
+            sprintf (fname, "async_write_%s.bp", methods[m]);
+            sprintf (othergroup, "async_other_%s", methods[m]);
+            sprintf (other, "async_other_%s.bp", methods[m]);
+            write_step (group, fname, (s ? "a" : "w"), m, s, rank, size, comm);
+            write_step (othergroup, other, (s ? "a" : "w"), m + NMETHODS, s, rank, size, comm);
+        }
+    }
+
+    // waits for the last steps
+    adios_finalize (rank);
+
+    adios_read_init_method (ADIOS_READ_METHOD_BP, comm, "");
+    for (m = 0; m < NMETHODS; m++)
+    {
+        sprintf (fname, "async_write_%s.bp", methods[m]);
+        sprintf (other, "async_other_%s.bp", methods[m]);
+        err |= check_file (fname, m, NSTEPS, rank, size, comm);
+        err |= check_file (other, m + NMETHODS, NSTEPS, rank, size, comm);
+    }
+
+    adios_read_finalize_method (ADIOS_READ_METHOD_BP);
+
+    MPI_Allreduce (&err, &gerr, 1, MPI_INT, MPI_MAX, comm);
+    if (rank == 0)
+        printf ("%s\n", gerr ? "FAILED" : "OK");
+
+    MPI_Finalize ();
+    return gerr;
+}
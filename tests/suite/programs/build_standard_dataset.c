@@ -72,6 +72,9 @@ static void build_dimension_var_list(int ndim, const char *dimvar_base, char *ou
 		outbuf += sprintf(outbuf, i == 0 ? "%s%d" : ",%s%d", dimvar_base, i);
 }
 
+// Write-time index applied to all variables (see usage_and_exit)
+static const char *index_name = "none";
+
 static void produce_xml(
 		FILE *outfile,
 		const dataset_xml_spec_t *xml_spec,
@@ -91,7 +94,7 @@ static void produce_xml(
 	"		<global-bounds dimensions=\"%s\" offsets=\"%s\">\n";
 
 	static const char *VAR_XML =
-	"			<var name=\"%s\" type=\"%s\" dimensions=\"%s\" transform=\"%s\"/>\n";
+	"			<var name=\"%s\" type=\"%s\" dimensions=\"%s\" transform=\"%s\" index=\"%s\"/>\n";
 
 	static const char *GLOBALBOUNDS_FOOTER_XML =
 	"		</global-bounds>\n";
@@ -117,7 +120,7 @@ static void produce_xml(
 
 	for (i = 0; i < xml_spec->nvar; ++i) {
 		build_dimension_var_list(xml_spec->ndim, "D", dimvar_list_buf1);
-		fprintf(outfile, VAR_XML, xml_spec->varnames[i], adios_type_to_string_int(xml_spec->vartypes[i]), dimvar_list_buf1, transform_name);
+		fprintf(outfile, VAR_XML, xml_spec->varnames[i], adios_type_to_string_int(xml_spec->vartypes[i]), dimvar_list_buf1, transform_name, index_name);
 	}
 
 	fprintf(outfile, GLOBALBOUNDS_FOOTER_XML);
@@ -725,7 +728,7 @@ static void build_dataset_unevenpg(const char *filename_prefix, const char *tran
 
 static void usage_and_exit() {
 	int i;
-	fprintf(stderr, "Usage: build_standard_dataset <dataset-id> <filename-prefix> [<transform-type>]\n");
+	fprintf(stderr, "Usage: build_standard_dataset <dataset-id> <filename-prefix> [<transform-type> [<index-type>]]\n");
 	fprintf(stderr, "\n");
 	fprintf(stderr, "  dataset-id: the ID of a standard dataset packaged in this executable:\n");
 	fprintf(stderr, "    - 'DS1': 1 variable, 2D array of floats\n");
@@ -735,7 +738,8 @@ static void usage_and_exit() {
 	fprintf(stderr, "            -> produces some/path/myfile.xml, some/path/myfile.bp:\n");
 	fprintf(stderr, "\n");
 	fprintf(stderr, "  transform-type: the data transform to apply (default: none). May include\n");
-	fprintf(stderr, "                  transform parameters, just like in an ADIOS XML file.");
+	fprintf(stderr, "                  transform parameters, just like in an ADIOS XML file.\n");
+	fprintf(stderr, "  index-type: the write-time index to build (default: none), e.g. 'bitmap:bins=64'.\n");
 	fprintf(stderr, "\n");
 	fprintf(stderr, "Available datasets:\n");
 	for (i = 0; i < NUM_DATASETS; ++i)
@@ -744,12 +748,14 @@ static void usage_and_exit() {
 }
 
 int main(int argc, char **argv) {
-	if (argc < 3 || argc > 4)
+	if (argc < 3 || argc > 5)
 		usage_and_exit();
 
 	const char *dataset_id = argv[1];
 	const char *path = argv[2];
 	const char *transform_name = (argc >= 4) ? argv[3] : "none";
+	if (argc >= 5)
+		index_name = argv[4];
 
 	int i;
 	const dataset_info_t *dataset = NULL;
@@ -0,0 +1,189 @@
+/*
+ * ADIOS is freely available under the terms of the BSD license described
+ * in the COPYING file in the top level directory of this source distribution.
+ *
+ * Copyright (c) 2008 - 2009.  UT-BATTELLE, LLC. All rights reserved.
+ */
+
+/* Test of appending with the MPI, MPI_LUSTRE and MPI_AGGREGATE methods to a
+ * file written by the POSIX method with a chained index ("index=chained").
+ *
+ * NCHAINED steps of a 1D global array and a scalar are written with POSIX,
+ * the first one with "w", the others appended with a chained index. For MPI
+ * and MPI_LUSTRE, rank 0 writes them alone into one file. For MPI_AGGREGATE,
+ * all processes write them into subfiles, with as many aggregators as
+ * processes for the appended step, so that each subfile is appended to.
+ * Then one step is appended with the method, which rewrites the whole index.
+ * Every process reads the whole array and the scalar of every step back
+ * and checks them, so steps missing from the index are detected.
+ *
+ * Usage: chained_append
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "mpi.h"
+#include "adios.h"
+#include "adios_read.h"
+
+#define NX 100
+#define NCHAINED 3
+#define NSTEPS (NCHAINED + 1)
+
+static const char * methods[] = {"MPI", "MPI_LUSTRE", "MPI_AGGREGATE"};
+#define NMETHODS 3
+
+static double value (int step, uint64_t i)
+{
+    return step * 1.0e6 + (double) i;
+}
+
+static void declare_group (const char * method, const char * params)
+{
+    int64_t g;
+
+    adios_declare_group (&g, "chained", "", adios_stat_default);
+    adios_select_method (g, method, params, "");
+    adios_define_var (g, "gdim", "", adios_unsigned_long, "", "", "");
+    adios_define_var (g, "ldim", "", adios_unsigned_long, "", "", "");
+    adios_define_var (g, "offs", "", adios_unsigned_long, "", "", "");
+    adios_define_var (g, "step", "", adios_integer, "", "", "");
+    adios_define_var (g, "data", "", adios_double, "ldim", "gdim", "offs");
+}
+
+/* Write 'step' of the array of gdim elements, ldim of them from offs */
+static void write_step (const char * fname, int step, uint64_t gdim, uint64_t ldim,
+                        uint64_t offs, MPI_Comm comm)
+{
+    int64_t fh;
+    uint64_t total, i;
+    double * data = (double *) malloc (ldim * sizeof (double));
+
+    for (i = 0; i < ldim; i++)
+        data[i] = value (step, offs + i);
+    adios_open (&fh, "chained", fname, (step ? "a" : "w"), comm);
+    adios_group_size (fh, 3 * sizeof (uint64_t) + sizeof (int) + ldim * sizeof (double), &total);
+    adios_write (fh, "gdim", &gdim);
+    adios_write (fh, "ldim", &ldim);
+    adios_write (fh, "offs", &offs);
+    adios_write (fh, "step", &step);
+    adios_write (fh, "data", data);
+    adios_close (fh);
+    free (data);
+}
+
+static void write_file (const char * fname, int m, int rank, int size, MPI_Comm comm)
+{
+    uint64_t gdim = (uint64_t) NX * size;
+    char params[64] = "";
+    int s;
+
+    // the chained steps
+    adios_init_noxml (comm);
+    adios_set_max_buffer_size (10);
+    declare_group ("POSIX", "index=chained");
+    if (!strcmp (methods[m], "MPI_AGGREGATE"))
+    {
+        for (s = 0; s < NCHAINED; s++)
+            write_step (fname, s, gdim, NX, (uint64_t) rank * NX, comm);
+        sprintf (params, "num_aggregators=%d;num_ost=%d", size, size);
+    }
+    else if (rank == 0)
+    {
+        for (s = 0; s < NCHAINED; s++)
+            write_step (fname, s, gdim, gdim, 0, MPI_COMM_SELF);
+    }
+    adios_finalize (rank);
+    MPI_Barrier (comm);
+
+    // the appended step, with the method
+    adios_init_noxml (comm);
+    adios_set_max_buffer_size (10);
+    declare_group (methods[m], params);
+    write_step (fname, NCHAINED, gdim, NX, (uint64_t) rank * NX, comm);
+    adios_finalize (rank);
+}
+
+static int check_file (const char * fname, int m, int rank, int size, MPI_Comm comm)
+{
+    ADIOS_FILE * f;
+    ADIOS_SELECTION * sel;
+    uint64_t start = 0, count = (uint64_t) NX * size, i;
+    double * data = (double *) malloc (count * sizeof (double));
+    int s, step, err = 0;
+
+    f = adios_read_open_file (fname, ADIOS_READ_METHOD_BP, comm);
+    if (!f)
+    {
+        printf ("ERROR: rank %d: %s: cannot open %s: %s\n", rank, methods[m], fname,
+                adios_errmsg ());
+        free (data);
+        return 1;
+    }
+    if (f->last_step + 1 != NSTEPS)
+    {
+        printf ("ERROR: rank %d: %s: %s has %d steps instead of %d\n", rank, methods[m],
+                fname, f->last_step + 1, NSTEPS);
+        err = 1;
+    }
+
+    sel = adios_selection_boundingbox (1, &start, &count);
+    for (s = 0; s < NSTEPS && !err; s++)
+    {
+        memset (data, 0, count * sizeof (double));
+        step = -1;
+        adios_schedule_read (f, sel, "data", s, 1, data);
+        adios_schedule_read (f, NULL, "step", s, 1, &step);
+        adios_perform_reads (f, 1);
+        if (step != s)
+        {
+            printf ("ERROR: rank %d: %s: step %d has step = %d\n", rank, methods[m], s, step);
+            err = 1;
+        }
+        for (i = 0; i < count && !err; i++)
+        {
+            if (data[i] != value (s, i))
+            {
+                printf ("ERROR: rank %d: %s: step %d data[%llu] = %g instead of %g\n",
+                        rank, methods[m], s, (unsigned long long) i, data[i], value (s, i));
+                err = 1;
+            }
+        }
+    }
+    adios_selection_delete (sel);
+    adios_read_close (f);
+    free (data);
+    return err;
+}
+
+int main (int argc, char ** argv)
+{
+    MPI_Comm comm = MPI_COMM_WORLD;
+    char fname[64];
+    int rank, size, m, err = 0, gerr;
+
+    MPI_Init (&argc, &argv);
+    MPI_Comm_rank (comm, &rank);
+    MPI_Comm_size (comm, &size);
+
+    for (m = 0; m < NMETHODS; m++)
+    {
+        sprintf (fname, "chained_append_%s.bp", methods[m]);
+        write_file (fname, m, rank, size, comm);
+    }
+
+    adios_read_init_method (ADIOS_READ_METHOD_BP, comm, "");
+    for (m = 0; m < NMETHODS; m++)
+    {
+        sprintf (fname, "chained_append_%s.bp", methods[m]);
+        err |= check_file (fname, m, rank, size, comm);
+    }
+    adios_read_finalize_method (ADIOS_READ_METHOD_BP);
+
+    MPI_Allreduce (&err, &gerr, 1, MPI_INT, MPI_MAX, comm);
+    if (rank == 0)
+        printf ("%s\n", gerr ? "FAILED" : "OK");
+
+    MPI_Finalize ();
+    return gerr;
+}
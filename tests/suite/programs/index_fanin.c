@@ -0,0 +1,171 @@
+/*
+ * ADIOS is freely available under the terms of the BSD license described
+ * in the COPYING file in the top level directory of this source distribution.
+ *
+ * Copyright (c) 2008 - 2009.  UT-BATTELLE, LLC. All rights reserved.
+ */
+
+/* Test of the tree reduction of the index in the MPI method ("index_fanin").
+ *
+ * The same NSTEPS steps are written into two files with the MPI method, one
+ * with index_fanin=2 and one with index_fanin set to the number of processes,
+ * where rank 0 receives the indexes of all processes in one round, like
+ * the flat gather used before. Each process writes a different number of
+ * blocks of a global array and a scalar. In both files, the index must
+ * list the blocks of every step in rank order, with the offsets and the
+ * min/max of the data written.
+ *
+ * Usage: index_fanin
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "mpi.h"
+#include "adios.h"
+#include "adios_read.h"
+
+#define NX 10
+#define NSTEPS 3
+
+static const char * fnames[] = {"index_fanin_2.bp", "index_fanin_flat.bp"};
+#define NFILES 2
+
+static double value (int step, int rank, int block, int i)
+{
+    return step * 1.0e4 + rank * 100 + block * NX + i;
+}
+
+/* Blocks written by 'rank': 1, 2, 3, 1, 2, ... */
+static int nblocks (int rank)
+{
+    return rank % 3 + 1;
+}
+
+static void write_file (int f, int rank, int size, MPI_Comm comm)
+{
+    char group[32], params[64];
+    int64_t g, fh;
+    uint64_t total;
+    double data[NX];
+    int s, b, i, r, gdim = 0, ldim = NX, offs = 0;
+
+    for (r = 0; r < size; r++)
+    {
+        if (r < rank)
+            offs += nblocks (r) * NX;
+        gdim += nblocks (r) * NX;
+    }
+
+    sprintf (group, "fanin%d", f);
+    sprintf (params, "index_fanin=%d", (f ? size : 2));
+    adios_declare_group (&g, group, "", adios_stat_default);
+    adios_select_method (g, "MPI", params, "");
+    adios_define_var (g, "gdim", "", adios_integer, "", "", "");
+    adios_define_var (g, "ldim", "", adios_integer, "", "", "");
+    adios_define_var (g, "offs", "", adios_integer, "", "", "");
+    adios_define_var (g, "rank", "", adios_integer, "", "", "");
+    adios_define_var (g, "data", "", adios_double, "ldim", "gdim", "offs");
+
+    for (s = 0; s < NSTEPS; s++)
+    {
+        adios_open (&fh, group, fnames[f], (s ? "a" : "w"), comm);
+        adios_group_size (fh, (3 + nblocks (rank)) * sizeof (int)
+                              + nblocks (rank) * NX * sizeof (double), &total);
+        adios_write (fh, "gdim", &gdim);
+        adios_write (fh, "ldim", &ldim);
+        adios_write (fh, "rank", &rank);
+        for (b = 0; b < nblocks (rank); b++)
+        {
+            int o = offs + b * NX;
+            for (i = 0; i < NX; i++)
+                data[i] = value (s, rank, b, i);
+            adios_write (fh, "offs", &o);
+            adios_write (fh, "data", data);
+        }
+        adios_close (fh);
+    }
+}
+
+/* The blocks of every process in every step must be in the index in rank
+ * order, with their own offsets and min/max */
+static int check_index (const char * fname, int rank, int size, MPI_Comm comm)
+{
+    ADIOS_FILE * f;
+    ADIOS_VARINFO * v;
+    int s, r, b, k, offs, err = 0;
+    double min, max;
+
+    f = adios_read_open_file (fname, ADIOS_READ_METHOD_BP, comm);
+    if (!f)
+    {
+        printf ("ERROR: rank %d: cannot open %s: %s\n", rank, fname, adios_errmsg ());
+        return 1;
+    }
+    v = adios_inq_var (f, "data");
+    if (!v || v->nsteps != NSTEPS)
+    {
+        printf ("ERROR: rank %d: %s: data has %d steps instead of %d\n", rank, fname,
+                (v ? v->nsteps : 0), NSTEPS);
+        err = 1;
+    }
+    if (!err)
+    {
+        adios_inq_var_blockinfo (f, v);
+        adios_inq_var_stat (f, v, 0, 1);
+    }
+    for (s = 0, k = 0; s < NSTEPS && !err; s++)
+    {
+        for (r = 0, offs = 0; r < size && !err; r++)
+        {
+            for (b = 0; b < nblocks (r) && !err; b++, k++, offs += NX)
+            {
+                min = value (s, r, b, 0);
+                max = value (s, r, b, NX - 1);
+                if (v->blockinfo[k].start[0] != offs
+                    || v->blockinfo[k].count[0] != NX
+                    || *(double *) v->statistics->blocks->mins[k] != min
+                    || *(double *) v->statistics->blocks->maxs[k] != max)
+                {
+                    printf ("ERROR: rank %d: %s: block %d of step %d is at %llu with min %g "
+                            "max %g, expected block %d of process %d at %d with min %g max %g\n",
+                            rank, fname, k, s, (unsigned long long) v->blockinfo[k].start[0],
+                            *(double *) v->statistics->blocks->mins[k],
+                            *(double *) v->statistics->blocks->maxs[k], b, r, offs, min, max);
+                    err = 1;
+                }
+            }
+        }
+    }
+    if (v)
+        adios_free_varinfo (v);
+    adios_read_close (f);
+    return err;
+}
+
+int main (int argc, char ** argv)
+{
+    MPI_Comm comm = MPI_COMM_WORLD;
+    int rank, size, f, err = 0, gerr;
+
+    MPI_Init (&argc, &argv);
+    MPI_Comm_rank (comm, &rank);
+    MPI_Comm_size (comm, &size);
+
+    adios_init_noxml (comm);
+    adios_set_max_buffer_size (10);
+    for (f = 0; f < NFILES; f++)
+        write_file (f, rank, size, comm);
+    adios_finalize (rank);
+
+    adios_read_init_method (ADIOS_READ_METHOD_BP, comm, "");
+    for (f = 0; f < NFILES; f++)
+        err |= check_index (fnames[f], rank, size, comm);
+    adios_read_finalize_method (ADIOS_READ_METHOD_BP);
+
+    MPI_Allreduce (&err, &gerr, 1, MPI_INT, MPI_MAX, comm);
+    if (rank == 0)
+        printf ("%s\n", gerr ? "FAILED" : "OK");
+
+    MPI_Finalize ();
+    return gerr;
+}
@@ -0,0 +1,207 @@
+/*
+ * ADIOS is freely available under the terms of the BSD license described
+ * in the COPYING file in the top level directory of this source distribution.
+ *
+ * Copyright (c) 2008 - 2009.  UT-BATTELLE, LLC. All rights reserved.
+ */
+
+/* Test of the "shared_index" parameter of the BP read method.
+ *
+ * Every process writes NBLOCKS blocks of a global array and a local array in
+ * each of NSTEPS steps. The file is then opened by all processes without
+ * parameters, with "shared_index" and with "shared_index;lazy_index", in which
+ * case the raw index stays in the shared memory window until the file is
+ * closed.
+ * With each parameter set, the variable info and the block info of both
+ * arrays must be the same as without parameters, and every process reads
+ * the blocks of another process in every step and checks the values. The
+ * processes access the variables in a different order, so that with
+ * lazy_index they are decoded from the shared raw index at different times.
+ *
+ * Usage: shared_index
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "mpi.h"
+#include "adios.h"
+#include "adios_read.h"
+
+#define NX 100
+#define NBLOCKS 3
+#define NSTEPS 3
+
+static const char FILENAME[] = "shared_index.bp";
+static const char * params[] = {"shared_index", "shared_index;lazy_index"};
+#define NPARAMS 2
+static const char * varnames[] = {"global", "local"};
+#define NVARS 2
+
+static double value (int var, int step, int rank, int block, int i)
+{
+    return var * 1.0e7 + step * 1.0e5 + (rank * NBLOCKS + block) * NX + i;
+}
+
+static void write_file (int rank, int size, MPI_Comm comm)
+{
+    int64_t g, fh;
+    uint64_t total;
+    double data[NX];
+    int s, b, i, gdim = NX * NBLOCKS * size, ldim = NX, offs;
+
+    adios_declare_group (&g, "shared_index", "", adios_stat_default);
+    adios_select_method (g, "MPI", "", "");
+    adios_define_var (g, "gdim", "", adios_integer, "", "", "");
+    adios_define_var (g, "ldim", "", adios_integer, "", "", "");
+    adios_define_var (g, "offs", "", adios_integer, "", "", "");
+    adios_define_var (g, "global", "", adios_double, "ldim", "gdim", "offs");
+    adios_define_var (g, "local", "", adios_double, "ldim", "", "");
+
+    for (s = 0; s < NSTEPS; s++)
+    {
+        adios_open (&fh, "shared_index", FILENAME, (s ? "a" : "w"), comm);
+        adios_group_size (fh, 3 * sizeof (int) + 2 * NBLOCKS * NX * sizeof (double), &total);
+        adios_write (fh, "gdim", &gdim);
+        adios_write (fh, "ldim", &ldim);
+        for (b = 0; b < NBLOCKS; b++)
+        {
+            offs = (rank * NBLOCKS + b) * NX;
+            adios_write (fh, "offs", &offs);
+            for (i = 0; i < NX; i++)
+                data[i] = value (0, s, rank, b, i);
+            adios_write (fh, "global", data);
+            for (i = 0; i < NX; i++)
+                data[i] = value (1, s, rank, b, i);
+            adios_write (fh, "local", data);
+        }
+        adios_close (fh);
+    }
+}
+
+/* Compare the variable and block info of var with the one read without parameters */
+static int check_info (ADIOS_FILE * f, ADIOS_FILE * ref, const char * name,
+                       const char * param, int rank)
+{
+    ADIOS_VARINFO * v = adios_inq_var (f, name);
+    ADIOS_VARINFO * r = adios_inq_var (ref, name);
+    int i, k, err = 0;
+
+    if (!v || !r)
+    {
+        printf ("ERROR: rank %d: %s: cannot inquire %s: %s\n", rank, param, name, adios_errmsg ());
+        err = 1;
+    }
+    else
+    {
+        adios_inq_var_blockinfo (f, v);
+        adios_inq_var_blockinfo (ref, r);
+        err = (v->ndim != r->ndim || v->nsteps != r->nsteps || v->sum_nblocks != r->sum_nblocks);
+        for (i = 0; i < v->ndim && !err; i++)
+            err = (v->dims[i] != r->dims[i]);
+        for (i = 0; i < v->nsteps && !err; i++)
+            err = (v->nblocks[i] != r->nblocks[i]);
+        for (i = 0; i < v->sum_nblocks && !err; i++)
+        {
+            err = (v->blockinfo[i].process_id != r->blockinfo[i].process_id
+                   || v->blockinfo[i].time_index != r->blockinfo[i].time_index);
+            for (k = 0; k < v->ndim && !err; k++)
+                err = (v->blockinfo[i].start[k] != r->blockinfo[i].start[k]
+                       || v->blockinfo[i].count[k] != r->blockinfo[i].count[k]);
+        }
+        if (err)
+            printf ("ERROR: rank %d: %s: the info of %s differs from the one read "
+                    "without parameters\n", rank, param, name);
+    }
+    if (v)
+        adios_free_varinfo (v);
+    if (r)
+        adios_free_varinfo (r);
+    return err;
+}
+
+/* Read the blocks written by process 'writer' in every step */
+static int check_values (ADIOS_FILE * f, int var, int writer, const char * param, int rank)
+{
+    ADIOS_SELECTION * sel;
+    double data[NX];
+    int s, b, i, err = 0;
+
+    for (s = 0; s < NSTEPS && !err; s++)
+    {
+        for (b = 0; b < NBLOCKS && !err; b++)
+        {
+            memset (data, 0, sizeof (data));
+            sel = adios_selection_writeblock (writer * NBLOCKS + b);
+            adios_schedule_read (f, sel, varnames[var], s, 1, data);
+            adios_perform_reads (f, 1);
+            adios_selection_delete (sel);
+            for (i = 0; i < NX && !err; i++)
+            {
+                if (data[i] != value (var, s, writer, b, i))
+                {
+                    printf ("ERROR: rank %d: %s: %s step %d block %d [%d] = %g instead of %g\n",
+                            rank, param, varnames[var], s, writer * NBLOCKS + b, i,
+                            data[i], value (var, s, writer, b, i));
+                    err = 1;
+                }
+            }
+        }
+    }
+    return err;
+}
+
+int main (int argc, char ** argv)
+{
+    MPI_Comm comm = MPI_COMM_WORLD;
+    ADIOS_FILE * f, * ref;
+    int rank, size, p, k, var, err = 0, gerr;
+
+    MPI_Init (&argc, &argv);
+    MPI_Comm_rank (comm, &rank);
+    MPI_Comm_size (comm, &size);
+
+    adios_init_noxml (comm);
+    adios_set_max_buffer_size (10);
+    write_file (rank, size, comm);
+    adios_finalize (rank);
+
+    for (p = 0; p < NPARAMS; p++)
+    {
+        // the reference is read without parameters
+        adios_read_init_method (ADIOS_READ_METHOD_BP, comm, "");
+        ref = adios_read_open_file (FILENAME, ADIOS_READ_METHOD_BP, comm);
+        adios_read_finalize_method (ADIOS_READ_METHOD_BP);
+
+        adios_read_init_method (ADIOS_READ_METHOD_BP, comm, params[p]);
+        f = adios_read_open_file (FILENAME, ADIOS_READ_METHOD_BP, comm);
+        if (!f || !ref)
+        {
+            printf ("ERROR: rank %d: %s: cannot open %s: %s\n", rank, params[p], FILENAME,
+                    adios_errmsg ());
+            err = 1;
+        }
+        else
+        {
+            // odd ranks start with the local array
+            for (k = 0; k < NVARS && !err; k++)
+            {
+                var = (k + rank) % NVARS;
+                err = check_info (f, ref, varnames[var], params[p], rank);
+                err = err || check_values (f, var, (rank + 1) % size, params[p], rank);
+            }
+        }
+        // collective with shared_index
+        if (f)
+            adios_read_close (f);
+        if (ref)
+            adios_read_close (ref);
+        adios_read_finalize_method (ADIOS_READ_METHOD_BP);
+    }
+
+    MPI_Allreduce (&err, &gerr, 1, MPI_INT, MPI_MAX, comm);
+    if (rank == 0)
+        printf ("%s\n", gerr ? "FAILED" : "OK");
+
+    MPI_Finalize ();
+    return gerr;
+}
@@ -0,0 +1,161 @@
+/*
+ * ADIOS is freely available under the terms of the BSD license described
+ * in the COPYING file in the top level directory of this source distribution.
+ *
+ * Copyright (c) 2008 - 2009.  UT-BATTELLE, LLC. All rights reserved.
+ */
+
+/* Test of the collective reads of the BP_AGGREGATE read method.
+ *
+ * Every process writes NBLOCKS blocks of a 1D global array in each of NSTEPS
+ * steps, with the MPI method into one file and with MPI_AGGREGATE into
+ * subfiles. Then every process reads its own part of the array plus half a
+ * block of each neighbour, in all steps with one perform_reads, using
+ * NAGGR aggregators. The boxes of neighbours overlap, so pieces are requested
+ * by several groups of readers, and a small stripe_size and max_chunk_size
+ * make the aggregators read their domains in several cycles. Every value is
+ * checked.
+ *
+ * Usage: staged_read
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "mpi.h"
+#include "adios.h"
+#include "adios_read.h"
+
+#define NX 32768    // doubles per block, 256 KB
+#define NBLOCKS 4
+#define NSTEPS 2
+#define NAGGR 2
+
+static const char * methods[] = {"MPI", "MPI_AGGREGATE"};
+static const char * method_params[] = {"", "num_aggregators=2;num_ost=2"};
+#define NMETHODS 2
+
+static double value (int step, uint64_t i)
+{
+    return step * 1.0e8 + (double) i;
+}
+
+static void write_file (const char * fname, int m, int rank, int size, MPI_Comm comm)
+{
+    char group[64];
+    int64_t g, fh;
+    uint64_t total, gdim = (uint64_t) NX * NBLOCKS * size, ldim = NX, offs, i;
+    double * data = (double *) malloc (NX * sizeof (double));
+    int s, b;
+
+    sprintf (group, "staged_%s", methods[m]);
+    adios_declare_group (&g, group, "", adios_stat_default);
+    adios_select_method (g, methods[m], method_params[m], "");
+    adios_define_var (g, "gdim", "", adios_unsigned_long, "", "", "");
+    adios_define_var (g, "ldim", "", adios_unsigned_long, "", "", "");
+    adios_define_var (g, "offs", "", adios_unsigned_long, "", "", "");
+    adios_define_var (g, "data", "", adios_double, "ldim", "gdim", "offs");
+
+    for (s = 0; s < NSTEPS; s++)
+    {
+        adios_open (&fh, group, fname, (s ? "a" : "w"), comm);
+        adios_group_size (fh, 3 * sizeof (uint64_t) + NBLOCKS * NX * sizeof (double), &total);
+        adios_write (fh, "gdim", &gdim);
+        adios_write (fh, "ldim", &ldim);
+        for (b = 0; b < NBLOCKS; b++)
+        {
+            offs = ((uint64_t) rank * NBLOCKS + b) * NX;
+            for (i = 0; i < NX; i++)
+                data[i] = value (s, offs + i);
+            adios_write (fh, "offs", &offs);
+            adios_write (fh, "data", data);
+        }
+        adios_close (fh);
+    }
+    free (data);
+}
+
+static int read_file (const char * fname, int rank, int size, MPI_Comm comm)
+{
+    ADIOS_FILE * f;
+    ADIOS_SELECTION * sel;
+    uint64_t gdim = (uint64_t) NX * NBLOCKS * size, start, end, count, i;
+    double * data[NSTEPS];
+    int s, err = 0;
+
+    // own blocks and half a block of each neighbour
+    start = (uint64_t) rank * NBLOCKS * NX;
+    end = start + NBLOCKS * NX + NX / 2;
+    start = (rank > 0 ? start - NX / 2 : 0);
+    end = (end > gdim ? gdim : end);
+    count = end - start;
+
+    f = adios_read_open_file (fname, ADIOS_READ_METHOD_BP_AGGREGATE, comm);
+    if (!f)
+    {
+        printf ("ERROR: rank %d: cannot open %s: %s\n", rank, fname, adios_errmsg ());
+        return 1;
+    }
+
+    sel = adios_selection_boundingbox (1, &start, &count);
+    for (s = 0; s < NSTEPS; s++)
+    {
+        data[s] = (double *) calloc (count, sizeof (double));
+        adios_schedule_read (f, sel, "data", s, 1, data[s]);
+    }
+    adios_perform_reads (f, 1);
+
+    for (s = 0; s < NSTEPS; s++)
+    {
+        for (i = 0; i < count && !err; i++)
+        {
+            if (data[s][i] != value (s, start + i))
+            {
+                printf ("ERROR: rank %d: %s step %d data[%llu] = %g instead of %g\n",
+                        rank, fname, s, (unsigned long long) (start + i), data[s][i],
+                        value (s, start + i));
+                err = 1;
+            }
+        }
+        free (data[s]);
+    }
+    adios_selection_delete (sel);
+    adios_read_close (f);
+    return err;
+}
+
+int main (int argc, char ** argv)
+{
+    MPI_Comm comm = MPI_COMM_WORLD;
+    char fname[64], params[128];
+    int rank, size, m, err = 0, gerr;
+
+    MPI_Init (&argc, &argv);
+    MPI_Comm_rank (comm, &rank);
+    MPI_Comm_size (comm, &size);
+
+    adios_init_noxml (comm);
+    adios_set_max_buffer_size (10);
+    for (m = 0; m < NMETHODS; m++)
+    {
+        sprintf (fname, "staged_read_%s.bp", methods[m]);
+        write_file (fname, m, rank, size, comm);
+    }
+    adios_finalize (rank);
+
+    // 64 KB stripes and 1 MB cycles, with 1 MB of data per process and step
+    sprintf (params, "num_aggregators=%d;max_chunk_size=1;stripe_size=65536", NAGGR);
+    adios_read_init_method (ADIOS_READ_METHOD_BP_AGGREGATE, comm, params);
+    for (m = 0; m < NMETHODS; m++)
+    {
+        sprintf (fname, "staged_read_%s.bp", methods[m]);
+        err |= read_file (fname, rank, size, comm);
+    }
+    adios_read_finalize_method (ADIOS_READ_METHOD_BP_AGGREGATE);
+
+    MPI_Allreduce (&err, &gerr, 1, MPI_INT, MPI_MAX, comm);
+    if (rank == 0)
+        printf ("%s\n", gerr ? "FAILED" : "OK");
+
+    MPI_Finalize ();
+    return gerr;
+}
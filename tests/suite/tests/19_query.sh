@@ -129,10 +129,11 @@ function invoke_dataset_builder() {
   local DSID="$1"
   local DSOUTPUT="$2"
   local TRANSFORM_ARG="$3"
-  [[ $# -eq 3 ]] || die "ERROR: Internal testing error, invalid parameters to invoke_dataset_builder: $@"
+  local INDEX_ARG="${4:-none}"
+  [[ $# -eq 3 || $# -eq 4 ]] || die "ERROR: Internal testing error, invalid parameters to invoke_dataset_builder: $@"
   
   set -o xtrace
-  $MPIRUN_SERIAL $DATASET_BUILDER_EXE_LOCAL "$DSID" "$DSOUTPUT" "$TRANSFORM_ARG" ||
+  $MPIRUN_SERIAL $DATASET_BUILDER_EXE_LOCAL "$DSID" "$DSOUTPUT" "$TRANSFORM_ARG" "$INDEX_ARG" ||
     die "ERROR: $DATASET_BUILDER_EXE_LOCAL failed with exit code $? (on dataset $DSID, outputting to $DSOUTPUT, using transform argument $TRANSFORM_ARG)"
   set +o xtrace
   
@@ -181,6 +182,16 @@ function build_indexed_datasets_minmax() {
   echo "Minmax method uses data as is, no index file is built"
 }
 
+function build_indexed_datasets_bitmap() {
+  local DSID="$1"
+  local DSOUTPUT="$2"
+  [[ $# -eq 2 ]] || die "ERROR: Internal testing error, invalid parameters to build_indexed_datasets_bitmap: $@"
+  
+  # The bitmap index is built at write time into $DSOUTPUT.<config>.bp.idx
+  invoke_dataset_builder "$DSID" "$DSOUTPUT.bins64" "none" "bitmap"
+  invoke_dataset_builder "$DSID" "$DSOUTPUT.bins5" "none" "bitmap:bins=5"
+}
+
 function build_datasets() {
   echo "STEP 2: INDEXING ALL TEST DATASETS USING ALL ENABLED INDEXING METHODS"
   echo "(ALSO PRODUCING A NON-INDEXED VERSION OF EACH DATASET FOR REFERENCE)"
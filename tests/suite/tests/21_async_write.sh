@@ -0,0 +1,36 @@
+#!/bin/bash
+#
+# Test the "async" parameter of the POSIX and MPI write methods:
+# several steps written and appended in the background, then read back.
+# Uses ../programs/async_write
+#
+# Environment variables set by caller:
+# MPIRUN        Run command
+# NP_MPIRUN     Run commands option to set number of processes
+# MAXPROCS      Max number of processes allowed
+# HAVE_FORTRAN  yes or no
+# SRCDIR        Test source dir (.. of this script)
+# TRUNKDIR      ADIOS trunk dir
+
+PROCS=3
+
+if [ $MAXPROCS -lt $PROCS ]; then
+    echo "WARNING: Needs $PROCS processes at least"
+    exit 77  # not failure, just skip
+fi
+
+# copy codes and inputs to . 
+cp $SRCDIR/programs/async_write .
+
+echo "Run async_write"
+$MPIRUN $NP_MPIRUN $PROCS $EXEOPT ./async_write
+EX=$?
+if [ ! -f async_write_POSIX.bp ] || [ ! -f async_write_MPI.bp ]; then
+    echo "ERROR: async_write failed at creating the BP files. Exit code=$EX"
+    exit 1
+fi
+
+if [ $EX != 0 ]; then
+    echo "ERROR: async_write failed with exit code=$EX"
+    exit 1
+fi
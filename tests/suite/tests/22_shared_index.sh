@@ -0,0 +1,36 @@
+#!/bin/bash
+#
+# Test the "shared_index" parameter of the BP read method, with and without
+# lazy_index, against the index read by every process.
+# Uses ../programs/shared_index
+#
+# Environment variables set by caller:
+# MPIRUN        Run command
+# NP_MPIRUN     Run commands option to set number of processes
+# MAXPROCS      Max number of processes allowed
+# HAVE_FORTRAN  yes or no
+# SRCDIR        Test source dir (.. of this script)
+# TRUNKDIR      ADIOS trunk dir
+
+PROCS=4
+
+if [ $MAXPROCS -lt $PROCS ]; then
+    echo "WARNING: Needs $PROCS processes at least"
+    exit 77  # not failure, just skip
+fi
+
+# copy codes and inputs to . 
+cp $SRCDIR/programs/shared_index .
+
+echo "Run shared_index"
+$MPIRUN $NP_MPIRUN $PROCS $EXEOPT ./shared_index
+EX=$?
+if [ ! -f shared_index.bp ]; then
+    echo "ERROR: shared_index failed at creating the BP file. Exit code=$EX"
+    exit 1
+fi
+
+if [ $EX != 0 ]; then
+    echo "ERROR: shared_index failed with exit code=$EX"
+    exit 1
+fi
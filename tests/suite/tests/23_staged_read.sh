@@ -0,0 +1,36 @@
+#!/bin/bash
+#
+# Test the collective reads of the BP_AGGREGATE read method with several
+# aggregators, small stripes and several read cycles.
+# Uses ../programs/staged_read
+#
+# Environment variables set by caller:
+# MPIRUN        Run command
+# NP_MPIRUN     Run commands option to set number of processes
+# MAXPROCS      Max number of processes allowed
+# HAVE_FORTRAN  yes or no
+# SRCDIR        Test source dir (.. of this script)
+# TRUNKDIR      ADIOS trunk dir
+
+PROCS=4
+
+if [ $MAXPROCS -lt $PROCS ]; then
+    echo "WARNING: Needs $PROCS processes at least"
+    exit 77  # not failure, just skip
+fi
+
+# copy codes and inputs to . 
+cp $SRCDIR/programs/staged_read .
+
+echo "Run staged_read"
+$MPIRUN $NP_MPIRUN $PROCS $EXEOPT ./staged_read
+EX=$?
+if [ ! -f staged_read_MPI.bp ] || [ ! -f staged_read_MPI_AGGREGATE.bp ]; then
+    echo "ERROR: staged_read failed at creating the BP files. Exit code=$EX"
+    exit 1
+fi
+
+if [ $EX != 0 ]; then
+    echo "ERROR: staged_read failed with exit code=$EX"
+    exit 1
+fi
@@ -0,0 +1,36 @@
+#!/bin/bash
+#
+# Test appending steps of different sizes per process with the MPI_AGGREGATE
+# method: the number of subfiles must not change, and the data is read back.
+# Uses ../programs/aggregate_append
+#
+# Environment variables set by caller:
+# MPIRUN        Run command
+# NP_MPIRUN     Run commands option to set number of processes
+# MAXPROCS      Max number of processes allowed
+# HAVE_FORTRAN  yes or no
+# SRCDIR        Test source dir (.. of this script)
+# TRUNKDIR      ADIOS trunk dir
+
+PROCS=4
+
+if [ $MAXPROCS -lt $PROCS ]; then
+    echo "WARNING: Needs $PROCS processes at least"
+    exit 77  # not failure, just skip
+fi
+
+# copy codes and inputs to . 
+cp $SRCDIR/programs/aggregate_append .
+
+echo "Run aggregate_append"
+$MPIRUN $NP_MPIRUN $PROCS $EXEOPT ./aggregate_append
+EX=$?
+if [ ! -f aggregate_append_0.bp ] || [ ! -f aggregate_append_1.bp ]; then
+    echo "ERROR: aggregate_append failed at creating the BP files. Exit code=$EX"
+    exit 1
+fi
+
+if [ $EX != 0 ]; then
+    echo "ERROR: aggregate_append failed with exit code=$EX"
+    exit 1
+fi
@@ -0,0 +1,36 @@
+#!/bin/bash
+#
+# Test the tree reduction of the index in the MPI method: index_fanin=2
+# against the index gathered by rank 0 in one round.
+# Uses ../programs/index_fanin
+#
+# Environment variables set by caller:
+# MPIRUN        Run command
+# NP_MPIRUN     Run commands option to set number of processes
+# MAXPROCS      Max number of processes allowed
+# HAVE_FORTRAN  yes or no
+# SRCDIR        Test source dir (.. of this script)
+# TRUNKDIR      ADIOS trunk dir
+
+PROCS=5
+
+if [ $MAXPROCS -lt $PROCS ]; then
+    echo "WARNING: Needs $PROCS processes at least"
+    exit 77  # not failure, just skip
+fi
+
+# copy codes and inputs to . 
+cp $SRCDIR/programs/index_fanin .
+
+echo "Run index_fanin"
+$MPIRUN $NP_MPIRUN $PROCS $EXEOPT ./index_fanin
+EX=$?
+if [ ! -f index_fanin_2.bp ] || [ ! -f index_fanin_flat.bp ]; then
+    echo "ERROR: index_fanin failed at creating the BP files. Exit code=$EX"
+    exit 1
+fi
+
+if [ $EX != 0 ]; then
+    echo "ERROR: index_fanin failed with exit code=$EX"
+    exit 1
+fi
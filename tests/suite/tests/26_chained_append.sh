@@ -0,0 +1,36 @@
+#!/bin/bash
+#
+# Test appending with the MPI, MPI_LUSTRE and MPI_AGGREGATE methods to a
+# file with a chained index written by the POSIX method.
+# Uses ../programs/chained_append
+#
+# Environment variables set by caller:
+# MPIRUN        Run command
+# NP_MPIRUN     Run commands option to set number of processes
+# MAXPROCS      Max number of processes allowed
+# HAVE_FORTRAN  yes or no
+# SRCDIR        Test source dir (.. of this script)
+# TRUNKDIR      ADIOS trunk dir
+
+PROCS=4
+
+if [ $MAXPROCS -lt $PROCS ]; then
+    echo "WARNING: Needs $PROCS processes at least"
+    exit 77  # not failure, just skip
+fi
+
+# copy codes and inputs to . 
+cp $SRCDIR/programs/chained_append .
+
+echo "Run chained_append"
+$MPIRUN $NP_MPIRUN $PROCS $EXEOPT ./chained_append
+EX=$?
+if [ ! -f chained_append_MPI.bp ]; then
+    echo "ERROR: chained_append failed at creating the BP file. Exit code=$EX"
+    exit 1
+fi
+
+if [ $EX != 0 ]; then
+    echo "ERROR: chained_append failed with exit code=$EX"
+    exit 1
+fi
@@ -0,0 +1,291 @@
+/*
+ * ADIOS is freely available under the terms of the BSD license described
+ * in the COPYING file in the top level directory of this source distribution.
+ *
+ * Copyright (c) 2008 - 2009.  UT-BATTELLE, LLC. All rights reserved.
+ */
+
+/* ADIOS test: appending steps with a chained index (POSIX method, index=chained).
+ *
+ * The same steps (scalars, an array and an attribute) are written to one file
+ * with the default index, which is merged and rewritten at every step, and to
+ * another file whose first step is written with the default index and the
+ * others are appended with a chained index. The close time of the first and
+ * last steps are printed. With the chained index, every appended step must add
+ * the same number of bytes to the file and leave the previous footer in place.
+ * Both files are read back and all values are checked.
+ *
+ * How to run: append_chained_index [number of steps]
+ * Output: append_merged_index.bp, append_chained_index.bp, timings,
+ *         non-zero exit code on mismatch
+ *
+ * This is a sequential test.
+ */
+#ifndef _NOMPI
+#define _NOMPI
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <inttypes.h>
+#include <string.h>
+#include <sys/time.h>
+#include <sys/stat.h>
+#include "public/adios.h"
+#include "public/adios_read.h"
+
+#define NVARS 50
+#define NX 16
+
+static const char MERGED_FILE[] = "append_merged_index.bp";
+static const char CHAINED_FILE[] = "append_chained_index.bp";
+
+static double now ()
+{
+    struct timeval tp;
+    gettimeofday (&tp, NULL);
+    return (double) tp.tv_sec + (double) tp.tv_usec * 1.0e-6;
+}
+
+static uint64_t file_size (const char *name)
+{
+    struct stat s;
+    if (stat (name, &s))
+        return 0;
+    return (uint64_t) s.st_size;
+}
+
+/* Read the FOOTER bytes in front of offset 'end' */
+#define FOOTER 64
+static int read_footer (const char *name, uint64_t end, char *buf)
+{
+    FILE *f = fopen (name, "rb");
+    int n = 0;
+    if (f)
+    {
+        if (!fseek (f, (long) (end - FOOTER), SEEK_SET))
+            n = fread (buf, 1, FOOTER, f);
+        fclose (f);
+    }
+    return (n == FOOTER ? 0 : 1);
+}
+
+static int value (int step, int k)
+{
+    return step * 1000 + k;
+}
+
+/* Write steps [first, last) of the file with the given POSIX parameters.
+ * growth[s] is set to the size the file grew by at step s and tclose[s]
+ * to the time spent in adios_close(). Returns the number of steps that
+ * overwrote the footer of the previous step. */
+static int write_steps (const char *filename, const char *params, int first, int last,
+                        uint64_t *growth, double *tclose)
+{
+    char footer[FOOTER], prev_footer[FOOTER];
+    int noverwritten = 0;
+    int64_t group, fh;
+    int64_t ids[NVARS], aid;
+    char name[32];
+    double a[NX];
+    int k, s, i;
+
+    adios_init_noxml (MPI_COMM_SELF);
+    adios_declare_group (&group, "steps", "", adios_stat_default);
+    adios_select_method (group, "POSIX", params, "");
+    for (k = 0; k < NVARS; k++)
+    {
+        sprintf (name, "v%02d", k);
+        ids[k] = adios_define_var (group, name, "/scalars", adios_integer, "", "", "");
+    }
+    aid = adios_define_var (group, "a", "", adios_double, "16", "16", "0");
+    adios_define_attribute (group, "desc", "/a", adios_string, "test array", "");
+
+    for (s = first; s < last; s++)
+    {
+        uint64_t size = (s ? file_size (filename) : 0);
+        double t;
+
+        if (s == first && s)
+            read_footer (filename, size, prev_footer);
+
+        adios_open (&fh, "steps", filename, (s ? "a" : "w"), MPI_COMM_SELF);
+        for (k = 0; k < NVARS; k++)
+        {
+            int v = value (s, k);
+            adios_write_byid (fh, ids[k], &v);
+        }
+        for (i = 0; i < NX; i++)
+            a[i] = s + 0.01 * i;
+        adios_write_byid (fh, aid, a);
+        t = now ();
+        adios_close (fh);
+        tclose[s] = now () - t;
+        growth[s] = file_size (filename) - size;
+
+        if (s && (read_footer (filename, size, footer) || memcmp (footer, prev_footer, FOOTER)))
+            noverwritten++;
+        read_footer (filename, size + growth[s], prev_footer);
+    }
+    adios_finalize (0);
+    return noverwritten;
+}
+
+static int check_file (const char *filename, int nsteps)
+{
+    ADIOS_FILE *f;
+    ADIOS_VARINFO *vi;
+    ADIOS_SELECTION *sel;
+    uint64_t start = 0, count = NX;
+    double *a;
+    int *v;
+    char name[32];
+    int k, s, i, err = 0;
+
+    f = adios_read_open_file (filename, ADIOS_READ_METHOD_BP, MPI_COMM_SELF);
+    if (!f)
+    {
+        printf ("ERROR: cannot open %s: %s\n", filename, adios_errmsg ());
+        return 1;
+    }
+    if (f->last_step + 1 != nsteps || f->nvars < NVARS + 1 || f->nattrs < 1)
+    {
+        printf ("ERROR: %s has %d steps, %d variables and %d attributes\n",
+                filename, f->last_step + 1, f->nvars, f->nattrs);
+        adios_read_close (f);
+        return 1;
+    }
+
+    v = (int *) malloc (nsteps * sizeof (int));
+    a = (double *) malloc (nsteps * NX * sizeof (double));
+    for (k = 0; k < NVARS && !err; k++)
+    {
+        sprintf (name, "/scalars/v%02d", k);
+        vi = adios_inq_var (f, name);
+        if (!vi || vi->nsteps != nsteps)
+        {
+            printf ("ERROR: %s: variable %s is missing or has the wrong number of steps\n",
+                    filename, name);
+            err = 1;
+            break;
+        }
+        adios_free_varinfo (vi);
+        adios_schedule_read (f, NULL, name, 0, nsteps, v);
+        adios_perform_reads (f, 1);
+        for (s = 0; s < nsteps; s++)
+        {
+            if (v[s] != value (s, k))
+            {
+                printf ("ERROR: %s: %s at step %d is %d instead of %d\n",
+                        filename, name, s, v[s], value (s, k));
+                err = 1;
+                break;
+            }
+        }
+    }
+
+    sel = adios_selection_boundingbox (1, &start, &count);
+    adios_schedule_read (f, sel, "a", 0, nsteps, a);
+    adios_perform_reads (f, 1);
+    adios_selection_delete (sel);
+    for (s = 0; s < nsteps && !err; s++)
+    {
+        for (i = 0; i < NX; i++)
+        {
+            if (a[s * NX + i] != s + 0.01 * i)
+            {
+                printf ("ERROR: %s: a[%d] at step %d is %g\n", filename, i, s, a[s * NX + i]);
+                err = 1;
+                break;
+            }
+        }
+    }
+
+    if (!err)
+    {
+        enum ADIOS_DATATYPES type;
+        int size;
+        void *data;
+        if (adios_get_attr (f, "/a/desc", &type, &size, &data) || strcmp ((char *) data, "test array"))
+        {
+            printf ("ERROR: %s: attribute /a/desc is missing or wrong\n", filename);
+            err = 1;
+        }
+        else
+        {
+            free (data);
+        }
+    }
+
+    free (v);
+    free (a);
+    adios_read_close (f);
+    return err;
+}
+
+static void print_steps (const char *label, int nsteps, const uint64_t *growth, const double *tclose)
+{
+    printf ("  %-8s step 1: %6" PRIu64 " bytes %.6f s,  step %d: %6" PRIu64 " bytes %.6f s\n",
+            label, growth[1], tclose[1], nsteps - 1, growth[nsteps - 1], tclose[nsteps - 1]);
+}
+
+int main (int argc, char ** argv)
+{
+    int nsteps = 300, s, noverwritten, err = 0;
+    uint64_t *growth;
+    double *tclose;
+
+    if (argc > 1)
+    {
+        nsteps = atoi (argv[1]);
+    }
+    if (nsteps < 3)
+    {
+        printf ("ERROR: number of steps must be at least 3\n");
+        return 1;
+    }
+
+    growth = (uint64_t *) malloc (nsteps * sizeof (uint64_t));
+    tclose = (double *) malloc (nsteps * sizeof (double));
+
+    printf ("Appending %d steps, file growth and close time:\n", nsteps);
+    noverwritten = write_steps (MERGED_FILE, "", 0, nsteps, growth, tclose);
+    print_steps ("merged", nsteps, growth, tclose);
+    printf ("  merged:  %d steps rewrote the previous index\n", noverwritten);
+
+    // the first step has a complete index, the chain starts from it
+    write_steps (CHAINED_FILE, "", 0, 1, growth, tclose);
+    noverwritten = write_steps (CHAINED_FILE, "index=chained", 1, nsteps, growth, tclose);
+    print_steps ("chained", nsteps, growth, tclose);
+    printf ("  chained: %d steps rewrote the previous index\n", noverwritten);
+    if (noverwritten)
+    {
+        printf ("ERROR: appending with a chained index overwrote the previous footer\n");
+        err = 1;
+    }
+    for (s = 2; s < nsteps && !err; s++)
+    {
+        if (growth[s] != growth[1])
+        {
+            printf ("ERROR: step %d added %" PRIu64 " bytes to %s, step 1 added %" PRIu64 "\n",
+                    s, growth[s], CHAINED_FILE, growth[1]);
+            err = 1;
+        }
+    }
+
+    adios_read_init_method (ADIOS_READ_METHOD_BP, MPI_COMM_SELF, "");
+    if (!err)
+        err = check_file (MERGED_FILE, nsteps);
+    if (!err)
+        err = check_file (CHAINED_FILE, nsteps);
+    adios_read_finalize_method (ADIOS_READ_METHOD_BP);
+
+    free (growth);
+    free (tclose);
+    if (err)
+        printf ("FAILED\n");
+    else
+        printf ("OK\n");
+    return err;
+}
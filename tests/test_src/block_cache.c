@@ -0,0 +1,408 @@
+/*
+ * ADIOS is freely available under the terms of the BSD license described
+ * in the COPYING file in the top level directory of this source distribution.
+ *
+ * Copyright (c) 2008 - 2009.  UT-BATTELLE, LLC. All rights reserved.
+ */
+
+/* ADIOS test: cache of decoded blocks of transformed variables.
+ *
+ * Write NSTEPS steps of an N x N array of doubles in NB x NB blocks with
+ * the zlib transform, then read overlapping subvolumes and check the values
+ * and the hit/miss counters of the block cache:
+ *   - the same box twice, then again after reopening the file
+ *   - the same steps as a stream, and a writeblock
+ *   - a cache smaller than the array, which evicts blocks
+ *   - with the cache off, the counters do not change
+ *   - a file rewritten with other values of the same size is not served
+ *     from the blocks of the old file, a step appended to it keeps them
+ * The time of reading the whole array REPEAT times is printed with the
+ * cache off and on.
+ *
+ * How to run: block_cache [N]
+ * Output: block_cache.bp, block_cache_rewrite.bp, timings, non-zero exit code on mismatch
+ *
+ * This is a sequential test.
+ */
+#ifndef _NOMPI
+#define _NOMPI
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <sys/time.h>
+#include <sys/stat.h>
+#include "public/adios.h"
+#include "public/adios_read.h"
+#include "public/adios_read_ext.h"
+
+#define NB 4
+#define NSTEPS 2
+#define REPEAT 5
+
+static const char FILENAME[] = "block_cache.bp";
+static const char REWRITTEN[] = "block_cache_rewrite.bp";
+#define NREWRITE 4096
+
+static double now ()
+{
+    struct timeval tp;
+    gettimeofday (&tp, NULL);
+    return (double) tp.tv_sec + (double) tp.tv_usec * 1.0e-6;
+}
+
+static double value (int step, uint64_t i, uint64_t j, uint64_t n)
+{
+    return step * 1.0e8 + (double) (i * n + j);
+}
+
+static void write_file (uint64_t n)
+{
+    int64_t group, fh, varid;
+    uint64_t ldim = n / NB, off1, off2, i, j;
+    double * block = (double *) malloc (ldim * ldim * sizeof (double));
+    int s, b1, b2;
+
+    adios_declare_group (&group, "cache", "", adios_stat_no);
+    adios_select_method (group, "POSIX", "", "");
+    adios_define_var (group, "n", "", adios_unsigned_long, "", "", "");
+    adios_define_var (group, "ldim", "", adios_unsigned_long, "", "", "");
+    adios_define_var (group, "off1", "", adios_unsigned_long, "", "", "");
+    adios_define_var (group, "off2", "", adios_unsigned_long, "", "", "");
+    varid = adios_define_var (group, "data", "", adios_double, "ldim,ldim", "n,n", "off1,off2");
+    adios_set_transform (varid, "zlib");
+
+    for (s = 0; s < NSTEPS; s++)
+    {
+        adios_open (&fh, "cache", FILENAME, (s ? "a" : "w"), MPI_COMM_SELF);
+        adios_write (fh, "n", &n);
+        adios_write (fh, "ldim", &ldim);
+        for (b1 = 0; b1 < NB; b1++)
+        {
+            for (b2 = 0; b2 < NB; b2++)
+            {
+                off1 = b1 * ldim;
+                off2 = b2 * ldim;
+                for (i = 0; i < ldim; i++)
+                    for (j = 0; j < ldim; j++)
+                        block [i * ldim + j] = value (s, off1 + i, off2 + j, n);
+                adios_write (fh, "off1", &off1);
+                adios_write (fh, "off2", &off2);
+                adios_write (fh, "data", block);
+            }
+        }
+        adios_close (fh);
+    }
+    free (block);
+}
+
+/* Read a box of step s and check it */
+static int read_box (ADIOS_FILE * f, int s, int from_steps, uint64_t * start, uint64_t * count,
+                     uint64_t n, const char * how)
+{
+    ADIOS_SELECTION * sel = adios_selection_boundingbox (2, start, count);
+    double * data = (double *) calloc (count[0] * count[1], sizeof (double));
+    uint64_t i, j;
+    int err = 0;
+
+    adios_schedule_read (f, sel, "data", from_steps, 1, data);
+    adios_perform_reads (f, 1);
+    adios_selection_delete (sel);
+
+    for (i = 0; i < count[0] && !err; i++)
+    {
+        for (j = 0; j < count[1] && !err; j++)
+        {
+            double expected = value (s, start[0] + i, start[1] + j, n);
+            if (data [i * count[1] + j] != expected)
+            {
+                printf ("ERROR: %s: step %d (%llu,%llu) = %g instead of %g\n", how, s,
+                        (unsigned long long) (start[0] + i), (unsigned long long) (start[1] + j),
+                        data [i * count[1] + j], expected);
+                err = 1;
+            }
+        }
+    }
+    free (data);
+    return err;
+}
+
+/* Check the counters since the last call */
+static int check_stats (uint64_t hits, uint64_t misses, const char * how)
+{
+    ADIOS_BLOCK_CACHE_STATS stats;
+    adios_read_get_block_cache_stats (&stats);
+    adios_read_reset_block_cache_stats ();
+    if (stats.hits != hits || stats.misses != misses)
+    {
+        printf ("ERROR: %s: %llu hits and %llu misses instead of %llu and %llu\n", how,
+                (unsigned long long) stats.hits, (unsigned long long) stats.misses,
+                (unsigned long long) hits, (unsigned long long) misses);
+        return 1;
+    }
+    return 0;
+}
+
+static int test_cache (uint64_t n)
+{
+    ADIOS_FILE * f;
+    ADIOS_SELECTION * wb;
+    ADIOS_BLOCK_CACHE_STATS stats;
+    uint64_t ldim = n / NB;
+    uint64_t start[2] = {ldim - 4, ldim / 2}, count[2] = {ldim + 8, 2 * ldim};
+    uint64_t start2[2] = {ldim + 1, ldim + 1}, count2[2] = {ldim / 2, ldim / 2};
+    uint64_t all[2] = {0, 0}, whole[2] = {n, n};
+    double * data = (double *) malloc (ldim * ldim * sizeof (double));
+    uint64_t i;
+    int err = 0;
+
+    adios_read_set_block_cache (64*1024*1024);
+    adios_read_reset_block_cache_stats ();
+
+    // 3 x 3 blocks, then the same box again, then a box within it
+    f = adios_read_open_file (FILENAME, ADIOS_READ_METHOD_BP, MPI_COMM_SELF);
+    err = read_box (f, 0, 0, start, count, n, "first read");
+    err = err || check_stats (0, 9, "first read");
+    err = err || read_box (f, 0, 0, start, count, n, "second read");
+    err = err || check_stats (9, 0, "second read");
+    err = err || read_box (f, 1, 1, start2, count2, n, "step 1");
+    err = err || check_stats (0, 1, "step 1");
+    adios_read_close (f);
+
+    // the blocks are found again after reopening the file
+    f = adios_read_open_file (FILENAME, ADIOS_READ_METHOD_BP, MPI_COMM_SELF);
+    err = err || read_box (f, 0, 0, start2, count2, n, "reopened");
+    err = err || check_stats (1, 0, "reopened");
+    adios_read_close (f);
+
+    // and in streaming mode, where the steps are relative to the current step
+    f = adios_read_open (FILENAME, ADIOS_READ_METHOD_BP, MPI_COMM_SELF, ADIOS_LOCKMODE_NONE, 0.0);
+    err = err || read_box (f, 0, 0, start2, count2, n, "stream step 0");
+    err = err || check_stats (1, 0, "stream step 0");
+    if (!err && adios_advance_step (f, 0, 0.0))
+    {
+        printf ("ERROR: cannot advance to step 1: %s\n", adios_errmsg ());
+        err = 1;
+    }
+    err = err || read_box (f, 1, 0, start2, count2, n, "stream step 1");
+    err = err || check_stats (1, 0, "stream step 1");
+
+    // block 5 of step 1 is (1,1)
+    wb = adios_selection_writeblock (5);
+    adios_schedule_read (f, wb, "data", 0, 1, data);
+    adios_perform_reads (f, 1);
+    adios_selection_delete (wb);
+    for (i = 0; i < ldim * ldim && !err; i++)
+    {
+        if (data [i] != value (1, ldim + i / ldim, ldim + i % ldim, n))
+        {
+            printf ("ERROR: writeblock 5 [%llu] = %g\n", (unsigned long long) i, data [i]);
+            err = 1;
+        }
+    }
+    err = err || check_stats (1, 0, "writeblock");
+    adios_read_close (f);
+
+    // room for 2 blocks only
+    adios_read_set_block_cache (2 * ldim * ldim * sizeof (double));
+    f = adios_read_open_file (FILENAME, ADIOS_READ_METHOD_BP, MPI_COMM_SELF);
+    err = err || read_box (f, 0, 0, all, whole, n, "small cache");
+    adios_read_get_block_cache_stats (&stats);
+    if (!err && (stats.nblocks != 2 || stats.evictions < NB * NB - 2))
+    {
+        printf ("ERROR: small cache holds %llu blocks after %llu evictions\n",
+                (unsigned long long) stats.nblocks, (unsigned long long) stats.evictions);
+        err = 1;
+    }
+    adios_read_reset_block_cache_stats ();
+
+    // off
+    adios_read_set_block_cache (0);
+    err = err || read_box (f, 0, 0, start, count, n, "cache off");
+    err = err || check_stats (0, 0, "cache off");
+    adios_read_close (f);
+
+    free (data);
+    return err;
+}
+
+/* Random bytes, so that zlib cannot compress them and every version of the
+   file has the same size */
+static void write_random (int seed, const char * mode)
+{
+    int64_t group, fh, varid;
+    uint64_t data[NREWRITE], x = seed;
+    int i;
+
+    for (i = 0; i < NREWRITE; i++)
+    {
+        x = x * 6364136223846793005ULL + 1442695040888963407ULL;
+        data[i] = x;
+    }
+    adios_declare_group (&group, "rewrite", "", adios_stat_no);
+    adios_select_method (group, "POSIX", "", "");
+    varid = adios_define_var (group, "r", "", adios_unsigned_long, "4096", "4096", "0");
+    adios_set_transform (varid, "zlib");
+    adios_open (&fh, "rewrite", REWRITTEN, mode, MPI_COMM_SELF);
+    adios_write (fh, "r", data);
+    adios_close (fh);
+}
+
+static int read_random (int seed, int step, const char * how)
+{
+    ADIOS_FILE * f;
+    ADIOS_SELECTION * sel;
+    uint64_t data[NREWRITE], x = seed, start = 0, count = NREWRITE;
+    int i;
+
+    f = adios_read_open_file (REWRITTEN, ADIOS_READ_METHOD_BP, MPI_COMM_SELF);
+    if (!f)
+    {
+        printf ("ERROR: %s: cannot open %s: %s\n", how, REWRITTEN, adios_errmsg ());
+        return 1;
+    }
+    memset (data, 0, sizeof (data));
+    sel = adios_selection_boundingbox (1, &start, &count);
+    adios_schedule_read (f, sel, "r", step, 1, data);
+    adios_perform_reads (f, 1);
+    adios_selection_delete (sel);
+    adios_read_close (f);
+    for (i = 0; i < NREWRITE; i++)
+    {
+        x = x * 6364136223846793005ULL + 1442695040888963407ULL;
+        if (data[i] != x)
+        {
+            printf ("ERROR: %s: r[%d] is not the value written with seed %d\n", how, i, seed);
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/* Rewrite a file between two reads, then append a step to it */
+static int test_rewrite ()
+{
+    struct stat st1, st2;
+    int err;
+
+    adios_init_noxml (MPI_COMM_SELF);
+    write_random (1, "w");
+    adios_finalize (0);
+    stat (REWRITTEN, &st1);
+
+    adios_read_set_block_cache (64*1024*1024);
+    adios_read_reset_block_cache_stats ();
+    err = read_random (1, 0, "before rewrite");
+    err = err || check_stats (0, 1, "before rewrite");
+
+    adios_init_noxml (MPI_COMM_SELF);
+    write_random (2, "w");
+    adios_finalize (0);
+    stat (REWRITTEN, &st2);
+    if (!err && st1.st_size != st2.st_size)
+    {
+        printf ("ERROR: the rewritten file has %lld bytes instead of %lld\n",
+                (long long) st2.st_size, (long long) st1.st_size);
+        err = 1;
+    }
+
+    err = err || read_random (2, 0, "after rewrite");
+    err = err || check_stats (0, 1, "after rewrite");
+    err = err || read_random (2, 0, "after rewrite, again");
+    err = err || check_stats (1, 0, "after rewrite, again");
+
+    // the blocks of step 0 do not move when a step is appended
+    adios_init_noxml (MPI_COMM_SELF);
+    write_random (3, "a");
+    adios_finalize (0);
+    err = err || read_random (2, 0, "after append");
+    err = err || check_stats (1, 0, "after append");
+    err = err || read_random (3, 1, "appended step");
+    err = err || check_stats (0, 1, "appended step");
+    adios_read_set_block_cache (0);
+    return err;
+}
+
+static double read_whole (uint64_t n, uint64_t cache_size)
+{
+    ADIOS_FILE * f;
+    uint64_t start[2] = {0, 0}, count[2] = {n, n};
+    double t = now ();
+    int k;
+
+    adios_read_set_block_cache (cache_size);
+    for (k = 0; k < REPEAT; k++)
+    {
+        f = adios_read_open_file (FILENAME, ADIOS_READ_METHOD_BP, MPI_COMM_SELF);
+        read_box (f, 0, 0, start, count, n, "whole array");
+        adios_read_close (f);
+    }
+    adios_read_set_block_cache (0);
+    return now () - t;
+}
+
+int main (int argc, char ** argv)
+{
+    uint64_t n = 1024;
+    ADIOS_FILE * f;
+    ADIOS_VARINFO * vi;
+    ADIOS_VARTRANSFORM * ti;
+    double t_off, t_on;
+    int transformed, err;
+
+    if (argc > 1)
+    {
+        n = atoi (argv[1]);
+    }
+    if (n < NB * 4)
+    {
+        printf ("ERROR: N must be at least %d\n", NB * 4);
+        return 1;
+    }
+    n = n / NB * NB;
+
+    adios_init_noxml (MPI_COMM_SELF);
+    write_file (n);
+    adios_finalize (0);
+
+    adios_read_init_method (ADIOS_READ_METHOD_BP, MPI_COMM_SELF, "");
+
+    // only transformed variables are cached
+    f = adios_read_open_file (FILENAME, ADIOS_READ_METHOD_BP, MPI_COMM_SELF);
+    vi = adios_inq_var (f, "data");
+    ti = adios_inq_var_transform (f, vi);
+    transformed = (ti && ti->transform_type != NO_TRANSFORM);
+    adios_free_var_transform (ti);
+    adios_free_varinfo (vi);
+    adios_read_close (f);
+
+    if (!transformed)
+    {
+        printf ("zlib transform is not available, skipped\n");
+        err = 0;
+    }
+    else
+    {
+        printf ("Read subvolumes of a %llu x %llu array in %d x %d zlib blocks\n",
+                (unsigned long long) n, (unsigned long long) n, NB, NB);
+        err = test_cache (n);
+        err = err || test_rewrite ();
+        if (!err)
+        {
+            t_off = read_whole (n, 0);
+            t_on = read_whole (n, 256*1024*1024);
+            printf ("  whole array %d times, no cache:  %.3f s\n", REPEAT, t_off);
+            printf ("  whole array %d times, cache:     %.3f s\n", REPEAT, t_on);
+        }
+    }
+
+    adios_read_finalize_method (ADIOS_READ_METHOD_BP);
+
+    if (err)
+        printf ("FAILED\n");
+    else
+        printf ("OK\n");
+    return err;
+}
@@ -0,0 +1,198 @@
+/*
+ * ADIOS is freely available under the terms of the BSD license described
+ * in the COPYING file in the top level directory of this source distribution.
+ *
+ * Copyright (c) 2008 - 2009.  UT-BATTELLE, LLC. All rights reserved.
+ */
+
+/* ADIOS test: reuse of the data buffer across adios_open()...adios_close().
+ *
+ * Write NSTEPS steps of NVARS arrays, larger than the default buffer so that
+ * the buffer grows during the first step, then read back and check all steps.
+ * This is done with malloc'ed buffers, with huge pages and with huge pages
+ * and a buffer allocated in advance with adios_set_buffer_options().
+ * The time of the first and of the later steps is printed for each.
+ *
+ * How to run: buffer_reuse [MB per variable]
+ * Output: buffer_reuse_[012].bp, timings, non-zero exit code on mismatch
+ *
+ * This is a sequential test.
+ */
+#ifndef _NOMPI
+#define _NOMPI
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <sys/time.h>
+#include "public/adios.h"
+#include "public/adios_read.h"
+
+#define NVARS 3
+#define NSTEPS 5
+
+static double now ()
+{
+    struct timeval tp;
+    gettimeofday (&tp, NULL);
+    return (double) tp.tv_sec + (double) tp.tv_usec * 1.0e-6;
+}
+
+static double value (int step, int var, uint64_t i)
+{
+    return step * 1000000.0 + var * 1000.0 + (double) (i % 997);
+}
+
+static int write_steps (const char * groupname, const char * filename, uint64_t n, double * data, double * t_first, double * t_rest)
+{
+    int64_t fh;
+    char name[16];
+    int s, v;
+    uint64_t i;
+    double t;
+
+    *t_rest = 0;
+    for (s = 0; s < NSTEPS; s++)
+    {
+        t = now ();
+        adios_open (&fh, groupname, filename, (s ? "a" : "w"), MPI_COMM_SELF);
+        adios_write (fh, "n", &n);
+        for (v = 0; v < NVARS; v++)
+        {
+            for (i = 0; i < n; i++)
+                data[i] = value (s, v, i);
+            sprintf (name, "v%d", v);
+            if (adios_write (fh, name, data))
+            {
+                printf ("ERROR: writing %s failed: %s\n", name, adios_errmsg ());
+                return 1;
+            }
+        }
+        adios_close (fh);
+        t = now () - t;
+        if (s)
+            *t_rest += t;
+        else
+            *t_first = t;
+    }
+    *t_rest /= (NSTEPS - 1);
+    return 0;
+}
+
+static int check_steps (const char * filename, uint64_t n, double * data)
+{
+    ADIOS_FILE * f;
+    ADIOS_SELECTION * sel;
+    uint64_t start = 0, i;
+    char name[16];
+    int s, v, err = 0;
+
+    f = adios_read_open_file (filename, ADIOS_READ_METHOD_BP, MPI_COMM_SELF);
+    if (!f)
+    {
+        printf ("ERROR: cannot open %s: %s\n", filename, adios_errmsg ());
+        return 1;
+    }
+    if (f->last_step + 1 != NSTEPS)
+    {
+        printf ("ERROR: %s has %d steps instead of %d\n", filename, f->last_step + 1, NSTEPS);
+        adios_read_close (f);
+        return 1;
+    }
+    sel = adios_selection_boundingbox (1, &start, &n);
+    for (s = 0; s < NSTEPS && !err; s++)
+    {
+        for (v = 0; v < NVARS && !err; v++)
+        {
+            sprintf (name, "v%d", v);
+            memset (data, 0, n * sizeof (double));
+            adios_schedule_read (f, sel, name, s, 1, data);
+            adios_perform_reads (f, 1);
+            for (i = 0; i < n; i++)
+            {
+                if (data[i] != value (s, v, i))
+                {
+                    printf ("ERROR: step %d %s[%llu] = %g instead of %g\n", s, name,
+                            (unsigned long long) i, data[i], value (s, v, i));
+                    err = 1;
+                    break;
+                }
+            }
+        }
+    }
+    adios_selection_delete (sel);
+    adios_read_close (f);
+    return err;
+}
+
+int main (int argc, char ** argv)
+{
+    int64_t group;
+    uint64_t n, mb = 8;
+    double * data;
+    double t_first, t_rest;
+    char groupname[16], varname[16], filename[32];
+    int v, mode, err = 0;
+    static const char * modes[] = { "malloc", "huge pages", "huge pages, prefault" };
+
+    if (argc > 1)
+    {
+        mb = atoi (argv[1]);
+    }
+    if (mb < 1)
+    {
+        printf ("ERROR: size must be at least 1 MB\n");
+        return 1;
+    }
+    n = mb * 1024 * 1024 / sizeof (double);
+
+    data = (double *) malloc (n * sizeof (double));
+    if (!data)
+    {
+        printf ("ERROR: cannot allocate %llu MB\n", (unsigned long long) mb);
+        return 1;
+    }
+
+    adios_init_noxml (MPI_COMM_SELF);
+    adios_read_init_method (ADIOS_READ_METHOD_BP, MPI_COMM_SELF, "");
+
+
+    printf ("Write %d steps of %d x %llu MB\n", NSTEPS, NVARS, (unsigned long long) mb);
+    for (mode = 0; mode < 3 && !err; mode++)
+    {
+        // start without buffers from the previous mode
+        adios_release_buffers ();
+        if (mode == 1)
+            adios_set_buffer_options (1, 0);
+        else if (mode == 2)
+            adios_set_buffer_options (1, NVARS * mb + 1);
+
+        // a new group and file for each mode, to start from step 1
+        sprintf (groupname, "buf%d", mode);
+        adios_declare_group (&group, groupname, "", adios_stat_no);
+        adios_select_method (group, "POSIX", "", "");
+        adios_define_var (group, "n", "", adios_unsigned_long, "", "", "");
+        for (v = 0; v < NVARS; v++)
+        {
+            sprintf (varname, "v%d", v);
+            adios_define_var (group, varname, "", adios_double, "n", "n", "0");
+        }
+
+        sprintf (filename, "buffer_reuse_%d.bp", mode);
+        err = write_steps (groupname, filename, n, data, &t_first, &t_rest);
+        if (!err)
+            err = check_steps (filename, n, data);
+        printf ("  %-22s first step %.3f s, next steps %.3f s\n", modes[mode], t_first, t_rest);
+    }
+
+    adios_read_finalize_method (ADIOS_READ_METHOD_BP);
+    adios_finalize (0);
+    free (data);
+    if (err)
+        printf ("FAILED\n");
+    else
+        printf ("OK\n");
+    return err;
+}
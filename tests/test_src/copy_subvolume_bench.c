@@ -0,0 +1,276 @@
+/*
+ * ADIOS is freely available under the terms of the BSD license described
+ * in the COPYING file in the top level directory of this source distribution.
+ *
+ * Copyright (c) 2008 - 2009.  UT-BATTELLE, LLC. All rights reserved.
+ */
+
+/* ADIOS test: subvolume copy engine (copy_subvolume_ragged_offset()) against
+ * a plain recursive copy of one innermost run at a time.
+ *
+ * Typical hyperslab shapes are copied out of a 3D, 2D and 1D array of doubles:
+ * slabs with narrow fastest dimensions, pencils, interior boxes, full planes,
+ * with and without endianness swapping, with ragged source buffers, and the
+ * in-place compaction of a subvolume. Results must be identical to the
+ * reference copy. Timings are printed for both.
+ *
+ * How to run: copy_subvolume_bench [edge of the 3D array]
+ * Output: timings, non-zero exit code on mismatch
+ *
+ * This is a sequential test.
+ */
+#ifndef _NOMPI
+#define _NOMPI
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <inttypes.h>
+#include <string.h>
+#include <sys/time.h>
+
+#include "public/adios_types.h"
+#include "core/adios_subvolume.h"
+#include "core/adios_internals.h"
+#include "core/util.h"
+
+#define NREPEAT 3
+
+static double now ()
+{
+    struct timeval tp;
+    gettimeofday (&tp, NULL);
+    return (double) tp.tv_sec + (double) tp.tv_usec * 1.0e-6;
+}
+
+/* Reference: recurse down to the fastest dimension, copy it, then swap it */
+static void ref_copy (char * dst, const char * src, int ndim, const uint64_t * count,
+                      const uint64_t * dst_stride, const uint64_t * src_stride,
+                      int type_size, enum ADIOS_DATATYPES type, int swap)
+{
+    uint64_t i;
+    if (ndim == 1)
+    {
+        memcpy (dst, src, count[0] * type_size);
+        if (swap)
+            change_endianness (dst, count[0] * type_size, type);
+        return;
+    }
+    for (i = 0; i < count[0]; i++)
+    {
+        ref_copy (dst + i * dst_stride[0], src + i * src_stride[0], ndim - 1,
+                  count + 1, dst_stride + 1, src_stride + 1, type_size, type, swap);
+    }
+}
+
+static void ref_copy_subvolume (void * dst, const void * src, int ndim, const uint64_t * subv_dims,
+                                const uint64_t * dst_dims, const uint64_t * dst_offsets,
+                                const uint64_t * src_dims, const uint64_t * src_offsets,
+                                uint64_t src_ragged_offset,
+                                enum ADIOS_DATATYPES type, int swap)
+{
+    uint64_t dst_stride[32], src_stride[32], dst_volume, src_volume;
+    uint64_t dst_start = 0, src_start = 0;
+    int type_size = adios_get_type_size (type, NULL);
+    int i;
+
+    dst_volume = src_volume = type_size;
+    for (i = ndim - 1; i >= 0; i--)
+    {
+        dst_stride[i] = dst_volume;
+        src_stride[i] = src_volume;
+        dst_volume *= dst_dims[i];
+        src_volume *= src_dims[i];
+    }
+    for (i = 0; i < ndim; i++)
+    {
+        dst_start += dst_offsets[i] * dst_stride[i];
+        src_start += src_offsets[i] * src_stride[i];
+    }
+    src_start -= src_ragged_offset * type_size;
+    ref_copy ((char *) dst + dst_start, (const char *) src + src_start, ndim,
+              subv_dims, dst_stride, src_stride, type_size, type, swap);
+}
+
+struct shape
+{
+    const char * name;
+    int ndim;
+    uint64_t count[3];   // subvolume
+    uint64_t offset[3];  // of the subvolume in the source array
+    enum ADIOS_DATATYPES type;
+    int swap;
+};
+
+static uint64_t volume (int ndim, const uint64_t * dims)
+{
+    uint64_t v = 1;
+    int i;
+    for (i = 0; i < ndim; i++)
+        v *= dims[i];
+    return v;
+}
+
+/* Copy the subvolume into a compact buffer of its own size */
+static int run_shape (const struct shape * sh, const uint64_t * src_dims, const char * src,
+                      char * dst_ref, char * dst_new)
+{
+    uint64_t zero[3] = {0, 0, 0};
+    int type_size = adios_get_type_size (sh->type, NULL);
+    uint64_t bytes = volume (sh->ndim, sh->count) * type_size;
+    double t0, t_ref = 0, t_new = 0;
+    int r;
+
+    for (r = 0; r < NREPEAT; r++)
+    {
+        t0 = now ();
+        ref_copy_subvolume (dst_ref, src, sh->ndim, sh->count, sh->count, zero,
+                            src_dims, sh->offset, 0, sh->type, sh->swap);
+        t_ref += now () - t0;
+
+        t0 = now ();
+        copy_subvolume (dst_new, src, sh->ndim, sh->count, sh->count, zero,
+                        src_dims, sh->offset, sh->type,
+                        (sh->swap ? adios_flag_yes : adios_flag_no));
+        t_new += now () - t0;
+    }
+
+    printf ("%-34s %8.1f MB  %10.6f s  %10.6f s\n", sh->name, bytes / 1048576.0,
+            t_ref / NREPEAT, t_new / NREPEAT);
+    if (memcmp (dst_ref, dst_new, bytes))
+    {
+        printf ("ERROR: %s: copied data differs from the reference\n", sh->name);
+        return 1;
+    }
+    return 0;
+}
+
+int main (int argc, char ** argv)
+{
+    uint64_t e = 192, i, n;
+    uint64_t dims3[3], dims2[2], dims1[1];
+    double * src;
+    char * dst_ref, * dst_new;
+    int err = 0, k;
+
+    if (argc > 1)
+    {
+        e = strtoull (argv[1], NULL, 10);
+    }
+    if (e < 16)
+    {
+        printf ("ERROR: edge of the 3D array must be at least 16\n");
+        return 1;
+    }
+
+    n = e * e * e;
+    dims3[0] = dims3[1] = dims3[2] = e;
+    dims2[0] = e * 8; dims2[1] = n / (e * 8);
+    dims1[0] = n;
+
+    src = (double *) malloc (n * sizeof (double));
+    dst_ref = (char *) malloc (n * sizeof (double));
+    dst_new = (char *) malloc (n * sizeof (double));
+    if (!src || !dst_ref || !dst_new)
+    {
+        printf ("ERROR: cannot allocate arrays of %" PRIu64 " doubles\n", n);
+        return 1;
+    }
+    for (i = 0; i < n; i++)
+        src[i] = (double) i * 1.5 + 0.25;
+
+    {
+        /* 3D array of e^3 doubles */
+        struct shape shapes3[] = {
+            {"3D slab, fastest dim 2",           3, {e, e, 2},             {0, 0, e / 2},          adios_double, 0},
+            {"3D slab, fastest dim 8",           3, {e, e, 8},             {0, 0, 3},              adios_double, 0},
+            {"3D slab, middle dim 4",            3, {e, 4, e},             {0, e / 3, 0},          adios_double, 0},
+            {"3D slab, slowest dim 4",           3, {4, e, e},             {e / 4, 0, 0},          adios_double, 0},
+            {"3D interior box, half edge",       3, {e / 2, e / 2, e / 2}, {e / 4, e / 4, e / 4},  adios_double, 0},
+            {"3D pencil along slowest dim",      3, {e, 1, 1},             {0, e / 2, e / 2},      adios_double, 0},
+            {"3D full planes, offset",           3, {e / 2, e, e},         {e / 4, 0, 0},          adios_double, 0},
+            {"3D interior box, swap double",     3, {e / 2, e / 2, e / 2}, {e / 4, e / 4, e / 4},  adios_double, 1},
+            {"3D slab fastest dim 8, swap",      3, {e, e, 8},             {0, 0, 3},              adios_double, 1},
+        };
+        /* the same memory as int and complex: 2 per double */
+        uint64_t idims3[3] = {e, e, 2 * e};
+        struct shape ishapes3[] = {
+            {"3D interior box, swap int",        3, {e / 2, e / 2, e},     {e / 4, e / 4, e / 2},  adios_integer, 1},
+            {"3D interior box, swap complex",    3, {e / 2, e / 2, e / 2}, {e / 4, e / 4, e / 4},  adios_complex, 1},
+        };
+        /* 2D array */
+        struct shape shapes2[] = {
+            {"2D column block, 2 wide",          2, {dims2[0], 2},         {0, dims2[1] / 2},      adios_double, 0},
+            {"2D row block, 16 rows",            2, {16, dims2[1]},        {dims2[0] / 2, 0},      adios_double, 0},
+            {"2D interior block",                2, {dims2[0] / 2, dims2[1] / 2}, {1, 1},          adios_double, 0},
+        };
+        /* 1D array */
+        struct shape shapes1[] = {
+            {"1D contiguous, whole array",       1, {dims1[0]},            {0},                    adios_double, 0},
+            {"1D contiguous, swap",              1, {dims1[0] / 2},        {dims1[0] / 4},         adios_double, 1},
+        };
+
+        printf ("Subvolume copies out of %" PRIu64 "^3 doubles, average of %d runs\n", e, NREPEAT);
+        printf ("%-34s %11s  %12s  %12s\n", "", "size", "reference", "engine");
+        for (k = 0; k < sizeof (shapes3) / sizeof (shapes3[0]); k++)
+            err |= run_shape (&shapes3[k], dims3, (const char *) src, dst_ref, dst_new);
+        for (k = 0; k < sizeof (ishapes3) / sizeof (ishapes3[0]); k++)
+        {
+            if (ishapes3[k].type == adios_complex)
+            {
+                idims3[2] = e;
+            }
+            err |= run_shape (&ishapes3[k], idims3, (const char *) src, dst_ref, dst_new);
+        }
+        for (k = 0; k < sizeof (shapes2) / sizeof (shapes2[0]); k++)
+            err |= run_shape (&shapes2[k], dims2, (const char *) src, dst_ref, dst_new);
+        for (k = 0; k < sizeof (shapes1) / sizeof (shapes1[0]); k++)
+            err |= run_shape (&shapes1[k], dims1, (const char *) src, dst_ref, dst_new);
+    }
+
+    {
+        /* ragged source: only the planes from e/4 on are in the buffer */
+        uint64_t count[3] = {e / 2, e / 2, e / 2}, offset[3] = {e / 4 + 3, e / 4, e / 4};
+        uint64_t zero[3] = {0, 0, 0};
+        uint64_t ragged = (e / 4) * e * e;
+        const double * ragged_src = src + ragged;
+        uint64_t bytes = volume (3, count) * sizeof (double);
+
+        ref_copy_subvolume (dst_ref, ragged_src, 3, count, count, zero,
+                            dims3, offset, ragged, adios_double, 0);
+        copy_subvolume_ragged_offset (dst_new, ragged_src, 3, count, count, zero, 0,
+                                      dims3, offset, ragged, adios_double, adios_flag_no);
+        if (memcmp (dst_ref, dst_new, bytes))
+        {
+            printf ("ERROR: ragged source: copied data differs from the reference\n");
+            err = 1;
+        }
+    }
+
+    {
+        /* in-place compaction of an interior box of the 3D array */
+        uint64_t count[3] = {e / 2, e / 2, e / 2}, offset[3] = {e / 4, e / 4, e / 4};
+        uint64_t zero[3] = {0, 0, 0};
+        uint64_t bytes = volume (3, count) * sizeof (double);
+        double t0;
+
+        ref_copy_subvolume (dst_ref, src, 3, count, count, zero, dims3, offset, 0, adios_double, 0);
+        memcpy (dst_new, src, n * sizeof (double));
+        t0 = now ();
+        compact_subvolume_ragged_offset (dst_new, 3, count, dims3, 0, offset, adios_double);
+        printf ("%-34s %8.1f MB  %12s  %10.6f s\n", "3D interior box, compact in place",
+                bytes / 1048576.0, "", now () - t0);
+        if (memcmp (dst_ref, dst_new, bytes))
+        {
+            printf ("ERROR: compaction: data differs from the reference\n");
+            err = 1;
+        }
+    }
+
+    free (src);
+    free (dst_ref);
+    free (dst_new);
+
+    return err;
+}
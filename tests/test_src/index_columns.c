@@ -0,0 +1,224 @@
+/*
+ * ADIOS is freely available under the terms of the BSD license described
+ * in the COPYING file in the top level directory of this source distribution.
+ *
+ * Copyright (c) 2008 - 2009.  UT-BATTELLE, LLC. All rights reserved.
+ */
+
+/* ADIOS test: columnar block index (bp_build_var_columns()) against
+ * the characteristics array of a variable.
+ *
+ * Build a synthetic index of one 3D variable with NBLOCKS blocks over NSTEPS
+ * steps, then do the typical block lookups both on the characteristics
+ * (array of structs) and on the columnar index:
+ *   - find the first/last block of each step (table lookup in the columns)
+ *   - find the blocks intersecting a bounding box (binary search on the
+ *     blocks ordered by start in the columns)
+ * The results must be identical. Timings are printed for both.
+ *
+ * How to run: index_columns [nblocks]
+ * Output: timings, non-zero exit code on mismatch
+ *
+ * This is a sequential test.
+ */
+#ifndef _NOMPI
+#define _NOMPI
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <inttypes.h>
+#include <string.h>
+#include <sys/time.h>
+#include "core/bp_utils.h"
+#include "core/bp_types.h"
+#include "core/adios_bp_v1.h"
+
+#define NSTEPS 10
+#define NDIM 3
+#define NBOXES 20
+
+/* blocks are laid out in a (bx, by, bz) grid of 4x4x4 elements each */
+static const uint64_t BLOCK = 4;
+
+static double now ()
+{
+    struct timeval tp;
+    gettimeofday (&tp, NULL);
+    return (double) tp.tv_sec + (double) tp.tv_usec * 1.0e-6;
+}
+
+static struct adios_index_var_struct_v1 * make_var (uint64_t nblocks, uint64_t grid[NDIM])
+{
+    struct adios_index_var_struct_v1 * v;
+    uint64_t b, per_step = nblocks / NSTEPS;
+    int d;
+
+    v = (struct adios_index_var_struct_v1 *) calloc (1, sizeof (struct adios_index_var_struct_v1));
+    v->type = adios_double;
+    v->characteristics_count = nblocks;
+    v->characteristics_allocated = nblocks;
+    v->characteristics = (struct adios_index_characteristic_struct_v1 *)
+            calloc (nblocks, sizeof (struct adios_index_characteristic_struct_v1));
+
+    for (b = 0; b < nblocks; b++)
+    {
+        struct adios_index_characteristic_struct_v1 * ch = &v->characteristics[b];
+        uint64_t pos = b % per_step;
+        uint64_t coord[NDIM];
+
+        coord[2] = pos % grid[2];
+        coord[1] = (pos / grid[2]) % grid[1];
+        coord[0] = pos / (grid[2] * grid[1]);
+
+        ch->offset = b * 1024;
+        ch->payload_offset = b * 1024 + 100;
+        ch->time_index = b / per_step + 1;
+        ch->dims.count = NDIM;
+        ch->dims.dims = (uint64_t *) malloc (3 * NDIM * sizeof (uint64_t));
+        for (d = 0; d < NDIM; d++)
+        {
+            ch->dims.dims[d * 3 + 0] = BLOCK;
+            ch->dims.dims[d * 3 + 1] = grid[d] * BLOCK;
+            ch->dims.dims[d * 3 + 2] = coord[d] * BLOCK;
+        }
+    }
+
+    return v;
+}
+
+static void free_var (struct adios_index_var_struct_v1 * v)
+{
+    uint64_t b;
+    for (b = 0; b < v->characteristics_count; b++)
+    {
+        free (v->characteristics[b].dims.dims);
+    }
+    free (v->characteristics);
+    free (v);
+}
+
+/* Array of structs versions of the scans, as done in read_bp.c */
+static uint64_t aos_intersect (struct adios_index_var_struct_v1 * v, int64_t from, int64_t to,
+                               const uint64_t * start, const uint64_t * count, uint64_t * blocks)
+{
+    uint64_t ldims[32], gdims[32], offsets[32];
+    int64_t b;
+    uint64_t n = 0;
+    int j, flag;
+
+    for (b = from; b < to; b++)
+    {
+        bp_get_dimension_characteristics_notime (&v->characteristics[b], ldims, gdims, offsets, 0);
+        flag = 1;
+        for (j = 0; j < NDIM; j++)
+        {
+            flag = flag && offsets[j] < start[j] + count[j] && start[j] < offsets[j] + ldims[j];
+        }
+        if (flag)
+            blocks[n++] = b;
+    }
+    return n;
+}
+
+static int compare (const char * what, uint64_t n1, uint64_t * b1, uint64_t n2, uint64_t * b2)
+{
+    if (n1 != n2 || memcmp (b1, b2, n1 * sizeof (uint64_t)))
+    {
+        printf ("ERROR: %s: array of structs found %" PRIu64 " blocks, "
+                "columns found %" PRIu64 " blocks\n", what, n1, n2);
+        return 1;
+    }
+    return 0;
+}
+
+int main (int argc, char ** argv)
+{
+    uint64_t nblocks = 1000000;
+    uint64_t grid[NDIM] = {100, 10, 10}; // 10000 blocks per step
+    struct adios_index_var_struct_v1 * v;
+    struct BP_var_columns * c;
+    uint64_t * blocks1, * blocks2, n1, n2, total = 0;
+    uint64_t start[NDIM], count[NDIM];
+    int64_t s1, e1, s2, e2;
+    double t0, t_build, t_time[2] = {0, 0}, t_bb[2] = {0, 0};
+    int t, k, d, err = 0;
+
+    if (argc > 1)
+    {
+        nblocks = strtoull (argv[1], NULL, 10);
+    }
+    grid[0] = nblocks / NSTEPS / (grid[1] * grid[2]);
+    if (grid[0] < 1)
+    {
+        printf ("ERROR: need at least %d blocks\n", (int) (NSTEPS * grid[1] * grid[2]));
+        return 1;
+    }
+    nblocks = NSTEPS * grid[0] * grid[1] * grid[2];
+
+    printf ("Build synthetic index: %" PRIu64 " blocks, %d steps\n", nblocks, NSTEPS);
+    v = make_var (nblocks, grid);
+    blocks1 = (uint64_t *) malloc (nblocks * sizeof (uint64_t));
+    blocks2 = (uint64_t *) malloc (nblocks * sizeof (uint64_t));
+
+    t0 = now ();
+    c = bp_build_var_columns (v, 0);
+    t_build = now () - t0;
+
+    for (t = 1; t <= NSTEPS && !err; t++)
+    {
+        /* time lookup */
+        t0 = now ();
+        s1 = get_var_start_index (v, t);
+        e1 = get_var_stop_index (v, t);
+        t_time[0] += now () - t0;
+
+        t0 = now ();
+        bp_columns_time_range (c, t, &s2, &e2);
+        t_time[1] += now () - t0;
+
+        if (s1 != s2 || e1 != e2)
+        {
+            printf ("ERROR: step %d: array of structs range [%" PRId64 ",%" PRId64 "], "
+                    "columns range [%" PRId64 ",%" PRId64 "]\n", t, s1, e1, s2, e2);
+            err = 1;
+            break;
+        }
+
+        /* bounding box intersections within the step */
+        for (k = 0; k < NBOXES && !err; k++)
+        {
+            for (d = 0; d < NDIM; d++)
+            {
+                uint64_t gdim = grid[d] * BLOCK;
+                start[d] = (k * 7919 + d * 104729) % gdim;
+                count[d] = 1 + (k * 31 + d * 17) % (gdim - start[d]);
+            }
+
+            t0 = now ();
+            n1 = aos_intersect (v, s1, e1 + 1, start, count, blocks1);
+            t_bb[0] += now () - t0;
+
+            t0 = now ();
+            n2 = bp_columns_find_blocks (c, t, start, count, blocks2);
+            t_bb[1] += now () - t0;
+
+            err = compare ("bounding box", n1, blocks1, n2, blocks2);
+            total += n1;
+        }
+    }
+
+    printf ("Build columns:            %10.6f s\n", t_build);
+    printf ("                          array of structs   columns\n");
+    printf ("Time lookup (%2d steps):   %10.6f s       %10.6f s\n", NSTEPS, t_time[0], t_time[1]);
+    printf ("Box intersection (%4d):  %10.6f s       %10.6f s   (%" PRIu64 " hits)\n",
+            NSTEPS * NBOXES, t_bb[0], t_bb[1], total);
+
+    bp_free_var_columns (c);
+    free_var (v);
+    free (blocks1);
+    free (blocks2);
+
+    return err;
+}
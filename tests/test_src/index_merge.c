@@ -0,0 +1,202 @@
+/*
+ * ADIOS is freely available under the terms of the BSD license described
+ * in the COPYING file in the top level directory of this source distribution.
+ *
+ * Copyright (c) 2008 - 2009.  UT-BATTELLE, LLC. All rights reserved.
+ */
+
+/* ADIOS test: merging the indexes of many processes into a global index.
+ *
+ * Build a synthetic index for each of NRANKS processes, with NVARS variables
+ * written in NSTEPS steps, and merge them into a global index twice:
+ *   - with adios_merge_index_v1(..., 1), sorting at every merge
+ *   - with adios_merge_index_v1(..., 0) and one
+ *     adios_sort_index_characteristics_v1() at the end
+ * In both cases the characteristics of each variable must be ordered by
+ * time index, and by process within a step. Timings are printed for both.
+ *
+ * How to run: index_merge [nranks]
+ * Output: timings, non-zero exit code on mismatch
+ *
+ * This is a sequential test.
+ */
+#ifndef _NOMPI
+#define _NOMPI
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <sys/time.h>
+#include "core/adios_internals.h"
+#include "core/adios_bp_v1.h"
+
+#define NVARS 8
+#define NSTEPS 10
+
+static double now ()
+{
+    struct timeval tp;
+    gettimeofday (&tp, NULL);
+    return (double) tp.tv_sec + (double) tp.tv_usec * 1.0e-6;
+}
+
+/* offset of the block of 'var' written by 'rank' in 'step' */
+static uint64_t block_offset (int rank, int var, int step)
+{
+    return ((uint64_t) rank * NSTEPS + step) * NVARS + var;
+}
+
+/* The index of one process: one PG, NVARS variables with NSTEPS characteristics */
+static void make_index (int rank,
+                        struct adios_index_process_group_struct_v1 ** pg,
+                        struct adios_index_var_struct_v1 ** vars)
+{
+    struct adios_index_var_struct_v1 * v, * tail = NULL;
+    char name[16];
+    int i, s;
+
+    *pg = (struct adios_index_process_group_struct_v1 *)
+            calloc (1, sizeof (struct adios_index_process_group_struct_v1));
+    (*pg)->group_name = strdup ("g");
+    (*pg)->process_id = rank;
+    (*pg)->time_index = 1;
+
+    *vars = NULL;
+    for (i = 0; i < NVARS; i++)
+    {
+        v = (struct adios_index_var_struct_v1 *) calloc (1, sizeof (struct adios_index_var_struct_v1));
+        sprintf (name, "v%d", i);
+        v->id = i;
+        v->group_name = strdup ("g");
+        v->var_name = strdup (name);
+        v->var_path = strdup ("/");
+        v->type = adios_double;
+        v->characteristics_count = NSTEPS;
+        v->characteristics_allocated = NSTEPS;
+        v->characteristics = (struct adios_index_characteristic_struct_v1 *)
+                calloc (NSTEPS, sizeof (struct adios_index_characteristic_struct_v1));
+        for (s = 0; s < NSTEPS; s++)
+        {
+            v->characteristics[s].offset = block_offset (rank, i, s);
+            v->characteristics[s].payload_offset = v->characteristics[s].offset;
+            v->characteristics[s].var_id = i;
+            v->characteristics[s].time_index = s + 1;
+        }
+        if (tail)
+            tail->next = v;
+        else
+            *vars = v;
+        tail = v;
+    }
+}
+
+static double merge (struct adios_index_struct_v1 * index, int nranks, int sort_each)
+{
+    struct adios_index_process_group_struct_v1 * pg;
+    struct adios_index_var_struct_v1 * vars;
+    double t = 0, t0;
+    int r;
+
+    for (r = 0; r < nranks; r++)
+    {
+        make_index (r, &pg, &vars);
+        t0 = now ();
+        adios_merge_index_v1 (index, pg, vars, NULL, sort_each);
+        t += now () - t0;
+    }
+    if (!sort_each)
+    {
+        t0 = now ();
+        adios_sort_index_characteristics_v1 (index);
+        t += now () - t0;
+    }
+    return t;
+}
+
+static int check (struct adios_index_struct_v1 * index, int nranks, const char * how)
+{
+    struct adios_index_var_struct_v1 * v = index->vars_root;
+    struct adios_index_process_group_struct_v1 * pg = index->pg_root;
+    uint64_t k;
+    int i, npgs = 0;
+
+    for (; pg; pg = pg->next)
+        npgs++;
+    if (npgs != nranks)
+    {
+        printf ("ERROR: %s: %d process groups instead of %d\n", how, npgs, nranks);
+        return 1;
+    }
+
+    for (i = 0; i < NVARS; i++, v = v->next)
+    {
+        if (!v || v->id != i || v->characteristics_count != (uint64_t) nranks * NSTEPS)
+        {
+            printf ("ERROR: %s: variable %d missing or with the wrong number of blocks\n", how, i);
+            return 1;
+        }
+        for (k = 0; k < v->characteristics_count; k++)
+        {
+            int step = k / nranks, rank = k % nranks;
+            if (v->characteristics[k].time_index != step + 1 ||
+                v->characteristics[k].offset != block_offset (rank, i, step))
+            {
+                printf ("ERROR: %s: variable %d block %llu is step %u offset %llu, "
+                        "expected step %d of process %d\n", how, i, (unsigned long long) k,
+                        v->characteristics[k].time_index,
+                        (unsigned long long) v->characteristics[k].offset, step + 1, rank);
+                return 1;
+            }
+        }
+    }
+    if (v)
+    {
+        printf ("ERROR: %s: too many variables\n", how);
+        return 1;
+    }
+    return 0;
+}
+
+int main (int argc, char ** argv)
+{
+    struct adios_index_struct_v1 * index;
+    int nranks = 1000, err = 0;
+    double t;
+
+    if (argc > 1)
+    {
+        nranks = atoi (argv[1]);
+    }
+    if (nranks < 1)
+    {
+        printf ("ERROR: number of processes must be at least 1\n");
+        return 1;
+    }
+
+    printf ("Merge the indexes of %d processes, %d variables, %d steps\n", nranks, NVARS, NSTEPS);
+
+    index = adios_alloc_index_v1 (1);
+    t = merge (index, nranks, 1);
+    err = check (index, nranks, "sort at every merge");
+    printf ("  sort at every merge: %.3f s\n", t);
+    adios_clear_index_v1 (index);
+    adios_free_index_v1 (index);
+
+    if (!err)
+    {
+        index = adios_alloc_index_v1 (1);
+        t = merge (index, nranks, 0);
+        err = check (index, nranks, "sort once");
+        printf ("  sort once:           %.3f s\n", t);
+        adios_clear_index_v1 (index);
+        adios_free_index_v1 (index);
+    }
+
+    if (err)
+        printf ("FAILED\n");
+    else
+        printf ("OK\n");
+    return err;
+}
@@ -0,0 +1,301 @@
+/*
+ * ADIOS is freely available under the terms of the BSD license described
+ * in the COPYING file in the top level directory of this source distribution.
+ *
+ * Copyright (c) 2008 - 2009.  UT-BATTELLE, LLC. All rights reserved.
+ */
+
+/* ADIOS test: lazy and threaded decoding of the variables index.
+ *
+ * Write NSTEPS steps of NVARS global arrays in NB blocks, a local array and
+ * a scalar. Then open the file with lazy_index=1, with index_threads=4 and
+ * with both, and compare against an open without parameters (eager parse):
+ *   - adios_inq_var(): type, dimensions, steps and blocks per step
+ *   - adios_inq_var_blockinfo(): start, count and time of every block
+ *   - adios_inq_var_stat(): min/max of every block
+ *   - a box across the blocks in every step, and every block, read back
+ * The variables are accessed in reverse order of the eager open, so that
+ * with lazy_index they are decoded in a different order.
+ *
+ * How to run: index_modes
+ * Output: index_modes.bp, non-zero exit code on mismatch
+ *
+ * This is a sequential test.
+ */
+#ifndef _NOMPI
+#define _NOMPI
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include "public/adios.h"
+#include "public/adios_read.h"
+
+#define NX 64
+#define NB 4
+#define NSTEPS 3
+#define NVARS 12
+
+static const char FILENAME[] = "index_modes.bp";
+static const char * params[] = {"lazy_index=1", "index_threads=4", "lazy_index=1;index_threads=4"};
+#define NPARAMS 3
+
+static double value (int var, int step, uint64_t i)
+{
+    return var * 1.0e6 + step * 1.0e4 + (double) i;
+}
+
+/* Variable names: the global arrays, the local array and the scalar */
+static void var_name (int v, char * name)
+{
+    if (v < NVARS)
+        sprintf (name, "v%d", v);
+    else if (v == NVARS)
+        strcpy (name, "local");
+    else
+        strcpy (name, "scalar");
+}
+
+static void write_file ()
+{
+    int64_t group, fh;
+    uint64_t n = NX * NB, ldim = NX, off, i;
+    double block[NX];
+    char name[32];
+    int s, v, b;
+
+    adios_declare_group (&group, "modes", "", adios_stat_default);
+    adios_select_method (group, "POSIX", "", "");
+    adios_define_var (group, "n", "", adios_unsigned_long, "", "", "");
+    adios_define_var (group, "ldim", "", adios_unsigned_long, "", "", "");
+    adios_define_var (group, "off", "", adios_unsigned_long, "", "", "");
+    for (v = 0; v < NVARS; v++)
+    {
+        var_name (v, name);
+        adios_define_var (group, name, "", adios_double, "ldim", "n", "off");
+    }
+    adios_define_var (group, "local", "", adios_double, "ldim", "", "");
+    adios_define_var (group, "scalar", "", adios_integer, "", "", "");
+
+    for (s = 0; s < NSTEPS; s++)
+    {
+        adios_open (&fh, "modes", FILENAME, (s ? "a" : "w"), MPI_COMM_SELF);
+        adios_write (fh, "n", &n);
+        adios_write (fh, "ldim", &ldim);
+        adios_write (fh, "scalar", &s);
+        for (b = 0; b < NB; b++)
+        {
+            off = b * ldim;
+            adios_write (fh, "off", &off);
+            for (v = 0; v <= NVARS; v++)
+            {
+                var_name (v, name);
+                for (i = 0; i < ldim; i++)
+                    block[i] = value (v, s, off + i);
+                adios_write (fh, name, block);
+            }
+        }
+        adios_close (fh);
+    }
+}
+
+static int compare_varinfo (const char * name, const char * param,
+                            ADIOS_VARINFO * v, ADIOS_VARINFO * r)
+{
+    int i, k, err;
+
+    err = (v->type != r->type || v->ndim != r->ndim || v->nsteps != r->nsteps
+           || v->sum_nblocks != r->sum_nblocks);
+    for (i = 0; i < v->ndim && !err; i++)
+        err = (v->dims[i] != r->dims[i]);
+    for (i = 0; i < v->nsteps && !err; i++)
+        err = (v->nblocks[i] != r->nblocks[i]);
+    if (err)
+    {
+        printf ("ERROR: %s: adios_inq_var (%s) differs from the eager parse\n", param, name);
+        return 1;
+    }
+
+    for (i = 0; i < v->sum_nblocks && !err; i++)
+    {
+        err = (v->blockinfo[i].time_index != r->blockinfo[i].time_index);
+        for (k = 0; k < v->ndim && !err; k++)
+            err = (v->blockinfo[i].start[k] != r->blockinfo[i].start[k]
+                   || v->blockinfo[i].count[k] != r->blockinfo[i].count[k]);
+        if (err)
+            printf ("ERROR: %s: block info %d of %s differs from the eager parse\n", param, i, name);
+    }
+
+    if (!err && v->type == adios_double)
+    {
+        for (i = 0; i < v->sum_nblocks && !err; i++)
+        {
+            err = (*(double *) v->statistics->blocks->mins[i] != *(double *) r->statistics->blocks->mins[i]
+                   || *(double *) v->statistics->blocks->maxs[i] != *(double *) r->statistics->blocks->maxs[i]);
+            if (err)
+                printf ("ERROR: %s: min/max of block %d of %s differ from the eager parse\n",
+                        param, i, name);
+        }
+    }
+    return err;
+}
+
+static int check_values (const char * name, const char * param, int v, int s,
+                         uint64_t first, uint64_t count, const double * data)
+{
+    uint64_t i;
+
+    for (i = 0; i < count; i++)
+    {
+        if (data[i] != value (v, s, first + i))
+        {
+            printf ("ERROR: %s: %s step %d [%llu] = %g instead of %g\n", param, name, s,
+                    (unsigned long long) (first + i), data[i], value (v, s, first + i));
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/* Read a box across the blocks of every global array, every block of the
+   local array and the scalar, in every step */
+static int read_var (ADIOS_FILE * f, int v, const char * name, const char * param)
+{
+    ADIOS_SELECTION * sel;
+    uint64_t start = NX / 2, count = NX * (NB - 1);
+    double data[NX * NB];
+    int s, b, scalar, err = 0;
+
+    for (s = 0; s < NSTEPS && !err; s++)
+    {
+        if (v < NVARS)
+        {
+            memset (data, 0, sizeof (data));
+            sel = adios_selection_boundingbox (1, &start, &count);
+            adios_schedule_read (f, sel, name, s, 1, data);
+            adios_perform_reads (f, 1);
+            adios_selection_delete (sel);
+            err = check_values (name, param, v, s, start, count, data);
+        }
+        else if (v == NVARS)
+        {
+            for (b = 0; b < NB && !err; b++)
+            {
+                memset (data, 0, sizeof (data));
+                sel = adios_selection_writeblock (b);
+                adios_schedule_read (f, sel, name, s, 1, data);
+                adios_perform_reads (f, 1);
+                adios_selection_delete (sel);
+                err = check_values (name, param, v, s, (uint64_t) b * NX, NX, data);
+            }
+        }
+        else
+        {
+            scalar = -1;
+            adios_schedule_read (f, NULL, name, s, 1, &scalar);
+            adios_perform_reads (f, 1);
+            if (scalar != s)
+            {
+                printf ("ERROR: %s: %s step %d = %d\n", param, name, s, scalar);
+                err = 1;
+            }
+        }
+    }
+    return err;
+}
+
+static int check_mode (ADIOS_VARINFO ** ref, const char * param)
+{
+    ADIOS_FILE * f;
+    ADIOS_VARINFO * vi;
+    char name[32];
+    int v, err = 0;
+
+    adios_read_init_method (ADIOS_READ_METHOD_BP, MPI_COMM_SELF, param);
+    f = adios_read_open_file (FILENAME, ADIOS_READ_METHOD_BP, MPI_COMM_SELF);
+    if (!f)
+    {
+        printf ("ERROR: %s: cannot open %s: %s\n", param, FILENAME, adios_errmsg ());
+        adios_read_finalize_method (ADIOS_READ_METHOD_BP);
+        return 1;
+    }
+    if (f->current_step != 0 || f->last_step != NSTEPS - 1)
+    {
+        printf ("ERROR: %s: steps %d to %d instead of 0 to %d\n", param,
+                f->current_step, f->last_step, NSTEPS - 1);
+        err = 1;
+    }
+
+    for (v = NVARS + 1; v >= 0 && !err; v--)
+    {
+        var_name (v, name);
+        vi = adios_inq_var (f, name);
+        if (!vi)
+        {
+            printf ("ERROR: %s: cannot inquire %s: %s\n", param, name, adios_errmsg ());
+            err = 1;
+            break;
+        }
+        adios_inq_var_blockinfo (f, vi);
+        adios_inq_var_stat (f, vi, 0, 1);
+        err = compare_varinfo (name, param, vi, ref[v]);
+        err = err || read_var (f, v, name, param);
+        adios_free_varinfo (vi);
+    }
+
+    adios_read_close (f);
+    adios_read_finalize_method (ADIOS_READ_METHOD_BP);
+    return err;
+}
+
+int main (int argc, char ** argv)
+{
+    ADIOS_FILE * f;
+    ADIOS_VARINFO * ref[NVARS + 2];
+    char name[32];
+    int v, p, err = 0;
+
+    adios_init_noxml (MPI_COMM_SELF);
+    write_file ();
+    adios_finalize (0);
+
+    // the eager parse is the reference
+    adios_read_init_method (ADIOS_READ_METHOD_BP, MPI_COMM_SELF, "");
+    f = adios_read_open_file (FILENAME, ADIOS_READ_METHOD_BP, MPI_COMM_SELF);
+    if (!f)
+    {
+        printf ("ERROR: cannot open %s: %s\n", FILENAME, adios_errmsg ());
+        return 1;
+    }
+    for (v = 0; v < NVARS + 2; v++)
+    {
+        var_name (v, name);
+        ref[v] = adios_inq_var (f, name);
+        if (!ref[v])
+        {
+            printf ("ERROR: cannot inquire %s: %s\n", name, adios_errmsg ());
+            return 1;
+        }
+        adios_inq_var_blockinfo (f, ref[v]);
+        adios_inq_var_stat (f, ref[v], 0, 1);
+        err = err || read_var (f, v, name, "eager");
+    }
+
+    for (p = 0; p < NPARAMS && !err; p++)
+    {
+        err = check_mode (ref, params[p]);
+    }
+
+    for (v = 0; v < NVARS + 2; v++)
+        adios_free_varinfo (ref[v]);
+    adios_read_close (f);
+    adios_read_finalize_method (ADIOS_READ_METHOD_BP);
+
+    if (err)
+        printf ("FAILED\n");
+    else
+        printf ("OK\n");
+    return err;
+}
@@ -0,0 +1,371 @@
+/*
+ * ADIOS is freely available under the terms of the BSD license described
+ * in the COPYING file in the top level directory of this source distribution.
+ *
+ * Copyright (c) 2008 - 2009.  UT-BATTELLE, LLC. All rights reserved.
+ */
+
+/* ADIOS test: lookup of variables and attributes by name and by prefix.
+ *
+ * A file with many scalar variables is written, every NATTR_EVERY-th one
+ * with an attribute.
+ * Every variable and attribute is then looked up by name in random order
+ * (with and without the leading /) with adios_inq_var() and adios_get_attr(),
+ * and the values are checked. Lookup times are printed next to the time of a
+ * linear search of the name lists. adios_inq_var_prefix() and
+ * adios_inq_attr_prefix() are compared to a search of the name lists.
+ * A second file has a variable and an attribute both as "a" and as "/a",
+ * each spelling must find its own.
+ *
+ * How to run: name_lookup [number of variables]
+ * Output: name_lookup.bp, name_lookup_slash.bp, timings, non-zero exit code on mismatch
+ *
+ * This is a sequential test.
+ */
+#ifndef _NOMPI
+#define _NOMPI
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <sys/time.h>
+#include "public/adios.h"
+#include "public/adios_read.h"
+
+#define NVARS_PER_DIR 1000
+#define NATTR_EVERY 10
+#define NLINEAR 2000
+
+static const char FILENAME[] = "name_lookup.bp";
+static const char SLASHFILE[] = "name_lookup_slash.bp";
+
+static double now ()
+{
+    struct timeval tp;
+    gettimeofday (&tp, NULL);
+    return (double) tp.tv_sec + (double) tp.tv_usec * 1.0e-6;
+}
+
+static unsigned int lcg (unsigned int *seed)
+{
+    *seed = *seed * 1103515245u + 12345u;
+    return (*seed >> 8) & 0xffffff;
+}
+
+static void var_path (int i, char *path)
+{
+    sprintf (path, "/sim/g%03d", i / NVARS_PER_DIR);
+}
+
+static int write_file (int nvars)
+{
+    int64_t group, fh, *ids;
+    char path[32], name[32], value[32];
+    int i;
+
+    ids = (int64_t *) malloc (nvars * sizeof (int64_t));
+    if (!ids)
+    {
+        printf ("ERROR: cannot allocate %d variable ids\n", nvars);
+        return 1;
+    }
+
+    adios_declare_group (&group, "names", "", adios_stat_no);
+    adios_select_method (group, "POSIX", "", "");
+    for (i = 0; i < nvars; i++)
+    {
+        var_path (i, path);
+        sprintf (name, "v%05d", i);
+        ids[i] = adios_define_var (group, name, path, adios_integer, "", "", "");
+        if (i % NATTR_EVERY == 0)
+        {
+            sprintf (path + strlen (path), "/v%05d", i);
+            sprintf (value, "u%d", i);
+            adios_define_attribute (group, "unit", path, adios_string, value, "");
+        }
+    }
+
+    adios_open (&fh, "names", FILENAME, "w", MPI_COMM_SELF);
+    for (i = 0; i < nvars; i++)
+    {
+        adios_write_byid (fh, ids[i], &i);
+    }
+    adios_close (fh);
+
+    free (ids);
+    return 0;
+}
+
+/* Variable and attribute "a" = 1 and "/a" = 2 */
+static int check_both_spellings ()
+{
+    static const char * names[] = { "a", "/a" };
+    int64_t group, fh, id[2];
+    ADIOS_FILE * f;
+    ADIOS_VARINFO * vi;
+    enum ADIOS_DATATYPES type;
+    int size, k, v, err = 0;
+    void *data;
+
+    adios_declare_group (&group, "slash", "", adios_stat_no);
+    adios_select_method (group, "POSIX", "", "");
+    id[0] = adios_define_var (group, "a", "", adios_integer, "", "", "");
+    id[1] = adios_define_var (group, "a", "/", adios_integer, "", "", "");
+    adios_define_attribute (group, "a", "", adios_integer, "1", "");
+    adios_define_attribute (group, "a", "/", adios_integer, "2", "");
+    adios_open (&fh, "slash", SLASHFILE, "w", MPI_COMM_SELF);
+    for (k = 0; k < 2; k++)
+    {
+        v = k + 1;
+        adios_write_byid (fh, id[k], &v);
+    }
+    adios_close (fh);
+
+    f = adios_read_open_file (SLASHFILE, ADIOS_READ_METHOD_BP, MPI_COMM_SELF);
+    if (!f)
+    {
+        printf ("ERROR: cannot open %s: %s\n", SLASHFILE, adios_errmsg ());
+        return 1;
+    }
+    for (k = 0; k < 2 && !err; k++)
+    {
+        vi = adios_inq_var (f, names[k]);
+        if (!vi || *(int *) vi->value != k + 1 || strcmp (f->var_namelist[vi->varid], names[k]))
+        {
+            printf ("ERROR: variable '%s' found %s instead of itself\n", names[k],
+                    (vi ? f->var_namelist[vi->varid] : "nothing"));
+            err = 1;
+        }
+        adios_free_varinfo (vi);
+        if (adios_get_attr (f, names[k], &type, &size, &data))
+        {
+            printf ("ERROR: attribute '%s' not found: %s\n", names[k], adios_errmsg ());
+            err = 1;
+            continue;
+        }
+        if (*(int *) data != k + 1)
+        {
+            printf ("ERROR: attribute '%s' has value %d instead of %d\n", names[k], *(int *) data, k + 1);
+            err = 1;
+        }
+        free (data);
+    }
+    adios_read_close (f);
+    return err;
+}
+
+static const char * skip_slash (const char *name)
+{
+    return (*name == '/' ? name + 1 : name);
+}
+
+static int linear_search (int n, char **namelist, const char *name)
+{
+    int i;
+    for (i = 0; i < n; i++)
+    {
+        if (!strcmp (skip_slash (namelist[i]), skip_slash (name)))
+            return i;
+    }
+    return -1;
+}
+
+/* Compare a prefix search to a search of the name list */
+static int check_prefix (ADIOS_FILE *f, int attrs, const char *prefix)
+{
+    int n = (attrs ? f->nattrs : f->nvars);
+    char **namelist = (attrs ? f->attr_namelist : f->var_namelist);
+    const char *p = skip_slash (prefix);
+    int *ids = NULL;
+    int nfound, i, k = 0, err = 0;
+    double t;
+
+    t = now ();
+    nfound = (attrs ? adios_inq_attr_prefix (f, prefix, &ids) : adios_inq_var_prefix (f, prefix, &ids));
+    t = now () - t;
+    if (nfound < 0)
+    {
+        printf ("ERROR: prefix search of '%s' failed: %s\n", prefix, adios_errmsg ());
+        return 1;
+    }
+    for (i = 0; i < n && !err; i++)
+    {
+        if (strncmp (skip_slash (namelist[i]), p, strlen (p)))
+            continue;
+        if (k >= nfound || ids[k] != i)
+        {
+            printf ("ERROR: prefix search of %s '%s': %s not found\n",
+                    (attrs ? "attributes" : "variables"), prefix, namelist[i]);
+            err = 1;
+        }
+        k++;
+    }
+    if (!err && k != nfound)
+    {
+        printf ("ERROR: prefix search of %s '%s' found %d names instead of %d\n",
+                (attrs ? "attributes" : "variables"), prefix, nfound, k);
+        err = 1;
+    }
+    printf ("  %s with prefix '%s': %d (%.6f s)\n", (attrs ? "attributes" : "variables"), prefix, nfound, t);
+    free (ids);
+    return err;
+}
+
+int main (int argc, char ** argv)
+{
+    int nvars = 100000, nattrs;
+    ADIOS_FILE * f;
+    ADIOS_VARINFO * vi;
+    char name[64], expected[32];
+    int *order;
+    unsigned int seed = 11;
+    int i, k, nlinear, err = 0;
+    double t, tvar, tattr, tlinear;
+    static const char * prefixes[] = { "/sim/g007/", "sim/g00", "/sim/g0", "/sim/g001/v0102", "/nothing", "/" };
+
+    if (argc > 1)
+    {
+        nvars = atoi (argv[1]);
+    }
+    if (nvars < 1)
+    {
+        printf ("ERROR: number of variables must be at least 1\n");
+        return 1;
+    }
+
+    adios_init_noxml (MPI_COMM_SELF);
+    adios_read_init_method (ADIOS_READ_METHOD_BP, MPI_COMM_SELF, "");
+
+    nattrs = (nvars + NATTR_EVERY - 1) / NATTR_EVERY;
+    t = now ();
+    if (write_file (nvars))
+        return 1;
+    printf ("Wrote %d variables and %d attributes in %.3f s\n", nvars, nattrs, now () - t);
+
+    f = adios_read_open_file (FILENAME, ADIOS_READ_METHOD_BP, MPI_COMM_SELF);
+    if (!f)
+    {
+        printf ("ERROR: cannot open %s: %s\n", FILENAME, adios_errmsg ());
+        return 1;
+    }
+    if (f->nvars < nvars || f->nattrs < nattrs)
+    {
+        printf ("ERROR: file has %d variables and %d attributes, expected %d and %d\n",
+                f->nvars, f->nattrs, nvars, nattrs);
+        return 1;
+    }
+
+    /* random order of lookups */
+    order = (int *) malloc (nvars * sizeof (int));
+    for (i = 0; i < nvars; i++)
+        order[i] = i;
+    for (i = nvars - 1; i > 0; i--)
+    {
+        int j = lcg (&seed) % (i + 1);
+        k = order[i]; order[i] = order[j]; order[j] = k;
+    }
+
+    /* variables, every other one without the leading / */
+    t = now ();
+    for (k = 0; k < nvars && !err; k++)
+    {
+        i = order[k];
+        var_path (i, name);
+        sprintf (name + strlen (name), "/v%05d", i);
+        vi = adios_inq_var (f, (k % 2 ? name + 1 : name));
+        if (!vi)
+        {
+            printf ("ERROR: variable %s not found: %s\n", name, adios_errmsg ());
+            err = 1;
+            break;
+        }
+        if (*(int *) vi->value != i || vi->nattrs != (i % NATTR_EVERY == 0) ||
+            (vi->nattrs && strcmp (f->attr_namelist[vi->attr_ids[0]] + strlen (name), "/unit")))
+        {
+            printf ("ERROR: variable %s has value %d and %d attributes\n", name, *(int *) vi->value, vi->nattrs);
+            err = 1;
+        }
+        adios_free_varinfo (vi);
+    }
+    tvar = now () - t;
+
+    /* attributes */
+    t = now ();
+    for (k = 0; k < nvars && !err; k++)
+    {
+        enum ADIOS_DATATYPES type;
+        int size;
+        void *data;
+        i = order[k];
+        if (i % NATTR_EVERY)
+            continue;
+        var_path (i, name);
+        sprintf (name + strlen (name), "/v%05d/unit", i);
+        if (adios_get_attr (f, (k % 2 ? name + 1 : name), &type, &size, &data))
+        {
+            printf ("ERROR: attribute %s not found: %s\n", name, adios_errmsg ());
+            err = 1;
+            break;
+        }
+        sprintf (expected, "u%d", i);
+        if (type != adios_string || strcmp ((char *) data, expected))
+        {
+            printf ("ERROR: attribute %s has value %s instead of %s\n", name, (char *) data, expected);
+            err = 1;
+        }
+        free (data);
+    }
+    tattr = now () - t;
+
+    /* the variable lookups with a linear search of the list */
+    nlinear = (nvars < NLINEAR ? nvars : NLINEAR);
+    t = now ();
+    for (k = 0; k < nlinear && !err; k++)
+    {
+        i = order[k];
+        var_path (i, name);
+        sprintf (name + strlen (name), "/v%05d", i);
+        if (linear_search (f->nvars, f->var_namelist, name) < 0)
+        {
+            printf ("ERROR: variable %s is not in the list\n", name);
+            err = 1;
+        }
+    }
+    tlinear = (now () - t) * nvars / nlinear;
+
+    if (!err)
+    {
+        printf ("Lookup of %d variables and %d attributes by name:\n", nvars, nattrs);
+        printf ("  adios_inq_var:  %.3f s\n", tvar);
+        printf ("  adios_get_attr: %.3f s\n", tattr);
+        printf ("  linear search of the variables: %.3f s (estimated from %d names)\n", tlinear, nlinear);
+    }
+
+    if (!err && (adios_inq_var (f, "/sim/nothing") || adios_errno != err_invalid_varname))
+    {
+        printf ("ERROR: a missing variable was found\n");
+        err = 1;
+    }
+
+    printf ("Prefix search:\n");
+    for (k = 0; k < sizeof (prefixes) / sizeof (prefixes[0]) && !err; k++)
+    {
+        err = check_prefix (f, 0, prefixes[k]) || check_prefix (f, 1, prefixes[k]);
+    }
+
+    free (order);
+    adios_read_close (f);
+
+    if (!err)
+        err = check_both_spellings ();
+
+    adios_read_finalize_method (ADIOS_READ_METHOD_BP);
+    adios_finalize (0);
+    if (err)
+        printf ("FAILED\n");
+    else
+        printf ("OK\n");
+    return err;
+}
@@ -0,0 +1,220 @@
+/*
+ * ADIOS is freely available under the terms of the BSD license described
+ * in the COPYING file in the top level directory of this source distribution.
+ *
+ * Copyright (c) 2008 - 2009.  UT-BATTELLE, LLC. All rights reserved.
+ */
+
+/* ADIOS test: blocking perform_reads with several threads.
+ *
+ * Write NVARS arrays of N doubles in NB blocks, half of them with the zlib
+ * transform, plus a scalar. Then schedule one read per array (bounding boxes
+ * that cross blocks, and writeblocks), a point selection and the scalar, and
+ * perform them at once without threads and with read_threads=4. Every value
+ * is checked and the times are printed.
+ *
+ * How to run: perform_threads [N]
+ * Output: perform_threads.bp, timings, non-zero exit code on mismatch
+ *
+ * This is a sequential test.
+ */
+#ifndef _NOMPI
+#define _NOMPI
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <sys/time.h>
+#include "public/adios.h"
+#include "public/adios_read.h"
+
+#define NB 4
+#define NVARS 32
+#define NPOINTS 5
+#define REPEAT 3
+
+static const char FILENAME[] = "perform_threads.bp";
+
+static double now ()
+{
+    struct timeval tp;
+    gettimeofday (&tp, NULL);
+    return (double) tp.tv_sec + (double) tp.tv_usec * 1.0e-6;
+}
+
+static double value (int var, uint64_t i)
+{
+    return var * 1.0e8 + (double) i;
+}
+
+static void write_file (uint64_t n)
+{
+    int64_t group, fh, varid;
+    uint64_t ldim = n / NB, off, i;
+    double * block = (double *) malloc (ldim * sizeof (double));
+    char name[32];
+    int v, k, scalar = 42;
+
+    adios_declare_group (&group, "threads", "", adios_stat_no);
+    adios_select_method (group, "POSIX", "", "");
+    adios_define_var (group, "n", "", adios_unsigned_long, "", "", "");
+    adios_define_var (group, "ldim", "", adios_unsigned_long, "", "", "");
+    adios_define_var (group, "off", "", adios_unsigned_long, "", "", "");
+    adios_define_var (group, "scalar", "", adios_integer, "", "", "");
+    for (v = 0; v < NVARS; v++)
+    {
+        sprintf (name, "v%d", v);
+        varid = adios_define_var (group, name, "", adios_double, "ldim", "n", "off");
+        if (v % 2)
+            adios_set_transform (varid, "zlib");
+    }
+
+    adios_open (&fh, "threads", FILENAME, "w", MPI_COMM_SELF);
+    adios_write (fh, "n", &n);
+    adios_write (fh, "ldim", &ldim);
+    adios_write (fh, "scalar", &scalar);
+    for (k = 0; k < NB; k++)
+    {
+        off = k * ldim;
+        adios_write (fh, "off", &off);
+        for (v = 0; v < NVARS; v++)
+        {
+            for (i = 0; i < ldim; i++)
+                block [i] = value (v, off + i);
+            sprintf (name, "v%d", v);
+            adios_write (fh, name, block);
+        }
+    }
+    adios_close (fh);
+    free (block);
+}
+
+/* Even variables read block v % NB, odd ones a box over the middle blocks */
+static int read_all (uint64_t n, const char * params, double * t_read)
+{
+    ADIOS_FILE * f;
+    ADIOS_SELECTION * sel[NVARS], * pts;
+    uint64_t ldim = n / NB, start = ldim / 2, count = n - ldim;
+    uint64_t points[NPOINTS], i, first;
+    double * data[NVARS], pdata[NPOINTS];
+    char name[32];
+    int v, k, scalar, err = 0;
+
+    for (k = 0; k < NPOINTS; k++)
+        points[k] = (n - 1) * k / (NPOINTS - 1);
+
+    adios_read_init_method (ADIOS_READ_METHOD_BP, MPI_COMM_SELF, params);
+    f = adios_read_open_file (FILENAME, ADIOS_READ_METHOD_BP, MPI_COMM_SELF);
+    if (!f)
+    {
+        printf ("ERROR: cannot open %s: %s\n", FILENAME, adios_errmsg ());
+        adios_read_finalize_method (ADIOS_READ_METHOD_BP);
+        return 1;
+    }
+    for (v = 0; v < NVARS; v++)
+    {
+        sel[v] = (v % 2 ? adios_selection_boundingbox (1, &start, &count)
+                        : adios_selection_writeblock (v % NB));
+        data[v] = (double *) malloc (count * sizeof (double));
+    }
+    pts = adios_selection_points (1, NPOINTS, points);
+
+    *t_read = 0;
+    for (k = 0; k < REPEAT && !err; k++)
+    {
+        double t = now ();
+        for (v = 0; v < NVARS; v++)
+        {
+            memset (data[v], 0, count * sizeof (double));
+            sprintf (name, "v%d", v);
+            adios_schedule_read (f, sel[v], name, 0, 1, data[v]);
+        }
+        scalar = 0;
+        memset (pdata, 0, sizeof (pdata));
+        adios_schedule_read (f, NULL, "scalar", 0, 1, &scalar);
+        adios_schedule_read (f, pts, "v0", 0, 1, pdata);
+        adios_perform_reads (f, 1);
+        *t_read += now () - t;
+
+        for (v = 0; v < NVARS && !err; v++)
+        {
+            first = (v % 2 ? start : (uint64_t) (v % NB) * ldim);
+            for (i = 0; i < (v % 2 ? count : ldim); i++)
+            {
+                if (data[v][i] != value (v, first + i))
+                {
+                    printf ("ERROR: %s: v%d[%llu] = %g instead of %g\n", params, v,
+                            (unsigned long long) (first + i), data[v][i], value (v, first + i));
+                    err = 1;
+                    break;
+                }
+            }
+        }
+        for (i = 0; i < NPOINTS && !err; i++)
+        {
+            if (pdata[i] != value (0, points[i]))
+            {
+                printf ("ERROR: %s: point %llu of v0 = %g instead of %g\n", params,
+                        (unsigned long long) points[i], pdata[i], value (0, points[i]));
+                err = 1;
+            }
+        }
+        if (!err && scalar != 42)
+        {
+            printf ("ERROR: %s: scalar = %d instead of 42\n", params, scalar);
+            err = 1;
+        }
+    }
+
+    for (v = 0; v < NVARS; v++)
+    {
+        adios_selection_delete (sel[v]);
+        free (data[v]);
+    }
+    adios_selection_delete (pts);
+    adios_read_close (f);
+    adios_read_finalize_method (ADIOS_READ_METHOD_BP);
+    return err;
+}
+
+int main (int argc, char ** argv)
+{
+    uint64_t n = 256*1024;
+    double t_seq, t_threads;
+    int err;
+
+    if (argc > 1)
+    {
+        n = atoi (argv[1]);
+    }
+    if (n < NB * 2)
+    {
+        printf ("ERROR: N must be at least %d\n", NB * 2);
+        return 1;
+    }
+    n = n / NB * NB;
+
+    adios_init_noxml (MPI_COMM_SELF);
+    write_file (n);
+    adios_finalize (0);
+
+    printf ("Read %d arrays of %llu doubles, half of them with zlib, %d times\n",
+            NVARS, (unsigned long long) n, REPEAT);
+    err = read_all (n, "", &t_seq);
+    if (!err)
+        err = read_all (n, "read_threads=4", &t_threads);
+    if (!err)
+    {
+        printf ("  time in perform_reads:\n");
+        printf ("  one thread:             %.3f s\n", t_seq);
+        printf ("  read_threads=4:         %.3f s\n", t_threads);
+    }
+
+    if (err)
+        printf ("FAILED\n");
+    else
+        printf ("OK\n");
+    return err;
+}
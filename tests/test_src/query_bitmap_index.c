@@ -0,0 +1,417 @@
+/*
+ * ADIOS is freely available under the terms of the BSD license described
+ * in the COPYING file in the top level directory of this source distribution.
+ *
+ * Copyright (c) 2008 - 2009.  UT-BATTELLE, LLC. All rights reserved.
+ */
+
+/* ADIOS test: the write-time bitmap index and the BITMAP query method.
+ *
+ * A 2D double array (with some NaN values) and a 2D integer array with few
+ * distinct values are written in blocks over two steps with a bitmap index
+ * (adios_set_index). Single conditions and AND/OR combinations are evaluated
+ * with the BITMAP query method over the whole arrays and over a bounding box
+ * that cuts through blocks, in small batches, and the returned points are
+ * compared to the points matching the written values. Evaluation times are
+ * printed.
+ *
+ * How to run: query_bitmap_index [number of blocks in each dimension]
+ * Output: query_bitmap_index.bp and query_bitmap_index.bp.idx, timings,
+ *         non-zero exit code on mismatch
+ *
+ * This is a sequential test.
+ */
+#ifndef _NOMPI
+#define _NOMPI
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <inttypes.h>
+#include <string.h>
+#include <math.h>
+#include <sys/time.h>
+#include "public/adios.h"
+#include "public/adios_read.h"
+#include "public/adios_query.h"
+
+#define BX 20
+#define BY 30
+#define NSTEPS 2
+#define BATCH 500
+
+static const char FILENAME[] = "query_bitmap_index.bp";
+
+static double now ()
+{
+    struct timeval tp;
+    gettimeofday (&tp, NULL);
+    return (double) tp.tv_sec + (double) tp.tv_usec * 1.0e-6;
+}
+
+/* the written arrays of each step */
+static uint64_t NX, NY;
+static double *tdata;
+static int *idata;
+
+static int write_file (int nb)
+{
+    int64_t group, fh;
+    int64_t *tids, *iids;
+    double *t;
+    int *iv;
+    char ldim[32], gdim[32], off[32];
+    int bx, by, s;
+    uint64_t x, y;
+
+    tids = (int64_t *) malloc (nb * nb * sizeof (int64_t));
+    iids = (int64_t *) malloc (nb * nb * sizeof (int64_t));
+    t = (double *) malloc (BX * BY * sizeof (double));
+    iv = (int *) malloc (BX * BY * sizeof (int));
+    if (!tids || !iids || !t || !iv)
+    {
+        printf ("ERROR: cannot allocate %d blocks\n", nb * nb);
+        return 1;
+    }
+
+    adios_declare_group (&group, "bitmap", "", adios_stat_no);
+    adios_select_method (group, "POSIX", "", "");
+    snprintf (ldim, sizeof (ldim), "%d,%d", BX, BY);
+    snprintf (gdim, sizeof (gdim), "%" PRIu64 ",%" PRIu64, NX, NY);
+    for (bx = 0; bx < nb; bx++)
+    {
+        for (by = 0; by < nb; by++)
+        {
+            int b = bx * nb + by;
+            snprintf (off, sizeof (off), "%d,%d", bx * BX, by * BY);
+            tids[b] = adios_define_var (group, "t", "", adios_double, ldim, gdim, off);
+            adios_set_index (tids[b], "bitmap:bins=16");
+            iids[b] = adios_define_var (group, "i", "", adios_integer, ldim, gdim, off);
+            adios_set_index (iids[b], "bitmap");
+        }
+    }
+
+    for (s = 0; s < NSTEPS; s++)
+    {
+        double *ts = tdata + s * NX * NY;
+        int *is = idata + s * NX * NY;
+        for (x = 0; x < NX; x++)
+        {
+            for (y = 0; y < NY; y++)
+            {
+                uint64_t k = x * NY + y;
+                ts[k] = sin (0.07 * x + 0.3 * s) * cos (0.05 * y);
+                if (k % 997 == 0)
+                    ts[k] = NAN;
+                else if (k % 101 == 0)
+                    ts[k] = 0.5;
+                is[k] = (int) ((x * 7 + y * 3 + s) % 16);
+            }
+        }
+
+        adios_open (&fh, "bitmap", FILENAME, (s ? "a" : "w"), MPI_COMM_SELF);
+        for (bx = 0; bx < nb; bx++)
+        {
+            for (by = 0; by < nb; by++)
+            {
+                int b = bx * nb + by;
+                for (x = 0; x < BX; x++)
+                {
+                    for (y = 0; y < BY; y++)
+                    {
+                        uint64_t k = (bx * BX + x) * NY + by * BY + y;
+                        t[x * BY + y] = ts[k];
+                        iv[x * BY + y] = is[k];
+                    }
+                }
+                adios_write_byid (fh, tids[b], t);
+                adios_write_byid (fh, iids[b], iv);
+            }
+        }
+        adios_close (fh);
+    }
+
+    free (tids);
+    free (iids);
+    free (t);
+    free (iv);
+    return 0;
+}
+
+/* A condition and its evaluation on an element; NaN values only match != */
+struct cond
+{
+    const char * varname;
+    enum ADIOS_PREDICATE_MODE op;
+    const char * value;
+};
+
+static int element_matches (const struct cond * c, int s, uint64_t k)
+{
+    double v = strtod (c->value, NULL);
+    double x = (c->varname[0] == 't' ? tdata[s * NX * NY + k] : (double) idata[s * NX * NY + k]);
+    switch (c->op)
+    {
+        case ADIOS_LT:   return x < v;
+        case ADIOS_LTEQ: return x <= v;
+        case ADIOS_GT:   return x > v;
+        case ADIOS_GTEQ: return x >= v;
+        case ADIOS_EQ:   return x == v;
+        case ADIOS_NE:   return x != v;
+    }
+    return 0;
+}
+
+/* Query trees: a single condition (c1 < 0), or c0 op1 c1, or (c0 op1 c1) op2 c2 */
+struct tree
+{
+    const char * name;
+    int c0, c1, c2;
+    enum ADIOS_CLAUSE_OP_MODE op1, op2;
+};
+
+static const struct cond conds[] = {
+    {"t", ADIOS_GT,   "0.5"},
+    {"t", ADIOS_LTEQ, "-0.25"},
+    {"t", ADIOS_EQ,   "0.5"},
+    {"t", ADIOS_NE,   "0.5"},
+    {"i", ADIOS_EQ,   "7"},
+    {"i", ADIOS_NE,   "3"},
+    {"i", ADIOS_GTEQ, "12"},
+    {"t", ADIOS_GT,   "10"},
+    {"t", ADIOS_NE,   "nan"},
+    {"t", ADIOS_EQ,   "nan"},
+};
+
+static const struct tree trees[] = {
+    {"t > 0.5",                           0, -1, -1, ADIOS_QUERY_OP_AND, ADIOS_QUERY_OP_AND},
+    {"t <= -0.25",                        1, -1, -1, ADIOS_QUERY_OP_AND, ADIOS_QUERY_OP_AND},
+    {"t == 0.5",                          2, -1, -1, ADIOS_QUERY_OP_AND, ADIOS_QUERY_OP_AND},
+    {"t != 0.5",                          3, -1, -1, ADIOS_QUERY_OP_AND, ADIOS_QUERY_OP_AND},
+    {"i == 7",                            4, -1, -1, ADIOS_QUERY_OP_AND, ADIOS_QUERY_OP_AND},
+    {"i != 3",                            5, -1, -1, ADIOS_QUERY_OP_AND, ADIOS_QUERY_OP_AND},
+    {"i >= 12",                           6, -1, -1, ADIOS_QUERY_OP_AND, ADIOS_QUERY_OP_AND},
+    {"t > 10",                            7, -1, -1, ADIOS_QUERY_OP_AND, ADIOS_QUERY_OP_AND},
+    {"t != nan",                          8, -1, -1, ADIOS_QUERY_OP_AND, ADIOS_QUERY_OP_AND},
+    {"t == nan",                          9, -1, -1, ADIOS_QUERY_OP_AND, ADIOS_QUERY_OP_AND},
+    {"t > 0.5 AND i == 7",                0,  4, -1, ADIOS_QUERY_OP_AND, ADIOS_QUERY_OP_AND},
+    {"t <= -0.25 OR i >= 12",             1,  6, -1, ADIOS_QUERY_OP_OR,  ADIOS_QUERY_OP_AND},
+    {"(t > 0.5 OR t <= -0.25) AND i != 3",
+                                          0,  1,  5, ADIOS_QUERY_OP_OR,  ADIOS_QUERY_OP_AND},
+};
+
+static int expected (const struct tree * t, int s, uint64_t k)
+{
+    int m = element_matches (&conds[t->c0], s, k);
+    if (t->c1 >= 0)
+    {
+        int m1 = element_matches (&conds[t->c1], s, k);
+        m = (t->op1 == ADIOS_QUERY_OP_AND ? m && m1 : m || m1);
+    }
+    if (t->c2 >= 0)
+    {
+        int m2 = element_matches (&conds[t->c2], s, k);
+        m = (t->op2 == ADIOS_QUERY_OP_AND ? m && m2 : m || m2);
+    }
+    return m;
+}
+
+/* Evaluate a query tree in every step and compare the returned points to the expected ones */
+static int check_tree (const uint64_t * start, const uint64_t * count, ADIOS_SELECTION * sel,
+                       const struct tree * t, ADIOS_QUERY ** leaves, char * returned)
+{
+    ADIOS_QUERY *q, *q1 = NULL, *q2 = NULL;
+    uint64_t n = count[0] * count[1], npoints = 0, i, x, y;
+    int err = 0, s;
+    double t0, t_eval = 0;
+
+    q = leaves[t->c0];
+    if (t->c1 >= 0)
+        q = q1 = adios_query_combine (q, t->op1, leaves[t->c1]);
+    if (q && t->c2 >= 0)
+        q = q2 = adios_query_combine (q, t->op2, leaves[t->c2]);
+    if (!q)
+    {
+        printf ("ERROR: cannot create %s: %s\n", t->name, adios_errmsg ());
+        if (q1)
+            adios_query_free (q1);
+        return 1;
+    }
+    adios_query_set_method (q, ADIOS_QUERY_METHOD_BITMAP);
+
+    for (s = 0; s < NSTEPS && !err; s++)
+    {
+        ADIOS_QUERY_RESULT * result;
+        uint64_t nexpected = 0, nstep = 0;
+        int64_t estimate = adios_query_estimate (q, s);
+
+        memset (returned, 0, n);
+        do
+        {
+            t0 = now ();
+            result = adios_query_evaluate (q, sel, s, BATCH);
+            t_eval += now () - t0;
+            if (result->status == ADIOS_QUERY_RESULT_ERROR)
+            {
+                printf ("ERROR: evaluating %s failed: %s\n", t->name, adios_errmsg ());
+                free (result);
+                err = 1;
+                break;
+            }
+            if (result->nselections)
+            {
+                ADIOS_SELECTION_POINTS_STRUCT * pts = &result->selections[0].u.points;
+                if (result->npoints > BATCH || pts->ndim != 2)
+                {
+                    printf ("ERROR: %s, step %d: %" PRIu64 " points in a batch of %d\n",
+                            t->name, s, result->npoints, BATCH);
+                    err = 1;
+                }
+                for (i = 0; i < pts->npoints && !err; i++)
+                {
+                    x = pts->points[2 * i];
+                    y = pts->points[2 * i + 1];
+                    if (x < start[0] || x >= start[0] + count[0] ||
+                        y < start[1] || y >= start[1] + count[1] ||
+                        returned[(x - start[0]) * count[1] + y - start[1]]++)
+                    {
+                        printf ("ERROR: %s, step %d: point (%" PRIu64 ",%" PRIu64 ") is "
+                                "out of the box or returned twice\n", t->name, s, x, y);
+                        err = 1;
+                    }
+                }
+                nstep += pts->npoints;
+                free (pts->points);
+                adios_selection_delete (pts->container_selection);
+                free (result->selections);
+            }
+            if (result->status == ADIOS_QUERY_NO_MORE_RESULTS)
+            {
+                free (result);
+                break;
+            }
+            free (result);
+        } while (!err);
+
+        for (x = 0; x < count[0] && !err; x++)
+        {
+            for (y = 0; y < count[1]; y++)
+            {
+                int e = expected (t, s, (start[0] + x) * NY + start[1] + y);
+                nexpected += e;
+                if (returned[x * count[1] + y] != e)
+                {
+                    printf ("ERROR: %s, step %d: point (%" PRIu64 ",%" PRIu64 ") is %s\n",
+                            t->name, s, start[0] + x, start[1] + y,
+                            (e ? "missing from the result" : "returned but does not match"));
+                    err = 1;
+                    break;
+                }
+            }
+        }
+        if (!err && estimate != (int64_t) nexpected)
+        {
+            printf ("ERROR: %s, step %d: estimate is %" PRId64 " instead of %" PRIu64 "\n",
+                    t->name, s, estimate, nexpected);
+            err = 1;
+        }
+        npoints += nstep;
+    }
+
+    printf ("%-40s %8" PRIu64 " points %10.6f s\n", t->name, npoints, t_eval);
+    if (q2)
+        adios_query_free (q2);
+    if (q1)
+        adios_query_free (q1);
+    return err;
+}
+
+static int run_queries (ADIOS_FILE * f, const uint64_t * start, const uint64_t * count, int whole)
+{
+    ADIOS_QUERY * leaves[sizeof (conds) / sizeof (conds[0])];
+    ADIOS_SELECTION * sel = NULL;
+    char * returned = (char *) malloc (count[0] * count[1]);
+    int err = 0, k;
+
+    if (!whole)
+        sel = adios_selection_boundingbox (2, start, count);
+
+    for (k = 0; k < sizeof (conds) / sizeof (conds[0]); k++)
+        leaves[k] = adios_query_create (f, sel, conds[k].varname, conds[k].op, conds[k].value);
+
+    // single conditions first: queries can only be combined after their
+    // selections have been checked at an evaluation
+    for (k = 0; k < sizeof (trees) / sizeof (trees[0]); k++)
+        err |= check_tree (start, count, sel, &trees[k], leaves, returned);
+
+    for (k = 0; k < sizeof (conds) / sizeof (conds[0]); k++)
+        adios_query_free (leaves[k]);
+    if (sel)
+        adios_selection_delete (sel);
+    free (returned);
+    return err;
+}
+
+int main (int argc, char ** argv)
+{
+    int nb = 3;
+    ADIOS_FILE * f;
+    int err = 0;
+
+    if (argc > 1)
+    {
+        nb = atoi (argv[1]);
+    }
+    if (nb < 2)
+    {
+        printf ("ERROR: number of blocks in each dimension must be at least 2\n");
+        return 1;
+    }
+    NX = nb * BX;
+    NY = nb * BY;
+
+    tdata = (double *) malloc (NSTEPS * NX * NY * sizeof (double));
+    idata = (int *) malloc (NSTEPS * NX * NY * sizeof (int));
+    if (!tdata || !idata)
+    {
+        printf ("ERROR: cannot allocate %" PRIu64 "x%" PRIu64 " arrays\n", NX, NY);
+        return 1;
+    }
+
+    adios_init_noxml (MPI_COMM_SELF);
+    adios_read_init_method (ADIOS_READ_METHOD_BP, MPI_COMM_SELF, "");
+
+    if (write_file (nb))
+        return 1;
+
+    f = adios_read_open_file (FILENAME, ADIOS_READ_METHOD_BP, MPI_COMM_SELF);
+    if (!f)
+    {
+        printf ("ERROR: cannot open %s: %s\n", FILENAME, adios_errmsg ());
+        return 1;
+    }
+
+    {
+        uint64_t start[2] = {0, 0};
+        uint64_t count[2] = {NX, NY};
+        printf ("Querying %" PRIu64 "x%" PRIu64 " arrays in %d blocks and %d steps\n",
+                NX, NY, nb * nb, NSTEPS);
+        err |= run_queries (f, start, count, 1);
+    }
+    {
+        uint64_t start[2] = {BX / 2 + 1, BY / 3};
+        uint64_t count[2] = {NX - BX, NY - BY / 2 - BY / 3};
+        printf ("With a bounding box of %" PRIu64 "x%" PRIu64 " at %" PRIu64 ",%" PRIu64 "\n",
+                count[0], count[1], start[0], start[1]);
+        err |= run_queries (f, start, count, 0);
+    }
+
+    adios_read_close (f);
+    free (tdata);
+    free (idata);
+
+    adios_read_finalize_method (ADIOS_READ_METHOD_BP);
+    adios_finalize (0);
+    return err;
+}
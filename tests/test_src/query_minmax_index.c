@@ -0,0 +1,344 @@
+/*
+ * ADIOS is freely available under the terms of the BSD license described
+ * in the COPYING file in the top level directory of this source distribution.
+ *
+ * Copyright (c) 2008 - 2009.  UT-BATTELLE, LLC. All rights reserved.
+ */
+
+/* ADIOS test: the min/max block index of the minmax query method.
+ *
+ * A 1D double array and a 1D integer array are written in many small blocks
+ * over two steps, some blocks holding a constant value. Single conditions with
+ * every predicate and AND/OR combinations of them are evaluated with the minmax
+ * query method, with and without a bounding box selection, and the returned
+ * blocks are compared to the blocks expected from the written min/max values.
+ * Evaluation times are printed.
+ *
+ * How to run: query_minmax_index [number of blocks]
+ * Output: query_minmax_index.bp, timings, non-zero exit code on mismatch
+ *
+ * This is a sequential test.
+ */
+#ifndef _NOMPI
+#define _NOMPI
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <inttypes.h>
+#include <string.h>
+#include <sys/time.h>
+#include "public/adios.h"
+#include "public/adios_read.h"
+#include "public/adios_query.h"
+
+#define BLOCKSIZE 8
+#define NSTEPS 2
+
+static const char FILENAME[] = "query_minmax_index.bp";
+
+static double now ()
+{
+    struct timeval tp;
+    gettimeofday (&tp, NULL);
+    return (double) tp.tv_sec + (double) tp.tv_usec * 1.0e-6;
+}
+
+/* min and max of each block of each step, as written */
+static double *dmin, *dmax;
+static int *imin, *imax;
+
+static unsigned int lcg (unsigned int *seed)
+{
+    *seed = *seed * 1103515245u + 12345u;
+    return (*seed >> 8) & 0xffff;
+}
+
+static int write_file (int nblocks)
+{
+    int64_t group, fh;
+    int64_t *dids, *iids;
+    double d[BLOCKSIZE];
+    int iv[BLOCKSIZE];
+    char ldim[32], gdim[32], off[32];
+    unsigned int seed = 7;
+    int b, j, s;
+
+    dids = (int64_t *) malloc (nblocks * sizeof (int64_t));
+    iids = (int64_t *) malloc (nblocks * sizeof (int64_t));
+    if (!dids || !iids)
+    {
+        printf ("ERROR: cannot allocate %d variable ids\n", nblocks);
+        return 1;
+    }
+
+    adios_declare_group (&group, "index", "", adios_stat_minmax);
+    adios_select_method (group, "POSIX", "", "");
+    snprintf (ldim, sizeof (ldim), "%d", BLOCKSIZE);
+    snprintf (gdim, sizeof (gdim), "%d", nblocks * BLOCKSIZE);
+    for (b = 0; b < nblocks; b++)
+    {
+        snprintf (off, sizeof (off), "%d", b * BLOCKSIZE);
+        dids[b] = adios_define_var (group, "d", "", adios_double, ldim, gdim, off);
+        iids[b] = adios_define_var (group, "i", "", adios_integer, ldim, gdim, off);
+    }
+
+    for (s = 0; s < NSTEPS; s++)
+    {
+        adios_open (&fh, "index", FILENAME, (s ? "a" : "w"), MPI_COMM_SELF);
+        for (b = 0; b < nblocks; b++)
+        {
+            int k = s * nblocks + b;
+            double base = (double) lcg (&seed) * 0.01;
+            double spread = (b % 10 == 3 ? 0.0 : (double) (lcg (&seed) % 100) * 0.01);
+            int ibase = (int) lcg (&seed) - 32768;
+            int ispread = (b % 10 == 5 ? 0 : (int) (lcg (&seed) % 50));
+            for (j = 0; j < BLOCKSIZE; j++)
+            {
+                d[j] = base + j * spread;
+                iv[j] = ibase + j * ispread;
+            }
+            dmin[k] = d[0]; dmax[k] = d[BLOCKSIZE - 1];
+            imin[k] = iv[0]; imax[k] = iv[BLOCKSIZE - 1];
+            adios_write_byid (fh, dids[b], d);
+            adios_write_byid (fh, iids[b], iv);
+        }
+        adios_close (fh);
+    }
+
+    free (dids);
+    free (iids);
+    return 0;
+}
+
+/* A condition and its evaluation on the written min/max values of a block */
+struct cond
+{
+    const char * varname;
+    enum ADIOS_PREDICATE_MODE op;
+    const char * value;
+};
+
+static int block_matches (const struct cond * c, int k)
+{
+    double v = strtod (c->value, NULL);
+    double mn = (c->varname[0] == 'd' ? dmin[k] : (double) imin[k]);
+    double mx = (c->varname[0] == 'd' ? dmax[k] : (double) imax[k]);
+    switch (c->op)
+    {
+        case ADIOS_LT:   return mn < v;
+        case ADIOS_LTEQ: return mn <= v;
+        case ADIOS_GT:   return mx > v;
+        case ADIOS_GTEQ: return mx >= v;
+        case ADIOS_EQ:   return mn <= v && v <= mx;
+        case ADIOS_NE:   return !(mn == v && mx == v);
+    }
+    return 0;
+}
+
+/* Query trees: a single condition (c1 < 0), or c0 op1 c1, or (c0 op1 c1) op2 c2.
+ * Every condition is evaluated alone before it is combined, since queries can only
+ * be combined after their selections have been checked at an evaluation.
+ */
+struct tree
+{
+    const char * name;
+    int c0, c1, c2;
+    enum ADIOS_CLAUSE_OP_MODE op1, op2;
+};
+
+static const struct cond conds[] = {
+    {"d", ADIOS_GTEQ, "300.5"},
+    {"d", ADIOS_LT,   "400"},
+    {"d", ADIOS_EQ,   "123.45"},
+    {"d", ADIOS_NE,   "0"},
+    {"i", ADIOS_GT,   "20000"},
+    {"i", ADIOS_LTEQ, "-10000"},
+    {"i", ADIOS_NE,   "-32768"},
+    {"d", ADIOS_GT,   "1e9"},
+};
+
+static const struct tree trees[] = {
+    {"d >= 300.5",                        0, -1, -1, ADIOS_QUERY_OP_AND, ADIOS_QUERY_OP_AND},
+    {"d < 400",                           1, -1, -1, ADIOS_QUERY_OP_AND, ADIOS_QUERY_OP_AND},
+    {"d == 123.45",                       2, -1, -1, ADIOS_QUERY_OP_AND, ADIOS_QUERY_OP_AND},
+    {"d != 0",                            3, -1, -1, ADIOS_QUERY_OP_AND, ADIOS_QUERY_OP_AND},
+    {"i > 20000",                         4, -1, -1, ADIOS_QUERY_OP_AND, ADIOS_QUERY_OP_AND},
+    {"i <= -10000",                       5, -1, -1, ADIOS_QUERY_OP_AND, ADIOS_QUERY_OP_AND},
+    {"i != -32768",                       6, -1, -1, ADIOS_QUERY_OP_AND, ADIOS_QUERY_OP_AND},
+    {"d > 1e9",                           7, -1, -1, ADIOS_QUERY_OP_AND, ADIOS_QUERY_OP_AND},
+    {"d >= 300.5 AND d < 400",            0,  1, -1, ADIOS_QUERY_OP_AND, ADIOS_QUERY_OP_AND},
+    {"d == 123.45 OR i > 20000",          2,  4, -1, ADIOS_QUERY_OP_OR,  ADIOS_QUERY_OP_AND},
+    {"(d >= 300.5 OR i > 20000) AND i <= -10000",
+                                          0,  4,  5, ADIOS_QUERY_OP_OR,  ADIOS_QUERY_OP_AND},
+    {"(d > 1e9 AND d < 400) OR i <= -10000",
+                                          7,  1,  5, ADIOS_QUERY_OP_AND, ADIOS_QUERY_OP_OR},
+};
+
+static int expected (const struct tree * t, int k)
+{
+    int m = block_matches (&conds[t->c0], k);
+    if (t->c1 >= 0)
+    {
+        int m1 = block_matches (&conds[t->c1], k);
+        m = (t->op1 == ADIOS_QUERY_OP_AND ? m && m1 : m || m1);
+    }
+    if (t->c2 >= 0)
+    {
+        int m2 = block_matches (&conds[t->c2], k);
+        m = (t->op2 == ADIOS_QUERY_OP_AND ? m && m2 : m || m2);
+    }
+    return m;
+}
+
+/* Evaluate a query tree in every step and compare the returned blocks to the expected ones */
+static int check_tree (ADIOS_FILE * f, ADIOS_SELECTION * sel, int nblocks, int first, int last,
+                       const struct tree * t, ADIOS_QUERY ** leaves, char * returned)
+{
+    ADIOS_QUERY *q, *q1 = NULL, *q2 = NULL;
+    int err = 0, s, n, b;
+    double t0, t_eval = 0;
+    int nreturned = 0;
+
+    q = leaves[t->c0];
+    if (t->c1 >= 0)
+        q = q1 = adios_query_combine (q, t->op1, leaves[t->c1]);
+    if (q && t->c2 >= 0)
+        q = q2 = adios_query_combine (q, t->op2, leaves[t->c2]);
+    if (!q)
+    {
+        printf ("ERROR: cannot create %s: %s\n", t->name, adios_errmsg ());
+        if (q1)
+            adios_query_free (q1);
+        return 1;
+    }
+    adios_query_set_method (q, ADIOS_QUERY_METHOD_MINMAX);
+
+    for (s = 0; s < NSTEPS; s++)
+    {
+        ADIOS_QUERY_RESULT * result;
+
+        t0 = now ();
+        result = adios_query_evaluate (q, sel, s, nblocks);
+        t_eval += now () - t0;
+
+        if (result->status == ADIOS_QUERY_RESULT_ERROR)
+        {
+            printf ("ERROR: evaluating %s failed: %s\n", t->name, adios_errmsg ());
+            free (result);
+            err = 1;
+            break;
+        }
+
+        memset (returned, 0, nblocks);
+        for (n = 0; n < result->nselections; n++)
+            returned[result->selections[n].u.block.index] = 1;
+        nreturned += result->nselections;
+        free (result->selections);
+        free (result);
+
+        for (b = 0; b < nblocks; b++)
+        {
+            int e = (b >= first && b <= last && expected (t, s * nblocks + b));
+            if (returned[b] != e)
+            {
+                printf ("ERROR: %s, step %d: block %d is %s\n", t->name, s, b,
+                        (e ? "missing from the result" : "returned but does not match"));
+                err = 1;
+                break;
+            }
+        }
+    }
+
+    printf ("%-44s %8d blocks %10.6f s\n", t->name, nreturned, t_eval);
+    if (q2)
+        adios_query_free (q2);
+    if (q1)
+        adios_query_free (q1);
+    return err;
+}
+
+static int run_queries (ADIOS_FILE * f, int nblocks, int first, int last, char * returned)
+{
+    ADIOS_QUERY * leaves[sizeof (conds) / sizeof (conds[0])];
+    ADIOS_SELECTION * sel = NULL;
+    int err = 0, k;
+
+    if (first > 0 || last < nblocks - 1)
+    {
+        uint64_t start = first * BLOCKSIZE;
+        uint64_t count = (last - first + 1) * BLOCKSIZE;
+        sel = adios_selection_boundingbox (1, &start, &count);
+    }
+
+    for (k = 0; k < sizeof (conds) / sizeof (conds[0]); k++)
+        leaves[k] = adios_query_create (f, sel, conds[k].varname, conds[k].op, conds[k].value);
+
+    for (k = 0; k < sizeof (trees) / sizeof (trees[0]); k++)
+        err |= check_tree (f, sel, nblocks, first, last, &trees[k], leaves, returned);
+
+    for (k = 0; k < sizeof (conds) / sizeof (conds[0]); k++)
+        adios_query_free (leaves[k]);
+    if (sel)
+        adios_selection_delete (sel);
+    return err;
+}
+
+int main (int argc, char ** argv)
+{
+    int nblocks = 20000;
+    ADIOS_FILE * f;
+    char * returned;
+    int err = 0;
+
+    if (argc > 1)
+    {
+        nblocks = atoi (argv[1]);
+    }
+    if (nblocks < 10)
+    {
+        printf ("ERROR: number of blocks must be at least 10\n");
+        return 1;
+    }
+
+    dmin = (double *) malloc (NSTEPS * nblocks * sizeof (double));
+    dmax = (double *) malloc (NSTEPS * nblocks * sizeof (double));
+    imin = (int *) malloc (NSTEPS * nblocks * sizeof (int));
+    imax = (int *) malloc (NSTEPS * nblocks * sizeof (int));
+    returned = (char *) malloc (nblocks);
+    if (!dmin || !dmax || !imin || !imax || !returned)
+    {
+        printf ("ERROR: cannot allocate the statistics of %d blocks\n", nblocks);
+        return 1;
+    }
+
+    adios_init_noxml (MPI_COMM_SELF);
+    adios_read_init_method (ADIOS_READ_METHOD_BP, MPI_COMM_SELF, "");
+
+    if (write_file (nblocks))
+        return 1;
+
+    f = adios_read_open_file (FILENAME, ADIOS_READ_METHOD_BP, MPI_COMM_SELF);
+    if (!f)
+    {
+        printf ("ERROR: cannot open %s: %s\n", FILENAME, adios_errmsg ());
+        return 1;
+    }
+
+    printf ("Querying %d blocks in %d steps\n", nblocks, NSTEPS);
+    err |= run_queries (f, nblocks, 0, nblocks - 1, returned);
+    printf ("With a bounding box over blocks %d..%d\n", nblocks / 4, nblocks / 2);
+    err |= run_queries (f, nblocks, nblocks / 4, nblocks / 2, returned);
+
+    adios_read_close (f);
+    free (dmin);
+    free (dmax);
+    free (imin);
+    free (imax);
+    free (returned);
+
+    adios_read_finalize_method (ADIOS_READ_METHOD_BP);
+    adios_finalize (0);
+    return err;
+}
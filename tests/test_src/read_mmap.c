@@ -0,0 +1,226 @@
+/*
+ * ADIOS is freely available under the terms of the BSD license described
+ * in the COPYING file in the top level directory of this source distribution.
+ *
+ * Copyright (c) 2008 - 2009.  UT-BATTELLE, LLC. All rights reserved.
+ */
+
+/* ADIOS test: reads served from memory mapped files (the 'mmap' read parameter).
+ *
+ * Write a step of an array in NB blocks and read it as a stream with mmap:
+ *   - every block without a user buffer, the chunks point into the mapping
+ *   - a box across the blocks into a user buffer
+ * Then append NSTEPS-1 more steps to the open file, so that it is mapped
+ * again, and read them the same way. The chunks of the first step are kept
+ * and checked again after the file has grown, and the values are compared to
+ * a read without mmap.
+ *
+ * How to run: read_mmap [N]
+ * Output: read_mmap.bp, non-zero exit code on mismatch
+ *
+ * This is a sequential test.
+ */
+#ifndef _NOMPI
+#define _NOMPI
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include "public/adios.h"
+#include "public/adios_read.h"
+
+#define NB 4
+#define NSTEPS 3
+
+static const char FILENAME[] = "read_mmap.bp";
+
+static double value (int step, uint64_t i)
+{
+    return step * 1.0e8 + (double) i;
+}
+
+static void write_step (int s, uint64_t n)
+{
+    int64_t fh;
+    uint64_t ldim = n / NB, off, i;
+    double * block = (double *) malloc (ldim * sizeof (double));
+    int b;
+
+    adios_open (&fh, "mmap", FILENAME, (s ? "a" : "w"), MPI_COMM_SELF);
+    adios_write (fh, "n", &n);
+    adios_write (fh, "ldim", &ldim);
+    for (b = 0; b < NB; b++)
+    {
+        off = b * ldim;
+        for (i = 0; i < ldim; i++)
+            block [i] = value (s, off + i);
+        adios_write (fh, "off", &off);
+        adios_write (fh, "data", block);
+    }
+    adios_close (fh);
+    free (block);
+}
+
+static int check_values (const double * data, int s, uint64_t first, uint64_t count, const char * how)
+{
+    uint64_t i;
+    for (i = 0; i < count; i++)
+    {
+        if (data [i] != value (s, first + i))
+        {
+            printf ("ERROR: %s: step %d [%llu] = %g instead of %g\n", how, s,
+                    (unsigned long long) (first + i), data [i], value (s, first + i));
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/* Read the blocks of the current step without a user buffer. Each chunk is
+   checked when it arrives; with mmap they are valid until close and kept in
+   chunks, otherwise they are freed. */
+static int read_blocks (ADIOS_FILE * f, int s, uint64_t n, int keep, ADIOS_VARCHUNK ** chunks)
+{
+    ADIOS_SELECTION * wb [NB];
+    ADIOS_VARCHUNK * chunk;
+    uint64_t ldim = n / NB;
+    int b, k = 0, err = 0;
+
+    for (b = 0; b < NB; b++)
+    {
+        wb [b] = adios_selection_writeblock (b);
+        adios_schedule_read (f, wb [b], "data", 0, 1, NULL);
+    }
+    adios_perform_reads (f, 0);
+    while (adios_check_reads (f, &chunk) > 0 && chunk)
+    {
+        err = err || check_values ((double *) chunk->data, s,
+                                   chunk->sel->u.block.index * ldim, ldim, "block");
+        if (keep && k < NB)
+            chunks [k] = chunk;
+        else
+            adios_free_chunk (chunk);
+        k++;
+    }
+    if (k != NB)
+    {
+        printf ("ERROR: step %d: %d chunks instead of %d\n", s, k, NB);
+        err = 1;
+    }
+    for (b = 0; b < NB; b++)
+        adios_selection_delete (wb [b]);
+    return err;
+}
+
+/* A box over the middle of the array, into a user buffer */
+static int read_box (ADIOS_FILE * f, int s, uint64_t n, const char * how)
+{
+    uint64_t start = n / NB / 2, count = n - n / NB;
+    ADIOS_SELECTION * sel = adios_selection_boundingbox (1, &start, &count);
+    double * data = (double *) calloc (count, sizeof (double));
+    int err;
+
+    adios_schedule_read (f, sel, "data", 0, 1, data);
+    adios_perform_reads (f, 1);
+    err = check_values (data, s, start, count, how);
+    adios_selection_delete (sel);
+    free (data);
+    return err;
+}
+
+static int read_stream (uint64_t n, const char * params, int keep)
+{
+    ADIOS_FILE * f;
+    ADIOS_VARCHUNK * first [NB], * chunks [NB];
+    uint64_t ldim = n / NB;
+    int s, b, err = 0;
+
+    adios_read_init_method (ADIOS_READ_METHOD_BP, MPI_COMM_SELF, params);
+    f = adios_read_open (FILENAME, ADIOS_READ_METHOD_BP, MPI_COMM_SELF, ADIOS_LOCKMODE_NONE, 0.0);
+    if (!f)
+    {
+        printf ("ERROR: %s: cannot open %s: %s\n", params, FILENAME, adios_errmsg ());
+        adios_read_finalize_method (ADIOS_READ_METHOD_BP);
+        return 1;
+    }
+
+    memset (first, 0, sizeof (first));
+    err = read_blocks (f, 0, n, keep, first);
+    err = err || read_box (f, 0, n, params);
+
+    for (s = 1; s < NSTEPS && !err; s++)
+    {
+        // the file grows while it is open
+        write_step (s, n);
+        if (adios_advance_step (f, 0, 0.0))
+        {
+            printf ("ERROR: %s: cannot advance to step %d: %s\n", params, s, adios_errmsg ());
+            err = 1;
+            break;
+        }
+        memset (chunks, 0, sizeof (chunks));
+        err = read_blocks (f, s, n, keep, chunks);
+        err = err || read_box (f, s, n, params);
+        for (b = 0; b < NB; b++)
+            adios_free_chunk (chunks [b]);
+
+        // the chunks of the first step still point into the old mapping
+        for (b = 0; b < NB && !err; b++)
+        {
+            if (first [b])
+                err = check_values ((double *) first [b]->data, 0,
+                                    first [b]->sel->u.block.index * ldim, ldim,
+                                    "first step after the file grew");
+        }
+    }
+
+    for (b = 0; b < NB; b++)
+        adios_free_chunk (first [b]);
+    adios_read_close (f);
+    adios_read_finalize_method (ADIOS_READ_METHOD_BP);
+    return err;
+}
+
+int main (int argc, char ** argv)
+{
+    uint64_t n = 256*1024;
+    int64_t group;
+    int err;
+
+    if (argc > 1)
+    {
+        n = atoi (argv[1]);
+    }
+    if (n < NB * 2)
+    {
+        printf ("ERROR: N must be at least %d\n", NB * 2);
+        return 1;
+    }
+    n = n / NB * NB;
+
+    adios_init_noxml (MPI_COMM_SELF);
+    adios_declare_group (&group, "mmap", "", adios_stat_no);
+    adios_select_method (group, "POSIX", "", "");
+    adios_define_var (group, "n", "", adios_unsigned_long, "", "", "");
+    adios_define_var (group, "ldim", "", adios_unsigned_long, "", "", "");
+    adios_define_var (group, "off", "", adios_unsigned_long, "", "", "");
+    adios_define_var (group, "data", "", adios_double, "ldim", "n", "off");
+
+    // the same steps are read with mmap and without
+    write_step (0, n);
+    err = read_stream (n, "mmap", 1);
+    if (!err)
+    {
+        write_step (0, n);
+        err = read_stream (n, "", 0);
+    }
+    adios_finalize (0);
+
+    if (err)
+        printf ("FAILED\n");
+    else
+        printf ("OK\n");
+    return err;
+}
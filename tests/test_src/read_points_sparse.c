@@ -0,0 +1,256 @@
+/*
+ * ADIOS is freely available under the terms of the BSD license described
+ * in the COPYING file in the top level directory of this source distribution.
+ *
+ * Copyright (c) 2008 - 2009.  UT-BATTELLE, LLC. All rights reserved.
+ */
+
+/* ADIOS test: sparse point reads in a large array.
+ *
+ * Write NSTEPS steps of an N x N array of doubles in NB x NB blocks, then
+ * read NPOINTS random points scattered over the whole array and check them:
+ *   - 2D points in the global bounding box, all steps in one request
+ *   - 1D points in a sub-box of the array
+ *   - the same with coalesce=no, so that every point is read alone
+ * Points are unsorted and some are repeated. The time of the point reads is
+ * printed next to the time of reading the whole array.
+ *
+ * How to run: read_points_sparse [N]
+ * Output: read_points_sparse.bp, timings, non-zero exit code on mismatch
+ *
+ * This is a sequential test.
+ */
+#ifndef _NOMPI
+#define _NOMPI
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <sys/time.h>
+#include "public/adios.h"
+#include "public/adios_read.h"
+
+#define NB 4
+#define NSTEPS 2
+#define NPOINTS 1000
+
+static const char FILENAME[] = "read_points_sparse.bp";
+
+static double now ()
+{
+    struct timeval tp;
+    gettimeofday (&tp, NULL);
+    return (double) tp.tv_sec + (double) tp.tv_usec * 1.0e-6;
+}
+
+static double value (int step, uint64_t i, uint64_t j, uint64_t n)
+{
+    return step * 1.0e8 + (double) (i * n + j);
+}
+
+static uint64_t next_random (uint64_t * seed)
+{
+    *seed = *seed * 6364136223846793005ULL + 1442695040888963407ULL;
+    return *seed >> 33;
+}
+
+static void write_file (uint64_t n)
+{
+    int64_t group, fh;
+    uint64_t ldim = n / NB, off1, off2, i, j;
+    double * block = (double *) malloc (ldim * ldim * sizeof (double));
+    int s, b1, b2;
+
+    adios_declare_group (&group, "sparse", "", adios_stat_no);
+    adios_select_method (group, "POSIX", "", "");
+    adios_define_var (group, "n", "", adios_unsigned_long, "", "", "");
+    adios_define_var (group, "ldim", "", adios_unsigned_long, "", "", "");
+    adios_define_var (group, "off1", "", adios_unsigned_long, "", "", "");
+    adios_define_var (group, "off2", "", adios_unsigned_long, "", "", "");
+    adios_define_var (group, "data", "", adios_double, "ldim,ldim", "n,n", "off1,off2");
+
+    for (s = 0; s < NSTEPS; s++)
+    {
+        adios_open (&fh, "sparse", FILENAME, (s ? "a" : "w"), MPI_COMM_SELF);
+        adios_write (fh, "n", &n);
+        adios_write (fh, "ldim", &ldim);
+        for (b1 = 0; b1 < NB; b1++)
+        {
+            for (b2 = 0; b2 < NB; b2++)
+            {
+                off1 = b1 * ldim;
+                off2 = b2 * ldim;
+                for (i = 0; i < ldim; i++)
+                    for (j = 0; j < ldim; j++)
+                        block [i * ldim + j] = value (s, off1 + i, off2 + j, n);
+                adios_write (fh, "off1", &off1);
+                adios_write (fh, "off2", &off2);
+                adios_write (fh, "data", block);
+            }
+        }
+        adios_close (fh);
+    }
+    free (block);
+}
+
+/* NPOINTS random points in a box of size count, some of them repeated */
+static void make_points (uint64_t * points, const uint64_t * count, uint64_t * seed)
+{
+    int k;
+    for (k = 0; k < NPOINTS; k++)
+    {
+        if (k % 10 == 9)
+        {
+            points [2*k] = points [2*(k-5)];
+            points [2*k+1] = points [2*(k-5)+1];
+        }
+        else
+        {
+            points [2*k] = next_random (seed) % count[0];
+            points [2*k+1] = next_random (seed) % count[1];
+        }
+    }
+}
+
+/* data holds NPOINTS values for each of nsteps steps from step 'from' */
+static int check (const double * data, const uint64_t * points, const uint64_t * start,
+                  int from, int nsteps, uint64_t n, const char * how)
+{
+    int s, k;
+    for (s = 0; s < nsteps; s++)
+    {
+        for (k = 0; k < NPOINTS; k++)
+        {
+            double expected = value (from + s, start[0] + points [2*k], start[1] + points [2*k+1], n);
+            if (data [s * NPOINTS + k] != expected)
+            {
+                printf ("ERROR: %s: step %d point %d (%llu,%llu) = %g instead of %g\n", how, from + s, k,
+                        (unsigned long long) (start[0] + points [2*k]),
+                        (unsigned long long) (start[1] + points [2*k+1]),
+                        data [s * NPOINTS + k], expected);
+                return 1;
+            }
+        }
+    }
+    return 0;
+}
+
+static int read_points (uint64_t n, const char * params, double * t_points)
+{
+    ADIOS_FILE * f;
+    ADIOS_SELECTION * box, * sel;
+    uint64_t points [2*NPOINTS], points1d [NPOINTS], seed = 12345;
+    uint64_t start[2] = {0, 0}, count[2] = {n, n}, substart[2], subcount[2];
+    double data [NSTEPS * NPOINTS];
+    double t;
+    int k, err = 0;
+
+    adios_read_init_method (ADIOS_READ_METHOD_BP, MPI_COMM_SELF, params);
+    f = adios_read_open_file (FILENAME, ADIOS_READ_METHOD_BP, MPI_COMM_SELF);
+    if (!f)
+    {
+        printf ("ERROR: cannot open %s: %s\n", FILENAME, adios_errmsg ());
+        return 1;
+    }
+
+    // 2D points in the whole array, both steps
+    t = now ();
+    make_points (points, count, &seed);
+    memset (data, 0, sizeof (data));
+    sel = adios_selection_points (2, NPOINTS, points);
+    adios_schedule_read (f, sel, "data", 0, NSTEPS, data);
+    adios_perform_reads (f, 1);
+    adios_selection_delete (sel);
+    err = check (data, points, start, 0, NSTEPS, n, "2D points");
+
+    // 1D points in a sub-box that spans several blocks
+    substart[0] = n / 8 + 1;
+    substart[1] = n / 3;
+    subcount[0] = n / 2;
+    subcount[1] = n / 2 + 3;
+    make_points (points, subcount, &seed);
+    for (k = 0; k < NPOINTS; k++)
+        points1d [k] = points [2*k] * subcount[1] + points [2*k+1];
+    memset (data, 0, sizeof (data));
+    box = adios_selection_boundingbox (2, substart, subcount);
+    sel = adios_selection_points (1, NPOINTS, points1d);
+    sel->u.points.container_selection = box;
+    adios_schedule_read (f, sel, "data", 1, 1, data);
+    adios_perform_reads (f, 1);
+    adios_selection_delete (sel);
+    if (!err)
+        err = check (data, points, substart, 1, 1, n, "1D points");
+    *t_points = now () - t;
+
+    adios_read_close (f);
+    adios_read_finalize_method (ADIOS_READ_METHOD_BP);
+    return err;
+}
+
+static double read_all (uint64_t n)
+{
+    ADIOS_FILE * f;
+    ADIOS_SELECTION * sel;
+    uint64_t start[2] = {0, 0}, count[2] = {n, n};
+    double * data = (double *) malloc (n * n * sizeof (double));
+    double t = now ();
+    int s;
+
+    adios_read_init_method (ADIOS_READ_METHOD_BP, MPI_COMM_SELF, "");
+    f = adios_read_open_file (FILENAME, ADIOS_READ_METHOD_BP, MPI_COMM_SELF);
+    sel = adios_selection_boundingbox (2, start, count);
+    for (s = 0; f && data && s < NSTEPS; s++)
+    {
+        adios_schedule_read (f, sel, "data", s, 1, data);
+        adios_perform_reads (f, 1);
+    }
+    adios_selection_delete (sel);
+    if (f)
+        adios_read_close (f);
+    adios_read_finalize_method (ADIOS_READ_METHOD_BP);
+    free (data);
+    return now () - t;
+}
+
+int main (int argc, char ** argv)
+{
+    uint64_t n = 2048;
+    double t_points, t_single, t_all;
+    int err;
+
+    if (argc > 1)
+    {
+        n = atoi (argv[1]);
+    }
+    if (n < NB * 4)
+    {
+        printf ("ERROR: N must be at least %d\n", NB * 4);
+        return 1;
+    }
+    n = n / NB * NB;
+
+    adios_init_noxml (MPI_COMM_SELF);
+    write_file (n);
+    adios_finalize (0);
+
+    printf ("Read %d points in %d steps of a %llu x %llu array\n", NPOINTS, NSTEPS,
+            (unsigned long long) n, (unsigned long long) n);
+    err = read_points (n, "", &t_points);
+    if (!err)
+        err = read_points (n, "coalesce=no", &t_single);
+    if (!err)
+    {
+        t_all = read_all (n);
+        printf ("  points:                 %.3f s\n", t_points);
+        printf ("  points, coalesce=no:    %.3f s\n", t_single);
+        printf ("  whole array:            %.3f s\n", t_all);
+    }
+
+    if (err)
+        printf ("FAILED\n");
+    else
+        printf ("OK\n");
+    return err;
+}
@@ -0,0 +1,214 @@
+/*
+ * ADIOS is freely available under the terms of the BSD license described
+ * in the COPYING file in the top level directory of this source distribution.
+ *
+ * Copyright (c) 2008 - 2009.  UT-BATTELLE, LLC. All rights reserved.
+ */
+
+/* ADIOS test: prefetch of the next steps while a time series is processed.
+ *
+ * Write NSTEPS steps of two arrays of N doubles in NB blocks, then read them
+ * step by step, working COMPUTE_MSEC on each step:
+ *   - as a file, with from_steps
+ *   - as a stream, with adios_advance_step()
+ * Array "a" is read with a bounding box, array "b" one writeblock at a time.
+ * Both are done without prefetch and with prefetch=2, every value is checked
+ * and the times are printed.
+ *
+ * How to run: read_prefetch [N]
+ * Output: read_prefetch.bp, timings, non-zero exit code on mismatch
+ *
+ * This is a sequential test.
+ */
+#ifndef _NOMPI
+#define _NOMPI
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/time.h>
+#include "public/adios.h"
+#include "public/adios_read.h"
+
+#define NB 4
+#define NSTEPS 8
+#define COMPUTE_MSEC 20
+
+static const char FILENAME[] = "read_prefetch.bp";
+
+static double now ()
+{
+    struct timeval tp;
+    gettimeofday (&tp, NULL);
+    return (double) tp.tv_sec + (double) tp.tv_usec * 1.0e-6;
+}
+
+static double value (int var, int step, uint64_t i)
+{
+    return var * 1.0e9 + step * 1.0e7 + (double) i;
+}
+
+static void write_file (uint64_t n)
+{
+    int64_t group, fh;
+    uint64_t ldim = n / NB, off, i;
+    double * a = (double *) malloc (ldim * sizeof (double));
+    double * b = (double *) malloc (ldim * sizeof (double));
+    int s, k;
+
+    adios_declare_group (&group, "prefetch", "", adios_stat_no);
+    adios_select_method (group, "POSIX", "", "");
+    adios_define_var (group, "n", "", adios_unsigned_long, "", "", "");
+    adios_define_var (group, "ldim", "", adios_unsigned_long, "", "", "");
+    adios_define_var (group, "off", "", adios_unsigned_long, "", "", "");
+    adios_define_var (group, "a", "", adios_double, "ldim", "n", "off");
+    adios_define_var (group, "b", "", adios_double, "ldim", "n", "off");
+
+    for (s = 0; s < NSTEPS; s++)
+    {
+        adios_open (&fh, "prefetch", FILENAME, (s ? "a" : "w"), MPI_COMM_SELF);
+        adios_write (fh, "n", &n);
+        adios_write (fh, "ldim", &ldim);
+        for (k = 0; k < NB; k++)
+        {
+            off = k * ldim;
+            for (i = 0; i < ldim; i++)
+            {
+                a [i] = value (0, s, off + i);
+                b [i] = value (1, s, off + i);
+            }
+            adios_write (fh, "off", &off);
+            adios_write (fh, "a", a);
+            adios_write (fh, "b", b);
+        }
+        adios_close (fh);
+    }
+    free (a);
+    free (b);
+}
+
+/* a holds the whole array "a", b holds block 1 of "b" */
+static int check (const double * a, const double * b, int s, uint64_t n, const char * how)
+{
+    uint64_t i, ldim = n / NB;
+    for (i = 0; i < n; i++)
+    {
+        if (a [i] != value (0, s, i))
+        {
+            printf ("ERROR: %s: step %d a[%llu] = %g instead of %g\n", how, s,
+                    (unsigned long long) i, a [i], value (0, s, i));
+            return 1;
+        }
+    }
+    for (i = 0; i < ldim; i++)
+    {
+        if (b [i] != value (1, s, ldim + i))
+        {
+            printf ("ERROR: %s: step %d b[%llu] = %g instead of %g\n", how, s,
+                    (unsigned long long) (ldim + i), b [i], value (1, s, ldim + i));
+            return 1;
+        }
+    }
+    return 0;
+}
+
+static int read_steps (uint64_t n, int stream, const char * params, double * t_read)
+{
+    ADIOS_FILE * f;
+    ADIOS_SELECTION * box, * wb;
+    uint64_t start = 0, count = n;
+    double * a = (double *) malloc (n * sizeof (double));
+    double * b = (double *) malloc (n / NB * sizeof (double));
+    double t;
+    int s, err = 0;
+
+    adios_read_init_method (ADIOS_READ_METHOD_BP, MPI_COMM_SELF, params);
+    if (stream)
+        f = adios_read_open (FILENAME, ADIOS_READ_METHOD_BP, MPI_COMM_SELF, ADIOS_LOCKMODE_NONE, 0.0);
+    else
+        f = adios_read_open_file (FILENAME, ADIOS_READ_METHOD_BP, MPI_COMM_SELF);
+    if (!f)
+    {
+        printf ("ERROR: cannot open %s: %s\n", FILENAME, adios_errmsg ());
+        return 1;
+    }
+    box = adios_selection_boundingbox (1, &start, &count);
+    wb = adios_selection_writeblock (1);
+
+    *t_read = 0;
+    for (s = 0; s < NSTEPS && !err; s++)
+    {
+        if (stream && s && adios_advance_step (f, 0, 0.0))
+        {
+            printf ("ERROR: cannot advance to step %d: %s\n", s, adios_errmsg ());
+            err = 1;
+            break;
+        }
+        memset (a, 0, n * sizeof (double));
+        memset (b, 0, n / NB * sizeof (double));
+        t = now ();
+        adios_schedule_read (f, box, "a", (stream ? 0 : s), 1, a);
+        adios_schedule_read (f, wb, "b", (stream ? 0 : s), 1, b);
+        adios_perform_reads (f, 1);
+        *t_read += now () - t;
+        err = check (a, b, s, n, params);
+
+        usleep (COMPUTE_MSEC * 1000); // work on the step
+    }
+
+    adios_selection_delete (wb);
+    adios_selection_delete (box);
+    adios_read_close (f);
+    adios_read_finalize_method (ADIOS_READ_METHOD_BP);
+    free (a);
+    free (b);
+    return err;
+}
+
+int main (int argc, char ** argv)
+{
+    uint64_t n = 1024*1024;
+    double t_file, t_file_prefetch, t_stream, t_stream_prefetch;
+    int err;
+
+    if (argc > 1)
+    {
+        n = atoi (argv[1]);
+    }
+    if (n < NB)
+    {
+        printf ("ERROR: N must be at least %d\n", NB);
+        return 1;
+    }
+    n = n / NB * NB;
+
+    adios_init_noxml (MPI_COMM_SELF);
+    write_file (n);
+    adios_finalize (0);
+
+    printf ("Read %d steps of two arrays of %llu doubles\n", NSTEPS, (unsigned long long) n);
+    err = read_steps (n, 0, "", &t_file);
+    if (!err)
+        err = read_steps (n, 0, "prefetch=2", &t_file_prefetch);
+    if (!err)
+        err = read_steps (n, 1, "", &t_stream);
+    if (!err)
+        err = read_steps (n, 1, "prefetch=2", &t_stream_prefetch);
+    if (!err)
+    {
+        printf ("  time in perform_reads:\n");
+        printf ("  file:                   %.3f s\n", t_file);
+        printf ("  file, prefetch=2:       %.3f s\n", t_file_prefetch);
+        printf ("  stream:                 %.3f s\n", t_stream);
+        printf ("  stream, prefetch=2:     %.3f s\n", t_stream_prefetch);
+    }
+
+    if (err)
+        printf ("FAILED\n");
+    else
+        printf ("OK\n");
+    return err;
+}
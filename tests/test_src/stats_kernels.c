@@ -0,0 +1,239 @@
+/*
+ * ADIOS is freely available under the terms of the BSD license described
+ * in the COPYING file in the top level directory of this source distribution.
+ *
+ * Copyright (c) 2008 - 2009.  UT-BATTELLE, LLC. All rights reserved.
+ */
+
+/* ADIOS test: statistics kernels (adios_stats_compute(), adios_stats_histogram())
+ * against the element by element loop used before to calculate the
+ * characteristics of a variable at write.
+ *
+ * Arrays of double, float and int are generated, with and without NaN/Inf values,
+ * and the statistics are calculated in min/max mode and in full mode.
+ * Min, max and count must be identical, sums must match within a relative
+ * tolerance (the order of additions differs). Timings are printed for both.
+ *
+ * How to run: stats_kernels [nelems]
+ * Output: timings, non-zero exit code on mismatch
+ *
+ * This is a sequential test.
+ */
+#ifndef _NOMPI
+#define _NOMPI
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <inttypes.h>
+#include <string.h>
+#include <math.h>
+#include <sys/time.h>
+#include "core/adios_stats.h"
+
+#define NBREAKS 16
+
+static double now ()
+{
+    struct timeval tp;
+    gettimeofday (&tp, NULL);
+    return (double) tp.tv_sec + (double) tp.tv_usec * 1.0e-6;
+}
+
+struct ref_result
+{
+    double min, max, sum, sum_square;
+    uint32_t cnt;
+    int have_value;
+};
+
+/* The reference loops, one value at a time */
+#define REF_STATS(T,SKIP) \
+static void ref_##T (const T * data, uint64_t n, int full, struct ref_result * r) \
+{ \
+    T min = 0, max = 0; \
+    uint64_t i; \
+    memset (r, 0, sizeof (struct ref_result)); \
+    for (i = 0; i < n; i++) \
+    { \
+        if (SKIP (data [i], full)) \
+            continue; \
+        if (!r->have_value) \
+        { \
+            min = max = data [i]; \
+            r->have_value = 1; \
+        } \
+        if (data [i] < min) \
+            min = data [i]; \
+        if (data [i] > max) \
+            max = data [i]; \
+        if (full) \
+        { \
+            r->sum += data [i]; \
+            r->sum_square += (double) data [i] * data [i]; \
+            r->cnt++; \
+        } \
+    } \
+    r->min = min; \
+    r->max = max; \
+}
+
+#define SKIP_FLOAT(v,full) ((full) ? !isfinite (v) : isnan (v))
+#define SKIP_INT(v,full) (0)
+
+REF_STATS(double,SKIP_FLOAT)
+REF_STATS(float,SKIP_FLOAT)
+REF_STATS(int32_t,SKIP_INT)
+
+static void ref_hist (const double * data, uint64_t n, const double * breaks, uint32_t * freq)
+{
+    uint64_t i;
+    int b;
+    for (i = 0; i < n; i++)
+    {
+        if (!isfinite (data [i]))
+            continue;
+        for (b = 0; b < NBREAKS && data [i] >= breaks [b]; b++)
+            ;
+        freq [b]++;
+    }
+}
+
+static int close_enough (double a, double b)
+{
+    return fabs (a - b) <= 1e-9 * (fabs (a) + fabs (b)) + 1e-300;
+}
+
+static int check (const char * what, int full, const struct ref_result * r,
+                  int have_value, double min, double max,
+                  double sum, double sum_square, uint32_t cnt)
+{
+    if (have_value != r->have_value
+        || (have_value && (min != r->min || max != r->max))
+        || (full && (cnt != r->cnt || !close_enough (sum, r->sum)
+                     || !close_enough (sum_square, r->sum_square))))
+    {
+        printf ("ERROR: %s %s: expected have_value=%d min=%g max=%g sum=%g sum_square=%g cnt=%u, "
+                "got have_value=%d min=%g max=%g sum=%g sum_square=%g cnt=%u\n",
+                what, (full ? "full" : "minmax"),
+                r->have_value, r->min, r->max, r->sum, r->sum_square, r->cnt,
+                have_value, min, max, sum, sum_square, cnt);
+        return 1;
+    }
+    return 0;
+}
+
+#define RUN_CASE(T,ADIOS_TYPE,NAME,DATA,N) \
+    for (full = 0; full <= 1; full++) \
+    { \
+        struct ref_result r; \
+        T min, max; \
+        double sum = 0, sum_square = 0, t0, t_ref, t_new; \
+        uint32_t cnt = 0; \
+        int have_value; \
+        t0 = now (); \
+        ref_##T (DATA, N, full, &r); \
+        t_ref = now () - t0; \
+        t0 = now (); \
+        have_value = adios_stats_compute (ADIOS_TYPE, DATA, N, full, &min, &max, \
+                                          &sum, &sum_square, &cnt); \
+        t_new = now () - t0; \
+        err |= check (NAME, full, &r, have_value, (double) min, (double) max, \
+                      sum, sum_square, cnt); \
+        printf ("%-22s %-7s %10.6f s  %10.6f s\n", NAME, (full ? "full" : "minmax"), t_ref, t_new); \
+    }
+
+int main (int argc, char ** argv)
+{
+    uint64_t n = 10000000, i;
+    double * d;
+    float * f;
+    int32_t * k;
+    double breaks [NBREAKS];
+    uint32_t freq1 [NBREAKS + 1], freq2 [NBREAKS + 1];
+    struct adios_hist_struct hist;
+    double t0, t_ref, t_new;
+    int full, b, err = 0;
+
+    if (argc > 1)
+    {
+        n = strtoull (argv[1], NULL, 10);
+    }
+    if (n < 16)
+    {
+        printf ("ERROR: need at least 16 elements\n");
+        return 1;
+    }
+
+    d = (double *) malloc (n * sizeof (double));
+    f = (float *) malloc (n * sizeof (float));
+    k = (int32_t *) malloc (n * sizeof (int32_t));
+    if (!d || !f || !k)
+    {
+        printf ("ERROR: cannot allocate arrays of %" PRIu64 " elements\n", n);
+        return 1;
+    }
+
+    srand (12345);
+    for (i = 0; i < n; i++)
+    {
+        d [i] = (double) rand () / RAND_MAX * 2000.0 - 1000.0;
+        f [i] = (float) d [i];
+        k [i] = rand () - RAND_MAX / 2;
+    }
+
+    printf ("Statistics of %" PRIu64 " elements\n", n);
+    printf ("                               reference    kernels\n");
+    RUN_CASE(double, adios_double, "double", d, n)
+    RUN_CASE(float, adios_real, "float", f, n)
+    RUN_CASE(int32_t, adios_integer, "int", k, n)
+    RUN_CASE(double, adios_double, "double (odd length)", d + 1, n - 3)
+
+    /* histogram of finite doubles */
+    for (b = 0; b < NBREAKS; b++)
+        breaks [b] = -1000.0 + (b + 1) * 2000.0 / (NBREAKS + 1);
+    memset (freq1, 0, sizeof (freq1));
+    memset (freq2, 0, sizeof (freq2));
+    hist.min = -1000.0;
+    hist.max = 1000.0;
+    hist.num_breaks = NBREAKS;
+    hist.breaks = breaks;
+    hist.frequencies = freq2;
+
+    /* put some non-finite values in a few chunks */
+    for (i = 0; i < n; i += n / 7 + 1)
+    {
+        d [i] = NAN;
+        f [i] = NAN;
+    }
+    d [n / 2 + 1] = INFINITY;
+    f [n / 2 + 1] = -INFINITY;
+
+    t0 = now ();
+    ref_hist (d, n, breaks, freq1);
+    t_ref = now () - t0;
+    t0 = now ();
+    adios_stats_histogram (adios_double, d, n, &hist);
+    t_new = now () - t0;
+    if (memcmp (freq1, freq2, sizeof (freq1)))
+    {
+        printf ("ERROR: histogram frequencies differ\n");
+        err = 1;
+    }
+    printf ("%-22s %-7s %10.6f s  %10.6f s\n", "histogram (double)", "", t_ref, t_new);
+
+    RUN_CASE(double, adios_double, "double (NaN/Inf)", d, n)
+    RUN_CASE(float, adios_real, "float (NaN/Inf)", f, n)
+
+    /* all values skipped */
+    for (i = 0; i < 100; i++)
+        d [i] = NAN;
+    RUN_CASE(double, adios_double, "double (all NaN)", d, 100)
+
+    free (d);
+    free (f);
+    free (k);
+
+    return err;
+}
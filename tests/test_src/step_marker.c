@@ -0,0 +1,236 @@
+/*
+ * ADIOS is freely available under the terms of the BSD license described
+ * in the COPYING file in the top level directory of this source distribution.
+ *
+ * Copyright (c) 2008 - 2009.  UT-BATTELLE, LLC. All rights reserved.
+ */
+
+/* ADIOS test: streaming reads of a file while it is being written.
+ *
+ * A child process writes NSTEPS steps of an array with the POSIX method,
+ * one step every STEP_MSEC milliseconds, and sends the time each step was
+ * closed to the parent through a pipe. The parent reads the file as a
+ * stream, checks every step and prints how long after adios_close() the
+ * step was seen. This is done
+ *   - without step marker, polling the file every POLL_MSEC
+ *   - with step_marker, the reader waits for the marker to change
+ *   - with step_marker and index=chained, the reader also keeps the
+ *     indexes of the steps it has read
+ *   - with step_marker for the first MARKED_STEPS steps only, the next
+ *     steps are written every STALE_STEP_MSEC without updating the marker,
+ *     and the reader must find them by polling the file
+ *
+ * How to run: step_marker
+ * Output: step_marker_[0123].bp, latencies, non-zero exit code on mismatch
+ *
+ * This is a sequential test.
+ */
+#ifndef _NOMPI
+#define _NOMPI
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/time.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include "public/adios.h"
+#include "public/adios_read.h"
+
+#define NSTEPS 10
+#define N 1000
+#define STEP_MSEC 200
+#define POLL_MSEC 1000
+#define MARKED_STEPS 3
+#define STALE_STEP_MSEC 1000
+
+static double now ()
+{
+    struct timeval tp;
+    gettimeofday (&tp, NULL);
+    return (double) tp.tv_sec + (double) tp.tv_usec * 1.0e-6;
+}
+
+static double value (int step, int i)
+{
+    return step * 1000.0 + i;
+}
+
+static void declare_group (const char * params)
+{
+    int64_t group;
+
+    adios_init_noxml (MPI_COMM_SELF);
+    adios_declare_group (&group, "stream", "", adios_stat_no);
+    adios_select_method (group, "POSIX", params, "");
+    adios_define_var (group, "n", "", adios_unsigned_long, "", "", "");
+    adios_define_var (group, "step", "", adios_integer, "", "", "");
+    adios_define_var (group, "v", "", adios_double, "n", "n", "0");
+}
+
+/* Write NSTEPS steps, the steps from 'nmarked' on without the parameters */
+static void write_steps (const char * filename, const char * params, int nmarked, int fd)
+{
+    int64_t fh;
+    double data [N];
+    uint64_t n = N;
+    double t;
+    int s, i;
+
+    declare_group (params);
+    for (s = 0; s < NSTEPS; s++)
+    {
+        if (s == nmarked)
+        {
+            // the step marker is not updated from now on
+            adios_finalize (0);
+            declare_group ("");
+        }
+        for (i = 0; i < N; i++)
+            data [i] = value (s, i);
+        adios_open (&fh, "stream", filename, (s ? "a" : "w"), MPI_COMM_SELF);
+        adios_write (fh, "n", &n);
+        adios_write (fh, "step", &s);
+        adios_write (fh, "v", data);
+        adios_close (fh);
+        t = now ();
+        if (write (fd, &t, sizeof (t)) != sizeof (t))
+            break;
+        usleep ((s + 1 >= nmarked && nmarked < NSTEPS ? STALE_STEP_MSEC : STEP_MSEC) * 1000);
+    }
+    adios_finalize (0);
+}
+
+static int check_step (ADIOS_FILE * f, int s, double * data)
+{
+    ADIOS_SELECTION * sel;
+    uint64_t start = 0, count = N;
+    int step = -1, i;
+
+    sel = adios_selection_boundingbox (1, &start, &count);
+    adios_schedule_read (f, NULL, "step", 0, 1, &step);
+    adios_schedule_read (f, sel, "v", 0, 1, data);
+    adios_perform_reads (f, 1);
+    adios_selection_delete (sel);
+
+    if (step != s)
+    {
+        printf ("ERROR: step %d has step = %d\n", s, step);
+        return 1;
+    }
+    for (i = 0; i < N; i++)
+    {
+        if (data [i] != value (s, i))
+        {
+            printf ("ERROR: step %d v[%d] = %g instead of %g\n", s, i, data [i], value (s, i));
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/* Read the steps as they come, the latency of each is the time between
+   adios_close() in the writer and the reader seeing the step */
+static int read_steps (const char * filename, int fd, double * latency)
+{
+    ADIOS_FILE * f;
+    double data [N], t_closed;
+    int s, err = 0;
+
+    // open after the first step, to wait for every next step
+    *latency = 0;
+    if (read (fd, &t_closed, sizeof (t_closed)) != sizeof (t_closed))
+    {
+        printf ("ERROR: no time from the writer for step 0\n");
+        return 1;
+    }
+    f = adios_read_open (filename, ADIOS_READ_METHOD_BP, MPI_COMM_SELF, ADIOS_LOCKMODE_NONE, 30.0);
+    if (!f)
+    {
+        printf ("ERROR: cannot open %s: %s\n", filename, adios_errmsg ());
+        return 1;
+    }
+    for (s = 0; s < NSTEPS && !err; s++)
+    {
+        if (s && adios_advance_step (f, 0, 30.0))
+        {
+            printf ("ERROR: step %d did not arrive: %s\n", s, adios_errmsg ());
+            err = 1;
+            break;
+        }
+        if (s)
+        {
+            if (read (fd, &t_closed, sizeof (t_closed)) != sizeof (t_closed))
+            {
+                printf ("ERROR: no time from the writer for step %d\n", s);
+                err = 1;
+                break;
+            }
+            *latency += now () - t_closed;
+        }
+        err = check_step (f, s, data);
+    }
+    *latency /= (NSTEPS - 1);
+    adios_read_close (f);
+    return err;
+}
+
+int main (int argc, char ** argv)
+{
+    char filename [32], params [64];
+    double latency;
+    int mode, fds [2], status, err = 0;
+    pid_t pid;
+    static const char * writer_params [] = { "", "step_marker", "step_marker;index=chained",
+                                             "step_marker" };
+    static const int marked_steps [] = { NSTEPS, NSTEPS, NSTEPS, MARKED_STEPS };
+    static const char * modes [] = { "polling", "step marker", "step marker, chained index",
+                                     "stale step marker" };
+
+    printf ("Read %d steps written every %d ms\n", NSTEPS, STEP_MSEC);
+    for (mode = 0; mode < 4 && !err; mode++)
+    {
+        sprintf (filename, "step_marker_%d.bp", mode);
+        unlink (filename);
+        sprintf (params, "%s%s", filename, ".step");
+        unlink (params);
+
+        if (pipe (fds))
+        {
+            printf ("ERROR: cannot create a pipe\n");
+            return 1;
+        }
+        pid = fork ();
+        if (pid == 0)
+        {
+            close (fds [0]);
+            write_steps (filename, writer_params [mode], marked_steps [mode], fds [1]);
+            close (fds [1]);
+            _exit (0);
+        }
+        close (fds [1]);
+
+        sprintf (params, "poll_interval=%d", POLL_MSEC);
+        adios_read_init_method (ADIOS_READ_METHOD_BP, MPI_COMM_SELF, params);
+        err = read_steps (filename, fds [0], &latency);
+        adios_read_finalize_method (ADIOS_READ_METHOD_BP);
+        close (fds [0]);
+
+        waitpid (pid, &status, 0);
+        if (!WIFEXITED (status) || WEXITSTATUS (status))
+        {
+            printf ("ERROR: the writer failed\n");
+            err = 1;
+        }
+        printf ("  %-28s step seen %.3f s after adios_close() on average\n", modes [mode], latency);
+    }
+
+    if (err)
+        printf ("FAILED\n");
+    else
+        printf ("OK\n");
+    return err;
+}
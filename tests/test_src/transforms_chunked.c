@@ -0,0 +1,224 @@
+/*
+ * ADIOS is freely available under the terms of the BSD license described
+ * in the COPYING file in the top level directory of this source distribution.
+ *
+ * Copyright (c) 2008 - 2009.  UT-BATTELLE, LLC. All rights reserved.
+ */
+
+/* ADIOS test: chunked compression in the zlib transform ("zlib:5,chunks=N,threads=T").
+ *
+ * A 2D array of doubles is written in two blocks, once compressed as a whole and
+ * once compressed in chunks with several threads. Bounding boxes of various shapes
+ * (a few rows, a column, an interior box, the whole array) and whole blocks are read
+ * back from both, with several decompression threads for the chunked one, and
+ * compared to the original values. Timings are printed for both.
+ *
+ * How to run: transforms_chunked [rows]
+ * Output: transforms_chunked.bp, timings, non-zero exit code on mismatch
+ *
+ * This is a sequential test.
+ */
+#ifndef _NOMPI
+#define _NOMPI
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <inttypes.h>
+#include <string.h>
+#include <sys/time.h>
+#include "config.h"
+#include "public/adios.h"
+#include "public/adios_read.h"
+
+#define NCOLS 512
+
+static const char FILENAME[] = "transforms_chunked.bp";
+
+static double now ()
+{
+    struct timeval tp;
+    gettimeofday (&tp, NULL);
+    return (double) tp.tv_sec + (double) tp.tv_usec * 1.0e-6;
+}
+
+static double value (uint64_t row, uint64_t col)
+{
+    // smooth enough to compress, but not constant
+    return (double) ((row * 7 + col) % 1000) * 0.5;
+}
+
+static int write_file (uint64_t nrows)
+{
+    int64_t group, fh, whole_ids[2], chunked_ids[2];
+    uint64_t gdims[2] = {nrows, NCOLS}, ldims[2] = {nrows / 2, NCOLS}, offs[2] = {0, 0};
+    uint64_t i, j, b;
+    char dims[64], gdimstr[64], offstr[64];
+    double * data = (double *) malloc (ldims[0] * NCOLS * sizeof (double));
+
+    if (!data)
+    {
+        printf ("ERROR: cannot allocate %" PRIu64 " rows\n", ldims[0]);
+        return 1;
+    }
+
+    adios_declare_group (&group, "chunked", "", adios_stat_no);
+    adios_select_method (group, "POSIX", "", "");
+
+    for (b = 0; b < 2; b++)
+    {
+        offs[0] = b * ldims[0];
+        snprintf (dims, sizeof (dims), "%" PRIu64 ",%" PRIu64, ldims[0], ldims[1]);
+        snprintf (gdimstr, sizeof (gdimstr), "%" PRIu64 ",%" PRIu64, gdims[0], gdims[1]);
+        snprintf (offstr, sizeof (offstr), "%" PRIu64 ",%" PRIu64, offs[0], offs[1]);
+        whole_ids[b] = adios_define_var (group, "whole", "", adios_double, dims, gdimstr, offstr);
+        adios_set_transform (whole_ids[b], "zlib:5");
+        chunked_ids[b] = adios_define_var (group, "chunked", "", adios_double, dims, gdimstr, offstr);
+        adios_set_transform (chunked_ids[b], "zlib:5,chunks=64,threads=4");
+    }
+
+    adios_open (&fh, "chunked", FILENAME, "w", MPI_COMM_SELF);
+    for (b = 0; b < 2; b++)
+    {
+        for (i = 0; i < ldims[0]; i++)
+            for (j = 0; j < NCOLS; j++)
+                data[i * NCOLS + j] = value (b * ldims[0] + i, j);
+        adios_write_byid (fh, whole_ids[b], data);
+        adios_write_byid (fh, chunked_ids[b], data);
+    }
+    adios_close (fh);
+
+    free (data);
+    return 0;
+}
+
+static int check_box (const double * data, const uint64_t * start, const uint64_t * count,
+                      const char * what)
+{
+    uint64_t i, j;
+    for (i = 0; i < count[0]; i++)
+    {
+        for (j = 0; j < count[1]; j++)
+        {
+            double expected = value (start[0] + i, start[1] + j);
+            if (data[i * count[1] + j] != expected)
+            {
+                printf ("ERROR: %s: element [%" PRIu64 ",%" PRIu64 "] is %g instead of %g\n",
+                        what, start[0] + i, start[1] + j, data[i * count[1] + j], expected);
+                return 1;
+            }
+        }
+    }
+    return 0;
+}
+
+struct box
+{
+    const char * name;
+    uint64_t start[2];
+    uint64_t count[2];
+};
+
+static int read_box (ADIOS_FILE * f, const char * varname, const struct box * b,
+                     double * data, double * t)
+{
+    ADIOS_SELECTION * sel = adios_selection_boundingbox (2, b->start, b->count);
+    double t0 = now ();
+    int err;
+
+    memset (data, 0, b->count[0] * b->count[1] * sizeof (double));
+    adios_schedule_read (f, sel, varname, 0, 1, data);
+    adios_perform_reads (f, 1);
+    *t = now () - t0;
+    adios_selection_delete (sel);
+
+    err = check_box (data, b->start, b->count, varname);
+    if (err)
+        printf ("ERROR: reading %s of %s failed\n", b->name, varname);
+    return err;
+}
+
+int main (int argc, char ** argv)
+{
+    uint64_t nrows = 2048;
+    ADIOS_FILE * f;
+    double * data;
+    double t_whole, t_chunked;
+    int err = 0, k;
+
+#ifndef HAVE_ZLIB
+    printf ("ADIOS is built without zlib, nothing to test\n");
+    return 0;
+#endif
+
+    if (argc > 1)
+    {
+        nrows = strtoull (argv[1], NULL, 10);
+    }
+    if (nrows < 64 || nrows % 2)
+    {
+        printf ("ERROR: number of rows must be an even number, at least 64\n");
+        return 1;
+    }
+
+    adios_init_noxml (MPI_COMM_SELF);
+    adios_read_init_method (ADIOS_READ_METHOD_BP, MPI_COMM_SELF, "");
+
+    if (write_file (nrows))
+        return 1;
+
+    data = (double *) malloc (nrows * NCOLS * sizeof (double));
+    f = adios_read_open_file (FILENAME, ADIOS_READ_METHOD_BP, MPI_COMM_SELF);
+    if (!f || !data)
+    {
+        printf ("ERROR: cannot open %s: %s\n", FILENAME, adios_errmsg ());
+        return 1;
+    }
+
+    {
+        struct box boxes[] = {
+            {"a few rows in the first block",  {3, 0},                 {5, NCOLS}},
+            {"rows across the two blocks",     {nrows / 2 - 9, 0},     {20, NCOLS}},
+            {"one column",                     {0, NCOLS / 3},         {nrows, 1}},
+            {"interior box",                   {nrows / 4, NCOLS / 4}, {nrows / 2, NCOLS / 2}},
+            {"last row",                       {nrows - 1, 0},         {1, NCOLS}},
+            {"whole array",                    {0, 0},                 {nrows, NCOLS}},
+        };
+
+        // decompress with several threads
+        setenv ("ADIOS_TRANSFORM_THREADS", "4", 1);
+
+        printf ("Reading from %" PRIu64 "x%d doubles\n", nrows, NCOLS);
+        printf ("%-32s %12s  %12s\n", "", "whole block", "chunked");
+        for (k = 0; k < sizeof (boxes) / sizeof (boxes[0]); k++)
+        {
+            err |= read_box (f, "whole", &boxes[k], data, &t_whole);
+            err |= read_box (f, "chunked", &boxes[k], data, &t_chunked);
+            printf ("%-32s %10.6f s  %10.6f s\n", boxes[k].name, t_whole, t_chunked);
+        }
+    }
+
+    {
+        // the second block as a writeblock
+        ADIOS_SELECTION * sel = adios_selection_writeblock (1);
+        uint64_t start[2] = {nrows / 2, 0}, count[2] = {nrows / 2, NCOLS};
+
+        setenv ("ADIOS_TRANSFORM_THREADS", "1", 1);
+        adios_schedule_read (f, sel, "chunked", 0, 1, data);
+        adios_perform_reads (f, 1);
+        adios_selection_delete (sel);
+        if (check_box (data, start, count, "chunked"))
+        {
+            printf ("ERROR: reading the second block of chunked failed\n");
+            err = 1;
+        }
+    }
+
+    adios_read_close (f);
+    free (data);
+
+    adios_read_finalize_method (ADIOS_READ_METHOD_BP);
+    adios_finalize (0);
+    return err;
+}
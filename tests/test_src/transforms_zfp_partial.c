@@ -0,0 +1,222 @@
+/*
+ * ADIOS is freely available under the terms of the BSD license described
+ * in the COPYING file in the top level directory of this source distribution.
+ *
+ * Copyright (c) 2008 - 2009.  UT-BATTELLE, LLC. All rights reserved.
+ */
+
+/* ADIOS test: reading parts of ZFP fixed-rate compressed blocks ("zfp:rate=R").
+ *
+ * 1D, 2D and 3D arrays of doubles, with sizes that are not multiples of 4, are
+ * written with ZFP in fixed-rate mode. The whole arrays are read (decompressing
+ * all ZFP blocks), then planes, lines and boxes are read, which decompress only the
+ * rows of ZFP blocks they need. Since the compression is lossy, the values are
+ * compared to the corresponding part of the whole array, they must be identical.
+ * Timings are printed for both.
+ *
+ * How to run: transforms_zfp_partial [edge of the 3D array]
+ * Output: transforms_zfp_partial.bp, timings, non-zero exit code on mismatch
+ *
+ * This is a sequential test.
+ */
+#ifndef _NOMPI
+#define _NOMPI
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <inttypes.h>
+#include <string.h>
+#include <math.h>
+#include <sys/time.h>
+#include "public/adios.h"
+#include "public/adios_read.h"
+
+static const char FILENAME[] = "transforms_zfp_partial.bp";
+
+static double now ()
+{
+    struct timeval tp;
+    gettimeofday (&tp, NULL);
+    return (double) tp.tv_sec + (double) tp.tv_usec * 1.0e-6;
+}
+
+struct box
+{
+    const char * name;
+    uint64_t start[3];
+    uint64_t count[3];
+};
+
+static int write_file (const uint64_t * dims)
+{
+    int64_t group, fh, varid;
+    char dimstr[3][64];
+    double * data;
+    uint64_t n = dims[0] * dims[1] * dims[2], i;
+
+    data = (double *) malloc (n * sizeof (double));
+    if (!data)
+    {
+        printf ("ERROR: cannot allocate %" PRIu64 " doubles\n", n);
+        return 1;
+    }
+    for (i = 0; i < n; i++)
+        data[i] = sin (i * 0.001) * 100.0 + cos (i * 0.37);
+
+    snprintf (dimstr[0], sizeof (dimstr[0]), "%" PRIu64, n);
+    snprintf (dimstr[1], sizeof (dimstr[1]), "%" PRIu64 ",%" PRIu64, dims[0] * dims[1], dims[2]);
+    snprintf (dimstr[2], sizeof (dimstr[2]), "%" PRIu64 ",%" PRIu64 ",%" PRIu64, dims[0], dims[1], dims[2]);
+
+    adios_declare_group (&group, "zfp", "", adios_stat_no);
+    adios_select_method (group, "POSIX", "", "");
+    varid = adios_define_var (group, "a1", "", adios_double, dimstr[0], dimstr[0], "0");
+    adios_set_transform (varid, "zfp:rate=16");
+    varid = adios_define_var (group, "a2", "", adios_double, dimstr[1], dimstr[1], "0,0");
+    adios_set_transform (varid, "zfp:rate=16");
+    varid = adios_define_var (group, "a3", "", adios_double, dimstr[2], dimstr[2], "0,0,0");
+    adios_set_transform (varid, "zfp:rate=12");
+
+    adios_open (&fh, "zfp", FILENAME, "w", MPI_COMM_SELF);
+    adios_write (fh, "a1", data);
+    adios_write (fh, "a2", data);
+    adios_write (fh, "a3", data);
+    adios_close (fh);
+
+    free (data);
+    return 0;
+}
+
+/* Read a box and compare it to the same part of the whole array */
+static int read_box (ADIOS_FILE * f, const char * varname, int ndim, const uint64_t * dims,
+                     const struct box * b, const double * whole, double * data, double * t)
+{
+    ADIOS_SELECTION * sel = adios_selection_boundingbox (ndim, b->start, b->count);
+    uint64_t i, j, k, pos = 0;
+    uint64_t c[3] = {1, 1, 1}, s[3] = {0, 0, 0}, d[3] = {1, 1, 1};
+    double t0 = now ();
+
+    adios_schedule_read (f, sel, varname, 0, 1, data);
+    adios_perform_reads (f, 1);
+    *t = now () - t0;
+    adios_selection_delete (sel);
+
+    // pad the box to 3D
+    for (i = 0; i < ndim; i++)
+    {
+        c[3 - ndim + i] = b->count[i];
+        s[3 - ndim + i] = b->start[i];
+        d[3 - ndim + i] = dims[i];
+    }
+    for (i = 0; i < c[0]; i++)
+    {
+        for (j = 0; j < c[1]; j++)
+        {
+            for (k = 0; k < c[2]; k++, pos++)
+            {
+                uint64_t w = ((s[0] + i) * d[1] + s[1] + j) * d[2] + s[2] + k;
+                if (data[pos] != whole[w])
+                {
+                    printf ("ERROR: %s, %s: element %" PRIu64 " of the box is %g instead of %g\n",
+                            varname, b->name, pos, data[pos], whole[w]);
+                    return 1;
+                }
+            }
+        }
+    }
+    return 0;
+}
+
+static int read_var (ADIOS_FILE * f, const char * varname, int ndim, const uint64_t * dims,
+                     const struct box * boxes, int nboxes, double * whole, double * data)
+{
+    uint64_t zero[3] = {0, 0, 0};
+    ADIOS_SELECTION * sel = adios_selection_boundingbox (ndim, zero, dims);
+    double t0, t_whole, t;
+    int err = 0, k;
+
+    t0 = now ();
+    adios_schedule_read (f, sel, varname, 0, 1, whole);
+    adios_perform_reads (f, 1);
+    t_whole = now () - t0;
+    adios_selection_delete (sel);
+
+    printf ("%-4s %-28s %10.6f s\n", varname, "whole array", t_whole);
+    for (k = 0; k < nboxes; k++)
+    {
+        err |= read_box (f, varname, ndim, dims, &boxes[k], whole, data, &t);
+        printf ("%-4s %-28s %10.6f s\n", varname, boxes[k].name, t);
+    }
+    return err;
+}
+
+int main (int argc, char ** argv)
+{
+    uint64_t e = 62;
+    uint64_t dims[3], dims2[2], dims1[1];
+    ADIOS_FILE * f;
+    double * whole, * data;
+    int err = 0;
+
+    if (argc > 1)
+    {
+        e = strtoull (argv[1], NULL, 10);
+    }
+    if (e < 16)
+    {
+        printf ("ERROR: edge of the 3D array must be at least 16\n");
+        return 1;
+    }
+    dims[0] = e; dims[1] = e - 5; dims[2] = e + 3;
+    dims2[0] = dims[0] * dims[1]; dims2[1] = dims[2];
+    dims1[0] = dims[0] * dims[1] * dims[2];
+
+    adios_init_noxml (MPI_COMM_SELF);
+    adios_read_init_method (ADIOS_READ_METHOD_BP, MPI_COMM_SELF, "");
+
+    if (write_file (dims))
+        return 1;
+
+    whole = (double *) malloc (dims1[0] * sizeof (double));
+    data = (double *) malloc (dims1[0] * sizeof (double));
+    f = adios_read_open_file (FILENAME, ADIOS_READ_METHOD_BP, MPI_COMM_SELF);
+    if (!f || !whole || !data)
+    {
+        printf ("ERROR: cannot open %s: %s\n", FILENAME, adios_errmsg ());
+        return 1;
+    }
+
+    {
+        struct box boxes3[] = {
+            {"plane of the 1st dim",    {e / 2, 0, 0},         {1, dims[1], dims[2]}},
+            {"plane of the 2nd dim",    {0, 7, 0},             {dims[0], 1, dims[2]}},
+            {"plane of the 3rd dim",    {0, 0, dims[2] - 1},   {dims[0], dims[1], 1}},
+            {"line of the 3rd dim",     {3, 5, 0},             {1, 1, dims[2]}},
+            {"interior box",            {e / 4, e / 4, e / 4}, {e / 2, e / 2, e / 2}},
+            {"last planes",             {dims[0] - 2, 0, 0},   {2, dims[1], dims[2]}},
+        };
+        struct box boxes2[] = {
+            {"one row",                 {dims2[0] / 3, 0},     {1, dims2[1]}},
+            {"one column",              {0, 5},                {dims2[0], 1}},
+            {"last rows",               {dims2[0] - 3, 0},     {3, dims2[1]}},
+        };
+        struct box boxes1[] = {
+            {"a few elements",          {1001},                {7}},
+            {"the tail",                {dims1[0] - 5},        {5}},
+        };
+
+        printf ("Reading from %" PRIu64 "x%" PRIu64 "x%" PRIu64 " doubles\n", dims[0], dims[1], dims[2]);
+        err |= read_var (f, "a3", 3, dims, boxes3, sizeof (boxes3) / sizeof (boxes3[0]), whole, data);
+        err |= read_var (f, "a2", 2, dims2, boxes2, sizeof (boxes2) / sizeof (boxes2[0]), whole, data);
+        err |= read_var (f, "a1", 1, dims1, boxes1, sizeof (boxes1) / sizeof (boxes1[0]), whole, data);
+    }
+
+    adios_read_close (f);
+    free (whole);
+    free (data);
+
+    adios_read_finalize_method (ADIOS_READ_METHOD_BP);
+    adios_finalize (0);
+    return err;
+}
@@ -0,0 +1,257 @@
+/*
+ * ADIOS is freely available under the terms of the BSD license described
+ * in the COPYING file in the top level directory of this source distribution.
+ *
+ * Copyright (c) 2008 - 2009.  UT-BATTELLE, LLC. All rights reserved.
+ */
+
+/* ADIOS test: zero-copy writes of large arrays with the POSIX method.
+ *
+ * Write NSTEPS steps of NLARGE large arrays, NSMALL small arrays, a scalar
+ * and an attribute, then read back and check everything. This is done
+ *   - copying all arrays into the buffer
+ *   - with zero_copy, where the large arrays are written from user memory
+ *   - with zero_copy and a buffer too small for the small arrays, so that
+ *     the buffer overflows and each step is written in several PGs
+ * The write time of each case is printed.
+ *
+ * How to run: zero_copy [MB per large array]
+ * Output: zero_copy_[012].bp, timings, non-zero exit code on mismatch
+ *
+ * This is a sequential test.
+ */
+#ifndef _NOMPI
+#define _NOMPI
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <sys/time.h>
+#include "public/adios.h"
+#include "public/adios_read.h"
+
+#define NLARGE 3
+#define NSMALL 4
+#define NSTEPS 3
+#define SMALL_N (300 * 1024 / sizeof (double))   // 300 KB, below the threshold
+#define THRESHOLD_KB 512
+
+static double now ()
+{
+    struct timeval tp;
+    gettimeofday (&tp, NULL);
+    return (double) tp.tv_sec + (double) tp.tv_usec * 1.0e-6;
+}
+
+static double value (int step, int var, uint64_t i)
+{
+    return step * 1000000.0 + var * 1000.0 + (double) (i % 997);
+}
+
+/* arrays [v] holds variable v: large ones first, then the small ones */
+static void fill (double ** arrays, uint64_t n, int step)
+{
+    uint64_t i;
+    int v;
+    for (v = 0; v < NLARGE + NSMALL; v++)
+    {
+        uint64_t count = (v < NLARGE ? n : SMALL_N);
+        for (i = 0; i < count; i++)
+            arrays [v][i] = value (step, v, i);
+    }
+}
+
+static void var_name (int v, char * name)
+{
+    if (v < NLARGE)
+        sprintf (name, "large%d", v);
+    else
+        sprintf (name, "small%d", v - NLARGE);
+}
+
+static int write_steps (const char * groupname, const char * filename, uint64_t n,
+                        double ** arrays, double * t_write)
+{
+    int64_t fh;
+    char name[16];
+    uint64_t small_n = SMALL_N;
+    int s, v;
+    double t;
+
+    *t_write = 0;
+    for (s = 0; s < NSTEPS; s++)
+    {
+        // arrays must not change until adios_close(), set them all up front
+        fill (arrays, n, s);
+        t = now ();
+        adios_open (&fh, groupname, filename, (s ? "a" : "w"), MPI_COMM_SELF);
+        adios_write (fh, "n", &n);
+        adios_write (fh, "small_n", &small_n);
+        for (v = 0; v < NLARGE + NSMALL; v++)
+        {
+            var_name (v, name);
+            if (adios_write (fh, name, arrays [v]))
+            {
+                printf ("ERROR: writing %s failed: %s\n", name, adios_errmsg ());
+                return 1;
+            }
+        }
+        adios_write (fh, "step", &s);
+        adios_close (fh);
+        *t_write += now () - t;
+    }
+    return 0;
+}
+
+static int check_steps (const char * filename, uint64_t n, double * data)
+{
+    ADIOS_FILE * f;
+    ADIOS_SELECTION * sel;
+    uint64_t start = 0, i;
+    char name[16];
+    int s, v, err = 0;
+    enum ADIOS_DATATYPES type;
+    int size;
+    void * attr;
+
+    f = adios_read_open_file (filename, ADIOS_READ_METHOD_BP, MPI_COMM_SELF);
+    if (!f)
+    {
+        printf ("ERROR: cannot open %s: %s\n", filename, adios_errmsg ());
+        return 1;
+    }
+    if (f->last_step + 1 != NSTEPS)
+    {
+        printf ("ERROR: %s has %d steps instead of %d\n", filename, f->last_step + 1, NSTEPS);
+        adios_read_close (f);
+        return 1;
+    }
+    if (adios_get_attr (f, "large0/unit", &type, &size, &attr) || strcmp ((char *) attr, "m"))
+    {
+        printf ("ERROR: attribute large0/unit is missing or wrong\n");
+        adios_read_close (f);
+        return 1;
+    }
+    free (attr);
+
+    for (s = 0; s < NSTEPS && !err; s++)
+    {
+        int step = -1;
+        sel = adios_selection_writeblock (0);
+        adios_schedule_read (f, sel, "step", s, 1, &step);
+        adios_perform_reads (f, 1);
+        adios_selection_delete (sel);
+        if (step != s)
+        {
+            printf ("ERROR: step %d: scalar step is %d\n", s, step);
+            err = 1;
+        }
+        for (v = 0; v < NLARGE + NSMALL && !err; v++)
+        {
+            uint64_t count = (v < NLARGE ? n : SMALL_N);
+            var_name (v, name);
+            memset (data, 0, count * sizeof (double));
+            sel = adios_selection_boundingbox (1, &start, &count);
+            adios_schedule_read (f, sel, name, s, 1, data);
+            adios_perform_reads (f, 1);
+            adios_selection_delete (sel);
+            for (i = 0; i < count; i++)
+            {
+                if (data[i] != value (s, v, i))
+                {
+                    printf ("ERROR: step %d %s[%llu] = %g instead of %g\n", s, name,
+                            (unsigned long long) i, data[i], value (s, v, i));
+                    err = 1;
+                    break;
+                }
+            }
+        }
+    }
+    adios_read_close (f);
+    return err;
+}
+
+int main (int argc, char ** argv)
+{
+    int64_t group;
+    uint64_t n, mb = 16;
+    double * arrays [NLARGE + NSMALL];
+    double * data;
+    double t_write;
+    char groupname[16], varname[16], filename[32], params[32];
+    int v, mode, err = 0;
+    static const char * modes[] = { "copy", "zero-copy", "zero-copy, overflow" };
+
+    if (argc > 1)
+    {
+        mb = atoi (argv[1]);
+    }
+    if (mb < 1)
+    {
+        printf ("ERROR: size must be at least 1 MB\n");
+        return 1;
+    }
+    n = mb * 1024 * 1024 / sizeof (double);
+
+    data = (double *) malloc (n * sizeof (double));
+    for (v = 0; v < NLARGE + NSMALL; v++)
+    {
+        arrays [v] = (double *) malloc ((v < NLARGE ? n : SMALL_N) * sizeof (double));
+        if (!arrays [v] || !data)
+        {
+            printf ("ERROR: cannot allocate %llu MB\n", (unsigned long long) mb);
+            return 1;
+        }
+    }
+
+    adios_init_noxml (MPI_COMM_SELF);
+    adios_read_init_method (ADIOS_READ_METHOD_BP, MPI_COMM_SELF, "");
+
+    printf ("Write %d steps of %d x %llu MB and %d x 300 KB\n", NSTEPS, NLARGE,
+            (unsigned long long) mb, NSMALL);
+    for (mode = 0; mode < 3 && !err; mode++)
+    {
+        if (mode == 2)
+        {
+            // the small arrays do not fit, the buffer overflows in each step
+            adios_release_buffers ();
+            adios_set_max_buffer_size (1);
+        }
+
+        sprintf (groupname, "zc%d", mode);
+        adios_declare_group (&group, groupname, "", adios_stat_no);
+        params[0] = '\0';
+        if (mode)
+            sprintf (params, "zero_copy=%d", THRESHOLD_KB);
+        adios_select_method (group, "POSIX", params, "");
+        adios_define_var (group, "n", "", adios_unsigned_long, "", "", "");
+        adios_define_var (group, "small_n", "", adios_unsigned_long, "", "", "");
+        for (v = 0; v < NLARGE + NSMALL; v++)
+        {
+            var_name (v, varname);
+            adios_define_var (group, varname, "", adios_double,
+                              (v < NLARGE ? "n" : "small_n"), (v < NLARGE ? "n" : "small_n"), "0");
+        }
+        adios_define_var (group, "step", "", adios_integer, "", "", "");
+        adios_define_attribute (group, "unit", "large0", adios_string, "m", "");
+
+        sprintf (filename, "zero_copy_%d.bp", mode);
+        err = write_steps (groupname, filename, n, arrays, &t_write);
+        if (!err)
+            err = check_steps (filename, n, data);
+        printf ("  %-20s write %.3f s\n", modes[mode], t_write);
+    }
+
+    adios_read_finalize_method (ADIOS_READ_METHOD_BP);
+    adios_finalize (0);
+    for (v = 0; v < NLARGE + NSMALL; v++)
+        free (arrays [v]);
+    free (data);
+    if (err)
+        printf ("FAILED\n");
+    else
+        printf ("OK\n");
+    return err;
+}